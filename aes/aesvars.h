@@ -38,6 +38,7 @@ static __inline__ EVB *FAKE_EVB(EVB **root)
 extern UBYTE    indisp;
 
 extern WORD     fpt, fph, fpcnt;                /* forkq tail, head, count */
+extern ULONG    fpdrop;                         /* forkq entries lost */
 
 extern SPB      wind_spb;
 extern WORD     curpid;
@@ -27,6 +27,8 @@
 #include "gempd.h"
 #include "geminput.h"
 #include "gemflag.h"
+#include "gemqueue.h"
+#include "gemasync.h"
 #include "gemevlib.h"
 #include "gemgsxif.h"
 #include "gemwmlib.h"
@@ -57,6 +59,10 @@ WORD ap_init(void)
 
     pid = rlr->p_pid;
 
+#if CONF_WITH_EVNT_PERSIST
+    apcancel(rlr->p_evpersist);     /* left over by a previous program */
+#endif
+
     rlr->p_flags |= AP_OPEN;        /* appl_init() done */
 
     return pid;
@@ -81,6 +87,13 @@ WORD ap_rdwr(WORD code, AESPD *p, WORD length, WORD *pbuff)
         return 1;       /* non-zero means it worked */
     }
 
+    /*
+     * likewise if it is a standard 16-byte write that can be done
+     * without blocking
+     */
+    if ((code == MU_SDMSG) && (length == 16) && aqwrite(p, length, pbuff))
+        return 1;
+
     m.qpb_ppd = p;
     m.qpb_cnt = length;
     m.qpb_buf = (LONG)pbuff;
@@ -115,6 +128,11 @@ WORD ap_find(char *pname)
  *  mouse movement.  in this case, we need to:
  *      a) disconnect the cursor from the VDI (done here), and
  *      b) draw it ourselves (done in mchange() in geminput.c).
+ *
+ *  consecutive mouse movements, with no time elapsing between them, are
+ *  replayed as a single movement to the last position.  this avoids
+ *  queueing, dispatching & drawing the cursor for intermediate positions
+ *  that would be overwritten immediately.
  */
 void ap_tplay(const EVNTREC *pbuff,WORD length,WORD scale)
 {
@@ -150,6 +168,8 @@ void ap_tplay(const EVNTREC *pbuff,WORD length,WORD scale)
                 gsx_0code(MOT_VECX);
                 m_lptr2(&mot_vecx_save);
             }
+            if ((i < length-1) && ((pbuff+1)->ap_event == MCHNG))
+                continue;
             f.f_code = mchange;
             break;
         case KCHNG:
@@ -251,6 +271,9 @@ WORD ap_trecd(EVNTREC *pbuff,WORD length)
 void ap_exit(void)
 {
     wm_update(BEG_UPDATE);
+#if CONF_WITH_EVNT_PERSIST
+    apcancel(rlr->p_evpersist);
+#endif
     mn_cleanup();
     wait_for_accs(AP_ACCLOSE);  /* block until all DAs have seen AC_CLOSE */
     if (rlr->p_qindex)
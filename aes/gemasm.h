@@ -29,4 +29,9 @@ extern void dsptch(void);
 /* called by disp() to end a dsptch ... switchto sequence */
 extern void switchto(UDA *puda) NORETURN ;
 
+#if CONF_WITH_AES_PREEMPTION
+/* where the timer interrupt returns to, to preempt the process in context */
+extern void aes_preempt(void);
+#endif
+
 #endif
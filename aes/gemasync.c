@@ -131,6 +131,12 @@ EVSPEC iasync(WORD afunc, LONG aparm)
 {
     EVB *e;
 
+#if CONF_WITH_EVNT_PERSIST
+    /* a persistent event must not satisfy a wait with other parameters */
+    if (rlr->p_evpersist & afunc)
+        apcancel(afunc);
+#endif
+
     /* get an evb */
     if ((e = eul) == NULL)
         panic("no free EVBs available\n");
@@ -241,3 +247,32 @@ EVSPEC acancel(EVSPEC m)
 
     return m1;
 }
+
+
+#if CONF_WITH_EVNT_PERSIST
+/*
+ *  Remove the persistent events in mask, whether they are still
+ *  waiting or have completed since they were armed
+ */
+void apcancel(EVSPEC mask)
+{
+    EVSPEC done, bit;
+
+    mask &= rlr->p_evpersist;
+    if (!mask)
+        return;
+
+    rlr->p_evpersist &= ~mask;
+
+    /* completed events are left on the zombie list by acancel() */
+    done = acancel(mask);
+    for (bit = 1; done; bit <<= 1)
+    {
+        if (done & bit)
+        {
+            apret(bit);
+            done &= ~bit;
+        }
+    }
+}
+#endif
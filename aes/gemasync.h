@@ -16,5 +16,8 @@ EVSPEC mwait(EVSPEC mask);
 EVSPEC iasync(WORD afunc, LONG aparm);
 UWORD apret(EVSPEC mask);
 EVSPEC acancel(EVSPEC m);
+#if CONF_WITH_EVNT_PERSIST
+void apcancel(EVSPEC mask);
+#endif
 
 #endif
@@ -37,22 +37,87 @@
 #include "gemdosif.h"
 
 #include "asm.h"
+#if CONF_WITH_PROCTIME
+#include "gemdos.h"
+#include "gemerror.h"
+#endif
+#if CONF_WITH_PROCTIME || CONF_WITH_AES_PREEMPTION
+#include "tosvars.h"
+#endif
+#if CONF_WITH_AES_PREEMPTION
+#include "biosext.h"
+#include "gemshlib.h"
+#endif
 
 #define KEYMASK 0xffff0000L             /* for comparing data to KEYSTOP */
 #define KEYSTOP 0x2b1c0000L             /* control-backslash */
 
+#if CONF_WITH_AES_FOREGROUND_BOOST
+/*
+ * when the process that owns the mouse becomes ready, it is put at the
+ * front of the ready list rather than at the end, so that it runs before
+ * any background processes.  to avoid starving the latter, it may jump
+ * the queue at most MAX_BOOSTS times in succession before another
+ * process gets a turn.
+ */
+#define MAX_BOOSTS  2
+
+static WORD boosts;         /* number of successive boosts so far */
+#endif
+
+#if CONF_WITH_PROCTIME
+static ULONG disp_stamp;    /* hz_200 when rlr was switched to */
+#endif
+
+#if CONF_WITH_AES_PREEMPTION
+/*
+ * a process that computes for longer than its time slice without calling
+ * the AES is switched out, as if it had called appl_yield(), provided
+ * that the system timer interrupted it in user mode (so that it is not
+ * in the middle of a call to the OS) and that there is something else
+ * to do.  the process that owns the mouse gets a longer time slice.
+ *
+ * since preempt_tick() is called at interrupt level, it cannot switch
+ * processes itself: it makes the timer interrupt return to aes_preempt()
+ * (in gemasm.S) instead, keeping a copy of the original exception frame
+ * in preempt_frame[] for it.  if the BIOS Timer C handler was called by
+ * another interrupt handler rather than by the hardware, its exception
+ * frame is a supervisor mode one, so nothing is ever preempted.
+ */
+#define FG_SLICE    40      /* time slices in hz_200 ticks: mouse owner */
+#define BG_SLICE    8       /* other processes */
+
+UWORD preempt_frame[4];     /* exception frame of the interrupted code */
+UBYTE preempt_pending;      /* TRUE until aes_preempt() has run */
+static ULONG slice_stamp;   /* hz_200 when rlr was switched to */
+#endif
+
 
 /*
  * forkq(): put an FPD (containing a function address and a parameter) into the fork ring
  *
  * this is expected to be called with interrupts disabled
  *
+ * if this is a mouse movement, and the most recently queued FPD is also
+ * a mouse movement that has not yet been handled by forker(), we just
+ * update the position in that FPD: only the latest position matters
+ *
  * returns -ve value iff it fails (the fork ring is full)
  */
 WORD forkq(FCODE fcode, LONG fdata)
 {
     FPD *f;
 
+    if ((fcode == mchange) && fpcnt)
+    {
+        f = &D.g_fpdx[(fpt ? fpt : NFORKS) - 1];
+        if (f->f_code == mchange)
+        {
+            f->f_data = fdata;
+            return 0;
+        }
+    }
+
     if (fpcnt < NFORKS)
     {
         f = &D.g_fpdx[fpt++];
@@ -66,6 +131,7 @@ WORD forkq(FCODE fcode, LONG fdata)
         return 0;   /* forkq() succeeded */
     }
 
+    fpdrop++;
     KDEBUG(("forkq() failed: fcode=%p, fdata=0x%08lx\n",fcode,fdata));
     return -1;      /* forkq() failed */
 }
@@ -75,6 +141,15 @@ static void disp_act(AESPD *p)
 {
     /* process is ready, so put him on RLR */
     p->p_stat &= ~WAITIN;
+#if CONF_WITH_AES_FOREGROUND_BOOST
+    if ((p == gl_mowner) && (boosts < MAX_BOOSTS))
+    {
+        boosts++;
+        p->p_link = rlr;
+        rlr = p;
+        return;
+    }
+#endif
     insert_process(p, &rlr);
 }
 
@@ -224,6 +299,9 @@ void disp(void)
 
     /* take the process p off the ready list root */
     p = rlr;
+#if CONF_WITH_PROCTIME
+    p->p_ticks += hz_200 - disp_stamp;
+#endif
     rlr = p->p_link;
     KDEBUG(("disp() to \"%8.8s\"\n", rlr->p_name));
 
@@ -243,6 +321,18 @@ void disp(void)
         schedule();
     } while (fpcnt);
 
+#if CONF_WITH_AES_FOREGROUND_BOOST
+    if (rlr != gl_mowner)
+        boosts = 0;
+#endif
+
+#if CONF_WITH_PROCTIME
+    disp_stamp = hz_200;
+#endif
+#if CONF_WITH_AES_PREEMPTION
+    slice_stamp = hz_200;
+#endif
+
     /* switchto() is a machine dependent routine which:
      *      1) restores machine state
      *      2) clear "indisp" semaphore
@@ -251,3 +341,94 @@ void disp(void)
      */
     switchto(rlr->p_uda);
 }
+
+#if CONF_WITH_AES_PREEMPTION
+/*
+ * called by tikcod() on each AES timer tick, to preempt the process in
+ * context if it has used up its time slice
+ */
+void preempt_tick(void)
+{
+    UWORD *frame = timerc_frame;
+    UWORD *sr;
+    WORD i;
+
+    /* not while a TOS program is running, or a switch is under way */
+    if (indisp || preempt_pending || !gl_shgem)
+        return;
+
+#ifdef __mcoldfire__
+    sr = frame + 1;         /* after the format/vector word */
+#else
+    sr = frame;
+#endif
+    if (*sr & 0x2000)       /* interrupted in supervisor mode */
+        return;
+
+    if (hz_200 - slice_stamp < ((rlr == gl_mowner) ? FG_SLICE : BG_SLICE))
+        return;
+
+    /* only if another process is ready, or events wait to be handled */
+    if (!rlr->p_link && !drl && !fpcnt)
+        return;
+
+    for (i = 0; i < 4; i++)
+        preempt_frame[i] = frame[i];
+
+    /* return to aes_preempt() in supervisor mode, without tracing */
+    *(ULONG *)(sr + 1) = (ULONG)aes_preempt;
+    *sr = (*sr & 0x0700) | 0x2000;
+    preempt_pending = TRUE;
+}
+#endif
+
+#if CONF_WITH_PROCTIME
+/*
+ * get the time in context of the AES process with the given id,
+ * for Sproctime(PT_AES)
+ */
+static LONG disp_proctime(WORD pid, PROCTIME *info)
+{
+    AESPD *p;
+    WORD i;
+
+    if ((pid < 0) || (pid >= curpid))
+        return ERANGE;
+
+    p = pd_index(pid);
+    info->pt_id = p->p_pid;
+    info->pt_ticks = p->p_ticks;
+    if (p == rlr)
+        info->pt_ticks += hz_200 - disp_stamp;
+
+    /* the name is padded with spaces: strip them */
+    memcpy(info->pt_name, p->p_name, AP_NAMELEN);
+    for (i = AP_NAMELEN; (i > 0) && (info->pt_name[i-1] == ' '); i--)
+        ;
+    info->pt_name[i] = '\0';
+
+    return E_OK;
+}
+
+/*
+ * start counting the time in context of the AES processes
+ */
+void proctime_start(void)
+{
+    WORD i;
+
+    for (i = 0; i < totpds; i++)
+        pd_index(i)->p_ticks = 0;
+    disp_stamp = hz_200;
+    aes_proctime = disp_proctime;
+}
+
+/*
+ * stop counting, when the AES terminates
+ */
+void proctime_stop(void)
+{
+    aes_proctime = NULL;
+}
+#endif
+
@@ -16,4 +16,15 @@ WORD forkq(FCODE fcode, LONG fdata);
 void forker(void);
 void chkkbd(void);
 
+#if CONF_WITH_PROCTIME
+void proctime_start(void);
+void proctime_stop(void);
+#endif
+
+#if CONF_WITH_AES_PREEMPTION
+extern UWORD preempt_frame[4];
+extern UBYTE preempt_pending;
+void preempt_tick(void);
+#endif
+
 #endif
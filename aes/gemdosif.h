@@ -37,6 +37,8 @@ extern void aes_wheel(void);
 
 extern void unset_aestrap(void);
 extern void set_aestrap(void);
+extern void aestrap(void);
+extern PFVOID savetrap2;                        /* trap #2 before the AES */
 
 extern void takeerr(void);
 extern void giveerr(void);
@@ -137,6 +137,62 @@ void ev_timer(LONG count)
 }
 
 
+#if CONF_WITH_EVNT_PERSIST
+/*
+ *  Check if a waiting mouse rectangle event has the given parameters
+ */
+static BOOL same_mrect(EVB *e, MOBLK *pmo)
+{
+    if (((e->e_flag & EVMOUT) != 0) != (pmo->m_out != 0))
+        return FALSE;
+
+    return (e->e_parm == MAKE_ULONG(pmo->m_gr.g_x, pmo->m_gr.g_y))
+        && (e->e_return == MAKE_ULONG(pmo->m_gr.g_w, pmo->m_gr.g_h));
+}
+
+
+/*
+ *  Return the persistent events in mask that are still waiting with
+ *  the given parameters, and remove all the other persistent events
+ */
+static EVSPEC ev_persist(EVSPEC mask, LONG buparm, MOBLK *pmo1, MOBLK *pmo2)
+{
+    EVSPEC  keep;
+    EVB     *e;
+
+    if (!rlr->p_evpersist)
+        return 0;
+
+    keep = 0;
+    for (e = rlr->p_evlist; e; e = e->e_nextp)
+    {
+        if (!(e->e_mask & mask & rlr->p_evpersist) || (e->e_flag & COMPLETE))
+            continue;
+
+        switch(e->e_mask)
+        {
+        case MU_BUTTON:
+            if (e->e_parm == buparm)
+                keep |= MU_BUTTON;
+            break;
+        case MU_M1:
+            if (same_mrect(e, pmo1))
+                keep |= MU_M1;
+            break;
+        case MU_M2:
+            if (same_mrect(e, pmo2))
+                keep |= MU_M2;
+            break;
+        }
+    }
+
+    apcancel(rlr->p_evpersist & ~keep);
+
+    return keep;
+}
+#endif
+
+
 /*
  *  Do a multi-wait on the specified events
  *
@@ -147,6 +203,11 @@ void ev_timer(LONG count)
  *      [3] key state (as returned by vq_key_s())
  *      [4] keyboard character (iff MU_KEYBD specified & character available)
  *      [5] # mouse button clicks (iff MU_BUTTON specified & there are clicks)
+ *
+ *  If MU_PERSIST is specified, the button and mouse rectangle events are
+ *  left armed on return, and are reused by the next ev_multi() as long
+ *  as it specifies the same parameters.  Events that complete between
+ *  two calls are discarded, like those of a non-persistent wait.
  */
 #if CONF_WITH_MENU_EXTENSION
 WORD ev_multi(WORD flags, MOBLK *pmo1, MOBLK *pmo2, MOBLK *pmo3, LONG tmcount,
@@ -160,6 +221,9 @@ WORD ev_multi(WORD flags, MOBLK *pmo1, MOBLK *pmo2, LONG tmcount,
     EVSPEC  which;
     WORD    what;
     CQUEUE  *pc;
+#if CONF_WITH_EVNT_PERSIST
+    EVSPEC  persist, armed;
+#endif
 
     /* say nothing has happened yet */
     what = 0;
@@ -169,6 +233,15 @@ WORD ev_multi(WORD flags, MOBLK *pmo1, MOBLK *pmo2, LONG tmcount,
     chkkbd();
     forker();
 
+#if CONF_WITH_EVNT_PERSIST
+    /* only events with no side effect on other waits may persist */
+    persist = (flags & MU_PERSIST) ? (flags & (MU_BUTTON|MU_M1|MU_M2)) : 0;
+    if (LOBYTE(HIWORD(buparm)) > 1)
+        persist &= ~MU_BUTTON;      /* multi-click waits change b_click() */
+    armed = ev_persist(persist, buparm, pmo1, pmo2);
+    flags &= ~MU_PERSIST;
+#endif
+
     /* a keystroke */
     if (flags & MU_KEYBD)
     {
@@ -234,6 +307,16 @@ WORD ev_multi(WORD flags, MOBLK *pmo1, MOBLK *pmo2, LONG tmcount,
         /* wait for a keystroke */
         if (flags & MU_KEYBD)
             iasync(MU_KEYBD, 0L);
+#if CONF_WITH_EVNT_PERSIST
+        /* wait for a button & mouse rectangles, unless still armed */
+        if ((flags & MU_BUTTON) && !(armed & MU_BUTTON))
+            iasync(MU_BUTTON, buparm);
+        if ((flags & MU_M1) && !(armed & MU_M1))
+            iasync(MU_M1, (LONG)pmo1);
+        if ((flags & MU_M2) && !(armed & MU_M2))
+            iasync(MU_M2, (LONG)pmo2);
+        rlr->p_evpersist = persist;
+#else
         /* wait for a button */
         if (flags & MU_BUTTON)
             iasync(MU_BUTTON, buparm);
@@ -242,6 +325,7 @@ WORD ev_multi(WORD flags, MOBLK *pmo1, MOBLK *pmo2, LONG tmcount,
             iasync(MU_M1, (LONG)pmo1);
         if (flags & MU_M2)
             iasync(MU_M2, (LONG)pmo2);
+#endif
 #if CONF_WITH_MENU_EXTENSION
         if (flags & MU_M3)
             iasync(MU_M3, (LONG)pmo3);
@@ -260,8 +344,16 @@ WORD ev_multi(WORD flags, MOBLK *pmo1, MOBLK *pmo2, LONG tmcount,
         /* wait for events */
         which = mwait(flags);
 
+#if CONF_WITH_EVNT_PERSIST
+        /* cancel outstanding events, except the persistent ones */
+        which |= acancel(flags & ~persist);
+
+        /* the persistent events that occurred are freed by apret() below */
+        rlr->p_evpersist &= ~which;
+#else
         /* cancel outstanding events */
         which |= acancel( flags );
+#endif
     }
 
     /* get the returns */
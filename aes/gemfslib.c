@@ -33,6 +33,9 @@
 #include "intmath.h"
 #include "asm.h"
 #include "miscutil.h"
+#if CONF_WITH_AES_FSEL_CACHE
+#include "biosext.h"
+#endif
 
 #define NM_NAMES (F9NAME-F1NAME+1)
 #define NAME_OFFSET F1NAME
@@ -49,9 +52,27 @@ static GRECT gl_rfs;
 static const char gl_fsobj[4] = {FTITLE, FILEBOX, SCRLBAR, 0x0};
 
 static char *ad_fsnames;    /* holds filenames in currently-displayed directory */
-static LONG *g_fslist;      /* offsets of filenames within ad_fsnames */
+static SORTKEY *g_fslist;   /* sort keys & offsets of filenames in ad_fsnames */
+static SORTKEY *g_fswork;   /* work area for sorting g_fslist[] */
 static LONG nm_files;       /* total number of slots in g_fslist[] */
 
+#if CONF_WITH_AES_FSEL_CACHE
+#define FSCACHE_SIZE 4096           /* max length of cached filenames */
+
+/*
+ * the sorted filenames of the last directory read by fs_active(), stored
+ * as consecutive strings in the same format as ad_fsnames.  the cache is
+ * valid while path[0] is non-zero and the BDOS change counter is unchanged.
+ */
+static struct {
+    ULONG chgcnt;                   /* value of 'dirchgcnt' when read */
+    WORD count;                     /* number of filenames */
+    WORD len;                       /* total length of names[] used */
+    char path[LEN_ZPATH+1];         /* path+filespec that was read */
+    char names[FSCACHE_SIZE];
+} fs_cache;
+#endif
+
 
 /*
  *  initialise the file selector
@@ -240,9 +261,9 @@ static char *fs_pspec(char *pstr, char *pend)
  *  Routine to compare files based on name
  *  Note: folders always sort lowest because the first character is \007
  */
-static WORD fs_comp(char *name1, char *name2)
+static WORD fs_comp(LONG index1, LONG index2)
 {
-    return strcmp(name1, name2);
+    return strcmp(ad_fsnames+index1, ad_fsnames+index2);
 }
 
 
@@ -250,14 +271,72 @@ static LONG fs_add(WORD thefile, LONG fs_index)
 {
     WORD len;
 
-    g_fslist[thefile] = fs_index;
-    ad_fsnames[fs_index++] = (D.g_dta.d_attrib & FA_SUBDIR) ? 0x07 : ' ';
-    len = strlencpy(ad_fsnames+fs_index,D.g_dta.d_fname);
-    fs_index += len + 1;
+    g_fslist[thefile].item = fs_index;
+    ad_fsnames[fs_index] = (D.g_dta.d_attrib & FA_SUBDIR) ? 0x07 : ' ';
+    len = strlencpy(ad_fsnames+fs_index+1,D.g_dta.d_fname);
+    g_fslist[thefile].key = sort_strkey(ad_fsnames+fs_index);
+    fs_index += len + 2;
     return fs_index;
 }
 
 
+#if CONF_WITH_AES_FSEL_CACHE
+/*
+ *  Set up the file list from the cache, if it is valid for this path
+ *
+ *  Returns TRUE iff the cache was used
+ */
+static BOOL fs_getcache(char *ppath, WORD *pcount)
+{
+    WORD drive, i;
+    LONG fs_index;
+
+    if (!fs_cache.path[0] || (fs_cache.chgcnt != dirchgcnt))
+        return FALSE;
+    if ((fs_cache.count > nm_files) || strcmp(fs_cache.path, ppath))
+        return FALSE;
+
+    /* media changes are not seen by the BDOS until it accesses the drive */
+    drive = extract_drive_number(ppath);
+    if (drive < 0)
+        drive = dos_gdrv();
+    if (drvrem & (1L << drive))
+        return FALSE;
+
+    memcpy(ad_fsnames, fs_cache.names, fs_cache.len);
+    for (i = 0, fs_index = 0L; i < fs_cache.count; i++)
+    {
+        g_fslist[i].item = fs_index;
+        fs_index += strlen(ad_fsnames+fs_index) + 1;
+    }
+    *pcount = fs_cache.count;
+
+    return TRUE;
+}
+
+
+/*
+ *  Save the sorted file list in the cache, if it fits
+ */
+static void fs_putcache(char *ppath, WORD count, LONG len, ULONG chgcnt)
+{
+    char *p;
+    WORD i;
+
+    fs_cache.path[0] = '\0';
+    if (len > FSCACHE_SIZE)
+        return;
+
+    for (i = 0, p = fs_cache.names; i < count; i++)
+        p += strlencpy(p, ad_fsnames+g_fslist[i].item) + 1;
+    fs_cache.chgcnt = chgcnt;
+    fs_cache.count = count;
+    fs_cache.len = len;
+    strcpy(fs_cache.path, ppath);
+}
+#endif
+
+
 /*
  *  Make a particular path the active path.  This involves
  *  reading its directory, initializing a file list, and filling
@@ -268,10 +347,16 @@ static LONG fs_add(WORD thefile, LONG fs_index)
 static WORD fs_active(char *ppath, char *pspec, WORD *pcount)
 {
     WORD ret;
-    LONG thefile, fs_index, temp;
-    WORD i, j, gap;
+    LONG thefile, fs_index;
     char *fname, allpath[LEN_ZPATH+1];
     DTA *user_dta;
+#if CONF_WITH_AES_FSEL_CACHE
+    ULONG chgcnt;
+
+    if (fs_getcache(ppath, pcount))
+        return TRUE;
+    chgcnt = dirchgcnt;
+#endif
 
     set_mouse_to_hourglass();
 
@@ -284,7 +369,7 @@ static WORD fs_active(char *ppath, char *pspec, WORD *pcount)
 
     user_dta = dos_gdta();          /* remember user's DTA */
     dos_sdta(&D.g_dta);
-    ret = dos_sfirst(allpath, FA_SUBDIR);
+    ret = dos_bsfirst(allpath, FA_SUBDIR);
 
     /*
      * like Atari TOS, we silently ignore any filenames that we don't
@@ -303,32 +388,23 @@ static WORD fs_active(char *ppath, char *pspec, WORD *pcount)
                 thefile++;
             }
         }
-        ret = dos_snext();
+        ret = dos_bsnext();
     }
 
     *pcount = thefile;
     dos_sdta(user_dta);             /* restore user DTA */
 
-    /* sort files using shell sort from page 108 of K&R C Prog. Lang. */
-    for (gap = thefile/2; gap > 0; gap /= 2)
-    {
-        for (i = gap; i < thefile; i++)
-        {
-            for (j = i-gap; j >= 0; j -= gap)
-            {
-                if (fs_comp(ad_fsnames+g_fslist[j],ad_fsnames+g_fslist[j+gap]) <= 0)
-                    break;
-                temp = g_fslist[j];
-                g_fslist[j] = g_fslist[j+gap];
-                g_fslist[j+gap] = temp;
-            }
-        }
-    }
+    sort_keys(g_fslist, thefile, g_fswork, fs_comp);
 
     set_mouse_to_arrow();
 
     if ((ret == EFILNF) || (ret == ENMFIL))
+    {
+#if CONF_WITH_AES_FSEL_CACHE
+        fs_putcache(ppath, thefile, fs_index, chgcnt);
+#endif
         return TRUE;
+    }
 
     if (!IS_BIOS_ERROR(ret))    /* if BDOS error, issue message via form_error(): */
         fm_error(-ret-31);      /* (need to convert to 'MS-DOS error code')       */
@@ -373,7 +449,7 @@ static void fs_format(OBJECT *tree, WORD currtop, WORD count)
     {
         if (i < cnt)
         {
-            p = ad_fsnames + g_fslist[currtop+i];
+            p = ad_fsnames + g_fslist[currtop+i].item;
             fmt_str(p+1, name+1);       /* format file/folder name */
             name[0] = p[0];             /* copy file/folder indicator */
         }
@@ -646,23 +722,25 @@ WORD fs_input(char *pipath, char *pisel, WORD *pbutton, char *pilabel)
      *
      * the order of data within the gotten area is:
      *  filename pointers
+     *  work area for sorting the filename pointers
      *  filename array
      *  locstr
      *  locold
      *  mask
      */
     memblk = NULL;
-    nm_files = (dos_avail_anyram()-LEN_FSWORK) / (LEN_FSNAME+sizeof(char *));
+    nm_files = (dos_avail_anyram()-LEN_FSWORK) / (LEN_FSNAME+2*sizeof(SORTKEY));
     if (nm_files >= NM_NAMES)
-        memblk = dos_alloc_anyram(nm_files*(LEN_FSNAME+sizeof(char *))+LEN_FSWORK);
+        memblk = dos_alloc_anyram(nm_files*(LEN_FSNAME+2*sizeof(SORTKEY))+LEN_FSWORK);
     if (!memblk)
     {
         fm_show(ALFSMEM, NULL, 1);
         return FALSE;
     }
 
-    g_fslist = (LONG *)memblk;
-    ad_fsnames = (char *)(g_fslist+nm_files);
+    g_fslist = (SORTKEY *)memblk;
+    g_fswork = g_fslist + nm_files;
+    ad_fsnames = (char *)(g_fswork+nm_files);
     locstr = ad_fsnames + (nm_files * LEN_FSNAME);
     locold = locstr + LEN_FSPATH;
     mask = locold + LEN_FSPATH;
@@ -75,6 +75,9 @@ static WORD     gl_tcolor;      /* text colour (vst_color) */
 static WORD     gl_lcolor;      /* line colour (vsl_color) */
 static WORD     gl_fis;         /* interior type (vsf_interior) */
 static WORD     gl_patt;        /* style of fill pattern (vsf_style) */
+static WORD     gl_fcolor;      /* fill colour (vsf_color) */
+static GRECT    gl_vclip;       /* clip rectangle last passed to vs_clip() */
+static BOOL     gl_vclipok;     /* TRUE iff gl_vclip is valid */
 static WORD     gl_font;        /* font type (IBM/SMALL) for v_gtext */
 
 static WORD     gl_wptschar;    /* width of character (normal font) */
@@ -92,6 +95,11 @@ void gsx_sclip(const GRECT *pt)
 {
     gl_clip = *pt;
 
+    if (gl_vclipok && rc_equal(&gl_clip, &gl_vclip))
+        return;
+    gl_vclip = gl_clip;
+    gl_vclipok = TRUE;
+
     if (gl_clip.g_w && gl_clip.g_h)
     {
         ptsin[0] = gl_clip.g_x;
@@ -376,6 +384,19 @@ void gsx_trans(void *addr, UWORD wb, UWORD h)
 }
 
 
+/*
+ *  Routine to forget the VDI attributes that we believe are set, so
+ *  that the next calls to set them are really made.  This is done on
+ *  every AES call, since applications often share our workstation.
+ */
+void gsx_resetattr(void)
+{
+    gl_mode = gl_tcolor = gl_lcolor = -1;
+    gl_fis = gl_patt = gl_font = gl_fcolor = -1;
+    gl_vclipok = FALSE;
+}
+
+
 /*
  *  Routine to initialize all the global variables dealing with
  *  a particular workstation open
@@ -385,8 +406,7 @@ void gsx_start(void)
     WORD dummy;
 
     /* reset variables to force initial VDI calls */
-    gl_mode = gl_tcolor = gl_lcolor = -1;
-    gl_fis = gl_patt = gl_font = -1;
+    gsx_resetattr();
 
     gl_clip.g_x = 0;
     gl_clip.g_y = 0;
@@ -453,6 +473,19 @@ void bb_fill(WORD mode, WORD fis, WORD patt, WORD hx, WORD hy, WORD hw, WORD hh)
 }
 
 
+/*
+ *  Routine to set the fill colour
+ */
+void gsx_fcolor(WORD color)
+{
+    if (color != gl_fcolor)
+    {
+        vsf_color(color);
+        gl_fcolor = color;
+    }
+}
+
+
 static UWORD ch_width(WORD fn)
 {
     if (fn == IBM)
@@ -554,7 +587,7 @@ void gr_rect(UWORD icolor, UWORD ipattern, GRECT *pt)
     else if (ipattern == IP_SOLID)
         fis = FIS_SOLID;
 
-    vsf_color(icolor);
+    gsx_fcolor(icolor);
     bb_fill(MD_REPLACE, fis, ipattern, pt->g_x, pt->g_y, pt->g_w, pt->g_h);
 }
 
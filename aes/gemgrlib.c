@@ -37,6 +37,7 @@
 
 #include "intmath.h"
 #include "asm.h"
+#include "tosvars.h"
 
 /*
  *  Routine to watch the mouse while the button is down and it stays
@@ -166,28 +167,33 @@ static void gr_draw(WORD have2box, GRECT *po, GRECT *poff)
 }
 
 
-static BOOL gr_wait(GRECT *po, GRECT *poff)
+/*
+ *  Move the XOR box(es) from *po to *pn, and update *po.
+ *
+ *  Nothing is drawn if the box has not changed (e.g. it is constrained,
+ *  or clamped to its minimum size).  Otherwise the old box is erased and
+ *  the new one drawn back to back, so that there is never a moment with
+ *  no box on the screen, and at most once per VBL: mouse movements that
+ *  arrive faster than that are merged into the next update, since the
+ *  new box is always computed from the current mouse position.
+ */
+static void gr_move(WORD have2box, GRECT *po, GRECT *pn, GRECT *poff)
 {
-    WORD have2box;
-    BOOL down;
-
-    have2box = !rc_equal(&gl_rzero, poff);
+    static LONG lastframe;
 
-    /* draw/erase old */
-    gsx_moff();
-    gr_draw(have2box, po, poff);
-    gsx_mon();
+    if (rc_equal(po, pn))
+        return;
 
-    /* wait for change */
-    down = gr_stilldn(TRUE, xrat, yrat, 1, 1);
+    while (frclock == lastframe)    /* already updated during this VBL */
+        ;
 
-    /* draw/erase old */
     gsx_moff();
-    gr_draw(have2box, po, poff);
+    gr_draw(have2box, po, poff);    /* erase old */
+    gr_draw(have2box, pn, poff);    /* draw new */
     gsx_mon();
 
-    /* return exit event */
-    return down;
+    lastframe = frclock;
+    rc_copy(pn, po);
 }
 
 
@@ -199,20 +205,32 @@ static BOOL gr_wait(GRECT *po, GRECT *poff)
 void gr_rubwind(WORD xorigin, WORD yorigin, WORD wmin, WORD hmin,
                 GRECT *poff, WORD *pwend, WORD *phend)
 {
-    BOOL    down;
-    GRECT   o;
+    WORD    have2box;
+    GRECT   o, n;
 
     wm_update(BEG_UPDATE);
     gr_setup(BLACK);
 
+    have2box = !rc_equal(&gl_rzero, poff);
     r_set(&o, xorigin, yorigin, 0, 0);
 
     /* clamp size of rubber box to no smaller than wmin, hmin */
-    do
+    gr_clamp(o.g_x, o.g_y, wmin, hmin, &o.g_w, &o.g_h);
+    gsx_moff();
+    gr_draw(have2box, &o, poff);
+    gsx_mon();
+
+    while (gr_stilldn(TRUE, xrat, yrat, 1, 1))
     {
-        gr_clamp(o.g_x, o.g_y, wmin, hmin, &o.g_w, &o.g_h);
-        down = gr_wait(&o, poff);
-    } while (down);
+        rc_copy(&o, &n);
+        gr_clamp(n.g_x, n.g_y, wmin, hmin, &n.g_w, &n.g_h);
+        gr_move(have2box, &o, &n, poff);
+    }
+
+    /* erase final box */
+    gsx_moff();
+    gr_draw(have2box, &o, poff);
+    gsx_mon();
 
     *pwend = o.g_w;
     *phend = o.g_h;
@@ -244,8 +262,7 @@ void gr_dragbox(WORD w, WORD h, WORD sx, WORD sy, GRECT *pc,
                 WORD *pdx, WORD *pdy)
 {
     WORD    offx, offy;
-    BOOL    down;
-    GRECT   o;
+    GRECT   o, n;
 
     wm_update(BEG_UPDATE);
     gr_setup(BLACK);
@@ -254,13 +271,26 @@ void gr_dragbox(WORD w, WORD h, WORD sx, WORD sy, GRECT *pc,
     r_set(&o, sx, sy, w, h);
 
     /* get box's x,y from mouse's x,y then constrain result */
-    do
+    o.g_x = xrat - offx;
+    o.g_y = yrat - offy;
+    rc_constrain(pc, &o);
+    gsx_moff();
+    gsx_xbox(&o);
+    gsx_mon();
+
+    while (gr_stilldn(TRUE, xrat, yrat, 1, 1))
     {
-        o.g_x = xrat - offx;
-        o.g_y = yrat - offy;
-        rc_constrain(pc, &o);
-        down = gr_wait(&o, &gl_rzero);
-    } while (down);
+        rc_copy(&o, &n);
+        n.g_x = xrat - offx;
+        n.g_y = yrat - offy;
+        rc_constrain(pc, &n);
+        gr_move(FALSE, &o, &n, &gl_rzero);
+    }
+
+    /* erase final box */
+    gsx_moff();
+    gsx_xbox(&o);
+    gsx_mon();
 
     *pdx = o.g_x;
     *pdy = o.g_y;
@@ -27,6 +27,7 @@
 #include "geminit.h"
 #include "gemctrl.h"
 #include "gemgsxif.h"
+#include "rectfunc.h"
 #include "xbiosbind.h"
 #include "has.h"        /* for blitter-related items */
 #include "biosdefs.h"   /* for FALCON_REZ */
@@ -78,6 +79,12 @@ GLOBAL WORD  gl_moff;                /* counting semaphore   */
                                      /*  >  0 implies OFF    */
 
 static FDB   gl_tmp;
+static void  *gl_bbbig;              /* buffer for a large saved area */
+#if CONF_WITH_AES_MENU_CACHE
+static FDB   gl_mcache;              /* image of the last drop-down menu */
+static ULONG gl_mckey;               /* key of cached image, 0 => none */
+static GRECT gl_mcrect;              /* screen area of cached image */
+#endif
 static PFVOID old_mcode;
 static PFVOID old_bcode;
 static LONG  gl_mlen;
@@ -111,12 +118,28 @@ void gsx_malloc(void)
 
     mlen = gsx_mcalc();                     /* need side effects now     */
     gl_tmp.fd_addr = dos_alloc_anyram(mlen);
+
+#if CONF_WITH_AES_MENU_CACHE
+    gl_mcache = gl_tmp;
+    gl_mcache.fd_addr = dos_alloc_anyram(mlen);
+    gl_mcache.fd_stand = TRUE;
+    gl_mckey = 0L;
+#endif
 }
 
 
 
 void gsx_mfree(void)
 {
+#if CONF_WITH_AES_MENU_CACHE
+    if (gl_mcache.fd_addr)
+        dos_free(gl_mcache.fd_addr);
+    gl_mcache.fd_addr = NULL;
+    gl_mckey = 0L;
+#endif
+    if (gl_bbbig)
+        dos_free(gl_bbbig);
+    gl_bbbig = NULL;
     dos_free(gl_tmp.fd_addr);
 }
 
@@ -317,62 +340,57 @@ void gsx_graphic(BOOL tographic)
 
 
 
-static void bb_set(BOOL save, GRECT *r)
+/*
+ * number of words per plane needed to hold the screen area *r, keeping
+ * its alignment within the first word
+ */
+#define bb_wdwidth(r)   ((((r)->g_x & 0x000f) + (r)->g_w + 15) / 16)
+
+/*
+ * copy an area of the screen to (save) or from (!save) the buffer
+ * described by *pbuf, whose fd_addr & fd_nplanes must be set.  the area
+ * has the same alignment in the buffer as on the screen, so the copy is
+ * not widened to word boundaries, and restoring it does not change
+ * anything outside the area.
+ */
+static void bb_blit(BOOL save, const GRECT *r, FDB *pbuf)
 {
     FDB *psrc, *pdst;
     WORD pxyarray[8], *pts1, *pts2;
-    WORD sx, sy, sw, sh, oldsx;
-    LONG            size;
-
-    /* extract x/y/w/h from GRECT */
-    r_get(r, &sx, &sy, &sw, &sh);
+    WORD bx;
 
-    /* get on word boundary */
-    oldsx = sx;
-    sx = (sx / 16) * 16;
-    sw = ( ((oldsx - sx) + (sw + 15)) / 16 ) * 16;
-    size = memsize(sw/16,sh,gl_tmp.fd_nplanes);
-
-    if (size > gl_mlen) {       /* buffer too small */
-        /* adjust height to fit buffer: this will leave droppings! */
-        sh = (ULONG)gl_mlen * sh / size;
-
-        /* issue warning message for backup only, not for subsequent restore */
-        if (save)
-            KINFO(("Menu/alert buffer too small: need at least %ld bytes\n",size));
-    }
+    bx = r->g_x & 0x000f;       /* same alignment as on the screen */
+    pbuf->fd_stand = TRUE;
+    pbuf->fd_wdwidth = bb_wdwidth(r);
+    pbuf->fd_w = pbuf->fd_wdwidth * 16;
+    pbuf->fd_h = r->g_h;
 
     gsx_fix_screen(&gl_src);
-    /* gl_tmp.fd_addr was set by gsx_malloc() */
-    gl_tmp.fd_stand = TRUE;
-    gl_tmp.fd_wdwidth = sw / 16;
-    gl_tmp.fd_w = sw;
-    gl_tmp.fd_h = sh;
 
     if (save)
     {
         psrc = &gl_src;
-        pdst = &gl_tmp;
+        pdst = pbuf;
         pts1 = pxyarray;
         pts2 = pxyarray + 4;
     }
     else
     {
-        psrc = &gl_tmp;         /* invert FDBs & coordinates */
+        psrc = pbuf;            /* invert FDBs & coordinates */
         pdst = &gl_src;
         pts1 = pxyarray + 4;
         pts2 = pxyarray;
     }
 
     gsx_moff();
-    pts1[0] = sx;
-    pts1[1] = sy;
-    pts1[2] = sx + sw - 1;
-    pts1[3] = sy + sh - 1;
-    pts2[0] = 0;
+    pts1[0] = r->g_x;
+    pts1[1] = r->g_y;
+    pts1[2] = r->g_x + r->g_w - 1;
+    pts1[3] = r->g_y + r->g_h - 1;
+    pts2[0] = bx;
     pts2[1] = 0;
-    pts2[2] = sw - 1;
-    pts2[3] = sh - 1 ;
+    pts2[2] = bx + r->g_w - 1;
+    pts2[3] = r->g_h - 1;
 
     vro_cpyfm(S_ONLY, pxyarray, psrc, pdst);
     gsx_mon();
@@ -380,6 +398,56 @@ static void bb_set(BOOL save, GRECT *r)
 
 
 
+/*
+ * save or restore the screen under a menu or alert
+ *
+ * an area too large for the menu/alert buffer is saved in a separate
+ * buffer, allocated by the save and freed by the restore (which are
+ * always done by the same process)
+ */
+static void bb_set(BOOL save, GRECT *r)
+{
+    FDB buf;
+    GRECT t;
+    LONG size;
+
+    rc_copy(r, &t);
+    buf = gl_tmp;               /* gl_tmp.fd_addr was set by gsx_malloc() */
+    size = memsize(bb_wdwidth(&t), t.g_h, buf.fd_nplanes);
+
+    if (size > gl_mlen)
+    {
+        if (save)
+        {
+            if (gl_bbbig)       /* not restored: "can't happen" */
+                dos_free(gl_bbbig);
+            gl_bbbig = dos_alloc_anyram(size);
+        }
+
+        if (gl_bbbig)
+            buf.fd_addr = gl_bbbig;
+        else
+        {
+            /* adjust height to fit buffer: this will leave droppings! */
+            t.g_h = (ULONG)gl_mlen * t.g_h / size;
+
+            /* issue warning message for backup only, not for subsequent restore */
+            if (save)
+                KINFO(("Menu/alert buffer too small: need at least %ld bytes\n",size));
+        }
+    }
+
+    bb_blit(save, &t, &buf);
+
+    if (!save && (size > gl_mlen) && gl_bbbig)
+    {
+        dos_free(gl_bbbig);
+        gl_bbbig = NULL;
+    }
+}
+
+
+
 void bb_save(GRECT *ps)
 {
     bb_set(TRUE, ps);
@@ -393,6 +461,58 @@ void bb_restore(GRECT *pr)
 }
 
 
+#if CONF_WITH_AES_MENU_CACHE
+/*
+ * copy an area of the screen to (save) or from (!save) the menu cache
+ * buffer
+ *
+ * returns FALSE iff there is no cache buffer, or it is too small
+ */
+static BOOL bb_cache(BOOL save, const GRECT *r)
+{
+    if (!gl_mcache.fd_addr)
+        return FALSE;
+
+    if (memsize(bb_wdwidth(r),r->g_h,gl_mcache.fd_nplanes) > gl_mlen)
+        return FALSE;
+
+    bb_blit(save, r, &gl_mcache);
+
+    return TRUE;
+}
+
+
+/*
+ * save the screen area *pr in the menu cache, under the specified
+ * (non-zero) key
+ */
+void bb_cache_save(const GRECT *pr, ULONG key)
+{
+    gl_mckey = 0L;
+    if (key && bb_cache(TRUE, pr))
+    {
+        gl_mckey = key;
+        rc_copy(pr, &gl_mcrect);
+    }
+}
+
+
+/*
+ * restore the screen area *pr from the menu cache, if it was saved
+ * from the same area under the same key
+ *
+ * returns TRUE iff the area was restored
+ */
+BOOL bb_cache_restore(const GRECT *pr, ULONG key)
+{
+    if (!key || (key != gl_mckey) || !rc_equal(pr, &gl_mcrect))
+        return FALSE;
+
+    return bb_cache(FALSE, pr);
+}
+#endif
+
+
 
 WORD gsx_tick(void *tcode, void *ptsave)
 {
@@ -447,6 +567,31 @@ void gsx_moff(void)
 
 
 
+#if CONF_WITH_MOUSE_EXCLUSION
+/*
+ * gsx_moff_rect - like gsx_moff(), for drawing that is confined to the
+ * specified rectangle
+ *
+ * the VDI leaves the mouse cursor on the screen if it is outside the
+ * rectangle (and removes it if it moves inside); gsx_mon() ends this
+ */
+void gsx_moff_rect(const GRECT *pt)
+{
+    if (!gl_moff)
+    {
+        ptsin[0] = pt->g_x;
+        ptsin[1] = pt->g_y;
+        ptsin[2] = pt->g_x + pt->g_w - 1;
+        ptsin[3] = pt->g_y + pt->g_h - 1;
+        gsx_ncode(HIDE_CUR, 2, 0);
+    }
+
+    gl_moff++;
+}
+#endif
+
+
+
 void gsx_mon(void)
 {
     gl_moff--;
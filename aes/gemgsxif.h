@@ -34,6 +34,10 @@ void gsx_init(void);
 void gsx_graphic(BOOL tographic);
 void bb_save(GRECT *ps);
 void bb_restore(GRECT *pr);
+#if CONF_WITH_AES_MENU_CACHE
+void bb_cache_save(const GRECT *pr, ULONG key);
+BOOL bb_cache_restore(const GRECT *pr, ULONG key);
+#endif
 
 WORD gsx_tick(void *tcode, void *ptsave);
 void gsx_mfset(const MFORM *pmfnew);
@@ -42,6 +46,9 @@ void gsx_mxmy(WORD *pmx, WORD *pmy);
 WORD gsx_kstate(void);
 void gsx_mon(void);
 void gsx_moff(void);
+#if CONF_WITH_MOUSE_EXCLUSION
+void gsx_moff_rect(const GRECT *pt);
+#endif
 WORD gsx_char(void);
 void gsx_setmousexy(WORD x, WORD y);
 WORD gsx_nplanes(void);
@@ -37,10 +37,12 @@
 #include "gemctrl.h"
 #include "gemshlib.h"
 #include "gempd.h"
+#include "gemdisp.h"
 #include "gemrslib.h"
 #include "gemdos.h"
 #include "gemevlib.h"
 #include "gemwmlib.h"
+#include "gemwrect.h"
 #include "gemfslib.h"
 #include "gemsclib.h"
 #include "gemfmlib.h"
@@ -66,8 +68,6 @@ LONG init_p0_stkptr(void);      /* called only from gemstart.S */
 void run_accs_and_desktop(void);/* called only from gemstart.S */
 void gem_main(void);            /* called only from gemstart.S */
 
-#define ROPEN 0
-
 #define NUM_MOUSE_CURSORS   8
 
 #if CONF_WITH_LOADABLE_CURSORS
@@ -135,6 +135,7 @@ GLOBAL UBYTE    indisp;
 
 GLOBAL WORD     fpt, fph, fpcnt;                /* forkq tail, head,    */
                                                 /*   count              */
+GLOBAL ULONG    fpdrop;                         /* forkq entries lost   */
 GLOBAL SPB      wind_spb;
 GLOBAL WORD     curpid;
 
@@ -231,29 +232,20 @@ static AESPD *iprocess(char *pname, PFVOID routine)
  *  Routine to load program file pointed at by acc->name, then create a
  *  new process context for it.  The load address is stored in acc->addr.
  *
- *  This is used to load a desk accessory.
+ *  This is used to load a desk accessory.  The file is loaded via
+ *  Pexec(), so with CONF_WITH_PGM_CACHE, an accessory reloaded after a
+ *  resolution change is copied from the program cache.
  */
 static void load_one_acc(ACC *acc)
 {
-    WORD    handle;
-    WORD    err_ret;
-    LONG    ret;
-
     KDEBUG(("load_one_acc(\"%s\")\n", (const char *)acc->name));
 
     acc->addr = -1L;
     strcpy(D.s_cmd, acc->name);
 
-    ret = dos_open(D.s_cmd, ROPEN);
-    if (ret >= 0L)
-    {
-        handle = (WORD)ret;
-        err_ret = pgmld(handle, D.s_cmd, (LONG **)&acc->addr);
-        dos_close(handle);
-        /* create process to execute it */
-        if (err_ret != -1)
-            pstart(gotopgm, acc->name, acc->addr);
-    }
+    /* create process to execute it */
+    if (pgmld(D.s_cmd, (LONG **)&acc->addr) == 0)
+        pstart(gotopgm, acc->name, acc->addr);
 }
 
 
@@ -685,6 +677,9 @@ void run_accs_and_desktop(void)
     sh_put(CP_SHELL_INIT,sizeof(CP_SHELL_INIT)-1);  /* see description at top */
 
     load_accs(num_accs);            /* load up to 'num_accs' desk accessories */
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("load_accs");
+#endif
 
     /* fix up icons */
     for (i = 0; i < 3; i++) {
@@ -728,6 +723,7 @@ void run_accs_and_desktop(void)
     }
 #endif
 
+    or_alloc();                     /* allocate extra window rectangles */
     wm_start();                     /* initialise window vars */
     fs_start();                     /* startup gem libs */
     build_root_path(D.s_cdir, 'A'+dos_gdrv());  /* root of current drive */
@@ -735,6 +731,9 @@ void run_accs_and_desktop(void)
 
     dsptch();                       /* off we go !!! */
     wait_for_accs(AP_MESAG);        /* wait until DAs have initialised */
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("AES init");
+#endif
 
     sh_main(isauto, isgem);         /* main shell loop */
 
@@ -762,8 +761,18 @@ void gem_main(void)
      */
     dos_conws("\033f\033E");    /* cursor off, clear screen */
 
-    /* read in first part of emudesk.inf */
-    n = readfile(INF_FILE_NAME, INF_SIZE, infbuf);
+    /*
+     * read in first part of emudesk.inf.  after a resolution change,
+     * the desktop has just saved its current EMUDESK.INF data in the
+     * shell buffer, so we use that instead of reading the file again.
+     */
+    if (gl_changerez && (D.g_shelbuf[CPDATA_LEN] == '#'))
+    {
+        memcpy(infbuf, D.g_shelbuf+CPDATA_LEN, INF_SIZE);
+        n = INF_SIZE;
+    }
+    else
+        n = readfile(INF_FILE_NAME, INF_SIZE, infbuf);
 
     if (n < 0L)
         n = 0L;
@@ -843,6 +852,7 @@ void gem_main(void)
     nrl = drl = NULL;
     dlr = zlr = NULL;
     fph = fpt = fpcnt = 0;
+    fpdrop = 0L;
 
     /* init initial process */
     for(i=totpds-1; i>=0; i--)
@@ -875,6 +885,10 @@ void gem_main(void)
 
     /* end of process init */
 
+#if CONF_WITH_PROCTIME
+    proctime_start();
+#endif
+
     /* restart the tick     */
     enable_interrupts();
 
@@ -893,8 +907,16 @@ void gem_main(void)
     /* restore previous trap#2 address */
     disable_interrupts();
     unset_aestrap();
+#if CONF_WITH_PROCTIME
+    proctime_stop();
+#endif
     enable_interrupts();
 
+#if CONF_WITH_DSYNC
+    /* make sure everything is on disk before the shutdown or rez change */
+    Dsync(-1);
+#endif
+
     if (D.g_acc)
         dos_free(D.g_acc);
 }
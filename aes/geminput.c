@@ -509,6 +509,12 @@ void adelay(EVB *e, LONG c)
          */
         if (c <= CMP_TICK)
             CMP_TICK = c;
+
+        /*
+         * the delays in the list are relative to the time that NUM_TICK
+         * was last reset, so make this one relative to that time too
+         */
+        c += NUM_TICK;
     }
     else
     {
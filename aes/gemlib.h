@@ -86,6 +86,7 @@ typedef struct window
 } WINDOW;
 
 #define NUM_ORECT (NUM_WIN * 10)        /* is this enough???    */
+#define NUM_ORECT_EXTRA (NUM_WIN * NUM_WIN * 2) /* allocated at startup */
 
 #define WS_FULL 0
 #define WS_CURR 1
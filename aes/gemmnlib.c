@@ -31,6 +31,7 @@
 #include "gemgsxif.h"
 #include "gemevlib.h"
 #include "gemoblib.h"
+#include "gemobjop.h"
 #include "gemwmlib.h"
 #include "gemgraf.h"
 #include "geminput.h"
@@ -67,6 +68,30 @@ static WORD     acc_display[NUM_ACCS];
 
 GLOBAL WORD     gl_dafirst;     /* object # of first DA entry */
 
+#if CONF_WITH_MENU_ITEM_LOOKUP
+#define MNL_MAX     64      /* max number of items handled by a lookup */
+
+/*
+ * the items of a pulled-down menu, when they form a column of contiguous
+ * objects of the same size (the usual case).  the item under the mouse
+ * is then found directly from the y position, instead of via ob_find().
+ */
+typedef struct {
+    OBJECT  *tree;          /* NULL => no lookup available */
+    WORD    root;           /* the menu box */
+    WORD    count;          /* number of items */
+    WORD    hit;            /* index of the item last found */
+    GRECT   box;            /* area of the menu box, as tested by ob_find() */
+    GRECT   first;          /* screen rectangle of the first item */
+    WORD    item[MNL_MAX];
+} MNLOOKUP;
+
+static MNLOOKUP mnl_menu;
+#if CONF_WITH_MENU_EXTENSION
+static MNLOOKUP mnl_submenu;
+#endif
+#endif
+
 
 static WORD menu_sub(OBJECT *tree, WORD ititle)
 {
@@ -125,12 +150,128 @@ static void menu_fixup(void)
 }
 
 
+#if CONF_WITH_MENU_ITEM_LOOKUP
+/*
+ *  Set up the lookup for the items of menu box root
+ */
+static void mnl_build(MNLOOKUP *p, OBJECT *tree, WORD root)
+{
+    OBJECT  *objptr;
+    GRECT   t;
+    WORD    obj, n;
+
+    p->tree = NULL;
+
+    for (n = 0, obj = tree[root].ob_head; (obj != root) && (obj != NIL); obj = tree[obj].ob_next)
+    {
+        objptr = tree + obj;
+        if ((n >= MNL_MAX) || (objptr->ob_flags & HIDETREE) || (objptr->ob_state & SHADOWED))
+            return;
+
+        ob_actxywh(tree, obj, &t);
+        if (n == 0)
+        {
+            if (t.g_h <= 0)
+                return;
+            p->first = t;
+        }
+        else if ((t.g_x != p->first.g_x) || (t.g_w != p->first.g_w)
+              || (t.g_h != p->first.g_h) || (t.g_y != p->first.g_y + n * t.g_h))
+            return;
+        p->item[n++] = obj;
+    }
+
+    if (n == 0)
+        return;
+
+    /* ob_find() ignores 3D adjustments for a shadowed object */
+#if CONF_WITH_3D_OBJECTS
+    if (tree[root].ob_state & SHADOWED)
+    {
+        ob_actxywh(tree, get_par(tree, root), &t);
+        r_set(&p->box, t.g_x + tree[root].ob_x, t.g_y + tree[root].ob_y,
+                tree[root].ob_width, tree[root].ob_height);
+    }
+    else
+#endif
+        ob_actxywh(tree, root, &p->box);
+
+    p->root = root;
+    p->count = n;
+    p->hit = 0;
+    p->tree = tree;
+}
+
+
+/*
+ *  Find the item of menu box root under the mouse: this returns the same
+ *  as ob_find(tree, root, 1, mx, my)
+ */
+static WORD mnl_find(MNLOOKUP *p, OBJECT *tree, WORD root, WORD mx, WORD my)
+{
+    WORD    i;
+
+    if ((p->tree != tree) || (p->root != root))
+        return ob_find(tree, root, 1, mx, my);
+
+    if (!inside(mx, my, &p->box))
+        return NIL;
+
+    if ((mx < p->first.g_x) || (mx >= p->first.g_x + p->first.g_w) || (my < p->first.g_y))
+        return root;
+
+    i = (my - p->first.g_y) / p->first.g_h;
+    if (i >= p->count)
+        return root;
+
+    p->hit = i;
+
+    return p->item[i];
+}
+
+
+/*
+ *  Get the screen rectangle of the item last found by mnl_find()
+ */
+static BOOL mnl_rect(MNLOOKUP *p, OBJECT *tree, WORD iob, GRECT *pt)
+{
+    if ((p->tree != tree) || (p->item[p->hit] != iob))
+        return FALSE;
+
+    *pt = p->first;
+    pt->g_y += p->hit * p->first.g_h;
+
+    return TRUE;
+}
+
+
+/*
+ *  Like ob_actxywh(), but using the lookups for the current menu items
+ */
+static void mnl_actxywh(OBJECT *tree, WORD iob, GRECT *pt)
+{
+    if (mnl_rect(&mnl_menu, tree, iob, pt))
+        return;
+#if CONF_WITH_MENU_EXTENSION
+    if (mnl_rect(&mnl_submenu, tree, iob, pt))
+        return;
+#endif
+
+    ob_actxywh(tree, iob, pt);
+}
+#endif
+
+
 /*
  *  Change a mouse-wait rectangle based on an object's size
  */
 static void rect_change(OBJECT *tree, MOBLK *prmob, WORD iob, BOOL x)
 {
+#if CONF_WITH_MENU_ITEM_LOOKUP
+    mnl_actxywh(tree, iob, &prmob->m_gr);
+#else
     ob_actxywh(tree, iob, &prmob->m_gr);
+#endif
     prmob->m_out = x;
 }
 
@@ -222,6 +363,100 @@ static void menu_sr(WORD saveit, OBJECT *tree, WORD imenu)
 }
 
 
+#if CONF_WITH_AES_MENU_CACHE
+static ULONG mc_sum;            /* checksum of menu objects, 0 => can't cache */
+
+#define MC_ADD(sum,val)     (((sum) << 5) + (sum) + (UWORD)(val))
+
+/*
+ * add an object into the menu checksum
+ *
+ * this covers everything that affects the appearance of the object,
+ * except for the contents of images & icons.  since applications often
+ * modify menu objects directly (rather than via objc_change() etc), this
+ * is how we detect that a cached menu image is out of date.
+ */
+static void mc_sumobj(OBJECT *tree, WORD obj, WORD x, WORD y)
+{
+    OBJECT  *objptr = tree + obj;
+    TEDINFO *ted;
+    const char *s = NULL;
+    LONG    spec;
+    ULONG   sum;
+
+    if (!mc_sum)
+        return;
+
+    spec = objptr->ob_spec;
+    if (objptr->ob_flags & INDIRECT)
+        spec = *(LONG *)objptr->ob_spec;
+
+    sum = MC_ADD(mc_sum, x);
+    sum = MC_ADD(sum, y);
+    sum = MC_ADD(sum, objptr->ob_width);
+    sum = MC_ADD(sum, objptr->ob_height);
+    sum = MC_ADD(sum, objptr->ob_type);
+    sum = MC_ADD(sum, objptr->ob_flags);
+    sum = MC_ADD(sum, objptr->ob_state);
+    sum = MC_ADD(sum, HIWORD(spec));
+    sum = MC_ADD(sum, LOWORD(spec));
+
+    switch(objptr->ob_type & 0x00ff)
+    {
+    case G_USERDEF:
+        mc_sum = 0L;        /* drawn by the application */
+        return;
+    case G_STRING:
+    case G_TITLE:
+    case G_BUTTON:
+        s = (const char *)spec;
+        break;
+    case G_TEXT:
+    case G_BOXTEXT:
+    case G_FTEXT:
+    case G_FBOXTEXT:
+        ted = (TEDINFO *)spec;
+        sum = MC_ADD(sum, ted->te_font);
+        sum = MC_ADD(sum, ted->te_just);
+        sum = MC_ADD(sum, ted->te_color);
+        sum = MC_ADD(sum, ted->te_thickness);
+        s = ted->te_ptext;
+        break;
+    }
+
+    if (s)
+        while(*s)
+            sum = MC_ADD(sum, *s++);
+
+    mc_sum = sum ? sum : 1L;
+}
+
+
+/*
+ *  Draw the menu sub-tree imenu, from the menu cache if possible
+ */
+static void menu_draw(OBJECT *tree, WORD imenu)
+{
+    GRECT   t;
+
+    ob_actxywh(tree, imenu, &t);
+    t.g_x -= MENU_THICKNESS;
+    t.g_w += 2 * MENU_THICKNESS;
+    t.g_h += 2 * MENU_THICKNESS;
+    rc_intersect(&gl_rscreen, &t);
+
+    mc_sum = (ULONG)tree + imenu + 1;
+    everyobj(tree, imenu, tree[imenu].ob_next, mc_sumobj, NULL, 0, 0, MAX_DEPTH);
+
+    if (bb_cache_restore(&t, mc_sum))
+        return;
+
+    ob_draw(tree, imenu, MAX_DEPTH);
+    bb_cache_save(&t, mc_sum);
+}
+#endif
+
+
 /*
  *  Routine to pull a menu down.  This involves saving the data
  *  underneath the menu and drawing in the proper menu sub-tree.
@@ -238,7 +473,14 @@ static WORD menu_down(OBJECT *tree, WORD ititle)
         /* save area underneath the menu */
         menu_sr(TRUE, tree, imenu);
         /* draw all items in menu */
+#if CONF_WITH_AES_MENU_CACHE
+        menu_draw(tree, imenu);
+#else
         ob_draw(tree, imenu, MAX_DEPTH);
+#endif
+#if CONF_WITH_MENU_ITEM_LOOKUP
+        mnl_build(&mnl_menu, tree, imenu);
+#endif
     }
 
     return imenu;
@@ -274,6 +516,11 @@ WORD mn_do(WORD *ptitle, WORD *pitem, OBJECT **ptree)
     tree = gl_mntree;
     smtree = NULL;
 
+#if CONF_WITH_MENU_ITEM_LOOKUP
+    mnl_menu.tree = NULL;
+    mnl_submenu.tree = NULL;
+#endif
+
     ct_mouse(TRUE);
 
     while (!done)
@@ -412,14 +659,22 @@ WORD mn_do(WORD *ptitle, WORD *pitem, OBJECT **ptree)
              * when we enter a submenu, we must not change cur_item.  so we
              * must make this check before we check for a change to cur_item.
              */
+#if CONF_WITH_MENU_ITEM_LOOKUP
+            cur_submenu = smtree ? mnl_find(&mnl_submenu, smtree, smroot, rets[0], rets[1]) : NIL;
+#else
             cur_submenu = smtree ? ob_find(smtree, smroot, 1, rets[0], rets[1]) : NIL;
+#endif
             if (cur_submenu != NIL)
             {
                 menu_state = SUBMENU_STATE;
                 continue;
             }
 
+#if CONF_WITH_MENU_ITEM_LOOKUP
+            cur_item = mnl_find(&mnl_menu, tree, cur_menu, rets[0], rets[1]);
+#else
             cur_item = ob_find(tree, cur_menu, 1, rets[0], rets[1]);
+#endif
             if (cur_item != NIL)
             {
                 menu_state = INITEM_STATE;
@@ -455,6 +710,9 @@ WORD mn_do(WORD *ptitle, WORD *pitem, OBJECT **ptree)
                 undisplay_submenu(tree, smparent);
                 smtree = NULL;
                 smparent = NIL;
+#if CONF_WITH_MENU_ITEM_LOOKUP
+                mnl_submenu.tree = NULL;
+#endif
             }
             menu_select(tree, last_item, cur_item, FALSE);
         }
@@ -472,7 +730,12 @@ WORD mn_do(WORD *ptitle, WORD *pitem, OBJECT **ptree)
         {
             smtree = display_submenu(tree, cur_item, &smroot);
             if (smtree)
+            {
                 smparent = cur_item;
+#if CONF_WITH_MENU_ITEM_LOOKUP
+                mnl_build(&mnl_submenu, smtree, smroot);
+#endif
+            }
         }
         if (smtree)
             menu_select(smtree, cur_submenu, last_submenu, TRUE);
@@ -541,6 +804,10 @@ WORD mn_do(WORD *ptitle, WORD *pitem)
     cur_title = cur_menu = cur_item = NIL;
     tree = gl_mntree;
 
+#if CONF_WITH_MENU_ITEM_LOOKUP
+    mnl_menu.tree = NULL;
+#endif
+
     ct_mouse(TRUE);
 
     while (!done)
@@ -642,7 +909,11 @@ WORD mn_do(WORD *ptitle, WORD *pitem)
             }
             else
             {
+#if CONF_WITH_MENU_ITEM_LOOKUP
+                cur_item = mnl_find(&mnl_menu, tree, cur_menu, rets[0], rets[1]);
+#else
                 cur_item = ob_find(tree, cur_menu, 1, rets[0], rets[1]);
+#endif
                 if (cur_item != NIL)
                     menu_state = INITEM_STATE;
                 else
@@ -25,12 +25,14 @@
 
 #include "gemoblib.h"
 #include "gemgraf.h"
+#include "gemgsxif.h"
 #include "geminit.h"
 #include "gemobjop.h"
 #include "gemobed.h"
 
 #include "string.h"
 #include "scancode.h"
+#include "rectfunc.h"
 
 
 /*
@@ -188,6 +190,60 @@ static void pxl_rect(OBJECT *tree, WORD obj, WORD ch_pos, GRECT *pt)
 }
 
 
+/*
+ *  Routine to redraw part of the field being edited by writing the
+ *  characters directly, rather than redrawing the whole object clipped
+ *  to the changed part.  This is only possible when the result is the
+ *  same as what ob_draw() would produce: the text must be written in
+ *  replace mode, with the system font, at the position used by
+ *  pxl_rect(), and must not be modified by any state or 3D effect.
+ *
+ *  Returns TRUE if the characters have been drawn.
+ */
+static BOOL quickfld(OBJECT *tree, WORD obj, WORD pos, GRECT *pt)
+{
+    OBJECT  *objptr = tree + obj;
+    WORD    type, bcol, tcol, ipat, icol, tmode;
+    GRECT   o, t;
+
+    if (objptr->ob_head != NIL)
+        return FALSE;
+    if (objptr->ob_state & (SELECTED|CROSSED|CHECKED|DISABLED))
+        return FALSE;
+#if CONF_WITH_3D_OBJECTS
+    if (objptr->ob_flags & FL3DMASK)
+        return FALSE;
+#endif
+    if ((edblk.te_font != IBM) || (edblk.te_thickness > 0))
+        return FALSE;
+    type = objptr->ob_type & 0x00ff;
+    if ((type != G_FTEXT) && (type != G_FBOXTEXT))
+        return FALSE;
+
+    gr_crack(edblk.te_color, &bcol, &tcol, &ipat, &icol, &tmode);
+    if (tmode != MD_REPLACE)
+        return FALSE;
+
+    /* don't draw beyond the part of the field that ob_draw() shows */
+    ob_actxywh(tree, obj, &o);
+    rc_copy(pt, &t);
+    t.g_w = min(t.g_w, o.g_x + o.g_w - t.g_x);
+    if ((t.g_w < gl_wchar) || (o.g_h < gl_hchar))
+        return TRUE;
+
+#if CONF_WITH_MOUSE_EXCLUSION
+    gsx_moff_rect(&t);
+#else
+    gsx_moff();
+#endif
+    gsx_attr(TRUE, MD_REPLACE, tcol);
+    gr_gtext(TE_LEFT, IBM, D.g_fmtstr + pos, &t);
+    gsx_mon();
+
+    return TRUE;
+}
+
+
 /*
  *  Routine to redraw the cursor or the field being edited
  */
@@ -197,7 +253,11 @@ static void curfld(OBJECT *tree, WORD obj, WORD new_pos, WORD dist)
 
     pxl_rect(tree, obj, new_pos, &t);
     if (dist)
+    {
         t.g_w += (dist - 1) * gl_wchar;
+        if (quickfld(tree, obj, new_pos, &t))
+            return;
+    }
     else
     {
         gsx_attr(FALSE, MD_XOR, BLACK);
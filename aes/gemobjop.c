@@ -73,8 +73,14 @@ char ob_sst(OBJECT *tree, WORD obj, LONG *pspec, WORD *pstate, WORD *ptype,
 }
 
 
+/*
+ * Routine that calls 'routine' for each object of a (sub)tree, in
+ * drawing order.  If 'prune' is not NULL, it is called after 'routine'
+ * for each object with children: if it returns TRUE, the children of
+ * that object are skipped.
+ */
 void everyobj(OBJECT *tree, WORD this, WORD last, EVERYOBJ_CALLBACK routine,
-              WORD startx, WORD starty, WORD maxdep)
+              EVERYOBJ_PRUNE prune, WORD startx, WORD starty, WORD maxdep)
 {
     WORD    tmp1;
     WORD    depth;
@@ -103,7 +109,8 @@ child:
     tmp1 = obj->ob_head;
     if (tmp1 != NIL)
     {
-        if (!(obj->ob_flags & HIDETREE) && (depth <= maxdep))
+        if (!(obj->ob_flags & HIDETREE) && (depth <= maxdep)
+         && !(prune && (*prune)(tree, this)))
         {
             depth++;
             this = tmp1;
@@ -11,11 +11,12 @@
 #define GEMOBJOP_H
 
 typedef void (*EVERYOBJ_CALLBACK)(OBJECT *tree, WORD obj, WORD sx, WORD sy);
+typedef BOOL (*EVERYOBJ_PRUNE)(OBJECT *tree, WORD obj);
 
 char ob_sst(OBJECT *tree, WORD obj, LONG *pspec, WORD *pstate, WORD *ptype,
             WORD *pflags, GRECT *pt, WORD *pth);
 void everyobj(OBJECT *tree, WORD this, WORD last, EVERYOBJ_CALLBACK routine,
-              WORD startx, WORD starty, WORD maxdep);
+              EVERYOBJ_PRUNE prune, WORD startx, WORD starty, WORD maxdep);
 WORD get_par(OBJECT *tree, WORD obj);
 
 #endif
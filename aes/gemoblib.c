@@ -308,15 +308,16 @@ void ob_relxywh(OBJECT *tree, WORD obj, GRECT *pt)
 
 
 /*
- *  ob_actxywh: fill GRECT with x/y/w/h of object (absolute x/y)
+ *  ob_absxywh: fill GRECT with x/y/w/h of object, given its absolute x/y
  */
-void ob_actxywh(OBJECT *tree, WORD obj, GRECT *pt)
+static void ob_absxywh(OBJECT *tree, WORD obj, WORD x, WORD y, GRECT *pt)
 {
 #if CONF_WITH_3D_OBJECTS
     LONG spec;
     WORD state, type, flags, border, adjust;
 
-    ob_offset(tree, obj, &pt->g_x, &pt->g_y);
+    pt->g_x = x;
+    pt->g_y = y;
     ob_sst(tree, obj, &spec, &state, &type, &flags, pt, &border);
 
     /* if 3D object, adjust position & size */
@@ -336,13 +337,26 @@ void ob_actxywh(OBJECT *tree, WORD obj, GRECT *pt)
 #else
     OBJECT *objptr = tree + obj;
 
-    ob_offset(tree, obj, &pt->g_x, &pt->g_y);
+    pt->g_x = x;
+    pt->g_y = y;
     pt->g_w = objptr->ob_width;
     pt->g_h = objptr->ob_height;
 #endif
 }
 
 
+/*
+ *  ob_actxywh: fill GRECT with x/y/w/h of object (absolute x/y)
+ */
+void ob_actxywh(OBJECT *tree, WORD obj, GRECT *pt)
+{
+    WORD x, y;
+
+    ob_offset(tree, obj, &x, &y);
+    ob_absxywh(tree, obj, x, y, pt);
+}
+
+
 /*
  * ob_setxywh: copy values from GRECT into object
  */
@@ -444,7 +458,23 @@ static WORD ob_user(OBJECT *tree, WORD obj, GRECT *pt, LONG spec,
     gsx_gclip((GRECT *)&pb.pb_xc);      /* FIXME: ditto */
     pb.pb_parm = ub->ub_parm;
 
+#if CONF_WITH_MOUSE_EXCLUSION
+    {
+        WORD ret;
+
+        /*
+         * we can't rely on the user's routine respecting the clipping
+         * rectangle, so make sure that the mouse cursor is really hidden
+         */
+        gsx_0code(HIDE_CUR);
+        ret = call_usercode(ub, &pb);
+        gsx_1code(SHOW_CUR, 1);
+
+        return ret;
+    }
+#else
     return call_usercode(ub, &pb);
+#endif
 }
 
 
@@ -468,6 +498,23 @@ static BOOL is_dashes(char *s, WORD len)
 /*
  *  Routine to draw an object from an object tree.
  */
+#if CONF_WITH_AES_SUBTREE_CLIP
+/*
+ * set by just_draw() when the object it was called for lies entirely
+ * outside the clipping rectangle
+ */
+static BOOL obj_clipped;
+
+/*
+ * callback for everyobj(): the children of an object are expected to lie
+ * within it (as ob_find() assumes), so they are skipped if it is clipped
+ */
+static BOOL skip_clipped(OBJECT *tree, WORD obj)
+{
+    return obj_clipped;
+}
+#endif
+
 static void just_draw(OBJECT *tree, WORD obj, WORD sx, WORD sy)
 {
     WORD bcol, tcol, ipat, icol, tmode, th;
@@ -485,6 +532,10 @@ static void just_draw(OBJECT *tree, WORD obj, WORD sx, WORD sy)
     BOOL movetext, changecol;
 #endif
 
+#if CONF_WITH_AES_SUBTREE_CLIP
+    obj_clipped = FALSE;
+#endif
+
     ch = ob_sst(tree, obj, &spec, &state, &obtype, &flags, &t, &th);
 
     if ((flags & HIDETREE) || (spec == -1L))
@@ -537,7 +588,12 @@ static void just_draw(OBJECT *tree, WORD obj, WORD sx, WORD sy)
             gr_inside(&c, ((th < 0) ? (3 * th) : (-3 * th)) );
 
         if (!(gsx_chkclip(&c)))
+        {
+#if CONF_WITH_AES_SUBTREE_CLIP
+            obj_clipped = TRUE;
+#endif
             return;
+        }
     }
 
 #if CONF_WITH_3D_OBJECTS
@@ -892,7 +948,7 @@ static void just_draw(OBJECT *tree, WORD obj, WORD sx, WORD sy)
 
         if ((state & SHADOWED) && th)
         {
-            vsf_color(bcol);
+            gsx_fcolor(bcol);
             bb_fill(MD_REPLACE, FIS_SOLID, 0, t.g_x, t.g_y+t.g_h+th,
                     t.g_w + th, 2*th);
             bb_fill(MD_REPLACE, FIS_SOLID, 0, t.g_x+t.g_w+th, t.g_y,
@@ -923,7 +979,7 @@ static void just_draw(OBJECT *tree, WORD obj, WORD sx, WORD sy)
             if ((flags & FL3DMASK) == FL3DBAK)
                 bcol = backgrcol;
 #endif
-            vsf_color(bcol);
+            gsx_fcolor(bcol);
             bb_fill(MD_TRANS, FIS_PATTERN, IP_4PATT, t.g_x, t.g_y,
                     t.g_w, t.g_h);
         }
@@ -970,8 +1026,18 @@ void ob_draw(OBJECT *tree, WORD obj, WORD depth)
     else
         sx = sy = 0;
 
-    gsx_moff();
-    everyobj(tree, obj, last, just_draw, sx, sy, depth);
+#if CONF_WITH_MOUSE_EXCLUSION
+    /* all drawing is clipped, so the cursor may stay outside the clip area */
+    if (gl_clip.g_w && gl_clip.g_h)
+        gsx_moff_rect(&gl_clip);
+    else
+#endif
+        gsx_moff();
+#if CONF_WITH_AES_SUBTREE_CLIP
+    everyobj(tree, obj, last, just_draw, skip_clipped, sx, sy, depth);
+#else
+    everyobj(tree, obj, last, just_draw, NULL, sx, sy, depth);
+#endif
     gsx_mon();
 }
 
@@ -1006,6 +1072,33 @@ static WORD get_prev(OBJECT *tree, WORD parent, WORD obj)
 }
 
 
+/*
+ *  ob_hit: return TRUE iff mx,my is inside the (visible) object obj
+ *
+ *  px,py is the absolute position of the parent object, and *po is the
+ *  rectangle found for the parent: see ob_find().  the rectangle for
+ *  obj is returned in *pt.
+ */
+static BOOL ob_hit(OBJECT *tree, WORD obj, WORD px, WORD py, const GRECT *po,
+                   WORD mx, WORD my, GRECT *pt)
+{
+    OBJECT *objptr = tree + obj;
+
+#if CONF_WITH_3D_OBJECTS
+    if (!(objptr->ob_state & SHADOWED))
+        ob_absxywh(tree, obj, px + objptr->ob_x, py + objptr->ob_y, pt);
+    else
+#endif
+    {
+        ob_relxywh(tree, obj, pt);
+        pt->g_x += po->g_x;
+        pt->g_y += po->g_y;
+    }
+
+    return inside(mx, my, pt) && !(objptr->ob_flags & HIDETREE);
+}
+
+
 /*
  *  ob_find: routine to find out which object a certain mx,my value is over
  *
@@ -1032,77 +1125,57 @@ static WORD get_prev(OBJECT *tree, WORD parent, WORD obj)
  */
 WORD ob_find(OBJECT *tree, WORD currobj, WORD depth, WORD mx, WORD my)
 {
-    WORD lastfound;
-    WORD dosibs, done;
-    GRECT t, o;
-    WORD parent, childobj, flags;
+    WORD lastfound, obj, hit;
+    WORD px, py;
+    GRECT t, o, ht;
     OBJECT *objptr;
 
-    lastfound = NIL;
-
     if (currobj == ROOT)
+    {
         r_set(&o, 0, 0, 0, 0);
+        px = py = 0;
+    }
     else
     {
-        parent = get_par(tree, currobj);
-        ob_actxywh(tree, parent, &o);
+        obj = get_par(tree, currobj);
+        ob_actxywh(tree, obj, &o);
+        ob_offset(tree, obj, &px, &py);
     }
 
-    done = FALSE;
-    dosibs = FALSE;
+    if (!ob_hit(tree, currobj, px, py, &o, mx, my, &t))
+        return NIL;     /* not even inside the starting object */
+    lastfound = currobj;
 
-    while(!done)
+    /*
+     * if inside this obj, might be inside a child, so check.  since
+     * later children are drawn on top of earlier ones, we want the last
+     * child that contains mx,my: we walk the children forwards & keep
+     * the last hit, because walking backwards means finding each
+     * previous sibling from the start of the list.
+     */
+    while (depth--)
     {
-        /*
-         * if inside this obj, might be inside a child, so check
-         */
         objptr = tree + currobj;
+        if (objptr->ob_head == NIL)
+            break;
 
-#if CONF_WITH_3D_OBJECTS
-        if (objptr->ob_state & SHADOWED)
-        {
-            ob_relxywh(tree, currobj, &t);
-            t.g_x += o.g_x;
-            t.g_y += o.g_y;
-        }
-        else
-        {
-            ob_actxywh(tree, currobj, &t);
-        }
-#else
-        ob_relxywh(tree, currobj, &t);
-        t.g_x += o.g_x;
-        t.g_y += o.g_y;
-#endif
-
-        flags = objptr->ob_flags;
-        if ( (inside(mx, my, &t)) && (!(flags & HIDETREE)) )
-        {
-            lastfound = currobj;
+        px += objptr->ob_x;
+        py += objptr->ob_y;
+        o = t;
 
-            childobj = objptr->ob_tail;
-            if ((childobj != NIL) && depth)
-            {
-                currobj = childobj;
-                depth--;
-                o.g_x = t.g_x;
-                o.g_y = t.g_y;
-                dosibs = TRUE;
-            }
-            else
-                done = TRUE;
-        }
-        else
+        hit = NIL;
+        for (obj = objptr->ob_head; obj != currobj; obj = tree[obj].ob_next)
         {
-            if (dosibs && (lastfound != NIL))
+            if (ob_hit(tree, obj, px, py, &o, mx, my, &ht))
             {
-                currobj = get_prev(tree, lastfound, currobj);
-                if (currobj == NIL)
-                    done = TRUE;
+                hit = obj;
+                t = ht;
             }
-            else
-                done = TRUE;
         }
+        if (hit == NIL)
+            break;
+
+        lastfound = currobj = hit;
     }
 
     /*
@@ -25,9 +25,55 @@
 #include "rectfunc.h"
 #include "gemasync.h"
 #include "gemqueue.h"
+#include "../bdos/bdosstub.h"
 
 
 
+/*
+ * returns TRUE iff two redraw rectangles are worth merging into their
+ * union, i.e. the union is no more than 50% bigger than their total area:
+ * otherwise the application would be asked to redraw too much
+ */
+static BOOL worth_merging(const GRECT *p1, const GRECT *p2)
+{
+    GRECT u;
+    ULONG area;
+
+    rc_copy(p2, &u);
+    rc_union(p1, &u);
+    area = (ULONG)p1->g_w * p1->g_h + (ULONG)p2->g_w * p2->g_h;
+
+    return ((ULONG)u.g_w * u.g_h) <= area + area / 2;
+}
+
+
+#if CONF_WITH_AES_BUFFER_MSG
+/*
+ * if a message being delivered to process p is AP_BUFFER, make the
+ * receiver the owner of the block, so that it is not freed when the
+ * sender terminates.  this is only done on delivery, so the sender keeps
+ * the block while the message waits for room in the pipe.
+ *
+ * the main application owns the block via the current process.  an
+ * accessory never terminates, so it owns the block via the process that
+ * loaded it: that one terminates, and so frees the block, when the
+ * accessories are reloaded.
+ */
+static void aq_give_buffer(AESPD *p, WORD length, const WORD *msg)
+{
+    PD *owner;
+
+    if ((length < 16) || (msg[0] != AP_BUFFER))
+        return;
+    if (p->p_pid == 1)              /* the screen manager has no memory */
+        return;
+
+    owner = (p->p_pid == 0) ? run : ((PD *)p->p_ldaddr)->p_parent;
+    set_owner((void *)MAKE_ULONG(msg[3], msg[4]), owner);
+}
+#endif
+
+
 static void doq(WORD donq, AESPD *p, QPB *m)
 {
     WORD n, index;
@@ -36,6 +82,9 @@ static void doq(WORD donq, AESPD *p, QPB *m)
     n = m->qpb_cnt;
     if (donq)
     {
+#if CONF_WITH_AES_BUFFER_MSG
+        aq_give_buffer(p, n, (WORD *)m->qpb_buf);
+#endif
         memcpy(p->p_qaddr+p->p_qindex, (char *)m->qpb_buf, n);
         /*
          * if it's a redraw msg, try to find a matching msg and
@@ -48,8 +97,12 @@ static void doq(WORD donq, AESPD *p, QPB *m)
             while ((index < p->p_qindex) && n)
             {
                 om = (WORD *) &p->p_queue[index];
-                /* if redraw and same handle then union */
-                if ((om[0] == WM_REDRAW) && (nm[3] == om[3]))
+                /*
+                 * if both redraw and same handle then union, unless
+                 * that would make the rectangle much bigger
+                 */
+                if ((om[0] == WM_REDRAW) && (nm[0] == WM_REDRAW) && (nm[3] == om[3])
+                 && worth_merging((GRECT *)&nm[4], (GRECT *)&om[4]))
                 {
                     rc_union((GRECT *)&nm[4], (GRECT *)&om[4]);  /* FIXME: Ugly pointer typecasting */
                     n = 0;
@@ -82,6 +135,51 @@ static void doq(WORD donq, AESPD *p, QPB *m)
 }
 
 
+/*
+ * write a message to the pipe of process p without going via an EVB
+ *
+ * if a reader is already waiting for a message of this length on an
+ * empty pipe, the message is copied straight into its buffer.  this
+ * must be called with dispatching off.
+ *
+ * returns FALSE if the message cannot be written without blocking
+ */
+BOOL aqwrite(AESPD *p, WORD length, WORD *pbuff)
+{
+    QPB     m, *mr;
+    EVB     *e;
+
+    if ((e = p->p_qdq) != NULL)     /* assignment ok */
+    {
+        mr = (QPB *)e->e_parm;
+        if (p->p_qindex || (mr->qpb_cnt != length))
+            return FALSE;
+
+        e->e_flag |= NOCANCEL;
+        p->p_qdq = e->e_link;
+        if (e->e_link)
+            e->e_link->e_pred = e->e_pred;
+
+#if CONF_WITH_AES_BUFFER_MSG
+        aq_give_buffer(p, length, pbuff);
+#endif
+        memcpy((char *)mr->qpb_buf, pbuff, length);
+        azombie(e, 1);
+        return TRUE;
+    }
+
+    if (length > (QUEUE_SIZE-p->p_qindex))
+        return FALSE;
+
+    m.qpb_ppd = p;
+    m.qpb_cnt = length;
+    m.qpb_buf = (LONG)pbuff;
+    doq(TRUE, p, &m);
+
+    return TRUE;
+}
+
+
 void aqueue(WORD isqwrite, EVB *e, LONG lm)
 {
     AESPD   *p;
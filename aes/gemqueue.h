@@ -10,6 +10,7 @@
 #ifndef GEMQUEUE_H
 #define GEMQUEUE_H
 
+BOOL aqwrite(AESPD *p, WORD length, WORD *pbuff);
 void aqueue(WORD isqwrite, EVB *e, LONG lm);
 
 #endif
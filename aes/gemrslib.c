@@ -360,16 +360,25 @@ static void transform_cicon(WORD *src, WORD *dest, WORD w, WORD h, WORD planes)
  * for each CICONBLK in the resource, select the CICON with the number of
  * planes that best matches the current resolution.  then expand the icon
  * if necessary, and transform it from standard to device-dependent format
+ *
+ * the device-dependent data for all the icons is put in a single buffer,
+ * and a single temporary buffer is used for expansion, rather than doing
+ * two or three memory allocations per icon.  the data buffer starts with
+ * the data of the first icon that has a CICON: see free_cicon_buffers().
  */
 static void transform_all_cicons(LONG num_cicons, CICONBLK **ciconblkptr)
 {
     CICONBLK *ciconblk;
     CICON *cicon;
     WORD *colbuf, *selbuf, *expandbuf, *src;
-    LONG data_size, n;
+    LONG data_size, total, maxexpand;
     BOOL expand;
     WORD i, w, h;
 
+    /*
+     * first pass: select the CICONs & determine the buffer sizes
+     */
+    total = maxexpand = 0L;
     for (i = 0; i < num_cicons; i++)
     {
         ciconblk = ciconblkptr[i];
@@ -380,30 +389,45 @@ static void transform_all_cicons(LONG num_cicons, CICONBLK **ciconblkptr)
         w = ciconblk->monoblk.ib_wicon;
         h = ciconblk->monoblk.ib_hicon;
         data_size = muls(w/8*gl_nplanes,h);
-        expand = (cicon->num_planes != gl_nplanes); /* boolean */
+        total += cicon->sel_data ? 2*data_size : data_size;
+        if ((cicon->num_planes != gl_nplanes) && (data_size > maxexpand))
+            maxexpand = data_size;
+    }
 
-        /* if we need to expand the icon, we need a temp buffer */
-        expandbuf = NULL;
-        if (expand)
+    if (!total)
+        return;
+
+    /* we always allocate a data buffer so we avoid transform-in-place */
+    colbuf = dos_alloc_anyram(total);
+    expandbuf = NULL;
+    if (colbuf && maxexpand)
+    {
+        expandbuf = dos_alloc_anyram(maxexpand);
+        if (!expandbuf)
         {
-            expandbuf = dos_alloc_anyram(data_size);
-            if (!expandbuf)
-            {
-                ciconblk->mainlist = NULL;  /* no colour for this icon */
-                continue;
-            }
+            dos_free(colbuf);
+            colbuf = NULL;
         }
+    }
 
-        /* we always allocate a data buffer so we avoid transform-in-place */
-        n = cicon->sel_data ? 2*data_size : data_size;
-        colbuf = dos_alloc_anyram(n);
+    /*
+     * second pass: expand & transform the icons
+     */
+    for (i = 0; i < num_cicons; i++)
+    {
+        ciconblk = ciconblkptr[i];
+        cicon = ciconblk->mainlist;
+        if (!cicon)
+            continue;
         if (!colbuf)
         {
-            if (expandbuf)
-                dos_free(expandbuf);
             ciconblk->mainlist = NULL;      /* no colour for this icon */
             continue;
         }
+        w = ciconblk->monoblk.ib_wicon;
+        h = ciconblk->monoblk.ib_hicon;
+        data_size = muls(w/8*gl_nplanes,h);
+        expand = (cicon->num_planes != gl_nplanes); /* boolean */
 
         /* handle standard icon */
         src = cicon->col_data;
@@ -414,11 +438,12 @@ static void transform_all_cicons(LONG num_cicons, CICONBLK **ciconblkptr)
         }
         transform_cicon(src, colbuf, w, h, gl_nplanes);
         cicon->col_data = colbuf;
+        colbuf += data_size/sizeof(WORD);
 
         /* handle 'selected' icon (if present) */
         if (cicon->sel_data)
         {
-            selbuf = colbuf + data_size/sizeof(WORD);
+            selbuf = colbuf;
             src = cicon->sel_data;
             if (expand)
             {
@@ -427,14 +452,15 @@ static void transform_all_cicons(LONG num_cicons, CICONBLK **ciconblkptr)
             }
             transform_cicon(src, selbuf, w, h, gl_nplanes);
             cicon->sel_data = selbuf;
+            colbuf += data_size/sizeof(WORD);
         }
 
         cicon->num_planes = gl_nplanes;     /* neatness only */
         cicon->next_res = NULL;
-
-        if (expandbuf)
-            dos_free(expandbuf);
     }
+
+    if (expandbuf)
+        dos_free(expandbuf);
 }
 
 /*
@@ -469,7 +495,7 @@ static CICONBLK **get_ciconblkptr(RSHDR *hdr)
 }
 
 /*
- * free the CICON-related buffers allocated by transform_all_cicons()
+ * free the CICON-related buffer allocated by transform_all_cicons()
  *
  * returns -1 iff dos_free() failed
  */
@@ -484,13 +510,19 @@ static WORD free_cicon_buffers(RSHDR *hdr)
     if (!ciconblkptr)   /* yes, we have no CICONBLKs */
         return 0;
 
-    /* free any buffers allocated by transform_all_cicons() */
+    /*
+     * free the buffer allocated by transform_all_cicons(): it starts
+     * with the data of the first icon that has a CICON
+     */
     for (p = ciconblkptr; *p != (CICONBLK *)-1L; p++)
     {
         cicon = (*p)->mainlist;
         if (cicon)
+        {
             if (dos_free(cicon->col_data))
                 rc = -1;
+            break;
+        }
     }
 
     return rc;
@@ -613,6 +645,25 @@ static BOOL fix_ptr(WORD type, WORD index)
 }
 
 
+/*
+ * fix up the three pointers in each ICONBLK in a single pass over the
+ * ICONBLK array, rather than one get_addr() lookup per pointer
+ */
+static void fix_iconblks(void)
+{
+    ICONBLK *iconblk;
+    WORD i;
+
+    iconblk = (ICONBLK *)get_addr(R_ICONBLK, 0);
+    for (i = 0; i < rs_hdr->rsh_nib; i++, iconblk++)
+    {
+        fix_long((LONG *)&iconblk->ib_pmask);
+        fix_long((LONG *)&iconblk->ib_pdata);
+        fix_long((LONG *)&iconblk->ib_ptext);
+    }
+}
+
+
 static void fix_tedinfo_std(void)
 {
     WORD ii;
@@ -711,7 +762,6 @@ WORD rs_saddr(AESGLOBAL *pglobal, UWORD rtype, UWORD rindex, void *rsaddr)
  */
 static WORD rs_readit(AESGLOBAL *pglobal,UWORD fd)
 {
-    WORD ibcnt;
     LONG rslsize;
     RSHDR hdr_buff;
 
@@ -757,10 +807,7 @@ static WORD rs_readit(AESGLOBAL *pglobal,UWORD fd)
     fix_cicons();
 #endif
     fix_tedinfo_std();
-    ibcnt = rs_hdr->rsh_nib;
-    fix_nptrs(ibcnt, R_IBPMASK);
-    fix_nptrs(ibcnt, R_IBPDATA);
-    fix_nptrs(ibcnt, R_IBPTEXT);
+    fix_iconblks();
     fix_nptrs(rs_hdr->rsh_nbb, R_BIPDATA);
     fix_nptrs(rs_hdr->rsh_nstring, R_FRSTR);
     fix_nptrs(rs_hdr->rsh_nimages, R_FRIMG);
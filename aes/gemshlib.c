@@ -88,7 +88,7 @@ static char sh_apdir[LEN_ZPATH];        /* saves initial value of current direct
                                         /* for applications run from the desktop.   */
 GLOBAL char *ad_stail;
 
-static BOOL gl_shgem;                   /* TRUE iff currently in graphics mode */
+BOOL gl_shgem;                          /* TRUE iff currently in graphics mode */
 
 /*
  *  Resolution settings:
@@ -98,6 +98,26 @@ static BOOL gl_shgem;                   /* TRUE iff currently in graphics mode *
 GLOBAL WORD gl_changerez;
 GLOBAL WORD gl_nextrez;
 
+#if CONF_WITH_PATH_CACHE
+#define NUM_PATHCACHE   8           /* must be a power of 2 */
+
+/*
+ * the results of recent successful searches of the AES path, indexed by
+ * a hash of the filename searched for.  an entry is valid while its
+ * 'chgcnt' matches the BDOS directory change counter; all entries are
+ * discarded if the PATH= string changes.
+ */
+typedef struct
+{
+    ULONG chgcnt;                   /* value of 'dirchgcnt' when found */
+    char name[LEN_ZFNAME];          /* filename searched for */
+    char fullname[MAXPATHLEN];      /* fully-qualified name found */
+} PATHENT;
+
+static PATHENT path_cache[NUM_PATHCACHE];
+static UWORD path_hash;             /* hash of PATH= for the above */
+#endif
+
 
 void sh_read(char *pcmd, char *ptail)
 {
@@ -386,6 +406,84 @@ static char *sh_path(char *src, char *dest, char *pname)
 }
 
 
+#if CONF_WITH_PATH_CACHE
+/*
+ *  Return a simple hash of a string
+ */
+static UWORD str_hash(const char *s)
+{
+    UWORD hash = 0;
+
+    while(*s)
+        hash = ((hash << 3) | (hash >> 13)) + (UBYTE)*s++;
+
+    return hash;
+}
+
+
+/*
+ *  Look up a filename in the path cache
+ *
+ *  Returns a pointer to the cache entry to use for the filename, or NULL
+ *  if it cannot be cached.  If a valid entry was found, *found is set
+ *  TRUE, and the fully-qualified name is copied to pspec.
+ */
+static PATHENT *path_lookup(char *pspec, const char *pname, const char *path, BOOL *found)
+{
+    PATHENT *pe;
+    UWORD hash;
+    WORD i;
+
+    *found = FALSE;
+
+    hash = str_hash(path);
+    if (hash != path_hash)          /* PATH= has changed */
+    {
+        for (i = 0, pe = path_cache; i < NUM_PATHCACHE; i++, pe++)
+            pe->name[0] = '\0';
+        path_hash = hash;
+    }
+
+    if (strlen(pname) >= LEN_ZFNAME)
+        return NULL;                /* not a plain filename */
+
+    pe = &path_cache[str_hash(pname) & (NUM_PATHCACHE-1)];
+
+    if (pe->name[0] && (pe->chgcnt == dirchgcnt) && (strcmp(pe->name, pname) == 0))
+    {
+        strcpy(pspec, pe->fullname);
+        *found = TRUE;
+    }
+
+    return pe;
+}
+
+
+/*
+ *  Remember the result of a successful search of the AES path
+ */
+static void path_remember(PATHENT *pe, const char *pname, const char *fullname, ULONG chgcnt)
+{
+    WORD drive;
+
+    pe->name[0] = '\0';
+    if (strlen(fullname) >= MAXPATHLEN)
+        return;
+
+    /* media changes are not seen by the BDOS until it accesses the drive */
+    drive = extract_drive_number(fullname);
+    if (drive < 0)
+        drive = dos_gdrv();
+    if (drvrem & (1L << drive))
+        return;
+
+    pe->chgcnt = chgcnt;
+    strcpy(pe->name, pname);
+    strcpy(pe->fullname, fullname);
+}
+#endif
+
+
 /*
  *  Routine to verify that a file is present.  Note that this routine
  *  tolerates the presence of wildcards in the filespec.
@@ -407,6 +505,11 @@ static WORD findfile(char *pspec)
 {
     char *path;
     char *pname;
+#if CONF_WITH_PATH_CACHE
+    PATHENT *pe;
+    ULONG chgcnt;
+    BOOL found;
+#endif
 
     KDEBUG(("sh_find(): input pspec='%s'\n",pspec));
     pname = sh_name(pspec);                 /* get ptr to name      */
@@ -454,6 +557,16 @@ static WORD findfile(char *pspec)
     if (!*path)                     /* skip nul after PATH= */
         path++;
 
+#if CONF_WITH_PATH_CACHE
+    pe = path_lookup(pspec, pname, path, &found);
+    if (found)
+    {
+        KDEBUG(("sh_find(4): returning cached pspec='%s'\n",pspec));
+        return 1;
+    }
+    chgcnt = dirchgcnt;
+#endif
+
     while(1)
     {
         path = sh_path(path, D.g_work, pname);
@@ -461,6 +574,10 @@ static WORD findfile(char *pspec)
             break;
         if (dos_sfirst(D.g_work, FA_RO | FA_HIDDEN | FA_SYSTEM) == 0)   /* found */
         {
+#if CONF_WITH_PATH_CACHE
+            if (pe)
+                path_remember(pe, pname, D.g_work, chgcnt);
+#endif
             strcpy(pspec, D.g_work);
             KDEBUG(("sh_find(4): returning pspec='%s'\n",pspec));
             return 1;
@@ -13,6 +13,7 @@
 extern char     *ad_stail;
 
 extern WORD     gl_changerez;
+extern BOOL     gl_shgem;
 extern WORD     gl_nextrez;
 
 void sh_read(char *pcmd, char *ptail);
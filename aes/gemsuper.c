@@ -40,6 +40,7 @@
 #include "gemfslib.h"
 #include "gemgrlib.h"
 #include "gemgsxif.h"
+#include "gemgraf.h"
 #include "gemsclib.h"
 #include "gemwmlib.h"
 #include "gemrslib.h"
@@ -150,7 +151,7 @@ static UWORD crysbind(WORD opcode, AESGLOBAL *pglobal, WORD control[], WORD int_
             count = MAKE_ULONG(MT_HICOUNT, MT_LOCOUNT);
         buparm = combine_cms(MB_CLICKS,MB_MASK,MB_STATE);
 #if CONF_WITH_MENU_EXTENSION
-        ret = ev_multi((MU_FLAGS & MU_TOSVALID),
+        ret = ev_multi((MU_FLAGS & (MU_TOSVALID|MU_PERSIST)),
                         (MOBLK *)&MMO1_FLAGS, (MOBLK *)&MMO2_FLAGS, NULL,
                         count, buparm, (WORD *)MME_PBUFF, &EV_MX);
 #else
@@ -420,6 +421,44 @@ static UWORD crysbind(WORD opcode, AESGLOBAL *pglobal, WORD control[], WORD int_
 }
 
 
+/*
+ *  Fast paths for frequently-called functions that only return values
+ *  and take their few input parameters directly from the caller's
+ *  intin array, so that the parameter block does not need to be copied
+ *  into local buffers.
+ *
+ *  Returns TRUE if the call has been handled.
+ */
+static BOOL xif_fast(AESPB *pcrys_blk)
+{
+    WORD    *pctrl = pcrys_blk->control;
+    WORD    *pin = pcrys_blk->intin;
+    WORD    int_out[O_SIZE];
+    WORD    n;
+
+    switch(pctrl[0])
+    {
+    case GRAF_MKSTATE:
+        int_out[0] = TRUE;
+        gr_mkstate(&int_out[1], &int_out[2], &int_out[3], &int_out[4]);
+        break;
+    case WIND_GET:
+        if (pctrl[1] < 2)
+            return FALSE;
+        int_out[0] = wm_get(pin[0], pin[1], &int_out[1], &pin[2]);
+        break;
+    default:
+        return FALSE;
+    }
+
+    n = min(pctrl[2], O_SIZE);
+    if (n > 0)
+        memcpy(pcrys_blk->intout, int_out, n*sizeof(WORD));
+
+    return TRUE;
+}
+
+
 /*
  *  Routine that copies input parameters into local buffers, calls the
  *  appropriate routine via a case statement, copies return parameters
@@ -432,6 +471,11 @@ static void xif(AESPB *pcrys_blk)
     WORD    int_out[O_SIZE];
     LONG    addr_in[AI_SIZE];
 
+    if (xif_fast(pcrys_blk))
+        return;
+
+    gsx_resetattr();        /* the caller may have used our workstation */
+
     memcpy(control, pcrys_blk->control, C_SIZE*sizeof(WORD));
     if (IN_LEN)
         memcpy(int_in, pcrys_blk->intin, min(IN_LEN,I_SIZE)*sizeof(WORD));
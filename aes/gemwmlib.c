@@ -168,6 +168,16 @@ static WORD adj_wbox;
 static WORD adj_hbox;
 #endif
 
+#if CONF_WITH_WINDOW_GADGET_UPDATE
+/* the window state that W_ACTIVE was last built for */
+static struct {
+    WORD  wh;               /* window handle, NIL if none */
+    BOOL  istop;
+    UWORD kind;
+    GRECT curr;             /* WS_CURR size */
+} gl_abuilt;
+#endif
+
 
 static void w_nilit(WORD num, OBJECT olist[])
 {
@@ -396,14 +406,47 @@ static void w_setcolor(WINDOW *pw, WORD gadget, BOOL istop)
 }
 
 
+#if CONF_WITH_WINDOW_GADGET_UPDATE
+static void w_setbuilt(WORD w_handle, BOOL istop)
+{
+    gl_abuilt.wh = w_handle;
+    gl_abuilt.istop = istop;
+    gl_abuilt.kind = D.w_win[w_handle].w_kind;
+    w_getsize(WS_CURR, w_handle, &gl_abuilt.curr);
+}
+#endif
+
+
 #if CONF_WITH_3D_OBJECTS
 /*
  * main routines to build a window with 3D objects
  */
-static void w_bldvbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w, WORD h)
+static void w_bldvelev(WINDOW *pw, WORD h)
 {
     WORD size, posn;
 
+    if (pw->w_vslsiz == -1)
+        size = gl_hbox;
+    else size = max(gl_hbox, mul_div(h, pw->w_vslsiz, 1000));
+    posn = mul_div(h-size, pw->w_vslide, 1000);
+    w_adjust(W_VSLIDE, W_VELEV, ADJ3DSTD, posn+ADJ3DSTD, gl_wbox, size-2*ADJ3DSTD-1);
+}
+
+
+static void w_bldhelev(WINDOW *pw, WORD w)
+{
+    WORD size, posn;
+
+    if (pw->w_hslsiz == -1)
+        size = gl_wbox;
+    else size = max(gl_wbox, mul_div(w, pw->w_hslsiz, 1000));
+    posn = mul_div(w-size, pw->w_hslide, 1000);
+    w_adjust(W_HSLIDE, W_HELEV, posn+ADJ3DSTD, ADJ3DSTD, size-2*ADJ3DSTD-1, gl_hbox);
+}
+
+
+static void w_bldvbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w, WORD h)
+{
     w_setcolor(pw, W_VBAR, istop);
     w_adjust(W_DATA, W_VBAR, x, y, adj_wbox, h);
 
@@ -428,20 +471,14 @@ static void w_bldvbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w
     {
         w_setcolor(pw, W_VSLIDE, istop);
         w_adjust(W_VBAR, W_VSLIDE, 0, y, adj_wbox, h);
-        if (pw->w_vslsiz == -1)
-            size = gl_hbox;
-        else size = max(gl_hbox, mul_div(h, pw->w_vslsiz, 1000));
-        posn = mul_div(h-size, pw->w_vslide, 1000);
         w_setcolor(pw, W_VELEV, istop);
-        w_adjust(W_VSLIDE, W_VELEV, ADJ3DSTD, posn+ADJ3DSTD, gl_wbox, size-2*ADJ3DSTD-1);
+        w_bldvelev(pw, h);
     }
 }
 
 
 static void w_bldhbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w, WORD h)
 {
-    WORD size, posn;
-
     w_setcolor(pw, W_HBAR, istop);
     w_adjust(W_DATA, W_HBAR, x, y, w, adj_hbox);
 
@@ -466,12 +503,8 @@ static void w_bldhbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w
     {
         w_setcolor(pw, W_HSLIDE, istop);
         w_adjust(W_HBAR, W_HSLIDE, x, 0, w, adj_hbox);
-        if (pw->w_hslsiz == -1)
-            size = gl_wbox;
-        else size = max(gl_wbox, mul_div(w, pw->w_hslsiz, 1000));
-        posn = mul_div(w-size, pw->w_hslide, 1000);
         w_setcolor(pw, W_HELEV, istop);
-        w_adjust(W_HSLIDE, W_HELEV, posn+ADJ3DSTD, ADJ3DSTD, size-2*ADJ3DSTD-1, gl_hbox);
+        w_bldhelev(pw, w);
     }
 }
 
@@ -496,6 +529,9 @@ void w_bldactive(WORD w_handle)
     istop = (gl_wtop == w_handle);  /* set if it is on top */
     kind = pw->w_kind;              /* get the kind of window */
     w_nilit(NUM_ELEM, W_ACTIVE);
+#if CONF_WITH_WINDOW_GADGET_UPDATE
+    w_setbuilt(w_handle, istop);
+#endif
 
     /* start adding pieces & adjusting sizes */
     gl_aname.te_ptext = (kind & NAME) ? pw->w_pname : (char *)empty_name;
@@ -631,10 +667,32 @@ void w_bldactive(WORD w_handle)
 /*
  * main routines to build a window with old-style (non-3D) objects
  */
-static void w_bldvbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w, WORD h)
+static void w_bldvelev(WINDOW *pw, WORD h)
+{
+    WORD size, posn;
+
+    if (pw->w_vslsiz == -1)
+        size = gl_hbox;
+    else size = max(gl_hbox, mul_div_round(h, pw->w_vslsiz, 1000));
+    posn = mul_div_round(h-size, pw->w_vslide, 1000);
+    w_adjust(W_VSLIDE, W_VELEV, 0, posn, gl_wbox, size);
+}
+
+
+static void w_bldhelev(WINDOW *pw, WORD w)
 {
     WORD size, posn;
 
+    if (pw->w_hslsiz == -1)
+        size = gl_wbox;
+    else size = max(gl_wbox, mul_div_round(w, pw->w_hslsiz, 1000));
+    posn = mul_div_round(w-size, pw->w_hslide, 1000);
+    w_adjust(W_HSLIDE, W_HELEV, posn, 0, size, gl_hbox);
+}
+
+
+static void w_bldvbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w, WORD h)
+{
     /* set window widget colours according to topped/untopped status */
     w_setcolor(pw, W_VBAR, istop);
     w_setcolor(pw, W_UPARROW, istop);
@@ -661,12 +719,7 @@ static void w_bldvbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w
         if (kind & VSLIDE)
         {
             w_adjust(W_VBAR, W_VSLIDE, x, y, gl_wbox, h);
-
-            if (pw->w_vslsiz == -1)
-                size = gl_hbox;
-            else size = max(gl_hbox, mul_div_round(h, pw->w_vslsiz, 1000));
-            posn = mul_div_round(h-size, pw->w_vslide, 1000);
-            w_adjust(W_VSLIDE, W_VELEV, 0, posn, gl_wbox, size);
+            w_bldvelev(pw, h);
         }
     }
 }
@@ -674,8 +727,6 @@ static void w_bldvbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w
 
 static void w_bldhbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w, WORD h)
 {
-    WORD size, posn;
-
     /* set window widget colours according to topped/untopped status */
     w_setcolor(pw, W_HBAR, istop);
     w_setcolor(pw, W_LFARROW, istop);
@@ -702,12 +753,7 @@ static void w_bldhbar(UWORD kind, BOOL istop, WINDOW *pw, WORD x, WORD y, WORD w
         if (kind & HSLIDE)
         {
             w_adjust(W_HBAR, W_HSLIDE, x, y, w, gl_hbox);
-
-            if (pw->w_hslsiz == -1)
-                size = gl_wbox;
-            else size = max(gl_wbox, mul_div_round(w, pw->w_hslsiz, 1000));
-            posn = mul_div_round(w-size, pw->w_hslide, 1000);
-            w_adjust(W_HSLIDE, W_HELEV, posn, 0, size, gl_hbox);
+            w_bldhelev(pw, w);
         }
     }
 }
@@ -732,6 +778,9 @@ void w_bldactive(WORD w_handle)
     istop = (gl_wtop == w_handle);  /* set if it is on top */
     kind = pw->w_kind;              /* get the kind of window */
     w_nilit(NUM_ELEM, W_ACTIVE);
+#if CONF_WITH_WINDOW_GADGET_UPDATE
+    w_setbuilt(w_handle, istop);
+#endif
 
     /* start adding pieces & adjusting sizes */
     gl_aname.te_ptext = pw->w_pname;
@@ -848,6 +897,52 @@ void w_bldactive(WORD w_handle)
 #endif
 
 
+#if CONF_WITH_WINDOW_GADGET_UPDATE
+/*
+ *  Update & redraw one gadget after a change to a window slider, name or
+ *  info line, if W_ACTIVE is still built for the window in its current
+ *  state.  Only the gadget's own rectangle is redrawn.
+ *
+ *  Returns FALSE if the window object tree must be rebuilt instead.
+ */
+static BOOL w_updgadget(WORD w_handle, WORD gadget)
+{
+    WINDOW  *pw;
+    GRECT   t;
+
+    pw = &D.w_win[w_handle];
+    if ((gl_abuilt.wh != w_handle) || (gl_abuilt.istop != (gl_wtop == w_handle))
+     || (gl_abuilt.kind != pw->w_kind))
+        return FALSE;
+
+    w_getsize(WS_CURR, w_handle, &t);
+    if (!rc_equal(&t, &gl_abuilt.curr))
+        return FALSE;
+
+    /* the gadget is not part of the window (as built): nothing to draw */
+    if (W_ACTIVE[gadget].ob_next == NIL)
+        return TRUE;
+
+    switch(gadget)
+    {
+    case W_VSLIDE:
+        W_ACTIVE[W_VSLIDE].ob_head = W_ACTIVE[W_VSLIDE].ob_tail = NIL;
+        w_bldvelev(pw, W_ACTIVE[W_VSLIDE].ob_height);
+        break;
+    case W_HSLIDE:
+        W_ACTIVE[W_HSLIDE].ob_head = W_ACTIVE[W_HSLIDE].ob_tail = NIL;
+        w_bldhelev(pw, W_ACTIVE[W_HSLIDE].ob_width);
+        break;
+    }
+
+    ob_actxywh(gl_awind, gadget, &t);
+    do_walk(w_handle, gl_awind, gadget, MAX_DEPTH, &t);
+
+    return TRUE;
+}
+#endif
+
+
 void ap_sendmsg(WORD ap_msg[], WORD type, AESPD *towhom,
                 WORD w3, WORD w4, WORD w5, WORD w6, WORD w7)
 {
@@ -929,11 +1024,89 @@ static BOOL w_mvfix(GRECT *ps, GRECT *pd)
 }
 
 
+#if CONF_WITH_AES_PARTIAL_MOVE
+/*
+ *  Redraw the part of the top window w_handle that is within *pt
+ */
+static void w_mvstrip(WORD w_handle, GRECT *pt)
+{
+    if (!(pt->g_w > 0 && pt->g_h > 0))
+        return;
+
+    gsx_sclip(pt);
+    w_cpwalk(w_handle, 0, MAX_DEPTH, FALSE);
+    w_redraw(w_handle, pt);
+}
+
+
+/*
+ *  Move the top window w_handle from source *ps to destination *pd when
+ *  part of the source is off the screen: the on-screen part of the
+ *  source is BLTed to wherever it stays on-screen, and only the strips
+ *  of the destination that were not BLTed are redrawn.
+ *
+ *  returns FALSE if nothing could be BLTed; otherwise, *ps is set to
+ *  the on-screen part of the source, for cleaning up by w_update
+ */
+static BOOL w_mvpart(WORD w_handle, GRECT *ps, GRECT *pd)
+{
+    GRECT   s, d, t;
+    WORD    dx, dy;
+
+    dx = pd->g_x - ps->g_x;
+    dy = pd->g_y - ps->g_y;
+
+    /* find the visible part of the source that remains visible */
+    rc_copy(ps, &s);
+    if (!rc_intersect(&gl_rfull, &s))
+        return FALSE;
+    d.g_x = s.g_x + dx;
+    d.g_y = s.g_y + dy;
+    d.g_w = s.g_w;
+    d.g_h = s.g_h;
+    if (!rc_intersect(&gl_rfull, &d))
+        return FALSE;
+    s.g_x = d.g_x - dx;
+    s.g_y = d.g_y - dy;
+    s.g_w = d.g_w;
+    s.g_h = d.g_h;
+
+    gsx_sclip(&gl_rfull);
+    bb_screen(s.g_x, s.g_y, d.g_x, d.g_y, s.g_w, s.g_h);
+
+    /* now redraw the strips of the destination around the BLTed part */
+    rc_copy(pd, &t);
+    rc_intersect(&gl_rfull, &t);
+    rc_copy(&t, pd);
+
+    t.g_h = d.g_y - pd->g_y;                        /* top */
+    w_mvstrip(w_handle, &t);
+    t.g_y = d.g_y + d.g_h;                          /* bottom */
+    t.g_h = pd->g_y + pd->g_h - t.g_y;
+    w_mvstrip(w_handle, &t);
+    t.g_y = d.g_y;                                  /* left */
+    t.g_h = d.g_h;
+    t.g_w = d.g_x - pd->g_x;
+    w_mvstrip(w_handle, &t);
+    t.g_x = d.g_x + d.g_w;                          /* right */
+    t.g_w = pd->g_x + pd->g_w - t.g_x;
+    w_mvstrip(w_handle, &t);
+
+    rc_intersect(&gl_rfull, ps);
+
+    return TRUE;
+}
+#endif
+
+
 /*
  *  Call to move top window.  This involves BLTing the window if none
  *  of it that is partially off the screen needs to be redrawn, else
  *  the whole desktop is just updated.  All uncovered portions of the
  *  desktop are redrawn by later calling w_update.
+ *
+ *  If CONF_WITH_AES_PARTIAL_MOVE is set, a window that is partially off
+ *  the screen is BLTed too, and only the newly-exposed parts redrawn.
  */
 static BOOL w_move(WORD w_handle, WORD *pstop, GRECT *prc)
 {
@@ -951,6 +1124,14 @@ static BOOL w_move(WORD w_handle, WORD *pstop, GRECT *prc)
     if ( ((s.g_x+s.g_w > gl_width) && (d.g_x < s.g_x))  ||
          ((s.g_y+s.g_h > gl_height) && (d.g_y < s.g_y)) )
     {
+#if CONF_WITH_AES_PARTIAL_MOVE
+        if (w_mvpart(w_handle, &s, &d))
+        {
+            *pstop = w_handle;
+            rc_copy(&s, prc);
+            return TRUE;
+        }
+#endif
         rc_union(&s, &d);
         *pstop = DESKWH;
     }
@@ -1057,7 +1238,7 @@ void w_update(WORD bottom, GRECT *pt, WORD top, BOOL moved)
  */
 static void draw_change(WORD w_handle, GRECT *pt)
 {
-    GRECT   c, pprev;
+    GRECT   c, pprev, told;
     GRECT   *pw;
     WORD    start, stop;
     BOOL    moved;
@@ -1066,6 +1247,7 @@ static void draw_change(WORD w_handle, GRECT *pt)
     wasclr = !(D.w_win[w_handle].w_flags & VF_BROKEN);
 
     /* save old size */
+    w_getsize(WS_TRUE, w_handle, &told);
     w_getsize(WS_CURR, w_handle, &c);
     w_setsize(WS_PREV, w_handle, &c);
 
@@ -1086,7 +1268,7 @@ static void draw_change(WORD w_handle, GRECT *pt)
         return;
 
     /* update rectangle lists */
-    everyobj(gl_wtree, ROOT, NIL, (EVERYOBJ_CALLBACK)newrect, 0, 0, MAX_DEPTH);
+    or_update(gl_wtree, w_handle, &told);
 
     /* remember oldtop & set new one */
     oldtop = gl_wtop;
@@ -1241,6 +1423,33 @@ static void w_owns(WINDOW *pwin, ORECT *po, GRECT *pt, GRECT *poutwds)
 }
 
 
+#if CONF_WITH_WF_RLIST
+/*
+ *  Copy up to 'max' rectangles of the rectangle list starting at 'po'
+ *  that intersect the rectangle 'pt' to the buffer 'buf', clipped to
+ *  'pt'.  Returns the total number of such rectangles, which may be
+ *  greater than 'max'.
+ */
+static WORD w_rlist(ORECT *po, GRECT *pt, GRECT *buf, WORD max)
+{
+    GRECT   t;
+    WORD    n;
+
+    for (n = 0; po; po = po->o_link)
+    {
+        rc_copy(&po->o_gr, &t);
+        if (!rc_intersect(pt, &t))
+            continue;
+        if (n < max)
+            rc_copy(&t, &buf[n]);
+        n++;
+    }
+
+    return n;
+}
+#endif
+
+
 /*
  *  (Re)initialize window manager internal variables, excluding window colours
  */
@@ -1297,6 +1506,9 @@ void wm_init(void)
     gl_wtop = NIL;
     gl_wtree = W_TREE;
     gl_awind = W_ACTIVE;
+#if CONF_WITH_WINDOW_GADGET_UPDATE
+    gl_abuilt.wh = NIL;
+#endif
     gl_newdesk = NULL;
 
     /* init tedinfo parts of title and info lines */
@@ -1560,6 +1772,16 @@ BOOL wm_get(WORD w_handle, WORD w_field, WORD *poutwds, WORD *pinwds)
         /* FIXME: GRECT typecasting again */
         w_owns(pwin, po, &t, (GRECT *)poutwds);
         break;
+#if CONF_WITH_WF_RLIST
+    /*
+     * intin[2-3] point to the buffer, intin[4] is its size in GRECTs;
+     * intout[1] returns the number of rectangles in the list
+     */
+    case WF_RLIST:
+        w_getsize(WS_WORK, w_handle, &t);
+        poutwds[0] = w_rlist(pwin->w_rlist, &t, *(GRECT **)pinwds, pinwds[2]);
+        break;
+#endif
     case WF_SCREEN:
         gsx_mret((LONG *)poutwds, (LONG *)(poutwds+2));
         break;
@@ -1727,7 +1949,13 @@ BOOL wm_set(WORD w_handle, WORD w_field, WORD *pinwds)
     }
 
     if (do_cpwalk)
-        w_cpwalk(w_handle, gadget, MAX_DEPTH, TRUE);
+    {
+#if CONF_WITH_WINDOW_GADGET_UPDATE
+        /* colour changes need the window object tree to be rebuilt */
+        if ((w_field == WF_COLOR) || !w_updgadget(w_handle, gadget))
+#endif
+            w_cpwalk(w_handle, gadget, MAX_DEPTH, TRUE);
+    }
 
     wm_update(END_UPDATE);      /* give up the sync */
 
@@ -20,6 +20,8 @@
 #include "obdefs.h"
 #include "intmath.h"
 #include "gemlib.h"
+#include "gemdos.h"
+#include "rectfunc.h"
 
 #include "gemobjop.h"
 #include "gemwmlib.h"
@@ -36,6 +38,26 @@
 static ORECT *rul;
 static ORECT gl_mkrect;
 
+/*
+ * the extra ORECTs are allocated by or_alloc() when the AES starts, so
+ * that the memory belongs to the AES rather than to an application
+ */
+static ORECT *or_extra;
+
+/*
+ * when chg_wh is not NIL, newrect() only rebuilds the rectangle lists
+ * of window chg_wh & the windows that overlap its previous (chg_old) or
+ * current (chg_new) position, since those of other windows are unchanged
+ */
+static WORD chg_wh = NIL;
+static GRECT chg_old, chg_new;
+
+
+void or_alloc(void)
+{
+    or_extra = dos_alloc_anyram(NUM_ORECT_EXTRA*sizeof(ORECT));
+}
+
 
 void or_start(void)
 {
@@ -47,6 +69,15 @@ void or_start(void)
         D.g_olist[i].o_link = rul;
         rul = &D.g_olist[i];
     }
+
+    if (or_extra)
+    {
+        for (i = 0; i < NUM_ORECT_EXTRA; i++)
+        {
+            or_extra[i].o_link = rul;
+            rul = &or_extra[i];
+        }
+    }
 }
 
 
@@ -132,6 +163,23 @@ static ORECT *brkrct(ORECT *new, ORECT *r, ORECT *p)
 }
 
 
+/*
+ * returns TRUE iff the rectangle list of window wh must be rebuilt
+ */
+static BOOL rlist_changed(WORD wh)
+{
+    GRECT t, u;
+
+    if ((chg_wh == NIL) || (wh == chg_wh))
+        return TRUE;
+
+    w_getsize(WS_TRUE, wh, &t);
+    rc_copy(&t, &u);
+
+    return rc_intersect(&chg_old, &t) || rc_intersect(&chg_new, &u);
+}
+
+
 /* tree = place holder for everyobj */
 static void mkrect(OBJECT *tree, WORD wh)
 {
@@ -139,6 +187,9 @@ static void mkrect(OBJECT *tree, WORD wh)
     ORECT   *new;
     ORECT   *r, *p;
 
+    if (!rlist_changed(wh))
+        return;
+
     pwin = &D.w_win[wh];
 
     /* get the new rect that is used for breaking this windows rects */
@@ -167,24 +218,30 @@ void newrect(OBJECT *tree, WORD wh)
     WINDOW  *pwin;
     ORECT   *r, *new;
     ORECT   *r0;
+    BOOL    changed;
 
     pwin = &D.w_win[wh];
-    r0 = pwin->w_rlist;
+    changed = rlist_changed(wh);
 
-    /* dump rectangle list */
-    if (r0)
+    if (changed)
     {
-        for (r = r0; r->o_link; r = r->o_link)
-            ;
-        r->o_link = rul;
-        rul = r0;
-    }
+        r0 = pwin->w_rlist;
 
-    /* zero the rectangle list */
-    pwin->w_rlist = NULL;
+        /* dump rectangle list */
+        if (r0)
+        {
+            for (r = r0; r->o_link; r = r->o_link)
+                ;
+            r->o_link = rul;
+            rul = r0;
+        }
 
-    /* start out with no broken rectangles */
-    pwin->w_flags &= ~VF_BROKEN;
+        /* zero the rectangle list */
+        pwin->w_rlist = NULL;
+
+        /* start out with no broken rectangles */
+        pwin->w_flags &= ~VF_BROKEN;
+    }
 
     /* if no size then return */
     w_getsize(WS_TRUE, wh, &gl_mkrect.o_gr);
@@ -195,7 +252,10 @@ void newrect(OBJECT *tree, WORD wh)
     gl_mkrect.o_link = NULL;
 
     /* break other window's rects with our current rect */
-    everyobj(tree, ROOT, wh, (EVERYOBJ_CALLBACK)mkrect, 0, 0, MAX_DEPTH);
+    everyobj(tree, ROOT, wh, (EVERYOBJ_CALLBACK)mkrect, NULL, 0, 0, MAX_DEPTH);
+
+    if (!changed)
+        return;
 
     /* get an orect in this window's list */
     new = get_orect();
@@ -203,3 +263,21 @@ void newrect(OBJECT *tree, WORD wh)
     w_getsize(WS_TRUE, wh, &new->o_gr);
     pwin->w_rlist = new;
 }
+
+
+/*
+ * rebuild the rectangle lists of all windows in the window tree, after
+ * window wh has changed from rectangle *pold (a WS_TRUE size)
+ *
+ * only the lists of windows that may have been affected are rebuilt
+ */
+void or_update(OBJECT *tree, WORD wh, GRECT *pold)
+{
+    chg_wh = wh;
+    rc_copy(pold, &chg_old);
+    w_getsize(WS_TRUE, wh, &chg_new);
+
+    everyobj(tree, ROOT, NIL, (EVERYOBJ_CALLBACK)newrect, NULL, 0, 0, MAX_DEPTH);
+
+    chg_wh = NIL;
+}
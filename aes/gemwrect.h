@@ -10,8 +10,10 @@
 #ifndef GEMWRECT_H
 #define GEMWRECT_H
 
+void or_alloc(void);
 void or_start(void);
 ORECT *get_orect(void);
 void newrect(OBJECT *tree, WORD wh);
+void or_update(OBJECT *tree, WORD wh, GRECT *pold);
 
 #endif
@@ -14,6 +14,9 @@
 #include "gsx2.h"
 #include "obdefs.h"
 #include "gsxdefs.h"
+#include "asm.h"
+#include "gemdosif.h"
+#include "../vdi/vdistub.h"
 
 VDIPB vdipb;
 
@@ -21,6 +24,26 @@ void gsx2(void)
 {
     vdipb.contrl = contrl;
 
+    /*
+     * if trap #2 still leads from the AES straight to the ROM VDI, i.e.
+     * nobody (such as NVDI or GDOS) has installed a handler before or
+     * after the AES, we call the VDI dispatcher directly.  it expects to
+     * run in supervisor mode, which the AES normally does.
+     */
+    if ((ULONG_AT(0x88) == (ULONG)aestrap) && (savetrap2 == vditrap)
+     && (get_sr() & 0x2000))
+    {
+        __asm__ volatile
+        (
+            "move.l  %0,d1\n\t"
+            "jsr     _GSX_ENTRY"
+        :
+        : "g"(&vdipb)
+        : "d0", "d1", "memory", "cc"
+        );
+        return;
+    }
+
     __asm__ volatile
     (
         "move.l  %0,d1\n\t"
@@ -52,9 +52,9 @@ typedef UWORD   EVSPEC;
 
 #define NUM_SMIBS   128                 /* SMIBs per process (when allocated) */
 
-#define KBD_SIZE 8
-#define QUEUE_SIZE 128
-#define NFORKS 32
+#define KBD_SIZE AES_KBD_QUEUE_SIZE
+#define QUEUE_SIZE AES_QUEUE_SIZE
+#define NFORKS 64
 
 struct cqueue               /* console keyboard queue */
 {
@@ -147,6 +147,14 @@ struct aespd                /* process descriptor */
         MFORM   p_mouse;        /* used by graf_mouse(SAVE,RESTORE) */
 #endif
 
+#if CONF_WITH_PROCTIME
+        ULONG   p_ticks;        /* time in context, in 200 Hz ticks */
+#endif
+
+#if CONF_WITH_EVNT_PERSIST
+        EVSPEC  p_evpersist;    /* events left armed by ev_multi(MU_PERSIST) */
+#endif
+
         char    *p_qaddr;       /* */
         WORD    p_qindex;       /* */
         char    p_queue[QUEUE_SIZE];    /* */
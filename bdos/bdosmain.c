@@ -51,6 +51,9 @@ PFVOID old_trap2; /* Old trap #2 handler, also used by rwa.S */
 
 static long ni(void);
 static long xgetver(void);
+#if CONF_WITH_BDOS_PROFILE
+static long xdosprof(WORD mode, WORD index, void *info);
+#endif
 
 
 /*
@@ -284,13 +287,172 @@ static const FND funcs[] =
     { NI, 0, 0 },
 
     { F(xrename),  0, 5 },      /* 0x56 */
-    { F(xgsdtof),  0, 4 }       /* 0x57 */
+    { F(xgsdtof),  0, 4 },      /* 0x57 */
+
+#if CONF_WITH_FSNEXTN || CONF_WITH_FPREALLOC || CONF_WITH_OSMEM_SLABS || CONF_WITH_MEMINFO \
+ || CONF_WITH_PROCTIME || CONF_WITH_FATMIRROR_DEFER || CONF_WITH_DSYNC || CONF_WITH_BDOS_PROFILE \
+ || CONF_WITH_DREADAHEAD
+# if CONF_WITH_FSNEXTN
+    { F(xsnextn),  0, 3 },      /* 0x58 - EmuTOS-specific */
+# else
+    { NI, 0, 0 },               /* 0x58 */
+# endif
+#endif
+
+#if CONF_WITH_FPREALLOC || CONF_WITH_OSMEM_SLABS || CONF_WITH_MEMINFO || CONF_WITH_PROCTIME \
+ || CONF_WITH_FATMIRROR_DEFER || CONF_WITH_DSYNC || CONF_WITH_BDOS_PROFILE \
+ || CONF_WITH_DREADAHEAD
+# if CONF_WITH_FPREALLOC
+    { F(xprealloc), 0, 3 },     /* 0x59 - EmuTOS-specific */
+# else
+    { NI, 0, 0 },               /* 0x59 */
+# endif
+#endif
+
+#if CONF_WITH_OSMEM_SLABS || CONF_WITH_MEMINFO || CONF_WITH_PROCTIME || CONF_WITH_FATMIRROR_DEFER \
+ || CONF_WITH_DSYNC || CONF_WITH_BDOS_PROFILE || CONF_WITH_DREADAHEAD
+# if CONF_WITH_OSMEM_SLABS
+    { F(xosmem),   0, 2 },      /* 0x5A - EmuTOS-specific */
+# else
+    { NI, 0, 0 },               /* 0x5A */
+# endif
+#endif
+
+#if CONF_WITH_MEMINFO || CONF_WITH_PROCTIME || CONF_WITH_FATMIRROR_DEFER || CONF_WITH_DSYNC \
+ || CONF_WITH_BDOS_PROFILE || CONF_WITH_DREADAHEAD
+# if CONF_WITH_MEMINFO
+    { F(xmeminfo), 0, 5 },      /* 0x5B - EmuTOS-specific */
+# else
+    { NI, 0, 0 },               /* 0x5B */
+# endif
+#endif
+
+#if CONF_WITH_PROCTIME || CONF_WITH_FATMIRROR_DEFER || CONF_WITH_DSYNC || CONF_WITH_BDOS_PROFILE \
+ || CONF_WITH_DREADAHEAD
+# if CONF_WITH_PROCTIME
+    { F(xproctime), 0, 4 },     /* 0x5C - EmuTOS-specific */
+# else
+    { NI, 0, 0 },               /* 0x5C */
+# endif
+#endif
+
+#if CONF_WITH_FATMIRROR_DEFER || CONF_WITH_DSYNC || CONF_WITH_BDOS_PROFILE || CONF_WITH_DREADAHEAD
+# if CONF_WITH_FATMIRROR_DEFER
+    { F(xfatmode), 0, 2 },      /* 0x5D - EmuTOS-specific */
+# else
+    { NI, 0, 0 },               /* 0x5D */
+# endif
+#endif
+
+#if CONF_WITH_DSYNC || CONF_WITH_BDOS_PROFILE || CONF_WITH_DREADAHEAD
+# if CONF_WITH_DSYNC
+    { F(xsync),    0, 1 },      /* 0x5E - EmuTOS-specific */
+# else
+    { NI, 0, 0 },               /* 0x5E */
+# endif
+#endif
+
+#if CONF_WITH_BDOS_PROFILE || CONF_WITH_DREADAHEAD
+# if CONF_WITH_BDOS_PROFILE
+    { F(xdosprof), 0, 4 },      /* 0x5F - EmuTOS-specific */
+# else
+    { NI, 0, 0 },               /* 0x5F */
+# endif
+#endif
+
+#if CONF_WITH_DREADAHEAD
+    { F(xreadahead), 0, 2 },    /* 0x60 - EmuTOS-specific */
+#endif
 #undef F
 #undef NI
 };
 #define MAX_FNCALL (ARRAY_SIZE(funcs) - 1)
 
 
+#if CONF_WITH_BDOS_PROFILE
+/*
+ * per-function profiling counters, indexed by function number, and
+ * latency histograms for the functions in hist_fn[]
+ */
+typedef struct {
+    ULONG calls;                /* number of calls */
+    ULONG ticks;                /* 200Hz ticks spent in those calls */
+} FN_PROFILE;
+
+static FN_PROFILE profile[MAX_FNCALL+1];
+
+static const UBYTE hist_fn[] = { GEMDOS_FOPEN, GEMDOS_FREAD, GEMDOS_FWRITE, 0x4b, 0x4e };
+static ULONG histogram[ARRAY_SIZE(hist_fn)][DP_BUCKETS];
+
+/* upper limits of the histogram buckets, in 200Hz ticks (see DOSPROF) */
+static const UBYTE bucket_limit[DP_BUCKETS-1] = { 1, 2, 8, 32, 128 };
+
+static void profile_call(WORD fn, ULONG ticks)
+{
+    WORD i, n;
+
+    profile[fn].calls++;
+    profile[fn].ticks += ticks;
+
+    for (i = 0; i < ARRAY_SIZE(hist_fn); i++)
+    {
+        if (hist_fn[i] == fn)
+        {
+            for (n = 0; (n < DP_BUCKETS-1) && (ticks >= bucket_limit[n]); n++)
+                ;
+            histogram[i][n]++;
+            break;
+        }
+    }
+}
+
+
+/*
+ * xdosprof - get the BDOS profiling counters
+ *
+ * Function 0x5F   s_dosprof (EmuTOS-specific)
+ *
+ * Arguments:
+ *  mode  - DP_FUNCTION, DP_CACHE or DP_RESET
+ *  index - for DP_FUNCTION, the GEMDOS function number
+ *  info  - for DP_FUNCTION, DOSPROF structure to fill in;
+ *          for DP_CACHE, DOSCACHE structure to fill in
+ *
+ * returns ERANGE if the mode or function number is invalid
+ */
+static long xdosprof(WORD mode, WORD index, void *info)
+{
+    DOSPROF *dp = info;
+    DOSCACHE *dc = info;
+    WORD i;
+
+    switch(mode) {
+    case DP_FUNCTION:
+        if ((index < 0) || (index > MAX_FNCALL))
+            break;
+        bzero(dp, sizeof(DOSPROF));
+        dp->dp_calls = profile[index].calls;
+        dp->dp_ticks = profile[index].ticks;
+        for (i = 0; i < ARRAY_SIZE(hist_fn); i++)
+            if (hist_fn[i] == index)
+                memcpy(dp->dp_hist, histogram[i], sizeof(dp->dp_hist));
+        return E_OK;
+    case DP_CACHE:
+        dc->dc_lookups = bufl_lookups;
+        dc->dc_misses = bufl_misses;
+        return E_OK;
+    case DP_RESET:
+        bzero(profile, sizeof(profile));
+        bzero(histogram, sizeof(histogram));
+        bufl_lookups = bufl_misses = 0;
+        return E_OK;
+    }
+
+    return ERANGE;
+}
+#endif
+
+
 /*
  *  xgetver -
  *      return current version number
@@ -340,6 +502,10 @@ void osinit_after_xmaddalt(void)
     run->p_flags = PF_STANDARD;
     run->p_env = CONST_CAST(char *,double_nul);
 
+#if CONF_WITH_BDOS_CACHE
+    bufl_grow();    /* add Alt-RAM buffers, now that Alt-RAM is known */
+#endif
+
     time_init();
 
     KDEBUG(("BDOS: address of basepage = %p\n", run));
@@ -385,17 +551,23 @@ static void offree(DMD *d)
 {
     int i;
     OFD *f;
+    FTAB *ftab;
+
+#if CONF_WITH_SFT_GROW
+    ofdhashpurge(d);
+#endif
 
-    for (i = 0; i < OPNFILES; i++)
+    for (i = 0; i < SFTNUM; i++)
     {
-        if (((long) (f = sft[i].f_ofd)) > 0L)
+        ftab = SFT(i);
+        if (((long) (f = ftab->f_ofd)) > 0L)
         {
             if (f->o_dmd == d)
             {
                 xmfreblk(f);
-                sft[i].f_ofd = NULL;
-                sft[i].f_own = NULL;
-                sft[i].f_use = 0;
+                ftab->f_ofd = NULL;
+                ftab->f_own = NULL;
+                ftab->f_use = 0;
             }
         }
     }
@@ -416,6 +588,9 @@ long osif(short *pw)
     int num, max;
     long rc, numl;
     const FND *f;
+#if CONF_WITH_BDOS_PROFILE
+    ULONG start;
+#endif
 
 restrt:
     fn = pw[0];
@@ -424,6 +599,37 @@ restrt:
 
     KDEBUG(("BDOS (fn=0x%04x)\n",fn));
 
+    /*
+     * calls that never access a disk cannot longjmp() to errbuf, so we
+     * handle the most frequent ones here without setting it up.  this is
+     * not done while a write-back is due, since that must be done first.
+     */
+#if CONF_WITH_BDOS_WRITEBACK
+    if (!bufl_wbdue)
+#endif
+    {
+        switch(fn)
+        {
+        case 0x02:              /* Cconout() */
+            if (run->p_uft[1] <= 0)     /* not redirected to a file */
+                return xconout(pw[1]);
+            break;
+        case 0x09:              /* Cconws() */
+            if (run->p_uft[1] <= 0)
+            {
+                xconws(*((char **) &pw[1]));
+                return 0;
+            }
+            break;
+        case 0x19:              /* Dgetdrv() */
+        case 0x2a:              /* Tgetdate() */
+        case 0x2c:              /* Tgettime() */
+        case 0x2f:              /* Fgetdta() */
+        case 0x30:              /* Sversion() */
+            return (*funcs[fn].fncall.v)();
+        }
+    }
+
     if (setjmp(errbuf))
     {
         rc = errcode;
@@ -436,16 +642,31 @@ restrt:
             /* first, out with the old stuff */
             dn = drvtbl[errdrv]->m_dtl;
             offree(drvtbl[errdrv]);
+#if CONF_WITH_BDOS_FREEMAP
+            freemap_discard(drvtbl[errdrv]);
+#endif
+#if CONF_WITH_BDOS_EXTENTS
+            extent_discard(drvtbl[errdrv],0);
+#endif
+#if CONF_WITH_PGM_CACHE
+            pgmcache_discard(drvtbl[errdrv],0);
+#endif
             xmfreblk(drvtbl[errdrv]);
             drvtbl[errdrv] = 0;
 
             if (dn)
                 freetree(dn);
+#if CONF_WITH_BDOS_NAMECACHE
+            namecache_purge(NULL);
+#endif
 
             for (i = 0; i < 2; i++)
                 for (bx = bufl[i]; bx; bx = bx->b_link)
                     if (bx->b_bufdrv == errdrv)
                         bx->b_bufdrv = -1;
+#if CONF_WITH_FATMIRROR_DEFER
+            fatmirror_discard(errdrv);
+#endif
 
             /* then, in with the new */
             b = (BPB *)Getbpb(errdrv);
@@ -469,9 +690,27 @@ restrt:
             for (bx = bufl[i]; bx; bx = bx->b_link)
                 if (bx->b_bufdrv == errdrv)
                     bx->b_bufdrv = -1;
+#if CONF_WITH_FATMIRROR_DEFER
+        fatmirror_discard(errdrv);
+#endif
         return rc;
     }
 
+#if CONF_WITH_BDOS_WRITEBACK
+    /* do any write-back requested by tikfrk() */
+    if (bufl_wbdue)
+    {
+#if CONF_WITH_FAT32
+        fsinfo_flush(-1);
+#endif
+        bufl_flush(-1);
+    }
+#endif
+
+#if CONF_WITH_OSMEM_SLABS
+    osmem_check();
+#endif
+
     f = &funcs[fn];
     typ = f->stdio_typ;
 
@@ -555,13 +794,15 @@ restrt:
         else
             h = pw[1];
 
-        if (h >= NUMSTD)
-            numl = (long) sft[h-NUMSTD].f_ofd;
+        if (h >= NUMHANDLES)
+            numl = 0;       /* out of range */
+        else if (h >= NUMSTD)
+            numl = (long) SFT(h-NUMSTD)->f_ofd;
         else if (h >= 0)
         {
             h = run->p_uft[h];
             if (h > 0)
-                numl = (long) sft[h-NUMSTD].f_ofd;
+                numl = (long) SFT(h-NUMSTD)->f_ofd;
             else
                 numl = h;
         }
@@ -605,15 +846,16 @@ restrt:
 
                 pb2 = *pb;      /* char * is buffer address */
 
-                for (n = 0; n < count; n++)
+                if (num == H_Console)
                 {
-                    if (num == H_Console)
-                        tabout(HXFORM(num), (unsigned char)*pb2++);
-                    else
-                    {           /* M01.01.1029.01 */
-                        if (Bconout(HXFORM(num), (unsigned char)*pb2++) == 0)
-                            return n;
-                    }
+                    tabouts(HXFORM(num), pb2, count);
+                    return count;
+                }
+
+                for (n = 0; n < count; n++)
+                {               /* M01.01.1029.01 */
+                    if (Bconout(HXFORM(num), (unsigned char)*pb2++) == 0)
+                        return n;
                 }
 
                 return count;
@@ -642,6 +884,9 @@ restrt:
         }
     }
 
+#if CONF_WITH_BDOS_PROFILE
+    start = hz_200;
+#endif
     if (!rc)
     {
         switch(f->wparms)
@@ -678,6 +923,9 @@ restrt:
             rc = EINTRN;    /* Internal error */
         }
     }
+#if CONF_WITH_BDOS_PROFILE
+    profile_call(fn, hz_200 - start);
+#endif
 
     KDEBUG(("BDOS returns: 0x%08lx\n",rc));
 
@@ -35,6 +35,10 @@ extern WORD *root[MAXQUICK];
  * and also by bios/kprint.c */
 extern PD *run;
 
+/* Set the owner of a memory block.
+ * Declared here because also used by the AES to hand over shared buffers */
+void set_owner(void *addr, PD *p);
+
 /* BDOS current date/time.
  * Declared here because also updated by XBIOS Settime() */
 extern UWORD current_date, current_time;
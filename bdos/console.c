@@ -22,7 +22,9 @@
 #include "proc.h"
 #include "console.h"
 #include "biosbind.h"
+#include "biosext.h"
 #include "bdosstub.h"
+#include "string.h"
 
 /*
  * The following structure is used for the typeahead buffer
@@ -75,6 +77,7 @@ static void buflush(TYPEAHEAD *bufptr);
 static long constat(int h);
 static void conbrk(int h);
 static void conout(int h, int ch);
+static void conouts(int h, const char *p, int n);
 static void cookdout(int h, int ch);
 static long getch(int h);
 static void prt_line(int h, char *p);
@@ -100,6 +103,12 @@ static int backsp(int h, char *cbuf, int retlen, int col);
 
 #define terminate() xterm(-32)
 
+/*
+ * the maximum number of printable characters output by tabouts() between
+ * checks for control-s/control-c
+ */
+#define MAX_CONRUN  64
+
 
 /*
  * set up system initial standard handles
@@ -273,6 +282,29 @@ static void conout(int h, int ch)
 }
 
 
+/*
+ * conouts - console output of printable characters - used internally
+ *
+ * @h - device handle
+ * @p - the characters, all of which must be >= ' '
+ * @n - the number of characters
+ */
+static void conouts(int h, const char *p, int n)
+{
+    int i;
+
+    conbrk(h);                  /* check for control-s break */
+
+    /* output the whole run if possible, else a character at a time */
+    if (!bconouts(h, (const UBYTE *)p, n))
+    {
+        for (i = 0; i < n; i++)
+            Bconout(h, (unsigned char)p[i]);
+    }
+    glbcolumn[h] += n;          /* keep track of screen column */
+}
+
+
 /*
  * xconout - Function 0x02 - console output with tab expansion
  */
@@ -303,6 +335,32 @@ void tabout(int h, int ch)
 }
 
 
+/*
+ * tabouts - output a string with tab expansion
+ *
+ * this is equivalent to calling tabout() for each character, except
+ * that runs of printable characters are output via conouts()
+ *
+ * @h - device handle
+ * @p - the string
+ * @count - number of characters in string
+ */
+void tabouts(int h, const char *p, long count)
+{
+    const char *q, *end;
+
+    for (end = p + count; p < end; p = q)
+    {
+        for (q = p; (q < end) && ((unsigned char)*q >= ' ') && (q - p < MAX_CONRUN); q++)
+            ;
+        if (q == p)
+            tabout(h, (unsigned char)*q++);
+        else
+            conouts(h, p, q - p);
+    }
+}
+
+
 /*
  * cookdout - console output with tab and control character expansion
  *
@@ -467,8 +525,7 @@ void xconws(char *p)
  */
 static void prt_line(int h, char *p)
 {
-    while(*p)
-        tabout(h, (unsigned char)*p++);
+    tabouts(h, p, strlen(p));
 }
 
 
@@ -58,6 +58,7 @@ void xconrs(char *p);
 int cgets(int h, int maxlen, char *buf);
 long conin(int h);
 void tabout(int h, int ch);
+void tabouts(int h, const char *p, long count);
 
 
 
@@ -42,7 +42,6 @@
 #define SUPSIZ      1024            /* common supervisor stack size (in words) */
 #define OPNFILES    75              /* max open files in system */
 #define NCURDIR     40              /* max current directories in use in system */
-#define NUMHANDLES  (NUMSTD+OPNFILES)
 #define KBBUFSZ     64              /* size of typeahead buffer -- must be power of 2!! */
 #define KBBUFMASK   (KBBUFSZ-1)
 
@@ -86,7 +85,11 @@ typedef struct _dnd DND;
 typedef struct _dmd DMD;
 
 typedef UWORD FH;               /*  file handle    */
+#if CONF_WITH_FAT32
+typedef ULONG CLNO;             /*  cluster number */
+#else
 typedef UWORD CLNO;             /*  cluster number */
+#endif
 typedef ULONG RECNO;            /*  record number  */
 
 
@@ -117,7 +120,6 @@ typedef struct
 {
     UWORD o_flag;       /* see below                            */
     WORD  o_usecnt;     /* count of open OFDs pointing here     */
-                    /* the following 3 items must be as in FCB: */
     DOSTIME o_td;       /* creation time/date: little-endian!   */
     CLNO  o_strtcl;     /* starting cluster number              */
     long  o_fileln;     /* length of file in bytes              */
@@ -128,6 +130,7 @@ typedef struct
  * bit usage in o_flag 
  */
 #define O_DIRTY     1   /* contents have changed, FCB on disk must be updated */ 
+#define O_PREALLOC  2   /* chain may extend beyond end of file, see xprealloc() */
 
 
 
@@ -150,8 +153,11 @@ struct _ofd
     CLNO  o_curcl;      /* current cluster number for file      */
     RECNO o_currec;     /* current record number for file       */
     UWORD o_curbyt;     /* byte pointer within current cluster  */
-    OFD   *o_thread;    /* multiple open thread list            */
+    OFD   *o_thread;    /* next base OFD in hash chain          */
     UWORD o_mod;        /* mode file opened in (see below)      */
+#if CONF_WITH_BDOS_READAHEAD
+    long  o_rdend;      /* byte pointer after last read         */
+#endif
 
     DFD   o_disk;       /* data to be synchronised with the disk*/
 } ;
@@ -164,6 +170,7 @@ struct _ofd
  * note: bits 4-7 are only used if GEMDOS file-sharing/record-locking
  *       is implemented
  */
+#define O_SHARED    0x0100  /* OFD is also used by a handle from Fdup() */
 #define INH_MODE    0x80    /* bit 7 is inheritance flag (not yet implemented) */
 #define MODE_FSM    0x70    /* bits 4-6 are file sharing mode (not yet implemented) */
 #define MODE_FAC    0x07    /* bits 0-2 are file access code: */
@@ -184,9 +191,10 @@ typedef struct
 {
     char f_name[FNAMELEN];
     UBYTE f_attrib;
-    UBYTE f_fill[10];
+    UBYTE f_fill[8];
+    UWORD f_clusthi;        /* FAT32 only: high word of f_clust */
     DOSTIME f_td;           /* time, date */
-    CLNO f_clust;
+    UWORD f_clust;          /* see fcb_getcl() */
     long f_fileln;
 } FCB;
 
@@ -222,8 +230,28 @@ struct _dnd         /* directory node descriptor */
 
     long d_scan;        /*  current posn in dir for DND tree    */
     OFD  *d_files;      /* open files on this node              */
+#if CONF_WITH_DND_LRU
+    UWORD d_stamp;      /*  value of dndclock when last used    */
+#endif
 } ;
 
+#if CONF_WITH_BDOS_NAMECACHE
+/*
+ *  NCE - directory name cache entry (see fsdir.c)
+ */
+typedef struct _nce NCE;
+struct _nce
+{
+    NCE   *n_hnext;     /*  next entry in the same hash chain   */
+    NCE   *n_age;       /*  next entry in order of reuse        */
+    DND   *n_dnd;       /*  directory, or NULL if unused        */
+    long  n_pos;        /*  position of FCB in directory        */
+    char  n_name[FNAMELEN]; /*  name, in FCB format             */
+    UBYTE n_spare;
+} ;
+#endif
+
+
 /*
  * bit usage in d_flag
  */
@@ -236,29 +264,43 @@ struct _dnd         /* directory node descriptor */
  *  DMD - Drive Media Block
  *
  *  note: in the following comments, records == logical sectors
+ *
+ *  architectural restriction: this is allocated by MGET(), so it must
+ *  not exceed 64 bytes in length
  */
 struct _dmd         /* drive media block */
 {
     RECNO  m_recoff[3]; /*  record offsets for fat,dir,data     */
     WORD   m_drvnum;    /*  drive number for this media         */
-    WORD   m_fsiz;      /*  fat size in records M01.01.03       */
+    UWORD  m_fsiz;      /*  fat size in records M01.01.03       */
     WORD   m_clsiz;     /*  cluster size in records M01.01.03   */
     UWORD  m_clsizb;    /*  cluster size in bytes               */
     UWORD  m_recsiz;    /*  record size in bytes                */
 
     CLNO   m_numcl;     /*  total number of clusters in data    */
-    WORD   m_clrlog;    /* log (base 2) of clsiz in records     */
     WORD   m_clrm;      /* clsiz in rec, mask                   */
-    WORD   m_rblog;     /* log (base 2) of recsiz in bytes      */
     WORD   m_rbm;       /* recsiz in bytes, mask                */
-    WORD   m_clblog;    /* log (base 2) of clsiz in bytes       */
     WORD   m_clbm;      /* clsiz in bytes, mask                 */
     OFD    *m_fatofd;   /* OFD for 'fat file'                   */
 
     OFD    *m_ofl;      /*  list of open files                  */
     DND    *m_dtl;      /* root of directory tree list          */
+    UBYTE  m_clrlog;    /* log (base 2) of clsiz in records     */
+    UBYTE  m_rblog;     /* log (base 2) of recsiz in bytes      */
+    UBYTE  m_clblog;    /* log (base 2) of clsiz in bytes       */
     UBYTE  m_16;        /* 16 bit fat ?                         */
     UBYTE  m_1fat;      /* 1 FAT only ?                         */
+#if CONF_WITH_FAT32
+    UBYTE  m_32;        /* 32 bit fat ? (see M32_FSINFO below)  */
+#endif
+#if CONF_WITH_BDOS_FREEMAP
+    UBYTE  *m_fbmap;    /* free cluster bitmap (1 bit = free)   */
+    CLNO   m_fbfree;    /* number of free clusters              */
+    CLNO   m_fbnext;    /* no free cluster below this one       */
+#endif
+#if CONF_WITH_BDOS_READAHEAD
+    UBYTE  m_rahead;    /* nbr of records to read ahead, 0=none */
+#endif
 } ;
 
 
@@ -311,6 +353,21 @@ typedef struct
     WORD f_use;         /* use count */
 } FTAB;
 
+/*
+ * with CONF_WITH_SFT_GROW, entries beyond the static sft[] are allocated
+ * as required from the OS memory pool, SFT_PER_BLOCK at a time
+ */
+#if CONF_WITH_SFT_GROW
+#define SFT_PER_BLOCK   (64/sizeof(FTAB))   /* entries per 64-byte block */
+#define SFT_BLOCKS      ((SFT_MAX_FILES-OPNFILES+SFT_PER_BLOCK-1)/SFT_PER_BLOCK)
+#define SFTNUM          sftnum              /* current number of entries */
+#define SFT(n)          (((n) < OPNFILES) ? &sft[n] : sftext(n))
+#else
+#define SFTNUM          OPNFILES
+#define SFT(n)          (&sft[n])
+#endif
+#define NUMHANDLES      (NUMSTD+SFTNUM)
+
 
 
 /*
@@ -326,8 +383,9 @@ typedef struct
                                 /*    FCB, otherwise 0                  */
     UWORD dt_cloffset;          /*  if subdir, offset within cluster to */
                                 /*   next FCB, otherwise 0              */
-    CLNO  dt_clnum;             /*  if subdir, current cluster number,  */
-                                /*   otherwise 0                        */
+    UWORD dt_clnum;             /*  if subdir, current cluster number,  */
+                                /*   otherwise 0 (for FAT32, the high   */
+                                /*   word is in dt_offset_drive 31-16)  */
     char  dt_attr;              /*  attribute from Fsfirst()            */
                             /* public area, must not change             */
     char  dt_fattr;             /*  attrib from fcb             21      */
@@ -337,6 +395,7 @@ typedef struct
 } DTAINFO;                      /*    includes null terminator          */
 
 #define DTA_DRIVEMASK   0x0000001fL
+#define DTA_CLHIMASK    0xffff0000L     /* FAT32 subdir: high word of cluster */
 
 /* the following structure is used to track current directories */
 typedef struct {
@@ -351,6 +410,13 @@ extern  DIRTBL_ENTRY dirtbl[];
 extern  DMD     *drvtbl[];
 extern  LONG    drvsel;
 extern  FTAB    sft[];
+#if CONF_WITH_SFT_GROW
+extern  FTAB    *sftblk[];
+extern  WORD    sftnum;
+#endif
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+extern  ULONG   dirchgcnt;
+#endif
 
 
 
@@ -399,6 +465,12 @@ long xunlink(char *name);
 /* internal delete file. */
 long ixdel(DND *dn, FCB *f, long pos);
 
+#if CONF_WITH_SFT_GROW
+/* maintain the open file hash */
+void ofdunhash(OFD *fd);
+void ofdhashpurge(DMD *dm);
+#endif
+
 /* internal check for illegal name */
 BOOL contains_illegal_characters(const char *test);
 
@@ -407,6 +479,49 @@ BOOL contains_illegal_characters(const char *test);
  */
 
 void bufl_init(void);
+#if CONF_WITH_MEDIACH_CACHE
+/* Mediach(), remembering 'no change' results */
+LONG bufl_mediach(WORD drv);
+#else
+#define bufl_mediach(drv) Mediach(drv)
+#endif
+#if CONF_WITH_BDOS_CACHE
+void bufl_grow(void);
+/* return our buffer holding the specified record, or NULL */
+BCB *bufl_lookup(WORD drv,WORD buftype,RECNO recnum);
+#endif
+#if CONF_WITH_BDOS_READAHEAD
+/* read up to 'count' data records into the cache, starting at 'recnum' */
+void bufl_readahead(DMD *dm,RECNO recnum,WORD count);
+#endif
+#if CONF_WITH_BDOS_WRITEBACK || CONF_WITH_BDOS_READAHEAD
+/* zero 'count' data records on disk, starting at 'recnum' */
+BOOL bufl_zero(DMD *dm,RECNO recnum,WORD count);
+#endif
+#if CONF_WITH_BDOS_PROFILE
+extern ULONG bufl_lookups;      /* getbcb() calls */
+extern ULONG bufl_misses;       /* getbcb() calls which read the record */
+#endif
+#if CONF_WITH_BDOS_WRITEBACK
+extern volatile WORD bufl_wbtimer; /* ms until write-back, 0 if not running */
+extern volatile BOOL bufl_wbdue;   /* TRUE if write-back should be done */
+/* write back dirty buffers for one drive, or all drives if negative */
+void bufl_flush(WORD drv);
+#endif
+#if CONF_WITH_DSYNC
+/* write back the dirty buffers of one drive, or all drives if negative */
+long xsync(int drv);
+#endif
+#if CONF_WITH_DREADAHEAD
+/* get or set the read-ahead limit of a drive */
+long xreadahead(int drv, int count);
+#endif
+#if CONF_WITH_FATMIRROR_DEFER
+/* get or set the FAT write mode of a drive */
+long xfatmode(int drv, int mode);
+/* forget the mirror FAT records still to be copied for a drive */
+void fatmirror_discard(WORD drv);
+#endif
 /* ??? */
 void flush(BCB *b);
 /* return the ptr to the buffer containing the desired record */
@@ -419,10 +534,41 @@ BCB *getbcb(DMD *dmd,WORD buftype,RECNO recnum);
 
 RECNO cl2rec(CLNO cl, DMD *dm);
 void clfix(CLNO cl, CLNO link, DMD *dm);
+void clfree(CLNO cl, DMD *dm);
 CLNO getrealcl(CLNO cl, DMD *dm);
 CLNO getclnum(CLNO cl, OFD *of);
 int nextcl(OFD *p, int wrtflg);
 long xgetfree(long *buf, int drv);
+/* get/set the starting cluster in a directory entry */
+CLNO fcb_getcl(const FCB *f, DMD *dm);
+void fcb_setcl(FCB *f, CLNO cl, DMD *dm);
+#if CONF_WITH_FPREALLOC
+long xprealloc(int h, long size);
+/* free any preallocated clusters beyond end of file */
+void prealloc_trim(OFD *fd);
+#endif
+#if CONF_WITH_BDOS_FREEMAP
+void freemap_discard(DMD *dm);
+#endif
+#if CONF_WITH_FAT32
+/* write back the FSInfo hints of a drive, or of all drives */
+void fsinfo_flush(WORD drv);
+#endif
+#if CONF_WITH_BDOS_EXTENTS
+/* discard the extent map(s) for a drive, or for one file on it */
+void extent_discard(DMD *dm, CLNO strtcl);
+/* return the disk cluster for cluster 'idx' of a file, via its extent map */
+CLNO extent_getcl(OFD *p, CLNO idx, CLNO *runlen);
+#endif
+
+#if CONF_WITH_PGM_CACHE
+/*
+ * in kpgmld.c
+ */
+
+/* discard the cached programs of a drive, or of one file on it */
+void pgmcache_discard(DMD *dm, CLNO strtcl);
+#endif
 
 /*
  * in fsio.c
@@ -453,6 +599,9 @@ long xchmod(char *p, int wrt, UBYTE mod);
 long ixsfirst(char *name, WORD att, DTAINFO *addr);
 long xsfirst(char *name, int att);
 long xsnext(void);
+#if CONF_WITH_FSNEXTN
+long xsnextn(FSENTRY *buf, int count);
+#endif
 long xgsdtof(DOSTIME *buf, int h, int wrt);
 void builds(const char *s1 , char *s2 );
 long xrename(int n, char *p1, char *p2);
@@ -465,6 +614,11 @@ int incr_curdir_usage(DND *dnd);
 void decr_curdir_usage(int index);
 OFD *makofd(DND *p);
 WORD free_available_dnds(void);
+#if CONF_WITH_BDOS_NAMECACHE
+void namecache_add(NCE *p, WORD count);
+void namecache_forget(DND *dnd, const char *name);
+void namecache_purge(DND *dnd);
+#endif
 
 
 /*
@@ -475,14 +629,28 @@ void xsetdta(DTAINFO *addr);
 long xsetdrv(int drv);
 long xgetdrv(void);
 OFD  *getofd(int h);
+int  sftalloc(void);
+#if CONF_WITH_SFT_GROW
+FTAB *sftext(int n);
+#endif
 
 
 /*
  * FAT chain defines
  */
 #define FREECLUSTER     0x0000
+#if CONF_WITH_FAT32
+/* getrealcl() maps the end-of-chain values of all FAT types to ENDOFCHAIN */
+#define ENDOFCHAIN      0x0fffffffUL            /* our end-of-chain marker */
+#define endofchain(a)   ((a)>=0x0ffffff8UL)     /* in case file was created by someone else */
+#define IS_FAT32(dm)    ((dm)->m_32)
+#define M32_FSINFO      0x02        /* in m_32: FSInfo hints have been read */
+#define M32_FSDIRTY     0x04        /* in m_32: ... and changed since written */
+#else
 #define ENDOFCHAIN      0xffff                  /* our end-of-chain marker */
 #define endofchain(a)   (((a)&0xfff8)==0xfff8)  /* in case file was created by someone else */
+#define IS_FAT32(dm)    0
+#endif
 
 
 /* Misc. defines */
@@ -490,4 +658,6 @@ OFD  *getofd(int h);
 #define CL_DIR  0x0002      /* this is a directory file, flush, do not free */
 #define CL_FULL 0x0004      /* even though it's a directory, full close */
 
+#define DIR_FILE_LENGTH 0x7fffffffL     /* fake size for directories */
+
 #endif /* FS_H */
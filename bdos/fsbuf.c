@@ -22,27 +22,270 @@
 #include "string.h"
 #include "tosvars.h"
 #include "biosext.h"
+#include "has.h"
+#include "intmath.h"
 
-#define NUMBUFS 2       /* buffers per list */
+#define NUMBUFS 2       /* minimum buffers per list */
 
-/* creates a chain of BCBs and corresponding buffers */
-static void *create_chain(UBYTE *p,LONG n)
+#if CONF_WITH_BDOS_CACHE
+
+/*
+ *  BCBX - extended Buffer Control Block
+ *
+ *  the BCBs that we allocate ourselves carry some private data after
+ *  the API part, so that they can be found via a hash table and replaced
+ *  in LRU order.  programs such as CACHEnnn.PRG may link their own
+ *  (plain) BCBs into the bufl[] chains: these are not hashed, but they
+ *  are still found by the scan of the chain that is done on a cache miss.
+ */
+typedef struct _bcbx BCBX;
+struct _bcbx
+{
+    BCB     x_bcb;      /*  must be first                       */
+    BCBX    *x_hnext;   /*  next BCBX in the same hash chain    */
+    ULONG   x_stamp;    /*  value of bcb_clock at last use      */
+    WORD    x_hash;     /*  hash chain index, -1 if not hashed  */
+    WORD    x_spare;    /*  keeps the buffers long-aligned      */
+} ;
+
+#define BCBHASH_SIZE    128     /* must be a power of 2 */
+#define BCBHASH(drv,typ,rec) \
+    ((UWORD)((UWORD)(rec) + ((drv) << 2) + (typ)) & (BCBHASH_SIZE-1))
+
+#define MAX_POOLS   2   /* buffers allocated by bufl_init() & bufl_grow() */
+
+static BCBX *bcbhash[BCBHASH_SIZE];
+static ULONG bcb_clock;         /* incremented on every buffer access */
+
+static struct {
+    UBYTE *start;
+    UBYTE *end;
+} pool[MAX_POOLS];
+static WORD numpools;
+
+#define BCBSIZE     sizeof(BCBX)
+
+#if CONF_WITH_BDOS_NAMECACHE
+# define NCESIZE    (BDOS_NAMECACHE_PER_BUF * sizeof(NCE))  /* per buffer */
+#else
+# define NCESIZE    0
+#endif
+
+#if CONF_WITH_BDOS_WRITEBACK || CONF_WITH_BDOS_READAHEAD
+static UBYTE *stgbuf;           /* staging buffer for write-back/read-ahead, */
+static LONG stgsize;            /*  in Alt-RAM: NULL & 0 if there is none   */
+#endif
+
+#if CONF_WITH_BDOS_WRITEBACK
+volatile WORD bufl_wbtimer;     /* ms until write-back, 0 if not running */
+volatile BOOL bufl_wbdue;       /* TRUE if write-back should be done */
+#endif
+
+#if CONF_WITH_FATMIRROR_DEFER
+/*
+ * deferred FAT mirror
+ *
+ * for the drives in fatdefer, FAT records are only written to the
+ * primary FAT (the one at m_recoff[BT_FAT]) when flushed, and the range
+ * of records written is remembered.  fatmirror_sync() then copies that
+ * range from the primary FAT to the other one when all the dirty buffers
+ * for the drive are written back: after the write-back delay, when a
+ * file is closed, and before a possible media change.
+ */
+static ULONG fatdefer;              /* bit n set: defer mirror of drive n */
+static RECNO mirlo[BLKDEVNUM];      /* first record to copy */
+static RECNO mirend[BLKDEVNUM];     /* record after the last, 0 if none */
+
+/*
+ * fatmirror_defer - if mirror writes are deferred for the drive, record
+ * that FAT records 'start' to 'start+n-1' need copying and return TRUE
+ */
+static BOOL fatmirror_defer(WORD drv, RECNO start, WORD n)
+{
+    if (!stgbuf || !(fatdefer & (1UL << drv)))
+        return FALSE;
+
+    if (mirend[drv] == 0)
+    {
+        mirlo[drv] = start;
+        mirend[drv] = start + n;
+    }
+    else
+    {
+        if (start < mirlo[drv])
+            mirlo[drv] = start;
+        if (start + n > mirend[drv])
+            mirend[drv] = start + n;
+    }
+
+    return TRUE;
+}
+
+/*
+ * fatmirror_sync - copy the changed records of the primary FAT to the
+ * mirror FAT, for one drive
+ *
+ * the primary FAT on disk must be up to date, i.e. there must be no
+ * dirty FAT buffers for the drive
+ *
+ * NOTE: see flush() for the use of longjmp_rwabs()
+ */
+static void fatmirror_sync(WORD drv)
+{
+    DMD *dm = drvtbl[drv];
+    RECNO rec;
+    WORD n, maxrecs;
+
+    if (mirend[drv] == 0)
+        return;
+
+    if (dm && !dm->m_1fat)
+    {
+        maxrecs = stgsize >> dm->m_rblog;
+        for (rec = mirlo[drv]; rec < mirend[drv]; rec += n)
+        {
+            n = min(maxrecs, mirend[drv] - rec);
+            KDEBUG(("fatmirror_sync(%d): recs %ld->%ld\n",drv,(long)rec,(long)(rec+n-1)));
+            longjmp_rwabs(0, (long)stgbuf, n, rec+dm->m_recoff[BT_FAT], drv);
+            longjmp_rwabs(1, (long)stgbuf, n, rec+dm->m_recoff[BT_FAT]-dm->m_fsiz, drv);
+        }
+    }
+
+    mirend[drv] = 0;
+}
+
+/*
+ * fatmirror_discard - forget the range still to be copied for a drive
+ *
+ * this is called when the buffers of the drive are invalidated after a
+ * media change or a disk error: the range no longer matches what is in
+ * the primary FAT, which may not even be on the same disk
+ */
+void fatmirror_discard(WORD drv)
+{
+    mirend[drv] = 0;
+}
+#endif
+
+/*
+ * is_own_bcb - return TRUE iff the BCB was allocated by us
+ */
+static BOOL is_own_bcb(BCB *b)
+{
+    WORD i;
+
+    for (i = 0; i < numpools; i++)
+        if (((UBYTE *)b >= pool[i].start) && ((UBYTE *)b < pool[i].end))
+            return TRUE;
+
+    return FALSE;
+}
+
+/*
+ * unhash_bcb - remove a BCBX from its hash chain (if any)
+ */
+static void unhash_bcb(BCBX *x)
+{
+    BCBX **q;
+
+    if (x->x_hash < 0)
+        return;
+
+    for (q = &bcbhash[x->x_hash]; *q; q = &(*q)->x_hnext)
+    {
+        if (*q == x)
+        {
+            *q = x->x_hnext;
+            break;
+        }
+    }
+    x->x_hash = -1;
+}
+
+#else
+
+#define BCBSIZE     sizeof(BCB)
+#define NCESIZE     0
+
+#endif /* CONF_WITH_BDOS_CACHE */
+
+#if CONF_WITH_BDOS_PROFILE
+ULONG bufl_lookups;             /* getbcb() calls */
+ULONG bufl_misses;              /* getbcb() calls which read the record */
+#endif
+
+/*
+ * creates a chain of 'count' BCBs and corresponding buffers, each of
+ * length 'n', linked in front of 'next'; returns the first free byte
+ */
+static UBYTE *create_chain(UBYTE *p,LONG n,WORD count,BCB *next)
 {
     BCB *bcbptr;
     WORD i;
 
-    for (i = 0; i < NUMBUFS; i++, p += n) {
+    for (i = 0; i < count; i++, p += n) {
         bcbptr = (BCB *)p;
-        bzero(bcbptr,sizeof(BCB));
-        if (i < NUMBUFS-1)                  /* chain to next */
-            bcbptr->b_link = (BCB *)(p + n);
+        bzero(bcbptr,BCBSIZE);
+        bcbptr->b_link = (i < count-1) ? (BCB *)(p + n) : next;
         bcbptr->b_bufdrv = -1;              /* mark as invalid */
-        bcbptr->b_bufr = p + sizeof(BCB);
+        bcbptr->b_bufr = p + BCBSIZE;
+#if CONF_WITH_BDOS_CACHE
+        ((BCBX *)bcbptr)->x_hash = -1;
+#endif
     }
 
     return p;
 }
 
+#if CONF_WITH_BDOS_CACHE
+/*
+ * add_buffers - create 'count' buffers of length 'n' at 'p', and add
+ * them to the cache: 'nfat' of them go to the FAT list, the rest to
+ * the dir/data list
+ */
+static void add_buffers(UBYTE *p,LONG n,WORD count,WORD nfat)
+{
+    BCB *next;
+
+    pool[numpools].start = p;
+    pool[numpools].end = p + count * n;
+    numpools++;
+
+    if (nfat > 0)
+    {
+        next = bufl[BI_FAT];
+        bufl[BI_FAT] = (BCB *)p;
+        p = create_chain(p,n,nfat,next);
+    }
+
+    next = bufl[BI_DATA];
+    bufl[BI_DATA] = (BCB *)p;
+    create_chain(p,n,count-nfat,next);
+
+    KDEBUG(("BDOS cache: %d buffers at %p\n",count,pool[numpools-1].start));
+}
+
+#if CONF_WITH_ALT_RAM
+/*
+ * cache_bufs - return the number of additional buffers to create, given
+ * the amount of free memory and the length of a buffer
+ *
+ * if CONF_WITH_BDOS_NAMECACHE is set, the same memory also holds the
+ * directory name cache entries that go with each buffer
+ */
+static WORD cache_bufs(LONG freemem,LONG n)
+{
+    LONG count;
+
+    count = freemem / 100 * BDOS_CACHE_PERCENT / (n + NCESIZE);
+    if (count > BDOS_CACHE_MAXBUFS)
+        count = BDOS_CACHE_MAXBUFS;
+
+    return (WORD)count;
+}
+#endif /* CONF_WITH_ALT_RAM */
+#endif
+
 /*
  * bufl_init - BDOS buffer list initialization
  *
@@ -52,26 +295,104 @@ static void *create_chain(UBYTE *p,LONG n)
  * doesn't, and some programs that are direct-booted from a disk may
  * therefore assume that all memory from membot upwards is available
  * (I'm looking at you, Dungeon Master).
+ *
+ * for the same reason, only the fixed number of buffers is allocated
+ * here: if CONF_WITH_BDOS_CACHE is set, bufl_grow() adds the additional
+ * buffers and the staging buffer later, in Alt-RAM only.
  */
 void bufl_init(void)
 {
     UBYTE *p;
-    LONG n;
+    LONG n, size;
+    WORD count;
 
-    n = sizeof(BCB) + pun_ptr->max_sect_siz;
-    p = balloc_stram(2L*NUMBUFS*n, FALSE);
+    n = BCBSIZE + pun_ptr->max_sect_siz;
+    count = 2*NUMBUFS;
+    size = count*n;
+    p = balloc_stram(size, FALSE);
     if (!p)
-        panic("bufl_init(%ld): no memory\n",2L*NUMBUFS*n);
+        panic("bufl_init(%ld): no memory\n",size);
 
+#if CONF_WITH_BDOS_WRITEBACK || CONF_WITH_BDOS_READAHEAD
+    stgbuf = NULL;              /* allocated by bufl_grow(), if at all */
+    stgsize = 0;
+#endif
+#if CONF_WITH_BDOS_WRITEBACK
+    bufl_wbtimer = 0;
+    bufl_wbdue = FALSE;
+#endif
+
+#if CONF_WITH_BDOS_CACHE
+    numpools = 0;
+    bzero(bcbhash,sizeof(bcbhash));
+    bufl[BI_FAT] = bufl[BI_DATA] = NULL;
+    add_buffers(p,n,count,NUMBUFS);
+#else
     /* set up FAT chain */
     bufl[BI_FAT] = (BCB *)p;
-    p = create_chain(p,n);
+    p = create_chain(p,n,NUMBUFS,NULL);
 
     /* set up dir/data chain */
     bufl[BI_DATA] = (BCB *)p;
-    create_chain(p,n);
+    create_chain(p,n,NUMBUFS,NULL);
+#endif
 }
 
+#if CONF_WITH_BDOS_CACHE
+/*
+ * bufl_grow - add Alt-RAM buffers to the BDOS cache
+ *
+ * this is called after the BIOS has declared Alt-RAM via Maddalt();
+ * Alt-RAM is not subject to the restriction described for bufl_init()
+ *
+ * the staging buffer used for write-back and read-ahead is allocated
+ * here too, but only if the additional buffers could be: read-ahead
+ * needs spare buffers to read into, and batched write-back only helps
+ * when there are enough buffers for runs of dirty records.  without it,
+ * buffers are written one at a time, and there is no read-ahead.
+ */
+void bufl_grow(void)
+{
+#if CONF_WITH_ALT_RAM
+    MD *m;
+    UBYTE *p;
+    LONG n;
+    WORD count;
+
+    if (!has_alt_ram)
+        return;
+
+    /*
+     * the sector buffers are aligned on cache lines (16 bytes), which
+     * makes copying them faster on a 68030 or better
+     */
+    n = (BCBSIZE + pun_ptr->max_sect_siz + 15) & ~15L;
+    count = cache_bufs((LONG)ffit(-1L,&pmdalt),n);
+    if (count == 0)
+        return;
+
+    m = ffit_aligned(count*(n+NCESIZE)+16,&pmdalt,16L);
+    if (!m)
+        return;
+    p = m->m_start + (-BCBSIZE & 15);
+
+    add_buffers(p,n,count,count/4);
+# if CONF_WITH_BDOS_NAMECACHE
+    namecache_add((NCE *)(p+count*n),count*BDOS_NAMECACHE_PER_BUF);
+# endif
+
+# if CONF_WITH_BDOS_WRITEBACK || CONF_WITH_BDOS_READAHEAD
+    n = max(BDOS_WRITEBACK_SIZE, pun_ptr->max_sect_siz);
+    m = ffit_aligned(n,&pmdalt,16L);
+    if (!m)
+        return;
+    stgbuf = m->m_start;
+    stgsize = n;
+# endif
+#endif
+}
+#endif
+
 
 
 /*
@@ -96,7 +417,11 @@ void flush(BCB *b)
 
     /* flush to both fats */
 
-    if (n == BT_FAT && !dm->m_1fat) {
+    if (n == BT_FAT && !dm->m_1fat
+#if CONF_WITH_FATMIRROR_DEFER
+     && !fatmirror_defer(d, b->b_bufrec, 1)
+#endif
+    ) {
         longjmp_rwabs(1, (long)b->b_bufr, 1,
                       b->b_bufrec+dm->m_recoff[BT_FAT]-dm->m_fsiz, d);
     }
@@ -106,6 +431,543 @@ void flush(BCB *b)
 
 
 
+#if CONF_WITH_MEDIACH_CACHE
+/*
+ * the last time (in 200 Hz ticks) that Mediach() reported no change for
+ * each drive, and the value of blkdev_changes at that time: the result is
+ * valid while blkdev_changes is unchanged and, for removable media, for
+ * MEDIACH_CACHE_TICKS after that
+ */
+static ULONG mediach_time[BLKDEVNUM];
+static UWORD mediach_changes[BLKDEVNUM];
+static BOOL mediach_valid[BLKDEVNUM];
+
+/*
+ * bufl_mediach - Mediach(), remembering 'no change' results
+ */
+LONG bufl_mediach(WORD drv)
+{
+    LONG err;
+
+    if ((drv < 0) || (drv >= BLKDEVNUM))
+        return Mediach(drv);
+
+    if (mediach_valid[drv] && (mediach_changes[drv] == blkdev_changes))
+    {
+        if (blkdev_fixed(drv))
+            return 0L;
+        if (hz_200 - mediach_time[drv] < MEDIACH_CACHE_TICKS)
+            return 0L;
+    }
+
+    mediach_changes[drv] = blkdev_changes;
+    err = Mediach(drv);
+    mediach_valid[drv] = (err == 0);
+    mediach_time[drv] = hz_200;
+
+    return err;
+}
+#endif
+
+
+
+#if CONF_WITH_BDOS_CACHE
+/*
+ * bufl_lookup - return our BCB for the specified record, if it is cached
+ *
+ * buffers belonging to other programs are not found
+ */
+BCB *bufl_lookup(WORD drv,WORD buftype,RECNO recnum)
+{
+    BCBX *x;
+
+    for (x = bcbhash[BCBHASH(drv,buftype,recnum)]; x; x = x->x_hnext)
+        if ((x->x_bcb.b_bufdrv == drv) && (x->x_bcb.b_buftyp == buftype) && (x->x_bcb.b_bufrec == recnum))
+            return &x->x_bcb;
+
+    return NULL;
+}
+#endif
+
+
+
+#if CONF_WITH_BDOS_WRITEBACK
+/*
+ * find_dirty - return our BCB for the specified record, if it is dirty
+ */
+static BCB *find_dirty(WORD drv,WORD buftype,RECNO recnum)
+{
+    BCBX *x;
+
+    for (x = bcbhash[BCBHASH(drv,buftype,recnum)]; x; x = x->x_hnext)
+        if ((x->x_bcb.b_bufdrv == drv) && (x->x_bcb.b_buftyp == buftype) && (x->x_bcb.b_bufrec == recnum))
+            return x->x_bcb.b_dirty ? &x->x_bcb : NULL;
+
+    return NULL;
+}
+
+/*
+ * flush_run - flush the run of adjacent dirty records containing 'b'
+ *
+ * the records are copied to the staging buffer, and written by a single
+ * call to Rwabs() (two calls for FAT records, one for each FAT).  'b'
+ * must be one of our own BCBs.
+ *
+ * NOTE: see flush() for the use of longjmp_rwabs()
+ */
+static void flush_run(BCB *b)
+{
+    DMD *dm = b->b_dm;
+    WORD drv = b->b_bufdrv;
+    WORD typ = b->b_buftyp;
+    RECNO start;
+    WORD i, n, maxrecs;
+    UBYTE *p;
+
+    if (!stgbuf)
+    {
+        flush(b);
+        return;
+    }
+
+    /* find the start of the run */
+    for (start = b->b_bufrec; start > 0; start--)
+        if (!find_dirty(drv,typ,start-1))
+            break;
+
+    /* copy as much of it as will fit into the staging buffer */
+    maxrecs = stgsize >> dm->m_rblog;
+    for (n = 0, p = stgbuf; n < maxrecs; n++, p += dm->m_recsiz)
+    {
+        b = find_dirty(drv,typ,start+n);
+        if (!b)
+            break;
+        memcpy(p,b->b_bufr,dm->m_recsiz);
+    }
+
+    if (n == 1)         /* no point in using the staging buffer */
+    {
+        flush(find_dirty(drv,typ,start));
+        return;
+    }
+
+    KDEBUG(("flush_run(%d): type %d recs %ld->%ld\n",drv,typ,start,start+n-1));
+
+    longjmp_rwabs(1, (long)stgbuf, n, start+dm->m_recoff[typ], drv);
+
+    if (typ == BT_FAT && !dm->m_1fat
+#if CONF_WITH_FATMIRROR_DEFER
+     && !fatmirror_defer(drv, start, n)
+#endif
+    ) {
+        longjmp_rwabs(1, (long)stgbuf, n,
+                      start+dm->m_recoff[BT_FAT]-dm->m_fsiz, drv);
+    }
+
+    for (i = 0; i < n; i++)
+        find_dirty(drv,typ,start+i)->b_dirty = 0;
+}
+
+/*
+ * bufl_flush - write back all dirty buffers for drive 'drv', or for all
+ * drives if 'drv' is negative
+ */
+void bufl_flush(WORD drv)
+{
+    BCB *b;
+    WORD i;
+
+    if (drv < 0)
+    {
+        bufl_wbtimer = 0;
+        bufl_wbdue = FALSE;
+    }
+
+    for (i = BI_FAT; i <= BI_DATA; i++)
+    {
+        for (b = bufl[i]; b; b = b->b_link)
+        {
+            if ((b->b_bufdrv == -1) || !b->b_dirty)
+                continue;
+            if ((drv >= 0) && (b->b_bufdrv != drv))
+                continue;
+            if (is_own_bcb(b))
+                flush_run(b);
+            else
+                flush(b);
+        }
+    }
+
+#if CONF_WITH_FATMIRROR_DEFER
+    /* the primary FATs are now up to date */
+    if (drv >= 0)
+        fatmirror_sync(drv);
+    else
+        for (i = 0; i < BLKDEVNUM; i++)
+            fatmirror_sync(i);
+#endif
+}
+#endif
+
+
+#if CONF_WITH_DSYNC
+/*
+ * xsync - write back the dirty buffers of a drive
+ *
+ * Function 0x5E   d_sync (EmuTOS-specific)
+ *
+ * drv: drive number, or -1 for all drives.  drives are flushed in
+ *      order, so that the records of each are written in as few
+ *      batches as possible.
+ *
+ * returns E_OK, or EDRIVE for an invalid drive
+ */
+long xsync(int drv)
+{
+    WORD d;
+
+    if (drv >= BLKDEVNUM)
+        return EDRIVE;
+
+#if CONF_WITH_FAT32
+    fsinfo_flush(drv);
+#endif
+
+    if (drv >= 0)
+    {
+        bufl_flush(drv);
+        return E_OK;
+    }
+
+    for (d = 0; d < BLKDEVNUM; d++)
+        bufl_flush(d);
+    bufl_wbtimer = 0;
+    bufl_wbdue = FALSE;
+
+    return E_OK;
+}
+#endif
+
+
+
+#if CONF_WITH_FATMIRROR_DEFER
+/*
+ * xfatmode - get or set the FAT write mode of a drive
+ *
+ * Function 0x5D   d_fatmode (EmuTOS-specific)
+ *
+ * mode: -1 to inquire, 0 to write both FATs at once (the default),
+ *       1 to write the mirror FAT only when buffers are written back
+ *
+ * returns the previous mode, or EDRIVE for an invalid drive
+ */
+long xfatmode(int drv, int mode)
+{
+    long old;
+
+    if ((drv < 0) || (drv >= BLKDEVNUM))
+        return EDRIVE;
+
+    old = (fatdefer & (1UL << drv)) ? 1 : 0;
+
+    if (mode == 0)
+    {
+        bufl_flush(drv);        /* bring the mirror up to date */
+        fatdefer &= ~(1UL << drv);
+    }
+    else if (mode > 0)
+        fatdefer |= (1UL << drv);
+
+    return old;
+}
+#endif
+
+
+
+#if CONF_WITH_BDOS_READAHEAD
+/*
+ * bufl_readahead - read records into the cache ahead of time
+ *
+ * if data record 'recnum' is not in the cache, read it and up to
+ * count-1 following records (stopping at the first one that is already
+ * cached) into the staging buffer with a single Rwabs(), then copy them
+ * to our own buffers.  only buffers that are empty or clean are reused,
+ * and at most half of them, so read-ahead never causes writes and cannot
+ * flush the whole cache.
+ *
+ * NOTE: see flush() for the use of longjmp_rwabs()
+ */
+void bufl_readahead(DMD *dm,RECNO recnum,WORD count)
+{
+    BCB *b, *v, *victim[BDOS_READAHEAD_MAX];
+    BCBX *x;
+    WORD drv = dm->m_drvnum;
+    WORD i, nv, nown, worst, h;
+    ULONG key, worstkey;
+    UBYTE *p;
+
+    if (!stgbuf)
+        return;
+
+    count = min(count, BDOS_READAHEAD_MAX);
+    count = min(count, stgsize >> dm->m_rblog);
+
+    /* stop at the first record that is already cached in our buffers */
+    for (i = 0; i < count; i++)
+    {
+        for (x = bcbhash[BCBHASH(drv,BT_DATA,recnum+i)]; x; x = x->x_hnext)
+            if ((x->x_bcb.b_bufdrv == drv) && (x->x_bcb.b_buftyp == BT_DATA) && (x->x_bcb.b_bufrec == recnum+i))
+                break;
+        if (x)
+            break;
+    }
+    count = i;
+    if (count < 2)      /* no point: leave it to getbcb() */
+        return;
+
+    /*
+     * select the empty or least recently used clean buffers, and also
+     * stop at any record that is in a buffer belonging to another program
+     */
+    nv = nown = worst = 0;
+    worstkey = 0;
+    for (b = bufl[BI_DATA]; b; b = b->b_link)
+    {
+        if (!is_own_bcb(b))
+        {
+            if ((b->b_bufdrv == drv) && (b->b_buftyp == BT_DATA)
+             && (b->b_bufrec >= recnum) && (b->b_bufrec < recnum+count))
+                count = b->b_bufrec - recnum;
+            continue;
+        }
+        nown++;
+        if ((b->b_bufdrv != -1) && b->b_dirty)
+            continue;
+        key = (b->b_bufdrv == -1) ? 0 : ((BCBX *)b)->x_stamp;
+        if (nv < count)
+        {
+            victim[nv] = b;
+            if (key >= worstkey)
+            {
+                worstkey = key;
+                worst = nv;
+            }
+            nv++;
+            continue;
+        }
+        if (key >= worstkey)
+            continue;
+        /* replace the most recently used of the selected buffers */
+        victim[worst] = b;
+        for (i = 0, worstkey = 0; i < nv; i++)
+        {
+            v = victim[i];
+            key = (v->b_bufdrv == -1) ? 0 : ((BCBX *)v)->x_stamp;
+            if (key >= worstkey)
+            {
+                worstkey = key;
+                worst = i;
+            }
+        }
+    }
+    count = min(count, nv);
+    count = min(count, nown/2);
+    if (count < 2)
+        return;
+
+    KDEBUG(("bufl_readahead(%d): recs %ld->%ld\n",drv,recnum,recnum+count-1));
+
+    longjmp_rwabs(0, (long)stgbuf, count, recnum+dm->m_recoff[BT_DATA], drv);
+
+    /* copy the records to the selected buffers */
+    for (i = 0, p = stgbuf; i < count; i++, p += dm->m_recsiz)
+    {
+        b = victim[i];
+        x = (BCBX *)b;
+        unhash_bcb(x);
+        memcpy(b->b_bufr,p,dm->m_recsiz);
+        b->b_bufrec = recnum + i;
+        b->b_dirty = 0;
+        b->b_buftyp = BT_DATA;
+        b->b_bufdrv = drv;
+        b->b_dm = dm;
+        h = BCBHASH(drv,BT_DATA,recnum+i);
+        x->x_hash = h;
+        x->x_hnext = bcbhash[h];
+        bcbhash[h] = x;
+        x->x_stamp = ++bcb_clock;
+    }
+}
+#endif
+
+
+
+#if CONF_WITH_BDOS_WRITEBACK || CONF_WITH_BDOS_READAHEAD
+/*
+ * bufl_zero - zero data records 'recnum' to 'recnum+count-1' on disk
+ *
+ * the records are written from the zeroed staging buffer, as many at a
+ * time as will fit, rather than one at a time through the cache.  any
+ * buffer holding one of them is then zeroed too, and becomes clean.
+ *
+ * returns FALSE, having done nothing, if there is no staging buffer
+ *
+ * NOTE: see flush() for the use of longjmp_rwabs()
+ */
+BOOL bufl_zero(DMD *dm,RECNO recnum,WORD count)
+{
+    BCB *b;
+    WORD drv = dm->m_drvnum;
+    WORD n, maxrecs;
+    RECNO rec;
+
+    if (!stgbuf)
+        return FALSE;
+
+    maxrecs = min(count, stgsize >> dm->m_rblog);
+    bzero(stgbuf, (LONG)maxrecs << dm->m_rblog);
+
+    for (rec = recnum; rec < recnum+count; rec += n)
+    {
+        n = min(maxrecs, recnum+count-rec);
+        KDEBUG(("bufl_zero(%d): recs %ld->%ld\n",drv,rec,rec+n-1));
+        longjmp_rwabs(1, (long)stgbuf, n, rec+dm->m_recoff[BT_DATA], drv);
+    }
+
+    for (b = bufl[BI_DATA]; b; b = b->b_link)
+    {
+        if ((b->b_bufdrv == drv) && (b->b_buftyp == BT_DATA)
+         && (b->b_bufrec >= recnum) && (b->b_bufrec < recnum+count))
+        {
+            bzero(b->b_bufr, dm->m_recsiz);
+            b->b_dirty = 0;
+        }
+    }
+
+    return TRUE;
+}
+#endif
+
+
+
+#if CONF_WITH_BDOS_CACHE
+/*
+ * getbcb - called by getrec() to get the BCB for the desired record
+ *
+ * buftype is BT_FAT, BT_ROOT, or BT_DATA
+ *
+ * this version looks up our own buffers via the hash table.  on a miss,
+ * it scans the appropriate chain, both to find buffers that belong to
+ * other programs, and to select the buffer to reuse: the last invalid
+ * (available) buffer, or else the least recently used one.  the order of
+ * the chain is not significant.
+ */
+BCB *getbcb(DMD *dmd,WORD buftype,RECNO recnum)
+{
+    BCB *b, *mtbuf, *lru;
+    BCBX *x;
+    WORD drv = dmd->m_drvnum;
+    WORD h;
+    int err;
+
+#if CONF_WITH_BDOS_PROFILE
+    bufl_lookups++;
+#endif
+    h = BCBHASH(drv,buftype,recnum);
+
+    for (x = bcbhash[h]; x; x = x->x_hnext)
+        if ((x->x_bcb.b_bufdrv == drv) && (x->x_bcb.b_buftyp == buftype) && (x->x_bcb.b_bufrec == recnum))
+            break;
+
+    if (x)
+        b = &x->x_bcb;
+    else
+    {
+        mtbuf = lru = NULL;
+        for (b = bufl[buftype==BT_FAT ? BI_FAT : BI_DATA]; b; b = b->b_link)
+        {
+            if ((b->b_bufdrv == drv) && (b->b_buftyp == buftype) && (b->b_bufrec == recnum))
+                break;
+            if (!is_own_bcb(b))     /* we only reuse our own buffers */
+                continue;
+            if (b->b_bufdrv == -1)  /*  if buffer not valid */
+                mtbuf = b;          /*    then it's 'empty' */
+            else if (!lru || (((BCBX *)b)->x_stamp < ((BCBX *)lru)->x_stamp))
+                lru = b;
+        }
+
+        if (!b)
+        {
+            b = mtbuf ? mtbuf : lru;
+            goto doio;
+        }
+    }
+
+    /* use a buffer, but first validate media */
+    err = bufl_mediach(b->b_bufdrv);
+    if (err != 0) {
+        if (err == 1) {
+#if CONF_WITH_BDOS_WRITEBACK
+            bufl_flush(drv);    /* write back before anything is re-read */
+#endif
+            goto doio; /* media may be changed */
+        } else if (err == 2) {
+            /* media definitely changed */
+            errdrv = b->b_bufdrv;
+            rwerr = E_CHNG; /* media change */
+            errcode = rwerr;
+            longjmp(errbuf,1);
+        }
+    }
+    goto done;
+
+doio:
+    /*
+     * if the buffer is dirty, flush it, then read in the new record
+     */
+#if CONF_WITH_BDOS_PROFILE
+    bufl_misses++;
+#endif
+    if ((b->b_bufdrv != -1) && b->b_dirty)
+    {
+#if CONF_WITH_BDOS_WRITEBACK
+        if (is_own_bcb(b))
+            flush_run(b);
+        else
+#endif
+            flush(b);
+    }
+    b->b_bufdrv = -1;       /* in case longjmp_rwabs() fails */
+    if (is_own_bcb(b))
+        unhash_bcb((BCBX *)b);
+    longjmp_rwabs(0, (long)b->b_bufr, 1, recnum+dmd->m_recoff[buftype], drv);
+
+    /*
+     * make the new buffer current
+     */
+    b->b_bufrec = recnum;
+    b->b_dirty = 0;
+    b->b_buftyp = buftype;
+    b->b_bufdrv = drv;
+    b->b_dm = dmd;
+
+    if (is_own_bcb(b))
+    {
+        x = (BCBX *)b;
+        x->x_hash = h;
+        x->x_hnext = bcbhash[h];
+        bcbhash[h] = x;
+    }
+
+done:
+    if (is_own_bcb(b))
+        ((BCBX *)b)->x_stamp = ++bcb_clock;
+
+    return b;
+}
+
+#else
+
 /*
  * getbcb - called by getrec() to get the BCB for the desired record
  *
@@ -117,6 +979,9 @@ BCB *getbcb(DMD *dmd,WORD buftype,RECNO recnum)
     BCB *p, *mtbuf, **q, **phdr;
     int err;
 
+#if CONF_WITH_BDOS_PROFILE
+    bufl_lookups++;
+#endif
     mtbuf = 0;
     phdr = &bufl[buftype==BT_FAT ? BI_FAT : BI_DATA];
 
@@ -151,7 +1016,11 @@ BCB *getbcb(DMD *dmd,WORD buftype,RECNO recnum)
          * is the least recently used.
          */
 
-doio:   for (p = *(q = phdr); p->b_link; p = *(q = &p->b_link))
+doio:
+#if CONF_WITH_BDOS_PROFILE
+        bufl_misses++;
+#endif
+        for (p = *(q = phdr); p->b_link; p = *(q = &p->b_link))
             if (b == p)
                 break;
         b = p;
@@ -176,7 +1045,7 @@ doio:   for (p = *(q = phdr); p->b_link; p = *(q = &p->b_link))
     }
     else
     {   /* use a buffer, but first validate media */
-        err = Mediach(b->b_bufdrv);
+        err = bufl_mediach(b->b_bufdrv);
         if (err != 0) {
             if (err == 1) {
                 goto doio; /* media may be changed */
@@ -203,14 +1072,25 @@ doio:   for (p = *(q = phdr); p->b_link; p = *(q = &p->b_link))
 
 
 
+#endif /* CONF_WITH_BDOS_CACHE */
+
+
+
 /*
  * getrec - return the ptr to the buffer containing the desired record
+ *
+ * directory & file records on the RAM disk are returned in place, since
+ * buffering them would just copy them from one part of memory to another.
+ * the FAT is still buffered, so that both copies of it are maintained.
  */
 UBYTE *getrec(RECNO recn, OFD *of, int wrtflg)
 {
     DMD *dm = of->o_dmd;
     BCB *b;
     int n;
+#if CONF_WITH_RAMDISK
+    UBYTE *p;
+#endif
 
     KDEBUG(("getrec 0x%lx, %p, 0x%x\n",recn,dm,wrtflg));
 
@@ -223,13 +1103,28 @@ UBYTE *getrec(RECNO recn, OFD *of, int wrtflg)
 
     KDEBUG(("n=%i, dm->m_recoff[n]=0x%lx\n",n,dm->m_recoff[n]));
 
+#if CONF_WITH_RAMDISK
+    if (n != BT_FAT)
+    {
+        p = blkdev_direct(dm->m_drvnum, recn+dm->m_recoff[n]);
+        if (p)
+            return p;
+    }
+#endif
+
     b = getbcb(dm,n,recn);          /* get BCB for buffer */
 
     /*
      * if we are writing to the buffer, dirty it
      */
     if (wrtflg)
+    {
         b->b_dirty = 1;
+#if CONF_WITH_BDOS_WRITEBACK
+        if (!bufl_wbtimer)      /* start the write-back timer */
+            bufl_wbtimer = BDOS_WRITEBACK_DELAY;
+#endif
+    }
 
     return b->b_bufr;
 }
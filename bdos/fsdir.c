@@ -136,8 +136,6 @@
 
 #define ROOT_PSEUDO_CLUSTER 1   /* see comments in xrename() */
 
-#define DIR_FILE_LENGTH 0x7fffffffL     /* fake size for directories */
-
 /*
  * forward prototypes
  */
@@ -171,6 +169,166 @@ static const char dots[22] = ".          ";
  */
 static LONG freed_dnds, freed_ofds; /* count of DNDs & OFDs made available */
 
+#if CONF_WITH_DND_LRU
+/*
+ *  DND usage clock, stored in d_stamp whenever a DND is used, so that
+ *  free_available_dnds() can free the least recently used DNDs first
+ */
+static UWORD dndclock;
+static UWORD dnd_minage;        /* age of the youngest DND to free */
+static UWORD dnd_maxage;        /* age of the oldest freeable DND seen */
+#define dndtouch(p) ((p)->d_stamp = ++dndclock)
+#endif
+
+
+#if CONF_WITH_BDOS_NAMECACHE
+/*
+ *  directory name cache
+ *
+ *  this remembers the position of directory entries by directory and name,
+ *  so that scan() can find a specific name without reading the directory
+ *  from the start.  entries are made as scan() reads the directory, and
+ *  the entries themselves are allocated by bufl_init()/bufl_grow() along
+ *  with the buffer cache.  a cached position is always checked against
+ *  the directory entry at that position before it is used, so an entry
+ *  that has become stale can only cost a directory scan.
+ */
+#define NCHASH_SIZE 128     /* must be a power of 2 */
+
+static NCE *nchash[NCHASH_SIZE];
+static NCE *nchand;         /* next entry to reuse; entries form a ring */
+
+static UWORD nc_hash(DND *dnd, const char *name)
+{
+    UWORD h = (UWORD)((ULONG)dnd >> 6);
+    int i;
+
+    for (i = 0; i < FNAMELEN; i++)
+        h += (h << 3) + toupper(name[i]);
+
+    return h & (NCHASH_SIZE-1);
+}
+
+/*
+ *  nc_lookup - return ptr to the hash chain link that points to the entry
+ *      for the specified directory & name, or to the NULL at the end of
+ *      the chain
+ */
+static NCE **nc_lookup(DND *dnd, const char *name)
+{
+    NCE **q;
+
+    for (q = &nchash[nc_hash(dnd,name)]; *q; q = &(*q)->n_hnext)
+        if (((*q)->n_dnd == dnd) && (strncasecmp((*q)->n_name,name,FNAMELEN) == 0))
+            break;
+
+    return q;
+}
+
+/*
+ *  nc_find - return the position in the directory of the specified name,
+ *      or -1 if it is not cached
+ */
+static LONG nc_find(DND *dnd, const char *name)
+{
+    NCE *e = *nc_lookup(dnd,name);
+
+    return e ? e->n_pos : -1L;
+}
+
+/*
+ *  namecache_forget - remove the entry for the specified name (if any)
+ */
+void namecache_forget(DND *dnd, const char *name)
+{
+    NCE **q = nc_lookup(dnd,name);
+    NCE *e = *q;
+
+    if (e)
+    {
+        *q = e->n_hnext;
+        e->n_dnd = NULL;
+    }
+}
+
+/*
+ *  nc_enter - remember the position of a directory entry
+ */
+static void nc_enter(DND *dnd, FCB *fcb, LONG pos)
+{
+    NCE **q, *e;
+
+    if (!nchand)
+        return;
+
+    if ((fcb->f_name[0] == '.') || (fcb->f_name[0] == ERASE_MARKER)
+     || (fcb->f_attrib == FA_LFN) || (fcb->f_attrib & FA_VOL))
+        return;
+
+    q = nc_lookup(dnd,fcb->f_name);
+    if ((e = *q) == NULL)
+    {
+        /* reuse the next entry in the ring */
+        e = nchand;
+        nchand = e->n_age;
+        if (e->n_dnd)
+            namecache_forget(e->n_dnd,e->n_name);
+        q = &nchash[nc_hash(dnd,fcb->f_name)];
+        e->n_hnext = *q;
+        *q = e;
+        e->n_dnd = dnd;
+        memcpy(e->n_name,fcb->f_name,FNAMELEN);
+    }
+    e->n_pos = pos;
+}
+
+/*
+ *  namecache_add - add entries to the name cache
+ */
+void namecache_add(NCE *p, WORD count)
+{
+    NCE *e;
+
+    if (count <= 0)
+        return;
+
+    bzero(p,count*sizeof(NCE));
+    for (e = p; e < p+count-1; e++)
+        e->n_age = e + 1;
+
+    if (nchand)         /* splice into the existing ring */
+    {
+        e->n_age = nchand->n_age;
+        nchand->n_age = p;
+    }
+    else
+    {
+        e->n_age = p;
+        nchand = p;
+    }
+}
+
+/*
+ *  namecache_purge - remove the entries for a directory, or all entries
+ *      if 'dnd' is NULL
+ */
+void namecache_purge(DND *dnd)
+{
+    NCE *e;
+
+    if (!nchand)
+        return;
+
+    e = nchand;
+    do
+    {
+        if (e->n_dnd && (!dnd || (e->n_dnd == dnd)))
+            namecache_forget(e->n_dnd,e->n_name);
+        e = e->n_age;
+    } while (e != nchand);
+}
+#endif
+
 
 /*
  *  namlen - parameter points to a character string of FNAMELEN bytes max
@@ -205,13 +363,15 @@ long xmkdir(char *s)
     DFD *dfd;
     FCB *fcb1,*fcb2;
     DND *dn;
-    int h,cl,plen;
+    DMD *dm;
+    int h,plen;
     long rc;
 
     if ((h = rc = ixcreat(s,FA_SUBDIR)) < 0)
         return rc;
 
     f = getofd(h);
+    dm = f->o_dmd;
 
     /* build a DND in the tree */
     fd = f->o_dirfil;
@@ -249,9 +409,7 @@ long xmkdir(char *s)
     fcb2->f_attrib = FA_SUBDIR;
     dfd = f0->o_dfd;
     fcb2->f_td = dfd->o_td;         /* time/date are little-endian */
-    cl = dfd->o_strtcl;
-    swpw(cl);
-    fcb2->f_clust = cl;
+    fcb_setcl(fcb2, dfd->o_strtcl, dm);
     fcb2->f_fileln = 0;
     fcb2++;
 
@@ -260,26 +418,28 @@ long xmkdir(char *s)
     fcb2->f_name[1] = '.';          /* This is .. */
     fcb2->f_attrib = FA_SUBDIR;
     /* if creating a folder in the root, the parent entry needs special handling */
-    if (!fd->o_dnode)
+    if (!f->o_dnode->d_parent)
     {
         fcb2->f_td.time = 0;        /* time/date of parent must be zero */
         fcb2->f_td.date = 0;
-        fcb2->f_clust = 0;          /* cluster number is zero too */
+        fcb_setcl(fcb2, 0, dm);     /* cluster number is zero too */
     }
     else
     {
         dfd = f->o_dirfil->o_dfd;
         fcb2->f_td = dfd->o_td;     /* time/date are little-endian */
-        fcb2->f_clust = dfd->o_strtcl;
-        swpw(fcb2->f_clust);
+        fcb_setcl(fcb2, dfd->o_strtcl, dm);
     }
     fcb2->f_fileln = 0;
+#if CONF_WITH_SFT_GROW
+    ofdunhash(f);                   /* f is about to be overwritten */
+#endif
     memcpy(f, f0, sizeof(OFD));
     f->o_disk.o_flag |= O_DIRTY;    /* must set flag in f, not f0! */
     ixclose(f,CL_DIR | CL_FULL);    /* force flush and write */
     xmfreblk(f);
-    sft[h-NUMSTD].f_own = 0;
-    sft[h-NUMSTD].f_ofd = 0;
+    SFT(h-NUMSTD)->f_own = 0;
+    SFT(h-NUMSTD)->f_ofd = 0;
     return E_OK;
 }
 
@@ -303,6 +463,10 @@ long xrmdir(char *p)
     long pos;
     const char *s;
 
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+    dirchgcnt++;                /* invalidate cached directory listings */
+#endif
+
     d = findit(p,&s,1);
     if (!d)                                 /* M01.01.1214.01 */
         return EPTHNF;
@@ -366,6 +530,9 @@ long xrmdir(char *p)
         xmfreblk(d->d_ofd);
 
     d1 = d->d_parent;
+#if CONF_WITH_BDOS_NAMECACHE
+    namecache_purge(d);
+#endif
     xmfreblk(d);
 
     /*
@@ -417,6 +584,9 @@ long xchmod(char *p, int wrt, UBYTE mod)
         ixread(fd,1L,&mod);
     else
     {
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+        dirchgcnt++;            /* invalidate cached directory listings */
+#endif
         ixwrite(fd,1L,&mod);
         ixclose(fd,CL_DIR);                 /* for flush */
     }
@@ -473,7 +643,10 @@ long ixsfirst(char *name, WORD att, DTAINFO *addr)
         {
             addr->dt_offset_drive = 0L;
             addr->dt_cloffset = ofd->o_curbyt;
-            addr->dt_clnum = ofd->o_curcl;
+            addr->dt_clnum = (UWORD)ofd->o_curcl;
+#if CONF_WITH_FAT32
+            addr->dt_offset_drive = ofd->o_curcl & DTA_CLHIMASK;
+#endif
         }
         addr->dt_offset_drive |= dn->d_drv->m_drvnum & DTA_DRIVEMASK;
         addr->dt_attr = att;
@@ -554,7 +727,7 @@ static FCB *ixsnext(DTAINFO *dt)
     /*
      * determine starting point
      */
-    if ((dt->dt_cloffset == 0) && (dt->dt_clnum == 0))
+    if ((dt->dt_cloffset == 0) && (dt->dt_clnum == 0) && !IS_FAT32(dmd))
     {
         buftype = BT_ROOT;
         offset = dt->dt_offset_drive & ~DTA_DRIVEMASK;
@@ -567,6 +740,9 @@ static FCB *ixsnext(DTAINFO *dt)
         buftype = BT_DATA;
         offset = dt->dt_cloffset;       /* within cluster */
         cluster = dt->dt_clnum;
+#if CONF_WITH_FAT32
+        cluster |= dt->dt_offset_drive & DTA_CLHIMASK;
+#endif
         recnum = cl2rec(cluster,dmd) + (offset >> dmd->m_rblog);
         offset &= dmd->m_rbm;           /* within record */
     }
@@ -626,7 +802,10 @@ static FCB *ixsnext(DTAINFO *dt)
     else
     {
         dt->dt_cloffset = ((recnum&dmd->m_clrm) << dmd->m_rblog) + offset;
-        dt->dt_clnum = cluster;
+        dt->dt_clnum = (UWORD)cluster;
+#if CONF_WITH_FAT32
+        dt->dt_offset_drive = (cluster & DTA_CLHIMASK) | dmd->m_drvnum;
+#endif
     }
 
     return fcb;
@@ -665,6 +844,63 @@ long xsnext(void)
 }
 
 
+#if CONF_WITH_FSNEXTN
+/*
+ *  xsnextn - search next, returning multiple entries
+ *
+ *  Function 0x58   f_snextn (EmuTOS-specific)
+ *
+ *  continues the search started by Fsfirst(), storing up to 'count'
+ *  entries in the buffer.  the DTA is updated as for Fsnext(), so it
+ *  describes the last entry stored.
+ *
+ *  returns the number of entries stored, or:
+ *      ENMFIL  no more entries
+ *      ERANGE  invalid count
+ *      EINVFN  DTA not set up by this BDOS
+ */
+long xsnextn(FSENTRY *buf, int count)
+{
+    FCB *fcb;
+    DTAINFO *dt;
+    int n;
+
+    if (count <= 0)
+        return ERANGE;
+
+    dt = (DTAINFO *)run->p_xdta;
+
+    /* has the DTA been initialized? */
+    if (dt->dt_offset_drive < 0L)
+        return ENMFIL;
+
+    /*
+     * a GEMDOS extension that handles Fsfirst()/Fsnext() itself (such
+     * as an emulator's host drive support) may own this DTA: the control
+     * characters it stores in the private area never appear in a search
+     * name set up by ixsfirst(), so tell the caller to use Fsnext()
+     */
+    for (n = 0; n < FNAMELEN; n++)
+        if ((UBYTE)dt->dt_name[n] < ' ')
+            return EINVFN;
+
+    for (n = 0; n < count; n++, buf++)
+    {
+        fcb = ixsnext(dt);
+        if (fcb == NULL)                    /* end of directory */
+        {
+            dt->dt_offset_drive = -1L;
+            break;
+        }
+        makbuf(fcb,dt);
+        memcpy(&buf->e_attrib, &dt->dt_fattr, sizeof(FSENTRY)-1);
+    }
+
+    return n ? n : ENMFIL;
+}
+#endif
+
+
 /*
  *  xgsdtof - get/set date/time of file into or from buffer
  *
@@ -898,6 +1134,10 @@ long xrename(int n, char *p1, char *p2)
     CLNO clust;
     LONG fileln;
 
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+    dirchgcnt++;                /* invalidate cached directory listings */
+#endif
+
     if (!ixsfirst(p2,FA_SUBDIR,(DTAINFO *)0L))       /* check if new path exists */
         return EACCDN;
 
@@ -932,6 +1172,10 @@ long xrename(int n, char *p1, char *p2)
     if (fcb->f_attrib & FA_RO)
         return EACCDN;
 
+#if CONF_WITH_BDOS_NAMECACHE
+    namecache_forget(dn1,fcb->f_name);  /* the old name is going away */
+#endif
+
     /* at this point:
      *   fcb -> FCB for old path
      *   dn1->d_ofd -> OFD for the directory containing the old path
@@ -946,8 +1190,7 @@ long xrename(int n, char *p1, char *p2)
     swpw(filetime);             /* convert from little-endian format */
     filedate = fcb->f_td.date;
     swpw(filedate);
-    clust = fcb->f_clust;
-    swpw(clust);
+    clust = fcb_getcl(fcb,dmd1);
     fileln = fcb->f_fileln;
     swpl(fileln);
 
@@ -984,6 +1227,7 @@ long xrename(int n, char *p1, char *p2)
     if (strtcl1 != strtcl2)
     {
         OFD *fd2, *fdparent;
+        FCB dotdot;
 
         /*
          * prevent invalid renames such as 0 -> 0\2 or a\b -> a\b\c
@@ -1038,12 +1282,20 @@ long xrename(int n, char *p1, char *p2)
             if (!fd2->o_dnode->d_name[0])   /* empty name means root */
                 temp = 0;
             else temp = fdparent->o_dfd->o_strtcl;  /* else real start cluster */
-            swpw(temp);                     /* convert to disk format */
-            if (update_fcb(fd2,sizeof(FCB)+26,2L,(UBYTE *)&temp) < 0)
+            fcb_setcl(&dotdot,temp,dmd1);   /* convert to disk format */
+            if (update_fcb(fd2,sizeof(FCB)+26,2L,(UBYTE *)&dotdot.f_clust) < 0)
+            {
+                KDEBUG(("xrename(): can't update .. entry\n"));
+                return EINTRN;
+            }
+#if CONF_WITH_FAT32
+            if (IS_FAT32(dmd1)
+             && (update_fcb(fd2,sizeof(FCB)+20,2L,(UBYTE *)&dotdot.f_clusthi) < 0))
             {
                 KDEBUG(("xrename(): can't update .. entry\n"));
                 return EINTRN;
             }
+#endif
 
             /* set attribute for this file in parent directory */
             if (update_fcb(fdparent,fd2->o_dirbyt+FNAMELEN,1L,&att) < 0)
@@ -1054,10 +1306,13 @@ long xrename(int n, char *p1, char *p2)
         }
         dfd->o_flag |= O_DIRTY;
         if (att&FA_SUBDIR) {
+#if CONF_WITH_SFT_GROW
+            ofdunhash(fd2);
+#endif
             ixclose(fd2,CL_DIR|CL_FULL);    /* force flush & write */
             xmfreblk(fd2);                  /* free OFD */
-            sft[hnew-NUMSTD].f_own = 0;     /* free handle */
-            sft[hnew-NUMSTD].f_ofd = 0;
+            SFT(hnew-NUMSTD)->f_own = 0;    /* free handle */
+            SFT(hnew-NUMSTD)->f_ofd = 0;
         } else xclose(hnew);
         ixclose(fdparent,CL_DIR);
     }
@@ -1240,7 +1495,8 @@ long xgetdir(char *buf, int drv)
 
 
 /*
- *  dirinit -
+ *  dirinit - zero the current cluster of a directory, and return a
+ *  pointer to its first record, which is dirty in the cache
  */
 /* dn: dir descr for dir */
 FCB *dirinit(DND *dn)
@@ -1254,12 +1510,23 @@ FCB *dirinit(DND *dn)
 
     fd = dn->d_ofd;                                 /*  OFD for dir */
     num = (dm = fd->o_dmd)->m_recsiz;               /*  bytes/rec   */
+    i2 = 1;
+
+#if CONF_WITH_BDOS_WRITEBACK || CONF_WITH_BDOS_READAHEAD
+    /*
+     *  zero the records of the current cluster, besides the first record,
+     *  directly on disk if we can: with large clusters, going through the
+     *  cache would read and write each record separately
+     */
+    if ((dm->m_clsiz > 1) && bufl_zero(dm, fd->o_currec+1, dm->m_clsiz-1))
+        i2 = dm->m_clsiz;
+#endif
 
     /*
-     *  for each record in the current cluster, besides the first record,
-     *  get the record and zero it out
+     *  for each remaining record in the current cluster, get the record
+     *  and zero it out
      */
-    for (i2 = 1; i2 < dm->m_clsiz; i2++)
+    for ( ; i2 < dm->m_clsiz; i2++)
     {
         KDEBUG(("dirinit i2 = %li\n",i2));
         s1 = getrec(fd->o_currec+i2,fd,1);
@@ -1474,6 +1741,11 @@ DND *findit(char *name, const char **sp, int dflag)
                 p = newp;
         }
 
+#if CONF_WITH_DND_LRU
+        if (p)
+            dndtouch(p);
+#endif
+
     scanxt:
     if (*(n = n + i))
         n++;
@@ -1518,6 +1790,10 @@ FCB *scan(DND *dnd, const char *n, WORD att, LONG *posp)
     OFD *fd;
     DND *dnd1;
     BOOL m;                 /*  T: found a matching FCB             */
+#if CONF_WITH_BDOS_NAMECACHE
+    LONG pos;
+    int i;
+#endif
 
     KDEBUG(("scan(%p,'%s',0x%x,%p)\n",dnd,n,att,posp));
 
@@ -1534,6 +1810,37 @@ FCB *scan(DND *dnd, const char *n, WORD att, LONG *posp)
     if (!(fd = dnd->d_ofd))
         fd = makofd(dnd);   /* makofd() also updates dnd->d_ofd */
 
+#if CONF_WITH_BDOS_NAMECACHE
+    /*
+     *  if we're looking for a specific name from the beginning of the
+     *  directory, try the name cache first
+     */
+    if (((*posp == 0) || (*posp == -1)) && (name[0] != '.') && (name[0] != ERASE_MARKER))
+    {
+        for (i = 0; i < FNAMELEN; i++)
+            if (name[i] == '?')
+                break;
+        if ((i == FNAMELEN) && ((pos = nc_find(dnd,name)) >= 0))
+        {
+            if ((ixlseek(fd,pos) == pos) && (fcb = ixgetfcb(fd))
+             && (strncasecmp(name,fcb->f_name,FNAMELEN) == 0))
+            {
+                m = match(name, fcb->f_name);
+                if (m && (fcb->f_attrib & FA_SUBDIR))
+                {
+                    dnd1 = getdnd(&fcb->f_name[0], dnd);
+                    if (!dnd1)
+                        dnd1 = makdnd(dnd,fcb);   /* always succeeds */
+                }
+                if (m)
+                    goto found;
+            }
+            else
+                namecache_forget(dnd,name);    /* stale */
+        }
+    }
+#endif
+
     /*
      *  seek to desired starting position.  If posp == -1, then start at
      *  the beginning.
@@ -1559,10 +1866,17 @@ FCB *scan(DND *dnd, const char *n, WORD att, LONG *posp)
                 dnd1 = makdnd(dnd,fcb);   /* always succeeds */
         }
 
+#if CONF_WITH_BDOS_NAMECACHE
+        nc_enter(dnd,fcb,fd->o_bytnum - sizeof(FCB));
+#endif
+
         if ((m = match(name, fcb->f_name)))
              break;
     }
 
+#if CONF_WITH_BDOS_NAMECACHE
+found:
+#endif
     KDEBUG(("\n   scan(pos=%ld DND=%p DNDfoundFile=%p name=%s name=%s, %d)",
             (long)fd->o_bytnum,dnd,dnd1,fcb?fcb->f_name:"(null)",name,m));
 
@@ -1598,14 +1912,30 @@ FCB *scan(DND *dnd, const char *n, WORD att, LONG *posp)
  */
 static DND *makdnd(DND *p, FCB *fcb)
 {
-    DIRTBL_ENTRY *dt;
     DND *p1;
-    DND **prev;
     OFD *fd;
+#if CONF_WITH_DND_LRU
+    UWORD flag;
+#else
+    DIRTBL_ENTRY *dt;
+    DND **prev;
     int i;
+#endif
 
     fd = p->d_ofd;
 
+#if CONF_WITH_DND_LRU
+    /*
+     *  rather than recycling a sibling, keep it cached, and free the
+     *  least recently used DNDs if there are too many.  we mustn't let
+     *  the parent be freed, here or by MGET() below!
+     */
+    p1 = NULL;
+    flag = p->d_flag;
+    p->d_flag |= DND_LOCKED;
+    if (osmem_used(MEMTYPE_DND) >= DND_CACHE_MAX)
+        free_available_dnds();
+#else
     /*
      *  scavenge a DND at this level if we can find one that has not
      *  d_left
@@ -1634,10 +1964,14 @@ static DND *makdnd(DND *p, FCB *fcb)
                 p1->d_files = (OFD *) 0;
                 if (p1->d_ofd)
                     xmfreblk(p1->d_ofd);
+#if CONF_WITH_BDOS_NAMECACHE
+                namecache_purge(p1);
+#endif
                 break;
             }
         }
     }
+#endif
 
     /* we didn't find one that qualifies, so allocate a new one */
 
@@ -1652,18 +1986,23 @@ static DND *makdnd(DND *p, FCB *fcb)
         p->d_left = p1;
         p1->d_parent = p;
     }
+#if CONF_WITH_DND_LRU
+    p->d_flag = flag;           /* restore the lock state */
+#endif
 
     /* complete the initialization */
 
     p1->d_ofd = (OFD *) 0;
-    p1->d_strtcl = fcb->f_clust;
-    swpw(p1->d_strtcl);
+    p1->d_strtcl = fcb_getcl(fcb,p->d_drv);
     p1->d_drv = p->d_drv;
     p1->d_dirfil = fd;
     p1->d_dirpos = fd->o_bytnum - sizeof(FCB);
     p1->d_td.time = fcb->f_td.time; /* note: DND time/date are  */
     p1->d_td.date = fcb->f_td.date; /*  actually little-endian! */
     memcpy(p1->d_name, fcb->f_name, FNAMELEN);
+#if CONF_WITH_DND_LRU
+    dndtouch(p1);
+#endif
 
     KDEBUG(("\n makdnd(%p)",p1));
 
@@ -1896,6 +2235,9 @@ static void freednd(DND *dn)                    /* M01.01.1031.02 */
     while (dn->d_left) {            /* is this step really necessary? */
         freednd(dn->d_left);
     }
+#if CONF_WITH_BDOS_NAMECACHE
+    namecache_purge(dn);
+#endif
     xmfreblk(dn);                   /* finally free this DND */
 }
 
@@ -1948,6 +2290,9 @@ static void process_dnd_tree(DND *dndstart)
     DND *dnd, *prev;
     DIRTBL_ENTRY *dt;
     WORD i;
+#if CONF_WITH_DND_LRU
+    UWORD age;
+#endif
 
     /*
      * follow the sibling chain
@@ -2007,6 +2352,19 @@ static void process_dnd_tree(DND *dndstart)
             continue;
         }
 
+#if CONF_WITH_DND_LRU
+        /*
+         * not locked - but has it been used recently?
+         */
+        age = dndclock - dnd->d_stamp;
+        if (age > dnd_maxage)
+            dnd_maxage = age;
+        if (age < dnd_minage) {
+            prev = dnd;
+            continue;
+        }
+#endif
+
         /*
          * we've got a freeable DND
          *
@@ -2027,6 +2385,9 @@ static void process_dnd_tree(DND *dndstart)
             xmfreblk(dnd->d_ofd);
             freed_ofds++;
         }
+#if CONF_WITH_BDOS_NAMECACHE
+        namecache_purge(dnd);
+#endif
         xmfreblk(dnd);
         freed_dnds++;
     }
@@ -2034,22 +2395,13 @@ static void process_dnd_tree(DND *dndstart)
 
 
 /*
- * the following routine is called (by xmgetblk() in osmem.c) when we
- * cannot get memory for a DND or OFD.  it calls process_dnd_tree() to
- * free up DNDs that are not absolutely required (this is the same idea
- * as the "scavenge" procedure in makdnd() above).
+ * process the DND trees of all DMDs
  */
-WORD free_available_dnds(void)
+static void process_all_dnd_trees(void)
 {
     DMD *dmd;
     WORD i;
 
-    KDEBUG(("free_available_dnds() called\n"));
-    freed_dnds = freed_ofds = 0L;
-
-    /*
-     * process all DMDs
-     */
     for (i = 0; i < BLKDEVNUM; i++) {
         dmd = drvtbl[i];
         if (!dmd)
@@ -2057,6 +2409,32 @@ WORD free_available_dnds(void)
         if (dmd->m_dtl)
             process_dnd_tree(dmd->m_dtl);
     }
+}
+
+
+/*
+ * the following routine is called (by xmgetblk() in osmem.c) when we
+ * cannot get memory for a DND or OFD.  it calls process_dnd_tree() to
+ * free up DNDs that are not absolutely required (this is the same idea
+ * as the "scavenge" procedure in makdnd() above).
+ *
+ * with CONF_WITH_DND_LRU, it is also called by makdnd() when there are
+ * too many DNDs, and only frees the least recently used half of them:
+ * the first pass just finds the age of the oldest one (and frees any
+ * that are as old as they can be).
+ */
+WORD free_available_dnds(void)
+{
+    KDEBUG(("free_available_dnds() called\n"));
+    freed_dnds = freed_ofds = 0L;
+
+#if CONF_WITH_DND_LRU
+    dnd_minage = 0xffff;
+    dnd_maxage = 0;
+    process_all_dnd_trees();
+    dnd_minage = dnd_maxage / 2;
+#endif
+    process_all_dnd_trees();
 
     KDEBUG(("freed %ld DNDs, %ld OFDs\n",freed_dnds,freed_ofds));
     return freed_dnds+freed_ofds;
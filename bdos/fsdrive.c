@@ -38,6 +38,7 @@
 #include "biosbind.h"
 #include "bdosstub.h"
 #include "biosext.h"
+#include "intmath.h"
 
 
 /*
@@ -58,6 +59,15 @@ DIRTBL_ENTRY dirtbl[NCURDIR];
  */
 LONG    drvsel;
 
+#if CONF_WITH_DREADAHEAD
+/*
+ **     raheadset - bit n set: the read-ahead limit of drive n has been
+ **         set by Dreadahead(), and is in rahead[n]
+ */
+static ULONG raheadset;
+static UBYTE rahead[BLKDEVNUM];
+#endif
+
 
 /*
  *  ckdrv - check the drive, see if it needs to be logged in.
@@ -172,6 +182,26 @@ static int log2ul(unsigned long n)
 }
 
 
+#if CONF_WITH_BDOS_READAHEAD
+/*
+ * rahead_limit - return the number of records to read ahead on drive 'drv'
+ */
+static UBYTE rahead_limit(int drv)
+{
+#if CONF_WITH_DREADAHEAD
+    if (raheadset & (1UL << drv))
+        return rahead[drv];
+#endif
+#if CONF_WITH_RAMDISK
+    if (blkdev_direct(drv, 0L))         /* nothing to gain on RAM disk */
+        return 0;
+#endif
+
+    return (drv < 2) ? BDOS_READAHEAD_FLOPPY : BDOS_READAHEAD_DISK; /* A: & B: are floppies */
+}
+#endif
+
+
 /*
 **      log_media -
 **          log in media 'b' on drive 'drv'.
@@ -187,21 +217,46 @@ WORD log_media(BPB *b, int drv)
     DFD *dfd;
     DND *d;
     DMD *dm;
-    unsigned long rsiz, cs, n, fs;
+    unsigned long rsiz, cs, n, fs, fatrec, datrec, numcl;
 
     rsiz = b->recsiz;
     cs = b->clsiz;
     n = b->rdlen;
     fs = b->fsiz;
+    fatrec = b->fatrec;
+    datrec = b->datrec;
+    numcl = b->numcl;
+#if CONF_WITH_FAT32
+    if (b->b_flags & B_32)      /* the real values follow the BPB */
+    {
+        const BPBEXT *x = &((const BPB32 *)b)->x;
+
+        fs = x->fsiz;
+        fatrec = x->fatrec;
+        datrec = x->datrec;
+        numcl = x->numcl;
+    }
+#endif
 
     KDEBUG(("log_media(%p,%i) rsiz=0x%lx, cs=0x%lx, n=0x%lx, fs=0x%lx\n",
             b,drv,rsiz,cs,n,fs));
 
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+    dirchgcnt++;                /* new media: invalidate cached listings */
+#endif
+
     if (fs == 0)
     {
         KDEBUG(("Warning: Trying to access a FAT32 partition?\n"));
         return EDRIVE;
     }
+#if CONF_WITH_FAT32
+    if (fs > 0xffffUL)          /* m_fsiz is 16 bits */
+    {
+        KDEBUG(("FAT size %lu is too large\n",fs));
+        return EDRIVE;
+    }
+#endif
 
     if (!(dm = getdmd(drv)))
         return ENSMEM;
@@ -220,17 +275,34 @@ WORD log_media(BPB *b, int drv)
     dm->m_clsiz = cs;                   /*  set cluster size in sectors */
     dm->m_clsizb = b->clsizb;           /*    and in bytes              */
     dm->m_recsiz = rsiz;                /*  set record (sector) size    */
-    dm->m_numcl = b->numcl;             /*  set cluster size in records */
+    dm->m_numcl = numcl;                /*  set number of clusters      */
     dm->m_clrlog = log2ul(cs);          /*    and log of it             */
     dm->m_clrm = (1L<<dm->m_clrlog)-1;  /*      and mask of it          */
     dm->m_rblog = log2ul(rsiz);         /*  set log of bytes/record     */
     dm->m_rbm = (1L<<dm->m_rblog)-1;    /*    and mask of it            */
     dm->m_clblog = log2ul(dm->m_clsizb);/*  log of bytes/clus           */
     dm->m_clbm = (1L<<dm->m_clblog)-1;  /*    and mask of it            */
+#if CONF_WITH_BDOS_READAHEAD
+    dm->m_rahead = rahead_limit(drv);   /*  nbr of records to read ahead */
+#endif
 
     f->o_dfd = dfd = &f->o_disk;
     dfd->o_fileln = n * rsiz;           /*  size of file (root dir)     */
     d->d_strtcl = dfd->o_strtcl = 2;    /*  root start pseudo-cluster   */
+#if CONF_WITH_FAT32
+    /*
+     * the FAT32 root directory is a cluster chain like any other directory.
+     * a non-NULL o_dnode is what tells the rest of the BDOS this, so we make
+     * it point to the root DND itself (which has no parent).
+     */
+    if (b->b_flags & B_32)
+    {
+        dm->m_32 = 1;                   /*  FSInfo is read on first use */
+        f->o_dnode = d;
+        dfd->o_fileln = DIR_FILE_LENGTH;
+        d->d_strtcl = dfd->o_strtcl = ((const BPB32 *)b)->x.rootcl;
+    }
+#endif
 
     fo = dm->m_fatofd;                  /*  OFD for 'fat file'          */
     fo->o_dmd = dm;                     /*  link with DMD               */
@@ -238,12 +310,58 @@ WORD log_media(BPB *b, int drv)
     dfd->o_fileln = fs * rsiz;          /*  FAT size                    */
     dfd->o_strtcl = 2;                  /*  FAT start pseudo-cluster    */
 
-    dm->m_recoff[BT_FAT] = (RECNO)b->fatrec;
-    dm->m_recoff[BT_ROOT] = (RECNO)b->fatrec + fs;
-    dm->m_recoff[BT_DATA] = (RECNO)b->datrec;
+    dm->m_recoff[BT_FAT] = (RECNO)fatrec;
+    dm->m_recoff[BT_ROOT] = (RECNO)fatrec + fs;
+    dm->m_recoff[BT_DATA] = (RECNO)datrec;
+#if CONF_WITH_FAT32
+    if (dm->m_32)       /* BT_ROOT is used for the FSInfo record, see fsfat.c */
+        dm->m_recoff[BT_ROOT] = (rsiz >= 512) ? ((const BPB32 *)b)->x.fsinfo : 0;
+#endif
 
     KDEBUG(("log_media(%i) dm->m_recoff[0-2] = 0x%lx/0x%lx/0x%lx\n",
             drv, dm->m_recoff[0],dm->m_recoff[1],dm->m_recoff[2]));
 
     return E_OK;
 }
+
+
+#if CONF_WITH_DREADAHEAD
+/*
+ * xreadahead - get or set the read-ahead limit of a drive
+ *
+ * Function 0x60   d_readahead (EmuTOS-specific)
+ *
+ * count: -1 to inquire, -2 to go back to the default limit, otherwise
+ *        the number of records to read ahead (0 disables read-ahead),
+ *        up to BDOS_READAHEAD_MAX.  the setting applies immediately if
+ *        the drive is logged in, and is kept across media changes.
+ *
+ * returns the previous limit, or EDRIVE for an invalid drive
+ */
+long xreadahead(int drv, int count)
+{
+    DMD *dm;
+    long old;
+
+    if ((drv < 0) || (drv >= BLKDEVNUM))
+        return EDRIVE;
+
+    dm = drvtbl[drv];
+    old = dm ? dm->m_rahead : rahead_limit(drv);
+
+    if (count == -2)
+        raheadset &= ~(1UL << drv);
+    else if (count >= 0)
+    {
+        rahead[drv] = min(count, BDOS_READAHEAD_MAX);
+        raheadset |= (1UL << drv);
+    }
+    else
+        return old;
+
+    if (dm)
+        dm->m_rahead = rahead_limit(drv);
+
+    return old;
+}
+#endif
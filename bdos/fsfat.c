@@ -15,6 +15,8 @@
 #include "fs.h"
 #include "gemerror.h"
 #include "bdosstub.h"
+#include "mem.h"
+#include "string.h"
 
 /*
 **  cl2rec -
@@ -26,6 +28,497 @@ RECNO cl2rec(CLNO cl, DMD *dm)
 }
 
 
+/*
+ * fcb_getcl - get the starting cluster from a directory entry
+ */
+CLNO fcb_getcl(const FCB *f, DMD *dm)
+{
+    UWORD lo = f->f_clust;
+#if CONF_WITH_FAT32
+    UWORD hi = f->f_clusthi;
+#endif
+
+    swpw(lo);
+#if CONF_WITH_FAT32
+    if (IS_FAT32(dm))
+    {
+        swpw(hi);
+        return MAKE_ULONG(hi,lo);
+    }
+#else
+    UNUSED(dm);
+#endif
+
+    return lo;
+}
+
+
+/*
+ * fcb_setcl - set the starting cluster in a directory entry
+ */
+void fcb_setcl(FCB *f, CLNO cl, DMD *dm)
+{
+    UWORD w = (UWORD)cl;
+
+    swpw(w);
+    f->f_clust = w;
+#if CONF_WITH_FAT32
+    if (IS_FAT32(dm))
+    {
+        w = (UWORD)(cl >> 16);
+        swpw(w);
+        f->f_clusthi = w;
+    }
+#else
+    UNUSED(dm);
+#endif
+}
+
+
+/*
+ * for FAT16 and FAT32, the FAT entries are aligned and cannot span
+ * FAT records, so whole FAT records can be scanned quickly
+ */
+#define FAT_ALIGNED(dm)     ((dm)->m_16 || IS_FAT32(dm))
+#define FATENT_LOG(dm)      (IS_FAT32(dm) ? 2 : 1)  /* log2 of entry size */
+#if CONF_WITH_FAT32
+/* the top 4 bits of a FAT32 entry (in the last byte) are reserved */
+#define FATENT_FREE(dm,p)   (IS_FAT32(dm) ? ((ULONG_AT(p) & 0xffffff0fUL) == 0) : (*(UWORD *)(p) == 0))
+#else
+#define FATENT_FREE(dm,p)   (*(UWORD *)(p) == 0)
+#endif
+
+/*
+ * fatoffset - return the byte offset of the entry for 'cl' within the FAT
+ */
+static LONG fatoffset(CLNO cl, DMD *dm)
+{
+    if (FAT_ALIGNED(dm))
+        return (LONG)cl << FATENT_LOG(dm);
+
+    return (LONG)cl + (cl >> 1);
+}
+
+
+#if CONF_WITH_FAT32
+/*
+ * FSInfo record of a FAT32 filesystem
+ *
+ * this holds the number of free clusters and a hint for the search for
+ * the next free cluster; either may be 0xffffffff (unknown) or wrong.
+ * since FAT32 has no fixed root directory, the FSInfo record is accessed
+ * as record 0 of the BT_ROOT area; m_recoff[BT_ROOT] is 0 if there is no
+ * valid FSInfo record.
+ *
+ * the hints are read on first use rather than when the drive is logged
+ * in, so that a read error is handled like any other.  they are updated
+ * in memory as clusters are allocated and freed, and only written back
+ * by fsinfo_flush(), just before the dirty buffers are written.
+ */
+#define FSI_LEADSIG     0       /* offset of lead signature */
+#define FSI_STRUCSIG    484     /* offset of structure signature */
+#define FSI_FREE        488     /* offset of free cluster count */
+#define FSI_NEXT        492     /* offset of next free cluster hint */
+
+#define FSI_LEADSIG_VAL     0x41615252UL
+#define FSI_STRUCSIG_VAL    0x61417272UL
+#define FSINFO_UNKNOWN      0xffffffffUL
+
+/*
+ * the hints for each drive, valid if M32_FSINFO is set in m_32 (they
+ * are kept here because the DMD is full)
+ */
+static struct
+{
+    CLNO free;          /* number of free clusters, or FSINFO_UNKNOWN */
+    CLNO next;          /* where to start looking for a free cluster */
+} fsinfo[BLKDEVNUM];
+
+#define FS_FREE(dm)     (fsinfo[(dm)->m_drvnum].free)
+#define FS_NEXT(dm)     (fsinfo[(dm)->m_drvnum].next)
+
+static ULONG fsinfo_get(const UBYTE *buf, WORD offset)
+{
+    ULONG n = ULONG_AT(buf+offset);
+
+    swpl(n);
+    return n;
+}
+
+static void fsinfo_put(UBYTE *buf, WORD offset, ULONG n)
+{
+    swpl(n);
+    ULONG_AT(buf+offset) = n;
+}
+
+/*
+ * fsinfo_load - get the hints from the FSInfo record, if not already done
+ */
+static void fsinfo_load(DMD *dm)
+{
+    UBYTE *buf;
+    ULONG n;
+
+    if (dm->m_32 & M32_FSINFO)  /* already done */
+        return;
+
+    dm->m_32 |= M32_FSINFO;
+    FS_FREE(dm) = FSINFO_UNKNOWN;
+    FS_NEXT(dm) = 2;
+    if (!dm->m_recoff[BT_ROOT])
+        return;
+
+    buf = getbcb(dm,BT_ROOT,0)->b_bufr;
+    if ((fsinfo_get(buf,FSI_LEADSIG) != FSI_LEADSIG_VAL)
+     || (fsinfo_get(buf,FSI_STRUCSIG) != FSI_STRUCSIG_VAL))
+    {
+        KDEBUG(("fsinfo_load(%d): invalid FSInfo record\n",dm->m_drvnum));
+        dm->m_recoff[BT_ROOT] = 0;
+        return;
+    }
+
+    n = fsinfo_get(buf,FSI_FREE);
+    if (n <= dm->m_numcl)
+        FS_FREE(dm) = n;
+    n = fsinfo_get(buf,FSI_NEXT);
+    if ((n >= 2) && (n < dm->m_numcl+2))
+        FS_NEXT(dm) = n;
+    KDEBUG(("fsinfo_load(%d): free=%lu, next=%lu\n",dm->m_drvnum,FS_FREE(dm),FS_NEXT(dm)));
+}
+
+/*
+ * fsinfo_update - copy the current hints to the buffer of the FSInfo record
+ */
+static void fsinfo_update(DMD *dm)
+{
+    BCB *b;
+
+    dm->m_32 &= ~M32_FSDIRTY;
+    if (!dm->m_recoff[BT_ROOT])
+        return;
+
+    b = getbcb(dm,BT_ROOT,0);
+    fsinfo_put(b->b_bufr,FSI_FREE,FS_FREE(dm));
+    fsinfo_put(b->b_bufr,FSI_NEXT,FS_NEXT(dm));
+    b->b_dirty = 1;
+}
+
+/*
+ * fsinfo_flush - update the FSInfo record of drive 'drv', or of all
+ * drives if 'drv' is negative, if the hints have changed
+ *
+ * this must be called before the dirty buffers are written, and not
+ * while the caller is using a buffer, since it may reuse one
+ */
+void fsinfo_flush(WORD drv)
+{
+    DMD *dm;
+    WORD i;
+
+    for (i = 0; i < BLKDEVNUM; i++)
+    {
+        if ((drv >= 0) && (i != drv))
+            continue;
+        dm = drvtbl[i];
+        if (dm && (dm->m_32 & M32_FSDIRTY))
+            fsinfo_update(dm);
+    }
+}
+#endif
+
+
+#if CONF_WITH_BDOS_FREEMAP
+/*
+ * free cluster bitmap
+ *
+ * bit n of the bitmap is set iff cluster n is free; the bitmap has
+ * entries for clusters 0 & 1, which are never free.  m_fbnext is a
+ * hint: no cluster below it is free.  it is zero until the bitmap has
+ * been completely built.
+ */
+#define FB_ISFREE(map,cl)   ((map)[(cl)>>3] & (1 << ((cl)&7)))
+#define FB_SETFREE(map,cl)  ((map)[(cl)>>3] |= (1 << ((cl)&7)))
+#define FB_SETUSED(map,cl)  ((map)[(cl)>>3] &= ~(1 << ((cl)&7)))
+
+/*
+ * freemap_setfree - mark a cluster as free in a valid bitmap
+ */
+static void freemap_setfree(CLNO cl, DMD *dm)
+{
+    if (!FB_ISFREE(dm->m_fbmap,cl))
+    {
+        FB_SETFREE(dm->m_fbmap,cl);
+        dm->m_fbfree++;
+        if (cl < dm->m_fbnext)
+            dm->m_fbnext = cl;
+    }
+}
+
+/*
+ * freemap_build - build the bitmap for a drive, if not already done
+ *
+ * returns FALSE if there is no bitmap (not enough memory)
+ */
+static BOOL freemap_build(DMD *dm)
+{
+    UBYTE *map;
+    CLNO cl;
+
+    if (dm->m_fbnext)       /* already built */
+        return TRUE;
+
+#if CONF_WITH_FAT32
+    if (IS_FAT32(dm))
+        fsinfo_load(dm);    /* so that the count below is not overwritten */
+#endif
+
+    /*
+     * if a previous build was interrupted by a disk error, the bitmap
+     * is already allocated
+     */
+    map = dm->m_fbmap;
+    if (!map)
+    {
+        map = xmsysalloc(((LONG)dm->m_numcl+2+7) >> 3);
+        if (!map)
+            return FALSE;
+        dm->m_fbmap = map;
+    }
+    bzero(map,((LONG)dm->m_numcl+2+7) >> 3);
+
+    dm->m_fbfree = 0;
+    for (cl = 2; cl < dm->m_numcl+2; )
+    {
+        if (FAT_ALIGNED(dm))    /* fast scan of a whole FAT record at a time */
+        {
+            WORD entlog = FATENT_LOG(dm);
+            WORD offset = ((LONG)cl << entlog) & dm->m_rbm;
+            UBYTE *buf = getrec(((LONG)cl << entlog) >> dm->m_rblog, dm->m_fatofd, 0);
+
+            for ( ; (offset < dm->m_recsiz) && (cl < (dm->m_numcl+2)); offset += 1 << entlog, cl++)
+            {
+                if (FATENT_FREE(dm,buf+offset))
+                {
+                    FB_SETFREE(map,cl);
+                    dm->m_fbfree++;
+                }
+            }
+            continue;
+        }
+        if (!getrealcl(cl,dm))
+        {
+            FB_SETFREE(map,cl);
+            dm->m_fbfree++;
+        }
+        cl++;
+    }
+    dm->m_fbnext = 2;       /* mark as built */
+    KDEBUG(("freemap_build(%d): %lu free clusters\n",dm->m_drvnum,(ULONG)dm->m_fbfree));
+#if CONF_WITH_FAT32
+    if (IS_FAT32(dm))
+        FS_FREE(dm) = dm->m_fbfree;    /* correct the FSInfo count */
+#endif
+
+    return TRUE;
+}
+
+/*
+ * freemap_discard - discard the bitmap for a drive (on media change)
+ */
+void freemap_discard(DMD *dm)
+{
+    if (dm->m_fbmap)
+    {
+        xmfree(dm->m_fbmap);
+        dm->m_fbmap = NULL;
+        dm->m_fbnext = 0;
+    }
+}
+
+/*
+ * freemap_find - find a free cluster via the bitmap
+ *
+ * the search starts at 'cl' (or at the hint, if that is higher) and
+ * wraps around; returns cluster number, or 0 if no free clusters
+ */
+static CLNO freemap_find(CLNO cl, DMD *dm)
+{
+    UBYTE *map = dm->m_fbmap;
+    ULONG n, start, end;
+    WORD pass;
+
+    if (dm->m_fbfree == 0)
+        return 0;
+
+    if (cl < dm->m_fbnext)
+        cl = dm->m_fbnext;
+
+    /* search from 'cl' to the end, then from the hint up to 'cl' */
+    start = cl;
+    end = (ULONG)dm->m_numcl + 2;
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (n = start; n < end; )
+        {
+            if (((n & 7) == 0) && (map[n>>3] == 0))
+            {
+                n += 8;             /* skip 8 used clusters at once */
+                continue;
+            }
+            if (FB_ISFREE(map,n))
+            {
+                if (start == dm->m_fbnext)
+                    dm->m_fbnext = n;
+                return (CLNO)n;
+            }
+            n++;
+        }
+        start = dm->m_fbnext;
+        end = cl;
+    }
+
+    return 0;
+}
+#endif
+
+
+#if CONF_WITH_BDOS_EXTENTS
+/*
+ * cluster chain extent maps
+ *
+ * an extent map records the layout of a file's cluster chain as a list
+ * of runs of contiguous clusters.  it is identified by the drive and
+ * the starting cluster, so it is shared by all OFDs for the same file.
+ * the map only ever covers a prefix of the chain, so it stays valid when
+ * the file grows; it is discarded when the chain is freed, or on media
+ * change.
+ */
+typedef struct
+{
+    CLNO  x_fcl;        /* index of first cluster of run within file */
+    CLNO  x_dcl;        /* first cluster of run on disk */
+    CLNO  x_len;        /* number of clusters in run */
+} EXTENT;
+
+typedef struct
+{
+    DMD    *x_dmd;      /* drive, or NULL if unused */
+    CLNO   x_strtcl;    /* starting cluster of file */
+    WORD   x_count;     /* number of extents in use */
+    ULONG  x_stamp;     /* time of last use, for LRU replacement */
+    EXTENT x_ext[BDOS_EXTENTS_PER_MAP];
+} EXTMAP;
+
+static EXTMAP extmap[BDOS_EXTENT_MAPS];
+static ULONG extmap_clock;
+
+/*
+ * extent_discard - discard the extent map(s) for a drive
+ *
+ * if 'strtcl' is zero, all maps for the drive are discarded; otherwise
+ * only the map for the file starting at that cluster
+ */
+void extent_discard(DMD *dm, CLNO strtcl)
+{
+    EXTMAP *m;
+
+    for (m = extmap; m < extmap+BDOS_EXTENT_MAPS; m++)
+        if ((m->x_dmd == dm) && (!strtcl || (m->x_strtcl == strtcl)))
+            m->x_dmd = NULL;
+}
+
+/*
+ * extent_getcl - get the disk cluster holding a given cluster of a file
+ *
+ * 'idx' is the index of the cluster within the file (0 = first cluster).
+ * the map is extended along the FAT chain as far as required.  if
+ * 'runlen' is not NULL, it is set to the number of clusters, starting
+ * with the one returned, that are known to be contiguous on disk (or to
+ * zero if no cluster is returned).
+ *
+ * returns
+ *      the cluster number, or
+ *      ENDOFCHAIN if the chain is shorter than 'idx' clusters, or
+ *      0 if the map cannot be used (FAT/root, empty file, map full)
+ */
+CLNO extent_getcl(OFD *p, CLNO idx, CLNO *runlen)
+{
+    DMD *dm = p->o_dmd;
+    CLNO strtcl = p->o_dfd->o_strtcl;
+    EXTMAP *m, *lru;
+    EXTENT *e;
+    CLNO cl;
+    WORD lo, hi, mid;
+
+    if (runlen)
+        *runlen = 0;
+
+    if (!p->o_dnode || (strtcl < 2) || endofchain(strtcl))
+        return 0;
+
+    /* find the map for this file, or replace the least recently used one */
+    for (m = extmap, lru = extmap; m < extmap+BDOS_EXTENT_MAPS; m++)
+    {
+        if ((m->x_dmd == dm) && (m->x_strtcl == strtcl))
+            break;
+        if (!m->x_dmd)
+            m->x_stamp = 0;
+        if (m->x_stamp < lru->x_stamp)
+            lru = m;
+    }
+    if (m == extmap+BDOS_EXTENT_MAPS)
+    {
+        m = lru;
+        m->x_dmd = dm;
+        m->x_strtcl = strtcl;
+        m->x_count = 1;
+        m->x_ext[0].x_fcl = 0;
+        m->x_ext[0].x_dcl = strtcl;
+        m->x_ext[0].x_len = 1;
+    }
+    m->x_stamp = ++extmap_clock;
+
+    /* extend the map until it covers 'idx' */
+    e = &m->x_ext[m->x_count-1];
+    while ((ULONG)idx >= (ULONG)e->x_fcl + e->x_len)
+    {
+        cl = getrealcl(e->x_dcl+e->x_len-1,dm);
+        if (endofchain(cl) || (cl < 2))
+            return ENDOFCHAIN;
+        if (cl == e->x_dcl+e->x_len)
+        {
+            e->x_len++;
+            continue;
+        }
+        if (m->x_count == BDOS_EXTENTS_PER_MAP)
+            return 0;
+        e[1].x_fcl = e->x_fcl + e->x_len;
+        e[1].x_dcl = cl;
+        e[1].x_len = 1;
+        e++;
+        m->x_count++;
+    }
+
+    /* binary search for the extent containing 'idx' */
+    for (lo = 0, hi = m->x_count-1; lo < hi; )
+    {
+        mid = (lo + hi + 1) / 2;
+        if (m->x_ext[mid].x_fcl <= idx)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    e = &m->x_ext[lo];
+    idx -= e->x_fcl;
+
+    if (runlen)
+        *runlen = e->x_len - idx;
+
+    return e->x_dcl + idx;
+}
+#endif
+
+
 /*
 **  clfix -
 **      replace the contents of the fat entry indexed by 'cl' with the value
@@ -36,23 +529,74 @@ RECNO cl2rec(CLNO cl, DMD *dm)
 void clfix(CLNO cl, CLNO link, DMD *dm)
 {
     int spans;
-    CLNO f, mask;
+    UWORD f, mask, w;
     LONG offset, recnum;
     UBYTE *buf;
 
-    offset = dm->m_16 ? (LONG)cl << 1 : ((LONG)cl + (cl >> 1));
+#if CONF_WITH_FAT32
+    if (IS_FAT32(dm))
+        fsinfo_load(dm);    /* before the free cluster count changes */
+#endif
+
+#if CONF_WITH_BDOS_FREEMAP
+    if (dm->m_fbnext)       /* bitmap is valid */
+    {
+        if (link == FREECLUSTER)
+            freemap_setfree(cl,dm);
+        else if (FB_ISFREE(dm->m_fbmap,cl))
+        {
+            FB_SETUSED(dm->m_fbmap,cl);
+            dm->m_fbfree--;
+        }
+    }
+#endif
+
+    offset = fatoffset(cl,dm);
     recnum = offset >> dm->m_rblog;
     offset &= dm->m_rbm;
 
+#if CONF_WITH_FAT32
+    /*
+     * handle 32-bit FAT
+     * like FAT16, except that the top 4 bits of the entry must be kept
+     */
+    if (IS_FAT32(dm))
+    {
+        ULONG old, new;
+
+        buf = getrec(recnum,dm->m_fatofd,1) + offset;
+        old = ULONG_AT(buf);
+        swpl(old);
+        new = (old & 0xf0000000UL) | (link & 0x0fffffffUL);
+        swpl(new);
+        ULONG_AT(buf) = new;
+
+        /* maintain the FSInfo hints */
+        old &= 0x0fffffffUL;
+        if (FS_FREE(dm) != FSINFO_UNKNOWN)
+        {
+            if ((old == FREECLUSTER) && (link != FREECLUSTER))
+                FS_FREE(dm)--;
+            else if ((old != FREECLUSTER) && (link == FREECLUSTER))
+                FS_FREE(dm)++;
+        }
+        if ((old == FREECLUSTER) && (link != FREECLUSTER))
+            FS_NEXT(dm) = (cl+1 < dm->m_numcl+2) ? cl+1 : 2;
+        dm->m_32 |= M32_FSDIRTY;
+        return;
+    }
+#endif
+
     /*
      * handle 16-bit FAT
      * easier because content is word-aligned and cannot span FAT sectors
      */
+    w = (UWORD)link;
     if (dm->m_16)
     {
         buf = getrec(recnum,dm->m_fatofd,1);
-        swpw(link);
-        *(CLNO *)(buf+offset) = link;
+        swpw(w);
+        *(UWORD *)(buf+offset) = w;
         return;
     }
 
@@ -61,12 +605,12 @@ void clfix(CLNO cl, CLNO link, DMD *dm)
      */
     if (IS_ODD(cl))
     {
-        link = link << 4;
+        w = w << 4;
         mask = 0x000f;
     }
     else
     {
-        link = link & 0x0fff;
+        w = w & 0x0fff;
         mask = 0xf000;
     }
 
@@ -81,7 +625,7 @@ void clfix(CLNO cl, CLNO link, DMD *dm)
 
     /* update */
     swpw(f);
-    f = (f & mask) | link;
+    f = (f & mask) | w;
     swpw(f);
 
     /* write back */
@@ -93,36 +637,174 @@ void clfix(CLNO cl, CLNO link, DMD *dm)
 }
 
 
+/*
+**  clfree -
+**      free the chain of clusters starting at 'cl'.
+**
+**      this has the same effect as calling getrealcl() then clfix(cl,
+**      FREECLUSTER,dm) for each cluster of the chain, but each entry is
+**      read and cleared in one go, and a FAT record is only looked up
+**      once for all the consecutive entries of the chain that lie in it.
+**      12-bit entries that span two records are handled by clfix().
+*/
+void clfree(CLNO cl, DMD *dm)
+{
+    CLNO next;
+    UWORD f;
+    LONG offset, recnum, currec;
+    UBYTE *buf, *p;
+#if CONF_WITH_FAT32
+    ULONG n, freed = 0;
+
+    if (IS_FAT32(dm))
+        fsinfo_load(dm);    /* before the free cluster count changes */
+#endif
+
+    buf = NULL;
+    currec = -1L;
+
+    while ((cl >= 2) && (cl < dm->m_numcl+2))
+    {
+        offset = fatoffset(cl,dm);
+        recnum = offset >> dm->m_rblog;
+        offset &= dm->m_rbm;
+
+        if (!FAT_ALIGNED(dm) && (dm->m_recsiz-offset == 1))
+        {
+            /* 12-bit entry spans FAT sectors: do it the slow way */
+            next = getrealcl(cl,dm);
+            clfix(cl,FREECLUSTER,dm);
+            currec = -1L;   /* buf may have been reused */
+            goto nextcl;
+        }
+
+        if (recnum != currec)
+        {
+            buf = getrec(recnum,dm->m_fatofd,1);
+            currec = recnum;
+        }
+        p = buf + offset;
+
+#if CONF_WITH_FAT32
+        if (IS_FAT32(dm))
+        {
+            /* keep the top 4 bits of the entry (in the last byte) */
+            n = ULONG_AT(p);
+            swpl(n);
+            next = n & 0x0fffffffUL;
+            p[0] = p[1] = p[2] = 0;
+            p[3] &= 0xf0;
+            if (next != FREECLUSTER)
+                freed++;
+            if (endofchain(next))
+                next = ENDOFCHAIN;
+        }
+        else
+#endif
+        if (dm->m_16)
+        {
+            f = *(UWORD *)p;
+            swpw(f);
+            next = f;
+            *(UWORD *)p = 0;
+#if CONF_WITH_FAT32
+            if ((f&0xfff8) == 0xfff8)   /* handle end of chain */
+                next = ENDOFCHAIN;
+#endif
+        }
+        else
+        {
+            f = p[0] | (p[1] << 8);     /* little-endian */
+            if (IS_ODD(cl))
+            {
+                next = f >> 4;
+                f &= 0x000f;
+            }
+            else
+            {
+                next = f & 0x0fff;
+                f &= 0xf000;
+            }
+            p[0] = LOBYTE(f);
+            p[1] = HIBYTE(f);
+            if ((next&0x0ff8) == 0x0ff8)    /* handle end of chain */
+                next = ENDOFCHAIN;
+        }
+
+#if CONF_WITH_BDOS_FREEMAP
+        if (dm->m_fbnext)   /* bitmap is valid */
+            freemap_setfree(cl,dm);
+#endif
+
+nextcl:
+        if (endofchain(next))
+            break;
+        cl = next;
+    }
+
+#if CONF_WITH_FAT32
+    if (IS_FAT32(dm))
+    {
+        if (FS_FREE(dm) != FSINFO_UNKNOWN)
+            FS_FREE(dm) += freed;
+        dm->m_32 |= M32_FSDIRTY;
+    }
+#endif
+}
+
+
 /*
 **  getrealcl -
 **      get the contents of the fat entry indexed by 'cl'.
 **
-**  returns 16-bit value
-**      for FAT12: 0xffff if entry contains the end of file marker
+**  returns
+**      for FAT12: ENDOFCHAIN if entry contains the end of file marker
 **                 otherwise, the contents of the entry
-**      for FAT16: the contents of the entry
+**      for FAT16: the contents of the entry (but ENDOFCHAIN for the
+**                 end of file marker if CONF_WITH_FAT32 is set)
+**      for FAT32: like FAT12, ignoring the top 4 bits of the entry
 **
 **      M01.0.1.03
 */
 CLNO getrealcl(CLNO cl, DMD *dm)
 {
-    CLNO f;
+    UWORD f;
     LONG offset, recnum;
     UBYTE *buf;
 
-    offset = dm->m_16 ? (LONG)cl << 1 : ((LONG)cl + (cl >> 1));
+    offset = fatoffset(cl,dm);
     recnum = offset >> dm->m_rblog;
     offset &= dm->m_rbm;
     buf = getrec(recnum,dm->m_fatofd,0) + offset;
 
+#if CONF_WITH_FAT32
+    /*
+     * handle 32-bit FAT
+     */
+    if (IS_FAT32(dm))
+    {
+        ULONG n = ULONG_AT(buf);
+
+        swpl(n);
+        n &= 0x0fffffffUL;
+        if (endofchain(n))
+            n = ENDOFCHAIN;
+        return n;
+    }
+#endif
+
     /*
      * handle 16-bit FAT
      * easier because content is word-aligned and cannot span FAT sectors
      */
     if (dm->m_16)
     {
-        f = *(CLNO *)buf;
+        f = *(UWORD *)buf;
         swpw(f);
+#if CONF_WITH_FAT32
+        if ((f&0xfff8) == 0xfff8)   /* handle end of chain */
+            return ENDOFCHAIN;
+#endif
         return f;
     }
 
@@ -167,33 +849,48 @@ CLNO getclnum(CLNO cl, OFD *of)
 
 
 /*
- * findfree16 - fast scan of FAT16 filesystem to find first free cluster
+ * findfree_fast - fast scan of FAT16/FAT32 filesystem to find a free cluster
+ *
+ * the search starts at 'start' and wraps around
  *
  * returns cluster number, or 0 if no free clusters
  */
-static CLNO findfree16(DMD *dm)
+static CLNO findfree_fast(CLNO start, DMD *dm)
 {
-    int recnum, offset;
-    CLNO clnum;
+    WORD entlog = FATENT_LOG(dm);
+    WORD offset, pass;
+    LONG recnum;
+    CLNO clnum, end;
     UBYTE *buf;
 
-    for (clnum = 2; clnum < dm->m_numcl+2; )
-    {
-        /*
-         * get the next FAT record
-         */
-        recnum = (clnum * sizeof(CLNO)) >> dm->m_rblog;
-        offset = (clnum * sizeof(CLNO)) & dm->m_rbm;
-        buf = getrec(recnum, dm->m_fatofd, 0);
+    if ((start < 2) || (start >= dm->m_numcl+2))
+        start = 2;
 
-        /*
-         * scan the FAT record, looking for a free slot
-         */
-        for ( ; (offset < dm->m_recsiz) && (clnum < (dm->m_numcl+2)); offset += sizeof(CLNO), clnum++)
+    /* search from 'start' to the end, then from the beginning up to 'start' */
+    clnum = start;
+    end = dm->m_numcl + 2;
+    for (pass = 0; pass < 2; pass++)
+    {
+        while (clnum < end)
         {
-            if (*(CLNO *)(buf+offset) == 0)
-                return clnum;
+            /*
+             * get the next FAT record
+             */
+            recnum = ((LONG)clnum << entlog) >> dm->m_rblog;
+            offset = ((LONG)clnum << entlog) & dm->m_rbm;
+            buf = getrec(recnum, dm->m_fatofd, 0);
+
+            /*
+             * scan the FAT record, looking for a free slot
+             */
+            for ( ; (offset < dm->m_recsiz) && (clnum < end); offset += 1 << entlog, clnum++)
+            {
+                if (FATENT_FREE(dm,buf+offset))
+                    return clnum;
+            }
         }
+        clnum = 2;
+        end = start;
     }
 
     return 0;
@@ -209,14 +906,29 @@ static CLNO findfree(CLNO cl, DMD *dm)
 {
     CLNO i;
 
+#if CONF_WITH_BDOS_FREEMAP
+    if (freemap_build(dm))
+        return freemap_find(cl,dm);
+#endif
+
     /*
-     * fast scan for first free cluster on FAT16 filesystem
+     * fast scan for next free cluster on FAT16/FAT32 filesystem; the
+     * first scan on FAT32 starts at the FSInfo hint
      */
-    if ((cl == 0) && dm->m_16)
-        return findfree16(dm);
+    if (FAT_ALIGNED(dm))
+    {
+#if CONF_WITH_FAT32
+        if ((cl == 0) && IS_FAT32(dm))
+        {
+            fsinfo_load(dm);
+            cl = FS_NEXT(dm);
+        }
+#endif
+        return findfree_fast(cl,dm);
+    }
 
     /*
-     * handle FAT12 filesystems, or subsequent scans on FAT16
+     * handle FAT12 filesystems
      *
      * the following code carefully avoids allowing overflow in CLNO variables
      */
@@ -293,12 +1005,197 @@ int nextcl(OFD *p, int wrtflg)
 }
 
 
+#if CONF_WITH_FPREALLOC
+/*
+ * freemap_bestfit - find a run of free clusters via the bitmap
+ *
+ * returns the first cluster of the shortest run of at least 'need'
+ * clusters or, if there is no such run, of the longest run; sets *len
+ * to the length of the run.  a long enough run starting at 'pref' is
+ * taken immediately, since it extends a file without fragmenting it.
+ *
+ * returns 0 if no free clusters
+ */
+static CLNO freemap_bestfit(CLNO pref, CLNO need, CLNO *len, DMD *dm)
+{
+    UBYTE *map = dm->m_fbmap;
+    ULONG n, start, end, run;
+    CLNO best = 0, bestlen = 0;
+
+    end = (ULONG)dm->m_numcl + 2;
+    for (n = dm->m_fbnext; n < end; )
+    {
+        if (((n & 7) == 0) && (map[n>>3] == 0))
+        {
+            n += 8;                 /* skip 8 used clusters at once */
+            continue;
+        }
+        if (!FB_ISFREE(map,n))
+        {
+            n++;
+            continue;
+        }
+
+        /* measure this run of free clusters */
+        for (start = n; n < end; )
+        {
+            if (((n & 7) == 0) && (map[n>>3] == 0xff) && (n+8 <= end))
+                n += 8;             /* skip 8 free clusters at once */
+            else if (FB_ISFREE(map,n))
+                n++;
+            else
+                break;
+        }
+        run = n - start;
+
+        if ((start == pref) && (run >= need))
+        {
+            best = start;
+            bestlen = run;
+            break;
+        }
+        if ((bestlen < need) ? (run > bestlen) : ((run >= need) && (run < bestlen)))
+        {
+            best = start;
+            bestlen = run;
+        }
+    }
+
+    *len = bestlen;
+    return best;
+}
+
+/*
+ *  xprealloc - preallocate space for a file
+ *
+ *  Function 0x59   f_prealloc (EmuTOS-specific)
+ *
+ *  extends the cluster chain of the file so that it can hold at least
+ *  'size' bytes, without changing the file length.  the new clusters
+ *  are allocated as a single best-fit run where possible; since the
+ *  FAT entries of a run are adjacent, this also dirties as few FAT
+ *  records as possible.  clusters still unused when the file is closed
+ *  are freed again.
+ *
+ *  Error returns:  EIHNDL, EACCDN (read-only or disk full), ERANGE
+ *                  ENSMEM (no memory for the free cluster bitmap)
+ */
+long xprealloc(int h, long size)
+{
+    OFD *fd = getofd(h);
+    DFD *dfd;
+    DMD *dm;
+    CLNO cl, last, start, len;
+    ULONG need, have;
+
+    if (!fd || ((long)fd < 0L))         /* invalid or character device */
+        return EIHNDL;
+    if ((fd->o_mod & MODE_FAC) == RO_MODE)
+        return EACCDN;
+    if (size < 0L)
+        return ERANGE;
+
+    dfd = fd->o_dfd;
+    dm = fd->o_dmd;
+
+    if (!freemap_build(dm))
+        return ENSMEM;
+
+    need = ((ULONG)size + dm->m_clbm) >> dm->m_clblog;
+    if (need > dm->m_numcl)
+        return EACCDN;
+
+    /* find the end of the existing chain */
+    for (cl = dfd->o_strtcl, last = 0, have = 0; (have < need) && (cl >= 2) && !endofchain(cl); have++)
+    {
+        last = cl;
+        cl = getrealcl(cl,dm);
+    }
+    if (have >= need)
+        return E_OK;
+    need -= have;
+    if (need > dm->m_fbfree)
+        return EACCDN;
+
+    while (need)
+    {
+        start = freemap_bestfit(last+1, need, &len, dm);
+        if (!start)                     /* "can't happen" */
+            return EACCDN;
+        if (len > need)
+            len = need;
+
+        for (cl = start; cl < start+len-1; cl++)
+            clfix(cl,cl+1,dm);
+        clfix(cl,ENDOFCHAIN,dm);
+        if (last)
+            clfix(last,start,dm);
+        else
+        {
+            dfd->o_strtcl = start;
+            dfd->o_flag |= O_DIRTY;
+        }
+
+        last = start + len - 1;
+        need -= len;
+    }
+    dfd->o_flag |= O_PREALLOC;
+
+    return E_OK;
+}
+
+/*
+ * prealloc_trim - free any preallocated clusters beyond end of file
+ */
+void prealloc_trim(OFD *fd)
+{
+    DFD *dfd = fd->o_dfd;
+    DMD *dm = fd->o_dmd;
+    CLNO cl, next, keep;
+
+    dfd->o_flag &= ~O_PREALLOC;
+
+#if CONF_WITH_BDOS_EXTENTS
+    if (dfd->o_strtcl)
+        extent_discard(dm,dfd->o_strtcl);
+#endif
+#if CONF_WITH_PGM_CACHE
+    if (dfd->o_strtcl)
+        pgmcache_discard(dm,dfd->o_strtcl);
+#endif
+
+    keep = ((ULONG)dfd->o_fileln + dm->m_clbm) >> dm->m_clblog;
+    cl = dfd->o_strtcl;
+    if (keep == 0)
+    {
+        dfd->o_strtcl = 0;
+        dfd->o_flag |= O_DIRTY;
+    }
+    else
+    {
+        while (--keep && (cl >= 2) && !endofchain(cl))
+            cl = getrealcl(cl,dm);
+        if ((cl < 2) || endofchain(cl))
+            return;
+        next = getrealcl(cl,dm);
+        clfix(cl,ENDOFCHAIN,dm);
+        cl = next;
+    }
+
+    if ((cl >= 2) && !endofchain(cl))
+        clfree(cl,dm);
+}
+#endif
+
+
 /*
- * countfree16 - fast scan of FAT16 filesystem to count free clusters
+ * countfree_fast - fast scan of FAT16/FAT32 filesystem to count free clusters
  */
-static CLNO countfree16(DMD *dm)
+static CLNO countfree_fast(DMD *dm)
 {
-    int recnum, offset;
+    WORD entlog = FATENT_LOG(dm);
+    WORD offset;
+    LONG recnum;
     CLNO free, clnum;
     UBYTE *buf;
 
@@ -307,16 +1204,16 @@ static CLNO countfree16(DMD *dm)
         /*
          * get the next FAT record
          */
-        recnum = (clnum * sizeof(CLNO)) >> dm->m_rblog;
-        offset = (clnum * sizeof(CLNO)) & dm->m_rbm;
+        recnum = ((LONG)clnum << entlog) >> dm->m_rblog;
+        offset = ((LONG)clnum << entlog) & dm->m_rbm;
         buf = getrec(recnum, dm->m_fatofd, 0);
 
         /*
          * scan the FAT record, counting free slots
          */
-        for ( ; (offset < dm->m_recsiz) && (clnum < (dm->m_numcl+2)); offset += sizeof(CLNO), clnum++)
+        for ( ; (offset < dm->m_recsiz) && (clnum < (dm->m_numcl+2)); offset += 1 << entlog, clnum++)
         {
-            if (*(CLNO *)(buf+offset) == 0)
+            if (FATENT_FREE(dm,buf+offset))
                 free++;
         }
     }
@@ -330,9 +1227,10 @@ static CLNO countfree16(DMD *dm)
         Error returns
                 ERR
 
-        The code is optimised for 16-bit FATs.  The 12-bit case is more
-        complex, since the entry for a cluster can span logical records,
-        and therefore we do it the old, slow way.
+        The code is optimised for 16-bit and 32-bit FATs.  The 12-bit case
+        is more complex, since the entry for a cluster can span logical
+        records, and therefore we do it the old, slow way.  For FAT32, the
+        count in the FSInfo record is used if it is valid.
 */
 long xgetfree(long *buf, int drv)
 {
@@ -346,9 +1244,25 @@ long xgetfree(long *buf, int drv)
         return ERR;
 
     dm = drvtbl[n];
-    if (dm->m_16)
+#if CONF_WITH_FAT32
+    if (IS_FAT32(dm))
+        fsinfo_load(dm);
+    if (IS_FAT32(dm) && (FS_FREE(dm) != FSINFO_UNKNOWN))
+    {
+        free = FS_FREE(dm);        /* kept up to date by clfix() */
+    }
+    else
+#endif
+#if CONF_WITH_BDOS_FREEMAP
+    if (freemap_build(dm))
+    {
+        free = dm->m_fbfree;
+    }
+    else
+#endif
+    if (FAT_ALIGNED(dm))
     {
-        free = countfree16(dm);
+        free = countfree_fast(dm);
     }
     else
     {
@@ -357,6 +1271,10 @@ long xgetfree(long *buf, int drv)
             if (!getrealcl(i+2,dm))     /* cluster numbers start at 2 */
                 free++;
     }
+#if CONF_WITH_FAT32
+    if (IS_FAT32(dm))
+        FS_FREE(dm) = free;        /* now known */
+#endif
 
     *buf++ = (long)(free);
     *buf++ = (long)(dm->m_numcl);
@@ -33,6 +33,15 @@ DMD *drvtbl[BLKDEVNUM];
  */
 FTAB sft[OPNFILES];
 
+#if CONF_WITH_SFT_GROW
+/*
+ *  sftblk - additional blocks of sft entries, allocated as required
+ *  sftnum - current number of sft entries, including sft[]
+ */
+FTAB *sftblk[SFT_BLOCKS];
+WORD sftnum = OPNFILES;
+#endif
+
 
 /*
  * rwerr -  hard error number currently in progress
@@ -41,6 +50,15 @@ long rwerr;
 long errcode;
 
 
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+/*
+ * dirchgcnt -  incremented whenever a directory may have been changed,
+ *              so that the AES can validate its caches
+ */
+ULONG dirchgcnt;
+#endif
+
+
 /*
  * errdrv -  drive on which error occurred
  */
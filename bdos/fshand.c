@@ -65,12 +65,16 @@ long ixforce(int std, int h, PD *p)
          * store the BIOS handle in the PD table; otherwise store the
          * non-std handle & update the use count
          */
-        if ((fh = (long) sft[h-NUMSTD].f_ofd) < 0L)
+        if ((fh = (long) SFT(h-NUMSTD)->f_ofd) < 0L)
             p->p_uft[std] = fh;
         else
         {
+#if CONF_WITH_SFT_GROW
+            if (h > 127)        /* must fit in p_uft[] */
+                return EIHNDL;
+#endif
             p->p_uft[std] = h;
-            sft[h-NUMSTD].f_use++;
+            SFT(h-NUMSTD)->f_use++;
         }
     }
 
@@ -92,32 +96,36 @@ long ixforce(int std, int h, PD *p)
  */
 long xdup(int h)
 {
+    FTAB *ftab;
+    OFD *fd;
     int i;
 
     if ((h < 0) || (h >= NUMSTD))
         return EIHNDL;          /* only dup standard */
 
-    for (i = 0; i < OPNFILES; i++)      /* find the first free handle */
-        if (!sft[i].f_own)
-            break;
-
-    if (i == OPNFILES)
+    i = sftalloc();             /* find the first free handle */
+    if (i < 0)
         return ENHNDL;          /* no free handles */
 
-    sft[i].f_own = run;
+    ftab = SFT(i);
 
     /*
      * if the standard handle is currently mapped to a non-BIOS
      * handle, copy the OFD pointer from the corresponding sft[]
      * entry to the new entry; otherwise, store the BIOS handle
-     * in the OFD pointer variable
+     * in the OFD pointer variable.  an OFD shared like this is marked,
+     * so that it is only looked for in the sft when one of them is closed
      */
     if ((h = run->p_uft[h]) > 0)
-        sft[i].f_ofd = sft[h-NUMSTD].f_ofd;
+    {
+        ftab->f_ofd = fd = SFT(h-NUMSTD)->f_ofd;
+        if ((long)fd > 0L)
+            fd->o_mod |= O_SHARED;
+    }
     else
-        sft[i].f_ofd = (OFD *)(long)h;
+        ftab->f_ofd = (OFD *)(long)h;
 
-    sft[i].f_use = 1;
+    ftab->f_use = 1;
 
     return i+NUMSTD;            /* return the new handle */
 }
@@ -19,7 +19,7 @@
 #include "intmath.h"
 
 
-#define CNTMAX  0x7FFFul  /* 16-bit MAXINT */
+#define CNTMAX  0x7FFFul  /* 16-bit MAXINT: max sector count for Rwabs() */
 
 
 /*
@@ -50,6 +50,11 @@ static void addit(OFD *p, long siz)
 /*
  * usrio - interface to rwabs
  *
+ * with CONF_WITH_BDOS_CACHE, the cache is kept coherent with the user
+ * buffer rather than being flushed: buffers holding records that are
+ * written are updated with the new data, and records that are read are
+ * copied from our buffers where possible, the rest being read directly.
+ *
  * NOTE: longjmp_rwabs() is a macro that includes a longjmp() which is
  *       executed if the BIOS returns an error, therefore usrio() does
  *       not need to return any error codes.
@@ -57,7 +62,63 @@ static void addit(OFD *p, long siz)
 static void usrio(int rwflg, int num, long strt, char *ubuf, DMD *dm)
 {
     BCB *b;
+#if CONF_WITH_BDOS_CACHE
+    WORD drv = dm->m_drvnum;
+    UWORD recsiz = dm->m_recsiz;
+    int n, hits = 0;
+
+    for (b = bufl[BI_DATA]; b; b = b->b_link)
+    {
+        if ((b->b_bufdrv != drv) || (b->b_buftyp != BT_DATA) ||
+            (b->b_bufrec < strt) || (b->b_bufrec >= strt+num))
+            continue;
+        if (rwflg)
+        {
+            /* any error invalidates all the buffers for the drive */
+            memcpy(b->b_bufr, ubuf + (b->b_bufrec-strt)*recsiz, recsiz);
+            b->b_dirty = 0;
+        }
+        else if (bufl_lookup(drv, BT_DATA, b->b_bufrec) == b)
+            hits++;
+        else
+        {   /* a buffer belonging to another program */
+            if (b->b_dirty)
+                flush(b);
+        }
+    }
+
+    if (hits)
+    {
+        if (bufl_mediach(drv) == 0)
+        {
+            while (num > 0)
+            {
+                b = bufl_lookup(drv, BT_DATA, strt);
+                if (b)
+                {
+                    memcpy(ubuf, b->b_bufr, recsiz);
+                    n = 1;
+                }
+                else
+                {
+                    for (n = 1; (n < num) && !bufl_lookup(drv, BT_DATA, strt+n); n++)
+                        ;
+                    longjmp_rwabs(0, (long)ubuf, n, strt+dm->m_recoff[BT_DATA], drv);
+                }
+                strt += n;
+                ubuf += (long)n * recsiz;
+                num -= n;
+            }
+            return;
+        }
 
+        /* the media may have changed: let the BIOS find out */
+        for (b = bufl[BI_DATA]; b; b = b->b_link)
+            if ((b->b_bufdrv == drv) && (b->b_buftyp == BT_DATA) && b->b_dirty &&
+                (b->b_bufrec >= strt) && (b->b_bufrec < strt+num))
+                flush(b);
+    }
+#else
     for (b = bufl[BI_DATA]; b; b = b->b_link)
     {
         if ((b->b_bufdrv == dm->m_drvnum) &&
@@ -69,6 +130,7 @@ static void usrio(int rwflg, int num, long strt, char *ubuf, DMD *dm)
             b->b_bufdrv = -1;
         }
     }
+#endif
 
     longjmp_rwabs(rwflg, (long)ubuf, num, strt+dm->m_recoff[BT_DATA], dm->m_drvnum);
 }
@@ -88,7 +150,12 @@ static char *xrw_recs(WORD wrtflg, OFD *p, RECNO startrec, RECNO numrecs, char *
     CLNO numclus;
     LONG nbytes;
     WORD rc;
-    BOOL first_time;
+    BOOL first_time, tailcl;
+    UWORD tailbyt;
+#if CONF_WITH_BDOS_EXTENTS
+    CLNO idx, run, nextdcl;
+    BOOL usemap;
+#endif
 
     dm = p->o_dmd;
 
@@ -126,11 +193,65 @@ static char *xrw_recs(WORD wrtflg, OFD *p, RECNO startrec, RECNO numrecs, char *
     last = nrecs = 0L;
     rc = 0;
     first_time = TRUE;
+    tailcl = FALSE;
+    tailbyt = 0;
+
+#if CONF_WITH_BDOS_EXTENTS
+    /*
+     * we can use the extent map to find the following clusters if we
+     * are at a cluster boundary and the map agrees with the OFD about
+     * the current cluster
+     */
+    idx = p->o_bytnum >> dm->m_clblog;
+    run = nextdcl = 0;
+    usemap = FALSE;
+    if (numclus && ((p->o_bytnum & dm->m_clbm) == 0))
+    {
+        if (idx)
+            usemap = (extent_getcl(p,idx-1,NULL) == p->o_curcl);
+        else
+            usemap = (p->o_curcl == 0);
+    }
+#endif
 
     while(TRUE)
     {
         if (numclus)
+        {
+#if CONF_WITH_BDOS_EXTENTS
+            if (usemap && (run == 0))
+            {
+                nextdcl = extent_getcl(p,idx,&run);
+                if (nextdcl == 0)
+                    usemap = FALSE;     /* map is full */
+            }
+            idx++;
+            if (run)                    /* next cluster is known */
+            {
+                p->o_curcl = nextdcl++;
+                p->o_currec = cl2rec(p->o_curcl,dm);
+                p->o_curbyt = 0;
+                run--;
+            }
+            else
+#endif
             rc = nextcl(p,wrtflg);
+        }
+        else if (tailrec && nrecs)
+        {
+            /*
+             * get the cluster for the 'tail' records now: if it follows
+             * on from the pending transfer, they can be added to it
+             */
+            rc = nextcl(p,wrtflg);
+            tailcl = TRUE;
+            if ((rc == 0) && (p->o_currec == last + nrecs) && (nrecs + tailrec <= CNTMAX))
+            {
+                nrecs += tailrec;
+                tailbyt = tailrec << dm->m_rblog;
+                tailrec = 0;
+            }
+        }
 
         if (first_time)
         {
@@ -155,6 +276,8 @@ static char *xrw_recs(WORD wrtflg, OFD *p, RECNO startrec, RECNO numrecs, char *
                 ubufr += nbytes;
                 last = p->o_currec;
                 nrecs = 0;
+                if (tailbyt)        /* we're part way into the tail cluster */
+                    p->o_curbyt = tailbyt;
             }
         }
 
@@ -173,7 +296,7 @@ static char *xrw_recs(WORD wrtflg, OFD *p, RECNO startrec, RECNO numrecs, char *
      */
     if (tailrec)
     {
-        if (nextcl(p,wrtflg))
+        if (!tailcl && nextcl(p,wrtflg))
             return NULL;
         KDEBUG(("xrw(%c %d): xfer tail recs %ld->%ld\n",
                 wrtflg?'W':'R',dm->m_drvnum,p->o_currec,p->o_currec+tailrec-1));
@@ -187,6 +310,45 @@ static char *xrw_recs(WORD wrtflg, OFD *p, RECNO startrec, RECNO numrecs, char *
 }
 
 
+#if CONF_WITH_BDOS_READAHEAD
+/*
+ * readahead - read ahead into the cache
+ *
+ * 'recn' is the record at the current position of the OFD, which is
+ * about to be read via getrec().  the records that follow it are read
+ * too, as far as they are contiguous on disk and within the file, up to
+ * the read-ahead limit for the drive.
+ */
+static void readahead(OFD *p, RECNO recn)
+{
+    DMD *dm = p->o_dmd;
+    LONG nrecs, filerecs;
+#if CONF_WITH_BDOS_EXTENTS
+    CLNO run;
+#endif
+
+    if (!dm->m_rahead || !p->o_dnode)
+        return;
+
+    /* the records remaining in the current cluster ... */
+    nrecs = p->o_currec + dm->m_clsiz - recn;
+
+#if CONF_WITH_BDOS_EXTENTS
+    /* ... plus those in any contiguous clusters that follow it */
+    if (extent_getcl(p,p->o_bytnum>>dm->m_clblog,&run) == p->o_curcl)
+        nrecs += (LONG)(run-1) << dm->m_clrlog;
+#endif
+
+    filerecs = ((p->o_dfd->o_fileln + dm->m_rbm) >> dm->m_rblog) - (p->o_bytnum >> dm->m_rblog);
+    nrecs = min(nrecs,filerecs);
+    nrecs = min(nrecs,dm->m_rahead);
+
+    if (nrecs > 1)
+        bufl_readahead(dm,recn,nrecs);
+}
+#endif
+
+
 /*
  * xrw - read/write for BDOS functions
  *
@@ -212,10 +374,24 @@ static long xrw(int wrtflg, OFD *p, long len, char *ubufr)
     WORD bytn, lenxfr, lentail;
     RECNO recn, numrecs;
     LONG rc, bytpos;
+#if CONF_WITH_BDOS_READAHEAD
+    BOOL seq;
+#endif
 
     dm = p->o_dmd;                      /*  get drive media descriptor  */
     bytpos = p->o_bytnum;               /*  starting file position      */
 
+#if CONF_WITH_BDOS_READAHEAD
+    /* a read that starts where the previous one ended is sequential */
+    seq = !wrtflg && p->o_rdend && (bytpos == p->o_rdend);
+#endif
+
+#if CONF_WITH_PGM_CACHE
+    /* a cached copy of a program being written is stale */
+    if (wrtflg && p->o_dfd && p->o_dfd->o_strtcl)
+        pgmcache_discard(dm,p->o_dfd->o_strtcl);
+#endif
+
     /*
      * get logical record number to start i/o with
      * (bytn will be byte offset into sector # recn)
@@ -232,6 +408,10 @@ static long xrw(int wrtflg, OFD *p, long len, char *ubufr)
         /* #bytes left in current record ) */
 
         lenxfr = min(len,dm->m_recsiz-bytn);
+#if CONF_WITH_BDOS_READAHEAD
+        if (seq)
+            readahead(p,recn);
+#endif
         bufp = getrec(recn,p,wrtflg);   /* get desired record  */
         addit(p,lenxfr);                /* update OFD          */
         len -= lenxfr;                  /* nbr left to do      */
@@ -269,6 +449,10 @@ static long xrw(int wrtflg, OFD *p, long len, char *ubufr)
             recn = 0;
         }
 
+#if CONF_WITH_BDOS_READAHEAD
+        if (seq)
+            readahead(p,p->o_currec+recn);
+#endif
         bufp = getrec((RECNO)p->o_currec+recn,p,wrtflg);
         addit(p,lentail);
 
@@ -279,6 +463,10 @@ static long xrw(int wrtflg, OFD *p, long len, char *ubufr)
 
 eof:
     rc = p->o_bytnum - bytpos;
+#if CONF_WITH_BDOS_READAHEAD
+    if (!wrtflg)
+        p->o_rdend = p->o_bytnum;
+#endif
 
     return(rc);
 }
@@ -371,6 +559,18 @@ long ixlseek(OFD *p,long n)
      */
     clnum = n >> dm->m_clblog;
 
+#if CONF_WITH_BDOS_EXTENTS
+    /*
+     * use the extent map if possible.  see below for why we go one less
+     * if on a cluster boundary.
+     */
+    clx = extent_getcl(p,((n&dm->m_clbm) == 0) ? clnum-1 : clnum,NULL);
+    if (endofchain(clx))
+        return EINTRN;          /* FAT chain is shorter than filesize says ... */
+    if (clx)
+        goto found;
+#endif
+
     /*
      * if that's beyond where we are, we can chain forward;
      * otherwise, we need to start from the beginning
@@ -417,6 +617,9 @@ long ixlseek(OFD *p,long n)
             return EINTRN;      /* FAT chain is shorter than filesize says ... */
     }
 
+#if CONF_WITH_BDOS_EXTENTS
+found:
+#endif
     p->o_curcl = clx;
     p->o_currec = cl2rec(clx,dm);
     p->o_bytnum = n;
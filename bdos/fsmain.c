@@ -482,5 +482,65 @@ OFD *getofd(int h)
     if (n < 0)
         return NULL;
 
-    return sft[n].f_ofd;
+    return SFT(n)->f_ofd;
+}
+
+
+#if CONF_WITH_SFT_GROW
+/*
+ *  sftext - returns ptr to an sft entry beyond the static sft[]
+ */
+FTAB *sftext(int n)
+{
+    n -= OPNFILES;
+
+    return &sftblk[n/SFT_PER_BLOCK][n%SFT_PER_BLOCK];
+}
+#endif
+
+
+/*
+ *  sftalloc - find a free sft entry and assign it to the current process
+ *
+ *  with CONF_WITH_SFT_GROW, the sft is extended by a block from the OS
+ *  memory pool if it is full
+ *
+ *  returns the index of the entry, or -1 if there are no free entries
+ */
+int sftalloc(void)
+{
+    FTAB *ftab;
+    int i;
+
+    for (i = 0, ftab = sft; i < OPNFILES; i++, ftab++)
+        if (!ftab->f_own)
+            goto found;
+
+#if CONF_WITH_SFT_GROW
+    for ( ; i < sftnum; i++)
+    {
+        ftab = sftext(i);
+        if (!ftab->f_own)
+            goto found;
+    }
+
+    if (sftnum >= OPNFILES + SFT_BLOCKS*SFT_PER_BLOCK)
+        return -1;
+
+    /* unlike the other memory types, this fails rather than halting */
+    ftab = xmgetblk(MEMTYPE_MDBLOCK);   /* zeroed, so all entries are free */
+    if (!ftab)
+        return -1;
+
+    sftblk[(sftnum-OPNFILES)/SFT_PER_BLOCK] = ftab;
+    sftnum += SFT_PER_BLOCK;
+    KDEBUG(("sft extended to %d entries\n",sftnum));
+    goto found;
+#else
+    return -1;
+#endif
+
+found:
+    ftab->f_own = run;
+    return i;
 }
@@ -185,8 +185,9 @@ long ixcreat(char *name, UBYTE attr)
     builds(s,a);
     pos -= sizeof(FCB);
     fcb->f_attrib = attr;
-    for (i = 0; i < 10; i++)
+    for (i = 0; i < sizeof(fcb->f_fill); i++)
         fcb->f_fill[i] = 0;
+    fcb->f_clusthi = 0;
     fcb->f_td.time = current_time;
     swpw(fcb->f_td.time);
     fcb->f_td.date = current_date;
@@ -243,6 +244,10 @@ static long ixopen(char *name, int mod)
     const char *s;
     long pos;
 
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+    dirchgcnt++;                /* invalidate cached directory listings */
+#endif
+
     /* first find path */
     dn = findit(name,&s,0);
     if (!dn)                                        /* M01.01.1214.01 */
@@ -264,6 +269,82 @@ static long ixopen(char *name, int mod)
 }
 
 
+#if CONF_WITH_SFT_GROW
+/*
+ * the base OFDs of all open files (i.e. those that own the DFD) are
+ * hashed by directory and position of the FCB within it, so that opening
+ * a file that is already open does not need to scan every open file in
+ * the directory.  chains are linked via o_thread.
+ */
+#define OFDHASH_SIZE    32      /* must be a power of 2 */
+#define OFDHASH(dn,pos) (((UWORD)((ULONG)(dn)>>6) ^ (UWORD)((pos)>>5)) & (OFDHASH_SIZE-1))
+
+static OFD *ofdhash[OFDHASH_SIZE];
+
+static OFD *ofdlookup(DND *dn, long pos)
+{
+    OFD *p;
+
+    for (p = ofdhash[OFDHASH(dn,pos)]; p; p = p->o_thread)
+        if ((p->o_dnode == dn) && (p->o_dirbyt == pos))
+            break;
+
+    return p;
+}
+
+static void ofdhashadd(OFD *fd)
+{
+    OFD **q = &ofdhash[OFDHASH(fd->o_dnode,fd->o_dirbyt)];
+
+    fd->o_thread = *q;
+    *q = fd;
+}
+
+/*
+**  ofdunhash - remove the base OFD of an open file from the hash
+**
+**  must be called before the base OFD is freed or its o_dnode/o_dirbyt
+**  are changed; does nothing if the OFD is not in the hash
+*/
+void ofdunhash(OFD *fd)
+{
+    OFD **q;
+
+    fd = (OFD *)((char *)fd->o_dfd - offsetof(OFD, o_disk));
+
+    for (q = &ofdhash[OFDHASH(fd->o_dnode,fd->o_dirbyt)]; *q; q = &(*q)->o_thread)
+    {
+        if (*q == fd)
+        {
+            *q = fd->o_thread;
+            fd->o_thread = NULL;
+            break;
+        }
+    }
+}
+
+/*
+**  ofdhashpurge - remove all the OFDs for the specified drive from the hash
+*/
+void ofdhashpurge(DMD *dm)
+{
+    OFD **q;
+    int i;
+
+    for (i = 0; i < OFDHASH_SIZE; i++)
+    {
+        for (q = &ofdhash[i]; *q; )
+        {
+            if ((*q)->o_dmd == dm)
+                *q = (*q)->o_thread;
+            else
+                q = &(*q)->o_thread;
+        }
+    }
+}
+#endif
+
+
 /*
 **  makopn - make an open file for sft handle h
 **
@@ -281,15 +362,19 @@ static long makopn(FCB *f, DND *dn, int h, int mod)
 
     p->o_mod = mod;                 /*  set mode                    */
     p->o_dmd = dm;                  /*  link OFD to media           */
-    sft[h-NUMSTD].f_ofd = p;
+    SFT(h-NUMSTD)->f_ofd = p;
     /* no need to zero o_curcl & o_curbyt, since MGET zeroes the OFD */
     p->o_dnode = dn;                /*  link to directory           */
     p->o_dirfil = dn->d_ofd;        /*  link to dir's OFD           */
     p->o_dirbyt = dn->d_ofd->o_bytnum - sizeof(FCB);    /* offset of fcb in dir */
 
+#if CONF_WITH_SFT_GROW
+    p2 = ofdlookup(dn, p->o_dirbyt);
+#else
     for (p2 = dn->d_files; p2; p2 = p2->o_link)
         if (p2->o_dirbyt == p->o_dirbyt)
             break;              /* same dir, same dcnt */
+#endif
 
     p->o_link = dn->d_files;
     dn->d_files = p;
@@ -303,8 +388,6 @@ static long makopn(FCB *f, DND *dn, int h, int mod)
     {
         dfd = p2->o_dfd;
         dfd->o_usecnt++;                /* more than one user of DFD! */
-        /* not used yet... TBA *********/
-        p2->o_thread = p;
     }
     else
     {
@@ -312,10 +395,12 @@ static long makopn(FCB *f, DND *dn, int h, int mod)
         dfd->o_usecnt = 1;              /* only OFD using this DFD */
         dfd->o_td.date = f->f_td.date;  /* note: OFD time/date are  */
         dfd->o_td.time = f->f_td.time;  /*  actually little-endian! */
-        dfd->o_strtcl = f->f_clust;     /* 1st cluster of file */
-        swpw(dfd->o_strtcl);
+        dfd->o_strtcl = fcb_getcl(f,dm);    /* 1st cluster of file */
         dfd->o_fileln = f->f_fileln;    /* init length of file */
         swpl(dfd->o_fileln);
+#if CONF_WITH_SFT_GROW
+        ofdhashadd(p);
+#endif
     }
 
     p->o_dfd = dfd;                     /* for future reference ... */
@@ -338,15 +423,11 @@ static long opnfil(FCB *f, DND *dn, int mod)
     int h;
 
     /* find free sft handle */
-    for (i = 0; i < OPNFILES; i++)
-        if( !sft[i].f_own )
-            break;
-
-    if (i == OPNFILES)
+    i = sftalloc();
+    if (i < 0)
         return ENHNDL;
 
-    sft[i].f_own = run;
-    sft[i].f_use = 1;
+    SFT(i)->f_use = 1;
     h = i + NUMSTD;
 
     return makopn(f, dn, h, mod);
@@ -364,9 +445,12 @@ static FTAB *sftofdsrch(OFD *ofd)
     FTAB *sftp;     /* scan ptr for sft */
     int i;
 
-    for (i = 0, sftp = sft; i < OPNFILES; i++, sftp++)
+    for (i = 0; i < SFTNUM; i++)
+    {
+        sftp = SFT(i);
         if (sftp->f_ofd == ofd)
             return sftp;
+    }
 
     return NULL;
 }
@@ -391,9 +475,10 @@ static void sftdel(FTAB *sftp)
 
     /*
      * if there are no other sft entries with same OFD, delete the OFD
-     * (subject to the complication of multiple OFDs pointing to the same file)
+     * (subject to the complication of multiple OFDs pointing to the same file).
+     * only an OFD shared by Fdup() can be in other sft entries.
      */
-    if (sftofdsrch(ofd) == NULL)
+    if (!(ofd->o_mod & O_SHARED) || (sftofdsrch(ofd) == NULL))
     {
         d = ofd->o_dfd;
         if (d->o_usecnt > 0)        /* paranoia */
@@ -405,6 +490,9 @@ static void sftdel(FTAB *sftp)
         if (d->o_usecnt == 0)       /* no more users of this file */
         {
             ofd = (OFD *)((char *)d - offsetof(OFD, o_disk));
+#if CONF_WITH_SFT_GROW
+            ofdunhash(ofd);
+#endif
             xmfreblk(ofd);          /* delete the 'base OFD' */
         }
     }
@@ -459,7 +547,7 @@ long xclose(int h)
     }
     else
     {
-        ftab = &sft[h-NUMSTD];
+        ftab = SFT(h-NUMSTD);
 
         if ((long)ftab->f_ofd < 0L)
         {
@@ -481,6 +569,16 @@ long xclose(int h)
     if (!(fd = getofd(h)))
         return EIHNDL;
 
+#if CONF_WITH_FPREALLOC
+    /*
+     * on the last close of a file, release any clusters preallocated
+     * by Fprealloc() that have not been written
+     */
+    if ((fd->o_dfd->o_flag & O_PREALLOC) && (fd->o_dfd->o_usecnt == 1)
+     && (SFT(h-NUMSTD)->f_use == 1))
+        prealloc_trim(fd);
+#endif
+
     rc = ixclose(fd,0);
 
     /*
@@ -488,7 +586,7 @@ long xclose(int h)
      * sft[] entry and, if there are no other entries with a pointer to
      * the OFD for this handle, free up the OFD
      */
-    ftab = &sft[h-NUMSTD];
+    ftab = SFT(h-NUMSTD);
     if (--ftab->f_use == 0)
         sftdel(ftab);
 
@@ -511,8 +609,10 @@ long xclose(int h)
 long ixclose(OFD *fd, int part)
 {                                   /*  M01.01.03                   */
     OFD *p, **q;
+#if !CONF_WITH_BDOS_WRITEBACK
     int i;                          /*  M01.01.03                   */
     BCB *b;
+#endif
     DFD *dfd = fd->o_dfd;
 
     /*
@@ -535,8 +635,9 @@ long ixclose(OFD *fd, int part)
         ixlseek(fd->o_dirfil,fd->o_dirbyt); /* start of dir entry */
         fcb = ixgetfcb(fd->o_dirfil);
         attr = fcb->f_attrib;               /* get attributes */
-        memcpy(&fcb->f_td,&dfd->o_td,10);   /* copy date/time, start, length */
-        swpw(fcb->f_clust);                 /*  & fixup byte order */
+        fcb->f_td = dfd->o_td;              /* copy date/time, start, length */
+        fcb_setcl(fcb,dfd->o_strtcl,fd->o_dmd); /*  & fixup byte order */
+        fcb->f_fileln = dfd->o_fileln;
         swpl(fcb->f_fileln);
 
         if (part & CL_DIR)
@@ -573,10 +674,17 @@ long ixclose(OFD *fd, int part)
      * partitioned hard disks.  however this would cost code space and,
      * in practice, flushing usually takes place to one drive only.
      */
+#if CONF_WITH_FAT32
+    fsinfo_flush(-1);
+#endif
+#if CONF_WITH_BDOS_WRITEBACK
+    bufl_flush(-1);
+#else
     for (i = BI_FAT; i <= BI_DATA; i++)
         for (b = bufl[i]; b; b = b->b_link)
             if ((b->b_bufdrv != -1) && b->b_dirty)
                 flush(b);
+#endif
 
     return E_OK;
 }
@@ -592,6 +700,10 @@ static long ixunlink(char *name)
     const char *s;
     long pos;
 
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+    dirchgcnt++;                /* invalidate cached directory listings */
+#endif
+
     /* first find path */
 
     dn = findit(name,&s,0);
@@ -653,34 +765,46 @@ long ixdel(DND *dn, FCB *f, long pos)
 {
     OFD *fd;
     DMD *dm;
-    int n2;
+    CLNO cl;
     int n;
     char c;
 
     for (fd = dn->d_files; fd; fd = fd->o_link)
         if (fd->o_dirbyt == pos)
-            for (n = 0; n < OPNFILES; n++)
-                if (sft[n].f_ofd == fd)
+            for (n = 0; n < SFTNUM; n++)
+                if (SFT(n)->f_ofd == fd)
                 {
-                    if (sft[n].f_own == run)
+                    if (SFT(n)->f_own == run)
+                    {
+#if CONF_WITH_SFT_GROW
+                        ofdunhash(fd);  /* the FCB is about to be reused */
+#endif
                         ixclose(fd,0);
+                    }
                     else
                         return EACCDN;
                 }
 
+#if CONF_WITH_BDOS_NAMECACHE
+    namecache_forget(dn,f->f_name);
+#endif
+
     /*
      * Traverse this file's chain of allocated clusters, freeing them.
      */
     dm = dn->d_drv;
-    n = f->f_clust;
-    swpw(n);
-
-    while (n && !endofchain(n))
-    {
-        n2 = getrealcl(n,dm);
-        clfix(n,FREECLUSTER,dm);
-        n = n2;
-    }
+    cl = fcb_getcl(f,dm);
+#if CONF_WITH_BDOS_EXTENTS
+    if (cl)
+        extent_discard(dm,cl);
+#endif
+#if CONF_WITH_PGM_CACHE
+    if (cl)
+        pgmcache_discard(dm,cl);
+#endif
+
+    if (cl && !endofchain(cl))
+        clfree(cl,dm);
 
     /*
      * Mark the directory entry as erased.
@@ -18,24 +18,371 @@
 #include "bdosstub.h"
 
 
+#if CONF_WITH_MEMINFO
 /*
- *  STATIUMEM - cond comp; set to true to count calls to these routines
+ *  counters for Smeminfo()
  */
-#define STATIUMEM   FALSE
+static MEMSTATS memstats[2];    /* for pmd & pmdalt */
 
-#if STATIUMEM
-long ccffit;
-long ccfreeit;
+MEMSTATS *mpb_stats(MPB *mp)
+{
+#if CONF_WITH_ALT_RAM
+    if (mp == &pmdalt)
+        return &memstats[1];
+#endif
+    return &memstats[0];
+}
+
+#define COUNT(mp,counter)   (mpb_stats(mp)->counter++)
+#else
+#define COUNT(mp,counter)   ((void)0)
+#endif
+
+
+/*
+ *  round_amount - round the size up to a multiple of 2 or 4 bytes to
+ *  keep alignment; alignment on long boundaries is faster in FastRAM
+ */
+static long round_amount(long amount, MPB *mp)
+{
+    if (mp == &pmd)
+        return (amount + malloc_align_stram) & ~malloc_align_stram;
+
+    return (amount + MALLOC_ALIGN_ALTRAM) & ~MALLOC_ALIGN_ALTRAM;
+}
+
+
+#if CONF_WITH_MEMTREE
+
+/*
+ *  The MD index
+ *
+ *  To avoid walking the free and allocated lists of an MPB for every
+ *  Malloc()/Mfree(), both lists are kept in ascending address order and
+ *  are indexed by a treap: a binary search tree on m_start, kept balanced
+ *  by a pseudo-random priority derived from the address of each MD.  In
+ *  the tree of free MDs, each node also holds the size of the largest
+ *  block in its subtree (m_max), so the lowest-addressed block that is
+ *  large enough (the block that the traditional first-fit search finds)
+ *  is located in logarithmic time, and Malloc(-1) needs no search at all.
+ *
+ *  The lists remain the real data: the MPBs are visible via Getmpb(),
+ *  and some of our own code edits them directly.  Any such change must
+ *  be followed by a call to mpb_changed(), and the index is rebuilt from
+ *  the lists the next time it is needed.
+ */
+typedef struct
+{
+    MD      *free;      /* root of the tree of free MDs */
+    MD      *alloc;     /* root of the tree of allocated MDs */
+    BOOL    valid;      /* FALSE => rebuild from the lists */
+} MDINDEX;
+
+#if CONF_WITH_ALT_RAM
+static MDINDEX mdindex[2];  /* for pmd & pmdalt */
+#else
+static MDINDEX mdindex[1];  /* for pmd */
 #endif
 
+#define LEFT(m)     (((MDEXT *)(m))->x_left)
+#define RIGHT(m)    (((MDEXT *)(m))->x_right)
+
+
+/*
+ *  prio - treap priority of an MD
+ */
+static UWORD prio(const MD *m)
+{
+    ULONG x = (ULONG)m;
+
+    x = (x ^ (x >> 16)) * 0x45d9f3bUL;
+    return (UWORD)(x ^ (x >> 16));
+}
+
+
+/*
+ *  fixmax - recompute m_max for a node of the tree of free MDs
+ */
+static void fixmax(MD *m)
+{
+    LONG max = m->m_length;
+
+    if (LEFT(m) && (LEFT(m)->m_max > max))
+        max = LEFT(m)->m_max;
+    if (RIGHT(m) && (RIGHT(m)->m_max > max))
+        max = RIGHT(m)->m_max;
+    m->m_max = max;
+}
+
+
+/*
+ *  tree_insert - insert MD 'n' into the tree 't', returns the new root
+ *
+ *  'isfree' must be set for the tree of free MDs only: for allocated
+ *  MDs, m_max overlays m_own.
+ */
+static MD *tree_insert(MD *t, MD *n, BOOL isfree)
+{
+    MD *c;
+
+    if (!t)
+    {
+        LEFT(n) = RIGHT(n) = NULL;
+        if (isfree)
+            n->m_max = n->m_length;
+        return n;
+    }
+
+    if (n->m_start < t->m_start)
+    {
+        c = LEFT(t) = tree_insert(LEFT(t), n, isfree);
+        if (prio(c) > prio(t))
+        {
+            LEFT(t) = RIGHT(c);     /* rotate right */
+            RIGHT(c) = t;
+            if (isfree)
+                fixmax(t);
+            t = c;
+        }
+    }
+    else
+    {
+        c = RIGHT(t) = tree_insert(RIGHT(t), n, isfree);
+        if (prio(c) > prio(t))
+        {
+            RIGHT(t) = LEFT(c);     /* rotate left */
+            LEFT(c) = t;
+            if (isfree)
+                fixmax(t);
+            t = c;
+        }
+    }
+
+    if (isfree)
+        fixmax(t);
+
+    return t;
+}
+
+
+/*
+ *  tree_merge - join two trees, all of 'a' being below all of 'b'
+ */
+static MD *tree_merge(MD *a, MD *b, BOOL isfree)
+{
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+
+    if (prio(a) > prio(b))
+    {
+        RIGHT(a) = tree_merge(RIGHT(a), b, isfree);
+        if (isfree)
+            fixmax(a);
+        return a;
+    }
+
+    LEFT(b) = tree_merge(a, LEFT(b), isfree);
+    if (isfree)
+        fixmax(b);
+    return b;
+}
+
+
+/*
+ *  tree_remove - remove MD 'n' from the tree 't', returns the new root
+ */
+static MD *tree_remove(MD *t, MD *n, BOOL isfree)
+{
+    if (!t)
+        return NULL;
+
+    if (t == n)
+        return tree_merge(LEFT(n), RIGHT(n), isfree);
+
+    if (n->m_start < t->m_start)
+        LEFT(t) = tree_remove(LEFT(t), n, isfree);
+    else
+        RIGHT(t) = tree_remove(RIGHT(t), n, isfree);
+
+    if (isfree)
+        fixmax(t);
+
+    return t;
+}
+
+
+/*
+ *  tree_find - find the MD for a given start address
+ */
+static MD *tree_find(MD *t, const UBYTE *addr)
+{
+    while (t && (t->m_start != addr))
+        t = (addr < t->m_start) ? LEFT(t) : RIGHT(t);
+
+    return t;
+}
+
+
+/*
+ *  tree_pred - find the highest MD starting below a given address
+ */
+static MD *tree_pred(MD *t, const UBYTE *addr)
+{
+    MD *pred = NULL;
+
+    while (t)
+    {
+        if (t->m_start < addr)
+        {
+            pred = t;
+            t = RIGHT(t);
+        }
+        else
+            t = LEFT(t);
+    }
+
+    return pred;
+}
+
+
+/*
+ *  tree_firstfit - find the lowest MD with at least 'amount' bytes
+ */
+static MD *tree_firstfit(MD *t, LONG amount)
+{
+    if (!t || (t->m_max < amount))
+        return NULL;
+
+    for (;;)
+    {
+        if (LEFT(t) && (LEFT(t)->m_max >= amount))
+            t = LEFT(t);
+        else if (t->m_length >= amount)
+            return t;
+        else
+            t = RIGHT(t);
+    }
+}
+
+
+/*
+ *  tree_relink - rebuild a list in ascending sequence from a tree
+ */
+static void tree_relink(MD *t, MD **list)
+{
+    for ( ; t; t = LEFT(t))
+    {
+        tree_relink(RIGHT(t), list);
+        t->m_link = *list;
+        *list = t;
+    }
+}
+
+
+/*
+ *  tree_build - index a list, which is then sorted
+ */
+static MD *tree_build(MD **list, BOOL isfree)
+{
+    MD *m, *next, *t = NULL;
+
+    for (m = *list; m; m = next)
+    {
+        next = m->m_link;
+        t = tree_insert(t, m, isfree);
+    }
+
+    *list = NULL;
+    tree_relink(t, list);
+
+    return t;
+}
+
+
+/*
+ *  get_index - get the (valid) index for an MPB
+ */
+static MDINDEX *get_index(MPB *mp)
+{
+    MDINDEX *ix = &mdindex[0];
+
+#if CONF_WITH_ALT_RAM
+    if (mp == &pmdalt)
+        ix = &mdindex[1];
+#endif
+
+    if (!ix->valid)
+    {
+        KDEBUG(("BDOS get_index: rebuilding index for mp=%p\n",mp));
+        ix->free = tree_build(&mp->mp_mfl, TRUE);
+        ix->alloc = tree_build(&mp->mp_mal, FALSE);
+        ix->valid = TRUE;
+    }
+
+    return ix;
+}
+
+
+/*
+ *  mpb_changed - invalidate the index of an MPB
+ */
+void mpb_changed(MPB *mp)
+{
+#if CONF_WITH_ALT_RAM
+    if (mp == &pmdalt)
+    {
+        mdindex[1].valid = FALSE;
+        return;
+    }
+#endif
+    mdindex[0].valid = FALSE;
+}
+
+
+/*
+ *  list_insert - insert MD 'n' in a list after 'pred' (NULL => at start)
+ */
+static void list_insert(MD **list, MD *pred, MD *n)
+{
+    MD **q = pred ? &pred->m_link : list;
+
+    n->m_link = *q;
+    *q = n;
+}
+
+
+/*
+ *  list_remove - remove MD 'n' from a list, 'pred' precedes it
+ */
+static void list_remove(MD **list, MD *pred, MD *n)
+{
+    MD **q = pred ? &pred->m_link : list;
+
+    *q = n->m_link;
+}
+
+
+/*
+ *  alloc_insert - add an MD to the allocated list & its index
+ */
+static void alloc_insert(MPB *mp, MDINDEX *ix, MD *m)
+{
+    list_insert(&mp->mp_mal, tree_pred(ix->alloc, m->m_start), m);
+    ix->alloc = tree_insert(ix->alloc, m, FALSE);
+}
+
+
+static MD *take_block(MPB *mp, MDINDEX *ix, MD *p, MD *q, long amount);
 
 /*
  *  ffit - find first fit for requested memory in ospool
  */
 MD *ffit(long amount, MPB *mp)
 {
-    MD *p, *q, *p1;     /* free list is composed of MD's */
-    LONG maxval;
+    MDINDEX *ix;
+    MD *p, *q;
 
 #ifdef ENABLE_KDEBUG
     if (mp == &pmd)
@@ -49,14 +396,266 @@ MD *ffit(long amount, MPB *mp)
 #endif
     KDEBUG(("BDOS ffit: requested=%ld\n",amount));
 
-#if STATIUMEM
-    ++ccffit;
+    COUNT(mp, ms_ffit);
+
+    ix = get_index(mp);
+    if (!ix->free)
+    {
+        KDEBUG(("BDOS ffit: null free list ptr\n"));
+        if (amount != -1L)
+            COUNT(mp, ms_failed);
+        return NULL;
+    }
+
+    /*
+     * handle request for maximum free block
+     */
+    if (amount == -1L)
+    {
+        KDEBUG(("BDOS ffit: maxval=%ld\n",ix->free->m_max));
+        return (MD *)ix->free->m_max;
+    }
+
+    if (mp == &pmd)
+        KDEBUG(("Malloc(%lu) from ST-RAM\n", amount));
+
+    amount = round_amount(amount, mp);
+
+    /*
+     * look for first free space that's large enough
+     */
+    q = tree_firstfit(ix->free, amount);
+    if (!q)
+    {
+        KDEBUG(("BDOS ffit: Not enough contiguous memory\n"));
+        COUNT(mp, ms_failed);
+        return NULL;
+    }
+    p = tree_pred(ix->free, q->m_start);
+
+    return take_block(mp, ix, p, q, amount);
+}
+
+
+/*
+ *  ffit_aligned - like ffit(), but the block starts at a multiple of
+ *  'align' (a power of 2)
+ *
+ *  the free memory before the aligned start stays on the free list
+ */
+MD *ffit_aligned(long amount, MPB *mp, LONG align)
+{
+    MDINDEX *ix;
+    MD *p, *q, *p1;
+    LONG slack = 0;
+
+    KDEBUG(("BDOS ffit_aligned: requested=%ld, align=%ld\n",amount,align));
+
+    COUNT(mp, ms_ffit);
+
+    ix = get_index(mp);
+    amount = round_amount(amount, mp);
+
+    /*
+     * look for the first free block that can hold an aligned block
+     */
+    for (p = NULL, q = mp->mp_mfl; q; p = q, q = q->m_link)
+    {
+        slack = -(LONG)q->m_start & (align - 1);
+        if (q->m_length >= slack + amount)
+            break;
+    }
+    if (!q)
+    {
+        KDEBUG(("BDOS ffit_aligned: Not enough contiguous memory\n"));
+        COUNT(mp, ms_failed);
+        return NULL;
+    }
+
+    /*
+     * describe the memory before the aligned start by a new free MD
+     */
+    if (slack)
+    {
+        if ((p1=xmgetmd()) == NULL)
+        {
+            KDEBUG(("BDOS ffit_aligned: null MGET\n"));
+            COUNT(mp, ms_failed);
+            return NULL;
+        }
+
+        ix->free = tree_remove(ix->free, q, TRUE);
+        p1->m_start = q->m_start;
+        p1->m_length = slack;
+        q->m_start += slack;
+        q->m_length -= slack;
+        list_insert(&mp->mp_mfl, p, p1);
+        ix->free = tree_insert(ix->free, p1, TRUE);
+        ix->free = tree_insert(ix->free, q, TRUE);
+        p = p1;
+    }
+
+    return take_block(mp, ix, p, q, amount);
+}
+
+
+/*
+ *  take_block - allocate 'amount' bytes from the start of free MD 'q',
+ *  'p' preceding it in the free list
+ */
+static MD *take_block(MPB *mp, MDINDEX *ix, MD *p, MD *q, long amount)
+{
+    MD *p1;
+
+    if (q->m_length == amount)
+        list_remove(&mp->mp_mfl, p, q); /* take the whole thing */
+    else
+    {
+        /* break it up - 1st allocate a new MD to describe the remainder */
+        if ((p1=xmgetmd()) == NULL)
+        {
+            KDEBUG(("BDOS ffit: null MGET\n"));
+            COUNT(mp, ms_failed);
+            return NULL;
+        }
+
+        /* init new MD for remaining memory on free chain */
+        p1->m_length = q->m_length - amount;
+        p1->m_start = q->m_start + amount;
+        list_remove(&mp->mp_mfl, p, q);
+        list_insert(&mp->mp_mfl, p, p1);
+        ix->free = tree_insert(ix->free, p1, TRUE);
+
+        /* adjust old MD for allocated memory on allocated chain */
+        q->m_length = amount;
+    }
+    ix->free = tree_remove(ix->free, q, TRUE);
+
+    /*
+     * link allocated block into allocated list & mark owner of block
+     */
+    alloc_insert(mp, ix, q);
+    q->m_own = run;
+
+    KDEBUG(("BDOS ffit: start=%p, length=%ld\n",q->m_start,q->m_length));
+    return q;
+}
+
+
+/*
+ *  freeit - Free up a memory descriptor
+ */
+void freeit(MD *m, MPB *mp)
+{
+    MDINDEX *ix;
+    MD *p, *q, *f;
+
+#ifdef ENABLE_KDEBUG
+    if (mp == &pmd)
+        KDEBUG(("BDOS freeit: mp=&pmd\n"));
+#if CONF_WITH_ALT_RAM
+    else if (mp == &pmdalt)
+        KDEBUG(("BDOS freeit: mp=&pmdalt\n"));
+#endif /* CONF_WITH_ALT_RAM */
+    else
+        KDEBUG(("BDOS freeit: mp=%p\n",mp));
 #endif
+    KDEBUG(("BDOS freeit: start=%p, length=%ld\n",m->m_start,m->m_length));
+
+    COUNT(mp, ms_freeit);
+
+    /*
+     * first, find it in the allocated list
+     */
+    ix = get_index(mp);
+    p = tree_find(ix->alloc, m->m_start);
+    if (!p)
+    {
+        KDEBUG(("BDOS freeit: invalid MD address %p\n",m));
+        return;
+    }
+
+    /*
+     * snip it out
+     */
+    list_remove(&mp->mp_mal, tree_pred(ix->alloc, p->m_start), p);
+    ix->alloc = tree_remove(ix->alloc, p, FALSE);
+
+    /*
+     * find its neighbours in the free list
+     *
+     * q -> next lower block, f -> next higher block
+     */
+    q = tree_pred(ix->free, p->m_start);
+    f = q ? q->m_link : mp->mp_mfl;
+
+    /*
+     * coalesce free blocks if possible, else insert it
+     */
+    if (f)
+        if (p->m_start + p->m_length == f->m_start)
+        { /* join to higher neighbor */
+            p->m_length += f->m_length;
+            list_remove(&mp->mp_mfl, q, f);
+            ix->free = tree_remove(ix->free, f, TRUE);
+            xmfremd(f);
+        }
+
+    if (q && (q->m_start + q->m_length == p->m_start))
+    { /* join to lower neighbor */
+        ix->free = tree_remove(ix->free, q, TRUE);
+        q->m_length += p->m_length;
+        ix->free = tree_insert(ix->free, q, TRUE);
+        xmfremd(p);
+    }
+    else
+    {
+        list_insert(&mp->mp_mfl, q, p);
+        ix->free = tree_insert(ix->free, p, TRUE);
+    }
+}
+
+
+/*
+ *  mdfind - find the allocated MD for a memory block
+ */
+MD *mdfind(MPB *mp, const UBYTE *addr)
+{
+    return tree_find(get_index(mp)->alloc, addr);
+}
+
+#else
+
+static MD *take_block(MPB *mp, MD *p, MD *q, long amount);
+
+/*
+ *  ffit - find first fit for requested memory in ospool
+ */
+MD *ffit(long amount, MPB *mp)
+{
+    MD *p, *q;          /* free list is composed of MD's */
+    LONG maxval;
+
+#ifdef ENABLE_KDEBUG
+    if (mp == &pmd)
+        KDEBUG(("BDOS ffit: mp=&pmd\n"));
+#if CONF_WITH_ALT_RAM
+    else if (mp == &pmdalt)
+        KDEBUG(("BDOS ffit: mp=&pmdalt\n"));
+#endif /* CONF_WITH_ALT_RAM */
+    else
+        KDEBUG(("BDOS ffit: mp=%p\n",mp));
+#endif
+    KDEBUG(("BDOS ffit: requested=%ld\n",amount));
+
+    COUNT(mp, ms_ffit);
 
     p = (MD *)mp;
     if ((q = mp->mp_mfl) == NULL)   /* get free list pointer */
     {
         KDEBUG(("BDOS ffit: null free list ptr\n"));
+        if (amount != -1L)
+            COUNT(mp, ms_failed);
         return NULL;
     }
 
@@ -76,14 +675,7 @@ MD *ffit(long amount, MPB *mp)
     if (mp == &pmd)
         KDEBUG(("Malloc(%lu) from ST-RAM\n", amount));
 
-    /*
-     * round the size up to a multiple of 2 or 4 bytes to keep alignment;
-     * alignment on long boundaries is faster in FastRAM
-     */
-    if (mp == &pmd)
-        amount = (amount + malloc_align_stram) & ~malloc_align_stram;
-    else
-        amount = (amount + MALLOC_ALIGN_ALTRAM) & ~MALLOC_ALIGN_ALTRAM;
+    amount = round_amount(amount, mp);
 
     /*
      * look for first free space that's large enough
@@ -97,9 +689,80 @@ MD *ffit(long amount, MPB *mp)
     if (!q)
     {
         KDEBUG(("BDOS ffit: Not enough contiguous memory\n"));
+        COUNT(mp, ms_failed);
+        return NULL;
+    }
+
+    return take_block(mp, p, q, amount);
+}
+
+
+/*
+ *  ffit_aligned - like ffit(), but the block starts at a multiple of
+ *  'align' (a power of 2)
+ *
+ *  the free memory before the aligned start stays on the free list
+ */
+MD *ffit_aligned(long amount, MPB *mp, LONG align)
+{
+    MD *p, *q, *p1;
+    LONG slack = 0;
+
+    KDEBUG(("BDOS ffit_aligned: requested=%ld, align=%ld\n",amount,align));
+
+    COUNT(mp, ms_ffit);
+
+    amount = round_amount(amount, mp);
+
+    /*
+     * look for the first free block that can hold an aligned block
+     */
+    for (p = (MD *)mp, q = mp->mp_mfl; q; p = q, q = p->m_link)
+    {
+        slack = -(LONG)q->m_start & (align - 1);
+        if (q->m_length >= slack + amount)
+            break;
+    }
+    if (!q)
+    {
+        KDEBUG(("BDOS ffit_aligned: Not enough contiguous memory\n"));
+        COUNT(mp, ms_failed);
         return NULL;
     }
 
+    /*
+     * describe the memory before the aligned start by a new free MD
+     */
+    if (slack)
+    {
+        if ((p1=xmgetmd()) == NULL)
+        {
+            KDEBUG(("BDOS ffit_aligned: null MGET\n"));
+            COUNT(mp, ms_failed);
+            return NULL;
+        }
+
+        p1->m_start = q->m_start;
+        p1->m_length = slack;
+        q->m_start += slack;
+        q->m_length -= slack;
+        p1->m_link = q;
+        p->m_link = p1;
+        p = p1;
+    }
+
+    return take_block(mp, p, q, amount);
+}
+
+
+/*
+ *  take_block - allocate 'amount' bytes from the start of free MD 'q',
+ *  'p' preceding it in the free list
+ */
+static MD *take_block(MPB *mp, MD *p, MD *q, long amount)
+{
+    MD *p1;
+
     if (q->m_length == amount)
         p->m_link = q->m_link;  /* take the whole thing */
     else
@@ -113,6 +776,7 @@ MD *ffit(long amount, MPB *mp)
         if ((p1=xmgetmd()) == NULL)
         {
             KDEBUG(("BDOS ffit: null MGET\n"));
+            COUNT(mp, ms_failed);
             return NULL;
         }
 
@@ -157,9 +821,7 @@ void freeit(MD *m, MPB *mp)
 #endif
     KDEBUG(("BDOS freeit: start=%p, length=%ld\n",m->m_start,m->m_length));
 
-#if STATIUMEM
-    ++ccfreeit;
-#endif
+    COUNT(mp, ms_freeit);
 
     /*
      * first, find it in the allocated list
@@ -222,6 +884,23 @@ void freeit(MD *m, MPB *mp)
 }
 
 
+/*
+ *  mdfind - find the allocated MD for a memory block
+ */
+MD *mdfind(MPB *mp, const UBYTE *addr)
+{
+    MD *p;
+
+    for (p = mp->mp_mal; p; p = p->m_link)
+        if (p->m_start == addr)
+            break;
+
+    return p;
+}
+
+#endif /* CONF_WITH_MEMTREE */
+
+
 /*
  *  shrinkit - Shrink a memory descriptor
  */
@@ -245,8 +924,12 @@ WORD shrinkit(MD *m, MPB *mp, LONG newlen)
     /*
      * Add it to the allocated list.
      */
+#if CONF_WITH_MEMTREE
+    alloc_insert(mp, get_index(mp), f);
+#else
     f->m_link = mp->mp_mal;
     mp->mp_mal = f;
+#endif
 
     /*
      * Update existing memory descriptor.
@@ -2,7 +2,7 @@
  * kpgmld.c - program load
  *
  * Copyright (C) 2001 Lineo, Inc.
- *               2013-2022 The EmuTOS development team
+ *               2013-2026 The EmuTOS development team
  *
  * Authors:
  *  SCC  Steven C. Cavender
@@ -20,6 +20,9 @@
 #include "gemerror.h"
 #include "pghdr.h"
 #include "string.h"
+#include "mem.h"
+#include "bdosstub.h"
+#include "biosext.h"
 
 
 /*
@@ -27,7 +30,65 @@
  */
 
 static LONG pgmld01(FH h, PD *pdptr, PGMHDR01 *hd);
-static LONG pgfix01(UBYTE *lastcp, LONG nrelbytes, PGMINFO *pi);
+static LONG pgfix01(UBYTE **cpp, const UBYTE *rp, LONG nrelbytes, PGMINFO *pi);
+
+
+#if CONF_WITH_PGM_CACHE
+/*
+ * program cache
+ *
+ * the (unrelocated) TEXT & DATA segments and the relocation info of the
+ * programs most recently loaded are kept in Alt-RAM, so that when they
+ * are run again, they can be loaded without reading the file.  an entry
+ * is identified by the drive, starting cluster, date/time & length of the
+ * file, so that it is no longer used once the file has been rewritten.
+ */
+#define NUM_PGM_CACHE   4
+
+typedef struct {
+    UBYTE   *image;     /* TEXT+DATA then relocation info, NULL => entry unused */
+    DMD     *dmd;       /* media descriptor for file */
+    CLNO    strtcl;     /* starting cluster of file */
+    DOSTIME td;         /* date/time of file */
+    LONG    fileln;     /* length of file */
+    LONG    flen;       /* length of TEXT+DATA */
+    LONG    rellen;     /* length of relocation info (including 1st offset) */
+    UWORD   lastuse;    /* for LRU replacement */
+#if CONF_WITH_SHARED_TEXT
+    WORD    share;      /* 0 => not checked, 1 => TEXT shared, -1 => can't be */
+    WORD    refs;       /* number of processes using the shared TEXT */
+#endif
+} PGMCACHE;
+
+static PGMCACHE pgmcache[NUM_PGM_CACHE];
+static UWORD pgmcache_clock;
+static UBYTE *pgmcache_pending; /* image being read, freed by pgmcache_abort() */
+
+static PGMCACHE *pgmcache_get(FH h, PGMHDR01 *hd);
+static LONG pgmld_cached(PGMCACHE *pc, PD *pdptr, PGMHDR01 *hd);
+
+#if CONF_WITH_SHARED_TEXT
+/*
+ * shared TEXT segments
+ *
+ * the TEXT segment of a program with the PF_SHTEXT flag is used in place
+ * in its program cache entry, rather than being copied to the TPA, as
+ * long as its fixups only refer to TEXT (i.e. it accesses its DATA & BSS
+ * relative to the basepage or a register).  those fixups are applied to
+ * the cache entry once, and only the DATA segment is copied & relocated
+ * for each process.  the processes using a cache entry are recorded here,
+ * and the entry is not replaced while any of them is running.
+ */
+#define NUM_SHTEXT_USERS    8
+
+static struct {
+    PD          *pd;    /* process, NULL => slot unused */
+    PGMCACHE    *pc;    /* the cache entry holding its TEXT */
+} shtext_user[NUM_SHTEXT_USERS];
+
+static LONG pgmld_shared(PGMCACHE *pc, PD *pdptr, PGMHDR01 *hd);
+#endif
+#endif
 
 /*
  * kpgmhdrld - load program header
@@ -79,8 +140,39 @@ LONG kpgmhdrld(FH h, PGMHDR01 *hd)
 LONG kpgmld(PD *p, FH h, PGMHDR01 *hd)
 {
     LONG r;
+#if CONF_WITH_PGM_CACHE
+    PGMCACHE *pc;
 
+    pc = pgmcache_get(h, hd);
+#if CONF_WITH_SHARED_TEXT
+    if (pc && (hd->h01_flags & PF_SHTEXT))
+    {
+        r = pgmld_shared(pc, p, hd);
+        if (r <= 0)
+            goto done;
+        /*
+         * the TEXT cannot be shared.  if the TEXT in the cache entry has
+         * already been relocated, we must load from the file.
+         */
+        if (pc->share > 0)
+            pc = NULL;
+    }
+#endif
+    if (pc)
+        r = pgmld_cached(pc, p, hd);
+    else
+    {
+        /* pgmcache_get() may have read some of the file */
+        r = xlseek(0x1c, h, 0);
+        if (r >= 0)
+            r = pgmld01(h, p, hd);
+    }
+#if CONF_WITH_SHARED_TEXT
+done:
+#endif
+#else
     r = pgmld01(h, p, hd);
+#endif
 
     KDEBUG(("BDOS pgmld01: return code=0x%lx\n",r));
 
@@ -100,8 +192,9 @@ LONG kpgmld(PD *p, FH h, PGMHDR01 *hd)
  *   it is a longword instead of a byte).
  * - make the first adjustment until we run out of relocation info or
  *   we have an error
- * - read in relocation info into the bss area
- * - call pgfix01() to fix up the code using that info
+ * - read in relocation info into the bss area, as much as will fit
+ * - call pgfix01() to fix up the code using that info, repeating
+ *   the last two steps until the relocation info is exhausted
  * - zero out the bss
  */
 static LONG pgmld01(FH h, PD *pdptr, PGMHDR01 *hd)
@@ -195,8 +288,8 @@ static LONG pgmld01(FH h, PD *pdptr, PGMHDR01 *hd)
                 if (r <= 0)
                     break;
 
-                /*  do fixups using that info  */
-                r = pgfix01(cp, r, pi);
+                /*  do fixups using that info, updating cp  */
+                r = pgfix01(&cp, pi->pi_bbase, r, pi);
                 if (r <= 0)
                     break;
             }
@@ -224,54 +317,477 @@ static LONG pgmld01(FH h, PD *pdptr, PGMHDR01 *hd)
 }
 
 
+#if CONF_WITH_PGM_CACHE
+/*
+ * pgmcache_free - free a program cache entry
+ */
+static void pgmcache_free(PGMCACHE *pc)
+{
+    xmfree(pc->image);
+    pc->image = NULL;
+#if CONF_WITH_SHARED_TEXT
+    pc->share = 0;
+#endif
+}
+
+
+/*
+ * pgmcache_discard - discard the program cache entries for a drive, or
+ * for one file on it if strtcl is not 0, because they may be stale
+ *
+ * this is called on a media change, and when a file is written,
+ * truncated or deleted
+ */
+void pgmcache_discard(DMD *dm, CLNO strtcl)
+{
+    PGMCACHE *pc;
+
+    for (pc = pgmcache; pc < pgmcache+NUM_PGM_CACHE; pc++)
+    {
+        if (!pc->image || (pc->dmd != dm))
+            continue;
+        if (strtcl && (pc->strtcl != strtcl))
+            continue;
+#if CONF_WITH_SHARED_TEXT
+        if (pc->refs)           /* its TEXT is in use: just never match it */
+        {
+            pc->dmd = NULL;
+            continue;
+        }
+#endif
+        pgmcache_free(pc);
+    }
+}
+
+
+/*
+ * pgmcache_abort - free the image being read by pgmcache_get()
+ *
+ * this is called by xexec() when the load longjmp()s out on a disk error
+ */
+void pgmcache_abort(void)
+{
+    if (pgmcache_pending)
+    {
+        xmfree(pgmcache_pending);
+        pgmcache_pending = NULL;
+    }
+}
+
+
+/*
+ * pgmcache_load - read a program file into memory for the cache
+ *
+ * the file is positioned after the header.  returns the length of
+ * relocation info read, or a negative error code.
+ */
+static LONG pgmcache_load(UBYTE *image, FH h, PGMHDR01 *hd, LONG flen, LONG rellen)
+{
+    LONG r;
+
+    r = xread(h, flen, image);
+    if (r != flen)
+        return (r < 0L) ? r : EPLFMT;
+
+    if (rellen)
+    {
+        r = xlseek(flen+hd->h01_slen+0x1c, h, 0);
+        if (r < 0L)
+            return r;
+        rellen = xread(h, rellen, image+flen);
+    }
+
+    return rellen;
+}
+
+
+/*
+ * pgmcache_get - get a program cache entry for a file
+ *
+ * returns a matching entry if there is one, otherwise tries to create
+ * one by reading the file into Alt-RAM.  returns NULL if the program
+ * cannot be cached, and must be loaded normally.
+ */
+static PGMCACHE *pgmcache_get(FH h, PGMHDR01 *hd)
+{
+    PGMCACHE *pc, *lru;
+    OFD *fd;
+    DFD *dfd;
+    UBYTE *image;
+    LONG flen, rellen;
+
+    fd = getofd(h);
+    if (!fd || !fd->o_dfd)
+        return NULL;
+    dfd = fd->o_dfd;
+
+    flen = hd->h01_tlen + hd->h01_dlen;
+    pgmcache_clock++;
+
+    for (pc = pgmcache, lru = NULL; pc < pgmcache+NUM_PGM_CACHE; pc++)
+    {
+        if (!pc->image)
+        {
+            lru = pc;
+            continue;
+        }
+        if ((pc->dmd == fd->o_dmd) && (pc->strtcl == dfd->o_strtcl)
+         && (pc->td.time == dfd->o_td.time) && (pc->td.date == dfd->o_td.date)
+         && (pc->fileln == dfd->o_fileln) && (pc->flen == flen))
+        {
+            KDEBUG(("BDOS pgmcache_get: hit, image at %p\n",pc->image));
+            pc->lastuse = pgmcache_clock;
+            return pc;
+        }
+#if CONF_WITH_SHARED_TEXT
+        if (pc->refs)           /* its TEXT is in use */
+            continue;
+#endif
+        if (!lru || (lru->image && ((UWORD)(pgmcache_clock-pc->lastuse) > (UWORD)(pgmcache_clock-lru->lastuse))))
+            lru = pc;
+    }
+    if (!lru)
+        return NULL;
+
+    /*
+     * not found: see if we can cache it.  we don't use more than half
+     * of the largest free block of Alt-RAM, to leave room for programs.
+     */
+    rellen = hd->h01_abs ? 0L : dfd->o_fileln - (0x1c + flen + hd->h01_slen);
+    if (rellen < 0L)
+        return NULL;
+    if (flen+rellen > PGM_CACHE_MAXLEN)
+        return NULL;
+    if (flen+rellen > (LONG)xmxalloc(-1L, MX_TTRAM) / 2)
+        return NULL;
+
+    /*
+     * until it has been loaded, the memory belongs to the current process;
+     * if a disk error occurs during the load, pgmcache_abort() frees it.
+     * the LRU entry is only replaced once the new one is complete.
+     */
+    image = xmxalloc(flen+rellen, MX_TTRAM);
+    if (!image)
+        return NULL;
+    pgmcache_pending = image;
+    rellen = pgmcache_load(image, h, hd, flen, rellen);
+    pgmcache_pending = NULL;
+    if (rellen < 0L)
+    {
+        xmfree(image);
+        return NULL;
+    }
+    set_owner(image, NULL);         /* it must survive the current process */
+
+    if (lru->image)
+        pgmcache_free(lru);
+    pc = lru;
+
+    pc->image = image;
+    pc->dmd = fd->o_dmd;
+    pc->strtcl = dfd->o_strtcl;
+    pc->td = dfd->o_td;
+    pc->fileln = dfd->o_fileln;
+    pc->flen = flen;
+    pc->rellen = rellen;
+    pc->lastuse = pgmcache_clock;
+    KDEBUG(("BDOS pgmcache_get: cached %ld+%ld bytes at %p\n",pc->flen,pc->rellen,pc->image));
+
+    return pc;
+}
+
+
+/*
+ * pgmld_cached - load a program from the program cache
+ *
+ * this is the equivalent of pgmld01(), but copies the program from
+ * the cache entry rather than reading the file
+ */
+static LONG pgmld_cached(PGMCACHE *pc, PD *pdptr, PGMHDR01 *hd)
+{
+    PGMINFO *pi;
+    PD      *p;
+    PGMINFO pinfo;
+    UBYTE   *cp;
+    LONG    relst;
+    LONG    flen;
+
+    pi = &pinfo;
+    p = pdptr;
+
+    /* calculate program load info */
+
+    pi->pi_tlen=hd->h01_tlen;
+    pi->pi_dlen=hd->h01_dlen;
+    flen = pi->pi_tlen + pi->pi_dlen;
+
+    pi->pi_blen = hd->h01_blen;
+    pi->pi_slen = hd->h01_slen;
+    pi->pi_tpalen = p->p_hitpa - p->p_lowtpa - sizeof(PD);
+    pi->pi_tbase = (UBYTE *) (p+1);     /*  1st byte after PD   */
+    pi->pi_bbase = pi->pi_tbase + flen;
+    pi->pi_dbase = pi->pi_tbase + pi->pi_tlen;
+
+    if ((flen > pi->pi_tpalen) || (pi->pi_tpalen-flen < pi->pi_blen))
+        return ENSMEM;
+
+    /* initialize PD fields */
+
+    memcpy(&p->p_tbase, &pi->pi_tbase, 6 * sizeof(long));
+
+    /* copy the text and data */
+
+    memcpy(pi->pi_tbase, pc->image, flen);
+
+    /* do the fixups, exactly as for pgmld01() */
+
+    if (pc->rellen >= (LONG)sizeof(relst))
+    {
+        memcpy(&relst, pc->image+flen, sizeof(relst));
+        if (relst != 0)
+        {
+            cp = pi->pi_tbase + relst;
+
+            /*  make sure we didn't wrap memory or overrun the bss  */
+
+            if ((cp < pi->pi_tbase) || (cp >= pi->pi_bbase))
+                return EPLFMT;
+
+            *((long *)(cp)) += (long)pi->pi_tbase ; /*  1st fixup     */
+
+            if (pgfix01(&cp, pc->image+flen+sizeof(relst), pc->rellen-sizeof(relst), pi) < 0)
+                return EPLFMT;
+        }
+    }
+
+    /* clear the bss or the whole heap */
+
+    if (hd->h01_flags & PF_FASTLOAD)
+    {
+        flen =  pi->pi_blen;                            /* clear only the bss */
+    }
+    else
+    {
+        flen = (long)p->p_hitpa - (long)pi->pi_bbase;   /* clear the whole heap */
+    }
+    if (flen > 0)
+        bzero(pi->pi_bbase, flen);
+
+    return 0;
+}
+
+
+#if CONF_WITH_SHARED_TEXT
+/* values of 'pass' for shtext_fixups() */
+#define FIX_CHECK   0   /* check that the TEXT fixups only refer to TEXT */
+#define FIX_TEXT    1   /* apply the TEXT fixups to the cache entry */
+#define FIX_DATA    2   /* apply the DATA fixups to the copy at 'dbase' */
+
+/*
+ * shtext_fixups - walk the fixups of a cache entry for a shared TEXT
+ *
+ * with FIX_DATA, a fixup referring to TEXT is relocated to the cache
+ * entry, and one referring to DATA or BSS to 'dbase'.  returns FALSE if
+ * the relocation info is invalid, or (for FIX_CHECK) if the TEXT cannot
+ * be shared.
+ */
+static BOOL shtext_fixups(PGMCACHE *pc, LONG tlen, UBYTE *dbase, WORD pass)
+{
+    UBYTE *tbase = pc->image;
+    const UBYTE *rp, *end;
+    LONG offset, *lp;
+    UBYTE c;
+
+    if (pc->rellen < (LONG)sizeof(offset))
+        return TRUE;
+    memcpy(&offset, tbase+pc->flen, sizeof(offset));
+    if (offset == 0)
+        return TRUE;
+    rp = tbase + pc->flen + sizeof(offset);
+    end = tbase + pc->flen + pc->rellen;
+
+    for (;;)
+    {
+        if ((offset < 0) || (offset > pc->flen - (LONG)sizeof(LONG)))
+            return FALSE;
+
+        if (offset < tlen)
+        {
+            lp = (LONG *)(tbase + offset);
+            if (pass == FIX_CHECK)
+            {
+                if ((offset > tlen - (LONG)sizeof(LONG)) || ((ULONG)*lp >= (ULONG)tlen))
+                    return FALSE;
+            }
+            else if (pass == FIX_TEXT)
+                *lp += (LONG)tbase;
+        }
+        else if (pass == FIX_DATA)
+        {
+            lp = (LONG *)(dbase + offset - tlen);
+            *lp += ((ULONG)*lp < (ULONG)tlen) ? (LONG)tbase : (LONG)dbase - tlen;
+        }
+
+        /* find the next fixup */
+        do
+        {
+            if (rp >= end)
+                return TRUE;
+            c = *rp++;
+            if (c == 0)
+                return TRUE;
+            offset += (c == 1) ? 254 : c;
+        } while (c == 1);
+    }
+}
+
+
+/*
+ * pgmcache_release - release the shared TEXT used by a process, if any
+ *
+ * this is called when a process terminates
+ */
+void pgmcache_release(PD *p)
+{
+    WORD i;
+
+    for (i = 0; i < NUM_SHTEXT_USERS; i++)
+    {
+        if (shtext_user[i].pd == p)
+        {
+            shtext_user[i].pc->refs--;
+            shtext_user[i].pd = NULL;
+        }
+    }
+}
+
+
+/*
+ * pgmld_shared - load a program with a shared TEXT segment
+ *
+ * this is the equivalent of pgmld_cached(), except that the TEXT stays
+ * in the cache entry, and the DATA and BSS start after the basepage.
+ * returns 1 if the TEXT cannot be shared.
+ */
+static LONG pgmld_shared(PGMCACHE *pc, PD *pdptr, PGMHDR01 *hd)
+{
+    PD      *p = pdptr;
+    UBYTE   *dbase;
+    LONG    tlen, tpalen, len;
+    WORD    i;
+
+    tlen = hd->h01_tlen;
+
+    if (pc->share == 0)
+    {
+        if (shtext_fixups(pc, tlen, NULL, FIX_CHECK))
+        {
+            shtext_fixups(pc, tlen, NULL, FIX_TEXT);
+            invalidate_instruction_cache(pc->image, tlen);
+            pc->share = 1;
+        }
+        else pc->share = -1;
+        KDEBUG(("BDOS pgmld_shared: TEXT at %p %s be shared\n",pc->image,(pc->share>0)?"can":"cannot"));
+    }
+    if (pc->share < 0)
+        return 1;
+
+    pgmcache_release(p);        /* in case a previous user of p was not */
+    for (i = 0; i < NUM_SHTEXT_USERS; i++)
+        if (!shtext_user[i].pd)
+            break;
+    if (i >= NUM_SHTEXT_USERS)
+        return 1;
+
+    tpalen = p->p_hitpa - p->p_lowtpa - sizeof(PD);
+    if ((hd->h01_dlen > tpalen) || (tpalen-hd->h01_dlen < hd->h01_blen))
+        return ENSMEM;
+
+    /* initialize PD fields */
+
+    dbase = (UBYTE *)(p+1);     /*  1st byte after PD   */
+    p->p_tbase = pc->image;
+    p->p_tlen = tlen;
+    p->p_dbase = dbase;
+    p->p_dlen = hd->h01_dlen;
+    p->p_bbase = dbase + hd->h01_dlen;
+    p->p_blen = hd->h01_blen;
+
+    /* copy & relocate the data */
+
+    memcpy(dbase, pc->image+tlen, hd->h01_dlen);
+    if (!shtext_fixups(pc, tlen, dbase, FIX_DATA))
+        return EPLFMT;
+
+    /* clear the bss or the whole heap */
+
+    if (hd->h01_flags & PF_FASTLOAD)
+        len = p->p_blen;
+    else
+        len = (long)p->p_hitpa - (long)p->p_bbase;
+    if (len > 0)
+        bzero(p->p_bbase, len);
+
+    shtext_user[i].pd = p;
+    shtext_user[i].pc = pc;
+    pc->refs++;
+
+    return 0;
+}
+#endif /* CONF_WITH_SHARED_TEXT */
+#endif /* CONF_WITH_PGM_CACHE */
+
+
 /*
  * pgfix01 - do the next set of fixups
  *
  *  returns:
- *      addr of last modified longword in code segment (cp)
- *      0 if error or done
- *      stat01:
- *              >0: all offsets in bss used up, read in more
- *              =0: offset of 0 encountered, no more fixups
- *              <0: EPLFMT (load file format error)
+ *      >0: all relocation bytes used up, read in more
+ *      =0: offset of 0 encountered, no more fixups
+ *      <0: EPLFMT (load file format error)
  *
  * Arguments:
+ *  cpp       - ptr to addr of last modified longword in code segment,
+ *              updated so that the fixups can continue with the next set
+ *  rp        - relocation info pointer
  *  nrelbytes - number of avail rel values
  *  pi        - program info pointer
  */
 
-static LONG pgfix01(UBYTE *lastcp, LONG nrelbytes, PGMINFO *pi)
+static LONG pgfix01(UBYTE **cpp, const UBYTE *rp, LONG nrelbytes, PGMINFO *pi)
 {
     UBYTE *cp;              /*  code pointer                */
-    UBYTE *rp;              /*  relocation info pointer     */
-    LONG  n;                /*  nbr of relocation bytes     */
+    const UBYTE *rpend;     /*  end of relocation info      */
     UBYTE *bbase;           /*  base addr of bss segment    */
     LONG  tbase;            /*  base addr of text segment   */
+    UBYTE c;
 
-    cp = lastcp;
-    rp = pi->pi_bbase;
-    n = nrelbytes;
+    cp = *cpp;
+    rpend = rp + nrelbytes;
     tbase = (LONG)pi->pi_tbase;
     bbase = pi->pi_bbase;
 
-    while(n-- && (*rp != 0))
+    while (rp < rpend)
     {
-        if (*rp == 1)
-            cp += 0xfe;
-        else
+        c = *rp++;
+        if (c == 0)                 /* end of fixups */
+            return 0;
+        if (c == 1)
         {
-            cp += *rp;  /* add the byte at rp to cp, don't sign ext */
-
-            if (cp >= bbase)
-                return EPLFMT;
-            if (((LONG)cp) & 1)
-                return EPLFMT;
-            *((long *)cp) += tbase;
+            cp += 0xfe;
+            continue;
         }
-        ++rp;
+
+        cp += c;    /* add the byte at rp to cp, don't sign ext */
+
+        if ((cp >= bbase) || (((LONG)cp) & 1))
+            return EPLFMT;
+        *((long *)cp) += tbase;
     }
 
-    return (++n == 0) ? 1 : 0;
+    *cpp = cp;
+
+    return 1;
 }
 
 
@@ -285,12 +801,14 @@ LONG kpgm_relocate(PD *p, long length)
     PGMINFO *pi;
     PGMHDR01 *hd;
     UWORD   abs_flag;
+    LONG    prgflags;
 
     KDEBUG(("BDOS kpgm_relocate: lotpa=%p hitpa=%p len=0x%lx\n",p->p_lowtpa,p->p_hitpa,length));
 
     hd = (PGMHDR01*)(((char*)(p+1)) + 2);
     pi = &pinfo;
     abs_flag = hd->h01_abs;
+    prgflags = hd->h01_flags;   /* the header is overwritten below */
 
     pi->pi_tlen=hd->h01_tlen;
     pi->pi_dlen=hd->h01_dlen;
@@ -341,17 +859,21 @@ LONG kpgm_relocate(PD *p, long length)
 
             *((long *)(cp)) += (long)pi->pi_tbase;  /*  1st fixup     */
 
-            /* move the relocation info to the pi_bbase */
+            /*
+             * fixup with the reloc information available: it lies beyond
+             * the bss start, so it is not overwritten by the fixups and
+             * need not be moved first
+             */
             length -= ((long)rp) - (long)pi->pi_tbase;
-            memmove(pi->pi_bbase, rp, length);
-
-            /* fixup with the reloc information available */
-            pgfix01(cp, length, pi);
+            pgfix01(&cp, (UBYTE *)rp, length, pi);
         }
     }
 
-    /* clear the whole heap */
-    flen = (long)p->p_hitpa - (long)pi->pi_bbase;
+    /* clear the bss or the whole heap, as for pgmld01() */
+    if (prgflags & PF_FASTLOAD)
+        flen = pi->pi_blen;
+    else
+        flen = (long)p->p_hitpa - (long)pi->pi_bbase;
     if (flen > 0)
         bzero(pi->pi_bbase, flen);
 
@@ -33,6 +33,19 @@ extern  MPB     pmdalt;  /* the memory pool for the alternative ram (TT-RAM or o
 extern  ULONG   malloc_align_stram;
 #define MALLOC_ALIGN_ALTRAM     3
 
+/*
+ * MDs allocated by xmgetmd() are followed by the index of the MD within
+ * its MDBLOCK, and by the links used by the MD index in iumem.c
+ */
+typedef struct {
+    MD md;
+    WORD index;         /* if used, 0-2, else -1 */
+#if CONF_WITH_MEMTREE
+    MD *x_left;         /* MD index: lower addresses */
+    MD *x_right;        /* MD index: higher addresses */
+#endif
+} MDEXT;
+
 /*
  * in osmem.c
  */
@@ -56,6 +69,15 @@ void xmfremd(MD *md);       /* xmfremd - free an MD */
 /* init os memory */
 void osmem_init(void);
 
+#if CONF_WITH_OSMEM_SLABS
+/* grow the os memory pool if it is running low */
+void osmem_check(void);
+/* get information about the os memory pool */
+long xosmem(OSMINFO *info);
+/* get the number of blocks in use for the specified memory type */
+WORD osmem_used(WORD memtype);
+#endif
+
 /*
  * in umem.c
  */
@@ -74,11 +96,16 @@ void *xmxalloc(long amount, int mode);
 void *srealloc(long amount);
 #endif
 
+/* allocate memory for the BDOS's own use */
+void *xmsysalloc(long amount);
+
 /* init user memory */
 void umem_init(void);
 
-/* set memory ownership */
-void set_owner(void *addr, PD *p);
+#if CONF_WITH_MEMINFO
+/* get information about a memory pool */
+long xmeminfo(int pool, MEMINFO *info, PD *pd);
+#endif
 
 
 /*
@@ -87,10 +114,29 @@ void set_owner(void *addr, PD *p);
 
 /* find first fit for requested memory in ospool */
 MD *ffit(long amount, MPB *mp);
+/* same, for a block starting at a multiple of 'align' */
+MD *ffit_aligned(long amount, MPB *mp, LONG align);
 /* Free up a memory descriptor */
 void freeit(MD *m, MPB *mp);
 /* shrink a memory descriptor */
 WORD shrinkit(MD *m, MPB *mp, LONG newlen);
+#if CONF_WITH_MEMINFO
+/* allocation counters for an MPB */
+typedef struct {
+    LONG ms_ffit;       /* calls to ffit() */
+    LONG ms_failed;     /* failed allocations */
+    LONG ms_freeit;     /* calls to freeit() */
+} MEMSTATS;
+MEMSTATS *mpb_stats(MPB *mp);
+#endif
+/* find the allocated MD for a memory block */
+MD *mdfind(MPB *mp, const UBYTE *addr);
+#if CONF_WITH_MEMTREE
+/* tell the MD index that the lists of an MPB were modified directly */
+void mpb_changed(MPB *mp);
+#else
+#define mpb_changed(mp)
+#endif
 
 
 #endif /* MEM_H */
@@ -2,7 +2,7 @@
  * osmem.c - allocate/release os memory
  *
  * Copyright (C) 2001 Lineo, Inc.
- *               2002-2019 The EmuTOS development team
+ *               2002-2026 The EmuTOS development team
  *
  * Authors:
  *  KTB   Karl T. Braun (kral)
@@ -27,6 +27,7 @@
 #include "nls.h"
 #include "fs.h"
 #include "mem.h"
+#include "gemerror.h"
 #include "bdosstub.h"
 #include "biosext.h"
 
@@ -38,20 +39,27 @@
 /* size of os memory pool, in words: */
 #define LENOSM          (LEN_OSM_BLOCK*NUM_OSM_BLOCKS/sizeof(WORD))
 
+#if CONF_WITH_OSMEM_SLABS
+/* size of a slab added to the pool, in words: */
+#define LENSLAB         (LEN_OSM_BLOCK*OSMEM_SLAB_BLOCKS/sizeof(WORD))
+/* the pool is grown when less than this is left, in words: */
+#define LENRESERVE      (LEN_OSM_BLOCK*OSMEM_RESERVE_BLOCKS/sizeof(WORD))
+#endif
+
 
 /*
  *  local typedefs
  */
+#if CONF_WITH_MEMTREE
+#define MDS_PER_BLOCK   2   /* MDEXTs are larger, see mem.h */
+#else
 #define MDS_PER_BLOCK   3
-
-typedef struct {
-    MD md;
-    WORD index;         /* if used, 0-2, else -1 */
-} MDEXT;
+#endif
 
 typedef struct _mdb MDBLOCK;
 struct _mdb {
     MDBLOCK *mdb_next;
+    MDBLOCK *mdb_prev;
     MDEXT entry[MDS_PER_BLOCK];
 };
 
@@ -59,10 +67,15 @@ struct _mdb {
 /*
  *  internal variables
  */
-static WORD osmptr;
-static WORD osmlen;
+static WORD *osmptr;        /* next free word in pool */
+static WORD osmlen;         /* number of free words in pool */
 static WORD osmem[LENOSM];
 
+#if CONF_WITH_OSMEM_SLABS
+static WORD osmslabs;       /* number of slabs added to the pool */
+static WORD osmused[MEMTYPE_OFD+1]; /* blocks in use, by memtype */
+#endif
+
 
 /*
  *  root - root array for 'quick' pool
@@ -108,45 +121,121 @@ static WORD *getosm(WORD n)
         return 0;
     }
 
-    m = &osmem[osmptr];         /*  start at base               */
+    m = osmptr;                 /*  start at base               */
     osmptr += n;                /*  new base                    */
     osmlen -= n;                /*  new length of free block    */
     return m;                   /*  allocated memory            */
 }
 
 
+#if CONF_WITH_OSMEM_SLABS
 /*
- *  unlink_mdblock - unlinks an MDBLOCK from the mdb chain
+ * osmem_grow - add a slab of memory to the pool
+ *
+ * any complete blocks left in the old pool are moved to the free chain,
+ * then the slab becomes the new pool.  the slab is never freed.
  *
- *  returns -1 iff the MDBLOCK is not on the mdb chain
+ * note: this allocates memory via ffit(), which may need an MD, so it
+ * must not be called while ffit() is already active
+ *
+ * returns TRUE iff the pool was grown
  */
-static WORD unlink_mdblock(MDBLOCK *mdb)
+static BOOL osmem_grow(void)
 {
-    MDBLOCK *prev, *next;
+    WORD *slab, *m;
 
-    next = mdb->mdb_next;
-    mdb->mdb_next = NULL;   /* neatness */
+    slab = xmsysalloc(LENSLAB*sizeof(WORD));
+    if (!slab)
+        return FALSE;
 
-    if (mdb == mdbroot)     /* first on mdb chain? */
+    while ((m = getosm(LEN_OSM_BLOCK/sizeof(WORD))))
     {
-        mdbroot = next;     /* yes, just point root to next */
-        return 0;
+        *m++ = 4;                   /* put size in control word */
+        *((WORD **) m) = root[4];   /* add to free chain */
+        root[4] = m;
     }
 
-    /*
-     * find previous MDBLOCK
-     */
-    for (prev = mdbroot; prev; prev = prev->mdb_next)
-    {
-        if (prev->mdb_next == mdb)
-        {
-            prev->mdb_next = next; /* just snip it out */
-            return 0;
-        }
-    }
+    osmptr = slab;
+    osmlen = LENSLAB;
+    osmslabs++;
+    KDEBUG(("osmem_grow(): added slab %d at %p\n",osmslabs,slab));
+
+    return TRUE;
+}
+
+/*
+ * osmem_check - grow the pool if it is running low
+ *
+ * called by osif() at the start of each GEMDOS call, when ffit() cannot
+ * be active, so that the MDs needed by the call are available
+ */
+void osmem_check(void)
+{
+    if (!root[4] && (osmlen < LENRESERVE))
+        osmem_grow();
+}
+
+/*
+ * xosmem - get information about the OS memory pool
+ *
+ * Function 0x5A   s_osmem (EmuTOS-specific)
+ */
+long xosmem(OSMINFO *info)
+{
+    WORD **m;
+    WORD i;
+
+    info->om_blocks = NUM_OSM_BLOCKS + (LONG)osmslabs * OSMEM_SLAB_BLOCKS;
+    info->om_slabs = osmslabs;
+
+    info->om_free = osmlen / (LEN_OSM_BLOCK/sizeof(WORD));
+    for (m = (WORD **)root[4]; m; m = (WORD **)*m)
+        info->om_free++;
+
+    for (i = 0; i <= MEMTYPE_OFD; i++)
+        info->om_used[i] = osmused[i];
+
+    return E_OK;
+}
+
+
+/*
+ * osmem_used - return the number of blocks in use for a memory type
+ */
+WORD osmem_used(WORD memtype)
+{
+    return osmused[memtype];
+}
+#endif
 
-    KDEBUG(("unlink_mdblock(): cannot unlink MDBLOCK at %p, not on mdb chain\n",mdb));
-    return -1;
+
+/*
+ *  unlink_mdblock - unlinks an MDBLOCK from the mdb chain
+ */
+static void unlink_mdblock(MDBLOCK *mdb)
+{
+    if (mdb->mdb_prev)
+        mdb->mdb_prev->mdb_next = mdb->mdb_next;
+    else
+        mdbroot = mdb->mdb_next;
+
+    if (mdb->mdb_next)
+        mdb->mdb_next->mdb_prev = mdb->mdb_prev;
+
+    mdb->mdb_next = mdb->mdb_prev = NULL;   /* neatness */
+}
+
+
+/*
+ * link_mdblock - links an MDBLOCK at the start of the mdb chain
+ */
+static void link_mdblock(MDBLOCK *mdb)
+{
+    mdb->mdb_prev = NULL;
+    mdb->mdb_next = mdbroot;
+    if (mdbroot)
+        mdbroot->mdb_prev = mdb;
+    mdbroot = mdb;
 }
 
 
@@ -154,7 +243,8 @@ static WORD unlink_mdblock(MDBLOCK *mdb)
  *  xmgetmd - get an MD
  *
  *  To create a single pool for all osmem requests, MDs are grouped in
- *  blocks of 3 called MDBLOCKs which occupy 58 bytes.  MDBLOCKs are
+ *  blocks of 3 (2 if CONF_WITH_MEMTREE is set) called MDBLOCKs which
+ *  occupy at most 62 bytes.  MDBLOCKs are
  *  handled as follows:
  *    . they are linked in a chain, initially empty
  *    . when the first MD is required, an MDBLOCK is obtained via
@@ -179,10 +269,9 @@ MD *xmgetmd(void)
             return NULL;
 
         /* initialise new MDBLOCK */
-        mdb->mdb_next = NULL;
         for (i = 0; i < MDS_PER_BLOCK; i++)
             mdb->entry[i].index = -1;   /* unused */
-        mdbroot = mdb;
+        link_mdblock(mdb);
         KDEBUG(("xmgetmd(): got new MDBLOCK at %p\n",mdb));
     }
 
@@ -215,8 +304,7 @@ MD *xmgetmd(void)
     if (avail == 0)
     {
         KDEBUG(("xmgetmd(): MDBLOCK at %p is now full\n",mdb));
-        if (unlink_mdblock(mdb) == 0)
-            KDEBUG(("xmgetmd(): removed MDBLOCK at %p from mdb chain\n",mdb));
+        unlink_mdblock(mdb);
     }
 
     return md;
@@ -240,7 +328,7 @@ void xmfremd(MD *md)
     }
 
     entry = (MDEXT *)md - i;        /* point to first entry */
-    mdb = (MDBLOCK *)((char *)entry - sizeof(MDBLOCK *));
+    mdb = (MDBLOCK *)((char *)entry - offsetof(MDBLOCK, entry));
 
     mdb->entry[i].index = -1;       /* mark as free */
     KDEBUG(("xmfremd(): MD at %p freed\n",md));
@@ -249,25 +337,20 @@ void xmfremd(MD *md)
         if (mdb->entry[i].index < 0)
             avail++;
 
-    switch(avail) {
-    case 3:             /* remove from mdb chain & put on free chain */
+    if (avail == MDS_PER_BLOCK)     /* remove from mdb chain & put on free chain */
+    {
         KDEBUG(("xmfremd(): MDBLOCK at %p is now empty\n",mdb));
-        if (unlink_mdblock(mdb) == 0)
-        {
-            xmfreblk(mdb);          /* move to free chain */
-            KDEBUG(("xmfremd(): MDBLOCK at %p moved to free chain\n",mdb));
-        }
-        break;
-    case 2:
-        break;
-    case 1:             /* add to mdb chain */
-        mdb->mdb_next = mdbroot;
-        mdbroot = mdb;
+        unlink_mdblock(mdb);
+        xmfreblk(mdb);              /* move to free chain */
+    }
+    else if (avail == 1)            /* add to mdb chain */
+    {
+        link_mdblock(mdb);
         KDEBUG(("xmfremd(): MDBLOCK at %p now has free entry, moved to mdb chain\n",mdb));
-        break;
-    default:
+    }
+    else if ((avail <= 0) || (avail > MDS_PER_BLOCK))
+    {
         KDEBUG(("xmfremd(): MDBLOCK at %p is invalid, %d free entries\n",mdb,avail));
-        break;
     }
 }
 
@@ -282,8 +365,9 @@ void xmfremd(MD *md)
  * the os memory pool.
  *
  * If we cannot get memory for an MDBLOCK, we return NULL (the request
- * will fail).  Otherwise we will attempt to free up DNDs to make space
- * and if that fails, the system will be halted.
+ * will fail).  Otherwise we will attempt to grow the pool (if configured)
+ * or to free up DNDs to make space, and if that fails, the system will
+ * be halted.
  *
  * Arguments:
  *  memtype: the type of request
@@ -328,6 +412,15 @@ void *xmgetblk(WORD memtype)
         if (memtype == MEMTYPE_MDBLOCK)
             break;
 
+#if CONF_WITH_OSMEM_SLABS
+        /*
+         * no memory for DMD/DND/OFD, try to grow the pool (ffit() is not
+         * active, since it only ever requests MDBLOCKs)
+         */
+        if ((j == 0) && osmem_grow())
+            continue;
+#endif
+
         /*
          * no memory for DMD/DND/OFD, try to get some
          *
@@ -347,8 +440,14 @@ void *xmgetblk(WORD memtype)
      */
 
     if ( (q = m) )
+    {
         for (j = 0; j < w; j++)
             *q++ = 0;
+#if CONF_WITH_OSMEM_SLABS
+        m[-1] = (memtype << 8) | i; /* remember type in control word */
+        osmused[memtype]++;
+#endif
+    }
 
     return m;
 }
@@ -363,6 +462,18 @@ void xmfreblk(void *m)
 
     i = *(((WORD *)m) - 1);
 
+#if CONF_WITH_OSMEM_SLABS
+    /* maintain usage counts, and clear the type from the control word */
+    if ((i & 0xff) == 4)
+    {
+        WORD memtype = (i >> 8) & 0xff;
+        if ((memtype <= MEMTYPE_OFD) && osmused[memtype])
+            osmused[memtype]--;
+        i = 4;
+        *(((WORD *)m) - 1) = i;
+    }
+#endif
+
     if (i != 4)
     {
         /*  bad index  */
@@ -389,6 +500,7 @@ void xmfreblk(void *m)
  */
 void osmem_init(void)
 {
+    osmptr = osmem;
     osmlen = LENOSM;
     mdbroot = NULL;
     dbgfreblk = 0;
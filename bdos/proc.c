@@ -19,6 +19,7 @@
 #include "bdosdefs.h"
 #include "fs.h"
 #include "mem.h"
+#include "bdosstub.h"
 #include "proc.h"
 #include "gemerror.h"
 #include "biosbind.h"
@@ -26,6 +27,7 @@
 #include "biosext.h"
 #include "asm.h"
 #include "has.h"
+#include "tosvars.h"
 
 
 /*
@@ -41,9 +43,12 @@ static void ixterm( PD *r );
 static WORD envsize( char *env );
 static void init_pd_fields(PD *p, char *tail, long max, char *envptr);
 static void init_pd_files(PD *p);
-static char *alloc_env(ULONG flags, char *v);
+static char *alloc_env(ULONG flags, char *v, BOOL share);
 static UBYTE *alloc_tpa(ULONG flags,LONG needed,LONG *avail);
 static void proc_go(PD *p);
+#if CONF_WITH_PROCTIME
+static void charge_ticks(PD *p);
+#endif
 
 /*
  * global variables
@@ -59,6 +64,147 @@ static WORD    supstk[SUPSIZ]; /* common sup stack for all processes */
 static jmp_buf bakbuf;         /* longjmp buffer */
 
 
+#if CONF_WITH_SHARED_ENV
+/*
+ * shared environments
+ *
+ * when a program is run via Pexec(PE_LOADGO) with the environment of its
+ * parent, the child uses the parent's environment block itself rather
+ * than a copy.  such a block is no longer owned by any process: instead,
+ * we count the processes that use it, and free it when the last one
+ * terminates.  note that a process that modifies its environment in place
+ * also modifies that of the processes sharing it, which is why this is
+ * not enabled by default.
+ */
+#define NUM_SHARED_ENV  8
+
+typedef struct {
+    char    *env;       /* shared environment block, NULL => unused entry */
+    WORD    users;      /* number of processes using it */
+} SHARED_ENV;
+
+static SHARED_ENV shared_env[NUM_SHARED_ENV];
+static char empty_env[2];   /* replaces an environment freed by Mfree() */
+
+static SHARED_ENV *find_shared_env(char *env)
+{
+    SHARED_ENV *se;
+
+    for (se = shared_env; se < shared_env+NUM_SHARED_ENV; se++)
+        if (se->env == env)
+            return se;
+
+    return NULL;
+}
+
+/*
+ * share_env - share the environment of the current process
+ *
+ * returns the shared block, or NULL if it cannot be shared
+ */
+static char *share_env(void)
+{
+    SHARED_ENV *se;
+    MD *m;
+
+    se = find_shared_env(run->p_env);
+    if (se)
+    {
+        se->users++;
+        return se->env;
+    }
+
+    /*
+     * we can only share a block in ST-RAM (so that the child does not
+     * need to be able to use alternate RAM) which starts with the
+     * environment, and if there is room in the table
+     */
+    m = mdfind(&pmd, (UBYTE *)run->p_env);
+    if (!m)
+        return NULL;
+    se = find_shared_env(NULL);
+    if (!se)
+        return NULL;
+
+    se->env = run->p_env;
+    se->users = 2;      /* the parent and the child */
+    m->m_own = NULL;    /* nobody owns it now */
+    KDEBUG(("BDOS share_env: sharing environment at %p\n",se->env));
+
+    return se->env;
+}
+
+/*
+ * release_shared_env - release a process's use of a shared environment
+ *
+ * returns FALSE iff the environment was not shared
+ */
+static BOOL release_shared_env(char *env)
+{
+    SHARED_ENV *se;
+
+    if (!env)
+        return FALSE;
+
+    se = find_shared_env(env);
+    if (!se)
+        return FALSE;
+
+    if (--se->users == 0)
+    {
+        KDEBUG(("BDOS release_shared_env: freeing environment at %p\n",env));
+        se->env = NULL;
+        xmfree(env);
+    }
+
+    return TRUE;
+}
+
+/*
+ * free_env - free an environment allocated by alloc_env()
+ */
+static void free_env(char *env)
+{
+    if (!release_shared_env(env))
+        xmfree(env);
+}
+
+/*
+ * set the owner of an environment, unless it is shared
+ */
+static void set_env_owner(char *env, PD *p)
+{
+    if (!find_shared_env(env))
+        set_owner(env, p);
+}
+
+/*
+ * mfree_shared_env - handle Mfree() of a shared environment
+ *
+ * some programs free their environment, e.g. before Ptermres().  if it
+ * is shared, we just release the caller's use of it.
+ *
+ * returns FALSE iff the block is not a shared environment
+ */
+BOOL mfree_shared_env(void *addr)
+{
+    if (!find_shared_env(addr))
+        return FALSE;
+
+    if (run->p_env == addr)
+    {
+        release_shared_env(addr);
+        run->p_env = empty_env;
+    }
+
+    return TRUE;
+}
+#else
+#define free_env(env)           xmfree(env)
+#define set_env_owner(env,p)    set_owner(env,p)
+#endif
+
+
 /*
  * memory internal routines
  *
@@ -86,6 +232,7 @@ static void reserve_blocks(PD *p, MPB *mpb)
             q = &m->m_link;
         }
     }
+    mpb_changed(mpb);
 }
 
 /* free each item in the allocated list, that is owned by 'p' */
@@ -118,8 +265,8 @@ static void ixterm(PD *r)
         if ((h = r->p_uft[i]) > 0)
             xclose(h);
 
-    for (i = 0; i < OPNFILES; i++)
-        if (r == sft[i].f_own)
+    for (i = 0; i < SFTNUM; i++)
+        if (r == SFT(i)->f_own)
             xclose(i+NUMSTD);
 
 
@@ -131,6 +278,13 @@ static void ixterm(PD *r)
             decr_curdir_usage(h);
     }
 
+#if CONF_WITH_SHARED_ENV
+    release_shared_env(r->p_env);
+#endif
+#if CONF_WITH_SHARED_TEXT
+    pgmcache_release(r);
+#endif
+
     /* free each item in the allocated list that is owned by 'r' */
 
     free_all_owned(r, &pmd);
@@ -203,7 +357,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
          * programs that jump into their DATA, BSS or HEAP are kindly invited
          * to do their cache management themselves.
          */
-        invalidate_instruction_cache( p+1, p->p_tlen);
+        invalidate_instruction_cache(p->p_tbase, p->p_tlen);
 
         return (long)p;
 #endif
@@ -212,7 +366,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
         FALLTHROUGH;
     case PE_BASEPAGEFLAGS:      /* create a basepage, respecting the flags */
         hdrflags = (ULONG)path;
-        env_ptr = alloc_env(hdrflags, env);
+        env_ptr = alloc_env(hdrflags, env, FALSE);
         if (env_ptr == NULL) {
             KDEBUG(("BDOS xexec: no memory for environment\n"));
             return ENSMEM;
@@ -227,7 +381,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
 
         /* memory ownership */
         set_owner(p, run);
-        set_owner(env_ptr, run);
+        set_env_owner(env_ptr, run);
 
         /* initialize the PD */
         init_pd_fields(p, tail, max, env_ptr);
@@ -239,7 +393,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
         /* set the owner of the memory to be this process */
         p = (PD *) tail;
         set_owner(p, p);
-        set_owner(p->p_env, p);
+        set_env_owner(p->p_env, p);
         FALLTHROUGH;
     case PE_GO:
         p = (PD *) tail;
@@ -280,7 +434,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
     }
 
     /* allocate the environment first, depending on memory policy */
-    env_ptr = alloc_env(hdr.h01_flags, env);
+    env_ptr = alloc_env(hdr.h01_flags, env, flag == PE_LOADGO);
     if (env_ptr == NULL) {
         KDEBUG(("BDOS xexec: no memory for environment\n"));
         xclose(fh);
@@ -294,7 +448,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
     /* if failed, free env_ptr and return */
     if (p == NULL) {
         KDEBUG(("BDOS xexec: no memory for TPA\n"));
-        xmfree(env_ptr);
+        free_env(env_ptr);
         xclose(fh);
         return ENSMEM;
     }
@@ -304,7 +458,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
      */
     owner = (flag == PE_LOADGO) ? p : run;
     set_owner(p, owner);
-    set_owner(env_ptr, owner);
+    set_env_owner(env_ptr, owner);
 
     /* initialize the fields in the PD structure */
     init_pd_fields(p, tail, max, env_ptr);
@@ -322,7 +476,10 @@ long xexec(WORD flag, char *path, char *tail, char *env)
         KDEBUG(("Error and longjmp in xexec()!\n"));
 
         /* free any memory allocated so far & close the file */
-        xmfree(cur_p->p_env);
+#if CONF_WITH_PGM_CACHE
+        pgmcache_abort();
+#endif
+        free_env(cur_p->p_env);
         xmfree(cur_p);
         xclose(fh);
 
@@ -337,7 +494,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
     if (rc) {
         KDEBUG(("BDOS xexec: kpgmld returned %ld (0x%lx)\n",rc,rc));
         /* free any memory allocated yet */
-        xmfree(cur_p->p_env);
+        free_env(cur_p->p_env);
         xmfree(cur_p);
 
         return rc;
@@ -353,7 +510,7 @@ long xexec(WORD flag, char *path, char *tail, char *env)
      * programs that jump into their DATA, BSS or HEAP are kindly invited
      * to do their cache management themselves.
      */
-    invalidate_instruction_cache(((UBYTE *)cur_p) + sizeof(PD), hdr.h01_tlen);
+    invalidate_instruction_cache(cur_p->p_tbase, hdr.h01_tlen);
 
     if (flag != PE_LOAD)
         proc_go(cur_p);
@@ -409,15 +566,30 @@ static void init_pd_files(PD *p)
     p->p_curdrv = run->p_curdrv;
 }
 
-/* allocate the environment, in ST RAM or alternate RAM, according to the header flags */
-static char *alloc_env(ULONG flags, char *env)
+/*
+ * allocate the environment, in ST RAM or alternate RAM, according to the header flags
+ *
+ * if 'share' is set and the parent's environment is inherited, it may be
+ * shared rather than copied (see share_env())
+ */
+static char *alloc_env(ULONG flags, char *env, BOOL share)
 {
     char *new_env;
     int size;
 
     /* determine the env size */
-    if (env == NULL)
+    if ((env == NULL) || (env == run->p_env))
+    {
+#if CONF_WITH_SHARED_ENV
+        if (share)
+        {
+            new_env = share_env();
+            if (new_env)
+                return new_env;
+        }
+#endif
         env = run->p_env;
+    }
     size = (envsize(env) + 1) & ~1;  /* must be even */
 
     /* allocate it */
@@ -454,22 +626,32 @@ static char *alloc_env(ULONG flags, char *env)
  * Reference: TT030 TOS Release Notes, Third Edition, 6 September 1991,
  * pages 29-30.
  *
+ * if PF_SMALLTPA is set in the flags (as for MagiC), the same "would
+ * like to have" amount is the size of the TPA: rather than taking the
+ * whole of the largest block (which the program would normally Mshrink()
+ * straight away), we allocate just that amount, from the first block
+ * that is large enough.  this also avoids splitting the largest free
+ * block on every Pexec().  larger amounts may still be Malloc()ed.
+ *
  * returns: ptr to allocated memory (NULL => failed)
  *          updates 'avail' with the size of allocated memory
  */
 static UBYTE *alloc_tpa(ULONG flags,LONG needed,LONG *avail)
 {
     MD *md;
-    LONG st_ram_size;
+    LONG st_ram_size, tpasize, wanted;
     BOOL st_ram_available = FALSE;
 
+    tpasize = (((flags >> 28) & 0x0f) + 1) * TPASIZE_QUANTUM;
+    wanted = (flags & PF_SMALLTPA) ? ((needed + tpasize + 3) & ~3L) : 0L;
+
     st_ram_size = (LONG) ffit(-1L, &pmd);
     if (st_ram_size >= needed)
         st_ram_available = TRUE;
 
 #if CONF_WITH_ALT_RAM
     {
-        LONG alt_ram_size = 0L, tpasize;
+        LONG alt_ram_size = 0L;
         BOOL alt_ram_available = FALSE;
 
         if (has_alt_ram && (flags & PF_TTRAMLOAD)) {
@@ -479,22 +661,29 @@ static UBYTE *alloc_tpa(ULONG flags,LONG needed,LONG *avail)
         }
 
         if (st_ram_available && alt_ram_available && (st_ram_size > alt_ram_size)) {
-            tpasize = (((flags >> 28) & 0x0f) + 1) * TPASIZE_QUANTUM;
             if (needed+tpasize > alt_ram_size)
                 alt_ram_available = FALSE;  /* force allocation in ST RAM */
         }
 
         if (alt_ram_available) {
-            *avail = alt_ram_size;
+            if (wanted && (wanted < alt_ram_size))
+                alt_ram_size = wanted;
             md = ffit(alt_ram_size, &pmdalt);
+            if (!md)
+                return NULL;
+            *avail = md->m_length;
             return md->m_start;
         }
     }
 #endif
 
     if (st_ram_available) {
-        *avail = st_ram_size;
+        if (wanted && (wanted < st_ram_size))
+            st_ram_size = wanted;
         md = ffit(st_ram_size, &pmd);
+        if (!md)
+            return NULL;
+        *avail = md->m_length;
         return md->m_start;
     }
 
@@ -571,6 +760,11 @@ static void proc_go(PD *p)
     p->p_areg[4-3] = (long)p->p_bbase;  /* a4 to point to the BSS segt */
 #endif
 
+#if CONF_WITH_PROCTIME
+    charge_ticks(run);              /* the parent stops running */
+    p->p_tstamp = hz_200;
+#endif
+
     /* the new process is the one to run */
     run = (PD *)p;
 
@@ -607,6 +801,11 @@ void xterm(UWORD rc)
     protect_v((PFLONG)userterm);    /* call it, protecting d2/a2 from modification */
 
     run = run->p_parent;
+#if CONF_WITH_PROCTIME
+    charge_ticks(p);
+    KDEBUG(("BDOS xterm: process %p ran for %lu ticks\n", p, p->p_ticks));
+    run->p_tstamp = hz_200;         /* the parent resumes */
+#endif
     ixterm(p);
     /* gouser() will store the current value of D0 in the active PD
      * so it cannot be used here. See proc_go() above.
@@ -625,6 +824,15 @@ WORD xtermres(long blkln, WORD rc)
 {
     xsetblk(0,run,blkln);
 
+#if CONF_WITH_SHARED_ENV
+    /* a resident program keeps its use of a shared environment */
+    {
+        SHARED_ENV *se = find_shared_env(run->p_env);
+        if (se)
+            se->users++;
+    }
+#endif
+
     reserve_blocks(run, &pmd);
 #if CONF_WITH_ALT_RAM
     if (has_alt_ram)
@@ -632,3 +840,61 @@ WORD xtermres(long blkln, WORD rc)
 #endif
     xterm(rc);
 }
+
+#if CONF_WITH_PROCTIME
+/*
+ * hook for Sproctime(PT_AES), set by the AES while it is running
+ */
+LONG (*aes_proctime)(WORD index, PROCTIME *info);
+
+/*
+ * add the time since a process last resumed to its running time
+ */
+static void charge_ticks(PD *p)
+{
+    ULONG now = hz_200;
+
+    p->p_ticks += now - p->p_tstamp;
+    p->p_tstamp = now;
+}
+
+/*
+ * xproctime - get the running time of a process
+ *
+ * Function 0x5C   s_proctime (EmuTOS-specific)
+ *
+ * Arguments:
+ *  type  - PT_GEMDOS or PT_AES
+ *  index - for PT_GEMDOS, 0 for the caller, 1 for its parent, and so on;
+ *          for PT_AES, the AES process id
+ *  info  - PROCTIME structure to fill in
+ *
+ * returns ERANGE if there is no such process
+ */
+long xproctime(WORD type, WORD index, PROCTIME *info)
+{
+    PD *p;
+
+    bzero(info, sizeof(PROCTIME));
+
+    switch(type) {
+    case PT_GEMDOS:
+        if (index < 0)
+            break;
+        charge_ticks(run);          /* bring the caller's time up to date */
+        for (p = run; p && index; p = p->p_parent)
+            index--;
+        if (!p)
+            break;
+        info->pt_id = (LONG)p;
+        info->pt_ticks = p->p_ticks;
+        return E_OK;
+    case PT_AES:
+        if (aes_proctime)
+            return aes_proctime(index, info);
+        break;
+    }
+
+    return ERANGE;
+}
+#endif
@@ -27,6 +27,13 @@ long xexec(WORD, char *, char *, char *);
 void x0term(void);
 void xterm(UWORD rc)  NORETURN ;
 WORD xtermres(long blkln, WORD rc);
+#if CONF_WITH_SHARED_ENV
+BOOL mfree_shared_env(void *addr);
+#endif
+#if CONF_WITH_PROCTIME
+long xproctime(WORD type, WORD index, PROCTIME *info);
+extern LONG (*aes_proctime)(WORD index, PROCTIME *info);
+#endif
 
 /*
  * in kpgmld.c
@@ -34,6 +41,12 @@ WORD xtermres(long blkln, WORD rc);
 
 LONG kpgmhdrld(FH h, PGMHDR01 *hd);
 LONG kpgmld(PD *p, FH h, PGMHDR01 *hd);
+#if CONF_WITH_PGM_CACHE
+void pgmcache_abort(void);
+#endif
+#if CONF_WITH_SHARED_TEXT
+void pgmcache_release(PD *p);
+#endif
 
 #if DETECT_NATIVE_FEATURES
 LONG kpgm_relocate( PD *p, long length); /* SOP */
@@ -46,6 +46,7 @@ NAMES
 #include "xbiosbind.h"
 #include "bdosstub.h"
 #include "tosvars.h"
+#include "fs.h"
 
 /*
  * globals: current time and date
@@ -179,6 +180,19 @@ static void tikfrk(int n)
 
 /*  uptime += n; */
 
+#if CONF_WITH_BDOS_WRITEBACK
+    /* request write-back of dirty buffers when the delay expires */
+    if (bufl_wbtimer > 0)
+    {
+        bufl_wbtimer -= n;
+        if (bufl_wbtimer <= 0)
+        {
+            bufl_wbtimer = 0;
+            bufl_wbdue = TRUE;
+        }
+    }
+#endif
+
     msec += n;
     if (msec < 2000)
         return;
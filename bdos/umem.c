@@ -24,6 +24,7 @@
 #include "biosext.h"
 #include "xbiosbind.h"
 #include "bdosstub.h"
+#include "proc.h"
 #include "cookie.h"
 #include "string.h"
 #include "has.h"        /* for has_videl */
@@ -139,16 +140,18 @@ long xmfree(void *addr)
 
     KDEBUG(("BDOS: Mfree(%p)\n",addr));
 
+#if CONF_WITH_SHARED_ENV
+    if (mfree_shared_env(addr))
+        return E_OK;
+#endif
+
     mpb = find_mpb(addr);
     if (!mpb)
         return EIMBA;
 
     KDEBUG(("BDOS Mfree: mpb=%s\n",(mpb==&pmd)?"pmd":"pmdalt"));
 
-    for (p = mpb->mp_mal; p; p = p->m_link)
-        if (addr == p->m_start)
-            break;
-
+    p = mdfind(mpb, addr);
     if (!p)
         return EIMBA;
 
@@ -183,9 +186,7 @@ long xsetblk(int n, void *blk, long len)
     /*
      * Traverse the list of memory descriptors looking for this block.
      */
-    for (p = mpb->mp_mal; p; p = p->m_link)
-        if ((UBYTE *)blk == p->m_start)
-            break;
+    p = mdfind(mpb, blk);
 
     /*
      * If block address doesn't match any memory descriptor, then abort.
@@ -228,16 +229,29 @@ long xsetblk(int n, void *blk, long len)
     return E_OK;
 }
 
+/*
+ *  mxfit - allocate memory from a pool, optionally aligned
+ */
+static MD *mxfit(long amount, MPB *mp, LONG align)
+{
+    return align ? ffit_aligned(amount,mp,align) : ffit(amount,mp);
+}
+
+
 /*
  *  xmxalloc - Function 0x44 (Mxalloc)
  */
 void *xmxalloc(long amount, int mode)
 {
+    static const LONG alignment[] = { 0L, 16L, 32L, 256L, 4096L };
     MD *m;
     void *ret_value;
+    LONG align;
 
     KDEBUG(("BDOS: Mxalloc(%ld,0x%04x)\n",amount,mode));
 
+    align = (mode & MX_ALIGNMASK) >> 8;
+    align = (align < ARRAY_SIZE(alignment)) ? alignment[align] : 0L;
     mode &= MX_MODEMASK;    /* ignore unsupported bits */
 
     /*
@@ -291,26 +305,26 @@ void *xmxalloc(long amount, int mode)
      */
     switch(mode) {
     case MX_STRAM:
-        m = ffit(amount,&pmd);
+        m = mxfit(amount,&pmd,align);
         break;
 #if CONF_WITH_ALT_RAM
     case MX_TTRAM:
-        m = ffit(amount,&pmdalt);
+        m = mxfit(amount,&pmdalt,align);
         break;
 #endif
     case MX_PREFSTRAM:
-        m = ffit(amount,&pmd);
+        m = mxfit(amount,&pmd,align);
 #if CONF_WITH_ALT_RAM
         if (m == NULL)
-            m = ffit(amount,&pmdalt);
+            m = mxfit(amount,&pmdalt,align);
 #endif
         break;
     case MX_PREFTTRAM:
 #if CONF_WITH_ALT_RAM
-        m = ffit(amount,&pmdalt);
+        m = mxfit(amount,&pmdalt,align);
         if (m == NULL)
 #endif
-            m = ffit(amount,&pmd);
+            m = mxfit(amount,&pmd,align);
         break;
     default:
         /* unknown mode */
@@ -415,6 +429,7 @@ void *srealloc(long amount)
     last->m_length = last->m_length + video_ram_size - amount;
     video_ram_size = amount;
     video_ram_addr = last->m_start + last->m_length;
+    mpb_changed(&pmd);
 
     /* finally, clear video ram */
     bzero(video_ram_addr, video_ram_size);
@@ -423,6 +438,31 @@ void *srealloc(long amount)
 }
 #endif
 
+/*
+ * xmsysalloc - allocate memory for the BDOS's own use
+ *
+ * the block has no owner, so it is not freed when the current process
+ * terminates; it must be freed explicitly via xmfree().  Alt-RAM is
+ * used if available.
+ */
+void *xmsysalloc(long amount)
+{
+    MD *m = NULL;
+
+#if CONF_WITH_ALT_RAM
+    if (has_alt_ram)
+        m = ffit(amount,&pmdalt);
+#endif
+    if (!m)
+        m = ffit(amount,&pmd);
+    if (!m)
+        return NULL;
+
+    m->m_own = NULL;
+
+    return m->m_start;
+}
+
 #if CONF_WITH_ALT_RAM
 
 #if CONF_WITH_STATIC_ALT_RAM
@@ -473,11 +513,13 @@ long xmaddalt(UBYTE *start, LONG size)
         if (p->m_start + p->m_length == start) {
             /* new block is just after a free one, extend it at end */
             p->m_length += size;
+            mpb_changed(&pmdalt);
             return 0;
         } else if (start + size == p->m_start) {
             /* new block is just before a free one, extend it at beginning */
             p->m_start -= size;
             p->m_length += size;
+            mpb_changed(&pmdalt);
             return 0;
         }
     }
@@ -512,6 +554,7 @@ long xmaddalt(UBYTE *start, LONG size)
         pmdalt.mp_mal = NULL;
         has_alt_ram = 1;
     }
+    mpb_changed(&pmdalt);
 
     return 0;
 }
@@ -559,6 +602,25 @@ void umem_init(void)
     end_stram = start_stram + pmd.mp_mfl->m_length;
     KDEBUG(("umem_init(): start_stram=%p, end_stram=%p\n",start_stram,end_stram));
 
+#if CONF_WITH_MEMTREE
+    /*
+     * the initial MD belongs to the BIOS, so it has no room for the links
+     * used by the MD index: replace it with one of our own
+     */
+    {
+        MD **q, *md;
+
+        for (q = &pmd.mp_mfl; *q; q = &md->m_link) {
+            md = xmgetmd();
+            if (!md)        /* "can't happen", the OS pool is brand new */
+                break;
+            *md = **q;
+            *q = md;
+        }
+        mpb_changed(&pmd);
+    }
+#endif
+
 #if CONF_WITH_ALT_RAM
     /* there is no known alternative RAM initially */
     has_alt_ram = 0;
@@ -594,10 +656,79 @@ void set_owner(void *addr, PD *p)
     if (!mpb)       /* block address was invalid */
         return;
 
+    m = mdfind(mpb, addr);
+    if (m)
+        m->m_own = p;
+}
+
+#if CONF_WITH_MEMINFO
+/*
+ * xmeminfo - get information about a memory pool
+ *
+ * Function 0x5B   s_meminfo (EmuTOS-specific)
+ *
+ * Arguments:
+ *  pool - MI_STRAM or MI_ALTRAM
+ *  info - MEMINFO structure to fill in
+ *  pd   - process whose memory is counted in mi_owned (NULL => caller)
+ */
+long xmeminfo(int pool, MEMINFO *info, PD *pd)
+{
+    MPB *mpb;
+    MD *m;
+    MEMSTATS *stats;
+    LONG scale;
+
+    switch(pool) {
+    case MI_STRAM:
+        mpb = &pmd;
+        break;
+#if CONF_WITH_ALT_RAM
+    case MI_ALTRAM:
+        if (!has_alt_ram)
+            return ERANGE;
+        mpb = &pmdalt;
+        break;
+#endif
+    default:
+        return ERANGE;
+    }
+
+    if (!pd)
+        pd = run;
+
+    bzero(info, sizeof(MEMINFO));
+
+    for (m = mpb->mp_mfl; m; m = m->m_link) {
+        info->mi_free += m->m_length;
+        info->mi_freeblks++;
+        if (m->m_length > info->mi_largest)
+            info->mi_largest = m->m_length;
+    }
+
     for (m = mpb->mp_mal; m; m = m->m_link) {
-        if (m->m_start == (UBYTE *)addr) {
-            m->m_own = p;
-            return;
-        }
+        info->mi_used += m->m_length;
+        info->mi_usedblks++;
+        if (m->m_own == pd)
+            info->mi_owned += m->m_length;
+    }
+
+    /* avoid overflow when scaling: free memory may exceed 2MB */
+    if (info->mi_free > 0) {
+        scale = info->mi_free / 1000;
+        if (scale)
+            info->mi_frag = (info->mi_free - info->mi_largest) / scale;
+        else
+            info->mi_frag = (1000 * (info->mi_free - info->mi_largest)) / info->mi_free;
+        if (info->mi_frag > 1000)
+            info->mi_frag = 1000;
     }
+
+    stats = mpb_stats(mpb);
+    info->mi_ffit = stats->ms_ffit;
+    info->mi_failed = stats->ms_failed;
+    info->mi_freeit = stats->ms_freeit;
+
+    return E_OK;
 }
+#endif /* CONF_WITH_MEMINFO */
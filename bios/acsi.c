@@ -42,6 +42,10 @@ static void acsi_end(void);
 static void hdc_start_dma(UWORD control);
 static void dma_send_byte(UBYTE data, UWORD control);
 static int do_acsi_rw(WORD rw, LONG sect, WORD cnt, UBYTE *buf, WORD dev);
+#if CONF_WITH_ACSI_OVERLAP
+static int acsi_rw_overlap(WORD rw, LONG sector, WORD count, UBYTE *buf, WORD dev, UBYTE *pool, WORD poolsecs);
+static void overlap_copy(void);
+#endif
 static LONG acsi_capacity(WORD dev, ULONG *info);
 static LONG acsi_testunit(WORD dev);
 static LONG acsi_inquiry(WORD dev, UBYTE *buf);
@@ -96,6 +100,18 @@ union acsidma {
 static ULONG loopcount_delay;   /* used by delay() macro */
 static ULONG next_acsi_time;    /* earliest time we can start the next i/o */
 
+#if CONF_WITH_ACSI_OVERLAP
+/*
+ * a copy between the user buffer and one half of the bounce pool, which
+ * send_command() performs while the DMA for the other half is in progress
+ */
+static struct {
+    UBYTE *dst;
+    const UBYTE *src;
+    LONG len;                   /* 0 => nothing to do */
+} pending_copy;
+#endif
+
 
 /*
  * High-level ACSI stuff.
@@ -149,6 +165,15 @@ LONG acsi_rw(WORD rw, LONG sector, WORD count, UBYTE *buf, WORD dev)
                 maxsecs_per_io = DSKBUF_SECS;
         }
         use_tmpbuf = TRUE;
+
+#if CONF_WITH_ACSI_OVERLAP
+        /*
+         * if the transfer needs more than one bounce buffer load, split
+         * the buffer in two, and copy one half while the DMA uses the other
+         */
+        if ((count > maxsecs_per_io) && (maxsecs_per_io >= 2))
+            return acsi_rw_overlap(rw, sector, count, buf, dev, tmp_buf, maxsecs_per_io);
+#endif
     }
 
     while(count > 0) {
@@ -182,6 +207,81 @@ LONG acsi_rw(WORD rw, LONG sector, WORD count, UBYTE *buf, WORD dev)
     return 0;
 }
 
+#if CONF_WITH_ACSI_OVERLAP
+/*
+ * perform any pending copy (see send_command())
+ */
+static void overlap_copy(void)
+{
+    if (pending_copy.len) {
+        memcpy(pending_copy.dst, pending_copy.src, pending_copy.len);
+        pending_copy.len = 0;
+    }
+}
+
+/*
+ * read/write via a double-buffered bounce pool
+ *
+ * when reading, the previous chunk is copied out of one half of the pool
+ * while the DMA fills the other half; when writing, the next chunk is
+ * copied into one half while the DMA empties the other
+ */
+static int acsi_rw_overlap(WORD rw, LONG sector, WORD count, UBYTE *buf, WORD dev, UBYTE *pool, WORD poolsecs)
+{
+    WORD half = poolsecs / 2;
+    UBYTE *p[2];
+    int i, retry;
+    int err = 0;
+
+    p[0] = pool;
+    p[1] = pool + half * SECTOR_SIZE;
+
+    if (rw)
+        memcpy(p[0], buf, min(count, half) * SECTOR_SIZE);
+
+    for (i = 0; count > 0; i ^= 1) {
+        WORD numsecs = (count > half) ? half : count;
+        LONG len = numsecs * SECTOR_SIZE;
+
+        if (rw) {           /* next chunk into the other half */
+            WORD next = count - numsecs;
+            if (next > half)
+                next = half;
+            pending_copy.dst = p[i^1];
+            pending_copy.src = buf + len;
+            pending_copy.len = next * SECTOR_SIZE;
+        }
+
+        for (retry = 0; retry < 2; retry++) {
+            err = do_acsi_rw(rw, sector, numsecs, p[i], dev);
+            if (err == 0)
+                break;
+        }
+        overlap_copy();     /* in case send_command() did not get that far */
+
+        if (err) {
+            KDEBUG(("acsi.c: %s error %d\n",rw?"write":"read",err));
+            KDEBUG(("        dev=%d,sector=%ld,numsecs=%d\n",dev,sector,numsecs));
+            return err;
+        }
+
+        if (!rw) {          /* copied out during the next transfer */
+            pending_copy.dst = buf;
+            pending_copy.src = p[i];
+            pending_copy.len = len;
+        }
+
+        count -= numsecs;
+        buf += len;
+        sector += numsecs;
+    }
+
+    overlap_copy();         /* last chunk read */
+
+    return 0;
+}
+#endif
+
 /*
  *  perform miscellaneous non-data-transfer functions
  */
@@ -524,6 +624,9 @@ int send_command(WORD dev,ACSICMD *cmd)
 
         /* send the last byte & wait for completion of DMA */
         dma_send_byte(*p,control&0xff00);
+#if CONF_WITH_ACSI_OVERLAP
+        overlap_copy();
+#endif
         status = timeout_gpip(cmd->timeout);
         next_acsi_time = hz_200 + INTER_IO_TIME;    /* next safe time */
         if (status)
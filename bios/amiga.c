@@ -37,6 +37,7 @@
 
 /* Custom registers */
 #define CUSTOM_BASE ((void *)0xdff000)
+#define DMACONR *(volatile UWORD*)0xdff002
 #define JOY0DAT *(volatile UWORD*)0xdff00a
 #define JOY1DAT *(volatile UWORD*)0xdff00c
 #define ADKCONR *(volatile UWORD*)0xdff010
@@ -47,6 +48,15 @@
 #define INTREQR *(volatile UWORD*)0xdff01e
 #define DSKPTH  *(void* volatile*)0xdff020
 #define DSKLEN  *(volatile UWORD*)0xdff024
+#define BLTCON0 *(volatile UWORD*)0xdff040
+#define BLTCON1 *(volatile UWORD*)0xdff042
+#define BLTAFWM *(volatile UWORD*)0xdff044
+#define BLTALWM *(volatile UWORD*)0xdff046
+#define BLTAPT  *(const void* volatile*)0xdff050
+#define BLTDPT  *(void* volatile*)0xdff054
+#define BLTSIZE *(volatile UWORD*)0xdff058
+#define BLTAMOD *(volatile UWORD*)0xdff064
+#define BLTDMOD *(volatile UWORD*)0xdff066
 #define SERDAT  *(volatile UWORD*)0xdff030
 #define SERPER  *(volatile UWORD*)0xdff032
 #define POTGO   *(volatile UWORD*)0xdff034
@@ -64,6 +74,7 @@
 #define BPLCON0 *(volatile UWORD*)0xdff100
 #define BPLCON1 *(volatile UWORD*)0xdff102
 #define BPL1MOD *(volatile UWORD*)0xdff108
+#define BPL2MOD *(volatile UWORD*)0xdff10a
 #define COLOR00 *(volatile UWORD*)0xdff180
 #define COLOR01 *(volatile UWORD*)0xdff182
 
@@ -509,15 +520,201 @@ UWORD amiga_screen_height;
 const UBYTE *amiga_screenbase;
 UWORD *copper_list;
 
+#if CONF_WITH_AMIGA_PLANAR
+
+/*
+ * In colour modes, the Amiga can't display the Atari screen as is, because
+ * the Atari interleaves the planes word by word, while the Amiga wants each
+ * plane as a separate bitmap.  So the screen stays in Atari format for the
+ * VDI and for the programs, and the VBL converts it to the planar buffer,
+ * which is the one actually displayed.
+ *
+ * To keep that cheap, only the lines marked as dirty by the VDI (through
+ * amiga_screen_dirty()) are converted, plus a few lines per VBL in round
+ * robin, so that direct screen writes by applications eventually show up.
+ * The conversion itself is done by the blitter, one plane at a time: with
+ * a blit width of 1 word, the A modulo skips the words of the other planes.
+ */
+#define PLANAR_BUFFER_SIZE  32000UL /* 320x200x4 or 640x200x2 */
+#define REFRESH_LINES       8       /* lines refreshed per VBL in round robin */
+#define BLIT_MAX_WORDS      1024    /* max height of a blit with width 1 */
+
+const UBYTE *amiga_displaybase;     /* what the VBL puts in BPL1PT */
+static UWORD amiga_planes;          /* 0 or 1 = monochrome */
+static UBYTE *planar_buffer;
+static ULONG plane_size;
+static WORD dirty_top, dirty_bottom; /* empty when top > bottom */
+static WORD refresh_line;
+static UWORD amiga_palette[16];
+
+/* Default palette, as on the ST(e) */
+static const UWORD amiga_dflt_palette[] = {
+    RGB_WHITE, RGB_RED, RGB_GREEN, RGB_YELLOW,
+    RGB_BLUE, RGB_MAGENTA, RGB_CYAN, RGB_LTGRAY,
+    RGB_GRAY, RGB_LTRED, RGB_LTGREEN, RGB_LTYELLOW,
+    RGB_LTBLUE, RGB_LTMAGENTA, RGB_LTCYAN, RGB_BLACK
+};
+
+#endif /* CONF_WITH_AMIGA_PLANAR */
+
 ULONG amiga_initial_vram_size(void)
 {
     return 640UL * 512 / 8;
 }
 
-static void amiga_set_videomode(UWORD width, UWORD height)
+#if CONF_WITH_AMIGA_PLANAR
+
+/* Convert an ST(e) colour value to Amiga 12-bit RGB */
+static UWORD amiga_color_from_ste(UWORD color)
+{
+    UWORD ste_lsb = (color & 0x0888) >> 3;
+    UWORD ste_msb = color & 0x0777;
+
+    return (ste_msb << 1) | ste_lsb;
+}
+
+static void amiga_load_color(WORD colorNum, UWORD color)
+{
+    amiga_palette[colorNum] = color & 0x0fff;
+    (&COLOR00)[colorNum] = amiga_color_from_ste(color);
+}
+
+/* Point the bitplanes to the planar buffer, or to the Atari screen */
+static void amiga_set_bitplanes(void)
+{
+    UWORD i;
+
+    if (amiga_planes <= 1)
+    {
+        amiga_displaybase = amiga_screenbase;
+        return;
+    }
+
+    amiga_displaybase = planar_buffer;
+
+    /* BPL1PT is updated by the VBL, the other bitplane pointers are fixed */
+    for (i = 1; i < amiga_planes; i++)
+    {
+        const UBYTE *plane = planar_buffer + i * plane_size;
+        copper_list[2 + i * 4 + 1] = HIWORD(plane);
+        copper_list[2 + i * 4 + 3] = LOWORD(plane);
+    }
+
+    /* Everything must be converted again */
+    dirty_top = 0;
+    dirty_bottom = amiga_screen_height - 1;
+}
+
+void amiga_screen_dirty(WORD y1, WORD y2)
+{
+    WORD t;
+
+    if (amiga_planes <= 1)
+        return;
+
+    if (y1 > y2)
+    {
+        t = y1;
+        y1 = y2;
+        y2 = t;
+    }
+
+    /* If the VBL interrupts us here, at worst some lines are converted
+     * late, by the round robin refresh.
+     */
+    if (y1 < dirty_top)
+        dirty_top = y1;
+    if (y2 > dirty_bottom)
+        dirty_bottom = y2;
+}
+
+/* Convert 'count' lines starting at line y to the planar buffer */
+static void amiga_convert_lines(WORD y, WORD count)
+{
+    UWORD words_per_line = amiga_screen_width / 16; /* per plane */
+    UWORD atari_line_bytes = words_per_line * amiga_planes * 2;
+    WORD max_lines = BLIT_MAX_WORDS / words_per_line;
+    UWORD plane;
+
+    if (y < 0)
+    {
+        count += y;
+        y = 0;
+    }
+    if (y + count > (WORD)amiga_screen_height)
+        count = amiga_screen_height - y;
+    if (count <= 0)
+        return;
+
+    /* The blitter only sees memory, not the CPU caches */
+    flush_data_cache((void *)(amiga_screenbase + (ULONG)y * atari_line_bytes),
+        (ULONG)count * atari_line_bytes);
+
+    while (count > 0)
+    {
+        WORD lines = (count < max_lines) ? count : max_lines;
+        UWORD words = lines * words_per_line;
+
+        for (plane = 0; plane < amiga_planes; plane++)
+        {
+            while (DMACONR & BBUSY)
+                ;
+
+            BLTCON0 = 0x09f0; /* use A and D, D = A */
+            BLTCON1 = 0;
+            BLTAFWM = 0xffff;
+            BLTALWM = 0xffff;
+            BLTAMOD = (amiga_planes - 1) * 2;
+            BLTDMOD = 0;
+            BLTAPT = amiga_screenbase + (ULONG)y * atari_line_bytes + plane * 2;
+            BLTDPT = planar_buffer + plane * plane_size + (ULONG)y * words_per_line * 2;
+            BLTSIZE = ((words & 0x3ff) << 6) | 1; /* 1024 is encoded as 0 */
+        }
+
+        y += lines;
+        count -= lines;
+    }
+}
+
+/* Called on each VBL */
+static void amiga_planar_vbl(void)
+{
+    WORD top, bottom;
+
+    if (amiga_planes <= 1)
+        return;
+
+    /* Setpalette(), handled here because there is no ST palette */
+    if (colorptr)
+    {
+        const UWORD *palette = (const UWORD *)((ULONG)colorptr & ~1UL);
+        WORD i;
+
+        colorptr = NULL;
+        for (i = 0; i < 16; i++)
+            amiga_load_color(i, palette[i]);
+    }
+
+    top = dirty_top;
+    bottom = dirty_bottom;
+    dirty_top = 0x7fff;
+    dirty_bottom = -1;
+
+    if (top <= bottom)
+        amiga_convert_lines(top, bottom - top + 1);
+
+    amiga_convert_lines(refresh_line, REFRESH_LINES);
+    refresh_line += REFRESH_LINES;
+    if (refresh_line >= (WORD)amiga_screen_height)
+        refresh_line = 0;
+}
+
+#endif /* CONF_WITH_AMIGA_PLANAR */
+
+static void amiga_set_videomode(UWORD width, UWORD height, UWORD planes)
 {
     UWORD lowres_height = height;
-    UWORD bplcon0 = 0x1200; /* 1 bit-plane, COLOR ON */
+    UWORD bplcon0 = (planes << 12) | 0x0200; /* bit-planes, COLOR ON */
     UWORD bpl1mod = 0; /* Modulo */
     UWORD ddfstrt = 0x0038; /* Data-fetch start for low resolution */
     UWORD ddfstop = 0x00d0; /* Data-fetch stop for low resolution */
@@ -563,11 +760,33 @@ static void amiga_set_videomode(UWORD width, UWORD height)
     BPLCON0 = bplcon0; /* Bit Plane Control */
     BPLCON1 = 0;       /* Horizontal scroll value 0 */
     BPL1MOD = bpl1mod; /* Modulo = line width in interlaced mode */
+    BPL2MOD = bpl1mod;
     DDFSTRT = ddfstrt; /* Data-fetch start */
     DDFSTOP = ddfstop; /* Data-fetch stop */
     DIWSTRT = diwstrt; /* Set display window start */
     DIWSTOP = diwstop; /* Set display window stop */
 
+#if CONF_WITH_AMIGA_PLANAR
+    amiga_planes = planes;
+    if (planes > 1)
+    {
+        WORD i;
+
+        plane_size = (ULONG)amiga_screen_width_in_bytes * height;
+        for (i = 0; i < 16; i++)
+            amiga_load_color(i, amiga_dflt_palette[i]);
+        if (planes == 2)
+            amiga_load_color(3, amiga_dflt_palette[15]);
+
+        sshiftmod = (planes == 4) ? ST_LOW : ST_MEDIUM;
+        if (copper_list)
+            amiga_set_bitplanes();
+        return;
+    }
+    if (copper_list)
+        amiga_set_bitplanes();
+#endif
+
     /* Set up color registers */
     COLOR00 = 0x0fff; /* Background color = white */
     COLOR01 = 0x0000; /* Foreground color = black */
@@ -584,6 +803,12 @@ WORD amiga_check_moderez(WORD moderez)
 
     if (moderez == 0xff02) /* ST High */
         moderez = VIDEL_COMPAT|VIDEL_1BPP|VIDEL_80COL|VIDEL_VERTICAL;
+#if CONF_WITH_AMIGA_PLANAR
+    else if (moderez == 0xff00) /* ST Low */
+        moderez = VIDEL_COMPAT|VIDEL_4BPP;
+    else if (moderez == 0xff01) /* ST Medium */
+        moderez = VIDEL_COMPAT|VIDEL_2BPP|VIDEL_80COL;
+#endif
 
     if (moderez < 0)                /* ignore other ST video modes */
         return 0;
@@ -595,14 +820,18 @@ WORD amiga_check_moderez(WORD moderez)
 
 void amiga_get_current_mode_info(UWORD *planes, UWORD *hz_rez, UWORD *vt_rez)
 {
+#if CONF_WITH_AMIGA_PLANAR
+    *planes = (amiga_planes > 1) ? amiga_planes : 1;
+#else
     *planes = 1;
+#endif
     *hz_rez = amiga_screen_width;
     *vt_rez = amiga_screen_height;
 }
 
 void amiga_screen_init(void)
 {
-    amiga_set_videomode(640, 400);
+    amiga_set_videomode(640, 400, 1);
 
     /* The VBL will update the Copper list below with any new value
      * of amiga_screenbase, eventually adjusted for interlace.
@@ -619,16 +848,40 @@ void amiga_screen_init(void)
      * handler enough time to update it.
      */
 
+#if CONF_WITH_AMIGA_PLANAR
+    /* Set up the Copper list (must be in ST-RAM), with all 4 bit-plane
+     * pointers: the ones after BPL1PT are only used in colour modes.
+     */
+    {
+        UWORD i;
+
+        copper_list = (UWORD *)balloc_stram(sizeof(UWORD) * 20, FALSE);
+        for (i = 0; i < 4; i++)
+        {
+            copper_list[2 + i * 4 + 0] = 0x0e0 + i * 4; /* BPLxPTH */
+            copper_list[2 + i * 4 + 1] = HIWORD(amiga_screenbase);
+            copper_list[2 + i * 4 + 2] = 0x0e2 + i * 4; /* BPLxPTL */
+            copper_list[2 + i * 4 + 3] = LOWORD(amiga_screenbase);
+        }
+        copper_list[18] = 0xffff; /* End of      */
+        copper_list[19] = 0xfffe; /* Copper list */
+    }
+
+    /* The bitplanes of colour modes (must be in Chip RAM) */
+    planar_buffer = balloc_stram(PLANAR_BUFFER_SIZE, FALSE);
+    amiga_set_bitplanes();
+#else
     /* Set up the Copper list (must be in ST-RAM) */
     copper_list = (UWORD *)balloc_stram(sizeof(UWORD) * 8, FALSE);
-    copper_list[0] = 0x0a01; /* Wait line 10 to give time to the VBL routine */
-    copper_list[1] = 0xff00; /* Vertical wait only */
     copper_list[2] = 0x0e0; /* BPL1PTH */
     copper_list[3] = HIWORD(amiga_screenbase);
     copper_list[4] = 0x0e2; /* BPL1PTL */
     copper_list[5] = LOWORD(amiga_screenbase);
     copper_list[6] = 0xffff; /* End of      */
     copper_list[7] = 0xfffe; /* Copper list */
+#endif
+    copper_list[0] = 0x0a01; /* Wait line 10 to give time to the VBL routine */
+    copper_list[1] = 0xff00; /* Vertical wait only */
 
     /* Initialize the Copper */
     COP1LCH = copper_list;
@@ -639,13 +892,23 @@ void amiga_screen_init(void)
     INTENA = SETBITS | INTEN | VERTB;
 
     /* Start the DMA, with bit plane and Copper */
+#if CONF_WITH_AMIGA_PLANAR
+    DMACON = SETBITS | COPEN | BPLEN | BLTEN | DMAEN;
+#else
     DMACON = SETBITS | COPEN | BPLEN | DMAEN;
+#endif
 }
 
 void amiga_setphys(const UBYTE *addr)
 {
     KDEBUG(("amiga_setphys(%p)\n", addr));
     amiga_screenbase = addr;
+#if CONF_WITH_AMIGA_PLANAR
+    if (amiga_planes <= 1)
+        amiga_displaybase = addr;
+    else
+        amiga_screen_dirty(0, amiga_screen_height - 1);
+#endif
 }
 
 const UBYTE *amiga_physbase(void)
@@ -657,6 +920,19 @@ WORD amiga_setcolor(WORD colorNum, WORD color)
 {
     KDEBUG(("amiga_setcolor(%d, 0x%04x)\n", colorNum, color));
 
+#if CONF_WITH_AMIGA_PLANAR
+    if (amiga_planes > 1)
+    {
+        WORD oldcolor;
+
+        colorNum &= 0x000f;
+        oldcolor = amiga_palette[colorNum];
+        if (color >= 0)
+            amiga_load_color(colorNum, color);
+        return oldcolor;
+    }
+#endif
+
     if (colorNum == 0)
         return 0x777;
     else
@@ -667,7 +943,32 @@ void amiga_setrez(WORD rez, WORD videlmode)
 {
     UWORD width, height;
 
-    /* Currently, we only support monochrome video modes */
+#if CONF_WITH_AMIGA_PLANAR
+    /* ST resolutions */
+    if (rez == ST_LOW)
+        videlmode = VIDEL_COMPAT|VIDEL_4BPP;
+    else if (rez == ST_MEDIUM)
+        videlmode = VIDEL_COMPAT|VIDEL_2BPP|VIDEL_80COL;
+    else if (rez == ST_HIGH)
+        videlmode = VIDEL_COMPAT|VIDEL_1BPP|VIDEL_80COL|VIDEL_VERTICAL;
+
+    /* The colour modes are limited to the ST ones, which fit in Chip RAM */
+    if ((videlmode & (VIDEL_VGA|VIDEL_PAL|VIDEL_VERTICAL|VIDEL_OVERSCAN)) == 0)
+    {
+        if ((videlmode & (VIDEL_BPPMASK|VIDEL_80COL)) == VIDEL_4BPP)
+        {
+            amiga_set_videomode(320, 200, 4);
+            return;
+        }
+        if ((videlmode & (VIDEL_BPPMASK|VIDEL_80COL)) == (VIDEL_2BPP|VIDEL_80COL))
+        {
+            amiga_set_videomode(640, 200, 2);
+            return;
+        }
+    }
+#endif
+
+    /* Other modes are monochrome */
     if ((videlmode & VIDEL_BPPMASK) != VIDEL_1BPP)
         return;
 
@@ -680,13 +981,20 @@ void amiga_setrez(WORD rez, WORD videlmode)
     else
         height = (videlmode & VIDEL_VERTICAL) ? 400 : 200;
 
-    amiga_set_videomode(width, height);
+    amiga_set_videomode(width, height, 1);
 }
 
 WORD amiga_vgetmode(void)
 {
     WORD mode = VIDEL_1BPP;
 
+#if CONF_WITH_AMIGA_PLANAR
+    if (amiga_planes == 4)
+        return VIDEL_COMPAT|VIDEL_4BPP;
+    if (amiga_planes == 2)
+        return VIDEL_COMPAT|VIDEL_2BPP|VIDEL_80COL;
+#endif
+
     if (amiga_screen_width >= 640)
         mode |= VIDEL_80COL;
 
@@ -1074,6 +1382,9 @@ void amiga_extra_vbl(void)
 {
     amiga_mouse_vbl();
     amiga_joystick_vbl();
+#if CONF_WITH_AMIGA_PLANAR
+    amiga_planar_vbl();
+#endif
 }
 
 /******************************************************************************/
@@ -1480,8 +1791,10 @@ static UWORD *mfm_track; /* MFM-encoded track buffer */
 static UBYTE sectors[MAX_SECTORS][SECTOR_SIZE]; /* Decoded sector data */
 static BOOL sectors_decoded = FALSE; /* TRUE if sectors[][] is valid */
 static UWORD crc_ccitt_table[256]; /* Precomputed CRC table */
+static UBYTE mfm_data_bits[256]; /* Precomputed data bits of an MFM byte */
 
 static void make_crc_ccitt_table(void);
+static void make_mfm_table(void);
 
 /* Initialize floppy driver */
 void amiga_floppy_init(void)
@@ -1495,6 +1808,7 @@ void amiga_floppy_init(void)
     KDEBUG(("mfm_track = %p, size = %lu\n", mfm_track, MFM_TRACK_SIZE));
 
     make_crc_ccitt_table(); /* Will be used to check track consistency */
+    make_mfm_table(); /* Will be used to decode tracks */
 
     /* Set /RDY /TK0 /WPRO /CHNG pins as input */
     CIAADDRA &= ~(0x20 | 0x10 | 0x08 | 0x04);
@@ -1795,8 +2109,7 @@ static UWORD get_crc_ccitt(const void *buffer, UWORD length)
 }
 
 /*
- * Decode a single MFM byte, and increment the pointer.
- * Rules:
+ * MFM rules:
  * - each bit is encoded as 2 bits
  * - 1 is encoded as 01
  * - 0 is encoded as 10 if following a 0
@@ -1807,26 +2120,34 @@ static UWORD get_crc_ccitt(const void *buffer, UWORD length)
  * https://jlgconsult.pagesperso-orange.fr/Atari/diskette/diskette_en.htm#MFM_Address_Marks
  * https://en.wikipedia.org/wiki/Modified_Frequency_Modulation
  */
+
+/*
+ * Precompute the 4 data bits of each MFM-encoded byte (bits 6, 4, 2, 0).
+ * Decoding with this table is much faster than shifting the bits out
+ * one by one, which matters on a 68000.
+ */
+static void make_mfm_table(void)
+{
+    int i, j;
+    UBYTE n;
+
+    for (i = 0; i < 256; i++)
+    {
+        n = 0;
+
+        for (j = 6; j >= 0; j -= 2)
+            n = (n << 1) | ((i >> j) & 1);
+
+        mfm_data_bits[i] = n;
+    }
+}
+
+/* Decode a single MFM byte, and increment the pointer */
 static UBYTE decode_mfm(const UWORD **ppmfm)
 {
     UWORD mfm = *(*ppmfm)++; /* MFM encoded byte, as word */
-    WORD counter; /* DBF counter */
-    UBYTE out; /* Decoded byte */
-
-    __asm__
-    (
-        "moveq   #7,%1\n"
-        "1:\n\t"
-        "add.w   %2,%2\n\t"
-        "addx.w  %2,%2\n\t"
-        "addx.b  %0,%0\n\t"
-        "dbf     %1,1b"
-    : "=&d"(out), "=&d"(counter)
-    : "d"(mfm)
-    :
-    );
 
-    return out;
+    return (mfm_data_bits[mfm >> 8] << 4) | mfm_data_bits[mfm & 0xff];
 }
 
 /* Decode 2 MFM bytes as a single big endian word */
@@ -47,6 +47,9 @@ extern UWORD amiga_screen_width_in_bytes;
 extern UWORD amiga_screen_height;
 extern const UBYTE *amiga_screenbase;
 extern UWORD *copper_list;
+#if CONF_WITH_AMIGA_PLANAR
+extern const UBYTE *amiga_displaybase;
+#endif
 extern int has_gayle;
 
 void amiga_machine_detect(void);
@@ -62,6 +62,7 @@
 #include "amiga.h"
 #include "lisa.h"
 #include "coldfire.h"
+#include "warmcache.h"
 #if WITH_CLI
 #include "../cli/clistub.h"
 #endif
@@ -107,6 +108,10 @@ UBYTE bootflags;
 void (*vector_5ms)(void);       /* 200 Hz system timer */
 #endif
 
+#if CONF_WITH_AES_PREEMPTION
+UWORD *timerc_frame;            /* see int_timerc in vectors.S */
+#endif
+
 /*==== BOOT ===============================================================*/
 
 
@@ -241,6 +246,9 @@ static void bios_init(void)
     vecs_init();        /* setup all exception vectors (above) */
     KDEBUG(("init_delay()\n"));
     init_delay();       /* set 'reasonable' default values for delay */
+#if CONF_WITH_WARM_CACHE
+    warm_cache_load();  /* reuse the detection results of a warm reset */
+#endif
 
     /* Detect optional hardware (video, sound, etc.) */
     KDEBUG(("machine_detect()\n"));
@@ -260,6 +268,15 @@ static void bios_init(void)
     amiga_autoconfig();
 #endif
 
+#if CONF_WITH_ROM_SHADOW
+    /*
+     * Copy the ROM to TT-RAM and run from there.  Must be done after
+     * TT-RAM detection, and before the 68040 MMU is initialized below.
+     */
+    KDEBUG(("rom_shadow_init()\n"));
+    rom_shadow_init();
+#endif
+
 #if CONF_WITH_68040_PMMU
     /*
      * Initialize the 68040 MMU if required
@@ -381,6 +398,9 @@ static void bios_init(void)
      */
     KDEBUG(("init_system_timer()\n"));
     init_system_timer();
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("hardware init");    /* times are counted from here */
+#endif
 
     /*
      * Now we can enable interrupts.  Although VBL & timer interrupts will
@@ -435,9 +455,17 @@ static void bios_init(void)
     /* Enable 50 Hz processing */
     timer_c_sieve = 0x1111;
 
-    KDEBUG(("calibrate_delay()\n"));
-    calibrate_delay();  /* determine values for delay() function */
-                        /*  - requires interrupts to be enabled  */
+#if CONF_WITH_WARM_CACHE
+    if (!warm_cache_valid)
+#endif
+    {
+        KDEBUG(("calibrate_delay()\n"));
+        calibrate_delay();  /* determine values for delay() function */
+                            /*  - requires interrupts to be enabled  */
+    }
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("devices init");
+#endif
 
     /* Initialize the DSP.  Since we currently use the system timer
      * in dsp_execboot(), which is called from dsp_init(), the latter
@@ -446,6 +474,9 @@ static void bios_init(void)
 #if CONF_WITH_DSP
     KDEBUG(("dsp_init()\n"));
     dsp_init();
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("dsp_init");
+#endif
 #endif
 
 #if CONF_WITH_MEMORY_TEST
@@ -458,6 +489,9 @@ static void bios_init(void)
         cprintf("\n%s:\n",_("Memory test"));
         ok = memory_test();         /* simple memory test, like Atari TOS */
         cprintf("%s %s\n",_("Memory test"),ok?_("complete"):_("aborted"));
+#if CONF_WITH_BOOT_PROFILE
+        boot_phase("memory_test");
+#endif
     }
 #endif
 
@@ -473,9 +507,19 @@ static void bios_init(void)
         }
     }
 
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("boot delay");
+#endif
+
     KDEBUG(("blkdev_init()\n"));
     blkdev_init();      /* floppy and harddisk initialisation */
     KDEBUG(("after blkdev_init()\n"));
+#if CONF_WITH_WARM_CACHE
+    warm_cache_save();  /* hardware detection is complete */
+#endif
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("blkdev_init");
+#endif
 
     /* initialize BIOS components */
 
@@ -484,6 +528,9 @@ static void bios_init(void)
     KDEBUG(("clock_init()\n"));
     clock_init();       /* init clock */
     KDEBUG(("after clock_init()\n"));
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("clock_init");
+#endif
 
 #if CONF_WITH_NOVA
     /* Detect and initialize a Nova card, skip if Ctrl is pressed */
@@ -520,6 +567,9 @@ static void bios_init(void)
     osinit_after_xmaddalt();    /* initialize BDOS (part 2) */
     KDEBUG(("after osinit_after_xmaddalt()\n"));
     boot_status |= DOS_AVAILABLE;   /* track progress */
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("BDOS init");
+#endif
 
     /* Enable VBL processing */
     swv_vec = os_header.reseth; /* reset system on monitor change & jump to _main */
@@ -545,6 +595,9 @@ static void bios_init(void)
     }
 #endif
 
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("bios_init");
+#endif
     KDEBUG(("bios_init() end\n"));
 }
 
@@ -779,6 +832,9 @@ void biosmain(void)
         bootdev = initinfo(&shiftbits); /* show the welcome screen */
     else
         shiftbits = kbshift(-1);
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("initinfo");
+#endif
 
     KDEBUG(("bootdev = %d\n", bootdev));
 
@@ -792,6 +848,9 @@ void biosmain(void)
 
     /* boot eventually from a block device (floppy or harddisk) */
     blkdev_boot();
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("blkdev_boot");
+#endif
 
     Dsetdrv(bootdev);           /* Set boot drive */
     init_default_environment(); /* Build default environment string */
@@ -813,6 +872,13 @@ void biosmain(void)
 #endif
 
     autoexec();                 /* autoexec PRGs from AUTO folder */
+#if CONF_WITH_BOOT_PROFILE
+    boot_phase("autoexec");
+    boot_profile_dump(FALSE);   /* the AES and desktop phases follow */
+#endif
+#if CONF_WITH_IRQ_TRACE
+    irq_trace_dump();           /* longest windows during the boot */
+#endif
 
     /* clear commandline */
 
@@ -835,6 +901,9 @@ void biosmain(void)
     }
 
 #if CONF_WITH_SHUTDOWN
+# if CONF_WITH_DSYNC
+    Dsync(-1);
+# endif
     /* try to shutdown the machine / close the emulator */
     shutdown();
 #endif
@@ -979,6 +1048,28 @@ LONG bconout(WORD handle, WORD what)
     return 0L;
 }
 
+/*
+ * bconouts - output a string of characters to a device
+ *
+ * this is used by the BDOS to output runs of printable characters to the
+ * console with one call.  it may only bypass the BIOS when neither the
+ * BIOS trap nor the console Bconout() vector has been redirected.
+ *
+ * returns FALSE if nothing was output: the caller must use Bconout()
+ */
+BOOL bconouts(WORD handle, const UBYTE *buf, LONG count)
+{
+    if (!(boot_status & CHARDEV_AVAILABLE))
+        return FALSE;
+
+    if ((handle != 2) || (VEC_BIOS != biostrap) || (bconout_vec[2] != bconout2))
+        return FALSE;
+
+    cputs(buf, count);
+
+    return TRUE;
+}
+
 #if DBGBIOS
 static LONG bios_3(WORD handle, WORD what)
 {
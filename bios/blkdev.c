@@ -29,6 +29,7 @@
 #include "scsi.h"
 #include "ide.h"
 #include "sd.h"
+#include "ramdisk.h"
 #include "scsidriv.h"
 #include "biosext.h"
 #include "biosmem.h"
@@ -51,6 +52,10 @@ BLKDEV blkdev[BLKDEVNUM];
 
 static PUN_INFO pun_info;
 
+#if CONF_WITH_MEDIACH_CACHE
+UWORD blkdev_changes;
+#endif
+
 /*
  * Function prototypes
  */
@@ -70,6 +75,14 @@ static UWORD getiword(UBYTE *addr)
     return value;
 }
 
+#if CONF_WITH_FAT32
+/* get intel longs */
+static ULONG getilong(UBYTE *addr)
+{
+    return MAKE_ULONG(getiword(addr+2), getiword(addr));
+}
+#endif
+
 /*
  * compute word checksum
  */
@@ -193,6 +206,10 @@ static void blkdev_hdv_init(void)
     scsidriv_init();    /* detect all devices */
 #endif
 
+#if CONF_WITH_DISK_CACHE
+    disk_cache_enable(TRUE);    /* the scan reads the same sectors repeatedly */
+#endif
+
     disk_init_all();    /* Detect hard disk partitions */
 
 #if CONF_WITH_XHDI
@@ -200,6 +217,10 @@ static void blkdev_hdv_init(void)
 #endif
 
     pun_info_setup();
+
+#if CONF_WITH_DISK_CACHE
+    disk_cache_enable(FALSE);
+#endif
 }
 
 /*
@@ -222,6 +243,10 @@ static void bus_init(void)
 #if CONF_WITH_SDMMC
     sd_init();
 #endif
+
+#if CONF_WITH_RAMDISK
+    ramdisk_init();
+#endif
 }
 
 /*
@@ -346,9 +371,19 @@ static BOOL getbpb_allowed(char *id)
         case 0x06:
         case 0x0e:
             return TRUE;
+#if CONF_WITH_FAT32
+        case 0x0b:
+        case 0x0c:
+            return TRUE;
+#endif
         }
     }
 
+#if CONF_WITH_FAT32
+    if (strcmp(id,"F32") == 0)
+        return TRUE;
+#endif
+
     return FALSE;
 }
 
@@ -407,9 +442,20 @@ int add_partition(UWORD unit, LONG *devices_available, char id[], ULONG start, U
 
 #define CNTMAX  0x7FFF  /* 16-bit MAXINT */
 
+/*
+ * wait before retrying a failed transfer
+ */
+static void retry_wait(ULONG ms)
+{
+    ULONG end = hz_200 + (ms + 4) / 5;
+
+    while (hz_200 < end)
+        ;
+}
+
 static LONG blkdev_rwabs(WORD rw, UBYTE *buf, WORD cnt, WORD recnr, WORD dev, LONG lrecnr)
 {
-    int retries = RWABS_RETRIES;
+    int retries, tries;
     int unit = dev;
     LONG lcount = cnt;
     LONG retval;
@@ -428,15 +474,15 @@ static LONG blkdev_rwabs(WORD rw, UBYTE *buf, WORD cnt, WORD recnr, WORD dev, LO
      */
     if ((dev < NUMFLOPPIES) && (buf == NULL)) {
         blkdev[dev].mediachange = cnt;
+#if CONF_WITH_MEDIACH_CACHE
+        blkdev_changes++;
+#endif
         return 0L;
     }
 
     if (recnr != -1)            /* if long offset not used */
         lrecnr = (UWORD)recnr;  /* recnr as unsigned to enable 16-bit recn */
 
-    if (rw & RW_NORETRIES)
-        retries = 1;
-
     /*
      * are we accessing a physical unit or a logical device?
      */
@@ -454,8 +500,12 @@ static LONG blkdev_rwabs(WORD rw, UBYTE *buf, WORD cnt, WORD recnr, WORD dev, LO
          */
         if (blkdev[dev].forcechange)
             return E_CHNG;
-        if ((rw & RW_WRITE) && (lrecnr == 0))
+        if ((rw & RW_WRITE) && (lrecnr == 0)) {
             blkdev[dev].forcechange = TRUE;
+#if CONF_WITH_MEDIACH_CACHE
+            blkdev_changes++;
+#endif
+        }
 
         /* convert logical sectors to physical ones */
         sectors = blkdev[dev].bpb.recsiz >> units[blkdev[dev].unit].psshift;
@@ -511,16 +561,28 @@ static LONG blkdev_rwabs(WORD rw, UBYTE *buf, WORD cnt, WORD recnr, WORD dev, LO
     psshift = units[unit].psshift;
     geo = &blkdev[unit].geometry;
 
+    if (rw & RW_NORETRIES)
+        retries = 1;
+    else
+        retries = (unit < NUMFLOPPIES) ? RWABS_RETRIES_FLOPPY : RWABS_RETRIES_DISK;
+
     do {
         /* split the transfer to 15-bit count blocks (lowlevel functions take WORD count) */
         WORD scount = (lcount > CNTMAX) ? CNTMAX : lcount;
         do {        /* outer loop retries if critical event handler says we should */
-            do {    /* inner loop automatically retries */
+            ULONG delay = RWABS_RETRY_DELAY;
+            tries = 0;
+            do {    /* inner loop automatically retries, backing off each time */
+                if (tries++)
+                {
+                    retry_wait(delay);
+                    delay <<= 1;
+                }
                 retval = (unit<NUMFLOPPIES) ? floppy_rw(rw, buf, scount, lrecnr, geo->spt, geo->sides, unit)
                                             : disk_rw(unit, (rw & ~RW_NOTRANSLATE), lrecnr, scount, buf);
                 if (retval == E_CHNG)       /* no automatic retry on media change */
                     break;
-            } while((retval < 0) && (--retries > 0));
+            } while((retval < 0) && (tries < retries));
             if ((retval < 0L) && !(rw & RW_NOTRANSLATE))    /* only call etv_critic for logical requests */
                 retval = call_etv_critic((WORD)retval,dev);
         } while(retval == CRITIC_RETRY_REQUEST);
@@ -564,6 +626,80 @@ WORD get_shift(ULONG blocksize)
 }
 
 
+#if CONF_WITH_FAT32
+/*
+ * getbpb_fat32 - build the BPB and its extension for a FAT32 filesystem
+ *
+ * returns FALSE if the filesystem is invalid
+ */
+static BOOL getbpb_fat32(BLKDEV *bdev, struct fat32_bs *b32)
+{
+    BPBEXT *x = &bdev->bpbext;
+    ULONG totsec, maxcl;
+    UWORD reserved, extflags, fsinfo;
+    UBYTE nfats = b32->fat;
+
+    if (bdev->bpb.rdlen)                /* FAT32 has no fixed root dir */
+        return FALSE;
+
+    reserved = getiword(b32->res);
+    if (reserved == 0)
+        reserved = 1;
+
+    x->fsiz = getilong(b32->spf32);
+    x->datrec = reserved + nfats * x->fsiz;
+
+    /*
+     * if FAT mirroring is disabled, only the active FAT is used: we
+     * treat the filesystem as having just that one
+     */
+    extflags = getiword(b32->extflags);
+    if (extflags & 0x0080)
+    {
+        if ((extflags & 0x000f) >= nfats)
+            return FALSE;
+        x->fatrec = reserved + (extflags & 0x000f) * x->fsiz;
+        nfats = 1;
+    }
+    else
+        x->fatrec = reserved + (nfats - 1) * x->fsiz;
+
+    totsec = getiword(b32->sec);
+    if (totsec == 0UL)
+        totsec = getilong(b32->sec2);
+    if ((x->fsiz == 0UL) || (totsec <= x->datrec))
+        return FALSE;
+
+    x->numcl = (totsec - x->datrec) / b32->spc;
+    maxcl = ((x->fsiz * bdev->bpb.recsiz) / 4) - 2;    /* FAT entries available */
+    if (x->numcl > maxcl)
+        x->numcl = maxcl;
+    if (x->numcl > MAX_FAT32_CLUSTERS)
+        x->numcl = MAX_FAT32_CLUSTERS;
+
+    x->rootcl = getilong(b32->rootcl);
+    if ((x->rootcl < 2) || (x->rootcl >= x->numcl + 2))
+        return FALSE;
+
+    fsinfo = getiword(b32->fsinfo);
+    x->fsinfo = (fsinfo < reserved) ? fsinfo : 0;
+
+    /* the standard fields cannot hold the values */
+    bdev->bpb.fsiz = 0;
+    bdev->bpb.fatrec = 0;
+    bdev->bpb.datrec = 0;
+    bdev->bpb.numcl = 0;
+    bdev->bpb.b_flags = B_32;
+    if (nfats < 2)
+        bdev->bpb.b_flags |= B_1FAT;
+
+    KDEBUG(("FAT32: fsiz=%lu, fatrec=%lu, datrec=%lu, numcl=%lu, rootcl=%lu, fsinfo=%u\n",
+            x->fsiz,x->fatrec,x->datrec,x->numcl,x->rootcl,x->fsinfo));
+
+    return TRUE;
+}
+#endif
+
 /*
  * blkdev_getbpb - Get BIOS parameter block
  *
@@ -592,6 +728,9 @@ LONG blkdev_getbpb(WORD dev)
 
     bdev->mediachange = MEDIANOCHANGE;      /* reset now */
     bdev->forcechange = FALSE;
+#if CONF_WITH_XHDI
+    bdev->flags &= ~BPB_VALID;
+#endif
     /*
      * set XHDI's "invalid BPB" indicator for non-floppy units
      * only, since they are the ones that might have a FAT32 or
@@ -696,6 +835,20 @@ LONG blkdev_getbpb(WORD dev)
 
     bdev->bpb.fsiz = getiword(b->spf);
 
+#if CONF_WITH_FAT32
+    /* FAT32 has no 16-bit FAT size: the real one is in the extended BPB */
+    if ((bdev->bpb.fsiz == 0) && (unit >= NUMFLOPPIES))
+    {
+        if (!getbpb_fat32(bdev, (struct fat32_bs *)dskbufp))
+        {
+            KINFO(("Disk %c: is inaccessible (invalid FAT32)\n",dev+'A'));
+            bdev->bpb.recsiz = 0;           /* mark it for XHDI */
+            return 0L;
+        }
+        goto bpb_done;
+    }
+#endif
+
     /* the structure of the logical disk is assumed to be:
      * - bootsector
      * - other reserved sectors (if any)
@@ -758,11 +911,18 @@ LONG blkdev_getbpb(WORD dev)
         bdev->bpb.b_flags |= B_1FAT;
 #endif
 
+#if CONF_WITH_FAT32
+bpb_done:
+#endif
     /* additional geometry info */
     bdev->geometry.sides = getiword(b->sides);
     bdev->geometry.spt = getiword(b->spt);
     memcpy(bdev->serial,b->serial,3);
     memcpy(bdev->serial2,b16->serial2,4);
+#if CONF_WITH_FAT32
+    if (bdev->bpb.b_flags & B_32)   /* at a different offset for FAT32 */
+        memcpy(bdev->serial2,((struct fat32_bs *)dskbufp)->serial2,4);
+#endif
 
     /* store checksums iff floppy drive */
     if (unit < NUMFLOPPIES)
@@ -776,6 +936,10 @@ LONG blkdev_getbpb(WORD dev)
             bdev->bpb.fatrec,bdev->bpb.datrec,bdev->bpb.numcl));
     KDEBUG(("  bflags = %d;\n}\n",bdev->bpb.b_flags));
 
+#if CONF_WITH_XHDI
+    bdev->flags |= BPB_VALID;
+#endif
+
     return (LONG) &bdev->bpb;
 }
 
@@ -817,11 +981,88 @@ static LONG blkdev_mediach(WORD dev)
     if (ret != MEDIANOCHANGE) {
         units[unit].status |= UNIT_CHANGED;
         b->mediachange = ret;
+#if CONF_WITH_MEDIACH_CACHE
+        blkdev_changes++;
+#endif
+#if CONF_WITH_XHDI
+        b->flags &= ~BPB_VALID;
+#endif
+#if CONF_WITH_DISK_CACHE
+        disk_cache_flush(unit);
+#endif
     }
 
     return b->mediachange;
 }
 
+#if CONF_WITH_MEDIACH_CACHE
+/*
+ * blkdev_fixed - return TRUE if the device is on a non-removable unit
+ * handled by EmuTOS, with no media change pending
+ *
+ * Mediach() can only report a change for such a device once something
+ * has incremented blkdev_changes
+ */
+BOOL blkdev_fixed(WORD dev)
+{
+    BLKDEV *b = &blkdev[dev];
+
+    if ((dev < 0) || (dev >= BLKDEVNUM) || !(b->flags&DEVICE_VALID))
+        return FALSE;
+
+    if (hdv_mediach != blkdev_mediach)  /* a driver has taken over */
+        return FALSE;
+
+    if (units[b->unit].features & UNIT_REMOVABLE)
+        return FALSE;
+
+    return (b->mediachange == MEDIANOCHANGE) && !b->forcechange;
+}
+#endif
+
+#if CONF_WITH_RAMDISK
+/*
+ * blkdev_direct - return the address of a logical sector of a device on
+ * the RAM disk, or NULL if the device is not on the RAM disk
+ *
+ * this lets the BDOS access the sector in place: it is only done while
+ * Rwabs() is our own, so that no driver is bypassed
+ */
+UBYTE *blkdev_direct(WORD dev, LONG lrecnr)
+{
+    BLKDEV *b = &blkdev[dev];
+    UWORD unit, major;
+    WORD shift;
+
+    if ((dev < 0) || (dev >= BLKDEVNUM) || !(b->flags&DEVICE_VALID))
+        return NULL;
+
+    if (hdv_rw != blkdev_rwabs)     /* a driver has taken over */
+        return NULL;
+
+    unit = b->unit;
+    major = unit - NUMFLOPPIES;
+    if ((unit < NUMFLOPPIES) || !IS_RAMDISK_DEVICE(major))
+        return NULL;
+#if DETECT_NATIVE_FEATURES
+    if (units[unit].features & UNIT_NATFEATS)
+        return NULL;
+#endif
+
+    /* convert the logical sector to a physical one, as blkdev_rwabs() does */
+    if ((b->bpb.recsiz == 0) || b->forcechange || (lrecnr < 0))
+        return NULL;
+    shift = get_shift(b->bpb.recsiz) - units[unit].psshift;
+    if (shift < 0)
+        return NULL;
+    lrecnr <<= shift;
+    if ((b->size > 0) && (lrecnr >= b->size))
+        return NULL;
+
+    return ramdisk_address(major - RAMDISK_BUS * DEVICES_PER_BUS, b->start + lrecnr);
+}
+#endif
+
 
 /**
  * blkdev_drvmap - Read drive bitmap
@@ -0,0 +1,63 @@
+/*
+ * bootprof.c - boot time profiling
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+#include "emutos.h"
+#include "biosdefs.h"
+#include "biosext.h"
+#include "bootprof.h"
+#include "tosvars.h"
+#include "mfp.h"
+
+#if CONF_WITH_BOOT_PROFILE
+
+BOOT_PROFILE boot_profile;
+
+/*
+ * record the end of a boot phase: must be called in supervisor mode,
+ * and after the system timer has been started (before that, all the
+ * times would be 0)
+ */
+void boot_phase(const char *name)
+{
+    WORD n = boot_profile.count;
+
+    if (boot_profile.complete || (n >= BOOT_PROFILE_MAX))
+        return;
+
+#if CONF_WITH_HIRES_CLOCK
+    boot_profile.phase[n].usec = hires_clock();
+#else
+    boot_profile.phase[n].usec = hz_200 * (1000000UL / CLOCKS_PER_SEC);
+#endif
+    boot_profile.phase[n].name = name;
+    boot_profile.count = n + 1;
+}
+
+/*
+ * output the phases recorded since the previous call to the debugger,
+ * with the time spent in each one.  if 'complete' is TRUE, the boot is
+ * complete and further phases (e.g. after a resolution change) are not
+ * recorded.
+ */
+void boot_profile_dump(BOOL complete)
+{
+    WORD i;
+    ULONG prev;
+
+    for (i = boot_profile.dumped; i < boot_profile.count; i++)
+    {
+        prev = i ? boot_profile.phase[i-1].usec : 0UL;
+        KINFO(("boot: %-24s %8lu us (+%lu us)\n", boot_profile.phase[i].name,
+            boot_profile.phase[i].usec, boot_profile.phase[i].usec - prev));
+    }
+    boot_profile.dumped = boot_profile.count;
+    boot_profile.complete = complete;
+}
+
+#endif /* CONF_WITH_BOOT_PROFILE */
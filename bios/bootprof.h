@@ -0,0 +1,40 @@
+/*
+ * bootprof.h - boot time profiling
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+#ifndef BOOTPROF_H
+#define BOOTPROF_H
+
+#if CONF_WITH_BOOT_PROFILE
+
+#define BOOT_PROFILE_MAX    32  /* max number of recorded phases */
+
+/*
+ * the ETBP cookie points to this structure; 'usec' is the time in
+ * microseconds at the end of each phase, counted from the start of
+ * the system timer
+ */
+typedef struct
+{
+    WORD count;                 /* number of recorded phases */
+    WORD dumped;                /* number of phases already output */
+    WORD complete;              /* TRUE when the boot is complete */
+    struct
+    {
+        const char *name;
+        ULONG usec;
+    } phase[BOOT_PROFILE_MAX];
+} BOOT_PROFILE;
+
+extern BOOT_PROFILE boot_profile;
+
+/* boot_phase() and boot_profile_dump() are declared in include/biosext.h */
+
+#endif /* CONF_WITH_BOOT_PROFILE */
+
+#endif /* BOOTPROF_H */
@@ -0,0 +1,141 @@
+/*
+ * cachectl.c - cache control for applications (Cachectl)
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/* #define ENABLE_KDEBUG */
+
+#include "emutos.h"
+#include "biosext.h"
+#include "cachectl.h"
+#include "gemerror.h"
+#include "tosvars.h"
+
+#if CONF_WITH_CACHECTL
+
+#if CONF_WITH_68040_PMMU
+
+/* in 68040_pmmu.S */
+extern LONG *pmmu040_root;  /* root table, or NULL if no PMMU tree */
+void pmmu040_flush(void);
+
+#define PAGE_SIZE_040   4096UL
+
+/* 68040 descriptor fields, see 68040_pmmu.S */
+#define DESC_RESIDENT   0x02                /* root & pointer descriptors */
+#define DESC_PAGE       0x03                /* page descriptors */
+#define DESC_CM_SHIFT   5
+#define DESC_CM_MASK    (3UL << DESC_CM_SHIFT)
+
+#define CM_WRITETHROUGH 0
+#define CM_COPYBACK     1
+#define CM_PRECISE      2                   /* cache-inhibited, serialized */
+
+/*
+ * return a pointer to the page descriptor for 'addr', or NULL if
+ * it is not mapped
+ */
+static LONG *page_descriptor(ULONG addr)
+{
+    LONG *table = pmmu040_root;
+    LONG desc;
+
+    desc = table[addr >> 25];
+    if (!(desc & DESC_RESIDENT))
+        return NULL;
+    table = (LONG *)(desc & 0xfffffe00UL);
+
+    desc = table[(addr >> 18) & 0x7f];
+    if (!(desc & DESC_RESIDENT))
+        return NULL;
+    table = (LONG *)(desc & 0xffffff00UL);
+
+    table += (addr >> 12) & 0x3f;
+    if (!(*table & DESC_PAGE))
+        return NULL;
+
+    return table;
+}
+
+/*
+ * set the cache mode of a region of RAM, which must be aligned on a
+ * page boundary
+ */
+static LONG set_cache_mode(ULONG start, LONG size, UWORD mode)
+{
+    ULONG addr, end = start + size;
+    LONG *desc;
+
+    if (!pmmu040_root)
+        return EINVFN;
+
+    if ((start | size) & (PAGE_SIZE_040-1))
+        return ERANGE;
+
+    /* only allow RAM, never the ROM or I/O areas */
+    if (end > (ULONG)phystop)
+    {
+        if ((start < (ULONG)TTRAM_START) || (end > (ULONG)ramtop))
+            return ERANGE;
+    }
+
+    /* check everything before changing anything */
+    for (addr = start; addr < end; addr += PAGE_SIZE_040)
+        if (!page_descriptor(addr))
+            return ERANGE;
+
+    for (addr = start; addr < end; addr += PAGE_SIZE_040)
+    {
+        desc = page_descriptor(addr);
+        *desc = (*desc & ~DESC_CM_MASK) | ((ULONG)mode << DESC_CM_SHIFT);
+    }
+    pmmu040_flush();    /* push modified data, then use the new modes */
+
+    KDEBUG(("cachectl: %08lx-%08lx set to cache mode %u\n", start, end, mode));
+
+    return E_OK;
+}
+#endif /* CONF_WITH_68040_PMMU */
+
+/*
+ * Cachectl() - EmuTOS-specific XBIOS function
+ *
+ * the first three operations apply to the caches, for the given zone
+ * of memory.  the others set the cache mode of a region of RAM: this
+ * requires a PMMU tree, so it is currently only supported when
+ * CONF_WITH_68040_PMMU is set and the tree has been installed;
+ * otherwise EINVFN is returned.
+ */
+LONG cachectl(WORD op, void *start, LONG size)
+{
+    switch(op) {
+    case CACHECTL_PUSH_DATA:
+        push_data_cache(start, size);
+        break;
+    case CACHECTL_INVAL_DATA:
+        invalidate_data_cache(start, size);
+        break;
+    case CACHECTL_INVAL_INSN:
+        push_data_cache(start, size);   /* e.g. for self-modifying code */
+        invalidate_instruction_cache(start, size);
+        break;
+#if CONF_WITH_68040_PMMU
+    case CACHECTL_WRITETHROUGH:
+        return set_cache_mode((ULONG)start, size, CM_WRITETHROUGH);
+    case CACHECTL_COPYBACK:
+        return set_cache_mode((ULONG)start, size, CM_COPYBACK);
+    case CACHECTL_INHIBIT:
+        return set_cache_mode((ULONG)start, size, CM_PRECISE);
+#endif
+    default:
+        return EINVFN;
+    }
+
+    return E_OK;
+}
+
+#endif /* CONF_WITH_CACHECTL */
@@ -0,0 +1,30 @@
+/*
+ * cachectl.h - cache control for applications (Cachectl)
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+#ifndef CACHECTL_H
+#define CACHECTL_H
+
+#if CONF_WITH_CACHECTL
+
+/* values for the 'op' argument of Cachectl() */
+#define CACHECTL_PUSH_DATA      0   /* push modified data to memory */
+#define CACHECTL_INVAL_DATA     1   /* invalidate the data cache */
+#define CACHECTL_INVAL_INSN     2   /* push data, invalidate the instruction cache */
+#define CACHECTL_WRITETHROUGH   3   /* set region to write-through */
+#define CACHECTL_COPYBACK       4   /* set region to copyback */
+#define CACHECTL_INHIBIT        5   /* set region to cache-inhibited */
+
+LONG cachectl(WORD op, void *start, LONG size);
+
+/* in processor.S */
+void push_data_cache(void *start, long size);
+
+#endif /* CONF_WITH_CACHECTL */
+
+#endif /* CACHECTL_H */
@@ -24,6 +24,7 @@
 #include "ikbd.h"
 #include "midi.h"
 #include "parport.h"
+#include "hardcopy.h"
 
 #define NUM_CHAR_VECS   8
 
@@ -81,7 +82,11 @@ int i;
     /* setup parallel output functions */
     prt_stat = just_rts;
     prt_vec = just_rts;
+#if CONF_WITH_HARDCOPY
+    dump_vec = hardcopy_start;
+#else
     dump_vec = just_rts;
+#endif
 }
 
 
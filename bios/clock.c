@@ -1213,6 +1213,14 @@ void clock_init(void)
 #endif /* CONF_WITH_IKBD_CLOCK */
 }
 
+#if CONF_WITH_CLOCK_CACHE
+/*
+ * hz_200 value when the GEMDOS software clock was last set from, or
+ * written to, the clock hardware
+ */
+static LONG clock_synced;
+#endif
+
 /* xbios functions */
 
 void settime(LONG time)
@@ -1220,6 +1228,9 @@ void settime(LONG time)
     /* Update GEMDOS time and date */
     current_time = LOWORD(time);
     current_date = HIWORD(time);
+#if CONF_WITH_CLOCK_CACHE
+    clock_synced = hz_200;
+#endif
 
     if (FALSE)
     {
@@ -1263,7 +1274,7 @@ void settime(LONG time)
     }
 }
 
-LONG gettime(void)
+static LONG getdt(void)
 {
     if (FALSE)
     {
@@ -1320,3 +1331,30 @@ LONG gettime(void)
 #endif /* CONF_WITH_IKBD_CLOCK */
     }
 }
+
+LONG gettime(void)
+{
+#if CONF_WITH_CLOCK_CACHE
+    LONG dt;
+
+    /*
+     * current_date is zero until GEMDOS has been initialised, and the
+     * software clock is only maintained by GEMDOS after that
+     */
+    if (current_date && (hz_200 - clock_synced < CLOCK_RESYNC_SECONDS*CLOCKS_PER_SEC))
+        return MAKE_ULONG(current_date, current_time);
+
+    dt = getdt();
+    if (current_date)
+    {
+        /* resynchronise the software clock */
+        current_time = LOWORD(dt);
+        current_date = HIWORD(dt);
+        clock_synced = hz_200;
+    }
+
+    return dt;
+#else
+    return getdt();
+#endif
+}
@@ -66,6 +66,23 @@ void coldfire_rs232_write_byte(UBYTE b)
 
 #if CONF_COLDFIRE_TIMER_C
 
+#if CONF_WITH_HIRES_CLOCK
+/* slice timer 1 count at the last GPT1 interrupt, set in coldfire2.S */
+ULONG coldfire_slt_tick;
+
+/* return the microseconds elapsed since the last 200 Hz tick */
+ULONG coldfire_usec_since_tick(void)
+{
+    ULONG usec;
+
+    /* the slice timer counts down at the system bus frequency */
+    usec = (coldfire_slt_tick - MCF_SLT1_SCNT) / (ULONG)cookie_mcf.sysbus_frequency;
+
+    /* never reach the next tick, in case its interrupt is pending */
+    return (usec < 5000UL) ? usec : 4999UL;
+}
+#endif
+
 void coldfire_init_system_timer(void)
 {
     /* Disable the timer before configuration */
@@ -92,6 +109,13 @@ void coldfire_init_system_timer(void)
                    MCF_GPT_GMS_SC       | /* Continuous mode */
                    MCF_GPT_GMS_IEN      | /* Interrupt enable */
                    MCF_GPT_GMS_TMS(4UL);  /* Internal timer */
+
+#if CONF_WITH_HIRES_CLOCK
+    /* Let slice timer 1 run freely, without interrupts */
+    MCF_SLT1_STCNT = 0xffffffffUL;
+    MCF_SLT1_SCR = MCF_SLT_SCR_TEN | MCF_SLT_SCR_RUN;
+    coldfire_slt_tick = MCF_SLT1_SCNT;
+#endif
 }
 
 #endif /* CONF_COLDFIRE_TIMER_C */
@@ -25,6 +25,10 @@ void coldfire_rs232_write_byte(UBYTE b);
 #if CONF_COLDFIRE_TIMER_C
 void coldfire_init_system_timer(void);
 void coldfire_int_61(void); /* In coldfire2.S */
+# if CONF_WITH_HIRES_CLOCK
+ULONG coldfire_usec_since_tick(void);
+extern ULONG coldfire_slt_tick;
+# endif
 #endif
 
 #ifdef MACHINE_M548X
@@ -23,12 +23,55 @@
 #include "sound.h"              /* for bell() */
 #include "string.h"
 #include "conout.h"
+#include "has.h"                /* for HAS_BLITTER, HAS_NOVA */
+#include "blitter.h"
+#include "biosext.h"            /* for cache control routines */
+#include "processor.h"          /* for mcpu */
 
 
 
 #define PLANE_OFFSET    2       /* interleaved planes */
 
 
+#if CONF_WITH_DEFERRED_CONSOLE
+/*
+ * the shadow copy of the text screen used in deferred mode.  screen row y
+ * is held in ring slot (shadow_top+y) modulo the number of rows, so that
+ * scrolling the whole screen up just advances shadow_top.  the changed
+ * cells in each slot are kept as a range of columns (clean if lo > hi).
+ */
+#define SHADOW_MAXCOLS  160
+#define SHADOW_MAXROWS  60
+
+typedef struct {
+    UBYTE ch;                   /* character code */
+    UBYTE fg;                   /* foreground colour */
+    UBYTE bg;                   /* background colour */
+} SHADOWCELL;
+
+static SHADOWCELL shadow[SHADOW_MAXROWS][SHADOW_MAXCOLS];
+static WORD shadow_lo[SHADOW_MAXROWS];  /* first changed column in slot */
+static WORD shadow_hi[SHADOW_MAXROWS];  /* last changed column in slot */
+static WORD shadow_rows;        /* number of rows in use (0 => immediate mode) */
+static WORD shadow_top;         /* ring slot of screen row 0 */
+static WORD shadow_scrolled;    /* full screen scrolls not yet displayed */
+static BOOL shadow_changed;     /* anything to repaint? */
+
+static BOOL cur_on;             /* cursor state as seen by the VT52 code ... */
+static WORD cur_x, cur_y;
+static BOOL drawn_on;           /* ... and as actually drawn on screen */
+static WORD drawn_x, drawn_y;
+
+static volatile WORD shadow_busy;   /* >0 while the shadow is being updated */
+static volatile BOOL shadow_due;    /* VBL repaint skipped while busy */
+static BOOL shadow_in_vbl;          /* repainting from the VBL interrupt */
+
+static void shadow_put(int ch, UWORD fg, UWORD bg);
+static void shadow_neg(UBYTE *cell);
+static void shadow_blank(int topx, int topy, int botx, int boty);
+#endif
+
+
 /*
  * char_addr - retrieve the address of the source cell
  *
@@ -117,6 +160,26 @@ static UBYTE *cell_addr(UWORD x, UWORD y)
 
 
 
+/*
+ * get_colors - get the colours to use for text output
+ *
+ * this takes reverse video into account
+ */
+static void get_colors(UWORD *fg, UWORD *bg)
+{
+    /* check for reversed foreground and background colors */
+    if (v_stat_0 & M_REVID) {
+        *fg = v_col_bg;
+        *bg = v_col_fg;
+    }
+    else {
+        *fg = v_col_fg;
+        *bg = v_col_bg;
+    }
+}
+
+
+
 /*
  * cell_xfer - Performs a byte aligned block transfer.
  *
@@ -129,32 +192,108 @@ static UBYTE *cell_addr(UWORD x, UWORD y)
  * in:
  * a0.l      points to contiguous source block (1 byte wide)
  * a1.l      points to destination (1st plane, top of block)
+ * fg, bg    foreground & background colours (see get_colors())
  *
  * out:
  * a4      points to byte below this cell's bottom
  */
 
-static void cell_xfer(UBYTE *src, UBYTE *dst)
+/*
+ * per-plane masks for the current colours
+ *
+ * for each plane, the and-mask selects the font data when the colours
+ * differ, and the xor-mask inverts it (or the blank) when the background
+ * colour bit is set.  they are only recomputed when the colours change.
+ */
+static UBYTE andmask[8], xormask[8];
+static UWORD mask_fg = 0xffff, mask_bg = 0xffff;
+
+static void get_masks(UWORD fg, UWORD bg)
 {
-    UBYTE * src_sav, * dst_sav;
-    UWORD fg;
-    UWORD bg;
-    int fnt_wr, line_wr;
     int plane;
 
+    if ((fg == mask_fg) && (bg == mask_bg))
+        return;
+
+    mask_fg = fg;
+    mask_bg = bg;
+    for (plane = 0; plane < 8; plane++, fg >>= 1, bg >>= 1) {
+        andmask[plane] = ((fg ^ bg) & 0x0001) ? 0xff : 0x00;
+        xormask[plane] = (bg & 0x0001) ? 0xff : 0x00;
+    }
+}
+
+/*
+ * line_cell_xfer - version of cell_xfer() for 2 to 8 planes
+ *
+ * this processes the cell a line at a time rather than a plane at a
+ * time, so each font byte is read only once, and each plane's byte is
+ * derived from it without branching.  the usual plane counts have their
+ * own loops, with the masks held in registers.
+ */
+static void line_cell_xfer(UBYTE *src, UBYTE *dst, UWORD fg, UWORD bg)
+{
+    int fnt_wr, line_wr;
+    int plane, planes, i;
+    UBYTE data;
+
     fnt_wr = v_fnt_wr;
     line_wr = v_lin_wr;
+    planes = v_planes;
 
-    /* check for reversed foreground and background colors */
-    if (v_stat_0 & M_REVID) {
-        fg = v_col_bg;
-        bg = v_col_fg;
+    get_masks(fg, bg);
+
+    if (planes == 2) {
+        UBYTE a0 = andmask[0], x0 = xormask[0];
+        UBYTE a1 = andmask[1], x1 = xormask[1];
+
+        for (i = v_cel_ht; i--; dst += line_wr, src += fnt_wr) {
+            data = *src;
+            dst[0] = (data & a0) ^ x0;
+            dst[PLANE_OFFSET] = (data & a1) ^ x1;
+        }
+        return;
     }
-    else {
-        fg = v_col_fg;
-        bg = v_col_bg;
+
+    if (planes == 4) {
+        UBYTE a0 = andmask[0], x0 = xormask[0];
+        UBYTE a1 = andmask[1], x1 = xormask[1];
+        UBYTE a2 = andmask[2], x2 = xormask[2];
+        UBYTE a3 = andmask[3], x3 = xormask[3];
+
+        for (i = v_cel_ht; i--; dst += line_wr, src += fnt_wr) {
+            data = *src;
+            dst[0] = (data & a0) ^ x0;
+            dst[PLANE_OFFSET] = (data & a1) ^ x1;
+            dst[2*PLANE_OFFSET] = (data & a2) ^ x2;
+            dst[3*PLANE_OFFSET] = (data & a3) ^ x3;
+        }
+        return;
+    }
+
+    for (i = v_cel_ht; i--; dst += line_wr, src += fnt_wr) {
+        UBYTE *work = dst;
+
+        data = *src;
+        for (plane = 0; plane < planes; plane++, work += PLANE_OFFSET)
+            *work = (data & andmask[plane]) ^ xormask[plane];
+    }
+}
+
+static void cell_xfer(UBYTE *src, UBYTE *dst, UWORD fg, UWORD bg)
+{
+    UBYTE * src_sav, * dst_sav;
+    int fnt_wr, line_wr;
+    int plane;
+
+    if ((v_planes >= 2) && (v_planes <= 8)) {
+        line_cell_xfer(src, dst, fg, bg);
+        return;
     }
 
+    fnt_wr = v_fnt_wr;
+    line_wr = v_lin_wr;
+
     src_sav = src;
     dst_sav = dst;
 
@@ -209,7 +348,7 @@ static void cell_xfer(UBYTE *src, UBYTE *dst)
 
 
 /*
- * neg_cell - negates
+ * neg_pixels - negates
  *
  * This routine negates the contents of an arbitrarily-tall byte-wide cell
  * composed of an arbitrary number of (Atari-style) bit-planes.
@@ -223,7 +362,7 @@ static void cell_xfer(UBYTE *src, UBYTE *dst)
  * out:
  */
 
-static void neg_cell(UBYTE *cell)
+static void neg_pixels(UBYTE *cell)
 {
     int plane, len;
     int cell_len = v_cel_ht;
@@ -244,6 +383,23 @@ static void neg_cell(UBYTE *cell)
     v_stat_0 &= ~M_CRIT;                /* end of critical section. */
 }
 
+/*
+ * neg_cell - negates a cell, as neg_pixels()
+ *
+ * in deferred mode, this is only done by the next repaint
+ */
+static void neg_cell(UBYTE *cell)
+{
+#if CONF_WITH_DEFERRED_CONSOLE
+    if (shadow_rows) {
+        shadow_neg(cell);               /* drawn by the next repaint */
+        return;
+    }
+#endif
+
+    neg_pixels(cell);
+}
+
 
 
 /*
@@ -378,6 +534,87 @@ void move_cursor(int x, int y)
 
 
 
+/*
+ * cell_crlf - perform a carriage return & line feed after the last cell
+ *
+ * this is called when next_cell() reports that a wrap is required
+ */
+static void cell_crlf(void)
+{
+    UBYTE * cell;
+    UWORD y = v_cur_cy;
+
+    /* perform cell carriage return. */
+    cell = v_bas_ad + (ULONG)v_cel_wr * y;
+    v_cur_cx = 0;                       /* set X to first cell in line */
+
+    /* perform cell line feed. */
+    if (y < v_cel_my) {
+        cell += v_cel_wr;               /* move down one cell */
+        v_cur_cy = y + 1;               /* update cursor's y coordinate */
+    }
+    else {
+        scroll_up(0);                   /* scroll from top of screen */
+    }
+    v_cur_ad = cell;                    /* update cursor address */
+}
+
+
+
+/*
+ * hide_cursor - start of text output
+ *
+ * returns TRUE iff the cursor was visible, in which case show_cursor()
+ * must be called at the end of the output
+ */
+static BOOL hide_cursor(void)
+{
+    if (v_stat_0 & M_CVIS) {
+        v_stat_0 &= ~M_CVIS;            /* start of critical section */
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+
+/*
+ * show_cursor - end of text output: display the cursor at its new position
+ */
+static void show_cursor(void)
+{
+    neg_cell(v_cur_ad);                 /* display cursor. */
+    v_stat_0 |= M_CSTATE;               /* set state flag (cursor on). */
+    v_stat_0 |= M_CVIS;                 /* end of critical section. */
+
+    /* do not flash the cursor when it moves */
+    if (v_stat_0 & M_CFLASH) {
+        v_cur_tim = v_period;           /* reset the timer. */
+    }
+}
+
+
+
+/*
+ * out_cell - put a character at the cursor position
+ *
+ * src is the character source (see char_addr())
+ */
+static void out_cell(UBYTE *src, int ch, UWORD fg, UWORD bg)
+{
+#if CONF_WITH_DEFERRED_CONSOLE
+    if (shadow_rows) {
+        shadow_put(ch, fg, bg);
+        return;
+    }
+#endif
+
+    cell_xfer(src, v_cur_ad, fg, bg);
+}
+
+
+
 /*
  * ascii_out - prints an ascii character on the screen
  *
@@ -388,54 +625,71 @@ void move_cursor(int x, int y)
 
 void ascii_out(int ch)
 {
-    UBYTE * src, * dst;
+    UBYTE * src;
+    UWORD fg, bg;
     BOOL visible;                       /* was the cursor visible? */
 
     src = char_addr(ch);                /* a0 -> get character source */
     if (src == NULL)
         return;                         /* no valid character */
 
-    dst = v_cur_ad;                     /* a1 -> get destination */
-
-    visible = v_stat_0 & M_CVIS;        /* test visibility bit */
-    if (visible) {
-        v_stat_0 &= ~M_CVIS;                    /* start of critical section */
-    }
+    visible = hide_cursor();
 
     /* put the cell out (this covers the cursor) */
-    cell_xfer(src, dst);
+    get_colors(&fg, &bg);
+    out_cell(src, ch, fg, bg);
 
     /* advance the cursor and update cursor address and coordinates */
-    if (next_cell()) {
-        UBYTE * cell;
-        UWORD y = v_cur_cy;
-
-        /* perform cell carriage return. */
-        cell = v_bas_ad + (ULONG)v_cel_wr * y;
-        v_cur_cx = 0;                   /* set X to first cell in line */
-
-        /* perform cell line feed. */
-        if (y < v_cel_my) {
-            cell += v_cel_wr;           /* move down one cell */
-            v_cur_cy = y + 1;           /* update cursor's y coordinate */
-        }
-        else {
-            scroll_up(0);               /* scroll from top of screen */
-        }
-        v_cur_ad = cell;                /* update cursor address */
-    }
+    if (next_cell())
+        cell_crlf();
 
     /* if visible */
-    if (visible) {
-        neg_cell(v_cur_ad);             /* display cursor. */
-        v_stat_0 |= M_CSTATE;           /* set state flag (cursor on). */
-        v_stat_0 |= M_CVIS;             /* end of critical section. */
-
-        /* do not flash the cursor when it moves */
-        if (v_stat_0 & M_CFLASH) {
-            v_cur_tim = v_period;       /* reset the timer. */
-        }
+    if (visible)
+        show_cursor();
+}
+
+
+
+/*
+ * ascii_outs - prints a run of ascii characters on the screen
+ *
+ * this has the same effect as calling ascii_out() for each character,
+ * but the cursor is hidden & redisplayed and the colours are determined
+ * once for the whole run.  the destination address is carried from one
+ * cell to the next by next_cell().
+ *
+ * in:
+ *
+ * buf       the characters (none of which may be control characters)
+ * count     the number of characters
+ */
+
+void ascii_outs(const UBYTE *buf, int count)
+{
+    UBYTE * src;
+    UWORD fg, bg;
+    BOOL visible;                       /* was the cursor visible? */
+
+    visible = hide_cursor();
+    get_colors(&fg, &bg);
+
+    while (count-- > 0) {
+        int ch = *buf++;
+
+        src = char_addr(ch);
+        if (src == NULL)
+            continue;                   /* no valid character */
+
+        /* put the cell out (the first one covers the cursor) */
+        out_cell(src, ch, fg, bg);
+
+        /* advance the cursor and update cursor address and coordinates */
+        if (next_cell())
+            cell_crlf();
     }
+
+    if (visible)
+        show_cursor();
 }
 
 
@@ -462,7 +716,16 @@ void blank_out(int topx, int topy, int botx, int boty)
 {
     UWORD color = v_col_bg;             /* bg color value */
     int pair, pairs, row, rows, offs;
-    UBYTE * addr = cell_addr(topx, topy);   /* running pointer to screen */
+    UBYTE * addr;                       /* running pointer to screen */
+
+#if CONF_WITH_DEFERRED_CONSOLE
+    if (shadow_rows) {
+        shadow_blank(topx, topy, botx, boty);
+        return;
+    }
+#endif
+
+    addr = cell_addr(topx, topy);
 
     /*
      * # of cell-pairs per row in region - 1
@@ -536,6 +799,444 @@ void blank_out(int topx, int topy, int botx, int boty)
 }
 
 
+#if CONF_WITH_BLITTER
+/*
+ * blit_copy - move a contiguous screen region with the blitter
+ *
+ * The region is moved as count/v_lin_wr lines of v_lin_wr/2 words.  If
+ * the destination is above the source, the copy is done backwards from
+ * the last word so that the overlapping part is not overwritten.
+ */
+static void blit_copy(UBYTE *dst, UBYTE *src, ULONG count)
+{
+    WORD incr = 2;
+
+    flush_data_cache(dst, count);
+
+    if (dst > src)
+    {
+        incr = -2;
+        src += count - 2;
+        dst += count - 2;
+    }
+
+    BLITTER->src_x_incr = incr;
+    BLITTER->src_y_incr = incr;
+    BLITTER->src_addr = (UWORD *)src;
+    BLITTER->endmask_1 = 0xffff;
+    BLITTER->endmask_2 = 0xffff;
+    BLITTER->endmask_3 = 0xffff;
+    BLITTER->dst_x_incr = incr;
+    BLITTER->dst_y_incr = incr;
+    BLITTER->dst_addr = (UWORD *)dst;
+    BLITTER->x_count = v_lin_wr / 2;
+    BLITTER->y_count = count / v_lin_wr;
+    BLITTER->op = 3;            /* D = S */
+    BLITTER->hop = HOP_SOURCE_ONLY;
+    BLITTER->skew = 0;
+
+    /* no-HOG mode, restarting the blitter until done, as in the VDI */
+    BLITTER->status = BUSY;
+    __asm__ __volatile__(
+    "lea    0xFFFF8A3C,a0\n\t"
+    "0:\n\t"
+    "tas    (a0)\n\t"
+    "nop\n\t"
+    "jbmi   0b\n\t"
+    :
+    :
+    : "a0", "memory", "cc"
+    );
+
+    invalidate_data_cache(dst, count);
+}
+#endif
+
+
+
+/*
+ * scroll_copy - move the scrolled part of the screen
+ *
+ * dst and src are one cell line apart, and count is a whole number of
+ * cell lines.  The blitter is used when enabled via Blitmode() and the
+ * screen is in ST-RAM; on a 68040/68060, move16 is used when everything
+ * is 16-byte aligned.  Otherwise, or for other CPUs, fall back to memmove.
+ */
+static void scroll_copy(UBYTE *dst, UBYTE *src, ULONG count)
+{
+#if CONF_WITH_BLITTER
+    BOOL use_blitter = HAS_BLITTER && blitter_is_enabled;
+
+#if CONF_WITH_DEFERRED_CONSOLE
+    /* the VBL interrupt may have interrupted the VDI during a blit */
+    if (shadow_in_vbl)
+        use_blitter = FALSE;
+#endif
+
+    if (use_blitter && !HAS_NOVA
+     && (src + count <= phystop) && (dst + count <= phystop)
+     && (count / v_lin_wr <= 65535U))
+    {
+        blit_copy(dst, src, count);
+        return;
+    }
+#endif
+
+#if CONF_WITH_ADVANCED_CPU && !defined(__mcoldfire__)
+    if ((mcpu >= 40) && !(((ULONG)dst | (ULONG)src | count) & 15))
+    {
+        if (dst < src)
+            memcpy16(dst, src, count);
+        else
+        {
+            /*
+             * copy downwards in chunks no bigger than the distance
+             * between src & dst, so that no chunk overlaps itself
+             */
+            ULONG chunk = dst - src;
+
+            while (count)
+            {
+                ULONG n = (count < chunk) ? count : chunk;
+                count -= n;
+                memcpy16(dst + count, src + count, n);
+            }
+        }
+        return;
+    }
+#endif
+
+    memmove(dst, src, count);
+}
+
+#if CONF_WITH_DEFERRED_CONSOLE
+/*
+ * shadow_lock/shadow_unlock - bracket updates of the shadow screen
+ *
+ * the VBL repaint is skipped while the shadow is locked; in that case it
+ * is done as soon as the shadow has been unlocked.
+ */
+static void shadow_flush(void);
+
+static void shadow_lock(void)
+{
+    shadow_busy++;
+}
+
+static void shadow_unlock(void)
+{
+    if (--shadow_busy == 0 && shadow_due)
+        shadow_flush();
+}
+
+
+
+/*
+ * shadow_slot - return the row of the shadow holding screen row y
+ */
+static SHADOWCELL *shadow_slot(int y, WORD *slot)
+{
+    int n = shadow_top + y;
+
+    if (n >= shadow_rows)
+        n -= shadow_rows;
+    *slot = n;
+
+    return shadow[n];
+}
+
+
+
+/*
+ * shadow_dirty - mark columns lo to hi of a ring slot for repaint
+ */
+static void shadow_dirty(WORD slot, WORD lo, WORD hi)
+{
+    if (lo < shadow_lo[slot])
+        shadow_lo[slot] = lo;
+    if (hi > shadow_hi[slot])
+        shadow_hi[slot] = hi;
+    shadow_changed = TRUE;
+}
+
+
+
+/*
+ * shadow_put - deferred version of cell_xfer() at the cursor position
+ */
+static void shadow_put(int ch, UWORD fg, UWORD bg)
+{
+    SHADOWCELL *cell;
+    WORD slot;
+
+    shadow_lock();
+
+    cell = shadow_slot(v_cur_cy, &slot) + v_cur_cx;
+    cell->ch = ch;
+    cell->fg = fg;
+    cell->bg = bg;
+    shadow_dirty(slot, v_cur_cx, v_cur_cx);
+
+    /* as on screen, the character covers the cursor */
+    if (cur_on && (cur_x == v_cur_cx) && (cur_y == v_cur_cy))
+        cur_on = FALSE;
+
+    shadow_unlock();
+}
+
+
+
+/*
+ * shadow_neg - deferred version of neg_pixels()
+ *
+ * this is only used for the cursor, so at most one cell is negated
+ */
+static void shadow_neg(UBYTE *cell)
+{
+    ULONG offs = cell - v_bas_ad - v_cur_of;
+    WORD x, y;
+
+    /* convert back the address computed by cell_addr() */
+    y = offs / v_cel_wr;
+    offs %= v_cel_wr;
+    x = (offs & ~1) / v_planes + (offs & 1);
+
+    shadow_lock();
+
+    if (cur_on && (cur_x == x) && (cur_y == y))
+        cur_on = FALSE;
+    else {
+        cur_on = TRUE;
+        cur_x = x;
+        cur_y = y;
+    }
+    shadow_changed = TRUE;
+
+    shadow_unlock();
+}
+
+
+
+/*
+ * shadow_blank - deferred version of blank_out()
+ */
+static void shadow_blank(int topx, int topy, int botx, int boty)
+{
+    SHADOWCELL *cell;
+    WORD slot;
+    int x, y;
+
+    shadow_lock();
+
+    for (y = topy; y <= boty; y++) {
+        cell = shadow_slot(y, &slot);
+        for (x = topx; x <= botx; x++) {
+            cell[x].ch = ' ';
+            cell[x].fg = v_col_bg;
+            cell[x].bg = v_col_bg;
+        }
+        shadow_dirty(slot, topx, botx);
+    }
+
+    if (cur_on && (cur_y >= topy) && (cur_y <= boty)
+     && (cur_x >= topx) && (cur_x <= botx))
+        cur_on = FALSE;
+
+    shadow_unlock();
+}
+
+
+
+/*
+ * shadow_copy_row - copy screen row src to screen row dst in the shadow
+ */
+static void shadow_copy_row(int dst, int src)
+{
+    SHADOWCELL *from, *to;
+    WORD slot;
+
+    from = shadow_slot(src, &slot);
+    to = shadow_slot(dst, &slot);
+    memcpy(to, from, (v_cel_mx + 1) * sizeof(SHADOWCELL));
+    shadow_dirty(slot, 0, v_cel_mx);
+}
+
+
+
+/*
+ * shadow_scroll_up - deferred version of the copy done by scroll_up()
+ *
+ * scrolling the whole screen just rotates the ring; the screen itself
+ * is scrolled by the next repaint
+ */
+static void shadow_scroll_up(UWORD top_line)
+{
+    int y;
+
+    shadow_lock();
+
+    if (top_line == 0) {
+        if (++shadow_top == shadow_rows)
+            shadow_top = 0;
+        if (shadow_scrolled < shadow_rows)
+            shadow_scrolled++;
+        shadow_changed = TRUE;
+    }
+    else {
+        for (y = top_line; y < v_cel_my; y++)
+            shadow_copy_row(y, y + 1);
+    }
+
+    /* the cursor moves with the screen contents */
+    if (cur_on && (cur_y >= top_line)) {
+        if (cur_y == top_line)
+            cur_on = FALSE;
+        else
+            cur_y--;
+    }
+
+    shadow_unlock();
+}
+
+
+
+/*
+ * shadow_scroll_down - deferred version of the copy done by scroll_down()
+ */
+static void shadow_scroll_down(UWORD start_line)
+{
+    int y;
+
+    shadow_lock();
+
+    for (y = v_cel_my; y > start_line; y--)
+        shadow_copy_row(y, y - 1);
+
+    if (cur_on && (cur_y >= start_line)) {
+        if (cur_y == v_cel_my)
+            cur_on = FALSE;
+        else
+            cur_y++;
+    }
+
+    shadow_unlock();
+}
+
+
+
+/*
+ * shadow_flush - repaint the screen from the shadow
+ */
+static void shadow_flush(void)
+{
+    SHADOWCELL *cell;
+    WORD slot;
+    int x, y;
+
+    shadow_busy++;
+    shadow_due = FALSE;
+
+    if (shadow_changed) {
+        shadow_changed = FALSE;
+
+        /* remove the cursor, so that the screen only holds text */
+        if (drawn_on) {
+            neg_pixels(cell_addr(drawn_x, drawn_y));
+            drawn_on = FALSE;
+        }
+
+        /* apply all the pending scrolls at once */
+        if (shadow_scrolled) {
+            if (shadow_scrolled < shadow_rows) {
+                ULONG offs = (ULONG)v_cel_wr * shadow_scrolled;
+                scroll_copy(v_bas_ad, v_bas_ad + offs,
+                            (ULONG)v_cel_wr * shadow_rows - offs);
+            }
+            shadow_scrolled = 0;
+        }
+
+        /* repaint the changed cells */
+        for (y = 0; y < shadow_rows; y++) {
+            cell = shadow_slot(y, &slot);
+            for (x = shadow_lo[slot]; x <= shadow_hi[slot]; x++) {
+                UBYTE *src = char_addr(cell[x].ch);
+                if (src)
+                    cell_xfer(src, cell_addr(x, y), cell[x].fg, cell[x].bg);
+            }
+            shadow_lo[slot] = SHADOW_MAXCOLS;
+            shadow_hi[slot] = -1;
+        }
+
+        if (cur_on) {
+            neg_pixels(cell_addr(cur_x, cur_y));
+            drawn_on = TRUE;
+            drawn_x = cur_x;
+            drawn_y = cur_y;
+        }
+    }
+
+    shadow_busy--;
+}
+
+
+
+/*
+ * shadow_init - select deferred or immediate mode for the current screen
+ *
+ * deferred mode is used if the screen fits in the shadow.  this must be
+ * called whenever the console geometry changes; the screen must then be
+ * cleared, since the shadow starts out blank.
+ */
+void shadow_init(void)
+{
+    WORD slot;
+    int x;
+
+    shadow_rows = 0;                    /* immediate mode while we work */
+    shadow_busy = 0;
+    shadow_due = FALSE;
+
+    if ((v_cel_mx >= SHADOW_MAXCOLS) || (v_cel_my >= SHADOW_MAXROWS))
+        return;
+
+    for (slot = 0; slot <= v_cel_my; slot++) {
+        for (x = 0; x <= v_cel_mx; x++) {
+            shadow[slot][x].ch = ' ';
+            shadow[slot][x].fg = v_col_bg;
+            shadow[slot][x].bg = v_col_bg;
+        }
+        shadow_lo[slot] = SHADOW_MAXCOLS;
+        shadow_hi[slot] = -1;
+    }
+    shadow_top = 0;
+    shadow_scrolled = 0;
+    shadow_changed = FALSE;
+    cur_on = drawn_on = FALSE;
+
+    shadow_rows = v_cel_my + 1;
+}
+
+
+
+/*
+ * shadow_vbl - repaint the changed cells, called from the VBL interrupt
+ */
+void shadow_vbl(void)
+{
+    if (!shadow_rows)
+        return;
+
+    if (shadow_busy)
+        shadow_due = TRUE;              /* done by shadow_unlock() */
+    else {
+        shadow_in_vbl = TRUE;
+        shadow_flush();
+        shadow_in_vbl = FALSE;
+    }
+}
+#endif
+
+
 
 /*
  * scroll_up - Scroll upwards
@@ -560,6 +1261,14 @@ void scroll_up(UWORD top_line)
     ULONG count;
     UBYTE * src, * dst;
 
+#if CONF_WITH_DEFERRED_CONSOLE
+    if (shadow_rows) {
+        shadow_scroll_up(top_line);
+        blank_out(0, v_cel_my, v_cel_mx, v_cel_my);
+        return;
+    }
+#endif
+
     /* screen base addr + cell y nbr * cell wrap */
     dst = v_bas_ad + (ULONG)top_line * v_cel_wr;
 
@@ -570,7 +1279,7 @@ void scroll_up(UWORD top_line)
     count = (ULONG)v_cel_wr * (v_cel_my - top_line);
 
     /* move BYTEs of memory*/
-    memmove(dst, src, count);
+    scroll_copy(dst, src, count);
 
     /* exit thru blank out, bottom line cell address y to top/left cell */
     blank_out(0, v_cel_my , v_cel_mx, v_cel_my);
@@ -587,6 +1296,14 @@ void scroll_down(UWORD start_line)
     ULONG count;
     UBYTE * src, * dst;
 
+#if CONF_WITH_DEFERRED_CONSOLE
+    if (shadow_rows) {
+        shadow_scroll_down(start_line);
+        blank_out(0, start_line, v_cel_mx, start_line);
+        return;
+    }
+#endif
+
     /* screen base addr + offset of start line */
     src = v_bas_ad + (ULONG)start_line * v_cel_wr;
 
@@ -597,7 +1314,7 @@ void scroll_down(UWORD start_line)
     count = (ULONG)v_cel_wr * (v_cel_my - start_line);
 
     /* move BYTEs of memory*/
-    memmove(dst, src, count);
+    scroll_copy(dst, src, count);
 
     /* exit thru blank out */
     blank_out(0, start_line , v_cel_mx, start_line);
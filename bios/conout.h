@@ -49,8 +49,14 @@ extern WORD sav_cur_y;          /* saved cursor cell y */
 /* Prototypes */
 
 void ascii_out(int);
+void ascii_outs(const UBYTE *buf, int count);
 void move_cursor(int, int);
 void blank_out (int, int, int, int);
 void invert_cell(int, int);
 void scroll_up(UWORD top_line);
 void scroll_down(UWORD start_line);
+
+#if CONF_WITH_DEFERRED_CONSOLE
+void shadow_init(void);
+void shadow_vbl(void);
+#endif
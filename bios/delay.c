@@ -20,6 +20,7 @@
 #include "mfp.h"
 #include "serport.h"
 #include "processor.h"
+#include "has.h"
 #include "delay.h"
 #include "coldfire.h" /* For cookie jar info. */
 
@@ -26,13 +26,20 @@
 #include "acsi.h"
 #include "scsi.h"
 #include "sd.h"
+#include "ramdisk.h"
 #include "../bdos/bdosstub.h"
+#include "biosext.h"
 #include "string.h"
 
 /*==== Defines ============================================================*/
 
 #define REMOVABLE_PARTITIONS    1   /* minimum # partitions for removable unit */
 
+#if CONF_WITH_DISK_CACHE
+#define CACHE_ENTRIES   4           /* number of cached physical sectors */
+#define CACHE_SECTSIZE  512         /* only units with this sector size are cached */
+#endif
+
 /*==== Structures =========================================================*/
 typedef struct {
     UBYTE fill0[4];
@@ -48,6 +55,15 @@ typedef struct {
     UWORD bootsig;
 } MBR;
 
+#if CONF_WITH_DISK_CACHE
+typedef struct {
+    UWORD unit;         /* 0 => entry not in use (floppies are not cached) */
+    ULONG sector;
+    LONG  stamp;        /* hz_200 when last read from the unit */
+    UBYTE data[CACHE_SECTSIZE];
+} CACHEENTRY;
+#endif
+
 /*==== Global variables ===================================================*/
 
 UNIT units[UNITSNUM];
@@ -57,6 +73,12 @@ int has_ultrasatan_clock;
 int ultrasatan_id;
 #endif
 
+#if CONF_WITH_DISK_CACHE
+static CACHEENTRY cache[CACHE_ENTRIES];
+static WORD cache_next;         /* next entry to replace */
+static BOOL cache_enabled;      /* TRUE while scanning for partitions */
+#endif
+
 /*==== Internal declarations ==============================================*/
 static int atari_partition(UWORD unit,LONG *devices_available);
 #if DETECT_NATIVE_FEATURES
@@ -80,6 +102,9 @@ static void disk_init_one(UWORD unit,LONG *devices_available)
 
     punit->valid = 0;
     punit->features = 0;
+#if CONF_WITH_DISK_CACHE
+    disk_cache_flush(unit);     /* the unit may have changed since last time */
+#endif
 
 #if DETECT_NATIVE_FEATURES
     /* First, determine if this unit is supported by NatFeats. */
@@ -187,7 +212,10 @@ void disk_init_all(void)
         0, 1, 2, 3, 4, 5, 6, 7,             /* ACSI */
 #endif
 #if CONF_WITH_SDMMC
-        24, 25, 26, 27, 28, 29, 30, 31      /* SD/MMC */
+        24, 25, 26, 27, 28, 29, 30, 31,     /* SD/MMC */
+#endif
+#if CONF_WITH_RAMDISK
+        32                                  /* RAM disk */
 #endif
     };
     int i;
@@ -303,6 +331,11 @@ LONG disk_mediach(UWORD unit)
         ret = sd_ioctl(reldev,GET_MEDIACHANGE,NULL);
         break;
 #endif /* CONF_WITH_SDMMC */
+#if CONF_WITH_RAMDISK
+    case RAMDISK_BUS:
+        ret = ramdisk_ioctl(reldev,GET_MEDIACHANGE,NULL);
+        break;
+#endif /* CONF_WITH_RAMDISK */
     default:
         ret = EUNDEV;
     }
@@ -322,6 +355,9 @@ void disk_rescan(UWORD unit)
 {
     int i;
     LONG devices_available, bitmask;
+#if CONF_WITH_DISK_CACHE
+    BOOL old_cache;
+#endif
 
     /* determine available devices for rescan */
     devices_available = units[unit].drivemap;
@@ -329,13 +365,22 @@ void disk_rescan(UWORD unit)
     KDEBUG(("disk_rescan(%d):drivemap=0x%08lx\n",unit,devices_available));
 
     /* rescan (this clobbers 'devices_available') */
+#if CONF_WITH_DISK_CACHE
+    old_cache = disk_cache_enable(TRUE);
     disk_init_one(unit,&devices_available);
+    disk_cache_enable(old_cache);
+#else
+    disk_init_one(unit,&devices_available);
+#endif
 
     /* now set the mediachange byte for the relevant devices */
     devices_available = units[unit].drivemap;
     for (i = 0, bitmask = 1L; i < BLKDEVNUM; i++, bitmask <<= 1)
         if (devices_available & bitmask)
             blkdev[i].mediachange = MEDIACHANGE;
+#if CONF_WITH_MEDIACH_CACHE
+    blkdev_changes++;
+#endif
 }
 
 /*
@@ -565,11 +610,13 @@ static WORD process_dos_mbr(UWORD unit, LONG *devices_available)
             case 0x0c:
             case 0x83:      /* any Linux partition, including ext2 */
                 /*
-                 * note that FAT32 & Linux partitions occupy drive letters,
-                 * but are not yet accessible to EmuTOS.  however, we allow
-                 * access via XHDI for MiNT's benefit.
+                 * note that Linux partitions (and FAT32 partitions, unless
+                 * CONF_WITH_FAT32 is set) occupy drive letters, but are not
+                 * accessible to EmuTOS.  however, we allow access via XHDI
+                 * for MiNT's benefit.
                  */
-                KDEBUG((" %s partition: not yet supported\n",(type==0x83)?"Linux":"FAT32"));
+                if ((type == 0x83) || !CONF_WITH_FAT32)
+                    KDEBUG((" %s partition: not yet supported\n",(type==0x83)?"Linux":"FAT32"));
                 FALLTHROUGH;
             case 0x01:
             case 0x04:
@@ -627,13 +674,16 @@ static int atari_partition(UWORD unit,LONG *devices_available)
     if (disk_rw(unit, RW_READ, 0, 1, sect))
         return -1;
 
-    KINFO(("%cd%c: ","ashf????"[major>>3],'a'+(major&0x07)));
+    KINFO(("%cd%c: ","ashfr???"[major>>3],'a'+(major&0x07)));
 
 #if CONF_WITH_IDE
     /* IDE drives may be byteswapped if partitioned on foreign hardware */
     if (IS_IDE_DEVICE(major) && unit_is_byteswapped(unit)) {
         byteswap(&physsect, SECTOR_SIZE);   /* fix loaded physical sector */
         units[unit].byteswap = 1;           /* let driver know for subsequent accesses */
+#if CONF_WITH_DISK_CACHE
+        disk_cache_flush(unit);             /* cached copy is not byteswapped */
+#endif
     }
 #endif /* CONF_WITH_IDE */
 
@@ -827,6 +877,11 @@ static LONG internal_inquire(UWORD unit, ULONG *blocksize, ULONG *deviceflags, c
         flags = XH_TARGET_REMOVABLE;    /* medium is removable */
         break;
 #endif /* CONF_WITH_SDMMC */
+#if CONF_WITH_RAMDISK
+    case RAMDISK_BUS:
+        ret = ramdisk_ioctl(reldev,GET_DISKNAME,name);
+        break;
+#endif /* CONF_WITH_RAMDISK */
     default:
         ret = EUNDEV;
     }
@@ -913,6 +968,13 @@ LONG disk_get_capacity(UWORD unit, ULONG *blocks, ULONG *blocksize)
             return ret;
         break;
 #endif /* CONF_WITH_SDMMC */
+#if CONF_WITH_RAMDISK
+    case RAMDISK_BUS:
+        ret = ramdisk_ioctl(reldev,GET_DISKINFO,info);
+        if (ret < 0)
+            return ret;
+        break;
+#endif /* CONF_WITH_RAMDISK */
     default:
         return EUNDEV;
     }
@@ -925,8 +987,8 @@ LONG disk_get_capacity(UWORD unit, ULONG *blocks, ULONG *blocksize)
     return 0;
 }
 
-/* Unit read/write */
-LONG disk_rw(UWORD unit, UWORD rw, ULONG sector, UWORD count, UBYTE *buf)
+/* Unit read/write, bypassing the cache */
+static LONG disk_rw_hw(UWORD unit, UWORD rw, ULONG sector, UWORD count, UBYTE *buf)
 {
     UWORD major = unit - NUMFLOPPIES;
     LONG ret;
@@ -981,6 +1043,11 @@ LONG disk_rw(UWORD unit, UWORD rw, ULONG sector, UWORD count, UBYTE *buf)
         KDEBUG(("sd_rw() returned %ld\n", ret));
         break;
 #endif /* CONF_WITH_SDMMC */
+#if CONF_WITH_RAMDISK
+    case RAMDISK_BUS:
+        ret = ramdisk_rw(rw, sector, count, buf, reldev);
+        break;
+#endif /* CONF_WITH_RAMDISK */
     default:
         ret = EUNDEV;
     }
@@ -988,6 +1055,154 @@ LONG disk_rw(UWORD unit, UWORD rw, ULONG sector, UWORD count, UBYTE *buf)
     return ret;
 }
 
+#if CONF_WITH_DISK_CACHE
+/*
+ * enable or disable the sector cache
+ *
+ * the cache is only used while scanning the units for partitions and
+ * building the BPBs, which reads the same few sectors several times.
+ * at other times, sectors may be written behind our back, e.g. by SCSI
+ * Driver commands or by a third-party hard disk driver, so the cache is
+ * emptied when it is disabled.
+ *
+ * returns the previous state
+ */
+BOOL disk_cache_enable(BOOL enable)
+{
+    BOOL old = cache_enabled;
+    CACHEENTRY *e;
+
+    cache_enabled = enable;
+    if (!enable)
+        for (e = cache; e < cache+CACHE_ENTRIES; e++)
+            e->unit = 0;
+
+    return old;
+}
+
+/*
+ * discard all cached sectors for a unit
+ *
+ * this must be called whenever the media in the unit may have changed
+ */
+void disk_cache_flush(UWORD unit)
+{
+    CACHEENTRY *e;
+
+    for (e = cache; e < cache+CACHE_ENTRIES; e++)
+        if (e->unit == unit)
+            e->unit = 0;
+}
+
+/*
+ * find a cached sector
+ *
+ * for removable units, a cached sector is only trusted for as long as
+ * disk_mediach() would assume that the media has not changed
+ */
+static CACHEENTRY *cache_find(UWORD unit, ULONG sector)
+{
+    CACHEENTRY *e;
+
+    for (e = cache; e < cache+CACHE_ENTRIES; e++) {
+        if ((e->unit != unit) || (e->sector != sector))
+            continue;
+        if ((units[unit].features & UNIT_REMOVABLE)
+         && (hz_200 >= e->stamp + CLOCKS_PER_SEC/2)) {
+            e->unit = 0;
+            return NULL;
+        }
+        return e;
+    }
+
+    return NULL;
+}
+
+/*
+ * check if a request is for a single sector that we can cache
+ *
+ * units managed by NatFeats are not cached: the host already caches
+ * the image file, and a host read costs no more than copying the sector
+ * from our cache, so caching would only evict sectors of slower units.
+ * for the same reason, the RAM disk is not cached either.
+ */
+static BOOL cacheable(UWORD unit, UWORD count)
+{
+    if (!cache_enabled)
+        return FALSE;
+#if DETECT_NATIVE_FEATURES
+    if (units[unit].features & UNIT_NATFEATS)
+        return FALSE;
+#endif
+#if CONF_WITH_RAMDISK
+    if (IS_RAMDISK_DEVICE(unit - NUMFLOPPIES))
+        return FALSE;
+#endif
+
+    return (unit >= NUMFLOPPIES) && (count == 1)
+        && ((1L << units[unit].psshift) == CACHE_SECTSIZE);
+}
+#endif
+
+/*
+ * Unit read/write
+ *
+ * if the sector cache is enabled, single-sector reads are satisfied
+ * from it where possible; writes update or discard the cached copies
+ */
+LONG disk_rw(UWORD unit, UWORD rw, ULONG sector, UWORD count, UBYTE *buf)
+{
+#if CONF_WITH_DISK_CACHE
+    CACHEENTRY *e;
+    ULONG n;
+    LONG ret;
+
+    /* RW_NOMEDIACH & RW_NORETRIES don't affect the data read */
+    if (!(rw & (RW_RW|RW_NOBYTESWAP))) {
+        if (!cacheable(unit, count))
+            return disk_rw_hw(unit, rw, sector, count, buf);
+        e = cache_find(unit, sector);
+        if (e) {
+            memcpy(buf, e->data, CACHE_SECTSIZE);
+            return E_OK;
+        }
+        ret = disk_rw_hw(unit, rw, sector, count, buf);
+        if (ret == E_OK) {
+            e = &cache[cache_next];
+            if (++cache_next >= CACHE_ENTRIES)
+                cache_next = 0;
+            e->unit = unit;
+            e->sector = sector;
+            e->stamp = hz_200;
+            memcpy(e->data, buf, CACHE_SECTSIZE);
+        }
+        return ret;
+    }
+
+    ret = disk_rw_hw(unit, rw, sector, count, buf);
+
+    /* keep cached copies of written sectors consistent */
+    if (rw & RW_WRITE) {
+        for (e = cache; e < cache+CACHE_ENTRIES; e++) {
+            if ((e->unit != unit) || (e->sector < sector))
+                continue;
+            n = e->sector - sector;
+            if (n >= count)
+                continue;
+            if ((ret == E_OK) && !(rw & RW_NOBYTESWAP)) {
+                memcpy(e->data, buf + n * CACHE_SECTSIZE, CACHE_SECTSIZE);
+                e->stamp = hz_200;
+            } else
+                e->unit = 0;
+        }
+    }
+
+    return ret;
+#else
+    return disk_rw_hw(unit, rw, sector, count, buf);
+#endif
+}
+
 /*==== XBIOS functions ====================================================*/
 
 LONG DMAread(LONG sector, WORD count, UBYTE *buf, WORD major)
@@ -26,6 +26,7 @@
 #define IS_SCSI_DEVICE(major)   (GET_BUS(major) == SCSI_BUS)
 #define IS_IDE_DEVICE(major)    (GET_BUS(major) == IDE_BUS)
 #define IS_SDMMC_DEVICE(major)  (GET_BUS(major) == SDMMC_BUS)
+#define IS_RAMDISK_DEVICE(major) (GET_BUS(major) == RAMDISK_BUS)
 
 #define GET_UNITNUM(bus,dev)    (NUMFLOPPIES+(DEVICES_PER_BUS*(bus))+dev)
 
@@ -99,6 +100,10 @@ LONG disk_inquire(UWORD unit, ULONG *blocksize, ULONG *deviceflags, char *produc
 
 LONG disk_get_capacity(UWORD unit, ULONG *blocks, ULONG *blocksize);
 LONG disk_rw(UWORD unit, UWORD rw, ULONG sector, UWORD count, UBYTE *buf);
+#if CONF_WITH_DISK_CACHE
+BOOL disk_cache_enable(BOOL enable);
+void disk_cache_flush(UWORD unit);
+#endif
 
 /* xbios functions */
 
@@ -14,11 +14,14 @@
 /* #define ENABLE_KDEBUG */
 
 #include "emutos.h"
+#include "biosdefs.h"
 #include "dmasound.h"
 #include "vectors.h"
 #include "gemerror.h"
 #include "asm.h"
 #include "machine.h"
+#include "mfp.h"
+#include "string.h"
 
 #if CONF_WITH_DMASOUND
 
@@ -802,4 +805,100 @@ LONG buffptr(LONG ptr)
     return 0;
 }
 
+#if CONF_WITH_SOUND_STREAM
+/*
+ * DMA sound streaming (EmuTOS-specific)
+ *
+ * In repeat mode, the hardware reloads the frame start & end registers
+ * at the end of each frame.  Timer A counts the ends of frames: each
+ * time one occurs, the buffer after the one now playing is put into the
+ * frame registers, and the caller's routine is called to refill the
+ * buffer that has just been played.
+ */
+static SNDBUF stream_bufs[SNDSTREAM_MAXBUFS];
+static WORD stream_count;       /* number of buffers, 0 if not streaming */
+static WORD stream_playing;     /* index of the buffer being played */
+static void (*stream_refill)(WORD index);
+
+static WORD stream_nextbuf(WORD index)
+{
+    if (++index >= stream_count)
+        index = 0;
+
+    return index;
+}
+
+static void stream_setframe(WORD index)
+{
+    setbuffer(0, stream_bufs[index].start, stream_bufs[index].end);
+}
+
+/*
+ * called by the timer A interrupt handler at the end of each frame
+ */
+void dmasound_stream_interrupt_handler(void)
+{
+    WORD done;
+
+    if (stream_count)
+    {
+        done = stream_playing;
+        stream_playing = stream_nextbuf(done);
+        stream_setframe(stream_nextbuf(stream_playing));
+        if (stream_refill)
+            stream_refill(done);
+    }
+
+    /* clear the interrupt service bit (timer A) */
+    MFP_BASE->isra = 0xdf;
+}
+
+/**
+ * Start or stop playing a ring of buffers
+ *
+ * mode 0 stops playback.  mode 1 starts playing the 'count' buffers
+ * described by 'bufs', in turn and without gaps.  When each buffer has
+ * been played, 'refill' (if not NULL) is called from the interrupt
+ * handler with the buffer index; it must refill the buffer before its
+ * turn comes round again.
+ */
+LONG sndstream(WORD mode, WORD count, const SNDBUF *bufs, LONG refill)
+{
+    if (!SOUND_IS_AVAILABLE)
+        return 0x8e;    /* unimplemented xbios call: return function # */
+
+    if (mode > 1 || (mode == 1 && (count < 2 || count > SNDSTREAM_MAXBUFS)))
+        return EBADRQ;
+
+    /* stop any current stream */
+    if (stream_count)
+    {
+        jdisint(MFP_TIMERA);
+        setup_timer(MFP_BASE, 0, 0, 0);
+        buffoper(0);
+        stream_count = 0;
+    }
+
+    if (mode == 0)
+        return 0;
+
+    memcpy(stream_bufs, bufs, count * sizeof(SNDBUF));
+    stream_refill = (void (*)(WORD))refill;
+    stream_playing = 0;
+    stream_count = count;
+
+    /* count the ends of frames with timer A */
+    if (has_falcon_dmasound)
+        setinterrupt(0, 1);
+    xbtimer(0, 0x08, 1, (LONG)dmasound_stream_interrupt);
+
+    /* start the first buffer, and queue the second one */
+    stream_setframe(0);
+    buffoper(0x03);     /* play, repeat */
+    stream_setframe(1);
+
+    return 0;
+}
+#endif /* CONF_WITH_SOUND_STREAM */
+
 #endif /* CONF_WITH_DMASOUND */
@@ -38,6 +38,24 @@ LONG devconnect(WORD source, WORD dest, WORD clk, WORD prescale, WORD protocol);
 LONG sndstatus(WORD reset);
 LONG buffptr(LONG sptr);
 
+#if CONF_WITH_SOUND_STREAM
+
+#define SNDSTREAM_MAXBUFS   8   /* max number of buffers for Sndstream() */
+
+/* a buffer for Sndstream() */
+typedef struct {
+    ULONG start;                /* start address */
+    ULONG end;                  /* end address (first byte not played) */
+} SNDBUF;
+
+LONG sndstream(WORD mode, WORD count, const SNDBUF *bufs, LONG refill);
+
+/* timer A interrupt handlers */
+void dmasound_stream_interrupt(void);           /* in vectors.S */
+void dmasound_stream_interrupt_handler(void);
+
+#endif /* CONF_WITH_SOUND_STREAM */
+
 #endif /* CONF_WITH_DMASOUND */
 
 #endif /* DMASOUND_H */
@@ -66,6 +66,16 @@ struct dsp {
 #define DSP_WAIT_RCV()  { while(!DSP_RCV_READY) ; }
 #define DSP_WAIT_SEND() { while(!DSP_SEND_READY) ; }
 
+/* send one DSP word (3 bytes) from p, with handshaking */
+#define DSP_SEND_WORD(p)                \
+    {                                   \
+        DSP_WAIT_SEND();                \
+        DSPBASE->data.d.high = (p)[0];  \
+        DSPBASE->data.d.mid = (p)[1];   \
+        DSPBASE->data.d.low = (p)[2];   \
+        (p) += DSP_WORD_SIZE;           \
+    }
+
 /* DSP interrupt vector - use the same one as TOS4.04 */
 #define DSP_INTNUM  0xff
 #define VEC_DSP     (*(volatile PFVOID*)(DSP_INTNUM*sizeof(LONG)))
@@ -86,6 +96,10 @@ struct dsp {
 #define BLOCKMOVE_VECTOR    0x16
 #define FIRST_SUBRTN_VECTOR 0x17        /* for users */
 #define NUM_DSP_VECTORS     (NUM_SYSTEM_SUBROUTINES+NUM_USER_SUBROUTINES)
+
+/* Dsp_LoadProg() cache */
+#define NUM_CACHED_PROGS    4
+#define CACHED_NAME_SIZE    64
 #define SIZE_DSP_VECTORS    (NUM_DSP_VECTORS*DSP_VECTOR_SIZE)
 #define LOADSUB_ADDR        (LOADSUB_VECTOR*DSP_VECTOR_SIZE)
 #define FIRST_SUBRTN_ADDR   (FIRST_SUBRTN_VECTOR*DSP_VECTOR_SIZE)
@@ -161,16 +175,42 @@ static UBYTE dspvect_ram[DSPVECT_SIZE*DSP_WORD_SIZE];
  */
 static SUBINFO subroutine[NUM_USER_SUBROUTINES];
 
+/*
+ * Dsp_LoadProg() cache
+ *
+ * Dsp_LoadProg() converts the program into a buffer supplied by the
+ * caller, so we can't keep the converted programs ourselves.  However,
+ * programs which swap DSP programs usually reload them from the same file
+ * into the same buffer.  So we remember what was converted where, and if
+ * the file is unchanged and the buffer still contains the same data
+ * (according to a checksum), we skip reading & converting the .LOD file.
+ */
+typedef struct {
+    char name[CACHED_NAME_SIZE];    /* filename as specified */
+    LONG fsize;         /* file size, date & time */
+    UWORD date;
+    UWORD time;
+    WORD ability;
+    const UBYTE *buffer;    /* where converted */
+    LONG numwords;      /* size of converted program */
+    ULONG checksum;     /* of converted program */
+} LODCACHE;
+
+static LODCACHE lodcache[NUM_CACHED_PROGS];
+static WORD next_lodcache;      /* next entry to replace */
+
 /* the following private structure is used by interrupt handling */
 static struct {
                     /* send info */
     char *send;         /* buffer ptr */
     LONG sendlen;       /* length */
+    LONG sendleft;      /* words left to send in current block */
     LONG sendblocks;    /* blocks to send */
     LONG *senddone;     /* ptr to 'blocks sent' */
                     /* receive info */
     char *rcv;          /* buffer ptr */
     LONG rcvlen;        /* length */
+    LONG rcvleft;       /* words left to receive in current block */
     LONG rcvblocks;     /* blocks to receive */
     LONG *rcvdone;      /* ptr to 'blocks received' */
 } ih_args;
@@ -197,6 +237,7 @@ void dsp_init(void)
 
     dsp_is_locked = FALSE;
     memcpy(dspvect_ram, dspvect, sizeof(dspvect));  /* initialise RAM copy of vector data */
+    bzero(lodcache, sizeof(lodcache));
     dsp_flushsubroutines();     /* reset subroutine info table & memory info */
     program_top = 0;
     program_ability = 0;
@@ -331,6 +372,7 @@ void dsp_instream(char *data, LONG datalen, LONG numblocks, LONG *blocksdone)
     /* save args for use by interrupt handler */
     ih_args.send = data;
     ih_args.sendlen = datalen;
+    ih_args.sendleft = datalen;
     ih_args.sendblocks = numblocks;
     ih_args.senddone = blocksdone;
 
@@ -355,6 +397,7 @@ void dsp_outstream(char *data, LONG datalen, LONG numblocks, LONG *blocksdone)
     /* save args for use by interrupt handler */
     ih_args.rcv = data;
     ih_args.rcvlen = datalen;
+    ih_args.rcvleft = datalen;
     ih_args.rcvblocks = numblocks;
     ih_args.rcvdone = blocksdone;
 
@@ -368,50 +411,80 @@ void dsp_outstream(char *data, LONG datalen, LONG numblocks, LONG *blocksdone)
     }
 }
 
+/*
+ * helpers for the interrupt handlers of Dsp_InStream()/Dsp_OutStream()/
+ * Dsp_IOStream()
+ *
+ * unlike TOS, which transfers a whole block blind on each interrupt, we
+ * only transfer the words that the host port is ready for, and return
+ * the number of words still to be transferred in the current block.  so
+ * if the DSP is slower than us, the rest of the block is transferred by
+ * subsequent interrupts, and the CPU runs normally in between, instead
+ * of reading stale or overwriting pending data.
+ */
+static LONG rcv_words(LONG left)
+{
+    char *data = ih_args.rcv;
+
+    do
+    {
+        *data++ = DSPBASE->data.d.high;
+        *data++ = DSPBASE->data.d.mid;
+        *data++ = DSPBASE->data.d.low;
+    } while(--left && DSP_RCV_READY);
+    ih_args.rcv = data;         /* update buffer pointer */
+
+    return left;
+}
+
+static LONG send_words(LONG left)
+{
+    char *data = ih_args.send;
+
+    do
+    {
+        DSPBASE->data.d.high = *data++;
+        DSPBASE->data.d.mid = *data++;
+        DSPBASE->data.d.low = *data++;
+    } while(--left && DSP_SEND_READY);
+    ih_args.send = data;        /* update buffer pointer */
+
+    return left;
+}
+
 /*
  * dsp_inout_handler(): C portion of interrupt handler for Dsp_InStream()/Dsp_OutStream()
  */
 void dsp_inout_handler(void)
 {
-    char *data;
-    LONG datalen;
-
     /*
      * handle receive data (if any)
      */
-    if (DSP_RCV_READY)
+    if ((DSPBASE->interrupt_control & ICR_RREQ) && DSP_RCV_READY)
     {
-        data = ih_args.rcv;
-        datalen = ih_args.rcvlen;
-        do
+        ih_args.rcvleft = rcv_words(ih_args.rcvleft);
+        if (ih_args.rcvleft == 0)   /* end of block */
         {
-            *data++ = DSPBASE->data.d.high;
-            *data++ = DSPBASE->data.d.mid;
-            *data++ = DSPBASE->data.d.low;
-        } while(--datalen);
-        ih_args.rcv = data;         /* update buffer pointer */
-        (*ih_args.rcvdone)++;       /*  & 'blocks received' count */
-        if (*ih_args.rcvdone == ih_args.rcvblocks)      /* if done, */
-            DSPBASE->interrupt_control &= ~ICR_RREQ;    /* disable rcv data interrupt */
+            ih_args.rcvleft = ih_args.rcvlen;
+            (*ih_args.rcvdone)++;   /* update 'blocks received' count */
+            if (*ih_args.rcvdone == ih_args.rcvblocks)      /* if done, */
+                DSPBASE->interrupt_control &= ~ICR_RREQ;    /* disable rcv data interrupt */
+        }
     }
 
     /*
      * handle send data (if any)
      */
-    if (DSP_SEND_READY)
+    if ((DSPBASE->interrupt_control & ICR_TREQ) && DSP_SEND_READY)
     {
-        data = ih_args.send;
-        datalen = ih_args.sendlen;
-        do
+        ih_args.sendleft = send_words(ih_args.sendleft);
+        if (ih_args.sendleft == 0)  /* end of block */
         {
-            DSPBASE->data.d.high = *data++;
-            DSPBASE->data.d.mid = *data++;
-            DSPBASE->data.d.low = *data++;
-        } while(--datalen);
-        ih_args.send = data;        /* update buffer pointer */
-        (*ih_args.senddone)++;      /*  & 'blocks sent' count */
-        if (*ih_args.senddone == ih_args.sendblocks)    /* if done, */
-            DSPBASE->interrupt_control &= ~ICR_TREQ;    /* disable send data interrupt */
+            ih_args.sendleft = ih_args.sendlen;
+            (*ih_args.senddone)++;  /* update 'blocks sent' count */
+            if (*ih_args.senddone == ih_args.sendblocks)    /* if done, */
+                DSPBASE->interrupt_control &= ~ICR_TREQ;    /* disable send data interrupt */
+        }
     }
 }
 
@@ -419,8 +492,9 @@ void dsp_inout_handler(void)
  * Dsp_IOStream(): send/receive DSP words (no handshaking) via an interrupt handler
  *
  * we send the first block, then install an interrupt handler to service
- * 'output is ready' from the DSP.  on each interrupt, we receive a block
- * and send the next one.
+ * 'output is ready' from the DSP.  when a block has been received, we
+ * send the next one.  both are transferred by interrupts, as the host
+ * port gets ready, so the CPU is free while the DSP processes the data.
  */
 void dsp_iostream(char *send, char *rcv, LONG sendlen, LONG rcvlen, LONG numblocks, LONG *blocksdone)
 {
@@ -431,24 +505,20 @@ void dsp_iostream(char *send, char *rcv, LONG sendlen, LONG rcvlen, LONG numbloc
     ih_args.send = send;
     ih_args.rcv = rcv;
     ih_args.sendlen = sendlen;
+    ih_args.sendleft = sendlen;
     ih_args.rcvlen = rcvlen;
+    ih_args.rcvleft = rcvlen;
     ih_args.rcvblocks = numblocks;
     ih_args.rcvdone = blocksdone;
 
     *blocksdone = 0L;
+    if (!rcvlen || !numblocks)
+        return;
 
-    do
-    {
-        DSPBASE->data.d.high = *send++;
-        DSPBASE->data.d.mid = *send++;
-        DSPBASE->data.d.low = *send++;
-    } while(--sendlen);
-    ih_args.send = send;        /* update buffer pointer */
-
-    /* set up interrupt handler */
+    /* set up interrupt handler: it sends the first block */
     VEC_DSP = dsp_io_asm;
     DSPBASE->interrupt_vector = DSP_INTNUM;
-    DSPBASE->interrupt_control |= ICR_RREQ;
+    DSPBASE->interrupt_control |= sendlen ? (ICR_TREQ|ICR_RREQ) : ICR_RREQ;
 }
 
 /*
@@ -456,36 +526,33 @@ void dsp_iostream(char *send, char *rcv, LONG sendlen, LONG rcvlen, LONG numbloc
  */
 void dsp_io_handler(void)
 {
-    char *data;
-    LONG datalen;
+    /* send the current block, as far as possible */
+    if ((DSPBASE->interrupt_control & ICR_TREQ) && DSP_SEND_READY)
+    {
+        ih_args.sendleft = send_words(ih_args.sendleft);
+        if (ih_args.sendleft == 0)                      /* block sent, */
+            DSPBASE->interrupt_control &= ~ICR_TREQ;    /* disable send data interrupt */
+    }
 
     /* receive the data that's ready */
-    data = ih_args.rcv;
-    datalen = ih_args.rcvlen;
-    do
-    {
-        *data++ = DSPBASE->data.d.high;
-        *data++ = DSPBASE->data.d.mid;
-        *data++ = DSPBASE->data.d.low;
-    } while(--datalen);
-    ih_args.rcv = data;         /* update buffer ptr */
-    (*ih_args.rcvdone)++;       /*  & 'blocks received' count */
+    if (!DSP_RCV_READY)
+        return;
+    ih_args.rcvleft = rcv_words(ih_args.rcvleft);
+    if (ih_args.rcvleft)            /* rest of block will come later */
+        return;
+
+    ih_args.rcvleft = ih_args.rcvlen;
+    (*ih_args.rcvdone)++;       /* update 'blocks received' count */
     if (*ih_args.rcvdone == ih_args.rcvblocks)      /* if done, */
     {
-        DSPBASE->interrupt_control &= ~ICR_RREQ;    /* disable rcv data interrupt */
+        DSPBASE->interrupt_control &= ~(ICR_TREQ|ICR_RREQ); /* disable interrupts */
         return;                                     /*  and exit */
     }
 
     /* not done, so send the next block */
-    data = ih_args.send;
-    datalen = ih_args.sendlen;
-    do
-    {
-        DSPBASE->data.d.high = *data++;
-        DSPBASE->data.d.mid = *data++;
-        DSPBASE->data.d.low = *data++;
-    } while(--datalen);
-    ih_args.send = data;        /* update buffer ptr */
+    ih_args.sendleft = ih_args.sendlen;
+    if (ih_args.sendleft)
+        DSPBASE->interrupt_control |= ICR_TREQ;
 }
 
 /*
@@ -644,26 +711,134 @@ WORD dsp_reserve(LONG xreserve, LONG yreserve)
     return 0;
 }
 
+/*
+ * helper functions for Dsp_LoadProg()
+ */
+
+/* get the directory information for the specified file */
+static BOOL get_fileinfo(char *filename, DTA *dta)
+{
+    DTA *dtasave;
+    BOOL found;
+
+    dtasave = dos_gdta();
+    dos_sdta(dta);
+    found = (dos_sfirst(filename, 0) == 0);
+    dos_sdta(dtasave);
+
+    return found;
+}
+
+/* checksum of a converted program */
+static ULONG checksum(const UBYTE *p, LONG numwords)
+{
+    ULONG sum = 0;
+    LONG n;
+
+    for (n = numwords * DSP_WORD_SIZE; n > 0; n--)
+        sum = ((sum << 1) | (sum >> 31)) + *p++;
+
+    return sum;
+}
+
+/* find the cache entry for a program, or NULL */
+static LODCACHE *find_cached_prog(const char *filename, const DTA *dta, WORD ability, const UBYTE *buffer)
+{
+    LODCACHE *entry;
+
+    for (entry = lodcache; entry < lodcache+NUM_CACHED_PROGS; entry++)
+    {
+        if ((entry->buffer == buffer) && (entry->ability == ability)
+         && (entry->fsize == dta->d_length)
+         && (entry->date == dta->d_date) && (entry->time == dta->d_time)
+         && (strcmp(entry->name, filename) == 0))
+            return entry;
+    }
+
+    return NULL;
+}
+
+/* remember a converted program, replacing the oldest entry if necessary */
+static void cache_prog(const char *filename, const DTA *dta, WORD ability, const UBYTE *buffer, LONG numwords)
+{
+    LODCACHE *entry;
+
+    if (strlen(filename) >= CACHED_NAME_SIZE)
+        return;
+
+    entry = find_cached_prog(filename, dta, ability, buffer);
+    if (!entry)
+    {
+        entry = &lodcache[next_lodcache];
+        if (++next_lodcache >= NUM_CACHED_PROGS)
+            next_lodcache = 0;
+    }
+
+    strcpy(entry->name, filename);
+    entry->fsize = dta->d_length;
+    entry->date = dta->d_date;
+    entry->time = dta->d_time;
+    entry->ability = ability;
+    entry->buffer = buffer;
+    entry->numwords = numwords;
+    entry->checksum = checksum(buffer, numwords);
+}
+
 /*
  * Dsp_LoadProg(): load & run .LOD file from disk
  */
 WORD dsp_loadprog(char *filename, WORD ability, void *buffer)
 {
+    DTA dta;
+    LODCACHE *entry;
     LONG size;
 
     if (!has_dsp)
         return 0x6c;    /* unimplemented xbios call: return function # */
 
+    if (!get_fileinfo(filename, &dta))
+        return -1;
+
+    /* if the buffer still contains the converted program, just run it */
+    entry = find_cached_prog(filename, &dta, ability, buffer);
+    if (entry && (checksum(buffer, entry->numwords) == entry->checksum))
+    {
+        KDEBUG(("Dsp_LoadProg(): using cached conversion of %s\n", filename));
+        dsp_execprog(buffer, entry->numwords, ability);
+        return 0;
+    }
+
     /* read .LOD file & convert to binary in 'buffer' */
     size = dsp_lodtobinary(filename, buffer);
     if (size < 0L)
         return -1;
 
+    cache_prog(filename, &dta, ability, buffer, size);
     dsp_execprog(buffer, size, ability);
 
     return 0;
 }
 
+/*
+ * send DSP words to our program loader
+ *
+ * this is the send part of Dsp_BlkHandShake(), unrolled: the handshake
+ * is still required for each word, but the loop overhead is reduced.
+ */
+static void send_program(const UBYTE *p, LONG count)
+{
+    for ( ; count >= 4; count -= 4)
+    {
+        DSP_SEND_WORD(p);
+        DSP_SEND_WORD(p);
+        DSP_SEND_WORD(p);
+        DSP_SEND_WORD(p);
+    }
+
+    for ( ; count > 0; count--)
+        DSP_SEND_WORD(p);
+}
+
 /*
  * Dsp_ExecProg(): load & run binary DSP program
  */
@@ -676,10 +851,10 @@ void dsp_execprog(const UBYTE *codeptr, LONG codesize, WORD ability)
     dsp_execboot(dspstart, DSPSTART_SIZE, ability);
 
     /* send the program */
-    dsp_blkhandshake(codeptr, codesize, NULL, 0);
+    send_program(codeptr, codesize);
 
     /* send the standard set of vectors & the transmission terminator */
-    dsp_blkhandshake(dspvect_ram, DSPVECT_SIZE, NULL, 0);
+    send_program(dspvect_ram, DSPVECT_SIZE);
 
     program_ability = ability;  /* remember this */
 }
@@ -899,46 +1074,53 @@ static LONG convert_lod(char *outbuf, char *inbuf)
     return (q - outbuf) / DSP_WORD_SIZE;
 }
 
-/* return filesize of specified file */
-static LONG filesize(char *filename)
-{
-    DTA dta, *dtasave;
-    LONG size = -1L;
-
-    dtasave = dos_gdta();
-    dos_sdta(&dta);
-
-    if (dos_sfirst(filename, 0) == 0)
-        size = dta.d_length;
-
-    dos_sdta(dtasave);
-
-    return size;
-}
-
 /*
  * Dsp_LodToBinary(): convert .LOD file to binary
+ *
+ * as an extension, the file may also contain a program which is already
+ * in binary format, i.e. as output by Dsp_LodToBinary().  this is detected
+ * by its first byte, which is always zero (the high byte of the memory type
+ * of the first section), while a .LOD file is text.  such a file is simply
+ * copied to the output buffer.
  */
 LONG dsp_lodtobinary(char *filename, char *outbuf)
 {
+    DTA dta;
     LONG fsize, numwords = 0L;
     char *inbuf;
 
     if (!has_dsp)
         return 0x6f;    /* unimplemented xbios call: return function # */
 
-    fsize = filesize(filename);
+    if (!get_fileinfo(filename, &dta))
+        return -1L;
+    fsize = dta.d_length;
     if (fsize <= 0L)
         return -1L;
 
-    inbuf = dos_alloc_stram(fsize);
+    inbuf = dos_alloc_stram(fsize+1);
     if (!inbuf)
         return -1L;
 
     if (dos_load_file(filename, fsize, inbuf) < 0L)
+    {
+        dos_free(inbuf);
         return -1L;
+    }
+    inbuf[fsize] = '\0';    /* convert_lod() needs a terminator */
 
-    numwords = convert_lod(outbuf, inbuf);
+    if (inbuf[0] == '\0')   /* binary program */
+    {
+        if (fsize % DSP_WORD_SIZE)
+            numwords = -1L;
+        else
+        {
+            memcpy(outbuf, inbuf, fsize);
+            numwords = fsize / DSP_WORD_SIZE;
+        }
+    }
+    else
+        numwords = convert_lod(outbuf, inbuf);
 
     dos_free(inbuf);
 
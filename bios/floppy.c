@@ -105,6 +105,34 @@ struct flop_info {
  */
 #define IO_RETRIES  2   /* actually the total number of tries */
 
+#if CONF_WITH_FLOPTRKS
+/*
+ * sector skew used by floptrks(): the first sector transferred on a new
+ * track/side is this many sectors after the one following the last sector
+ * transferred, to allow for the head switch or the step
+ */
+#define SWITCH_SKEW 1   /* to the other side of the same track */
+#define STEP_SKEW   2   /* to the next track */
+#endif
+
+#if CONF_WITH_FLOPPY_CACHE
+/*
+ * track cache
+ *
+ * a partial-track read by floppy_rw() reads the whole track/side into
+ * trackbuf[], and later reads from the same track/side are then satisfied
+ * from memory.  the cache is discarded on any write or format, on a
+ * possible diskette change, and when the drive is deselected.
+ */
+#define CACHE_MAXSPT    18      /* HD; tracks with more sectors are not cached */
+
+static UWORD trackbuf[CACHE_MAXSPT*SECTOR_SIZE/2];  /* word-aligned for DMA */
+static WORD cache_dev = -1;     /* -1 => cache is empty */
+static WORD cache_track;
+static WORD cache_side;
+static WORD cache_spt;
+#endif
+
 /*==== Internal prototypes ==============================================*/
 
 /* set intel words */
@@ -115,6 +143,10 @@ static WORD flopio(UBYTE *buf, WORD rw, WORD dev,
                    WORD sect, WORD track, WORD side, WORD count);
 static WORD flopio_ver(UBYTE *buf, WORD rw, WORD dev,
                    WORD sect, WORD track, WORD side, WORD count);
+#if CONF_WITH_FLOPPY_CACHE
+static WORD flopio_cached(UBYTE *buf, WORD rw, WORD dev,
+                   WORD sect, WORD track, WORD side, WORD count, WORD spt);
+#endif
 
 /* floppy write track */
 static WORD flopwtrack(UBYTE *buf, WORD dev, WORD track, WORD side,
@@ -125,6 +157,10 @@ static void flop_detect_drive(WORD dev);
 
 #if CONF_WITH_FDC
 
+/* read or write one sector of the current track */
+static WORD fdc_rwsect(UBYTE *userbuf, UBYTE *tmpbuf, WORD rw, WORD dev,
+                       WORD sect, BOOL *density_ok);
+
 /* called at start and end of a floppy access. */
 static void floplock(WORD dev);
 static void flopunlk(void);
@@ -487,6 +523,10 @@ LONG flop_mediach(WORD dev)
      * change.  we clear the latch & will report a change of some kind.
      */
     fi->wplatch = FALSE;
+#if CONF_WITH_FLOPPY_CACHE
+    if (cache_dev == dev)
+        cache_dev = -1;
+#endif
 
     /*
      * if the current status is clear, then we must have gone from a WP
@@ -596,7 +636,11 @@ LONG floppy_rw(WORD rw, UBYTE *buf, WORD cnt, LONG recnr, WORD spt,
         numsecs = spt - start_relsec;
         KDEBUG(("floppy_rw() #1: track=%d, side=%d, start=%d, count=%d\n",
                 track,side,start_relsec+1,numsecs));
+#if CONF_WITH_FLOPPY_CACHE
+        err = flopio_cached(buf, rw, dev, start_relsec+1, track, side, numsecs, spt);
+#else
         err = flopio_ver(buf, rw, dev, start_relsec+1, track, side, numsecs);
+#endif
         if (err)
             return err;
         buf += SECTOR_SIZE * numsecs;
@@ -636,7 +680,11 @@ LONG floppy_rw(WORD rw, UBYTE *buf, WORD cnt, LONG recnr, WORD spt,
     numsecs = end_relsec - start_relsec + 1;
     KDEBUG(("floppy_rw() #3: track=%d, side=%d, start=%d, count=%d\n",
             track,side,start_relsec+1,numsecs));
+#if CONF_WITH_FLOPPY_CACHE
+    err = flopio_cached(buf, rw, dev, start_relsec+1, track, side, numsecs, spt);
+#else
     err = flopio_ver(buf, rw, dev, start_relsec+1, track, side, numsecs);
+#endif
     if (err)
         return err;
 
@@ -764,6 +812,90 @@ LONG flopwr(const UBYTE *buf, LONG filler, WORD dev,
     return flopio(CONST_CAST(UBYTE *, buf), RW_WRITE, dev, sect, track, side, count);
 }
 
+#if CONF_WITH_FLOPTRKS
+/*==== xbios floptrks =====================================================*/
+
+/*
+ * read or write 'count' whole tracks (both sides if 'sides' is 2),
+ * starting at 'track', as a single operation
+ *
+ * the buffer holds the track/sides in order, each one with its 'spt'
+ * sectors in order; like for Floprd(), it may be anywhere in RAM.
+ *
+ * unlike one Floprd() per track/side, the drive stays locked throughout,
+ * and the sectors of each track/side are transferred starting with the
+ * one expected under the head after the head switch or step (see
+ * SWITCH_SKEW and STEP_SKEW), instead of waiting for sector 1.
+ */
+LONG floptrks(UBYTE *buf, WORD dev, WORD rw, WORD spt, WORD sides,
+              WORD track, WORD count)
+{
+    WORD side;
+    WORD err = 0;
+#if CONF_WITH_FDC
+    WORD n, sect, first;
+    BOOL density_ok;
+    UBYTE *tmpbuf = NULL;
+#endif
+
+    if (!IS_VALID_FLOPPY_DEVICE(dev))
+        return EUNDEV;  /* unknown disk */
+
+    if ((spt < 1) || (spt > 20) || (sides < 1) || (sides > 2) || (track < 0))
+        return EBADSF;
+
+    rw &= RW_RW;    /* remove any extraneous bits */
+
+#if CONF_WITH_FLOPPY_CACHE
+    if ((rw == RW_WRITE) && (cache_dev == dev))
+        cache_dev = -1;
+#endif
+
+#if CONF_WITH_FDC
+    if (count <= 0)
+        return 0;
+
+    floplock(dev);
+    density_ok = (finfo[dev].drive_type==DD_DRIVE) ? TRUE : FALSE;
+
+    if (IS_ODD_POINTER(buf) || !IS_STRAM_POINTER(buf))
+        tmpbuf = dskbufp;
+    else if (rw)
+        flush_data_cache(buf, (LONG)count * sides * spt * SECTOR_SIZE);
+
+    for (first = 1; count-- && !err; track++) {
+        for (side = 0; (side < sides) && !err; side++) {
+            select(dev, side);
+            err = set_track(track);
+            for (n = 0, sect = first; (n < spt) && !err; n++) {
+                err = fdc_rwsect(buf + (sect-1) * SECTOR_SIZE, tmpbuf, rw, dev,
+                                 sect, &density_ok);
+                if (++sect > spt)
+                    sect = 1;
+            }
+            buf += spt * SECTOR_SIZE;
+
+            /* 'first' is now the sector following the last one transferred */
+            first += (side+1 < sides) ? SWITCH_SKEW : STEP_SKEW;
+            if (first > spt)
+                first -= spt;
+        }
+    }
+
+    flopunlk();
+#else
+    for ( ; (count > 0) && !err; count--, track++) {
+        for (side = 0; (side < sides) && !err; side++) {
+            err = flopio(buf, rw, dev, 1, track, side, spt);
+            buf += spt * SECTOR_SIZE;
+        }
+    }
+#endif
+
+    return err;
+}
+#endif
+
 /*==== xbios flopver ======================================================*/
 
 /*
@@ -1083,10 +1215,8 @@ static WORD flopio(UBYTE *userbuf, WORD rw, WORD dev,
 {
     WORD err;
 #if CONF_WITH_FDC
-    WORD retry;
-    WORD cmd;
     BOOL density_ok;
-    UBYTE *tmpbuf = NULL, *iobufptr;
+    UBYTE *tmpbuf = NULL;
 #endif
 
     if (!IS_VALID_FLOPPY_DEVICE(dev))
@@ -1098,6 +1228,11 @@ static WORD flopio(UBYTE *userbuf, WORD rw, WORD dev,
         /* TODO, maybe media changed ? */
     }
 
+#if CONF_WITH_FLOPPY_CACHE
+    if ((rw == RW_WRITE) && (cache_dev == dev))
+        cache_dev = -1;
+#endif
+
 #ifdef MACHINE_AMIGA
     err = amiga_floprw(userbuf, rw, dev, sect, track, side, count);
     units[dev].last_access = hz_200;
@@ -1138,53 +1273,12 @@ static WORD flopio(UBYTE *userbuf, WORD rw, WORD dev,
     if (rw && !tmpbuf)
         flush_data_cache(userbuf, count * SECTOR_SIZE);
 
-    while(count--) {
-        iobufptr = tmpbuf ? tmpbuf : userbuf;
-        if (rw && tmpbuf) {
-            memcpy(tmpbuf, userbuf, SECTOR_SIZE);
-            flush_data_cache(tmpbuf, SECTOR_SIZE);
-        }
-
-        for (retry = 0; retry < IO_RETRIES; ) {
-            set_fdc_reg(FDC_SR, sect);
-            set_dma_addr(iobufptr);
-            if (rw == RW_READ) {
-                fdc_start_dma_read(1);
-                cmd = FDC_READ;
-            } else {
-                fdc_start_dma_write(1);
-                cmd = FDC_WRITE;
-            }
-            if (flopcmd(cmd) < 0) {     /* timeout */
-                err = EDRVNR;           /* drive not ready */
-                break;                  /* no retry */
-            }
-            err = decode_error(rw);
-            if ((err == 0) || (err == EWRPRO))
-                break;
-            if ((err == ESECNF) && !density_ok) {   /* density _may_ be wrong */
-                switch_density(dev);
-                density_ok = TRUE;
-                retry = 0;              /* reset retry count after density switch */
-                continue;
-            }
-            retry++;
-        }
+    for (err = 0; count--; ) {
+        err = fdc_rwsect(userbuf, tmpbuf, rw, dev, sect, &density_ok);
         /* If there was an error, don't read any more sectors */
         if (err)
             break;
 
-        /*
-         * if reading, invalidate data cache (this is low-cost, so
-         * it's ok to do it on a sector-by-sector basis), then copy
-         * from temporary buffer if necessary.
-         */
-        if (!rw) {
-            invalidate_data_cache(iobufptr, SECTOR_SIZE);
-            if (tmpbuf)
-                memcpy(userbuf, tmpbuf, SECTOR_SIZE);
-        }
-
         /* Otherwise carry on sequentially */
         userbuf += SECTOR_SIZE;
         sect++;
@@ -1198,6 +1292,70 @@ static WORD flopio(UBYTE *userbuf, WORD rw, WORD dev,
     return err;
 }
 
+#if CONF_WITH_FDC
+/*==== internal fdc_rwsect =================================================*/
+
+/*
+ * read or write one sector of the current track, with retries
+ *
+ * the drive must be locked and selected, and the head positioned.
+ * if tmpbuf is not NULL, the data goes through it; otherwise, the
+ * caller must have flushed the data cache before writing.
+ */
+static WORD fdc_rwsect(UBYTE *userbuf, UBYTE *tmpbuf, WORD rw, WORD dev,
+                       WORD sect, BOOL *density_ok)
+{
+    UBYTE *iobufptr = tmpbuf ? tmpbuf : userbuf;
+    WORD retry, cmd, err = 0;
+
+    if (rw && tmpbuf) {
+        memcpy(tmpbuf, userbuf, SECTOR_SIZE);
+        flush_data_cache(tmpbuf, SECTOR_SIZE);
+    }
+
+    for (retry = 0; retry < IO_RETRIES; ) {
+        set_fdc_reg(FDC_SR, sect);
+        set_dma_addr(iobufptr);
+        if (rw == RW_READ) {
+            fdc_start_dma_read(1);
+            cmd = FDC_READ;
+        } else {
+            fdc_start_dma_write(1);
+            cmd = FDC_WRITE;
+        }
+        if (flopcmd(cmd) < 0) {     /* timeout */
+            err = EDRVNR;           /* drive not ready */
+            break;                  /* no retry */
+        }
+        err = decode_error(rw);
+        if ((err == 0) || (err == EWRPRO))
+            break;
+        if ((err == ESECNF) && !*density_ok) {  /* density _may_ be wrong */
+            switch_density(dev);
+            *density_ok = TRUE;
+            retry = 0;              /* reset retry count after density switch */
+            continue;
+        }
+        retry++;
+    }
+    if (err)
+        return err;
+
+    /*
+     * if reading, invalidate data cache (this is low-cost, so
+     * it's ok to do it on a sector-by-sector basis), then copy
+     * from temporary buffer if necessary.
+     */
+    if (!rw) {
+        invalidate_data_cache(iobufptr, SECTOR_SIZE);
+        if (tmpbuf)
+            memcpy(userbuf, tmpbuf, SECTOR_SIZE);
+    }
+
+    return 0;
+}
+#endif
+
 /*==== internal flopio_ver =================================================*/
 
 /*
@@ -1224,6 +1382,38 @@ static WORD flopio_ver(UBYTE *buf, WORD rw, WORD dev, WORD sect, WORD track, WOR
     return err;
 }
 
+#if CONF_WITH_FLOPPY_CACHE
+/*==== internal flopio_cached ==============================================*/
+
+/*
+ * performs flopio_ver(), reading via the track cache where possible
+ */
+static WORD flopio_cached(UBYTE *buf, WORD rw, WORD dev, WORD sect, WORD track, WORD side, WORD count, WORD spt)
+{
+    UBYTE *cachebuf = (UBYTE *)trackbuf;
+
+    if ((rw & RW_WRITE) || (spt > CACHE_MAXSPT) || (count == spt))
+        return flopio_ver(buf, rw, dev, sect, track, side, count);
+
+    if ((cache_dev != dev) || (cache_track != track)
+     || (cache_side != side) || (cache_spt != spt) || finfo[dev].wplatch) {
+        cache_dev = -1;
+        if (flopio(cachebuf, RW_READ, dev, 1, track, side, spt) != 0) {
+            /* e.g. a bad sector elsewhere on the track: just read what we need */
+            return flopio(buf, RW_READ, dev, sect, track, side, count);
+        }
+        cache_track = track;
+        cache_side = side;
+        cache_spt = spt;
+        cache_dev = dev;
+    }
+
+    memcpy(buf, cachebuf + (sect-1) * SECTOR_SIZE, count * SECTOR_SIZE);
+
+    return 0;
+}
+#endif
+
 /*==== internal flopwtrack =================================================*/
 
 static WORD flopwtrack(UBYTE *userbuf, WORD dev, WORD track, WORD side, WORD track_size, WORD density)
@@ -1236,6 +1426,11 @@ static WORD flopwtrack(UBYTE *userbuf, WORD dev, WORD track, WORD side, WORD tra
         /* TODO, maybe media changed ? */
     }
 
+#if CONF_WITH_FLOPPY_CACHE
+    if (cache_dev == dev)
+        cache_dev = -1;
+#endif
+
     /* flush cache here so that track image is pushed to memory */
     flush_data_cache(userbuf,track_size);
 
@@ -1384,6 +1579,10 @@ void flopvbl(void)
     motor_on = status & FDC_MOTORON;    /* remember for flopcmd()'s use */
 
     wp = status & FDC_WRI_PRO;
+#if CONF_WITH_MEDIACH_CACHE
+    if (wp != finfo[n].wpstatus)
+        blkdev_changes++;       /* diskette inserted or removed */
+#endif
     finfo[n].wpstatus = wp;
     finfo[n].wplatch |= wp;
 
@@ -1460,6 +1659,9 @@ static void deselect(void)
 {
     select(-1,0);
     deselect_time = 0UL;
+#if CONF_WITH_FLOPPY_CACHE
+    cache_dev = -1;     /* the diskette may be changed while the motor is off */
+#endif
 }
 
 /*
@@ -37,6 +37,10 @@ void protobt(UBYTE *buf, LONG serial, WORD type, WORD exec);
 LONG flopver(WORD *buf, LONG filler, WORD dev,
                     WORD sect, WORD track, WORD side, WORD count);
 LONG floprate(WORD dev, WORD rate);
+#if CONF_WITH_FLOPTRKS
+LONG floptrks(UBYTE *buf, WORD dev, WORD rw, WORD spt, WORD sides,
+              WORD track, WORD count);
+#endif
 
 /* internal functions */
 
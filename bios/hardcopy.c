@@ -0,0 +1,207 @@
+/*
+ * hardcopy.c - background screen dump to the printer
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * The screen is printed as Epson ESC/P bit image graphics, in bands of
+ * 8 pixel lines (one print head pass).  Pixels with a colour index other
+ * than 0 are printed as black dots.
+ *
+ * Rather than sending the dump byte by byte, a few 16-pixel columns of
+ * the current band are rendered on each VBL into the parallel port queue,
+ * which is drained by the BUSY interrupt.  The dump therefore runs in the
+ * background; pressing Alt-Help again cancels it.
+ */
+
+/* #define ENABLE_KDEBUG */
+
+#include "emutos.h"
+#include "intmath.h"
+#include "biosext.h"
+#include "tosvars.h"
+#include "lineavars.h"
+#include "has.h"
+#include "screen.h"
+#include "parport.h"
+#include "hardcopy.h"
+
+#if CONF_WITH_HARDCOPY
+
+#define ESC             0x1b
+#define BAND_HEIGHT     8       /* pixel lines per print head pass */
+#define GROUPS_PER_VBL  4       /* 16-pixel columns rendered per VBL */
+#define MAX_DENSITY_1   960     /* max width printed at 120 dpi */
+
+/* printer commands */
+static const UBYTE init_cmd[] = { ESC, '3', 24 };   /* line spacing 24/216" */
+static const UBYTE exit_cmd[] = { ESC, '2' };       /* line spacing 1/6" */
+static const UBYTE eol_cmd[] = { '\r', '\n' };
+
+static volatile BOOL hardcopy_active;
+
+static struct {
+    const UBYTE *base;  /* screen address */
+    UWORD width;        /* in pixels */
+    UWORD height;       /* in pixels */
+    UWORD planes;
+    UWORD linebytes;    /* bytes per screen line */
+    UWORD y;            /* top of the current band */
+    UWORD x;            /* next column to render in the current band */
+    UBYTE density;      /* ESC/P bit image command */
+} hc;
+
+
+/*
+ * render 16 pixel columns of the current band starting at hc.x into buf,
+ * one byte per column, the top pixel line being in bit 7
+ */
+static void render_group(UBYTE *buf)
+{
+    const UBYTE *p;
+    UWORD mask, bits;
+    WORD lines, row, plane, i;
+    UBYTE dot;
+
+    for (i = 0; i < 16; i++)
+        buf[i] = 0;
+
+    p = hc.base + (ULONG)hc.y * hc.linebytes + (hc.x / 16) * hc.planes * 2;
+    lines = min(BAND_HEIGHT, hc.height - hc.y);
+
+    for (row = 0, dot = 0x80; row < lines; row++, dot >>= 1, p += hc.linebytes)
+    {
+        /* merge the planes: a pixel is set if its colour index is not 0 */
+        for (plane = 0, bits = 0; plane < hc.planes; plane++)
+            bits |= ((const UWORD *)p)[plane];
+
+        for (i = 0, mask = 0x8000; bits && (i < 16); i++, mask >>= 1)
+        {
+            if (bits & mask)
+                buf[i] |= dot;
+        }
+    }
+}
+
+
+/*
+ * start (or, if one is in progress, cancel) a dump of the logical screen
+ *
+ * this is the default dump_vec routine, called by the VBL after Alt-Help
+ */
+void hardcopy_start(void)
+{
+    UWORD planes, width, height;
+
+    if (hardcopy_active)
+    {
+        KDEBUG(("hardcopy cancelled\n"));
+        hardcopy_active = FALSE;
+        parport_queue_flush();
+        return;
+    }
+
+#if CONF_WITH_NOVA
+    /* the Nova screen (in use if the resolution is locked) is chunky */
+    if (HAS_NOVA && !rez_changeable())
+        return;
+#endif
+
+    screen_get_current_mode_info(&planes, &width, &height);
+    if (planes > 8)     /* truecolor is not supported */
+        return;
+
+    /* the dump follows any queued printer output */
+    if (parport_queue_free() < (WORD)sizeof(init_cmd))
+        return;
+
+    hc.base = v_bas_ad;
+    hc.width = width;
+    hc.height = height;
+    hc.planes = planes;
+    hc.linebytes = v_lin_wr;
+    hc.y = hc.x = 0;
+    hc.density = (width <= MAX_DENSITY_1) ? 'L' : 'Z';  /* 120 or 240 dpi */
+
+    KDEBUG(("hardcopy of %ux%u, %u planes\n", width, height, planes));
+
+    parport_queue(init_cmd, sizeof(init_cmd));
+    hardcopy_active = TRUE;
+}
+
+
+/*
+ * render the next part of the dump, as far as the queue allows
+ */
+void hardcopy_vbl(void)
+{
+    UBYTE buf[16];
+    WORD n;
+
+    if (!hardcopy_active)
+        return;
+
+    /* give up if the printer does not accept data any more */
+    if (parport_queue_stalled())
+    {
+        KDEBUG(("hardcopy: printer timeout\n"));
+        hardcopy_active = FALSE;
+        parport_queue_flush();
+        return;
+    }
+
+    if (hc.y >= hc.height)
+    {
+        /* all sent: the dump is complete */
+        if (parport_queue_empty())
+            hardcopy_active = FALSE;
+        return;
+    }
+
+    for (n = 0; n < GROUPS_PER_VBL; n++)
+    {
+        /* room for a band header, a group, and the end of band / dump */
+        if (parport_queue_free() < 4 + sizeof(buf) + sizeof(eol_cmd) + sizeof(exit_cmd))
+            break;
+
+        if (hc.x == 0)
+        {
+            buf[0] = ESC;
+            buf[1] = hc.density;
+            buf[2] = LOBYTE(hc.width);
+            buf[3] = HIBYTE(hc.width);
+            parport_queue(buf, 4);
+        }
+
+        render_group(buf);
+        parport_queue(buf, sizeof(buf));
+        hc.x += 16;
+
+        if (hc.x >= hc.width)
+        {
+            parport_queue(eol_cmd, sizeof(eol_cmd));
+            hc.x = 0;
+            hc.y += BAND_HEIGHT;
+            if (hc.y >= hc.height)
+            {
+                parport_queue(exit_cmd, sizeof(exit_cmd));
+                break;
+            }
+        }
+    }
+}
+
+
+/*
+ * return TRUE while a dump is in progress
+ */
+BOOL hardcopy_busy(void)
+{
+    return hardcopy_active;
+}
+
+#endif /* CONF_WITH_HARDCOPY */
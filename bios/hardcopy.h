@@ -0,0 +1,21 @@
+/*
+ * hardcopy.h - background screen dump to the printer
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+#ifndef HARDCOPY_H
+#define HARDCOPY_H
+
+#if CONF_WITH_HARDCOPY
+
+void hardcopy_start(void);
+void hardcopy_vbl(void);
+BOOL hardcopy_busy(void);
+
+#endif /* CONF_WITH_HARDCOPY */
+
+#endif /* HARDCOPY_H */
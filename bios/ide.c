@@ -36,6 +36,7 @@
 #include "biosmem.h"
 #include "amiga.h"
 #include "intmath.h"
+#include "warmcache.h"
 
 #if CONF_WITH_IDE
 
@@ -207,6 +208,10 @@ struct IDE
 #define IDE_CMD_READ_MULTIPLE       0xc4
 #define IDE_CMD_WRITE_MULTIPLE      0xc5
 #define IDE_CMD_SET_MULTIPLE_MODE   0xc6
+#define IDE_CMD_READ_SECTOR_EXT     0x24    /* LBA48 commands */
+#define IDE_CMD_WRITE_SECTOR_EXT    0x34
+#define IDE_CMD_READ_MULTIPLE_EXT   0x29
+#define IDE_CMD_WRITE_MULTIPLE_EXT  0x39
 
 #define IDE_CMD_ATAPI_PACKET    0xa0    /* ATAPI-only commands */
 #define IDE_CMD_ATAPI_IDENTIFY  0xa1
@@ -228,11 +233,20 @@ struct IDE
 
 /*
  * maximum number of sectors per physical i/o.  this MUST not exceed 256,
- * at least for LBA28-style commands.  the best performance is obtained
- * if this is a multiple of the sectors-per-interrupt value supported by
- * the drive(s) in multiple mode.
+ * at least for LBA28-style commands (a sector count of 256 is sent as 0).
+ * the best performance is obtained if this is a multiple of the
+ * sectors-per-interrupt value supported by the drive(s) in multiple mode.
  */
-#define MAXSECS_PER_IO  32
+#define MAXSECS_PER_IO  256
+
+/*
+ * the same, for devices that support LBA48 commands, where the sector
+ * count is 16 bits.  this is a multiple of any power-of-2 spi value.
+ */
+#define MAXSECS_PER_IO_LBA48    16384
+
+/* highest sector number + 1 that can be accessed by LBA28 commands */
+#define LBA28_LIMIT     0x10000000UL
 
 
 /* interface/device info */
@@ -257,6 +271,7 @@ struct IFINFO {
 #define DEVTYPE_ATAPI   3
 
 #define MULTIPLE_MODE_ACTIVE    0x01    /* for 'options' */
+#define LBA48_SUPPORTED         0x02
 
 #define INVALID_OPCODE  1               /* for 'sense' */
 #define INVALID_SECTOR  2
@@ -344,10 +359,14 @@ static struct {             /* space to build return data for Inquiry */
 
 /* prototypes */
 static WORD clear_multiple_mode(UWORD ifnum,UWORD dev);
-static void ide_detect_devices(UWORD ifnum);
+static void ide_start_detect(UWORD ifnum);
+static void ide_end_detect(UWORD ifnum,LONG deadline);
 static LONG ata_identify(WORD dev);
 static int ide_select_device(volatile struct IDE *interface,UWORD dev);
 static void set_multiple_mode(WORD dev,UWORD multi_io);
+#if CONF_WITH_IDE_LBA48
+static void set_lba48_mode(WORD dev,UWORD cmds_supported);
+#endif
 static UWORD get_start_count(volatile struct IDE *interface);
 static void set_start_count(volatile struct IDE *interface,UBYTE sector,UBYTE count);
 static int wait_for_not_BSY(volatile struct IDE *interface,LONG timeout);
@@ -575,6 +594,7 @@ BOOL detect_ide(void)
 void ide_init(void)
 {
     int i, bitmask;
+    LONG timeout;
 
     delay400ns = loopcount_1_msec / 2500;
     delay5us = loopcount_1_msec / 200;
@@ -588,24 +608,57 @@ void ide_init(void)
      * since this is called during initialisation, which can be
      * invoked by power-on/reset.
      */
-    LONG timeout = hz_200 + LONG_TIMEOUT;
-    for (i = 0, bitmask = 1; i < NUM_IDE_INTERFACES; i++, bitmask <<= 1)
-        if (has_ide&bitmask)
-            if (!ide_interface_exists(i, timeout))
-                has_ide &= ~bitmask;
+#if CONF_WITH_WARM_CACHE
+    if (warm_cache_valid) {
+        /* same interfaces & cables as on the previous boot */
+        has_ide &= warm_cache.ide_present;
+        for (i = 0, bitmask = 1; i < NUM_IDE_INTERFACES; i++, bitmask <<= 1)
+            if (warm_cache.ide_twisted&bitmask) {
+                ifinfo[i].base_address = (volatile struct IDE *)(((ULONG)ifinfo[i].base_address)-1);
+                ifinfo[i].twisted_cable = TRUE;
+            }
+    } else
+#endif
+    {
+        timeout = hz_200 + LONG_TIMEOUT;
+        for (i = 0, bitmask = 1; i < NUM_IDE_INTERFACES; i++, bitmask <<= 1)
+            if (has_ide&bitmask)
+                if (!ide_interface_exists(i, timeout))
+                    has_ide &= ~bitmask;
+#if CONF_WITH_WARM_CACHE
+        warm_cache.ide_present = has_ide;
+        for (i = 0, bitmask = 1; i < NUM_IDE_INTERFACES; i++, bitmask <<= 1)
+            if (ifinfo[i].twisted_cable)
+                warm_cache.ide_twisted |= bitmask;
+#endif
+    }
 
     KDEBUG(("ide_init(): has_ide = 0x%02x\n",has_ide));
 #endif
 
-    /* detect devices */
+    /*
+     * detect devices: the soft resets of all the interfaces are started
+     * first, then we wait for them all to complete.  so the devices
+     * reset in parallel, and we wait at most LONG_TIMEOUT rather than
+     * LONG_TIMEOUT per interface.
+     */
     for (i = 0, bitmask = 1; i < NUM_IDE_INTERFACES; i++, bitmask <<= 1)
         if (has_ide&bitmask)
-            ide_detect_devices(i);
+            ide_start_detect(i);
+    timeout = hz_200 + LONG_TIMEOUT;
+    for (i = 0, bitmask = 1; i < NUM_IDE_INTERFACES; i++, bitmask <<= 1)
+        if (has_ide&bitmask)
+            ide_end_detect(i, timeout);
 
-    /* set multiple mode for all devices that we have info for */
-    for (i = 0; i < DEVICES_PER_BUS; i++)
-        if (ata_identify(i) == 0)
+    /* set multiple mode (and LBA48) for all devices that we have info for */
+    for (i = 0; i < DEVICES_PER_BUS; i++) {
+        if (ata_identify(i) == 0) {
             set_multiple_mode(i,identify.multiple_io_info);
+#if CONF_WITH_IDE_LBA48
+            set_lba48_mode(i,identify.cmds_supported[1]);
+#endif
+        }
+    }
 
 #if CONF_WITH_SCSI_DRIVER
     /* set packet size for all ATAPI devices */
@@ -645,21 +698,26 @@ static UWORD ide_device_type(WORD dev)
  * the following routines for device type detection are adapted
  * from Hale Landis's public domain ATA driver, MINDRVR.
  */
-static int wait_for_not_BSY_and_DRDY(volatile struct IDE *interface,LONG timeout)
+/*
+ * note: 'deadline' is an absolute value of hz_200.  the status is
+ * always checked at least once, even if the deadline has passed.
+ */
+static int wait_for_not_BSY_and_DRDY(volatile struct IDE *interface,LONG deadline)
 {
-    LONG next = hz_200 + timeout;
-
     DELAY_400NS;
-    while(hz_200 < next) {
+    do {
         if ((IDE_READ_ALT_STATUS(interface) & (IDE_STATUS_BSY|IDE_STATUS_DRDY)) == IDE_STATUS_DRDY)
             return 0;
-    }
+    } while(hz_200 < deadline);
 
-    KDEBUG(("Timeout in wait_for_not_BSY_and_DRDY(%p,%ld)\n",interface,timeout));
+    KDEBUG(("Timeout in wait_for_not_BSY_and_DRDY(%p,%ld)\n",interface,deadline));
     return 1;
 }
 
-static void ide_reset(UWORD ifnum)
+/*
+ * start a soft reset: the caller must wait for its completion
+ */
+static void ide_start_reset(UWORD ifnum)
 {
     struct IFINFO *info = ifinfo + ifnum;
     volatile struct IDE *interface = info->base_address;
@@ -669,11 +727,6 @@ static void ide_reset(UWORD ifnum)
     DELAY_5US;
     IDE_WRITE_CONTROL(interface,IDE_CONTROL_nIEN);
     DELAY_400NS;
-
-    /* if at least one device exists, wait for it to clear BSY and set DRDY */
-    if ((info->dev[0].type != DEVTYPE_NONE)
-     || (info->dev[1].type != DEVTYPE_NONE))
-        wait_for_not_BSY_and_DRDY(interface,LONG_TIMEOUT);
 }
 
 static UBYTE ide_decode_type(UBYTE status,UWORD signature)
@@ -694,12 +747,18 @@ static UBYTE ide_decode_type(UBYTE status,UWORD signature)
     return DEVTYPE_UNKNOWN;
 }
 
-static void ide_detect_devices(UWORD ifnum)
+/*
+ * device detection is done in two parts, so that the soft resets of
+ * all the interfaces can proceed in parallel:
+ *  . ide_start_detect() does an initial check for devices, then starts
+ *    the soft reset
+ *  . ide_end_detect() waits for the reset to complete, then rechecks
+ *    the devices and detects their type
+ */
+static void ide_start_detect(UWORD ifnum)
 {
     volatile struct IDE *interface = ifinfo[ifnum].base_address;
     struct IFINFO *info = ifinfo + ifnum;
-    UBYTE status;
-    UWORD signature;
     int i;
 
     MAYBE_UNUSED(interface);
@@ -724,10 +783,27 @@ static void ide_detect_devices(UWORD ifnum)
 #endif
     }
 
-    /* recheck after soft reset, also detect ata/atapi */
+    /* start soft reset */
     ide_select_device(interface,0);
-    ide_reset(ifnum);
+    ide_start_reset(ifnum);
+}
 
+static void ide_end_detect(UWORD ifnum,LONG deadline)
+{
+    volatile struct IDE *interface = ifinfo[ifnum].base_address;
+    struct IFINFO *info = ifinfo + ifnum;
+    UBYTE status;
+    UWORD signature;
+    int i;
+
+    MAYBE_UNUSED(interface);
+
+    /* if at least one device exists, wait for it to clear BSY and set DRDY */
+    if ((info->dev[0].type != DEVTYPE_NONE)
+     || (info->dev[1].type != DEVTYPE_NONE))
+        wait_for_not_BSY_and_DRDY(interface,deadline);
+
+    /* recheck after soft reset, also detect ata/atapi */
     for (i = 0; i < 2; i++) {
         ide_select_device(interface,i);
         if (get_start_count(interface) == 0x0101) {
@@ -842,6 +918,26 @@ static void ide_rw_start(volatile struct IDE *interface,UWORD dev,ULONG sector,U
 {
     KDEBUG(("ide_rw_start(%p, %u, %lu, %u, 0x%02x)\n", interface, dev, sector, count, cmd));
 
+#if CONF_WITH_IDE_LBA48
+    /*
+     * for LBA48 commands, each register holds two bytes: the high-order
+     * bytes are written first.  our sector numbers are only 32 bits, so
+     * LBA bits 32-47 are always zero.
+     */
+    switch(cmd) {
+    case IDE_CMD_READ_SECTOR_EXT:
+    case IDE_CMD_WRITE_SECTOR_EXT:
+    case IDE_CMD_READ_MULTIPLE_EXT:
+    case IDE_CMD_WRITE_MULTIPLE_EXT:
+        set_start_count(interface,(UBYTE)(sector>>24),HIBYTE(count));
+        set_cylinder(interface,0);
+        set_start_count(interface,LOBYTE(sector),LOBYTE(count));
+        set_cylinder(interface,(UWORD)((sector & 0xffff00) >> 8));
+        set_command_head(interface,cmd,IDE_MODE_LBA|IDE_DEVICE(dev));
+        return;
+    }
+#endif
+
     set_start_count(interface,LOBYTE(sector),LOBYTE(count));
     set_cylinder(interface,(UWORD)((sector & 0xffff00) >> 8));
     set_command_head(interface,cmd,IDE_MODE_LBA|IDE_DEVICE(dev)|(UBYTE)((sector>>24)&0x0f));
@@ -904,6 +1000,86 @@ static void ide_get_data_32(volatile struct IDE *interface,UBYTE *buffer,ULONG b
 }
 #endif /* CONF_WITH_APOLLO_68080 */
 
+#if IDE_32BIT_XFER
+/*
+ * byteswapped transfers, 16 bytes per iteration
+ *
+ * the buffer side is accessed with a single movem.l per iteration, and
+ * each LONG is swapped in a register.  this is only worthwhile on CPUs
+ * with a barrel shifter (68020+ & ColdFire); the 68000 uses xferswap().
+ */
+#ifdef __mcoldfire__
+# define HAS_BLOCK_SWAP     TRUE
+/* ColdFire has no word rotates, so use shifts & masks (%d4 = 0x00ff00ff) */
+# define SWAPLONG(r)        "move.l  " r ",%%d5\n\t"      \
+                            "lsr.l   #8,%%d5\n\t"         \
+                            "and.l   %%d4,%%d5\n\t"       \
+                            "and.l   %%d4," r "\n\t"      \
+                            "lsl.l   #8," r "\n\t"        \
+                            "or.l    %%d5," r "\n\t"
+# define SWAPINIT           "move.l  #0x00ff00ff,%%d4\n\t"
+# define SWAPREGS           "d0", "d1", "d2", "d3", "d4", "d5"
+#else
+# define HAS_BLOCK_SWAP     (mcpu >= 20)
+# define SWAPLONG(r)        "ror.w   #8," r "\n\t"        \
+                            "swap    " r "\n\t"           \
+                            "ror.w   #8," r "\n\t"        \
+                            "swap    " r "\n\t"
+# define SWAPINIT
+# define SWAPREGS           "d0", "d1", "d2", "d3"
+#endif
+
+/* 'end' must be greater than 'p', and 'end - p' a multiple of 16 bytes */
+static void ide_get_data_blockswap(volatile XFERWIDTH *datareg,XFERWIDTH *p,XFERWIDTH *end)
+{
+    __asm__ volatile
+    (
+        SWAPINIT
+        "1:\n\t"
+        "move.l  (%2),%%d0\n\t"
+        "move.l  (%2),%%d1\n\t"
+        "move.l  (%2),%%d2\n\t"
+        "move.l  (%2),%%d3\n\t"
+        SWAPLONG("%%d0")
+        SWAPLONG("%%d1")
+        SWAPLONG("%%d2")
+        SWAPLONG("%%d3")
+        "movem.l %%d0-%%d3,(%0)\n\t"
+        "lea     16(%0),%0\n\t"
+        "cmp.l   %1,%0\n\t"
+        "jcs     1b"
+    : "+a"(p)
+    : "a"(end), "a"(datareg)
+    : SWAPREGS, "cc", "memory"
+    );
+}
+
+/* 'end' must be greater than 'p', and 'end - p' a multiple of 16 bytes */
+static void ide_put_data_blockswap(volatile XFERWIDTH *datareg,XFERWIDTH *p,XFERWIDTH *end)
+{
+    __asm__ volatile
+    (
+        SWAPINIT
+        "1:\n\t"
+        "movem.l (%0),%%d0-%%d3\n\t"
+        "lea     16(%0),%0\n\t"
+        SWAPLONG("%%d0")
+        SWAPLONG("%%d1")
+        SWAPLONG("%%d2")
+        SWAPLONG("%%d3")
+        "move.l  %%d0,(%2)\n\t"
+        "move.l  %%d1,(%2)\n\t"
+        "move.l  %%d2,(%2)\n\t"
+        "move.l  %%d3,(%2)\n\t"
+        "cmp.l   %1,%0\n\t"
+        "jcs     1b"
+    : "+a"(p)
+    : "a"(end), "a"(datareg)
+    : SWAPREGS, "cc", "memory"
+    );
+}
+#endif /* IDE_32BIT_XFER */
+
 /*
  * get data from IDE device
  */
@@ -926,6 +1102,12 @@ static void ide_get_data(volatile struct IDE *interface,UBYTE *buffer,ULONG buff
 
     if (need_byteswap) {
         end = (XFERWIDTH *)(buffer + (bufferlen & ~(16-1)));    /* mask must match unrolled loop */
+#if IDE_32BIT_XFER
+        if (HAS_BLOCK_SWAP && (p < end)) {
+            ide_get_data_blockswap(&interface->data, p, end);
+            p = end;
+        }
+#endif
         while (p < end) {
             XFERWIDTH temp;
 
@@ -990,6 +1172,20 @@ static void ide_get_data(volatile struct IDE *interface,UBYTE *buffer,ULONG buff
     }
 }
 
+#if CONF_WITH_IDE_LBA48
+/*
+ * return TRUE iff a transfer must use LBA48 commands, i.e. if it goes
+ * beyond the LBA28 limit or is too long for an 8-bit sector count
+ */
+static BOOL need_lba48(struct IFINFO *info,UWORD dev,ULONG sector,UWORD count)
+{
+    if (!(info->dev[dev].options & LBA48_SUPPORTED))
+        return FALSE;
+
+    return (count > 256) || (sector + count > LBA28_LIMIT);
+}
+#endif
+
 /*
  * read from the IDE device
  */
@@ -1017,6 +1213,15 @@ static LONG ide_read(UBYTE cmd,UWORD ifnum,UWORD dev,ULONG sector,UWORD count,UB
         KDEBUG(("spi=%u\n", spi));
     }
 
+#if CONF_WITH_IDE_LBA48
+    if (need_lba48(info,dev,sector,count)) {
+        if (cmd == IDE_CMD_READ_SECTOR)
+            cmd = IDE_CMD_READ_SECTOR_EXT;
+        else if (cmd == IDE_CMD_READ_MULTIPLE)
+            cmd = IDE_CMD_READ_MULTIPLE_EXT;
+    }
+#endif
+
     ide_rw_start(interface,dev,sector,count,cmd);
 
     /*
@@ -1086,6 +1291,12 @@ static void ide_put_data(volatile struct IDE *interface,UBYTE *buffer,ULONG buff
 
     if (need_byteswap) {
         end = (XFERWIDTH *)(buffer + (bufferlen & ~(16-1)));    /* mask must match unrolled loop */
+#if IDE_32BIT_XFER
+        if (HAS_BLOCK_SWAP && (p < end)) {
+            ide_put_data_blockswap(&interface->data, p, end);
+            p = end;
+        }
+#endif
         while (p < end) {
             XFERWIDTH temp;
 
@@ -1176,6 +1387,15 @@ static LONG ide_write(UBYTE cmd,UWORD ifnum,UWORD dev,ULONG sector,UWORD count,U
         spi = info->dev[dev].spi;
     }
 
+#if CONF_WITH_IDE_LBA48
+    if (need_lba48(info,dev,sector,count)) {
+        if (cmd == IDE_CMD_WRITE_SECTOR)
+            cmd = IDE_CMD_WRITE_SECTOR_EXT;
+        else if (cmd == IDE_CMD_WRITE_MULTIPLE)
+            cmd = IDE_CMD_WRITE_MULTIPLE_EXT;
+    }
+#endif
+
     ide_rw_start(interface,dev,sector,count,cmd);
 
     if (wait_for_not_BSY(interface,SHORT_TIMEOUT))
@@ -1240,6 +1460,11 @@ LONG ide_rw(WORD rw,LONG sector,WORD count,UBYTE *buf,WORD dev,BOOL need_byteswa
 
     rw &= RW_RW;    /* we just care about read or write for now */
 
+#if CONF_WITH_IDE_LBA48
+    if (ifinfo[ifnum].dev[dev].options & LBA48_SUPPORTED)
+        maxsecs_per_io = MAXSECS_PER_IO_LBA48;
+#endif
+
     /*
      * because ide_read()/ide_write() access the buffer with word (or long)
      * moves, we must use an intermediate buffer if the user buffer is not
@@ -1333,6 +1558,27 @@ static void set_multiple_mode(WORD dev,UWORD multi_io)
     ifinfo[ifnum].dev[dev].spi = spi;
 }
 
+#if CONF_WITH_IDE_LBA48
+/*
+ * remember if the device supports the 48-bit address feature set
+ * (IDENTIFY DEVICE word 83, valid if bits 15-14 are 01)
+ */
+static void set_lba48_mode(WORD dev,UWORD cmds_supported)
+{
+    UWORD ifnum;
+
+    if ((cmds_supported & 0xc400) != 0x4400)
+        return;
+
+    ifnum = dev / 2;    /* i.e. primary IDE, secondary IDE, ... */
+    dev &= 1;           /* 0 or 1 */
+
+    KDEBUG(("Enabling LBA48 for ifnum %d dev %d\n",ifnum,dev));
+
+    ifinfo[ifnum].dev[dev].options |= LBA48_SUPPORTED;
+}
+#endif
+
 static LONG ata_identify(WORD dev)
 {
     LONG ret;
@@ -1355,6 +1601,26 @@ static LONG ata_identify(WORD dev)
     return ret;
 }
 
+/*
+ * return the number of sectors of the device, from the identify structure
+ */
+static ULONG ata_capacity(void)
+{
+    ULONG numsecs = MAKE_ULONG(identify.numsecs_lba28[1], identify.numsecs_lba28[0]);
+
+#if CONF_WITH_IDE_LBA48
+    /* big disks report the LBA28 maximum: get the real size if possible */
+    if ((identify.cmds_supported[1] & 0xc400) == 0x4400) {
+        if (identify.maxsec_lba48[3] || identify.maxsec_lba48[2])
+            numsecs = 0xffffffffUL;     /* our sector numbers are 32 bits */
+        else
+            numsecs = MAKE_ULONG(identify.maxsec_lba48[1], identify.maxsec_lba48[0]);
+    }
+#endif
+
+    return numsecs;
+}
+
 /*
  *  perform miscellaneous non-data-transfer functions
  */
@@ -1368,8 +1634,7 @@ LONG ide_ioctl(WORD dev,UWORD ctrl,void *arg)
     case GET_DISKINFO:
         ret = ata_identify(dev);    /* reads into identify structure */
         if (ret >= 0) {
-            info[0] = MAKE_ULONG(identify.numsecs_lba28[1],
-                        identify.numsecs_lba28[0]);
+            info[0] = ata_capacity();
             info[1] = SECTOR_SIZE;  /* note: could be different under ATAPI 7 */
             ret = E_OK;
         }
@@ -1572,7 +1837,7 @@ static LONG handle_ata_device(WORD dev, IDECmd *cmd)
         ret = ata_identify(dev);
         if (ret)
             break;
-        info[0] = MAKE_ULONG(identify.numsecs_lba28[1], identify.numsecs_lba28[0]) - 1;
+        info[0] = ata_capacity() - 1;
         info[1] = SECTOR_SIZE;
         memcpy(cmd->bufptr, (void *)info, 2*sizeof(LONG));
         break;
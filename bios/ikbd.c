@@ -39,6 +39,8 @@
 #include "coldfire.h"
 #include "amiga.h"
 #include "lisa.h"
+#include "mouse.h"
+#include "intmath.h"
 
 
 /* forward declarations */
@@ -168,7 +170,7 @@ static void push_ikbdiorec(ULONG value)
         /* iorec full */
         return;
     }
-    *(ULONG_ALIAS *) (ikbdiorec.buf + tail) = value;
+    *(volatile ULONG_ALIAS *) (ikbdiorec.buf + tail) = value;
     ikbdiorec.tail = tail;
 }
 
@@ -256,24 +258,22 @@ LONG bconin2(void)
     value = ikbdiorec_from_ascii(ascii);
 #else
     /* Check the IKBD IOREC */
-    WORD old_sr;
+    WORD head;
 
     while (!bconstat2()) {
 #if USE_STOP_INSN_TO_FREE_HOST_CPU
         stop_until_interrupt();
 #endif
     }
-    /* disable interrupts */
-    old_sr = set_sr(0x2700);
 
-    ikbdiorec.head += 4;
-    if (ikbdiorec.head >= ikbdiorec.size) {
-        ikbdiorec.head = 0;
+    head = ikbdiorec.head + 4;
+    if (head >= ikbdiorec.size) {
+        head = 0;
     }
-    value = *(ULONG_ALIAS *) (ikbdiorec.buf + ikbdiorec.head);
+    value = *(volatile ULONG_ALIAS *) (ikbdiorec.buf + head);
 
-    /* restore interrupts */
-    set_sr(old_sr);
+    /* free the slot only once it has been read (see iorec.h) */
+    ikbdiorec.head = head;
 #endif /* CONF_SERIAL_CONSOLE_POLLING_MODE */
 
     if (!(conterm & 8))         /* shift status not wanted? */
@@ -282,6 +282,101 @@ LONG bconin2(void)
     return value;
 }
 
+#if CONF_WITH_MOUSE_COALESCE
+/*
+ * relative mouse packet coalescing
+ *
+ * while the mouse vector is the VDI's, the movement reported by relative
+ * mouse packets with an unchanged button state is accumulated here, and
+ * delivered by ikbd_mouse_vbl() as a single packet (or a few, if it does
+ * not fit in one) per VBL.  the VDI only redraws the cursor at VBL time
+ * anyway, so this just saves the intermediate calls.
+ */
+static WORD mouse_acc_dx, mouse_acc_dy;     /* accumulated movement */
+static SBYTE mouse_acc_hdr = (SBYTE)MOUSE_REL_POS_REPORT;  /* current header */
+
+/*
+ * apply the acceleration curve to one axis of a packet
+ */
+static WORD mouse_accel(WORD d)
+{
+#if MOUSE_ACCEL_THRESHOLD > 0
+    if (d > MOUSE_ACCEL_THRESHOLD)
+        d += (d - MOUSE_ACCEL_THRESHOLD) * (MOUSE_ACCEL_FACTOR - 1);
+    else if (d < -MOUSE_ACCEL_THRESHOLD)
+        d += (d + MOUSE_ACCEL_THRESHOLD) * (MOUSE_ACCEL_FACTOR - 1);
+#endif
+
+    return d;
+}
+
+/*
+ * send the accumulated movement to mousevec (at least one packet)
+ *
+ * this must be called with the IKBD interrupt masked
+ */
+static void mouse_send(void)
+{
+    SBYTE packet[3];
+    WORD dx, dy;
+
+    do {
+        dx = max(-128, min(127, mouse_acc_dx));
+        dy = max(-128, min(127, mouse_acc_dy));
+        mouse_acc_dx -= dx;
+        mouse_acc_dy -= dy;
+        packet[0] = mouse_acc_hdr;
+        packet[1] = dx;
+        packet[2] = dy;
+        call_mousevec(packet);
+    } while (mouse_acc_dx || mouse_acc_dy);
+}
+
+/*
+ * handle a relative mouse packet from the IKBD
+ */
+void ikbd_rel_mouse(SBYTE *packet)
+{
+    if (kbdvecs.mousevec != (PFVOID)mouse_int)
+    {
+        call_mousevec(packet);
+        return;
+    }
+
+    if (packet[0] != mouse_acc_hdr)
+    {
+        /* the buttons changed: send the movement so far, then this packet */
+        if (mouse_acc_dx || mouse_acc_dy)
+            mouse_send();
+        mouse_acc_hdr = packet[0];
+        mouse_acc_dx = mouse_accel(packet[1]);
+        mouse_acc_dy = mouse_accel(packet[2]);
+        mouse_send();
+        return;
+    }
+
+    mouse_acc_dx += mouse_accel(packet[1]);
+    mouse_acc_dy += mouse_accel(packet[2]);
+}
+
+/*
+ * send the movement accumulated since the last VBL, if any
+ */
+void ikbd_mouse_vbl(void)
+{
+    WORD old_sr;
+
+    if (!mouse_acc_dx && !mouse_acc_dy)
+        return;
+
+    old_sr = set_sr(0x2700);
+    if (mouse_acc_dx || mouse_acc_dy)
+        mouse_send();
+    set_sr(old_sr);
+}
+#endif /* CONF_WITH_MOUSE_COALESCE */
+
+
 /*
  * emulated mouse support (alt-arrowkey support)
  */
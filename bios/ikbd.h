@@ -103,6 +103,13 @@ void kbd_int(UBYTE scancode);
 /* called by timer C int to handle key repeat */
 void kb_timerc_int(void);
 
+#if CONF_WITH_MOUSE_COALESCE
+/* called by aciavecs.S for each relative mouse packet */
+void ikbd_rel_mouse(SBYTE *packet);
+/* called by the VBL to deliver the accumulated mouse movement */
+void ikbd_mouse_vbl(void);
+#endif
+
 /* some bios functions */
 LONG bconstat2(void);
 LONG bconin2(void);
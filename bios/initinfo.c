@@ -29,6 +29,7 @@
 #include "tosvars.h"
 #include "machine.h"
 #include "processor.h"
+#include "has.h"
 #include "xbiosbind.h"
 #include "biosext.h"
 #include "version.h"
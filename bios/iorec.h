@@ -15,6 +15,15 @@
 
 /*==== Structs ============================================================*/
 
+/*
+ * The input buffers are single-producer (interrupt), single-consumer
+ * (task) rings, which need no interrupt masking:
+ *  - the producer stores the data at the new tail, then updates tail;
+ *  - the consumer reads the data at the new head, then updates head.
+ * Each index is written by one side only, with a single word store
+ * holding its final value, and the data accesses are made through
+ * volatile pointers so that the compiler keeps them in this order.
+ */
 typedef struct iorec IOREC;
 
 struct iorec {
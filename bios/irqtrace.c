@@ -0,0 +1,122 @@
+/*
+ * irqtrace.c - interrupt masking latency tracer
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * When CONF_WITH_IRQ_TRACE is set, set_sr() (see include/asm.h) and the
+ * AES disable_interrupts()/enable_interrupts() go through
+ * irq_trace_set_sr_at(), which times each window during which the MFP
+ * interrupts are masked.  Changes of the mask by rte or by assembler
+ * code are not seen, so a window opened by set_sr() and closed that way
+ * is only closed by the next unmasking set_sr().
+ */
+
+#include "emutos.h"
+#include "biosdefs.h"
+#include "biosext.h"
+#include "irqtrace.h"
+#include "tosvars.h"
+#include "mfp.h"
+#include "asm.h"
+
+#if CONF_WITH_IRQ_TRACE
+
+#define MASKED(sr)  (((sr) & 0x0700) >= 0x0600)
+
+IRQ_TRACE irq_trace;
+
+static ULONG now(void)
+{
+#if CONF_WITH_HIRES_CLOCK
+    return hires_clock();
+#else
+    return hz_200 * (1000000UL / CLOCKS_PER_SEC);
+#endif
+}
+
+/*
+ * insert a window in the sorted table, if it is long enough
+ */
+static void record_window(ULONG usec, const void *restore_pc)
+{
+    WORD i;
+
+    irq_trace.windows++;
+    irq_trace.total += usec;
+
+    i = irq_trace.count;
+    if (i >= IRQ_TRACE_MAX)
+    {
+        if (usec <= irq_trace.window[IRQ_TRACE_MAX-1].usec)
+            return;
+        i = IRQ_TRACE_MAX - 1;
+    }
+    else
+        irq_trace.count = i + 1;
+
+    for ( ; (i > 0) && (irq_trace.window[i-1].usec < usec); i--)
+        irq_trace.window[i] = irq_trace.window[i-1];
+
+    irq_trace.window[i].usec = usec;
+    irq_trace.window[i].raise_pc = irq_trace.start_pc;
+    irq_trace.window[i].restore_pc = restore_pc;
+}
+
+/*
+ * set sr, return the old value, and time the window if the interrupts
+ * are masked or unmasked; 'pc' identifies the caller
+ *
+ * the clock is read with the interrupts masked, so that the time of
+ * the window itself (and the nested set_sr() calls of hires_clock())
+ * are not disturbed
+ */
+WORD irq_trace_set_sr_at(WORD sr, const void *pc)
+{
+    WORD old_sr = set_sr_untraced(0x2700);
+
+    if (MASKED(old_sr))
+    {
+        if (!MASKED(sr) && irq_trace.active)
+        {
+            irq_trace.active = FALSE;
+            record_window(now() - irq_trace.start, pc);
+        }
+    }
+    else if (MASKED(sr))
+    {
+        irq_trace.active = TRUE;
+        irq_trace.start_pc = pc;
+        irq_trace.start = now();
+    }
+
+    set_sr_untraced(sr);
+
+    return old_sr;
+}
+
+WORD irq_trace_set_sr(WORD sr)
+{
+    return irq_trace_set_sr_at(sr, __builtin_return_address(0));
+}
+
+/*
+ * output the longest windows recorded so far to the debugger
+ */
+void irq_trace_dump(void)
+{
+    WORD i;
+
+    KINFO(("irq: %lu windows, %lu us masked\n", irq_trace.windows, irq_trace.total));
+    for (i = 0; i < irq_trace.count; i++)
+    {
+        KINFO(("irq: %8lu us  masked at %p, unmasked at %p\n", irq_trace.window[i].usec,
+            irq_trace.window[i].raise_pc, irq_trace.window[i].restore_pc));
+    }
+}
+
+#endif /* CONF_WITH_IRQ_TRACE */
@@ -0,0 +1,49 @@
+/*
+ * irqtrace.h - interrupt masking latency tracer
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+#ifndef IRQTRACE_H
+#define IRQTRACE_H
+
+#if CONF_WITH_IRQ_TRACE
+
+#define IRQ_TRACE_MAX       16  /* number of longest windows kept */
+
+/*
+ * the ETIL cookie points to this structure.  a window starts when the
+ * interrupt mask is raised to the MFP level (6) or above, and ends when
+ * it is lowered below it again.  'window' lists the longest windows,
+ * longest first; a debugger may clear 'count' (in supervisor mode, with
+ * interrupts masked) to start a new measurement.
+ */
+typedef struct
+{
+    WORD count;                 /* number of entries in window[] */
+    WORD active;                /* TRUE while a window is open */
+    ULONG windows;              /* number of windows since the last reset */
+    ULONG total;                /* total time in microseconds */
+    ULONG start;                /* start time of the open window */
+    const void *start_pc;       /* caller which opened it */
+    struct
+    {
+        ULONG usec;             /* length of the window */
+        const void *raise_pc;   /* caller which masked the interrupts */
+        const void *restore_pc; /* caller which unmasked them */
+    } window[IRQ_TRACE_MAX];
+} IRQ_TRACE;
+
+extern IRQ_TRACE irq_trace;
+
+/*
+ * irq_trace_set_sr() is declared in include/asm.h, where it replaces set_sr();
+ * irq_trace_set_sr_at() and irq_trace_dump() are declared in include/biosext.h
+ */
+
+#endif /* CONF_WITH_IRQ_TRACE */
+
+#endif /* IRQTRACE_H */
@@ -42,6 +42,9 @@
 #include "nova.h"
 #include "biosext.h"
 #include "amiga.h"
+#include "bootprof.h"
+#include "irqtrace.h"
+#include "warmcache.h"
 
 #if CONF_WITH_ADVANCED_CPU
 UBYTE is_bus32; /* 1 if address bus is 32-bit, 0 if it is 24-bit */
@@ -598,6 +601,11 @@ void machine_detect(void)
     detect_blitter();
 #endif
 
+#if CONF_WITH_WARM_CACHE
+    if (warm_cache_valid)
+        detected_busses = warm_cache.detected_busses;
+    else
+#endif
     detected_busses = check_busses();
     KDEBUG(("detected_busses = 0x%04x\n", detected_busses));
 
@@ -790,6 +798,14 @@ void fill_cookie_jar(void)
     cookie_add(COOKIE_SCSIDRIV, (ULONG)&scsidriv_root);
 #endif
 
+#if CONF_WITH_BOOT_PROFILE
+    cookie_add(COOKIE_ETBP, (ULONG)&boot_profile);
+#endif
+
+#if CONF_WITH_IRQ_TRACE
+    cookie_add(COOKIE_ETIL, (ULONG)&irq_trace);
+#endif
+
 #if !CONF_WITH_MFP
     /* Set the _5MS cookie with the address of the 200 Hz system timer
      * interrupt vector so FreeMiNT can hook it. */
@@ -33,6 +33,17 @@
 
 void ttram_detect(void);
 
+#if CONF_WITH_ROM_SHADOW
+
+/* Size of the ROM copy in TT-RAM, and of the ROM address range it replaces */
+#define ROM_SHADOW_SIZE (1024UL*1024)
+#define ROM_SHADOW_CHUNK (64UL*1024)   /* unit of ROM presence checking */
+
+void rom_shadow_init(void);
+extern UBYTE *rom_shadow;   /* copy of the ROM in TT-RAM, or NULL */
+
+#endif /* CONF_WITH_ROM_SHADOW */
+
 #if CONF_WITH_ALT_RAM
 
 void altram_init(void);
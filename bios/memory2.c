@@ -25,6 +25,9 @@
 #include "../bdos/bdosstub.h"
 #include "amiga.h"
 #include "string.h"
+#include "processor.h"
+#include "natfeat.h"
+#include "ramdisk.h"
 
 #define ZONECOUNT   32      /* for memory test */
 
@@ -120,6 +123,94 @@ void ttram_detect(void)
     KDEBUG(("ttram_detect(): ramtop=%p\n", ramtop));
 }
 
+#if CONF_WITH_ROM_SHADOW
+
+UBYTE *rom_shadow;
+
+#define TOS_ROM_START ((UBYTE *)0x00e00000)
+
+#if CONF_WITH_68030_PMMU
+void pmmu030_map_rom(UBYTE *copy);  /* in pmmu030.c */
+#endif
+
+/*
+ * Copy the ROM to the last megabyte of TT-RAM, and map the ROM address
+ * range onto that copy.  The copy is reserved by lowering ramtop, so that
+ * neither the BDOS nor programs which use _ramtop can overwrite it.  This
+ * must be called after ttram_detect(), and before altram_init().
+ *
+ * On a 68030, the PMMU tree has already been set up by processor_init()
+ * and is updated here.  On a 68040, the copy is used when the PMMU tree
+ * is set up later by setup_68040_pmmu().
+ */
+void rom_shadow_init(void)
+{
+    BOOL has_pmmu = FALSE;
+    ULONG offset;
+
+    rom_shadow = NULL;
+
+    /* only when running from the TOS ROM */
+    if (_text != TOS_ROM_START)
+        return;
+    if (ramtop == NULL)
+        return;
+
+#if CONF_WITH_BUS_ERROR
+    /*
+     * after a warm reset, ramtop has been kept from the previous boot, so
+     * the previous copy of this ROM is just above it: take back its megabyte
+     * rather than losing another one
+     */
+    if (check_read_byte((long)ramtop)
+     && (memcmp(ramtop, TOS_ROM_START, sizeof(OSHEADER)) == 0))
+        ramtop += ROM_SHADOW_SIZE;
+#endif
+
+    /* only with enough TT-RAM left */
+    if ((ULONG)(ramtop - TTRAM_START) < 2 * ROM_SHADOW_SIZE)
+        return;
+
+#if CONF_WITH_68030_PMMU
+    if ((mcpu == 30) && !mcpu_subtype)
+        has_pmmu = TRUE;
+#endif
+#if CONF_WITH_68040_PMMU
+    if ((mcpu == 40) && mmu_is_emulated())
+        has_pmmu = TRUE;
+#endif
+    if (!has_pmmu)
+        return;
+
+    rom_shadow = ramtop - ROM_SHADOW_SIZE;  /* megabyte-aligned */
+    ramtop = rom_shadow;
+
+    /*
+     * copy the whole range that is mapped, not just EmuTOS itself.  with
+     * smaller ROMs, the unused part of the range may cause bus errors:
+     * it reads as 0xff in the copy.
+     */
+    for (offset = 0; offset < ROM_SHADOW_SIZE; offset += ROM_SHADOW_CHUNK)
+    {
+#if CONF_WITH_BUS_ERROR
+        if (!check_read_byte((long)(TOS_ROM_START + offset)))
+        {
+            memset(rom_shadow + offset, 0xff, ROM_SHADOW_CHUNK);
+            continue;
+        }
+#endif
+        memcpy(rom_shadow + offset, TOS_ROM_START + offset, ROM_SHADOW_CHUNK);
+    }
+    KDEBUG(("rom_shadow_init(): ROM copied to %p, ramtop=%p\n", rom_shadow, ramtop));
+
+#if CONF_WITH_68030_PMMU
+    if (mcpu == 30)
+        pmmu030_map_rom(rom_shadow);
+#endif
+}
+
+#endif /* CONF_WITH_ROM_SHADOW */
+
 #if CONF_WITH_ALT_RAM
 
 /* Initialize all Alt-RAM */
@@ -135,7 +226,14 @@ void altram_init(void)
 #if CONF_WITH_TTRAM
     /* Add eventual TT-RAM to BDOS pool */
     if (ramtop != NULL)
-        xmaddalt(TTRAM_START, ramtop - TTRAM_START);
+    {
+        UBYTE *top = ramtop;
+#if CONF_WITH_RAMDISK
+        if (ramdisk_mem)
+            top = ramdisk_mem;  /* keep the RAM disk for ourselves */
+#endif
+        xmaddalt(TTRAM_START, top - TTRAM_START);
+    }
 #endif
 
 #if CONF_WITH_MONSTER
@@ -285,20 +383,26 @@ static void end_line(LONG memsize)
 static BOOL testtype(BOOL is_ttram, LONG memsize)
 {
     UBYTE *testaddr, *startaddr;
-    LONG zonesize;
+    LONG zonesize, testsize;
     WORD i;
-    BOOL ok;
+    BOOL ok, dotest;
 
     init_line(is_ttram);
     startaddr = is_ttram ? TTRAM_START : (UBYTE *)0L;
     zonesize = (memsize / ZONECOUNT);
+    testsize = zonesize;
+#if CONF_MEMTEST_SAMPLE_SIZE
+    if (testsize > CONF_MEMTEST_SAMPLE_SIZE)
+        testsize = CONF_MEMTEST_SAMPLE_SIZE;
+#endif
     for (i = 0, testaddr = startaddr; i < ZONECOUNT; i++, testaddr += zonesize)
     {
         ok = TRUE;
         /* we skip testing areas in use by the system! */
-        if (is_ttram
-         || ((testaddr >= membot) && (testaddr+zonesize <= memtop)))
-            ok = testzone(testaddr, zonesize);
+        dotest = is_ttram
+              || ((testaddr >= membot) && (testaddr+testsize <= memtop));
+        if (dotest)
+            ok = testzone(testaddr, testsize);
         cprintf(ok?"-":"X");
         if (bconstat(2))    /* abort */
         {
@@ -19,6 +19,7 @@
 #include "vectors.h"
 #include "coldfire.h"
 #include "lisa.h"
+#include "asm.h"
 
 #if CONF_WITH_MFP || CONF_WITH_TT_MFP
 
@@ -210,3 +211,51 @@ void init_system_timer(void)
 
     /* The timer will really be enabled when sr is set to 0x2500 or lower. */
 }
+
+#if CONF_WITH_HIRES_CLOCK
+/*
+ * return a monotonic clock in microseconds, which wraps around after
+ * about 71 minutes.  the 200 Hz tick count is refined with the time
+ * elapsed since the last tick, read from the hardware timer:
+ *  . on the MFP, timer C counts down from 192 at 38400 Hz, so the
+ *    resolution is about 26 microseconds
+ *  . on ColdFire, a free-running slice timer is used
+ *  . elsewhere, only the 200 Hz resolution is available
+ */
+ULONG hires_clock(void)
+{
+    ULONG ticks, usec;
+    WORD old_sr;
+
+    /* disable interrupts */
+    old_sr = set_sr(0x2700);
+
+    ticks = hz_200;
+#if CONF_COLDFIRE_TIMER_C
+    usec = coldfire_usec_since_tick();
+#elif defined(MACHINE_LISA)
+    usec = 0;
+#elif CONF_WITH_MFP
+    {
+        MFP *mfp = MFP_BASE;
+        UBYTE count = mfp->tcdr;
+
+        usec = ((ULONG)(192 - count) * 625UL) / 24;
+
+        /*
+         * if the counter has just been reloaded, but the interrupt has
+         * not been serviced yet, hz_200 is one tick behind
+         */
+        if ((mfp->iprb & 0x20) && (count > 96))
+            ticks++;
+    }
+#else
+    usec = 0;
+#endif
+
+    /* restore interrupts */
+    set_sr(old_sr);
+
+    return ticks * 5000UL + usec;
+}
+#endif
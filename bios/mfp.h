@@ -115,4 +115,9 @@ void init_system_timer(void);
 /* "sieve" to get only the fourth interrupt, 0x1111 initially */
 extern WORD timer_c_sieve;
 
+#if CONF_WITH_HIRES_CLOCK
+/* microseconds since the system timer was started (Hrclock) */
+ULONG hires_clock(void);
+#endif
+
 #endif /* MFP_H */
@@ -17,6 +17,48 @@
 #include "asm.h"
 #include "midi.h"
 
+#if CONF_WITH_MIDI_QUEUES
+/*
+ * MIDI output queue, emptied by the ACIA transmit interrupt
+ */
+#define MIDI_OBUFSIZE   MIDI_IOREC_SIZE
+
+#define MIDI_ACIA_CTRL  (ACIA_RIE|ACIA_DIV16|ACIA_D8N1S)
+
+static UBYTE midi_obuf[MIDI_OBUFSIZE];
+static volatile WORD midi_ohead, midi_otail;
+static BOOL midi_txint;     /* TRUE iff ACIA transmit interrupt is enabled */
+
+static WORD midi_next(WORD index)
+{
+    if (++index >= MIDI_OBUFSIZE)
+        index = 0;
+
+    return index;
+}
+
+/*
+ * called from the MIDI ACIA interrupt handler, at interrupt level 6
+ */
+void midi_tx_interrupt(void)
+{
+    if (!(midi_acia.ctrl & ACIA_TDRE))
+        return;
+
+    if (midi_ohead == midi_otail) {
+        /* nothing more to send: stop the interrupts */
+        if (midi_txint) {
+            midi_acia.ctrl = MIDI_ACIA_CTRL|ACIA_RLTID;
+            midi_txint = FALSE;
+        }
+        return;
+    }
+
+    midi_acia.data = midi_obuf[midi_ohead];
+    midi_ohead = midi_next(midi_ohead);
+}
+#endif
+
 
 /*==== MIDI bios functions =========================================*/
 
@@ -39,21 +81,18 @@ LONG bconin3(void)
 
 #if CONF_WITH_MIDI_ACIA
     {
-        WORD old_sr;
+        WORD head;
         LONG value;
 
-        /* disable interrupts */
-        old_sr = set_sr(0x2700);
-
-        midiiorec.head++;
-        if (midiiorec.head >= midiiorec.size)
+        head = midiiorec.head + 1;
+        if (head >= midiiorec.size)
         {
-            midiiorec.head = 0;
+            head = 0;
         }
-        value = *(UBYTE *)(midiiorec.buf+midiiorec.head);
+        value = *(volatile UBYTE *)(midiiorec.buf+head);
 
-        /* restore interrupts */
-        set_sr(old_sr);
+        /* free the slot only once it has been read (see iorec.h) */
+        midiiorec.head = head;
         return value;
     }
 #else
@@ -65,7 +104,10 @@ LONG bconin3(void)
 /* can we send a byte to the MIDI ACIA ? */
 LONG bcostat3(void)
 {
-#if CONF_WITH_MIDI_ACIA
+#if CONF_WITH_MIDI_QUEUES
+    /* OK if there's space in the queue */
+    return (midi_next(midi_otail) == midi_ohead) ? 0 : -1;
+#elif CONF_WITH_MIDI_ACIA
     if (midi_acia.ctrl & ACIA_TDRE)
     {
         return -1;  /* OK */
@@ -86,7 +128,33 @@ LONG bconout3(WORD dev, WORD c)
     while(!bcostat3())
         ;
 
-#if CONF_WITH_MIDI_ACIA
+#if CONF_WITH_MIDI_QUEUES
+    {
+        WORD old_sr;
+
+        /* disable interrupts */
+        old_sr = set_sr(0x2700);
+
+        /*
+         * If the queue is empty & the ACIA is ready, output directly.
+         * otherwise queue the data and let the interrupt send it.
+         */
+        if ((midi_ohead == midi_otail) && (midi_acia.ctrl & ACIA_TDRE)) {
+            midi_acia.data = c;
+        } else {
+            midi_obuf[midi_otail] = (UBYTE)c;
+            midi_otail = midi_next(midi_otail);
+            if (!midi_txint) {
+                midi_acia.ctrl = MIDI_ACIA_CTRL|ACIA_RLTIE;
+                midi_txint = TRUE;
+            }
+        }
+
+        /* restore interrupts */
+        set_sr(old_sr);
+    }
+    return 1L;
+#elif CONF_WITH_MIDI_ACIA
     midi_acia.data = c;
     return 1L;
 #else
@@ -120,6 +188,11 @@ void midi_init(void)
     /* initialize midi ACIA */
     midi_acia.ctrl = ACIA_RESET;    /* master reset */
 
+#if CONF_WITH_MIDI_QUEUES
+    midi_ohead = midi_otail = 0;
+    midi_txint = FALSE;
+#endif
+
     midi_acia.ctrl = ACIA_RIE|      /* enable RxINT */
                      ACIA_RLTID|    /* RTS low, TxINT disabled */
                      ACIA_DIV16|    /* clock/16 */
@@ -22,6 +22,11 @@ LONG bconin3(void);
 LONG bcostat3(void);
 LONG bconout3(WORD dev, WORD c);
 
+#if CONF_WITH_MIDI_QUEUES
+/* called by the MIDI ACIA interrupt handler */
+void midi_tx_interrupt(void);
+#endif
+
 /* some xbios functions */
 void midiws(WORD cnt, const UBYTE *ptr);
 
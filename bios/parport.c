@@ -20,11 +20,16 @@
 #include "psg.h"
 #include "ikbd.h"
 #include "tosvars.h"
+#include "vectors.h"
+#include "hardcopy.h"
 #endif
 
 /*
  * known differences with respect to the original TOS:
- * - printer hardcopy is not done
+ * - printer hardcopy is done in the background (see hardcopy.c), and only
+ *   if CONF_WITH_HARDCOPY is set
+ * - if CONF_WITH_PRINTER_SPOOL is set, output is queued and sent by the
+ *   BUSY interrupt rather than by polling
  * - no input
  */
 
@@ -42,6 +47,30 @@ static WORD printer_config;
 static ULONG last_timeout;
 #endif
 
+#if CONF_WITH_PRINTER_QUEUE
+/*
+ * output queue, drained by the BUSY interrupt: each time the printer
+ * becomes ready (BUSY goes low), the next byte is sent
+ */
+#define MFP_BUSY        0           /* MFP interrupt number of BUSY */
+#define QUEUE_SIZE      1024        /* must be a power of 2 */
+static UBYTE queue[QUEUE_SIZE];
+static volatile UWORD queue_head;   /* next byte to send */
+static volatile UWORD queue_tail;   /* next free slot */
+static volatile BOOL queue_sending; /* a byte has been sent, waiting for BUSY */
+static volatile ULONG queue_stamp;  /* hz_200 when the last byte was sent */
+#endif
+
+#if CONF_WITH_PRINTER_SPOOL
+/*
+ * once the queue reaches the high water mark, Bcostat() reports the
+ * printer as busy until the queue has drained to the low water mark
+ */
+#define SPOOL_HIGH_WATER    (QUEUE_SIZE - QUEUE_SIZE / 8)
+#define SPOOL_LOW_WATER     (QUEUE_SIZE / 4)
+static BOOL spool_full;
+#endif
+
 #if CONF_WITH_PRINTER_PORT
 /*
  * implements xbios_21 - Set/get the desktop printer configuration word
@@ -105,6 +134,105 @@ static LONG prnout(WORD c)
 }
 #endif
 
+#if CONF_WITH_PRINTER_QUEUE
+/*
+ * send the next queued byte, if any: called with interrupts disabled,
+ * or from the BUSY interrupt
+ */
+static void queue_send_next(void)
+{
+    if (queue_head == queue_tail)
+    {
+        queue_sending = FALSE;
+        jdisint(MFP_BUSY);
+        return;
+    }
+
+    queue_sending = TRUE;
+    queue_stamp = hz_200;
+    prnout(queue[queue_head]);
+    queue_head = (queue_head + 1) & (QUEUE_SIZE - 1);
+}
+
+void parport_busy_interrupt_handler(void)
+{
+    queue_send_next();
+
+    /* clear the interrupt service bit (bit 0) */
+    MFP_BASE->isrb = 0xfe;
+}
+
+/*
+ * return the number of bytes which can be queued
+ */
+WORD parport_queue_free(void)
+{
+    return (queue_head - queue_tail - 1) & (QUEUE_SIZE - 1);
+}
+
+/*
+ * queue bytes for output: the caller must have checked that there is
+ * enough room, using parport_queue_free()
+ */
+void parport_queue(const UBYTE *buf, WORD count)
+{
+    WORD old_sr;
+
+    while (count-- > 0)
+    {
+        queue[queue_tail] = *buf++;
+        queue_tail = (queue_tail + 1) & (QUEUE_SIZE - 1);
+    }
+
+    /*
+     * if nothing is being sent, start the transfer; if the printer
+     * is not ready yet, the BUSY interrupt will do it
+     */
+    old_sr = set_sr(0x2700);
+    if (!queue_sending)
+    {
+        queue_stamp = hz_200;   /* start timing from now */
+        mfpint(MFP_BUSY, (LONG)parport_busy_interrupt);
+        if (!(MFP_BASE->gpip & 1))
+            queue_send_next();
+    }
+    set_sr(old_sr);
+}
+
+/*
+ * return TRUE if all the queued bytes have been sent
+ */
+BOOL parport_queue_empty(void)
+{
+    return (queue_head == queue_tail) && !queue_sending;
+}
+
+/*
+ * return TRUE if queued bytes have been waiting for the printer too long
+ */
+BOOL parport_queue_stalled(void)
+{
+    if (queue_head == queue_tail)
+        return FALSE;
+
+    return (hz_200 - queue_stamp) > LONG_TIMEOUT;
+}
+
+/*
+ * discard the queued bytes
+ */
+void parport_queue_flush(void)
+{
+    WORD old_sr;
+
+    old_sr = set_sr(0x2700);
+    jdisint(MFP_BUSY);
+    queue_head = queue_tail;
+    queue_sending = FALSE;
+    set_sr(old_sr);
+}
+#endif
+
 void parport_init(void)
 {
 #if CONF_WITH_PRINTER_PORT
@@ -118,6 +246,13 @@ void parport_init(void)
     printer_config = 0;     /* Setprt() default: output via parallel port */
     last_timeout = 0UL;     /* parallel port: ticks value at last timeout */
 #endif
+#if CONF_WITH_PRINTER_QUEUE
+    queue_head = queue_tail = 0;
+    queue_sending = FALSE;
+#endif
+#if CONF_WITH_PRINTER_SPOOL
+    spool_full = FALSE;
+#endif
 }
 
 LONG bconin0(void)
@@ -131,6 +266,25 @@ LONG bcostat0(void)
 #if CONF_WITH_PRINTER_PORT
     MFP *mfp=MFP_BASE;
 
+#if CONF_WITH_HARDCOPY
+    if (hardcopy_busy())
+        return 0;   /* hardcopy in progress */
+#endif
+
+#if CONF_WITH_PRINTER_SPOOL
+    {
+        WORD used = QUEUE_SIZE - 1 - parport_queue_free();
+
+        if (used >= SPOOL_HIGH_WATER)
+            spool_full = TRUE;
+        else if (used <= SPOOL_LOW_WATER)
+            spool_full = FALSE;
+
+        UNUSED(mfp);
+        return spool_full ? 0 : -1;
+    }
+#endif
+
     if(mfp->gpip & 1) {
         return 0;   /* busy high: printer not available */
     } else {
@@ -159,7 +313,16 @@ LONG bconout0(WORD dev, WORD c)
         while(hz_200 < (now+LONG_TIMEOUT))
         {
             if (bcostat0())
+            {
+#if CONF_WITH_PRINTER_SPOOL
+                UBYTE b = (UBYTE)c;
+
+                parport_queue(&b, 1);
+                return 1L;
+#else
                 return prnout(c);
+#endif
+            }
             if (bconstat2())
                 if ((bconin2() & 0xff) == CTL_C)
                     break;
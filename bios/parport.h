@@ -19,3 +19,12 @@ void parport_init(void);
 #if CONF_WITH_PRINTER_PORT
 WORD setprt(WORD config);
 #endif
+
+#if CONF_WITH_PRINTER_QUEUE
+void parport_busy_interrupt_handler(void);
+WORD parport_queue_free(void);
+void parport_queue(const UBYTE *buf, WORD count);
+BOOL parport_queue_empty(void);
+BOOL parport_queue_stalled(void);
+void parport_queue_flush(void);
+#endif
@@ -1,7 +1,7 @@
 /*
  * pmmu030.c - initialisation for 68030 PMMU
  *
- * Copyright (C) 2013-2022 The EmuTOS development team
+ * Copyright (C) 2013-2026 The EmuTOS development team
  *
  * Authors:
  *  RFB    Roger Burrows
@@ -29,6 +29,7 @@ struct pmmutable
  */
 #define PMMU_FLAGS_PD   0x01        /* short-format page descriptor */
 #define PMMU_FLAGS_TD   0x02        /* short-format table descriptor */
+#define PMMU_FLAGS_WP   0x04        /* write protect */
 #define PMMU_FLAGS_CI   0x40        /* cache inhibit (page descriptors only) */
 
 
@@ -151,4 +152,23 @@ void setup_68030_pmmu(void)
 {
     memcpy(&pmmutree, &mmutable_rom, sizeof mmutable_rom);
 }
+
+#if CONF_WITH_ROM_SHADOW
+void pmmu030_map_rom(UBYTE *copy);  /* called only from memory2.c */
+
+/*
+ * Map 0x??e00000-0x??efffff (?? = 00 or ff) onto the copy of the ROM
+ * in TT-RAM, write-protected, allow caching.  'copy' must be aligned
+ * on a megabyte boundary.
+ */
+void pmmu030_map_rom(UBYTE *copy)
+{
+    pmmutree.tic[14] = PMMU_SF_PAGE(copy) | PMMU_FLAGS_WP;
+    __asm__ volatile
+    (
+        ".dc.l 0xf0002400"      /* pflusha (68030) */
+        : : : "memory"
+    );
+}
+#endif /* CONF_WITH_ROM_SHADOW */
 #endif /* CONF_WITH_68030_PMMU */
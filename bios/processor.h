@@ -90,11 +90,8 @@ void processor_init(void);
  */
 void instruction_cache_kludge(void *start,long size);
 extern ULONG mcpu;
+extern UWORD mcpu_subtype;
 extern ULONG fputype;
 extern WORD longframe;
 
-#if CONF_WITH_APOLLO_68080
-extern BOOL is_apollo_68080;
-#endif
-
 #endif /* PROCESSOR_H */
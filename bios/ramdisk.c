@@ -0,0 +1,208 @@
+/*
+ * ramdisk.c - RAM disk driver
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * The RAM disk occupies RAMDISK_SIZE kilobytes at the top of TT-RAM
+ * (below the ROM copy, if any), which are withheld from the BDOS by
+ * altram_init().  It is a single unit, device 0 of RAMDISK_BUS, with
+ * 512-byte sectors.  It is formatted as an unpartitioned FAT disk, so
+ * atari_partition() finds a single BGM partition on it.
+ *
+ * TT-RAM survives a warm boot; if the RAM disk is found unchanged in
+ * size, its contents are kept.
+ */
+
+/* #define ENABLE_KDEBUG */
+
+#include "emutos.h"
+#include "gemerror.h"
+#include "disk.h"
+#include "blkdev.h"
+#include "tosvars.h"
+#include "string.h"
+#include "ramdisk.h"
+
+#if CONF_WITH_RAMDISK
+
+#define RAMDISK_SECTORS ((RAMDISK_SIZE * 1024UL) / SECTOR_SIZE)
+#define ROOT_ENTRIES    256
+#define ROOT_SECTORS    ((ROOT_ENTRIES * 32) / SECTOR_SIZE)
+
+UBYTE *ramdisk_mem;
+
+static const UBYTE oem_name[6] = { 'E', 'm', 'u', 'R', 'A', 'M' };
+
+
+static void setiword(UBYTE *p, UWORD val)
+{
+    p[0] = LOBYTE(val);
+    p[1] = HIBYTE(val);
+}
+
+
+/*
+ * check if the RAM disk already holds a filesystem that we created
+ */
+static BOOL ramdisk_formatted(void)
+{
+    const struct fat16_bs *bs = (const struct fat16_bs *)ramdisk_mem;
+
+    if (memcmp(bs->loader, oem_name, sizeof(oem_name)) != 0)
+        return FALSE;
+    if (MAKE_UWORD(bs->cksum[0], bs->cksum[1]) != 0x55aa)
+        return FALSE;
+
+    return MAKE_ULONG(MAKE_UWORD(bs->sec2[3], bs->sec2[2]),
+                      MAKE_UWORD(bs->sec2[1], bs->sec2[0])) == RAMDISK_SECTORS;
+}
+
+
+/*
+ * create an empty FAT12/FAT16 filesystem, with 2 FATs and the smallest
+ * cluster size that keeps the cluster count within FAT16 limits
+ */
+static void ramdisk_format(void)
+{
+    struct fat16_bs *bs = (struct fat16_bs *)ramdisk_mem;
+    ULONG numcl, fatbytes;
+    UWORD spc, spf;
+    WORD i;
+    BOOL fat16;
+
+    for (spc = 1; ; spc <<= 1)
+    {
+        numcl = (RAMDISK_SECTORS - 1 - ROOT_SECTORS) / spc;
+        if ((numcl <= MAX_FAT16_CLUSTERS) || (spc >= MAX_SECS_PER_CLUS))
+            break;
+    }
+    fat16 = (numcl > MAX_FAT12_CLUSTERS);
+    fatbytes = fat16 ? (numcl + 2) * 2 : ((numcl + 2) * 3 + 1) / 2;
+    spf = (fatbytes + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+    /* boot sector, FATs and root directory */
+    bzero(ramdisk_mem, (ULONG)(1 + 2*spf + ROOT_SECTORS) * SECTOR_SIZE);
+
+    bs->bra[0] = 0xe9;          /* not bootable (no 0x1234 checksum) */
+    memcpy(bs->loader, oem_name, sizeof(oem_name));
+    setiword(bs->bps, SECTOR_SIZE);
+    bs->spc = spc;
+    setiword(bs->res, 1);
+    bs->fat = 2;
+    setiword(bs->dir, ROOT_ENTRIES);
+    bs->media = 0xf8;
+    setiword(bs->spf, spf);
+    setiword(bs->spt, 1);
+    setiword(bs->sides, 1);
+    setiword(bs->sec2, LOWORD(RAMDISK_SECTORS));
+    setiword(bs->sec2+2, HIWORD(RAMDISK_SECTORS));
+    bs->ext = 0x29;
+    memcpy(bs->label, "RAMDISK    ", sizeof(bs->label));
+    memcpy(bs->fstype, fat16 ? "FAT16   " : "FAT12   ", sizeof(bs->fstype));
+    bs->cksum[0] = 0x55;
+    bs->cksum[1] = 0xaa;
+
+    /* media byte & end-of-chain marker in the reserved FAT entries */
+    for (i = 0; i < 2; i++)
+    {
+        UBYTE *fat = ramdisk_mem + (ULONG)(1 + i*spf) * SECTOR_SIZE;
+
+        fat[0] = 0xf8;
+        fat[1] = 0xff;
+        fat[2] = 0xff;
+        if (fat16)
+            fat[3] = 0xff;
+    }
+
+    KDEBUG(("ramdisk_format(): %lu clusters of %u sectors, %u sectors per FAT\n",
+            numcl, spc, spf));
+}
+
+
+/*
+ * reserve the RAM disk memory, and format it unless it is still valid
+ *
+ * this must be called before altram_init()
+ */
+void ramdisk_init(void)
+{
+    UBYTE *top = ramtop;
+
+    ramdisk_mem = NULL;
+
+    if (top == NULL)
+        return;
+    if ((ULONG)(top - TTRAM_START) < 2 * RAMDISK_SECTORS * SECTOR_SIZE)
+        return;
+
+    ramdisk_mem = top - RAMDISK_SECTORS * SECTOR_SIZE;
+
+    if (ramdisk_formatted())
+        KDEBUG(("ramdisk_init(): keeping RAM disk at %p\n", ramdisk_mem));
+    else
+        ramdisk_format();
+}
+
+
+LONG ramdisk_ioctl(UWORD dev, UWORD ctrl, void *arg)
+{
+    ULONG *info = arg;
+
+    if (dev || !ramdisk_mem)
+        return EUNDEV;
+
+    switch(ctrl) {
+    case GET_DISKINFO:
+        info[0] = RAMDISK_SECTORS;
+        info[1] = SECTOR_SIZE;
+        break;
+    case GET_DISKNAME:
+        strcpy(arg, "EmuTOS RAM disk");
+        break;
+    case GET_MEDIACHANGE:
+        return MEDIANOCHANGE;
+    default:
+        return ERR;
+    }
+
+    return E_OK;
+}
+
+
+LONG ramdisk_rw(WORD rw, ULONG sector, WORD count, UBYTE *buf, WORD dev)
+{
+    UBYTE *p;
+
+    if ((sector >= RAMDISK_SECTORS) || (count > RAMDISK_SECTORS - sector))
+        return ESECNF;
+
+    p = ramdisk_address(dev, sector);
+    if (!p)
+        return EUNDEV;
+
+    if (rw & RW_WRITE)
+        memcpy(p, buf, (ULONG)count * SECTOR_SIZE);
+    else
+        memcpy(buf, p, (ULONG)count * SECTOR_SIZE);
+
+    return E_OK;
+}
+
+
+/*
+ * return the address of a sector, or NULL if it does not exist
+ */
+UBYTE *ramdisk_address(WORD dev, ULONG sector)
+{
+    if (dev || !ramdisk_mem || (sector >= RAMDISK_SECTORS))
+        return NULL;
+
+    return ramdisk_mem + sector * SECTOR_SIZE;
+}
+
+#endif /* CONF_WITH_RAMDISK */
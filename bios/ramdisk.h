@@ -0,0 +1,25 @@
+/*
+ * ramdisk.h - RAM disk driver
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+#ifndef RAMDISK_H
+#define RAMDISK_H
+
+#if CONF_WITH_RAMDISK
+
+extern UBYTE *ramdisk_mem;      /* start of the RAM disk, or NULL */
+
+/* driver functions */
+void ramdisk_init(void);
+LONG ramdisk_ioctl(UWORD dev, UWORD ctrl, void *arg);
+LONG ramdisk_rw(WORD rw, ULONG sector, WORD count, UBYTE *buf, WORD dev);
+UBYTE *ramdisk_address(WORD dev, ULONG sector);
+
+#endif /* CONF_WITH_RAMDISK */
+
+#endif /* RAMDISK_H */
@@ -35,6 +35,14 @@ typedef struct {
 #define SCC_RESET_TX_INT    0x28
 #define SCC_ERROR_RESET     0x30
 #define SCC_RESET_HIGH_IUS  0x38
+
+/*
+ * bits in RR0 (status) and WR5 (transmit control)
+ */
+#define SCC_RR0_RX_AVAIL    0x01
+#define SCC_RR0_TX_EMPTY    0x04
+#define SCC_RR0_CTS         0x20
+#define SCC_WR5_RTS         0x02
 #endif
 
 #endif  /* _SCC_H */
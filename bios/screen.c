@@ -817,7 +817,11 @@ void screen_get_current_mode_info(UWORD *planes, UWORD *hz_rez, UWORD *vt_rez)
 WORD get_palette(void)
 {
 #ifdef MACHINE_AMIGA
-    return 2;               /* we currently only support monochrome */
+#if CONF_WITH_AMIGA_PLANAR
+    if ((sshiftmod == ST_LOW) || (sshiftmod == ST_MEDIUM))
+        return 4096;
+#endif
+    return 2;               /* other modes are monochrome */
 #else
     WORD palette;
 
@@ -1214,6 +1218,84 @@ void vsync(void)
 #endif /* CONF_WITH_ATARI_VIDEO */
 }
 
+#if CONF_WITH_SCREEN_FLIP
+
+/*
+ * screen flip queue
+ *
+ * Vflip() adds screen addresses to a small queue, and the VBL interrupt
+ * handler makes the oldest one the physical screen.  since the video
+ * hardware only reloads its address counter at the start of a frame, the
+ * new screen is displayed in full from the next frame on, without tearing.
+ * each flip is numbered: applications can wait for the number returned
+ * by FLIP_SUBMIT to be reached by FLIP_COUNT (e.g. before drawing into
+ * the previous screen again), or install a callback which is called from
+ * the VBL interrupt after each flip, with the screen address and the flip
+ * number as LONG arguments.
+ *
+ * Vflip() is the only writer of flips_queued, and the VBL handler the only
+ * writer of flips_done, so no locking is needed.
+ */
+typedef void (*FLIPCALLBACK)(LONG addr, LONG count);
+
+static const UBYTE *flip_queue[FLIP_QUEUE_SIZE];
+static ULONG flips_queued;      /* number of flips submitted */
+static volatile ULONG flips_done;   /* number of flips performed */
+static FLIPCALLBACK flip_callback;
+
+LONG vflip(WORD mode, LONG arg)
+{
+    LONG ret;
+    WORD old_sr;
+
+    switch(mode) {
+    case FLIP_SUBMIT:
+#if CONF_WITH_NOVA
+        /* the Nova display is not driven by our VBL */
+        if (HAS_NOVA && rez_was_hacked)
+            return -1L;
+#endif
+        if ((flips_queued - flips_done) >= FLIP_QUEUE_SIZE)
+            return -1L;     /* queue is full */
+        flip_queue[flips_queued % FLIP_QUEUE_SIZE] = (const UBYTE *)arg;
+        return ++flips_queued;
+    case FLIP_COUNT:
+        return flips_done;
+    case FLIP_CALLBACK:
+        ret = (LONG)flip_callback;
+        flip_callback = (FLIPCALLBACK)arg;
+        return ret;
+    case FLIP_CANCEL:
+        old_sr = set_sr(0x2700);
+        ret = flips_queued - flips_done;
+        flips_queued = flips_done;
+        set_sr(old_sr);
+        return ret;
+    }
+
+    return -1L;
+}
+
+/*
+ * vflip_vbl(): called by VBL interrupt handler
+ */
+void vflip_vbl(void)
+{
+    const UBYTE *addr;
+
+    if (flips_done == flips_queued)
+        return;
+
+    addr = flip_queue[flips_done % FLIP_QUEUE_SIZE];
+    setphys(addr);
+    flips_done++;
+
+    if (flip_callback)
+        flip_callback((LONG)addr, flips_done);
+}
+
+#endif /* CONF_WITH_SCREEN_FLIP */
+
 #if CONF_WITH_ATARI_VIDEO
 /*
  * detect_monitor_change(): called by VBL interrupt handler
@@ -51,6 +51,8 @@ WORD egetpalette(WORD index,WORD count,UWORD *rgb);
 WORD esetgray(WORD mode);
 WORD esetsmear(WORD mode);
 
+#endif /* CONF_WITH_ATARI_VIDEO */
+
 /* palette color definitions */
 
 #define RGB_BLACK     0x0000            /* ST(e) palette */
@@ -87,8 +89,6 @@ WORD esetsmear(WORD mode);
 #define TTRGB_LTYELLOW  0x0ff9
 #define TTRGB_WHITE     0x0fff
 
-#endif /* CONF_WITH_ATARI_VIDEO */
-
 /* set screen address, mode, ... */
 void screen_init_address(void);
 void screen_init_mode(void);
@@ -104,4 +104,17 @@ void setpalette(const UWORD *palettePtr);
 WORD setcolor(WORD colorNum, WORD color);
 void vsync(void);
 
+#if CONF_WITH_SCREEN_FLIP
+/* Vflip() modes */
+#define FLIP_SUBMIT     0   /* queue screen address, return its flip number */
+#define FLIP_COUNT      1   /* return the number of flips done */
+#define FLIP_CALLBACK   2   /* set the routine called after each flip */
+#define FLIP_CANCEL     3   /* forget pending flips, return their count */
+
+#define FLIP_QUEUE_SIZE 4   /* max number of pending flips */
+
+LONG vflip(WORD mode, LONG arg);
+void vflip_vbl(void);
+#endif
+
 #endif /* SCREEN_H */
@@ -63,8 +63,12 @@
  */
 #define COMMAND_COMPLETE_MSG    0x00
 #define EXTENDED_MSG            0x01        /* i.e. multibyte */
+#define SAVE_POINTERS_MSG       0x02
+#define RESTORE_POINTERS_MSG    0x03
+#define DISCONNECT_MSG          0x04
 #define MESSAGE_REJECT_MSG      0x07
 #define IDENTIFY_MSG            0x80
+#define DISCPRIV_BIT            0x40        /* in IDENTIFY: target may disconnect */
 
 
 /*
@@ -989,18 +993,25 @@ static int handle_data_out(CMDINFO *info)
 
     if (info->mode & DMA_MODE)  /* doing DMA ? */
     {
+#if CONF_WITH_SCSI_DISCONNECT
+        if (info->dma_started)  /* can't resume a partial DMA transfer */
+            return PHASE_ERROR;
+        info->dma_started = 1;
+#endif
         init_data_out(info);
         return wait_dma_complete(timeout);
     }
 
     /* handle programmed i/o */
-    p = info->bufptr;
+    p = info->data_ptr;
     while(1)
     {
-        ret = send_byte(*p++, timeout);
+        ret = send_byte(*p, timeout);
         if (ret < 0)
             break;
+        p++;
     }
+    info->data_ptr = p;
     if (ret == PHASE_CHANGE)
         ret = 0;
     return ret;
@@ -1016,6 +1027,11 @@ static int handle_data_in(CMDINFO *info)
 
     if (info->mode & DMA_MODE)      /* doing DMA ? */
     {
+#if CONF_WITH_SCSI_DISCONNECT
+        if (info->dma_started)      /* can't resume a partial DMA transfer */
+            return PHASE_ERROR;
+        info->dma_started = 1;
+#endif
         init_data_in(info);
         ret = wait_dma_complete(timeout);
         if ((ret == 0) && (has_scsi == TT_SCSI))
@@ -1024,7 +1040,7 @@ static int handle_data_in(CMDINFO *info)
     }
 
     /* handle programmed i/o */
-    p = info->bufptr;
+    p = info->data_ptr;
     while(1)
     {
         ret = receive_byte(timeout);
@@ -1032,6 +1048,7 @@ static int handle_data_in(CMDINFO *info)
             break;
         *p++ = (UBYTE)ret;
     }
+    info->data_ptr = p;
     if (ret == PHASE_CHANGE)
         ret = 0;
     return ret;
@@ -1120,10 +1137,34 @@ static int handle_msg_out(CMDINFO *info)
     return ret;
 }
 
+#if CONF_WITH_SCSI_DISCONNECT
+/*
+ * check for the messages used by disconnection/reselection
+ */
+static BOOL is_disconnect_msg(UBYTE msgbyte)
+{
+    return (msgbyte == SAVE_POINTERS_MSG)
+        || (msgbyte == RESTORE_POINTERS_MSG)
+        || (msgbyte == DISCONNECT_MSG)
+        || (msgbyte & IDENTIFY_MSG);    /* sent by target after reselection */
+}
+
+/*
+ * restore the data pointer to the value saved by SAVE DATA POINTER
+ * (this is also implied by a reselection)
+ */
+static void restore_pointers(CMDINFO *info)
+{
+    info->data_ptr = info->saved_ptr;
+    info->dma_started = info->saved_dma_started;
+}
+#endif
+
 /*
  * handle MESSAGE IN phase
  *
- * we accept COMMAND COMPLETE, otherwise we force a subsequent MESSAGE OUT
+ * we accept COMMAND COMPLETE (plus the disconnection messages, if
+ * configured), otherwise we force a subsequent MESSAGE OUT
  */
 static int handle_msg_in(CMDINFO *info)
 {
@@ -1142,7 +1183,11 @@ static int handle_msg_in(CMDINFO *info)
 
     info->msg_in = msgbyte = get_data_reg();
     if ((msgbyte != COMMAND_COMPLETE_MSG)
-     && (msgbyte != MESSAGE_REJECT_MSG))
+     && (msgbyte != MESSAGE_REJECT_MSG)
+#if CONF_WITH_SCSI_DISCONNECT
+     && !is_disconnect_msg(msgbyte)
+#endif
+       )
     {
         or_icr_reg(0x02);       /* assert ATN to request MESSAGE OUT phase */
         info->next_msg_out = MESSAGE_REJECT_MSG;
@@ -1151,6 +1196,20 @@ static int handle_msg_in(CMDINFO *info)
     if (ret < 0)
         return ret;
 
+#if CONF_WITH_SCSI_DISCONNECT
+    switch(msgbyte) {
+    case SAVE_POINTERS_MSG:
+        info->saved_ptr = info->data_ptr;
+        info->saved_dma_started = info->dma_started;
+        break;
+    case RESTORE_POINTERS_MSG:
+        restore_pointers(info);
+        break;
+    case DISCONNECT_MSG:
+        return 0;               /* the target now releases the bus */
+    }
+#endif
+
     /*
      * determine length of message
      */
@@ -1177,6 +1236,56 @@ static int handle_msg_in(CMDINFO *info)
     return wait_phase_change(timeout);
 }
 
+#if CONF_WITH_SCSI_DISCONNECT
+/*
+ * wait for the target to reselect us after disconnecting
+ *
+ * since there is only ever one command outstanding, only the target of
+ * the current command can reselect us
+ */
+static int wait_reselect(CMDINFO *info)
+{
+    ULONG timeout = hz_200 + info->xfer_time + SHORT_TIMEOUT;
+    UBYTE ids = hostid_bit | info->target_bit;
+
+    put_icr_reg(0x00);              /* unassert everything */
+    put_tcr_reg(0x00);
+
+    /*
+     * wait for BUS FREE, then for SEL & I/O with BSY false and both our
+     * id and the target's id on the bus
+     */
+    while(get_bus_status_reg() & 0x40)
+        if (hz_200 >= timeout)
+            return TIMEOUT_ERROR;
+    while(((get_bus_status_reg() & 0x46) != 0x06) || (get_data_reg() != ids))
+        if (hz_200 >= timeout)
+            return TIMEOUT_ERROR;
+
+    or_icr_reg(0x08);               /* respond by asserting BSY */
+    while(get_bus_status_reg() & 0x02)  /* until target drops SEL */
+    {
+        if (hz_200 >= timeout)
+        {
+            put_icr_reg(0x00);
+            return TIMEOUT_ERROR;
+        }
+    }
+    and_icr_reg(0xf7);              /* release BSY: the target holds it now */
+
+    restore_pointers(info);
+
+    /* wait for the target to request the first (IDENTIFY) message */
+    timeout = hz_200 + SHORT_TIMEOUT;
+    while(!(get_bus_status_reg() & 0x20))
+        if (hz_200 >= timeout)
+            return TIMEOUT_ERROR;
+
+    KDEBUG(("wait_reselect(): reselected by target 0x%02x\n",info->target_bit));
+    return 0;
+}
+#endif
+
 static int scsi_dispatcher(CMDINFO *info)
 {
     WORD error = 0;
@@ -1204,6 +1313,10 @@ static int scsi_dispatcher(CMDINFO *info)
             error = handle_msg_in(info);
             if (!error && (info->msg_in == COMMAND_COMPLETE_MSG))
                 return 0;
+#if CONF_WITH_SCSI_DISCONNECT
+            if (!error && (info->msg_in == DISCONNECT_MSG))
+                error = wait_reselect(info);
+#endif
             break;
         default:
             error = PHASE_ERROR;
@@ -1240,7 +1353,15 @@ LONG send_scsi_command(WORD dev, CMDINFO *info)
             flush_data_cache(info->bufptr, info->buflen);
     }
 
+    info->data_ptr = info->bufptr;
+#if CONF_WITH_SCSI_DISCONNECT
+    info->saved_ptr = info->bufptr;
+    info->dma_started = info->saved_dma_started = 0;
+    info->target_bit = dev_bit;
+    info->next_msg_out = IDENTIFY_MSG | DISCPRIV_BIT;   /* set for first msg out phase */
+#else
     info->next_msg_out = IDENTIFY_MSG;  /* set for first msg out phase */
+#endif
 
     if (has_scsi == FALCON_SCSI)
         flock = -1;                     /* don't let floppy interfere */
@@ -37,6 +37,14 @@ typedef struct
     UBYTE next_msg_out;             /* next msg to send */
     UBYTE msg_in;                   /* first msg byte received */
     UBYTE status;                   /* (last) status byte received */
+    /* the following are set by send_scsi_command() */
+    UBYTE *data_ptr;                /* current data pointer */
+#if CONF_WITH_SCSI_DISCONNECT
+    UBYTE *saved_ptr;               /* saved data pointer */
+    UBYTE dma_started;              /* DMA data transfer has begun */
+    UBYTE saved_dma_started;        /*  & value when pointer was saved */
+    UBYTE target_bit;               /* for reselection */
+#endif
 } CMDINFO;
 
 BOOL detect_scsi(void);
@@ -48,8 +48,11 @@
                             /* Application-specific command class */
 #define CMD55       55          /* APP_CMD: response type R1 */
 #define ACMD13      13          /* SD_STATUS: response type R2 (in SPI mode only!) */
+#define ACMD23      23          /* SET_WR_BLK_ERASE_COUNT: response type R1 */
 #define ACMD41      41          /* SD_SEND_OP_COND: response type R1 */
 #define ACMD51      51          /* SEND_SCR: response type R1 */
+                            /* Switch function command class */
+#define CMD6        6           /* SWITCH_FUNC: response type R1 */
 
 /*
  *  SD card response types
@@ -98,6 +101,8 @@
  *  miscellaneous
  */
 #define SDV2_CSIZE_MULTIPLIER   1024    /* converts C_SIZE to sectors */
+#define SD_CRC_ERROR            1       /* sd_receive_data(): bad data CRC */
+#define SD_PROBE_COUNT          4       /* reads to verify a raised clock */
 #define DELAY_1_MSEC            delay_loop(loopcount_1_msec)
 
 /*
@@ -110,6 +115,7 @@ struct cardinfo {
 #define CARDTYPE_SD         2
     UBYTE version;
     UBYTE features;
+#define HIGH_SPEED          0x04
 #define BLOCK_ADDRESSING    0x02
 #define MULTIBLOCK_IO       0x01
 };
@@ -120,6 +126,25 @@ struct cardinfo {
 static struct cardinfo card;
 static UBYTE response[5];
 
+#if CONF_WITH_SDMMC_HIGHSPEED
+/*
+ *  CRC16-CCITT (polynomial x^16+x^12+x^5+1) of each possible nibble,
+ *  for checking the CRC of data blocks
+ */
+static const UWORD crc16_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+};
+
+/*
+ *  the spi_clock_hs() step in use for SD cards in High Speed mode,
+ *  or -1 if the default SD clock is in use.  data CRCs are only
+ *  checked in the former case.
+ */
+static WORD hsclock = -1;
+static UWORD lastcrc;       /* CRC sent with the last data block */
+#endif
+
 /*
  *  function prototypes
  */
@@ -138,6 +163,13 @@ static int sd_wait_for_not_busy(LONG timeout);
 static int sd_wait_for_not_idle(UBYTE cmd,ULONG arg);
 static int sd_wait_for_ready(LONG timeout);
 static LONG sd_write(UWORD drv,ULONG sector,UWORD count,UBYTE *buf);
+#if CONF_WITH_SDMMC_HIGHSPEED
+static int sd_clock_down(void);
+static UWORD sd_crc16(UWORD crc,const UBYTE *p,UWORD len);
+static int sd_probe_read(void);
+static int sd_switch_highspeed(void);
+static void sd_tune_clock(void);
+#endif
 
 
 /*
@@ -181,6 +213,12 @@ int i;
 
         ret = (rw&RW_RW) ? sd_write(dev,sector,count,p) : sd_read(dev,sector,count,p);
 
+#if CONF_WITH_SDMMC_HIGHSPEED
+        /* a bad data CRC at a raised clock: retry at the next slower one */
+        while ((ret == SD_CRC_ERROR) && (sd_clock_down() == 0))
+            ret = sd_read(dev,sector,count,p);
+#endif
+
         if (ret == 0L)
             break;
 
@@ -308,6 +346,9 @@ int i, rc;
 
     spi_initialise();
     spi_clock_ident();
+#if CONF_WITH_SDMMC_HIGHSPEED
+    hsclock = -1;
+#endif
 
     /* wait at least 1msec */
     DELAY_1_MSEC;
@@ -353,6 +394,10 @@ int i, rc;
     switch(card.type) {
     case CARDTYPE_SD:
         spi_clock_sd();
+#if CONF_WITH_SDMMC_HIGHSPEED
+        if (card.features&HIGH_SPEED)
+            sd_tune_clock();
+#endif
         break;
     case CARDTYPE_MMC:
         spi_clock_mmc();
@@ -420,8 +465,9 @@ LONG posn, incr;
 /*
  *  write one or more blocks
  *
- *  note: we don't use the pre-erase function, since
- *  it doesn't seem to improve performance
+ *  for multiple block writes to SD cards, we tell the card how many
+ *  blocks will be written (ACMD23), so that it can pre-erase them.
+ *  this is only a hint: the write is done in the same way if it fails.
  */
 static LONG sd_write(UWORD drv,ULONG sector,UWORD count,UBYTE *buf)
 {
@@ -447,6 +493,9 @@ LONG posn, incr;
      *  can we use multi sector writes?
      */
     if ((count > 1) && (card.features&MULTIBLOCK_IO)) {
+        if (card.type == CARDTYPE_SD)
+            if (sd_command(CMD55,0L,0,R1,response) == 0)
+                sd_command(ACMD23,count,0,R1,response);
         rc = sd_command(CMD25,posn,0,R1,response);
         if (rc == 0L) {
             for (i = 0; i < count; i++, buf += SECTOR_SIZE) {
@@ -566,13 +615,20 @@ static int sd_command(UBYTE cmd,ULONG argument,UBYTE crc,UBYTE resp_type,UBYTE *
  *  2. if 'special' is non-zero, we use the special SD_CSD_TIMEOUT
  *     instead of the standard read timeout
  *
+ *  3. when running at a raised clock, the data CRC is checked
+ *
  *  returns -1 timeout or unexpected start token
  *          0   ok
+ *          SD_CRC_ERROR    bad data CRC
  */
 static int sd_receive_data(UBYTE *buf,UWORD len,UWORD special)
 {
 LONG i;
 UBYTE token;
+#if CONF_WITH_SDMMC_HIGHSPEED
+UWORD crc = 0;
+UBYTE c;
+#endif
 
     /* wait for the token */
     if (special) {
@@ -601,9 +657,29 @@ UBYTE token;
     /*
      *  transfer data
      */
+#if CONF_WITH_SDMMC_HIGHSPEED
     if (buf) {
-        for (i = 0; i < len; i++)
-            *buf++ = spi_recv_byte();
+        spi_recv_block(buf,len);
+        if (hsclock >= 0)
+            crc = sd_crc16(0,buf,len);
+    } else {
+        for (i = 0; i < len; i++) {
+            c = spi_recv_byte();
+            if (hsclock >= 0)
+                crc = sd_crc16(crc,&c,1);
+        }
+    }
+
+    lastcrc = (UWORD)spi_recv_byte() << 8;
+    lastcrc |= spi_recv_byte();
+
+    if ((hsclock >= 0) && (crc != lastcrc)) {
+        KDEBUG(("sd_receive_data() bad crc 0x%04x, expected 0x%04x\n",lastcrc,crc));
+        return SD_CRC_ERROR;
+    }
+#else
+    if (buf) {
+        spi_recv_block(buf,len);
     } else {
         for (i = 0; i < len; i++)
             spi_recv_byte();
@@ -611,6 +687,7 @@ UBYTE token;
 
     spi_recv_byte();        /* discard crc */
     spi_recv_byte();
+#endif
 
     return 0;
 }
@@ -623,7 +700,6 @@ UBYTE token;
  */
 static int sd_send_data(UBYTE *buf,UWORD len,UBYTE token)
 {
-LONG i;
 UBYTE rtoken;
 
     spi_send_byte(token);
@@ -631,8 +707,7 @@ UBYTE rtoken;
         spi_recv_byte();    /* skip a byte before testing for busy */
     } else {
         /* send the data */
-        for (i = 0; i < len; i++)
-            spi_send_byte(*buf++);
+        spi_send_block(buf,len);
         spi_send_byte(0xff);        /* send dummy crc */
         spi_send_byte(0xff);
 
@@ -727,6 +802,10 @@ static void sd_features(struct cardinfo *info)
      */
     if (info->type == CARDTYPE_SD) {
         info->features |= MULTIBLOCK_IO;
+#if CONF_WITH_SDMMC_HIGHSPEED
+        if (sd_switch_highspeed() == 0)
+            info->features |= HIGH_SPEED;
+#endif
         return;
     }
 
@@ -762,6 +841,122 @@ static int sd_mbtest(void)
     return 0;
 }
 
+#if CONF_WITH_SDMMC_HIGHSPEED
+/*
+ *  switch an SD card to High Speed mode (CMD6, function 1 of group 1),
+ *  allowing SPI clocks up to 50MHz
+ *
+ *  SDv1.0 cards reject CMD6 as an illegal command
+ *
+ *  returns 0 iff the card is now in High Speed mode
+ */
+static int sd_switch_highspeed(void)
+{
+UBYTE status[64];
+
+    /*
+     *  check mode: see if High Speed is supported (bit 401 of the status)
+     */
+    if (sd_command(CMD6,0x00fffff1L,0,R1,response) != 0)
+        return -1;
+    if (sd_receive_data(status,sizeof(status),0) != 0)
+        return -1;
+    if (!(status[13] & 0x02))
+        return -1;
+
+    /*
+     *  switch mode: the function selected for group 1 (bits 379-376)
+     *  is reported back
+     */
+    if (sd_command(CMD6,0x80fffff1L,0,R1,response) != 0)
+        return -1;
+    if (sd_receive_data(status,sizeof(status),0) != 0)
+        return -1;
+    if ((status[16] & 0x0f) != 0x01)
+        return -1;
+
+    return 0;
+}
+
+/*
+ *  read block 0, for verifying the clock
+ */
+static int sd_probe_read(void)
+{
+    if (sd_command(CMD17,0L,0,R1,response) != 0)
+        return -1;
+
+    return sd_receive_data(NULL,SECTOR_SIZE,0);
+}
+
+/*
+ *  select the fastest clock that a card in High Speed mode handles reliably
+ *
+ *  block 0 is read at the default clock, then repeatedly at each of the
+ *  raised clocks in turn (fastest first): the first one for which all the
+ *  reads have a good CRC, equal to that of the first read, is kept
+ */
+static void sd_tune_clock(void)
+{
+WORD step, i;
+UWORD ref;
+
+    spi_cs_assert();
+
+    if (sd_probe_read() == 0) {
+        ref = lastcrc;
+        for (step = 0; spi_clock_hs(step) == 0; step++) {
+            hsclock = step;
+            for (i = 0; i < SD_PROBE_COUNT; i++)
+                if ((sd_probe_read() != 0) || (lastcrc != ref))
+                    break;
+            if (i == SD_PROBE_COUNT) {
+                KDEBUG(("SD clock step %d selected\n",step));
+                spi_cs_unassert();
+                return;
+            }
+        }
+    }
+
+    hsclock = -1;
+    spi_clock_sd();
+    spi_cs_unassert();
+}
+
+/*
+ *  switch to the next slower clock after a data CRC error
+ *
+ *  returns 0   the clock has been lowered
+ *          -1  the default clock was already in use
+ */
+static int sd_clock_down(void)
+{
+    if (hsclock < 0)
+        return -1;
+
+    KDEBUG(("data CRC error at SD clock step %d\n",hsclock));
+    if (spi_clock_hs(++hsclock) != 0) {
+        hsclock = -1;
+        spi_clock_sd();
+    }
+
+    return 0;
+}
+
+/*
+ *  update a CRC16-CCITT with the specified bytes
+ */
+static UWORD sd_crc16(UWORD crc,const UBYTE *p,UWORD len)
+{
+    while (len--) {
+        crc = (crc << 4) ^ crc16_table[((crc >> 12) ^ (*p >> 4)) & 0x0f];
+        crc = (crc << 4) ^ crc16_table[((crc >> 12) ^ *p++) & 0x0f];
+    }
+
+    return crc;
+}
+#endif /* CONF_WITH_SDMMC_HIGHSPEED */
+
 /*
  *  calculate card capacity in sectors
  */
@@ -32,7 +32,7 @@
 /*
  * defines
  */
-#define RS232_BUFSIZE   256     /* like Atari TOS */
+#define RS232_BUFSIZE   RS232_IOREC_SIZE
 
 #if CONF_WITH_SCC
 #define RESET_RECOVERY_DELAY    delay_loop(reset_recovery_loops)
@@ -58,6 +58,8 @@ static LONG bconstatB(void);
 static LONG bconinB(void);
 static LONG bcostatB(void);
 static ULONG rsconfB(WORD baud, WORD ctrl, WORD ucr, WORD rsr, WORD tsr, WORD scr);
+
+static void scc_set_rts(SCC_PORT *port, EXT_IOREC *iorec, BOOL on);
 #endif  /* CONF_WITH_SCC */
 
 #if CONF_WITH_TT_MFP
@@ -170,20 +172,17 @@ static void put_iorecbuf(IOREC *out, WORD b)
 
 static LONG get_iorecbuf(IOREC *in)
 {
-    WORD old_sr;
+    WORD head;
     LONG value;
 
-    /* disable interrupts */
-    old_sr = set_sr(0x2700);
-
-    in->head++;
-    if (in->head >= in->size) {
-        in->head = 0;
+    head = in->head + 1;
+    if (head >= in->size) {
+        head = 0;
     }
-    value = *(UBYTE *)(in->buf + in->head);
+    value = *(volatile UBYTE *)(in->buf + head);
 
-    /* restore interrupts */
-    set_sr(old_sr);
+    /* free the slot only once it has been read */
+    in->head = head;
 
     return value;
 }
@@ -337,7 +336,7 @@ void push_serial_iorec(UBYTE data)
     if (tail == in->head) {
         /* iorec full, do nothing */
     } else {
-        *((UBYTE *)(in->buf + tail)) = data;
+        *((volatile UBYTE *)(in->buf + tail)) = data;
         in->tail = tail;
     }
 }
@@ -456,7 +455,7 @@ void mfp_tt_rx_interrupt_handler(void)
         tail = incr_tail(in);
         if (tail != in->head) {
             /* space available in iorec buffer */
-            *((UBYTE *)(in->buf + tail)) = data;
+            *((volatile UBYTE *)(in->buf + tail)) = data;
             in->tail = tail;
         }
     }
@@ -493,6 +492,66 @@ static ULONG rsconfTT(WORD baud, WORD ctrl, WORD ucr, WORD rsr, WORD tsr, WORD s
 
 
 #if CONF_WITH_SCC
+/*
+ * RTS/CTS flow control for the SCC ports
+ *
+ * This is handled entirely at interrupt level: the rx interrupt handler
+ * drops RTS when the input buffer passes its high water mark, and the
+ * tx interrupt handler stops sending while CTS is negated.  When CTS is
+ * reasserted, the external/status interrupt handler restarts output.
+ * RTS is raised again by bconin_scc() once the application has read
+ * the buffer down to its low water mark.
+ */
+static BOOL scc_hard_flow(EXT_IOREC *iorec)
+{
+    return (iorec->flowctrl & FLOW_CTRL_HARD) ? TRUE : FALSE;
+}
+
+/*
+ * return TRUE iff a character may be written to the port now,
+ * given the value of RR0
+ */
+static BOOL scc_can_send(EXT_IOREC *iorec, UBYTE rr0)
+{
+    if (!(rr0 & SCC_RR0_TX_EMPTY))
+        return FALSE;
+    if (scc_hard_flow(iorec) && !(rr0 & SCC_RR0_CTS))
+        return FALSE;
+
+    return TRUE;
+}
+
+/*
+ * return the number of characters waiting in an iorec buffer
+ */
+static WORD iorec_used(IOREC *iorec)
+{
+    WORD n;
+
+    n = iorec->tail - iorec->head;
+    if (n < 0)
+        n += iorec->size;
+
+    return n;
+}
+
+static LONG bconin_scc(SCC_PORT *port, EXT_IOREC *iorec)
+{
+    LONG value;
+    WORD old_sr;
+
+    value = bconin_iorec(iorec);
+
+    /* if the rx interrupt handler dropped RTS, raise it when appropriate */
+    if (!(iorec->wr5 & SCC_WR5_RTS) && (iorec_used(&iorec->in) <= iorec->in.low)) {
+        old_sr = set_sr(0x2700);
+        scc_set_rts(port, iorec, TRUE);
+        set_sr(old_sr);
+    }
+
+    return value;
+}
+
 /*
  * SCC port A i/o routines
  */
@@ -503,7 +562,9 @@ static LONG bconstatA(void)
 
 static LONG bconinA(void)
 {
-    return bconin_iorec(&iorecA);
+    SCC *scc = (SCC *)SCC_BASE;
+
+    return bconin_scc(&scc->portA, &iorecA);
 }
 
 static LONG bcostatA(void)
@@ -532,7 +593,7 @@ static LONG bconoutA(WORD dev, WORD b)
      * otherwise queue the data.
      */
     out = &iorecA.out;
-    if ((out->head == out->tail) && (scc->portA.ctl & 0x04)) {
+    if ((out->head == out->tail) && scc_can_send(&iorecA, scc->portA.ctl)) {
         scc->portA.data = (UBYTE)b;
         RECOVERY_DELAY;
     } else {
@@ -555,7 +616,9 @@ static LONG bconstatB(void)
 
 static LONG bconinB(void)
 {
-    return bconin_iorec(&iorecB);
+    SCC *scc = (SCC *)SCC_BASE;
+
+    return bconin_scc(&scc->portB, &iorecB);
 }
 
 /*
@@ -606,7 +669,7 @@ LONG bconoutB(WORD dev, WORD b)
      * otherwise queue the data.
      */
     out = &iorecB.out;
-    if ((out->head == out->tail) && (scc->portB.ctl & 0x04)) {
+    if ((out->head == out->tail) && scc_can_send(&iorecB, scc->portB.ctl)) {
         scc->portB.data = (UBYTE)b;
         RECOVERY_DELAY;
     } else {
@@ -640,6 +703,46 @@ static void write_scc_reg0(SCC_PORT *port, UBYTE data)
     RECOVERY_DELAY;
 }
 
+/*
+ * raise or drop RTS, keeping the shadow wr5 up to date
+ */
+static void scc_set_rts(SCC_PORT *port, EXT_IOREC *iorec, BOOL on)
+{
+    UBYTE wr5 = iorec->wr5;
+
+    if (on)
+        wr5 |= SCC_WR5_RTS;
+    else
+        wr5 &= ~SCC_WR5_RTS;
+
+    if (wr5 != iorec->wr5) {
+        iorec->wr5 = wr5;
+        write_scc(port, 5, wr5);
+    }
+}
+
+/*
+ * send the next queued character, if the port & flow control allow it
+ */
+static void scc_send_next(SCC_PORT *port, EXT_IOREC *iorec)
+{
+    IOREC *out = &iorec->out;
+    UBYTE rr0;
+
+    if (out->head == out->tail)
+        return;
+
+    rr0 = port->ctl;
+    RECOVERY_DELAY;
+    if (!scc_can_send(iorec, rr0))
+        return;
+
+    port->data = *((UBYTE *)(out->buf + out->head));
+    RECOVERY_DELAY;
+    if (++out->head >= out->size)
+        out->head = 0;
+}
+
 /*
  * the following routines are called by assembler interrupt handlers.
  * they run at interrupt level 5.
@@ -650,7 +753,7 @@ void scc_rx_interrupt_handler(WORD portnum)
     EXT_IOREC *extiorec;
     IOREC *in;
     SCC_PORT *port;
-    UBYTE available;
+    UBYTE available, data;
     WORD tail;
 
     if (portnum == 0) {
@@ -662,21 +765,29 @@ void scc_rx_interrupt_handler(WORD portnum)
     }
     in = &extiorec->in;
 
-    /* is there really data there? */
-    available = port->ctl & 0x01;
-    RECOVERY_DELAY;
-
-    if (available) {
-        UBYTE data = port->data & extiorec->datamask;
+    /*
+     * empty the receive FIFO: at high baud rates, several characters
+     * may have arrived by the time we get here
+     */
+    while(1) {
+        available = port->ctl & SCC_RR0_RX_AVAIL;
+        RECOVERY_DELAY;
+        if (!available)
+            break;
+        data = port->data & extiorec->datamask;
         RECOVERY_DELAY;
         tail = incr_tail(in);
         if (tail != in->head) {
             /* space available in iorec buffer */
-            *((UBYTE *)(in->buf + tail)) = data;
+            *((volatile UBYTE *)(in->buf + tail)) = data;
             in->tail = tail;
         }
     }
 
+    /* ask the sender to pause if the buffer is getting full */
+    if (scc_hard_flow(extiorec) && (iorec_used(in) >= in->high))
+        scc_set_rts(port, extiorec, FALSE);
+
     /* do error reset in case we're here because of a 'special receive condition' */
     write_scc_reg0(port, SCC_ERROR_RESET);
 
@@ -688,9 +799,7 @@ void scc_tx_interrupt_handler(WORD portnum)
 {
     SCC *scc = (SCC *)SCC_BASE;
     EXT_IOREC *extiorec;
-    IOREC *out;
     SCC_PORT *port;
-    UBYTE empty;
 
     if (portnum == 0) {
         extiorec = &iorecA;
@@ -699,7 +808,6 @@ void scc_tx_interrupt_handler(WORD portnum)
         extiorec = &iorecB;
         port = &scc->portB;
     }
-    out = &extiorec->out;
 
     /* reset TX interrupt pending */
     write_scc_reg0(port, SCC_RESET_TX_INT);
@@ -707,36 +815,37 @@ void scc_tx_interrupt_handler(WORD portnum)
     /* reset highest IUS, allows lower priority interrupts */
     write_scc_reg0(port, SCC_RESET_HIGH_IUS);
 
-    /* make sure TX buffer is empty ... unnecessary check? */
-    empty = port->ctl & 0x04;
-    RECOVERY_DELAY;
-    if (!empty)
-        return;
-
     /*
-     * if there's any queued output data, send it
+     * if there's any queued output data, send it.  if CTS is negated,
+     * output stops here and is restarted by the ext/status handler.
      */
-    if (out->head != out->tail) {
-        port->data = *((UBYTE *)(out->buf + out->head));
-        RECOVERY_DELAY;
-        if (++out->head >= out->size)
-            out->head = 0;
-    }
+    scc_send_next(port, extiorec);
 }
 
 /*
  * the external/status interrupt handler is only called for those
  * events for which we set the corresponding bit in wr15.
  *
- * in preparation for future support of flow handling, we request
- * interrupts for changes to CTS; but for now, we just ignore them.
+ * we request interrupts for changes to CTS, so that output that was
+ * stopped by hardware flow control can be restarted.
  */
 void scc_es_interrupt_handler(WORD portnum)
 {
     SCC *scc = (SCC *)SCC_BASE;
+    EXT_IOREC *extiorec;
     SCC_PORT *port;
 
-    port = (portnum==0) ? &scc->portA : &scc->portB;
+    if (portnum == 0) {
+        extiorec = &iorecA;
+        port = &scc->portA;
+    } else {
+        extiorec = &iorecB;
+        port = &scc->portB;
+    }
+
+    /* if CTS is now asserted, resume any output that's queued */
+    if (scc_hard_flow(extiorec))
+        scc_send_next(port, extiorec);
 
     /* reset ext/status interrupts */
     write_scc_reg0(port, SCC_RESET_ES_INT);
@@ -789,8 +898,11 @@ static ULONG rsconf_scc(SCC_PORT *port,EXT_IOREC *iorec,WORD baud, WORD ctrl, WO
     if (iorec->wr5 & 0x10)  /* break being sent? */
         old |= 0x0800;              /* yes, mark it in the returned pseudo-TSR */
 
-    if ((ctrl >= MIN_FLOW_CTRL) && (ctrl <= MAX_FLOW_CTRL))
+    if ((ctrl >= MIN_FLOW_CTRL) && (ctrl <= MAX_FLOW_CTRL)) {
         iorec->flowctrl = ctrl;
+        if (!scc_hard_flow(iorec))      /* RTS may have been dropped */
+            scc_set_rts(port, iorec, TRUE);
+    }
 
     /*
      * set baudrate from lookup table
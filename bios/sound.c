@@ -46,7 +46,7 @@ static void do_keyclick(void);
 
 /* data used by dosound: */
 
-static const UBYTE *sndtable;
+const UBYTE *sndtable;      /* tested by the timer C handler, see sndirq() */
 static UBYTE snddelay;
 static UBYTE sndtmp;
 
@@ -160,6 +160,10 @@ LONG dosound(const UBYTE *table)
 }
 
 #if CONF_WITH_YM2149
+/*
+ * called by the timer C handler at 50 Hz, but only while sndtable is not
+ * NULL, i.e. while a sound is playing
+ */
 void sndirq(void)
 {
     const UBYTE *code;
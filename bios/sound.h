@@ -34,6 +34,7 @@ void bell(void);
 #if CONF_WITH_YM2149
 
 /* timer C int sound routine */
+extern const UBYTE *sndtable;
 void sndirq(void);
 
 #endif /* CONF_WITH_YM2149 */
@@ -13,6 +13,9 @@
 #define _SPI_H
 
 void spi_clock_ident(void);
+#if CONF_WITH_SDMMC_HIGHSPEED
+int spi_clock_hs(WORD step);
+#endif
 void spi_clock_mmc(void);
 void spi_clock_sd(void);
 void spi_cs_assert(void);
@@ -20,5 +23,7 @@ void spi_cs_unassert(void);
 void spi_initialise(void);
 UBYTE spi_recv_byte(void);
 void spi_send_byte(UBYTE input);
+void spi_recv_block(UBYTE *buf,UWORD len);
+void spi_send_block(const UBYTE *buf,UWORD len);
 
 #endif /* _SPI_H */
@@ -42,6 +42,7 @@
  *      <= 25MHz    for SD operation        DCTAR0
  *      <= 20MHz    for MMC operation       DCTAR1
  *      <= 400kHz   identification mode     DCTAR2
+ *      <= 50MHz    for SD High Speed mode  DCTAR3
  *
  *  the actual clock speeds available are limited by the ColdFire bus clock
  *  and the baud rate prescaler/scaler combination.  we also need to set
@@ -55,6 +56,9 @@
  *      Tasc = (PASC * ASC / Fsys) = (3 * 4 / 132000000) = 91 nsec
  *      Tdt = (PDT * DT / Fsys) = (3 * 8 / 132000000) = 182 nsec
  *      baud rate = (Fsys / (PBR * BR)) = (132000000 / (3 * 2)) = 22MHz
+ *  SD High Speed mode:
+ *      Tcsc, Tasc, Tdt as for SD mode
+ *      baud rate = (Fsys / (PBR * BR)) = (132000000 / (2 * 2)) = 33MHz
  *  MMC mode:
  *      Tcsc = (PCSSCK * CSSCK / Fsys) = (1 * 16 / 132000000) = 121 nsec
  *      Tasc = (PASC * ASC / Fsys) = (1 * 16 / 132000000) = 121 nsec
@@ -76,6 +80,16 @@
                     MCF_DSPI_DCTAR_DT(2L) |         /* delay after transfer scaler = 8 */ \
                     MCF_DSPI_DCTAR_BR(0L)           /* baudrate scaler = 2 */
 
+#define HS_MODE     MCF_DSPI_DCTAR_TRSZ(7L) |       /* transfer size = 8 bit */ \
+                    MCF_DSPI_DCTAR_PCSSCK_3CLK |    /* 3 clock DSPICS to DSPISCK delay prescaler */ \
+                    MCF_DSPI_DCTAR_PASC_3CLK |      /* 3 clock DSPISCK to DSPICS negation prescaler */ \
+                    MCF_DSPI_DCTAR_PDT_3CLK |       /* 3 clock delay between DSPICS assertions prescaler */ \
+                    MCF_DSPI_DCTAR_PBR_2CLK |       /* 2 clock baudrate prescaler */ \
+                    MCF_DSPI_DCTAR_CSSCK(1L) |      /* CS to SCK delay scaler = 4 */\
+                    MCF_DSPI_DCTAR_ASC(1L) |        /* after SCK delay scaler = 4 */ \
+                    MCF_DSPI_DCTAR_DT(2L) |         /* delay after transfer scaler = 8 */ \
+                    MCF_DSPI_DCTAR_BR(0L)           /* baudrate scaler = 2 */
+
 #define MMC_MODE    MCF_DSPI_DCTAR_TRSZ(7L) |       /* transfer size = 8 bit */ \
                     MCF_DSPI_DCTAR_PCSSCK_1CLK |    /* 1 clock DSPICS to DSPISCK delay prescaler */ \
                     MCF_DSPI_DCTAR_PASC_1CLK |      /* 1 clock DSPISCK to DSPICS negation prescaler */ \
@@ -118,6 +132,7 @@ void spi_initialise(void)
     MCF_DSPI_DCTAR0 = SD_MODE;
     MCF_DSPI_DCTAR1 = MMC_MODE;
     MCF_DSPI_DCTAR2 = IDENT_MODE;
+    MCF_DSPI_DCTAR3 = HS_MODE;
 
     /* Initialize the PAR_DPSI register to use correct pin functions.*/
     MCF_PAD_PAR_DSPI |= (
@@ -143,6 +158,25 @@ void spi_clock_sd(void)
     fifo_out |= MCF_DSPI_DTFR_CTAS(0L);     /* use DCTAR0 */
 }
 
+#if CONF_WITH_SDMMC_HIGHSPEED
+/*
+ *  select a clock above that of spi_clock_sd(), for SD cards in
+ *  High Speed mode: step 0 is the fastest one
+ *
+ *  returns 0 iff there is such a clock
+ */
+int spi_clock_hs(WORD step)
+{
+    if (step != 0)
+        return -1;
+
+    fifo_out &= ~MCF_DSPI_DTFR_CTAS(7L);    /* remove old DCTARn selection */
+    fifo_out |= MCF_DSPI_DTFR_CTAS(3L);     /* use DCTAR3 */
+
+    return 0;
+}
+#endif
+
 void spi_clock_mmc(void)
 {
     fifo_out &= ~MCF_DSPI_DTFR_CTAS(7L);    /* remove old DCTARn selection */
@@ -193,3 +227,35 @@ ULONG temp;
 
     return LOBYTE(temp);
 }
+
+/*
+ * the following are equivalent to calling spi_recv_byte()/spi_send_byte()
+ * for each byte of the buffer, but avoid the function call overhead
+ */
+void spi_recv_block(UBYTE *buf,UWORD len)
+{
+ULONG out = fifo_out | 0xff;
+ULONG temp;
+
+    while (len--) {
+        MCF_DSPI_DTFR = out;                        /* send a byte to get one */
+        while(!(MCF_DSPI_DSR & MCF_DSPI_DSR_TCF))   /* wait for transfer complete */
+            ;
+        temp = MCF_DSPI_DRFR;                       /* retrieve this before clearing DSR */
+        MCF_DSPI_DSR = 0xffffffffL;                 /* clear status register */
+        *buf++ = LOBYTE(temp);
+    }
+}
+
+void spi_send_block(const UBYTE *buf,UWORD len)
+{
+ULONG out = fifo_out;
+
+    while (len--) {
+        MCF_DSPI_DTFR = out | *buf++;
+        while(!(MCF_DSPI_DSR & MCF_DSPI_DSR_TCF))   /* wait for transfer complete */
+            ;
+        FORCE_READ(MCF_DSPI_DRFR);                  /* need to do this! */
+        MCF_DSPI_DSR = 0xffffffffL;                 /* clear status register */
+    }
+}
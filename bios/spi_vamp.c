@@ -24,6 +24,7 @@
 #define SAGA_SDCARD_CLKDIV_IDENT ((UWORD)0xffU) /* 195 kHz */
 #define SAGA_SDCARD_CLKDIV_MMC   ((UWORD)0x02U) /* 16.7 MHz */
 #define SAGA_SDCARD_CLKDIV_SD    ((UWORD)0x01U) /* 25 MHz */
+#define SAGA_SDCARD_CLKDIV_HS    ((UWORD)0x00U) /* 50 MHz */
 
 /*
  *  initialise spi for memory card
@@ -38,6 +39,24 @@ void spi_clock_sd(void)
     SAGA_SDCARD_CLK = SAGA_SDCARD_CLKDIV_SD;
 }
 
+#if CONF_WITH_SDMMC_HIGHSPEED
+/*
+ *  select a clock above that of spi_clock_sd(), for SD cards in
+ *  High Speed mode: step 0 is the fastest one
+ *
+ *  returns 0 iff there is such a clock
+ */
+int spi_clock_hs(WORD step)
+{
+    if (step != 0)
+        return -1;
+
+    SAGA_SDCARD_CLK = SAGA_SDCARD_CLKDIV_HS;
+
+    return 0;
+}
+#endif
+
 void spi_clock_mmc(void)
 {
     SAGA_SDCARD_CLK = SAGA_SDCARD_CLKDIV_MMC;
@@ -77,4 +96,50 @@ UBYTE spi_recv_byte(void)
     /* reading will stall until transmission is complete */
     return SAGA_SDCARD_DATA;
 }
+
+/*
+ * the following are equivalent to calling spi_recv_byte()/spi_send_byte()
+ * for each byte of the buffer, but avoid the function call overhead
+ */
+void spi_recv_block(UBYTE *buf,UWORD len)
+{
+    UBYTE *end = buf + (len & ~3);
+
+    while (buf < end) {
+        SAGA_SDCARD_DATA = 0xFF;
+        *buf++ = SAGA_SDCARD_DATA;
+        SAGA_SDCARD_DATA = 0xFF;
+        *buf++ = SAGA_SDCARD_DATA;
+        SAGA_SDCARD_DATA = 0xFF;
+        *buf++ = SAGA_SDCARD_DATA;
+        SAGA_SDCARD_DATA = 0xFF;
+        *buf++ = SAGA_SDCARD_DATA;
+    }
+
+    for (len &= 3; len; len--) {
+        SAGA_SDCARD_DATA = 0xFF;
+        *buf++ = SAGA_SDCARD_DATA;
+    }
+}
+
+void spi_send_block(const UBYTE *buf,UWORD len)
+{
+    const UBYTE *end = buf + (len & ~3);
+
+    while (buf < end) {
+        SAGA_SDCARD_DATA = *buf++;
+        FORCE_READ(SAGA_SDCARD_DATA);
+        SAGA_SDCARD_DATA = *buf++;
+        FORCE_READ(SAGA_SDCARD_DATA);
+        SAGA_SDCARD_DATA = *buf++;
+        FORCE_READ(SAGA_SDCARD_DATA);
+        SAGA_SDCARD_DATA = *buf++;
+        FORCE_READ(SAGA_SDCARD_DATA);
+    }
+
+    for (len &= 3; len; len--) {
+        SAGA_SDCARD_DATA = *buf++;
+        FORCE_READ(SAGA_SDCARD_DATA);
+    }
+}
 #endif /* CONF_WITH_VAMPIRE_SPI */
@@ -104,6 +104,10 @@ void mfp_rs232_rx_interrupt(void);
 void mfp_rs232_tx_interrupt(void);
 #endif
 
+#if CONF_WITH_PRINTER_QUEUE
+void parport_busy_interrupt(void);
+#endif
+
 #if CONF_WITH_TT_MFP
 void mfp_tt_rx_interrupt(void);
 void mfp_tt_tx_interrupt(void);
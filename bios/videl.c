@@ -508,50 +508,113 @@ static WORD determine_regc0(WORD mode,WORD monitor)
  *      The offset register (xff820e) is set to 1/5 of the screen width.
  *      The logically equivalent set of modes (0x001n) do not do this.
  */
+/*
+ * cache of the register values for the most recently used modes
+ *
+ * programs that switch between two modes (e.g. for split-screen effects)
+ * get the register values from here, without looking up the mode table
+ * or recomputing them.
+ */
+#define NUM_CACHED_MODES 2
+
+typedef struct {
+    WORD mode;          /* video mode, already fixed up */
+    WORD monitor;       /* monitor type the values are computed for */
+    const VMODE_ENTRY *timing;  /* timing register values */
+    UWORD linewidth;    /* scanline width */
+    UWORD vctl;         /* video control */
+    UWORD regc0;        /* video clock */
+} VIDEL_REGS;
+
+static VIDEL_REGS videl_regs_cache[NUM_CACHED_MODES];
+static WORD next_cached_mode;   /* next entry to replace */
+
+static const VIDEL_REGS *get_videl_regs(WORD mode, WORD monitor)
+{
+    VIDEL_REGS *r;
+    const VMODE_ENTRY *p;
+
+    for (r = videl_regs_cache; r < videl_regs_cache+NUM_CACHED_MODES; r++)
+        if (r->timing && (r->mode == mode) && (r->monitor == monitor))
+            return r;
+
+    p = lookup_videl_mode(mode);        /* validate mode */
+    if (!p)
+        return NULL;
+
+    r = &videl_regs_cache[next_cached_mode];
+    if (++next_cached_mode >= NUM_CACHED_MODES)
+        next_cached_mode = 0;
+
+    r->mode = mode;
+    r->monitor = monitor;
+    r->timing = p;
+    r->linewidth = determine_width(mode);
+    r->vctl = determine_vctl(mode,monitor);
+    r->regc0 = determine_regc0(mode,monitor);
+
+    return r;
+}
+
 static int set_videl_vga(WORD mode)
 {
     volatile char *videlregs = (char *)0xffff8200;
 #define videlword(n) (*(volatile UWORD *)(videlregs+(n)))
+/* only write registers that change, to keep mode switches short */
+#define set_videlword(n,value)                  \
+    if (videlword(n) != (value))                \
+        videlword(n) = (value)
+    const VIDEL_REGS *r;
     const VMODE_ENTRY *p;
     WORD linewidth, monitor, vctl;
+    BOOL in_interrupt;
 
     monitor = vmontype();
 
-    p = lookup_videl_mode(mode);        /* validate mode */
-    if (!p)
+    r = get_videl_regs(mode, monitor);
+    if (!r)
         return -1;
+    p = r->timing;
+
+    /*
+     * when called from an interrupt routine (typically a VBL or HBL routine
+     * doing split-screen effects), the caller is already synchronised with
+     * the display, and waiting for a VBL would be too late (or hang)
+     */
+    in_interrupt = (get_sr() & 0x0700) > 0x0300;
 
     videlregs[0x0a] = (mode&VIDEL_PAL) ? 2 : 0; /* video sync to 50Hz if PAL */
 
 #ifndef MACHINE_FIREBEE
     /* On the Falcon, synchronize Videl register updates like Atari TOS 4 */
-    vsync(); /* wait for VBL */
+    if (!in_interrupt)
+        vsync(); /* wait for VBL */
 #endif
 
-    videlword(0x82) = p->hht;           /* H hold timer */
-    videlword(0x84) = p->hbb;           /* H border begin */
-    videlword(0x86) = p->hbe;           /* H border end */
-    videlword(0x88) = p->hdb;           /* H display begin */
-    videlword(0x8a) = p->hde;           /* H display end */
-    videlword(0x8c) = p->hss;           /* H SS */
+    set_videlword(0x82, p->hht);        /* H hold timer */
+    set_videlword(0x84, p->hbb);        /* H border begin */
+    set_videlword(0x86, p->hbe);        /* H border end */
+    set_videlword(0x88, p->hdb);        /* H display begin */
+    set_videlword(0x8a, p->hde);        /* H display end */
+    set_videlword(0x8c, p->hss);        /* H SS */
 
-    videlword(0xa2) = p->vft;           /* V freq timer */
-    videlword(0xa4) = p->vbb;           /* V border begin */
-    videlword(0xa6) = p->vbe;           /* V border end */
-    videlword(0xa8) = p->vdb;           /* V display begin */
-    videlword(0xaa) = p->vde;           /* V display end */
-    videlword(0xac) = p->vss;           /* V SS */
+    set_videlword(0xa2, p->vft);        /* V freq timer */
+    set_videlword(0xa4, p->vbb);        /* V border begin */
+    set_videlword(0xa6, p->vbe);        /* V border end */
+    set_videlword(0xa8, p->vdb);        /* V display begin */
+    set_videlword(0xaa, p->vde);        /* V display end */
+    set_videlword(0xac, p->vss);        /* V SS */
 
     videlregs[0x60] = 0x00;             /* clear ST shift for safety */
 
-    videlword(0x0e) = 0;                /* offset */
+    set_videlword(0x0e, 0);             /* offset */
 
-    linewidth = determine_width(mode);
-    vctl = determine_vctl(mode,monitor);
+    linewidth = r->linewidth;
+    vctl = r->vctl;
 
     videlword(0x10) = linewidth;        /* scanline width */
     videlword(0xc2) = vctl;             /* video control */
-    videlword(0xc0) = determine_regc0(mode,monitor);
+    set_videlword(0xc0, r->regc0);
     videlword(0x66) = 0x0000;           /* clear SPSHIFT */
 
     switch(mode&VIDEL_BPPMASK) {        /* set SPSHIFT / ST shift */
@@ -578,7 +641,7 @@ static int set_videl_vga(WORD mode)
              * Hatari has NatFeats disabled, or if we compile without NatFeats
              * support, we'll still see those messages.
              */
-            if (!HAS_NATFEATS) {
+            if (!HAS_NATFEATS && !in_interrupt) {
                 vsync();
                 videlword(0x66) = 0;
                 vsync();
@@ -72,6 +72,7 @@ static void ascii_lf(void);
 static void ascii_cr(void);
 
 /* handlers for the console state machine */
+static void normal_ascii(WORD);
 static void esc_ch1(WORD);
 static void get_row(WORD);
 static void get_column(WORD);
@@ -160,6 +161,43 @@ void cputc(WORD ch)
 }
 
 
+/*
+ * cputs - console output of a string
+ *
+ * equivalent to calling cputc() for each character, but runs of printable
+ * characters are rendered by a single call to ascii_outs()
+ */
+void cputs(const UBYTE *buf, LONG count)
+{
+    const UBYTE *end = buf + count;
+
+#if CONF_SERIAL_CONSOLE
+    /* the serial port needs each character, let cputc() handle it */
+    while (buf < end)
+        cputc(*buf++);
+#else
+    const UBYTE *p;
+
+    if (!con_state) {
+        /* vt52_init() has not been called yet, ignore */
+        return;
+    }
+
+    while (buf < end) {
+        if ((con_state != normal_ascii) || (*buf < ' ')) {
+            (*con_state)(*buf++);
+            continue;
+        }
+
+        for (p = buf; (p < end) && (*p >= ' '); p++)
+            ;
+        ascii_outs(buf, p - buf);
+        buf = p;
+    }
+#endif
+}
+
+
 /*
  * normal_ascii - state is normal output
  */
@@ -848,6 +886,10 @@ static void ascii_lf(void)
  */
 void blink(void)
 {
+#if CONF_WITH_DEFERRED_CONSOLE
+    shadow_vbl();               /* repaint what changed since the last VBL */
+#endif
+
     /* test visibility/semaphore bit */
     if (!(v_stat_0 & M_CVIS) )
         return;    /* if invisible or blocked, return */
@@ -947,6 +989,10 @@ void vt52_init(void)
     }
     v_col_bg = 0;
 
+#if CONF_WITH_DEFERRED_CONSOLE
+    shadow_init();                      /* select deferred or immediate mode */
+#endif
+
     con_state = normal_ascii;           /* Init conout state machine */
 
     clear_and_home();
@@ -0,0 +1,84 @@
+/*
+ * warmcache.c - hardware detection results kept across warm resets
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * On a warm reset, the hardware is the same as on the previous boot, so
+ * the slow parts of its detection (the delay loop calibration, and the
+ * IDE interface checks, which may wait for seconds) can use the results
+ * saved then.  Everything is detected again on a cold boot, or if the
+ * saved block is not valid.
+ *
+ * The probes which also initialise hardware, the device detection and
+ * the partition scan are always done: the devices are reset, and the
+ * media may have been changed.
+ */
+
+/* #define ENABLE_KDEBUG */
+
+#include "emutos.h"
+#include "biosdefs.h"
+#include "bios.h"
+#include "machine.h"
+#include "delay.h"
+#include "string.h"
+#include "warmcache.h"
+
+#if CONF_WITH_WARM_CACHE
+
+BOOL warm_cache_valid;
+
+static UWORD warm_cache_checksum(void)
+{
+    const UWORD *p = (const UWORD *)&warm_cache;
+    UWORD sum = 0x1234;
+    WORD n;
+
+    for (n = offsetof(WARM_CACHE, checksum) / sizeof(UWORD); n > 0; n--)
+        sum += *p++;
+
+    return sum;
+}
+
+/*
+ * reuse the results saved by the previous boot, if they are valid;
+ * this must be called after init_delay(), which sets default values
+ */
+void warm_cache_load(void)
+{
+    warm_cache_valid = !FIRST_BOOT
+                    && (warm_cache.magic == WARM_CACHE_MAGIC)
+                    && (warm_cache.rom == &os_header)
+                    && (warm_cache.date == os_header.os_date)
+                    && (warm_cache.checksum == warm_cache_checksum());
+
+    if (!warm_cache_valid)
+    {
+        bzero(&warm_cache, sizeof(warm_cache));
+        return;
+    }
+
+    loopcount_1_msec = warm_cache.loopcount_1_msec;
+    KDEBUG(("warm_cache_load(): loopcount_1_msec=%lu, busses=0x%04lx, ide=0x%02x\n",
+            loopcount_1_msec, warm_cache.detected_busses, warm_cache.ide_present));
+}
+
+/*
+ * save the results for the next warm reset, once detection is complete
+ */
+void warm_cache_save(void)
+{
+    warm_cache.magic = WARM_CACHE_MAGIC;
+    warm_cache.rom = &os_header;
+    warm_cache.date = os_header.os_date;
+    warm_cache.loopcount_1_msec = loopcount_1_msec;
+    warm_cache.detected_busses = detected_busses;
+    warm_cache.checksum = warm_cache_checksum();
+}
+
+#endif /* CONF_WITH_WARM_CACHE */
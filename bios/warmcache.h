@@ -0,0 +1,43 @@
+/*
+ * warmcache.h - hardware detection results kept across warm resets
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+#ifndef WARMCACHE_H
+#define WARMCACHE_H
+
+#if CONF_WITH_WARM_CACHE
+
+/*
+ * this block is located in the system variables (see tosvars.ld), which
+ * are cleared on a cold boot, but not on a warm reset
+ */
+typedef struct
+{
+    ULONG magic;                /* WARM_CACHE_MAGIC if valid */
+    const OSHEADER *rom;        /* OS which wrote the block */
+    ULONG date;                 /* and its build date */
+    ULONG loopcount_1_msec;     /* result of calibrate_delay() */
+    ULONG detected_busses;      /* result of check_busses() */
+    UBYTE ide_present;          /* IDE interfaces found by ide_init() */
+    UBYTE ide_twisted;          /* and those with a twisted cable */
+    UWORD checksum;
+} WARM_CACHE;
+
+#define WARM_CACHE_MAGIC    0x57434143L /* 'WCAC' */
+
+extern WARM_CACHE warm_cache;
+
+/* TRUE if the results of the previous boot are reused */
+extern BOOL warm_cache_valid;
+
+void warm_cache_load(void);
+void warm_cache_save(void);
+
+#endif /* CONF_WITH_WARM_CACHE */
+
+#endif /* WARMCACHE_H */
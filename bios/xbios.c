@@ -38,6 +38,8 @@
 #include "asm.h"
 #include "vectors.h"
 #include "xbios.h"
+#include "cachectl.h"
+#include "hardcopy.h"
 
 #define DBG_XBIOS        0
 
@@ -489,6 +491,22 @@ static LONG xbios_13(WORD *buf, LONG filler, WORD devno, WORD sectno,
 
 static void scrdmp(void)
 {
+#if CONF_WITH_HARDCOPY
+    /*
+     * the default hardcopy runs in the background: since programs expect
+     * Scrdmp() to return when the dump is complete, we wait for it
+     */
+    if (dump_vec == hardcopy_start)
+    {
+        while (hardcopy_busy())
+            ;
+        hardcopy_start();
+        while (hardcopy_busy())
+            ;
+        dumpflg = -1;
+        return;
+    }
+#endif
     protect_v((PFLONG)dump_vec);
     dumpflg = -1;       /* reset to allow future dumps ... */
 }
@@ -867,6 +885,20 @@ static LONG xbios_2c(WORD devno)
 
 
 
+/*
+ * xbios_2d - (Hrclock) EmuTOS-specific
+ */
+
+#if DBG_XBIOS && CONF_WITH_HIRES_CLOCK
+static LONG xbios_2d(void)
+{
+    kprintf("XBIOS: Hrclock\n");
+    return hires_clock();
+}
+#endif
+
+
+
 /*
  * xbios_2e - (NVMaccess)
  */
@@ -1239,6 +1271,54 @@ static LONG xbios_8d(LONG sptr)
     return buffptr(sptr);
 }
 
+#if CONF_WITH_SOUND_STREAM
+static LONG xbios_8e(WORD mode, WORD count, const SNDBUF *bufs, LONG refill)
+{
+    kprintf("XBIOS: Sndstream\n");
+    return sndstream(mode, count, bufs, refill);
+}
+#endif
+
+#endif
+
+
+
+/*
+ * xbios_8f - (Cachectl) EmuTOS-specific
+ */
+
+#if DBG_XBIOS && CONF_WITH_CACHECTL
+static LONG xbios_8f(WORD op, void *start, LONG size)
+{
+    kprintf("XBIOS: Cachectl(%d, %p, %ld)\n", op, start, size);
+    return cachectl(op, start, size);
+}
+#endif
+
+/*
+ * xbios_90 - (Vflip) EmuTOS-specific
+ */
+
+#if DBG_XBIOS && CONF_WITH_SCREEN_FLIP
+static LONG xbios_90(WORD mode, LONG arg)
+{
+    kprintf("XBIOS: Vflip(%d, 0x%08lx)\n", mode, arg);
+    return vflip(mode, arg);
+}
+#endif
+
+/*
+ * xbios_91 - (Floptrks) EmuTOS-specific
+ */
+
+#if DBG_XBIOS && CONF_WITH_FLOPTRKS
+static LONG xbios_91(UBYTE *buf, WORD dev, WORD rw, WORD spt, WORD sides,
+                     WORD track, WORD count)
+{
+    kprintf("XBIOS: Floptrks(%p, %d, %d, %d, %d, %d, %d)\n",
+            buf, dev, rw, spt, sides, track, count);
+    return floptrks(buf, dev, rw, spt, sides, track, count);
+}
 #endif
 
 /*
@@ -1270,7 +1350,15 @@ LONG supexec(PFLONG);       /* defined in vectors.S */
 #define VEC(wrapper, direct) (PFLONG) direct
 #endif
 
-#if CONF_WITH_DMASOUND
+#if CONF_WITH_FLOPTRKS
+# define LAST_ENTRY 0x91
+#elif CONF_WITH_SCREEN_FLIP
+# define LAST_ENTRY 0x90
+#elif CONF_WITH_CACHECTL
+# define LAST_ENTRY 0x8f
+#elif CONF_WITH_SOUND_STREAM
+# define LAST_ENTRY 0x8e
+#elif CONF_WITH_DMASOUND
 # define LAST_ENTRY 0x8d
 #elif CONF_WITH_DSP
 # define LAST_ENTRY 0x7f
@@ -1345,7 +1433,11 @@ const PFLONG xbios_vecs[] = {
     VEC(xbios_2a, DMAread),
     VEC(xbios_2b, DMAwrite),
     VEC(xbios_2c, bconmap),
+#if CONF_WITH_HIRES_CLOCK
+    VEC(xbios_2d, hires_clock),  /* 2d - EmuTOS-specific */
+#else
     xbios_unimpl,   /* 2d */
+#endif
 #if CONF_WITH_NVRAM
     VEC(xbios_2e, nvmaccess),  /* 2e */
 #else
@@ -1511,7 +1603,40 @@ const PFLONG xbios_vecs[] = {
     VEC(xbios_8b, devconnect),  /* 8b */
     VEC(xbios_8c, sndstatus),   /* 8c */
     VEC(xbios_8d, buffptr),     /* 8d */
+#elif LAST_ENTRY > 0x8d     /* must insert fillers for sound opcodes */
+    xbios_unimpl,   /* 80 */
+    xbios_unimpl,   /* 81 */
+    xbios_unimpl,   /* 82 */
+    xbios_unimpl,   /* 83 */
+    xbios_unimpl,   /* 84 */
+    xbios_unimpl,   /* 85 */
+    xbios_unimpl,   /* 86 */
+    xbios_unimpl,   /* 87 */
+    xbios_unimpl,   /* 88 */
+    xbios_unimpl,   /* 89 */
+    xbios_unimpl,   /* 8a */
+    xbios_unimpl,   /* 8b */
+    xbios_unimpl,   /* 8c */
+    xbios_unimpl,   /* 8d */
 #endif /* CONF_WITH_DMASOUND */
+#if CONF_WITH_SOUND_STREAM
+    VEC(xbios_8e, sndstream),   /* 8e - EmuTOS-specific */
+#elif LAST_ENTRY > 0x8e
+    xbios_unimpl,   /* 8e */
+#endif
+#if CONF_WITH_CACHECTL
+    VEC(xbios_8f, cachectl),    /* 8f - EmuTOS-specific */
+#elif LAST_ENTRY > 0x8f
+    xbios_unimpl,   /* 8f */
+#endif
+#if CONF_WITH_SCREEN_FLIP
+    VEC(xbios_90, vflip),       /* 90 - EmuTOS-specific */
+#elif LAST_ENTRY > 0x90
+    xbios_unimpl,   /* 90 */
+#endif
+#if CONF_WITH_FLOPTRKS
+    VEC(xbios_91, floptrks),    /* 91 - EmuTOS-specific */
+#endif
 };
 
 const UWORD xbios_ent = ARRAY_SIZE(xbios_vecs);
@@ -21,6 +21,7 @@
 #include "string.h"
 #include "disk.h"
 #include "ahdi.h"
+#include "machine.h"
 
 
 #if CONF_WITH_XHDI
@@ -76,6 +77,31 @@ static long XHNewCookie(ULONG newcookie)
     return E_OK;
 }
 
+/*
+ * check if the BPB built by the last blkdev_getbpb() can be returned as is,
+ * avoiding a boot sector read and the reset of the mediachange status.
+ * removable units are always re-checked.
+ */
+static BOOL bpb_is_current(BLKDEV *b)
+{
+    return (b->flags & BPB_VALID) && (b->mediachange == MEDIANOCHANGE)
+        && !b->forcechange && !(units[b->unit].features & UNIT_REMOVABLE);
+}
+
+/*
+ * a physical write may have modified the boot sector of a partition:
+ * if so, its BPB must be rebuilt next time
+ */
+static void invalidate_bpbs(UWORD unit, ULONG sector, UWORD count)
+{
+    LONG drivemap = units[unit].drivemap;
+    BLKDEV *b;
+
+    for (b = blkdev; drivemap; b++, drivemap >>= 1)
+        if ((drivemap & 1) && (b->start >= sector) && (b->start - sector < count))
+            b->flags &= ~BPB_VALID;
+}
+
 static long XHInqDev2(UWORD drv, UWORD *major, UWORD *minor, ULONG *start,
                       BPB *bpb, ULONG *blocks, char *partid)
 {
@@ -108,7 +134,11 @@ static long XHInqDev2(UWORD drv, UWORD *major, UWORD *minor, ULONG *start,
     if (start)
         *start = pstart;
 
-    myBPB = (BPB *)blkdev_getbpb(drv);
+    myBPB = bpb_is_current(&blkdev[drv]) ? &blkdev[drv].bpb : (BPB *)blkdev_getbpb(drv);
+#if CONF_WITH_FAT32
+    if (myBPB && (myBPB->b_flags & B_32))
+        myBPB = NULL;       /* not describable by a BPB: leave recsiz zero */
+#endif
     if (bpb && myBPB)
         memcpy(bpb, myBPB, sizeof(BPB));
 
@@ -313,7 +343,11 @@ static long XHDOSLimits(UWORD which, ULONG limit)
 
             case XH_DL_CLUSTS32:
                 /* Max. number of clusters of a 32 bit FAT */
+#if CONF_WITH_FAT32
+                ret = MAX_FAT32_CLUSTERS;
+#else
                 ret = EINVFN; /* No FAT32 support. */
+#endif
                 break;
 
             case XH_DL_BFLAGS:
@@ -433,11 +467,14 @@ static long XHReadWrite(UWORD major, UWORD minor, UWORD rw, ULONG sector,
             return ret;
     }
 
-    if (minor != 0)
+    if ((minor != 0) || (major >= UNITSNUM - NUMFLOPPIES))
         return EUNDEV;
 
     unit = NUMFLOPPIES + major;
 
+    if (rw & RW_WRITE)
+        invalidate_bpbs(unit, sector, count);
+
     return disk_rw(unit, rw, sector, count, buf);
 }
 
@@ -47,6 +47,7 @@ extern LONG jmp_xbios(WORD, ...);
 #define jmp_gemdos_wlp(a,b,c,d) jmp_gemdos((WORD)(a),(WORD)(b),(LONG)(c),(void *)(d))
 #define jmp_gemdos_wpp(a,b,c,d) jmp_gemdos((WORD)(a),(WORD)(b),(void *)(c),(void *)(d))
 #define jmp_gemdos_pww(a,b,c,d) jmp_gemdos((WORD)(a),(void *)(b),(WORD)(c),(WORD)(d))
+#define jmp_gemdos_wwp(a,b,c,d) jmp_gemdos((WORD)(a),(WORD)(b),(WORD)(c),(void *)(d))
 #define jmp_gemdos_wppp(a,b,c,d,e)  jmp_gemdos((WORD)(a),(WORD)(b),(void *)(c),(void *)(d),(void *)(e))
 #define jmp_bios_w(a,b)         jmp_bios((WORD)(a),(WORD)(b))
 #define jmp_bios_ww(a,b,c)      jmp_bios((WORD)(a),(WORD)(b),(WORD)(c))
@@ -57,6 +58,7 @@ extern LONG jmp_xbios(WORD, ...);
 
 #define Dsetdrv(a)          jmp_gemdos_w(0x0e,a)
 #define Dgetdrv()           jmp_gemdos_v(0x19)
+#define Fsetdta(a)          jmp_gemdos_p(0x1a,a)
 #define Fgetdta()           jmp_gemdos_v(0x2f)
 #define Sversion()          jmp_gemdos_v(0x30)
 #define Dfree(a,b)          jmp_gemdos_pw(0x36,a,b)
@@ -79,6 +81,8 @@ extern LONG jmp_xbios(WORD, ...);
 #define Fsfirst(a,b)        jmp_gemdos_pw(0x4e,a,b)
 #define Fsnext()            jmp_gemdos_v(0x4f)
 #define Frename(a,b,c)      jmp_gemdos_wpp(0x56,a,b,c)
+#define Sproctime(a,b,c)    jmp_gemdos_wwp(0x5c,a,b,c)
+#define Sdosprof(a,b,c)     jmp_gemdos_wwp(0x5f,a,b,c)
 
 #define Bconstat(a)         jmp_bios_w(0x01,a)
 #define Bconin(a)           jmp_bios_w(0x02,a)
@@ -99,10 +103,14 @@ extern LONG jmp_xbios(WORD, ...);
 #define MAXCMDLINE      125     /* the most amount of real data allowed */
 
 #define IOBUFSIZE       16384L  /* buffer size */
+#define IOBUF_RESERVE   16384L  /* memory left free by large copy buffers */
 
 #define MAX_LINE_SIZE   200L    /* must be greater than the largest screen width */
 #define HISTORY_SIZE    10      /* number of lines of history */
+#define TAB_NAMES_SIZE  4096L   /* size of buffer for tab completion names */
 #define MAX_ARGS        30      /* maximum number of args we can parse */
+#define MAX_SCRIPT_DEPTH 4      /* maximum nesting of scripts */
+#define MAX_TREE_DEPTH  16      /* maximum directory depth for cp/rm -r */
 
 #define LOCAL           static  /* comment out for testing */
 #define PRIVATE         static  /* comment out for testing */
@@ -148,6 +156,34 @@ typedef struct {
     char    d_fname[14];
 } DTA;
 
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PROCTIME
+typedef struct {
+    LONG    pt_id;
+    ULONG   pt_ticks;
+    char    pt_name[10];
+} PROCTIME;
+
+#define PT_GEMDOS       0               /* for Sproctime() */
+#define PT_AES          1
+#endif
+
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_BDOS_PROFILE
+typedef struct {
+    ULONG   dp_calls;
+    ULONG   dp_ticks;
+    ULONG   dp_hist[6];
+} DOSPROF;
+
+typedef struct {
+    ULONG   dc_lookups;
+    ULONG   dc_misses;
+} DOSCACHE;
+
+#define DP_FUNCTION     0               /* for Sdosprof() */
+#define DP_CACHE        1
+#define DP_RESET        2
+#endif
+
 /* Type of function run by execute() */
 typedef LONG FUNC(WORD argc,char **argv);
 
@@ -175,6 +211,8 @@ typedef LONG FUNC(WORD argc,char **argv);
 #define CMDLINE_LENGTH  -103
 #define DIR_NOT_EMPTY   -104        /* translated from EACCDN for folders */
 #define CANT_DELETE     -105        /* translated from EACCDN for files */
+#define SCRIPT_NESTING  -106        /* scripts nested too deeply */
+#define SCRIPT_FAILED   -107        /* script ended by error (already reported) */
 #define CHANGE_RES      -125        /* returned by mode command */
 #define INVALID_PARAM   -126        /* for builtin commands */
 #define WRONG_NUM_ARGS  -127        /* for builtin commands */
@@ -210,14 +248,20 @@ extern DTA *dta;
 extern LONG redir_handle;
 extern char user_path[MAXPATHLEN];     /* from PATH command */
 extern char *environment;              /* from cmdasm.S */
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PATH_CACHE
+extern ULONG dirchgcnt;                 /* BDOS directory change counter */
+extern LONG drvrem;                     /* bitmap of removable drives */
+#endif
 
 /*
  *  function prototypes
  */
 /* cmdmain.c */
+LONG run_script(WORD argc,char **argv);
 int valid_res(WORD res);
 
 /* cmdedit.c */
+const char *get_history(WORD n);
 WORD init_cmdedit(void);
 void init_screen(void);
 void insert_char(char *line,WORD pos,WORD len,char c);
@@ -22,6 +22,21 @@ LOCAL char *history_line[HISTORY_SIZE];
 LOCAL char *insert;     /* saves insertion point for tab completion */
 LOCAL char fsfbuf[MAXPATHLEN];  /* saves Fsfirst() string for tab completion */
 
+/*
+ * the names matching fsfbuf[], read once when tab completion starts, so
+ * that cycling through them doesn't depend on the Fsnext() state.  if
+ * there are too many names, we fall back to using Fsfirst()/Fsnext().
+ */
+LOCAL char *tab_names;  /* names, stored as consecutive strings */
+LOCAL WORD tab_count;   /* number of names in tab_names[], -1 => not valid */
+LOCAL WORD tab_exec;    /* TRUE iff tab_names[] holds executables only */
+LOCAL WORD tab_used;    /* number of names used in current cycle */
+LOCAL char *tab_next;   /* next name to use */
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PATH_CACHE
+LOCAL ULONG tab_chgcnt; /* value of 'dirchgcnt' when tab_names[] was read */
+LOCAL char tab_dir[MAXPATHLEN];     /* current directory at that time */
+#endif
+
 /*
  *  function prototypes
  */
@@ -31,11 +46,13 @@ PRIVATE void erase_line(char *start,WORD len);
 PRIVATE LONG getfirstnondot(const char *buffer,WORD executable_only);
 PRIVATE LONG getnextfile(WORD executable_only);
 PRIVATE char *insertion_point(char *start);
+PRIVATE const char *next_completion(WORD first,WORD executable_only);
 PRIVATE WORD next_history(char *line);
 PRIVATE WORD next_word_count(const char *line,WORD pos,WORD len);
 PRIVATE WORD previous_history(char *line);
 PRIVATE WORD previous_word_count(const char *line,WORD pos);
 PRIVATE WORD replace_line(char *line,WORD num);
+PRIVATE void scan_completions(const char *spec,WORD executable_only);
 PRIVATE char *start_of_current_word(char *line,WORD pos);
 
 WORD read_line(char *line)
@@ -148,8 +165,10 @@ char *p;
 WORD i;
 
     history_num = -1;       /* means history not available */
+    tab_names = NULL;       /* tab completion uses Fsfirst()/Fsnext() */
+    tab_count = -1;
 
-    p = (char *)Malloc(MAX_LINE_SIZE*HISTORY_SIZE);
+    p = (char *)Malloc(MAX_LINE_SIZE*HISTORY_SIZE+TAB_NAMES_SIZE);
     if (!p)
         return -1;
 
@@ -157,12 +176,30 @@ WORD i;
         history_line[i] = p;
         *p = '\0';
     }
+    tab_names = p;
 
     history_num = 0;
 
     return 0;
 }
 
+/*
+ *  return the specified line of the history, counting from the oldest
+ *
+ *  returns NULL if there is no such line; unused lines are empty
+ */
+const char *get_history(WORD n)
+{
+    if ((history_num < 0) || (n >= HISTORY_SIZE))
+        return NULL;
+
+    n += history_num;       /* the oldest line is the next one to be reused */
+    if (n >= HISTORY_SIZE)
+        n -= HISTORY_SIZE;
+
+    return history_line[n];
+}
+
 /*
  *  save a line in the history
  *  skip whitespace at start, and empty or duplicate lines
@@ -195,7 +232,7 @@ void save_history(const char *line)
 PRIVATE WORD edit_line(char *line,WORD *pos,WORD *len,WORD scancode,WORD prevcode)
 {
 char *start, *p, *q;
-LONG rc;
+const char *name;
 WORD n, word = 0;
 
     switch(scancode) {
@@ -255,24 +292,22 @@ WORD n, word = 0;
             insert = insertion_point(start);    /* where we insert the names */
         if (insert+sizeof(dta->d_fname)-line >= linesize)
             break;
-        if (prevcode == TAB) {
-            rc = getnextfile(start==line);
-        } else {
-            for (p = start, q = fsfbuf; p < line+*pos; )
+        if (prevcode != TAB) {
+            char spec[MAXPATHLEN];
+            for (p = start, q = spec; p < line+*pos; )
                 *q++ = *p++;
             *q++ = '*';
             *q++ = '.';
             *q++ = '*';
             *q = '\0';
-            rc = -1L;       /* force getfirstnondot() */
+            scan_completions(spec,start==line);
         }
-        if (rc < 0L)        /* no more files */
-            rc = getfirstnondot(fsfbuf,start==line);
-        if (rc == 0L) {
+        name = next_completion(prevcode!=TAB,start==line);
+        if (name) {
             erase_line(insert,*pos-(insert-line));
-            for (q = insert, p = dta->d_fname; *p; ) {
-                conout(*p);
-                *q++ = *p++;
+            for (q = insert; *name; ) {
+                conout(*name);
+                *q++ = *name++;
             }
             *q = '\0';
             *pos = *len = q - line;
@@ -441,6 +476,85 @@ WORD gotword = 0;
     return pos;
 }
 
+/*
+ *  set up the names for tab completion of 'spec'
+ *
+ *  if the names for the previous completion are still valid, they are
+ *  reused; otherwise they are read into tab_names[] if they fit
+ */
+PRIVATE void scan_completions(const char *spec,WORD executable_only)
+{
+char *p, *end;
+LONG rc;
+WORD len, n;
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PATH_CACHE
+char dir[MAXPATHLEN];
+WORD drive;
+
+    /*
+     * a relative spec with a drive letter depends on the current
+     * directory of that drive, so we don't try to reuse it; we also
+     * don't reuse names from removable drives, since the BDOS doesn't
+     * see a media change until it accesses the drive
+     */
+    get_path(dir,0);
+    drive = (spec[1] == DRIVESEP) ? (toupper(spec[0]) - 'A') : Dgetdrv();
+    if ((tab_count >= 0) && (tab_exec == executable_only) && (tab_chgcnt == dirchgcnt)
+     && ((spec[1] != DRIVESEP) || (spec[2] == PATHSEP))
+     && (drive >= 0) && (drive < BLKDEVNUM) && !(drvrem & (1L << drive))
+     && strequal(spec,fsfbuf) && strequal(dir,tab_dir))
+        return;
+    tab_chgcnt = dirchgcnt;
+    strcpy(tab_dir,dir);
+#endif
+
+    strcpy(fsfbuf,spec);
+    tab_count = -1;
+    if (!tab_names)
+        return;
+
+    end = tab_names + TAB_NAMES_SIZE;
+    for (rc = getfirstnondot(fsfbuf,executable_only), p = tab_names, n = 0; rc == 0; rc = getnextfile(executable_only), n++) {
+        len = strlen(dta->d_fname) + 1;
+        if (p+len > end)    /* too many, use Fsfirst()/Fsnext() instead */
+            return;
+        strcpy(p,dta->d_fname);
+        p += len;
+    }
+
+    tab_count = n;
+    tab_exec = executable_only;
+}
+
+/*
+ *  return the next name for tab completion, cycling back to the first
+ *  one after the last; returns NULL if there are none
+ */
+PRIVATE const char *next_completion(WORD first,WORD executable_only)
+{
+const char *name;
+LONG rc;
+
+    if (tab_count >= 0) {           /* names are in tab_names[] */
+        if (tab_count == 0)
+            return NULL;
+        if (first || (tab_used >= tab_count)) {
+            tab_next = tab_names;
+            tab_used = 0;
+        }
+        name = tab_next;
+        tab_next += strlen(name) + 1;
+        tab_used++;
+        return name;
+    }
+
+    rc = first ? -1L : getnextfile(executable_only);
+    if (rc < 0L)                    /* no more files */
+        rc = getfirstnondot(fsfbuf,executable_only);
+
+    return rc ? NULL : dta->d_fname;
+}
+
 /*
  *  get first file/folder in dir that doesn't start with .
  */
@@ -14,6 +14,25 @@
 
 static UWORD old_stdout;
 
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PATH_CACHE
+#define NUM_PATHCACHE   8       /* must be a power of 2 */
+
+/*
+ *  the results of recent successful searches of user_path[], indexed by
+ *  a hash of the name searched for.  an entry is valid while its 'chgcnt'
+ *  matches the BDOS directory change counter; all entries are discarded
+ *  if user_path[] changes.
+ */
+typedef struct {
+    ULONG chgcnt;               /* value of 'dirchgcnt' when found */
+    char name[LEN_ZFNAME];      /* name searched for */
+    char fullname[MAXPATHLEN];  /* full name of executable found */
+} PATHENT;
+
+static PATHENT path_cache[NUM_PATHCACHE];
+static UWORD path_hash;         /* hash of user_path[] for the above */
+#endif
+
 /*
  *  function prototypes
  */
@@ -22,6 +41,9 @@ PRIVATE WORD build_cmdline(char *cmdline,WORD argc,char **argv);
 PRIVATE WORD check_user_path(char *path,const char *name);
 PRIVATE WORD find_executable(char *fullname,const char *name);
 PRIVATE WORD is_graphical(const char *name);
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PATH_CACHE
+PRIVATE UWORD str_hash(const char *s);
+#endif
 PRIVATE LONG redirect_stdout(char *redir);
 PRIVATE void restore_stdout(char *redir);
 
@@ -113,13 +135,49 @@ PRIVATE WORD check_user_path(char *path,const char *name)
 {
 char temp[MAXPATHLEN];
 const char *p;
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PATH_CACHE
+PATHENT *pe = NULL;
+ULONG chgcnt;
+UWORD hash;
+WORD i, drive;
+
+    hash = str_hash(user_path);
+    if (hash != path_hash) {        /* PATH has changed */
+        for (i = 0; i < NUM_PATHCACHE; i++)
+            path_cache[i].name[0] = '\0';
+        path_hash = hash;
+    }
+
+    if (strlen(name) < LEN_ZFNAME) {
+        pe = &path_cache[str_hash(name)&(NUM_PATHCACHE-1)];
+        if (pe->name[0] && (pe->chgcnt == dirchgcnt) && strequal(pe->name,name)) {
+            strcpy(path,pe->fullname);
+            return 0;
+        }
+    }
+    chgcnt = dirchgcnt;
+#endif
 
     for (p = user_path; *p; ) {
         if (get_path_component(&p,temp) == 0)
             return -1;
         add_to_path(temp,name);
-        if (find_executable(path,temp) == 0)
+        if (find_executable(path,temp) == 0) {
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PATH_CACHE
+            /*
+             * don't remember names on removable drives, since the BDOS
+             * doesn't see a media change until it accesses the drive
+             */
+            drive = (path[1] == DRIVESEP) ? (toupper(path[0]) - 'A') : Dgetdrv();
+            if (pe && (strlen(path) < MAXPATHLEN) && (drive >= 0) && (drive < BLKDEVNUM)
+             && !(drvrem & (1L << drive))) {
+                pe->chgcnt = chgcnt;
+                strcpy(pe->name,name);
+                strcpy(pe->fullname,path);
+            }
+#endif
             return 0;
+        }
     }
 
     return -1;
@@ -170,6 +228,21 @@ LONG rc;
     return -1;
 }
 
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PATH_CACHE
+/*
+ *  return a simple case-insensitive hash of a string
+ */
+PRIVATE UWORD str_hash(const char *s)
+{
+UWORD hash = 0;
+
+    while(*s)
+        hash = ((hash << 3) | (hash >> 13)) + toupper((UBYTE)*s++);
+
+    return hash;
+}
+#endif
+
 /*
  *  test type of executed program
  */
@@ -24,8 +24,12 @@ typedef struct {
 /*
  *  function prototypes
  */
+PRIVATE char *alloc_iobuf(LONG *size);
 PRIVATE LONG check_path_component(char *component);
+PRIVATE LONG copy_file(const char *inname,const char *outname,char *iobuf,LONG bufsize);
 PRIVATE LONG copy_move(WORD argc,char **argv,WORD delete);
+PRIVATE LONG copy_recursive(char *src,char *dest);
+PRIVATE LONG copy_tree(char *inpath,char *outpath,char *iobuf,LONG bufsize,WORD depth);
 PRIVATE void display_dta_detail(void);
 PRIVATE char *extract_path(char *dest,const char *src);
 PRIVATE void fixup_filespec(char *filespec);
@@ -34,12 +38,15 @@ PRIVATE void help_display(const COMMAND *p);
 PRIVATE WORD help_lines(const COMMAND *p);
 PRIVATE WORD help_pause(void);
 PRIVATE WORD help_wanted(const COMMAND *p,char *cmd);
+PRIVATE WORD is_dot_dir(const char *name);
 PRIVATE LONG is_valid_drive(char drive_letter);
 PRIVATE void output(const char *s);
 PRIVATE void outputnl(const char *s);
 PRIVATE LONG outputbuf(const char *s,LONG len,WORD paging);
 PRIVATE LONG output_files(WORD argc,char **argv,WORD paging);
 PRIVATE void padname(char *buf,const char *name);
+PRIVATE LONG remove_recursive(char *dir,WORD prompt);
+PRIVATE LONG remove_tree(char *path,WORD prompt,WORD depth);
 PRIVATE void show_line(const char *title,ULONG n);
 PRIVATE WORD user_break(void);
 PRIVATE WORD user_input(WORD c);
@@ -49,18 +56,26 @@ PRIVATE LONG run_cd(WORD argc,char **argv);
 PRIVATE LONG run_chmod(WORD argc,char **argv);
 PRIVATE LONG run_cls(WORD argc,char **argv);
 PRIVATE LONG run_cp(WORD argc,char **argv);
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_BDOS_PROFILE
+PRIVATE LONG run_dosprof(WORD argc,char **argv);
+#endif
 PRIVATE LONG run_echo(WORD argc,char **argv);
 PRIVATE LONG run_help(WORD argc,char **argv);
+PRIVATE LONG run_history(WORD argc,char **argv);
 PRIVATE LONG run_ls(WORD argc,char **argv);
 PRIVATE LONG run_mkdir(WORD argc,char **argv);
 PRIVATE LONG run_more(WORD argc,char **argv);
 PRIVATE LONG run_mode(WORD argc,char **argv);
 PRIVATE LONG run_path(WORD argc,char **argv);
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PROCTIME
+PRIVATE LONG run_ps(WORD argc,char **argv);
+#endif
 PRIVATE LONG run_pwd(WORD argc,char **argv);
 PRIVATE LONG run_mv(WORD argc,char **argv);
 PRIVATE LONG run_ren(WORD argc,char **argv);
 PRIVATE LONG run_rm(WORD argc,char **argv);
 PRIVATE LONG run_rmdir(WORD argc,char **argv);
+PRIVATE LONG run_run(WORD argc,char **argv);
 PRIVATE LONG run_setdrv(WORD argc,char **argv);
 PRIVATE LONG run_show(WORD argc,char **argv);
 PRIVATE LONG run_version(WORD argc,char **argv);
@@ -80,10 +95,18 @@ LOCAL const char * const help_chmod[] = { "<mode> <filename>",
     N_("r=read-only  h=hidden  s=system  -=none"), NULL };
 LOCAL const char * const help_cls[] = { "",
     N_("Clear screen"), NULL };
-LOCAL const char * const help_cp[] = { "<filespec> <dest>",
+LOCAL const char * const help_cp[] = { "[-r] <filespec> <dest>",
     N_("Copy files matching <filespec> to <dest>"),
     N_("If <filespec> matches multiple files,"),
-    N_("<dest> must be a directory"), NULL };
+    N_("<dest> must be a directory"),
+    N_("Specify -r to copy directory <filespec>"),
+    N_("and all its contents"), NULL };
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_BDOS_PROFILE
+LOCAL const char * const help_dosprof[] = { "[reset]",
+    N_("Display the number of calls and the time spent"),
+    N_("in each GEMDOS function, and buffer cache hits"),
+    N_("Specify reset to clear the counters"), NULL };
+#endif
 LOCAL const char * const help_echo[] = { "<string> ...",
     N_("Copy <string> ... to standard output"),
     N_("Strings may be surrounded by \"\""), NULL };
@@ -93,6 +116,9 @@ LOCAL const char * const help_help[] = { "[<cmd>]",
     N_("Get help about <cmd> or list available commands"),
     N_("Use HELP ALL for help on all commands"),
     N_("Use HELP EDIT for help on line editing"), NULL };
+LOCAL const char * const help_history[] = { "",
+    N_("Display the command history, oldest first"),
+    N_("Use HISTORY >file to save it to disk"), NULL };
 LOCAL const char * const help_ls[] = { "[-l] <path>",
     N_("List files (default terse, horizontal)"),
     N_("Specify -l for detailed list"), NULL };
@@ -111,15 +137,27 @@ LOCAL const char * const help_mv[] = { "<filespec> <dir>",
 LOCAL const char * const help_path[] = { "[<searchpath>]",
     N_("Set search path for external programs"),
     N_("or display current search path"), NULL };
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PROCTIME
+LOCAL const char * const help_ps[] = { "",
+    N_("Display the running time of the GEMDOS"),
+    N_("processes (current first) and AES processes"), NULL };
+#endif
 LOCAL const char * const help_pwd[] = { "",
     N_("Display current drive and directory"), NULL };
 LOCAL const char * const help_ren[] = { "<oldname> <newname>",
     N_("Rename <oldname> to <newname>"), NULL };
-LOCAL const char * const help_rm[] = { " [-q] <filespec>",
+LOCAL const char * const help_rm[] = { " [-q] [-r] <filespec>",
     N_("Delete files matching <filespec>"),
-    N_("Specify -q to be prompted each time"), NULL };
+    N_("Specify -q to be prompted each time"),
+    N_("Specify -r to delete directory <filespec>"),
+    N_("and all its contents"), NULL };
 LOCAL const char * const help_rmdir[] = { "<dir>",
     N_("Delete directory <dir>"), NULL };
+LOCAL const char * const help_run[] = { "<script> [<arg> ...]",
+    N_("Execute the commands in file <script>;"),
+    N_("%1-%9 are replaced by <arg> ..."),
+    N_("Stops at the first failing command,"),
+    N_("unless its line starts with '-'"), NULL };
 LOCAL const char * const help_show[] = { "[<drive>]",
     N_("Show info for <drive> or current drive"), NULL };
 LOCAL const char * const help_version[] = { "",
@@ -142,20 +180,28 @@ LOCAL const COMMAND cmdtable[] = {
     { "cd", NULL, 0, 1, run_cd, help_cd },
     { "chmod", NULL, 2, 2, run_chmod, help_chmod },
     { "cls", "clear", 0, 0, run_cls, help_cls },
-    { "cp", "copy", 2, 2, run_cp, help_cp },
+    { "cp", "copy", 2, 3, run_cp, help_cp },
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_BDOS_PROFILE
+    { "dosprof", NULL, 0, 1, run_dosprof, help_dosprof },
+#endif
     { "echo", NULL, 0, 255, run_echo, help_echo },
     { "exit", NULL, 0, 0, LOOKUP_EXIT, help_exit },
     { "help", NULL, 0, 1, run_help, help_help },
+    { "history", NULL, 0, 0, run_history, help_history },
     { "ls", "dir", 0, 2, run_ls, help_ls },
     { "mkdir", "md", 1, 1, run_mkdir, help_mkdir },
     { "mode", NULL, 1, 4, run_mode, help_mode },
     { "more", NULL, 1, 1, run_more, help_more },
     { "mv", "move", 2, 2, run_mv, help_mv },
     { "path", NULL, 0, 1, run_path, help_path },
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PROCTIME
+    { "ps", NULL, 0, 0, run_ps, help_ps },
+#endif
     { "pwd", NULL, 0, 0, run_pwd, help_pwd },
     { "ren", NULL, 2, 2, run_ren, help_ren },
-    { "rm", "del", 1, 2, run_rm, help_rm },
+    { "rm", "del", 1, 3, run_rm, help_rm },
     { "rmdir", "rd", 1, 1, run_rmdir, help_rmdir },
+    { "run", NULL, 1, 10, run_run, help_run },
     { "show", NULL, 0, 1, run_show, help_show },
     { "version", NULL, 0, 0, run_version, help_version },
     { "wrap", NULL, 0, 1, run_wrap, help_wrap },
@@ -297,9 +343,63 @@ PRIVATE LONG run_cls(WORD argc,char **argv)
 
 PRIVATE LONG run_cp(WORD argc,char **argv)
 {
+    if (argc == 4) {
+        if (!strequal(argv[1],"-r"))
+            return INVALID_PARAM;
+        return copy_recursive(argv[2],argv[3]);
+    }
+
     return copy_move(argc,argv,0);
 }
 
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_BDOS_PROFILE
+PRIVATE LONG run_dosprof(WORD argc,char **argv)
+{
+DOSPROF dp;
+DOSCACHE dc;
+char buf[80];
+LONG rc;
+WORD i;
+
+    if (argc > 1) {
+        if (!strequal(argv[1],"RESET"))
+            return INVALID_PARAM;
+        return Sdosprof(DP_RESET,0,NULL);
+    }
+
+    outputnl("func     calls         ms  <5ms <10ms <40ms <160 <640 >=640");
+    for (i = 0; (rc = Sdosprof(DP_FUNCTION,i,&dp)) == 0L; i++) {
+        if (!dp.dp_calls)
+            continue;
+        sprintf(buf,"0x%02x %9lu %10lu",i,dp.dp_calls,dp.dp_ticks*5);
+        output(buf);
+        if (dp.dp_hist[0] || dp.dp_hist[1] || dp.dp_hist[2] || dp.dp_hist[3]
+         || dp.dp_hist[4] || dp.dp_hist[5]) {
+            sprintf(buf," %5lu %5lu %5lu %4lu %4lu %5lu",dp.dp_hist[0],dp.dp_hist[1],
+                    dp.dp_hist[2],dp.dp_hist[3],dp.dp_hist[4],dp.dp_hist[5]);
+            output(buf);
+        }
+        outputnl("");
+    }
+    if (i == 0)             /* not supported */
+        return rc;
+
+    rc = Sdosprof(DP_CACHE,0,&dc);
+    if (rc < 0L)
+        return rc;
+    sprintf(buf,"cache: %lu lookups, %lu misses",dc.dc_lookups,dc.dc_misses);
+    output(buf);
+    if (dc.dc_lookups) {
+        sprintf(buf,", %lu%% hits",
+                ((dc.dc_lookups-dc.dc_misses)*100)/dc.dc_lookups);
+        output(buf);
+    }
+    outputnl("");
+
+    return 0L;
+}
+#endif
+
 PRIVATE LONG run_echo(WORD argc,char **argv)
 {
 WORD i;
@@ -358,6 +458,18 @@ const char * const *s;
     return 0L;
 }
 
+PRIVATE LONG run_history(WORD argc,char **argv)
+{
+const char *p;
+WORD i;
+
+    for (i = 0; (p = get_history(i)); i++)
+        if (*p)
+            outputnl(p);
+
+    return 0L;
+}
+
 PRIVATE LONG run_ls(WORD argc,char **argv)
 {
 char filespec[MAXPATHLEN];
@@ -489,6 +601,42 @@ const char *p;
     return 0L;
 }
 
+#if !defined(STANDALONE_CONSOLE) && CONF_WITH_PROCTIME
+PRIVATE LONG run_ps(WORD argc,char **argv)
+{
+PROCTIME pt;
+char buf[40];
+LONG rc;
+WORD i;
+
+    rc = Sproctime(PT_GEMDOS,0,&pt);
+    if (rc < 0L)
+        return rc;
+
+    outputnl("GEMDOS   basepage      seconds");
+    for (i = 1; rc == 0L; i++) {
+        sprintf(buf,"         %08lx %9lu.%02lu",pt.pt_id,
+                pt.pt_ticks/200,(pt.pt_ticks%200)/2);
+        outputnl(buf);
+        rc = Sproctime(PT_GEMDOS,i,&pt);
+    }
+
+    rc = Sproctime(PT_AES,0,&pt);
+    if (rc < 0L)            /* the AES is not running */
+        return 0L;
+
+    outputnl("AES  id  name          seconds");
+    for (i = 1; rc == 0L; i++) {
+        sprintf(buf,"     %2ld  %-8s  %9lu.%02lu",pt.pt_id,pt.pt_name,
+                pt.pt_ticks/200,(pt.pt_ticks%200)/2);
+        outputnl(buf);
+        rc = Sproctime(PT_AES,i,&pt);
+    }
+
+    return 0L;
+}
+#endif
+
 PRIVATE LONG run_pwd(WORD argc,char **argv)
 {
 char buf[MAXPATHLEN];
@@ -507,20 +655,29 @@ PRIVATE LONG run_ren(WORD argc,char **argv)
 
 PRIVATE LONG run_rm(WORD argc,char **argv)
 {
-WORD prompt = 0;
+char name[MAXPATHLEN];
+char *p;
+WORD prompt = 0, recurse = 0;
 LONG rc;
 
     argc--;
     argv++;
 
-    if (strequal(*argv,"-q")) {
-        prompt = 1;
+    while((argc > 1) && (**argv == '-')) {
+        if (strequal(*argv,"-q"))
+            prompt = 1;
+        else if (strequal(*argv,"-r"))
+            recurse = 1;
+        else return INVALID_PARAM;
         argc--;
         argv++;
     }
 
-    if (argc == 0)
-        return 0L;
+    if (argc != 1)
+        return WRONG_NUM_ARGS;
+
+    if (recurse)
+        return remove_recursive(*argv,prompt);
 
     if (has_wildcard(*argv)) {
         message(_("Delete ALL matching files"));
@@ -528,6 +685,7 @@ LONG rc;
             return 0;
     }
 
+    p = extract_path(name,*argv);
     for (rc = Fsfirst(*argv,0x17); rc == 0; rc = Fsnext()) {
         if (prompt) {
             message(_("Delete file "));
@@ -535,7 +693,8 @@ LONG rc;
             if (getyn() != 'y')
                 continue;
         }
-        rc = Fdelete(*argv);
+        strcpy(p,dta->d_fname);         /* add name to path */
+        rc = Fdelete(name);
         if (rc < 0L) {
             if (rc == EACCDN)
                 rc = CANT_DELETE;
@@ -558,6 +717,11 @@ LONG rc;
     return (rc==EACCDN) ? DIR_NOT_EMPTY : rc;
 }
 
+PRIVATE LONG run_run(WORD argc,char **argv)
+{
+    return run_script(argc-1,argv+1);
+}
+
 PRIVATE LONG run_setdrv(WORD argc,char **argv)
 {
     if (!is_valid_drive(argv[0][0]))
@@ -787,7 +951,7 @@ PRIVATE LONG copy_move(WORD argc,char **argv,WORD delete)
 {
 char inname[MAXPATHLEN], outname[MAXPATHLEN], fullname[MAXPATHLEN];
 char *inptr, *outptr;
-WORD in, out, output_is_dir = 0;
+WORD output_is_dir = 0;
 char *iobuf;
 LONG bufsize, n, rc;
 
@@ -831,8 +995,7 @@ LONG bufsize, n, rc;
         *outptr = '\0';
     }
 
-    bufsize = IOBUFSIZE;
-    iobuf = (char *)Malloc(bufsize);
+    iobuf = alloc_iobuf(&bufsize);
     if (!iobuf)
         return ENSMEM;
 
@@ -855,46 +1018,25 @@ LONG bufsize, n, rc;
             continue;
         }
 
+        /*
+         * for a move, try a rename first: this avoids copying the
+         * data when the input & output are on the same drive
+         */
+        if (delete && (Frename(0,inname,outname) == 0L)) {
+            message(_("Moving "));
+            message(inname);
+            message(_(" to "));
+            message(outname);
+            messagenl(_(" ... done"));
+            continue;
+        }
+
         message(_("Copying "));
         message(inname);
         message(_(" to "));
         message(outname);
 
-        rc = Fopen(inname,0);
-        if (rc < 0L)
-            break;
-        in = LOWORD(rc);
-
-        rc = Fcreate(outname,0);
-        if (rc < 0L) {
-            Fclose(in);
-            break;
-        }
-        out = LOWORD(rc);
-
-        do {
-            /* allow user to interrupt during file copy/move */
-            if (constat()) {
-                if (user_break()) {
-                    rc = USER_BREAK;
-                    break;
-                }
-            }
-            n = rc = Fread(in,bufsize,iobuf);
-            if (rc < 0L)
-                break;
-            rc = Fwrite(out,n,iobuf);
-            if (rc < 0L)
-                break;
-            if (rc != n)
-                rc = DISK_FULL;
-        } while(rc > 0L);
-        Fclose(in);
-        Fclose(out);
-
-        /* if the copy failed, delete the output to avoid an incomplete file */
-        if (rc < 0L)
-            Fdelete(outname);
+        rc = copy_file(inname,outname,iobuf,bufsize);
 
         if (delete && (rc == 0L)) { /* don't delete unless copy successful */
             message(_(" ... deleting "));
@@ -917,6 +1059,317 @@ LONG bufsize, n, rc;
     return rc;
 }
 
+/*
+ *  copy a directory and all its contents
+ *
+ *  if 'dest' is an existing directory, the copy is made within it;
+ *  otherwise 'dest' is created as the copy
+ */
+PRIVATE LONG copy_recursive(char *src,char *dest)
+{
+char inpath[MAXPATHLEN], outpath[MAXPATHLEN];
+char *iobuf, *p;
+const char *name;
+LONG bufsize, rc;
+WORD len;
+
+    rc = make_absolute(inpath,src);
+    if (rc == 0L)
+        rc = check_path_component(inpath);
+    if (rc == NOT_DIRECTORY) {
+        message(src);
+        messagenl(_(" is not a directory"));
+        return 0;           /* because we already issued a message */
+    }
+    if (rc < 0L)
+        return rc;
+
+    rc = make_absolute(outpath,dest);
+    if (rc < 0L)
+        return rc;
+
+    /* remove any trailing separators, except from the root */
+    for (p = inpath+strlen(inpath); (*(p-1) == PATHSEP) && (*(p-2) != DRIVESEP); )
+        *--p = '\0';
+    for (p = outpath+strlen(outpath); (*(p-1) == PATHSEP) && (*(p-2) != DRIVESEP); )
+        *--p = '\0';
+
+    /* copying into an existing directory: add the source directory name */
+    for (name = inpath+strlen(inpath); (name > inpath) && (*(name-1) != PATHSEP); name--)
+        ;
+    if (*name && (check_path_component(outpath) == 0L)) {
+        p = outpath + strlen(outpath);
+        if (*(p-1) != PATHSEP)
+            *p++ = PATHSEP;
+        if (p+strlen(name) >= outpath+MAXPATHLEN)
+            return EPTHNF;
+        strcpy(p,name);
+    }
+
+    /* don't copy a directory into itself */
+    len = strlen(inpath);
+    if ((strncasecmp(inpath,outpath,len) == 0)
+     && ((outpath[len] == '\0') || (outpath[len] == PATHSEP) || (inpath[len-1] == PATHSEP))) {
+        message(outpath);
+        messagenl(_(" is within the source directory"));
+        return 0;           /* because we already issued a message */
+    }
+
+    iobuf = alloc_iobuf(&bufsize);
+    if (!iobuf)
+        return ENSMEM;
+
+    rc = copy_tree(inpath,outpath,iobuf,bufsize,0);
+    Fsetdta(dta);
+
+    Mfree(iobuf);
+
+    return rc;
+}
+
+/*
+ *  copy the contents of directory 'inpath' to directory 'outpath',
+ *  creating the latter if necessary
+ *
+ *  the paths are extended while processing subdirectories, and
+ *  restored on return.  each level uses its own DTA, so the caller
+ *  must restore the global one afterwards.
+ */
+PRIVATE LONG copy_tree(char *inpath,char *outpath,char *iobuf,LONG bufsize,WORD depth)
+{
+DTA treedta;
+char *inptr, *outptr;
+WORD inlen, outlen;
+LONG rc;
+
+    if (depth >= MAX_TREE_DEPTH)
+        return EPTHNF;
+
+    rc = Dcreate(outpath);
+    if ((rc < 0L) && (rc != EACCDN))    /* EACCDN => already exists */
+        return rc;
+
+    inlen = strlen(inpath);
+    outlen = strlen(outpath);
+    if ((inlen+sizeof(treedta.d_fname) >= MAXPATHLEN) || (outlen+sizeof(treedta.d_fname) >= MAXPATHLEN))
+        return EPTHNF;
+    inptr = inpath + inlen;
+    if (*(inptr-1) != PATHSEP)
+        *inptr++ = PATHSEP;
+    outptr = outpath + outlen;
+    if (*(outptr-1) != PATHSEP)
+        *outptr++ = PATHSEP;
+
+    strcpy(inptr,"*.*");
+    Fsetdta(&treedta);
+    for (rc = Fsfirst(inpath,0x17); rc == 0; rc = Fsnext()) {
+        /* allow user to interrupt or pause before every file/folder */
+        if (constat()) {
+            if (user_input(-1)) {
+                rc = USER_BREAK;
+                break;
+            }
+        }
+        if (is_dot_dir(treedta.d_fname))
+            continue;
+        strcpy(inptr,treedta.d_fname);
+        strcpy(outptr,treedta.d_fname);
+        if (treedta.d_attrib & 0x10) {
+            rc = copy_tree(inpath,outpath,iobuf,bufsize,depth+1);
+            Fsetdta(&treedta);
+        } else {
+            message(_("Copying "));
+            message(inpath);
+            message(_(" to "));
+            message(outpath);
+            rc = copy_file(inpath,outpath,iobuf,bufsize);
+            if (rc < 0L)
+                message(" ... ");
+            else messagenl(_(" ... done"));
+        }
+        if (rc < 0L)
+            break;
+    }
+
+    inpath[inlen] = '\0';
+    outpath[outlen] = '\0';
+
+    if ((rc == ENMFIL) || (rc == EFILNF))   /* not really errors */
+        rc = 0L;
+
+    return rc;
+}
+
+/*
+ *  copy the data of one file, using the specified buffer
+ *
+ *  if the copy fails, the output is deleted to avoid an incomplete file
+ */
+PRIVATE LONG copy_file(const char *inname,const char *outname,char *iobuf,LONG bufsize)
+{
+WORD in, out;
+LONG n, rc;
+
+    rc = Fopen(inname,0);
+    if (rc < 0L)
+        return rc;
+    in = LOWORD(rc);
+
+    rc = Fcreate(outname,0);
+    if (rc < 0L) {
+        Fclose(in);
+        return rc;
+    }
+    out = LOWORD(rc);
+
+    do {
+        /* allow user to interrupt during file copy/move */
+        if (constat()) {
+            if (user_break()) {
+                rc = USER_BREAK;
+                break;
+            }
+        }
+        n = rc = Fread(in,bufsize,iobuf);
+        if (rc < 0L)
+            break;
+        rc = Fwrite(out,n,iobuf);
+        if (rc < 0L)
+            break;
+        if (rc != n)
+            rc = DISK_FULL;
+    } while(rc > 0L);
+    Fclose(in);
+    Fclose(out);
+
+    if (rc < 0L)
+        Fdelete(outname);
+
+    return rc;
+}
+
+/*
+ *  allocate a buffer for copying files
+ *
+ *  the buffer is as large as possible (leaving a little memory free),
+ *  so that big files are copied with few Fread()/Fwrite() calls.  its
+ *  size is a multiple of 512, so that whole sectors can be transferred
+ *  directly.
+ */
+PRIVATE char *alloc_iobuf(LONG *size)
+{
+LONG n;
+
+    n = (Malloc(-1L) - IOBUF_RESERVE) & ~511L;
+    if (n < IOBUFSIZE)
+        n = IOBUFSIZE;
+    *size = n;
+
+    return (char *)Malloc(n);
+}
+
+/*
+ *  delete a directory and all its contents
+ */
+PRIVATE LONG remove_recursive(char *dir,WORD prompt)
+{
+char path[MAXPATHLEN];
+char *p;
+LONG rc;
+
+    rc = make_absolute(path,dir);
+    if (rc == 0L)
+        rc = check_path_component(path);
+    if (rc == NOT_DIRECTORY) {
+        message(dir);
+        messagenl(_(" is not a directory"));
+        return 0;           /* because we already issued a message */
+    }
+    if (rc < 0L)
+        return rc;
+
+    /* remove any trailing separators, and refuse to delete the root */
+    for (p = path+strlen(path); (*(p-1) == PATHSEP) && (*(p-2) != DRIVESEP); )
+        *--p = '\0';
+    if (*(p-1) == PATHSEP)
+        return INVALID_PARAM;
+
+    message(_("Delete "));
+    message(path);
+    message(_(" and ALL its contents"));
+    if (getyn() != 'y')
+        return 0L;
+
+    rc = remove_tree(path,prompt,0);
+    Fsetdta(dta);
+
+    return rc;
+}
+
+/*
+ *  delete the contents of directory 'path', then the directory itself
+ *
+ *  the path is extended while processing subdirectories, and restored
+ *  on return.  each level uses its own DTA, so the caller must restore
+ *  the global one afterwards.
+ */
+PRIVATE LONG remove_tree(char *path,WORD prompt,WORD depth)
+{
+DTA treedta;
+char *p;
+WORD len;
+LONG rc;
+
+    if (depth >= MAX_TREE_DEPTH)
+        return EPTHNF;
+
+    len = strlen(path);
+    if (len+sizeof(treedta.d_fname) >= MAXPATHLEN)
+        return EPTHNF;
+    p = path + len;
+    *p++ = PATHSEP;
+
+    strcpy(p,"*.*");
+    Fsetdta(&treedta);
+    for (rc = Fsfirst(path,0x17); rc == 0; rc = Fsnext()) {
+        if (constat()) {
+            if (user_input(-1)) {
+                rc = USER_BREAK;
+                break;
+            }
+        }
+        if (is_dot_dir(treedta.d_fname))
+            continue;
+        strcpy(p,treedta.d_fname);
+        if (treedta.d_attrib & 0x10) {
+            rc = remove_tree(path,prompt,depth+1);
+            Fsetdta(&treedta);
+        } else {
+            if (prompt) {
+                message(_("Delete file "));
+                message(path);
+                if (getyn() != 'y')
+                    continue;
+            }
+            rc = Fdelete(path);
+            if (rc == EACCDN)
+                rc = CANT_DELETE;
+        }
+        if (rc < 0L)
+            break;
+    }
+
+    path[len] = '\0';
+
+    if ((rc == ENMFIL) || (rc == EFILNF)) {
+        rc = Ddelete(path);
+        if (rc == EACCDN)
+            rc = DIR_NOT_EMPTY;
+    }
+
+    return rc;
+}
+
 /*
  *  get specified drive's current path (including drive letter) into buffer
  *
@@ -1102,6 +1555,19 @@ char buf[80], *p = buf;
     outputnl(buf);
 }
 
+/*
+ *  returns TRUE iff the name is . or ..
+ */
+PRIVATE WORD is_dot_dir(const char *name)
+{
+    if (*name++ != '.')
+        return FALSE;
+    if (*name == '.')
+        name++;
+
+    return (*name == '\0');
+}
+
 PRIVATE LONG is_valid_drive(char drive_letter)
 {
 ULONG drvbits;
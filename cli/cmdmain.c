@@ -16,9 +16,10 @@
  *      execution of standard TOS programs
  *      commandline history & editing
  *      output redirection
+ *      simple script files (via the 'run' builtin)
  *
  * The following omissions are deliberate:
- *      no batch/shell files
+ *      no control flow or variables in scripts, other than arguments
  *      no input redirection or pipes
  */
 #include "cmd.h"
@@ -46,14 +47,27 @@ LOCAL char redir_name[MAXPATHLEN];
 LOCAL WORD original_res;
 LOCAL WORD original_color3;
 LOCAL LONG vdo_value;
+LOCAL LONG command_rc;          /* return code from last command executed */
+LOCAL WORD script_depth;        /* current nesting level of scripts */
+
+/*
+ * work areas for executing a script, allocated along with the script
+ * text so that nested scripts do not use up the stack
+ */
+typedef struct {
+    char line[MAX_LINE_SIZE];
+    char *argv[MAX_ARGS];
+    char redir[MAXPATHLEN];
+} SCRIPT_WORK;
 
 /*
  *  function prototypes
  */
 PRIVATE void change_res(WORD res);
-PRIVATE void close_redir(void);
+PRIVATE void close_redir(char *name,LONG old_handle);
 PRIVATE void create_redir(const char *name);
 PRIVATE WORD execute(WORD argc,char **argv,char *redir);
+PRIVATE WORD expand_line(char *dest,const char *src,WORD argc,char **argv);
 PRIVATE WORD get_nflops(void);
 PRIVATE void strip_quotes(int argc,char **argv);
 PRIVATE void getenv(char **ppath, const char *psrch);
@@ -151,7 +165,9 @@ WORD argc, rc;
 PRIVATE WORD execute(WORD argc,char **argv,char *redir)
 {
 FUNC *func;
-LONG rc;
+LONG rc, old_handle;
+
+    command_rc = 0L;
 
     if (argc == 0)
         return 0;
@@ -160,19 +176,151 @@ LONG rc;
     if (func == LOOKUP_EXIT)    /* exit/quit */
         return -1;
 
+    /*
+     * builtins inherit the redirection (if any) of the script that
+     * they are run from, unless they are redirected themselves
+     */
+    old_handle = redir_handle;
     if (func == LOOKUP_ARGS)
         rc = WRONG_NUM_ARGS;
     else if (func) {
         create_redir(redir);
         strip_quotes(argc,argv);
         rc = func(argc,argv);
-        close_redir();
+        close_redir(redir,old_handle);
         if (rc == CHANGE_RES)
             return 1;
     }
-    else rc = exec_program(argc,argv,redir);
+    else {
+        rc = exec_program(argc,argv,redir);
+        redir_handle = old_handle;
+    }
 
     errmsg(rc);
+    command_rc = rc;
+
+    return 0;
+}
+
+/*
+ *  execute the commands in a script file
+ *
+ *  argv[0] is the name of the script, and argv[1] onwards are the args
+ *  that replace %1 to %9 in the script lines.  lines that are empty or
+ *  start with '#' are ignored.  execution stops at the first command
+ *  that fails, unless its line starts with '-'.
+ */
+LONG run_script(WORD argc,char **argv)
+{
+SCRIPT_WORK *work;
+char *text, *p, *line;
+LONG len, rc;
+WORD handle, n, ignore;
+
+    if (script_depth >= MAX_SCRIPT_DEPTH)
+        return SCRIPT_NESTING;
+
+    rc = Fsfirst(argv[0],0x07);
+    if (rc < 0L)
+        return rc;
+    len = dta->d_length;
+
+    work = (SCRIPT_WORK *)Malloc(sizeof(SCRIPT_WORK)+len+1);
+    if (!work)
+        return ENSMEM;
+    text = (char *)(work+1);
+
+    rc = Fopen(argv[0],0);
+    if (rc >= 0L) {
+        handle = LOWORD(rc);
+        rc = Fread(handle,len,text);
+        Fclose(handle);
+    }
+    if (rc < 0L) {
+        Mfree(work);
+        return rc;
+    }
+    text[rc] = '\0';
+
+    script_depth++;
+
+    for (p = text, rc = 0L; *p; ) {
+        /* isolate the next line */
+        for (line = p; *p && (*p != '\r') && (*p != '\n'); p++)
+            ;
+        if (*p)
+            *p++ = '\0';
+
+        while(*line == ' ')
+            line++;
+        if (!*line || (*line == '#'))
+            continue;
+        ignore = (*line == '-');
+        if (ignore)
+            line++;
+
+        if (expand_line(work->line,line,argc,argv) < 0) {
+            rc = CMDLINE_LENGTH;
+            break;
+        }
+        work->redir[0] = '\0';
+        n = parse_line(work->line,work->argv,work->redir);
+        if (n < 0) {            /* parse error, already reported */
+            rc = SCRIPT_FAILED;
+            break;
+        }
+
+        n = execute(n,work->argv,work->redir);
+        if (n < 0)              /* 'exit' ends the script */
+            break;
+        if (n > 0) {            /* resolution change */
+            change_res(requested_res);
+            init_screen();
+        }
+
+        if (command_rc && !ignore) {    /* error, already reported */
+            rc = SCRIPT_FAILED;
+            break;
+        }
+    }
+
+    script_depth--;
+    Mfree(work);
+
+    return rc;
+}
+
+/*
+ *  copy a script line, replacing %0 to %9 by the corresponding args
+ *  and %% by %
+ *
+ *  returns -1 iff the result is too long
+ */
+PRIVATE WORD expand_line(char *dest,const char *src,WORD argc,char **argv)
+{
+char *end = dest + MAX_LINE_SIZE - 1;
+const char *q;
+WORD n;
+
+    while(*src) {
+        if ((*src == '%') && (src[1] >= '0') && (src[1] <= '9')) {
+            n = src[1] - '0';
+            src += 2;
+            q = (n < argc) ? argv[n] : "";
+            while(*q) {
+                if (dest >= end)
+                    return -1;
+                *dest++ = *q++;
+            }
+            continue;
+        }
+        if ((*src == '%') && (src[1] == '%'))
+            src++;
+        if (dest >= end)
+            return -1;
+        *dest++ = *src++;
+    }
+    *dest = '\0';
 
     return 0;
 }
@@ -181,9 +329,7 @@ PRIVATE void create_redir(const char *name)
 {
 LONG rc;
 
-    redir_handle = -1L;     /* no redirection */
-
-    if (!*name)
+    if (!*name)             /* keep any existing redirection */
         return;
 
     rc = Fcreate(name,0);
@@ -192,13 +338,13 @@ LONG rc;
     else redir_handle = rc;
 }
 
-PRIVATE void close_redir(void)
+PRIVATE void close_redir(char *name,LONG old_handle)
 {
-    if (redir_handle >= 0)
+    if (redir_handle != old_handle)
         Fclose((WORD)redir_handle);
 
-    redir_name[0] = '\0';
-    redir_handle = -1L;
+    *name = '\0';
+    redir_handle = old_handle;
 }
 
 /*
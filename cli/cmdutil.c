@@ -97,6 +97,11 @@ const char *p;
     case CANT_DELETE:
         p = _("can't delete file (read-only?)");
         break;
+    case SCRIPT_NESTING:
+        p = _("scripts nested too deeply");
+        break;
+    case SCRIPT_FAILED:     /* error has already been reported */
+        return;
     case INVALID_PARAM:
         p = _("invalid parameter");
         break;
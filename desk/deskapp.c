@@ -128,13 +128,6 @@
 
 #define INF_REV_LEVEL   0x02    /* revision level when creating EMUDESK.INF */
 
-/*
- * the following defines the number of bytes reserved for control panel
- * use at the start of the shell buffer.  these bytes are not modified
- * by EmuDesk, and are (currently) not saved to the EMUDESK.INF file.
- */
-#define CPDATA_LEN      128
-
 /*
  * the maximum size of an EMUDESK.INF line (see app_save())
  */
@@ -145,6 +138,33 @@ static WORD     inf_rev_level;  /* revision level of current EMUDESK.INF */
 
 static char     *atextptr;      /* current pointer within ANODE text buffer */
 
+#if CONF_WITH_ANODE_INDEX
+/*
+ * index of the ANODEs, for app_afind_by_name()
+ *
+ * each ANODE has two entries, one for its data name (a_pdata) and one
+ * for its application name (a_pappl), in the order in which they are
+ * checked by a search of the ANODE list.  an entry for a "*.EXT" pattern
+ * is chained from the hash bucket for EXT, and one for a full application
+ * pathname from the bucket for that pathname; entries for other patterns
+ * are chained together.  each chain is in ascending order, so the first
+ * match in a chain is the best one in it.
+ */
+#define NUM_AHASH       32          /* must be a power of 2 */
+#define AINDEX_NONE     (-1)
+
+typedef struct
+{
+    ANODE   *pa;
+    WORD    next;                   /* next entry in chain, or AINDEX_NONE */
+} AINDEX;
+
+static AINDEX   aindex[2*NUM_ANODES];   /* entry 2n+1 is an application entry */
+static WORD     ahash[NUM_AHASH];       /* first entry in each bucket chain */
+static WORD     awild;                  /* first entry in the pattern chain */
+static UWORD    aindex_gen;             /* G.g_agen when the index was built */
+#endif
+
 
 /* When we can't get EMUDESK.INF via shel_get() or by reading from
  * the disk, we create one dynamically from three sources:
@@ -199,6 +219,17 @@ void nomem_alert(void)
 }
 
 
+/*
+ *  Note that the ANODEs may have changed: this invalidates the f_pa &
+ *  f_isap values remembered in the FNODEs
+ */
+void app_changed(void)
+{
+    if (++G.g_agen == 0)
+        G.g_agen = 1;
+}
+
+
 /*
  *  Allocate an application object
  *
@@ -214,6 +245,7 @@ ANODE *app_alloc(void)
         G.g_aavail = pa->a_next;
         pa->a_next = G.g_ahead;
         G.g_ahead = pa;
+        app_changed();
     }
     else
         fun_alert(1, STAPGONE);
@@ -241,6 +273,7 @@ void app_free(ANODE *pa)
     }
     pa->a_next = G.g_aavail;
     G.g_aavail = pa;
+    app_changed();
 }
 
 
@@ -449,9 +482,14 @@ void app_tran(WORD bi_num)
 /*
  * set up ICONBLK stuff - all the hard work is done here
  *
+ * if 'copy' is FALSE, the icon masks & data remain valid for as long as the
+ * desktop runs (e.g. the builtin icons in ROM), so they are used in place.
+ * this is possible because mono icons are the same in standard format and
+ * in device-dependent format, so that they do not need to be transformed.
+ *
  * returns -1 iff insufficient memory
  */
-static WORD setup_iconblks(const ICONBLK *ibstart, WORD count)
+static WORD setup_iconblks(const ICONBLK *ibstart, WORD count, BOOL copy)
 {
     char *maskstart, *datastart, *allocmem;
     char *p;
@@ -470,9 +508,11 @@ static WORD setup_iconblks(const ICONBLK *ibstart, WORD count)
     /*
      * Allocate memory for:
      *  ICONBLKs
-     *  icon masks
-     *  icon data
+     *  icon masks (if copied)
+     *  icon data (if copied)
      */
+    if (!copy)
+        num_bytes = 0;
     allocmem = dos_alloc_anyram(count*(sizeof(ICONBLK)+2*num_bytes));
     if (!allocmem)
     {
@@ -498,21 +538,16 @@ static WORD setup_iconblks(const ICONBLK *ibstart, WORD count)
      */
     memcpy(G.g_iblist, ibstart, count*sizeof(ICONBLK));
 
-    /*
-     * Copy the icons' mask/data
-     */
-    for (i = 0, p = maskstart; i < count; i++, p += num_bytes)
-        memcpy(p, ibstart[i].ib_pmask, num_bytes);
-    for (i = 0, p = datastart; i < count; i++, p += num_bytes)
-        memcpy(p, ibstart[i].ib_pdata, num_bytes);
-
     /*
      * Fix up the ICONBLKs
      */
     for (i = 0, offset = 0; i < count; i++, offset += num_bytes)
     {
-        G.g_iblist[i].ib_pmask = (WORD *)(maskstart + offset);
-        G.g_iblist[i].ib_pdata = (WORD *)(datastart + offset);
+        if (copy)
+        {
+            G.g_iblist[i].ib_pmask = (WORD *)(maskstart + offset);
+            G.g_iblist[i].ib_pdata = (WORD *)(datastart + offset);
+        }
         G.g_iblist[i].ib_ptext = "";        /* precautionary */
         G.g_iblist[i].ib_char &= 0xff00;    /* strip any existing char */
         G.g_iblist[i].ib_ytext = ih;
@@ -520,6 +555,17 @@ static WORD setup_iconblks(const ICONBLK *ibstart, WORD count)
         G.g_iblist[i].ib_htext = gl_hschar + 2;
     }
 
+    if (!copy)
+        return 0;
+
+    /*
+     * Copy the icons' mask/data
+     */
+    for (i = 0, p = maskstart; i < count; i++, p += num_bytes)
+        memcpy(p, ibstart[i].ib_pmask, num_bytes);
+    for (i = 0, p = datastart; i < count; i++, p += num_bytes)
+        memcpy(p, ibstart[i].ib_pdata, num_bytes);
+
     /*
      * Finally we do the transforms
      */
@@ -595,7 +641,7 @@ static WORD setup_mono_icons(void)
         }
     }
 
-    rc = setup_iconblks(ibptr, n);
+    rc = setup_iconblks(ibptr, n, TRUE);
 
     rsrc_free();
 
@@ -640,6 +686,7 @@ static WORD initialise_anodes(void)
 
     G.g_ahead = (ANODE *) NULL;
     G.g_aavail = G.g_alist;
+    app_changed();
 
     return 0;
 }
@@ -670,7 +717,7 @@ static WORD app_rdicon(void)
             return 0;
     }
 
-    return setup_iconblks(icon_rs_iconblk, BUILTIN_IBLKS);
+    return setup_iconblks(icon_rs_iconblk, BUILTIN_IBLKS, FALSE);
 }
 
 
@@ -1034,6 +1081,33 @@ static void app_revit(void)
 }
 
 
+/*
+ *  Write a space and a 2-digit hex value to the EMUDESK.INF output
+ *  buffer; returns the updated buffer pointer
+ */
+static char *put_hex(char *pcurr, WORD value)
+{
+    *pcurr++ = ' ';
+
+    return put_2(pcurr, value);
+}
+
+
+/*
+ *  Copy a string plus its terminating '@', preceded by a space, to the
+ *  EMUDESK.INF output buffer; returns the updated buffer pointer
+ */
+static char *put_str(char *pcurr, const char *str)
+{
+    *pcurr++ = ' ';
+    while(*str)
+        *pcurr++ = *str++;
+    *pcurr++ = '@';
+
+    return pcurr;
+}
+
+
 /*
  *  Perform the actual save of the EMUDESK.INF file
  */
@@ -1254,14 +1328,26 @@ void app_save(WORD todisk)
         default:
             type = ' ';
         }
-        pcurr += sprintf(pcurr,"#%c",type);
+        /*
+         * this loop runs once per ANODE, so we build the line directly
+         * rather than via sprintf(); the output is identical
+         */
+        *pcurr++ = '#';
+        *pcurr++ = type;
         if (pa->a_flags & AF_ISDESK)
-            pcurr += sprintf(pcurr," %02X %02X",(pa->a_xspot/G.g_icw)&0x00ff,
-                            (max(0,(pa->a_yspot-G.g_desk.g_y))/G.g_ich)&0x00ff);
-        pcurr += sprintf(pcurr," %02X %02X",pa->a_aicon&0x00ff,pa->a_dicon&0x00ff);
+        {
+            pcurr = put_hex(pcurr, pa->a_xspot/G.g_icw);
+            pcurr = put_hex(pcurr, max(0,(pa->a_yspot-G.g_desk.g_y))/G.g_ich);
+        }
+        pcurr = put_hex(pcurr, pa->a_aicon);
+        pcurr = put_hex(pcurr, pa->a_dicon);
         if (pa->a_flags & AF_ISDESK)
-            pcurr += sprintf(pcurr," %c",pa->a_letter?pa->a_letter:' ');
-        pcurr += sprintf(pcurr," %s@ %s@",pa->a_pappl,pa->a_pdata);
+        {
+            *pcurr++ = ' ';
+            *pcurr++ = pa->a_letter ? pa->a_letter : ' ';
+        }
+        pcurr = put_str(pcurr, pa->a_pappl);
+        pcurr = put_str(pcurr, pa->a_pdata);
         if ((pa->a_type == AT_ISFILE) && !(pa->a_flags & AF_ISDESK))
         {
             type = 0;
@@ -1269,7 +1355,10 @@ void app_save(WORD todisk)
                 type |= INF_AT_APPDIR;
             if (pa->a_flags & AF_ISFULL)
                 type |= INF_AT_ISFULL;
-            pcurr += sprintf(pcurr," %X%02X %s@",type,pa->a_funkey,pa->a_pargs);
+            *pcurr++ = ' ';
+            *pcurr++ = '0' + type;      /* always a single digit */
+            pcurr = put_2(pcurr, pa->a_funkey);
+            pcurr = put_str(pcurr, pa->a_pargs);
         }
         *pcurr++ = '\r';
         *pcurr++ = '\n';
@@ -1424,6 +1513,142 @@ ANODE *app_afind_by_id(WORD obid)
 }
 
 
+/*
+ *  Check if the application name of an ANODE matches a file
+ */
+static WORD app_match_appl(ANODE *pa, char *pathname, char *pname)
+{
+    if ((pa->a_pappl[0] == '*') || (pa->a_pappl[0] == '?'))
+        return wildcmp(pa->a_pappl, pname);
+
+    return !strcmp(pa->a_pappl, pathname);
+}
+
+
+#if CONF_WITH_ANODE_INDEX
+static WORD ahash_str(const char *s)
+{
+    UWORD h = 0;
+
+    while(*s)
+        h = (h << 3) + (h >> 13) + (UBYTE)*s++;
+
+    return h & (NUM_AHASH-1);
+}
+
+
+/*
+ *  Return the extension EXT if the pattern is "*.EXT" and EXT does not
+ *  contain wildcards, else NULL
+ *
+ *  wildcmp() matches such a pattern with exactly those names whose text
+ *  after the first '.' (or nothing, if there is no '.') is EXT
+ */
+static const char *pattern_ext(const char *pattern)
+{
+    const char *p;
+
+    if ((pattern[0] != '*') || (pattern[1] != '.'))
+        return NULL;
+
+    for (p = pattern+2; *p; p++)
+        if ((*p == '*') || (*p == '?') || (*p == '.'))
+            return NULL;
+
+    return pattern+2;
+}
+
+
+/*
+ *  Add an entry to the end of a chain whose last entry is *ptail
+ */
+static void aindex_add(WORD n, WORD *phead, WORD *ptail)
+{
+    aindex[n].next = AINDEX_NONE;
+    if (*ptail == AINDEX_NONE)
+        *phead = n;
+    else aindex[*ptail].next = n;
+    *ptail = n;
+}
+
+
+/*
+ *  Rebuild the ANODE index
+ */
+static void aindex_build(void)
+{
+    ANODE *pa;
+    const char *ext;
+    WORD i, n, h;
+    WORD htail[NUM_AHASH], wtail;
+
+    for (i = 0; i < NUM_AHASH; i++)
+        ahash[i] = htail[i] = AINDEX_NONE;
+    awild = wtail = AINDEX_NONE;
+
+    for (pa = G.g_ahead, n = 0; pa; pa = pa->a_next, n += 2)
+    {
+        aindex[n].pa = aindex[n+1].pa = pa;
+
+        /* data name: an empty one matches nothing */
+        ext = pattern_ext(pa->a_pdata);
+        if (ext)
+        {
+            h = ahash_str(ext);
+            aindex_add(n, &ahash[h], &htail[h]);
+        }
+        else if (pa->a_pdata[0])
+            aindex_add(n, &awild, &wtail);
+
+        /* application name: a pattern, or else a full pathname */
+        if ((pa->a_pappl[0] == '*') || (pa->a_pappl[0] == '?'))
+        {
+            ext = pattern_ext(pa->a_pappl);
+            if (ext)
+            {
+                h = ahash_str(ext);
+                aindex_add(n+1, &ahash[h], &htail[h]);
+            }
+            else aindex_add(n+1, &awild, &wtail);
+        }
+        else if (pa->a_pappl[0])
+        {
+            h = ahash_str(pa->a_pappl);
+            aindex_add(n+1, &ahash[h], &htail[h]);
+        }
+    }
+
+    aindex_gen = G.g_agen;
+    KDEBUG(("ANODE index rebuilt for generation %u\n",aindex_gen));
+}
+
+
+/*
+ *  Return the first entry in a chain (up to but not including 'limit')
+ *  which matches the file, or 'limit' if there is none
+ */
+static WORD aindex_search(WORD n, WORD limit, WORD atype, WORD ignore, char *pathname, char *pname)
+{
+    ANODE *pa;
+    WORD match;
+
+    for ( ; (n != AINDEX_NONE) && (n < limit); n = aindex[n].next)
+    {
+        pa = aindex[n].pa;
+        if ((pa->a_flags & ignore) || (pa->a_type != atype))
+            continue;
+        if (n & 1)
+            match = app_match_appl(pa, pathname, pname);
+        else match = wildcmp(pa->a_pdata, pname);
+        if (match)
+            return n;
+    }
+
+    return limit;
+}
+#endif
+
+
 /*
  *  Find ANODE by name & type
  *
@@ -1436,13 +1661,36 @@ ANODE *app_afind_by_id(WORD obid)
  */
 ANODE *app_afind_by_name(WORD atype, WORD ignore, char *pspec, char *pname, BOOL *pisapp)
 {
-    ANODE *pa;
-    WORD match;
     char pathname[MAXPATHLEN];
+#if CONF_WITH_ANODE_INDEX
+    char *ext;
+    WORD n;
+#else
+    ANODE *pa;
+#endif
 
     strcpy(pathname,pspec);                 /* build full pathname */
     strcpy(filename_start(pathname),pname);
 
+#if CONF_WITH_ANODE_INDEX
+    if (aindex_gen != G.g_agen)
+        aindex_build();
+
+    /*
+     * the candidates are the entries for the file's extension, for its
+     * full pathname, and for other patterns: the best is the earliest
+     */
+    ext = strchr(pname, '.');
+    ext = ext ? ext+1 : "";
+    n = aindex_search(ahash[ahash_str(ext)], 2*NUM_ANODES, atype, ignore, pathname, pname);
+    n = aindex_search(ahash[ahash_str(pathname)], n, atype, ignore, pathname, pname);
+    n = aindex_search(awild, n, atype, ignore, pathname, pname);
+    if (n >= 2*NUM_ANODES)
+        return NULL;
+
+    *pisapp = n & 1;
+    return aindex[n].pa;
+#else
     for (pa = G.g_ahead; pa; pa = pa->a_next)
     {
         if (pa->a_flags & ignore)
@@ -1454,10 +1702,7 @@ ANODE *app_afind_by_name(WORD atype, WORD ignore, char *pspec, char *pname, BOOL
                 *pisapp = FALSE;
                 return pa;
             }
-            if ((pa->a_pappl[0] == '*') || (pa->a_pappl[0] == '?'))
-                match = wildcmp(pa->a_pappl, pname);
-            else match = !strcmp(pa->a_pappl, pathname);
-            if (match)
+            if (app_match_appl(pa, pathname, pname))
             {
                 *pisapp = TRUE;
                 return pa;
@@ -1466,6 +1711,7 @@ ANODE *app_afind_by_name(WORD atype, WORD ignore, char *pspec, char *pname, BOOL
     }
 
     return NULL;
+#endif
 }
 
 
@@ -159,6 +159,7 @@ typedef struct
 /*
  * Function prototypes
  */
+void app_changed(void);
 ANODE *app_alloc(void);
 void app_free(ANODE *pa);
 char *scan_str(char *pcurr, char **ppstr);
@@ -197,6 +197,8 @@ typedef struct
 /*GLOBAL*/ ANODE        *g_alist;               /* pointer to ANODE array */
 /*GLOBAL*/ ANODE        *g_aavail;              /* pointer to chain of free ANODEs */
 /*GLOBAL*/ ANODE        *g_ahead;               /* pointer to chain of allocated ANODEs */
+/*GLOBAL*/ UWORD        g_agen;                 /* ANODE generation: never 0, changed */
+                                                /*  whenever the ANODEs may change    */
 
 /*GLOBAL*/ WORD         g_numiblks;             /* number of icon blocks */
 /*GLOBAL*/ ICONBLK      *g_iblist;              /* ptr to array of icon blocks */
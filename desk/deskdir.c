@@ -53,6 +53,26 @@ static LONG     copylen;    /* size of above buffer */
 
 static WORD     ml_havebox;
 static WORD     deleted_folders;
+
+/*
+ * the tree walk list: while it exists, d_doop(OP_COUNT) records the
+ * entries it finds, so that the operation that follows can replay them
+ * instead of reading all the directories again.  each top-level folder
+ * starts with a WALK_TREE record (e_fname is the folder name, e_length
+ * the number of records that follow for it), and the entries of each
+ * folder are followed by a WALK_END record.
+ */
+#define WALK_MAXENTS    2048        /* max size of list, in records */
+#define WALK_ENTRY      0           /* values for e_fill */
+#define WALK_TREE       1
+#define WALK_END        2
+
+static FSENTRY  *walk_list;         /* NULL if not recording */
+static LONG     walk_max;           /* max number of records in list */
+static LONG     walk_count;         /* number of records, -1 if invalid */
+static FSENTRY  *walk_tree;         /* WALK_TREE record being built, */
+                                    /*  or NULL if not recording     */
+static FSENTRY  *walk_play;         /* next record to replay, or NULL */
 /*
  * check for UNDO key pressed: if so, ask user if she wants to abort and,
  * if so, return TRUE.  otherwise return FALSE.
@@ -469,6 +489,16 @@ static WORD d_dofcopy(char *psrc_file, char *pdst_file, WORD time, WORD date, WO
             diskfull = TRUE;
             break;
         }
+
+        /*
+         * a short read means we have reached the end of the file, so
+         * we can avoid another (zero-length) read
+         */
+        if (readlen < copylen)
+        {
+            dos_setdt(dstfh, time, date);   /* update target date/time */
+            break;
+        }
     }
 
     if (error < 0L)
@@ -521,6 +551,146 @@ static void update_modified_windows(char *path,WORD length)
 }
 
 
+/*
+ *  Allocate the tree walk list, for use by the following dir_op() calls
+ */
+void dir_walk_start(void)
+{
+    walk_max = dos_avail_anyram() / (4*sizeof(FSENTRY));
+    if (walk_max > WALK_MAXENTS)
+        walk_max = WALK_MAXENTS;
+    walk_list = (walk_max > 0L) ? dos_alloc_anyram(walk_max*sizeof(FSENTRY)) : NULL;
+    walk_count = 0L;
+    walk_tree = walk_play = NULL;
+}
+
+
+/*
+ *  Free the tree walk list
+ */
+void dir_walk_end(void)
+{
+    if (walk_list)
+        dos_free(walk_list);
+    walk_list = walk_tree = walk_play = NULL;
+}
+
+
+/*
+ *  Add a record to the tree walk list, if it is being built
+ */
+static void walk_add(WORD type, DTA *dta)
+{
+    FSENTRY *e;
+
+    if (!walk_tree || (walk_count < 0L))
+        return;
+
+    if (walk_count >= walk_max)     /* list full: we can't use it */
+    {
+        walk_count = -1L;
+        return;
+    }
+
+    e = walk_list + walk_count++;
+    e->e_fill = type;
+    memcpy(&e->e_attrib, &dta->d_attrib, 23);
+}
+
+
+/*
+ *  Start recording or replaying the tree walk list for the top-level
+ *  folder 'path' (in the form D:\X\FOLDER\*.*)
+ */
+static void walk_begin(WORD op, char *path)
+{
+    char *p, *name;
+    FSENTRY *e, *end;
+
+    walk_play = walk_tree = NULL;
+    if (!walk_list || (walk_count < 0L))
+        return;
+
+    /* isolate the folder name */
+    p = filename_start(path) - 1;
+    *p = '\0';
+    name = filename_start(path);
+
+    if (op == OP_COUNT)
+    {
+        if (walk_count < walk_max)
+        {
+            walk_tree = walk_list + walk_count++;
+            walk_tree->e_fill = WALK_TREE;
+            strcpy(walk_tree->e_fname, name);
+        }
+        else walk_count = -1L;
+    }
+    else
+    {
+        for (e = walk_list, end = walk_list + walk_count; e < end; e += e->e_length + 1)
+        {
+            if (strcmp(e->e_fname, name) == 0)
+            {
+                walk_play = e + 1;
+                break;
+            }
+        }
+    }
+
+    *p = '\\';
+}
+
+
+/*
+ *  Finish recording or replaying the tree walk list for a top-level folder
+ */
+static void walk_finish(WORD more)
+{
+    if (walk_tree && (walk_count >= 0L))
+    {
+        if (more)
+            walk_tree->e_length = walk_list + walk_count - walk_tree - 1;
+        else walk_count = -1L;      /* incomplete, so we can't use it */
+    }
+
+    walk_tree = walk_play = NULL;
+}
+
+
+/*
+ *  Get the first or next entry of a folder, either from the directory
+ *  (recording it in the tree walk list if required) or from the list
+ */
+static WORD walk_next(char *path, DTA *dta, BOOL first)
+{
+    FSENTRY *e;
+    WORD ret;
+
+    if (walk_play)
+    {
+        e = walk_play++;
+        if (e->e_fill == WALK_END)
+            return ENMFIL;
+        memcpy(&dta->d_attrib, &e->e_attrib, 23);
+        return 0;
+    }
+
+    ret = first ? dos_sfirst(path, ALLFILES) : dos_snext();
+    if (ret == 0)
+    {
+        if (dta->d_fname[0] != '.')
+            walk_add(WALK_ENTRY, dta);
+    }
+    else if ((ret == ENMFIL) || (ret == EFILNF))
+        walk_add(WALK_END, dta);
+    else if (walk_tree)
+        walk_count = -1L;           /* real error: don't use the list */
+
+    return ret;
+}
+
+
 /*
  *  Directory routine to DO an operation on an entire sub-directory
  */
@@ -548,13 +718,16 @@ WORD d_doop(WORD level, WORD op, char *psrc_path, char *pdst_path, OBJECT *tree,
     }
 
     if (level == 0)
+    {
         deleted_folders = 0L;
+        walk_begin(op, psrc_path);
+    }
 
     /* save old DTA, use new DTA for this level */
     prevdta = dos_gdta();
     dos_sdta(dta);
 
-    for (ret = dos_sfirst(psrc_path, ALLFILES); ; ret = dos_snext())
+    for (ret = walk_next(psrc_path, dta, TRUE); ; ret = walk_next(psrc_path, dta, FALSE))
     {
         more = TRUE;
         /*
@@ -683,6 +856,9 @@ WORD d_doop(WORD level, WORD op, char *psrc_path, char *pdst_path, OBJECT *tree,
     dos_sdta(prevdta);
     dos_free(dta);
 
+    if (level == 0)
+        walk_finish(more);
+
     return more;
 }
 
@@ -27,6 +27,8 @@ void draw_dial(OBJECT *tree);
 char *add_fname(char *path, char *new_name);
 void del_fname(char *pstr);
 void add_path(char *path, char *new_name);
+void dir_walk_start(void);
+void dir_walk_end(void);
 WORD d_doop(WORD level, WORD op, char *psrc_path, char *pdst_path, OBJECT *tree, DIRCOUNT *count);
 WORD dir_op(WORD op, WORD icontype, PNODE *pspath, char *pdst_path, DIRCOUNT *count);
 WORD illegal_op_msg(void);
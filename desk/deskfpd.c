@@ -37,6 +37,7 @@
 #include "desksupp.h"
 
 #include "string.h"
+#include "miscutil.h"
 
 
 /*
@@ -147,56 +148,94 @@ static LONG pn_comp(FNODE *pf1, FNODE *pf2)
 }
 
 
+/*
+ *  Tie-breaking compare function for sort_keys()
+ */
+static WORD pn_keycomp(LONG item1, LONG item2)
+{
+    LONG chk;
+
+    chk = pn_comp((FNODE *)item1, (FNODE *)item2);
+
+    return (chk < 0L) ? -1 : (chk > 0L);
+}
+
+
+/*
+ *  Return the primary sort key for an fnode: this must be consistent
+ *  with pn_comp(), though it need not be as precise.  folders sort
+ *  first (unless unsorted), so they have the high bit clear.
+ */
+static ULONG pn_key(FNODE *pf)
+{
+    ULONG key;
+
+    switch(G.g_isort)
+    {
+    case S_NSRT:
+        return (ULONG)pf->f_seq;
+    case S_DATE:                    /* newest first */
+        key = ~(((ULONG)pf->f_date << 16) | pf->f_time) >> 1;
+        break;
+    case S_SIZE:                    /* largest first */
+        key = ~(ULONG)pf->f_size >> 1;
+        break;
+    case S_TYPE:
+        key = sort_strkey(scasb(pf->f_name,'.')) >> 8;
+        break;
+    default:                        /* S_NAME */
+        key = sort_strkey(pf->f_name) >> 8;
+        break;
+    }
+
+    if (!(pf->f_attr & FA_SUBDIR))
+        key |= 0x80000000UL;
+
+    return key;
+}
+
+
 /*
  *  Sort the fnodes in the list chained from the specified pathnode
  *
+ *  the primary sort keys are computed once per fnode, so that pn_comp()
+ *  is only called to resolve ties
  */
 FNODE *pn_sort(PNODE *pn)
 {
-    FNODE *pf, *pftemp;
+    FNODE *pf;
     FNODE *newlist;
-    FNODE **ml_pfndx;
-    WORD  count, gap, i, j;
+    SORTKEY *ml_pfndx;
+    WORD  count, i;
 
     if (pn->p_count < 2)        /* the list is already sorted */
         return pn->p_flist;
 
     /*
-     * malloc & build index array
+     * malloc & build index array, plus the work area for sort_keys()
      */
-    ml_pfndx = dos_alloc_anyram(pn->p_count*sizeof(FNODE *));
+    ml_pfndx = dos_alloc_anyram(2*pn->p_count*sizeof(SORTKEY));
     if (!ml_pfndx)              /* no space, can't sort */
     {
         malloc_fail_alert();
         return pn->p_flist;
     }
 
-    for (count = 0, pf = pn->p_flist; pf; pf = pf->f_next)
-        ml_pfndx[count++] = pf;
-
-    /* sort files using shell sort on page 108 of  K&R C Prog. Lang. */
-    for (gap = count/2; gap > 0; gap /= 2)
+    for (count = 0, pf = pn->p_flist; pf; pf = pf->f_next, count++)
     {
-        for (i = gap; i < count; i++)
-        {
-            for (j = i-gap; j >= 0; j -= gap)
-            {
-                if (pn_comp(ml_pfndx[j], ml_pfndx[j+gap]) <= 0L)
-                    break;
-                pftemp = ml_pfndx[j];
-                ml_pfndx[j] = ml_pfndx[j+gap];
-                ml_pfndx[j+gap] = pftemp;
-            }
-        }
+        ml_pfndx[count].key = pn_key(pf);
+        ml_pfndx[count].item = (LONG)pf;
     }
 
+    sort_keys(ml_pfndx, count, ml_pfndx+count, pn_keycomp);
+
     /* link up the list in order */
-    newlist = ml_pfndx[0];
-    pf = ml_pfndx[0];
+    newlist = (FNODE *)ml_pfndx[0].item;
+    pf = newlist;
     for (i = 1; i < count; i++)
     {
-        pf->f_next = ml_pfndx[i];
-        pf = ml_pfndx[i];
+        pf->f_next = (FNODE *)ml_pfndx[i].item;
+        pf = pf->f_next;
     }
     pf->f_next = (FNODE *) NULL;
 
@@ -206,6 +245,132 @@ FNODE *pn_sort(PNODE *pn)
 }
 
 
+/*
+ *  Look up a file in the directory of the specified pathnode, leaving
+ *  its details in G.g_wdta
+ *
+ *  returns TRUE iff the file exists
+ */
+static BOOL pn_lookup(PNODE *pn, char *name)
+{
+    DTA *dtasave;
+    char path[MAXPATHLEN];
+    WORD ret;
+
+    strcpy(path, pn->p_spec);
+    strcpy(filename_start(path), name);
+
+    dtasave = dos_gdta();
+    dos_sdta(&G.g_wdta);
+    ret = dos_sfirst(path, pn->p_attr);
+    dos_sdta(dtasave);
+
+    return (ret == 0);
+}
+
+
+/*
+ *  Add a single file or folder, just created, to the filenode list of
+ *  the specified pathnode, without rereading the directory
+ *
+ *  returns the position of the new fnode in the list, or -1 if the
+ *  caller must rebuild the list with pn_active()
+ */
+WORD pn_addfile(PNODE *pn, char *name)
+{
+    FNODE *fnbase, *fn, *pf, *fnew;
+    FNODE **prev;
+    WORD pos;
+
+    if (G.g_isort == S_NSRT)        /* position depends on the directory */
+        return -1;
+    if (!pn_lookup(pn, name))
+        return -1;
+
+    fnbase = dos_alloc_anyram((pn->p_count+1)*sizeof(FNODE));
+    if (!fnbase)
+        return -1;
+
+    /* build the new fnode at the end of the new block */
+    fnew = fnbase + pn->p_count;
+    fnew->f_selected = FALSE;
+    memcpy(&fnew->f_attr, &G.g_wdta.d_attrib, 23);
+    fnew->f_seq = pn->p_count;
+    fnew->f_pagen = 0;
+
+    /* copy the existing fnodes in list sequence, inserting the new one */
+    pos = -1;
+    prev = &pn->p_flist;
+    for (pf = pn->p_flist, fn = fnbase; pf; pf = pf->f_next, fn++)
+    {
+        if ((pos < 0) && (pn_comp(fnew, pf) < 0L))
+        {
+            pos = fn - fnbase;
+            *prev = fnew;
+            prev = &fnew->f_next;
+        }
+        *fn = *pf;
+        *prev = fn;
+        prev = &fn->f_next;
+    }
+    if (pos < 0)
+    {
+        pos = pn->p_count;
+        *prev = fnew;
+        prev = &fnew->f_next;
+    }
+    *prev = NULL;
+
+    if (pn->p_fbase)
+        dos_free(pn->p_fbase);
+    pn->p_fbase = fnbase;
+    pn->p_count++;
+    pn->p_size += fnew->f_size;
+
+    return pos;
+}
+
+
+/*
+ *  Remove the selected fnodes whose files no longer exist (for example,
+ *  after a delete) from the filenode list of the specified pathnode,
+ *  without rereading the directory
+ *
+ *  returns the position of the first fnode removed (p_count if none
+ *  were), or -1 if the caller must rebuild the list with pn_active()
+ */
+WORD pn_delfiles(PNODE *pn)
+{
+    FNODE *pf;
+    FNODE **prev;
+    WORD nsel, pos, first;
+
+    for (nsel = 0, pf = pn->p_flist; pf; pf = pf->f_next)
+        if (pf->f_selected)
+            nsel++;
+    if (nsel > MAX_DELCHECK)        /* quicker to reread the directory */
+        return -1;
+
+    first = -1;
+    prev = &pn->p_flist;
+    for (pos = 0, pf = pn->p_flist; pf; pf = pf->f_next, pos++)
+    {
+        if (pf->f_selected && !pn_lookup(pn, pf->f_name))
+        {
+            *prev = pf->f_next;     /* unlink it (the space is not reused) */
+            pn->p_count--;
+            pn->p_size -= pf->f_size;
+            if (first < 0)
+                first = pos;
+            continue;
+        }
+        prev = &pf->f_next;
+    }
+
+    return (first < 0) ? pn->p_count : first;
+}
+
+
 /*
  *  Build the filenode list for the specified pathnode
  *
@@ -221,7 +386,7 @@ FNODE *pn_sort(PNODE *pn)
  *              NOTE: if insufficient memory is available, some files in
  *              the specified pathnode will be silently excluded from the
  *              filenode list.  our excuse is that Atari TOS does this too ...
- *          <0  error (other than EFILNF/ENMFIL) returned by dos_sfirst()/dos_snext()
+ *          <0  error (other than EFILNF/ENMFIL) returned by dos_bsfirst()/dos_bsnext()
  *              (e.g. when attempting to open a floppy drive with no disk)
  */
 WORD pn_active(PNODE *pn, BOOL include_folders)
@@ -256,13 +421,13 @@ WORD pn_active(PNODE *pn, BOOL include_folders)
     if (include_folders)                /* match all folders? */
         del_fname(search);              /* yes - change search filespec to *.* */
     match = filename_start(pn->p_spec); /* the match filespec is always unaltered */
-    for (ret = dos_sfirst(search, pn->p_attr), count = 0; (ret == 0) && (count < maxcount); ret = dos_snext())
+    for (ret = dos_bsfirst(search, pn->p_attr), count = 0; (ret == 0) && (count < maxcount); ret = dos_bsnext())
     {
         if (G.g_wdta.d_attrib != FA_SUBDIR) /* skip *files* that don't match */
             if (!wildcmp(match, G.g_wdta.d_fname))
                 continue;
 #else
-    for (ret = dos_sfirst(pn->p_spec,pn->p_attr), count = 0; (ret == 0) && (count < maxcount); ret = dos_snext())
+    for (ret = dos_bsfirst(pn->p_spec,pn->p_attr), count = 0; (ret == 0) && (count < maxcount); ret = dos_bsnext())
     {
 #endif
         if (G.g_wdta.d_fname[0] == '.') /* skip "." & ".." entries */
@@ -270,6 +435,7 @@ WORD pn_active(PNODE *pn, BOOL include_folders)
         fn->f_selected = FALSE;
         memcpy(&fn->f_attr, &G.g_wdta.d_attrib, 23);
         fn->f_seq = count++;
+        fn->f_pagen = 0;        /* f_pa/f_isap not set yet */
         size += fn->f_size;
         prev->f_next = fn;      /* link fnodes */
         prev = fn++;
@@ -42,6 +42,8 @@
 #define S_NSRT (NSRTITEM-NAMEITEM)  /* no sort (directory sequence) */
 #define START_SORT  S_NAME      /* default */
 
+#define MAX_DELCHECK 32     /* max items checked individually by pn_delfiles() */
+
 #define E_NOERROR 0
 #define E_NOFNODES 100
 #define E_NOPNODES 101
@@ -63,6 +65,7 @@ struct _filenode
     WORD  f_obid;           /* index into G.g_screen[] for this object */
     ANODE *f_pa;            /* ANODE to get icon# from */
     BOOL  f_isap;           /* if TRUE, use a_aicon in ANODE, else use a_dicon */
+    UWORD f_pagen;          /* value of G.g_agen when f_pa/f_isap were set */
 };
 
 
@@ -86,6 +89,8 @@ void pn_clear(WNODE *pw);
 void pn_close(PNODE *thepath);
 PNODE *pn_open(char *pathname, WNODE *pw);
 FNODE *pn_sort(PNODE *pn);
+WORD pn_addfile(PNODE *pn, char *name);
+WORD pn_delfiles(PNODE *pn);
 WORD pn_active(PNODE *thepath, BOOL include_folders);
 FNODE *pn_selected(WNODE *pw);
 void pn_count(WNODE *pw, WORD *nsel, WORD *napp);
@@ -144,6 +144,94 @@ static void rebuild_window(WNODE *pwin)
 }
 
 
+/*
+ *  Update a window after its filenode list has been changed in place,
+ *  redrawing only the rows from the one containing the fnode at 'pos'
+ */
+static void update_window(WNODE *pwin, WORD pos)
+{
+    GRECT gr;
+    WORD cvrow, ncols, dy;
+
+    cvrow = pwin->w_cvrow;
+    desk_verify(pwin->w_id, TRUE);
+    win_sinfo(pwin, FALSE);
+    wind_get_grect(pwin->w_id, WF_WXYWH, &gr);
+
+    if (pwin->w_cvrow == cvrow)     /* not scrolled, so redraw from 'pos' */
+    {
+#if CONF_WITH_SIZE_TO_FIT
+        ncols = G.g_ifit ? pwin->w_pncol : G.g_icols;
+#else
+        ncols = pwin->w_pncol;
+#endif
+        if (ncols < 1)
+            ncols = 1;
+        dy = (pos / ncols - cvrow) * G.g_ihspc;
+        if (dy >= gr.g_h)           /* change is below the visible rows */
+            return;
+        if (dy > 0)
+        {
+            gr.g_y += dy;
+            gr.g_h -= dy;
+        }
+    }
+    fun_msg(WM_REDRAW, pwin->w_id, gr.g_x, gr.g_y, gr.g_w, gr.g_h);
+}
+
+
+/*
+ *  Update the windows with the specified path after 'name' has been
+ *  created in it, inserting a single fnode where possible
+ */
+static void fun_rebld_added(char *ptst, char *name)
+{
+    WNODE *pwin;
+    WORD pos;
+
+    desk_busy_on();
+
+    for (pwin = G.g_wfirst; pwin; pwin = pwin->w_next)
+    {
+        if ( (pwin->w_id) && (strcmp(pwin->w_pnode.p_spec, ptst)==0) )
+        {
+            pos = pn_addfile(&pwin->w_pnode, name);
+            if (pos < 0)
+                rebuild_window(pwin);
+            else update_window(pwin, pos);
+        }
+    }
+
+    desk_busy_off();
+}
+
+
+/*
+ *  Update the windows with the same path as 'pw' after a delete: the
+ *  deleted fnodes are removed from 'pw', other windows are rebuilt
+ */
+static void fun_rebld_deleted(WNODE *pw)
+{
+    WNODE *pwin;
+    WORD pos;
+
+    desk_busy_on();
+
+    for (pwin = G.g_wfirst; pwin; pwin = pwin->w_next)
+    {
+        if ( (pwin->w_id) && (strcmp(pwin->w_pnode.p_spec, pw->w_pnode.p_spec)==0) )
+        {
+            pos = (pwin == pw) ? pn_delfiles(&pwin->w_pnode) : -1;
+            if (pos < 0)
+                rebuild_window(pwin);
+            else update_window(pwin, pos);
+        }
+    }
+
+    desk_busy_off();
+}
+
+
 /*
  *  Rebuild marked windows
  */
@@ -441,9 +529,8 @@ static BOOL search_display(WORD curr, char *pathname, char *searchwild)
 static BOOL search_recursive(WORD curr, char *pathname, char *searchwild)
 {
     DTA dta, *save_dta;
-    char *p;
     WORD ret;
-    BOOL ok = TRUE;
+    BOOL ok = TRUE, match = FALSE, subdirs = FALSE;
 
     /*
      * we must use a local DTA to manage the recursive search
@@ -452,31 +539,39 @@ static BOOL search_recursive(WORD curr, char *pathname, char *searchwild)
     dos_sdta(&dta);
 
     /*
-     * check if there is a filename match; if so, display the folder
+     * check if there is a filename match, and note whether there are
+     * any folders to search.  we match in memory, using the same test
+     * as mark_matching_fnodes(), so that a single pass through the
+     * directory will do.
      */
-    p = filename_start(pathname);
-    strcpy(p, searchwild);
-    ret = dos_sfirst(pathname, DISPATTR);
-    set_all_files(p);
+    for (ret = dos_sfirst(pathname, DISPATTR); ret == 0; ret = dos_snext())
+    {
+        if (dta.d_fname[0] == '.')  /* ignore . and .. */
+            continue;
+        if (dta.d_attrib & FA_SUBDIR)
+            subdirs = TRUE;
+        if (!match && wildcmp(searchwild, dta.d_fname))
+            match = TRUE;
+        if (match && subdirs)
+            break;
+    }
     dos_sdta(save_dta); /* in case we must return */
 
-    switch(ret) {
-    case 0:             /* file found, display folder */
+    if ((ret < 0) && (ret != ENMFIL) && (ret != EFILNF))
+        return TRUE;    /* some strange kind of error, ignore silently */
+
+    if (match)          /* file found, display folder */
         if (!search_display(curr, pathname, searchwild))
             return FALSE;   /* user cancelled */
-        FALLTHROUGH;
-    case ENMFIL:        /* nothing found, continue processing */
-    case EFILNF:
-        break;
-    default:            /* some strange kind of error, ignore silently */
-        return TRUE;
-    }
 
     /*
      * at this point, either there were no matching filenames, or we found
-     * some but the user wants to continue.  we do an fsfirst/fsnext loop
-     * and call ourselves for every folder found.
+     * some but the user wants to continue.  if there are any folders, we
+     * do an fsfirst/fsnext loop and call ourselves for every folder found.
      */
+    if (!subdirs)
+        return TRUE;
+
     dos_sdta(&dta);     /* original DTA is already saved */
 
     for (ret = dos_sfirst(pathname, DISPATTR), ok = TRUE; ret==0; ret = dos_snext())
@@ -711,7 +806,7 @@ WORD fun_mkdir(WNODE *pw_node)
         desk_busy_off();
         if (rc == 0)        /* mkdir succeeded */
         {
-            fun_rebld(pw_node->w_pnode.p_spec);
+            fun_rebld_added(pw_node->w_pnode.p_spec, unew_name);
             break;
         }
 
@@ -789,13 +884,19 @@ WORD fun_op(WORD op, WORD icontype, PNODE *pspath, char *pdest)
     case OP_COPY:
     case OP_MOVE:
     case OP_DELETE:
-        /* first, count source files */
+        /*
+         * first, count source files: the folder contents found are
+         * remembered, so the operation needn't read them again
+         */
+        dir_walk_start();
         more = dir_op(OP_COUNT, icontype, pspath, pdest, &count);
+        if (more && (count.files+count.dirs))
+            dir_op(op, icontype, pspath, pdest, &count);    /* do the operation     */
+        dir_walk_end();
         if (!more)
             return illegal_op_msg();
         if ((count.files+count.dirs) == 0)
             break;
-        dir_op(op, icontype, pspath, pdest, &count);        /* do the operation     */
         return TRUE;
     }
 
@@ -1287,6 +1388,13 @@ static void fun_desk2desk(WORD dobj, WORD keystate)
                     illegal_op_msg();
                     continue;
                 }
+#if CONF_WITH_FLOPTRKS
+                /* with Alternate, copy a whole diskette from floppy to floppy */
+                if ((keystate & MODE_ALT) && (target->a_type == AT_ISDISK)
+                 && (source->a_letter <= 'B') && (target->a_letter <= 'B')
+                 && disk_copy(source->a_letter-'A', target->a_letter-'A'))
+                    continue;
+#endif
                 break;
 #if CONF_WITH_PRINTER_ICON
             case AT_ISPRNT:
@@ -1419,7 +1527,7 @@ void fun_del(WNODE *pw, WORD sobj)
     if (pw)     /* precautionary, should never be NULL */
     {
         if (fun_op(OP_DELETE, -1, &pw->w_pnode, NULL))
-            fun_rebld(pw->w_pnode.p_spec);
+            fun_rebld_deleted(pw);
     }
 }
 
@@ -307,19 +307,91 @@ static WORD format_fnode(FNODE *pf, char *pfmt)
 }
 
 
+#if CONF_WITH_TEXT_ROW_CACHE
+/*
+ * cache of formatted rows, indexed by the f_seq of the FNODE
+ *
+ * consecutive rows of a window use consecutive entries.  an entry is
+ * valid for an FNODE while its file data is unchanged (the FNODEs of a
+ * window are rebuilt in place when it is refreshed), and all entries
+ * are discarded when the format settings change.
+ */
+#define NUM_TEXT_ROWS   32          /* must be a power of 2 */
+#define FNODE_DATA_LEN  23          /* f_attr thru f_name[] */
+
+typedef struct
+{
+    FNODE   *pf;                    /* NULL => entry not in use */
+    char    data[FNODE_DATA_LEN];   /* file data that was formatted */
+    UBYTE   len;
+    char    text[LEN_FNODE];
+} TEXTROW;
+
+static TEXTROW text_row[NUM_TEXT_ROWS];
+
+static struct
+{
+    LONG    idt;
+    char    timeform;
+    char    dateform;
+    BOOL    wide;
+} text_row_fmt;                 /* format settings for the cached rows */
+
+
+/*
+ * return the formatted text for an FNODE, from the cache if possible
+ */
+static char *get_text_row(FNODE *pf, WORD *plen)
+{
+    TEXTROW *row;
+    BOOL wide = USE_WIDE_FORMAT();
+
+    if ((text_row_fmt.idt != G.g_idt) || (text_row_fmt.timeform != G.g_ctimeform)
+     || (text_row_fmt.dateform != G.g_cdateform) || (text_row_fmt.wide != wide))
+    {
+        for (row = text_row; row < text_row+NUM_TEXT_ROWS; row++)
+            row->pf = NULL;
+        text_row_fmt.idt = G.g_idt;
+        text_row_fmt.timeform = G.g_ctimeform;
+        text_row_fmt.dateform = G.g_cdateform;
+        text_row_fmt.wide = wide;
+    }
+
+    row = &text_row[pf->f_seq & (NUM_TEXT_ROWS-1)];
+    if ((row->pf != pf) || memcmp(row->data, &pf->f_attr, FNODE_DATA_LEN))
+    {
+        row->pf = pf;
+        memcpy(row->data, &pf->f_attr, FNODE_DATA_LEN);
+        row->len = format_fnode(pf, row->text);
+    }
+
+    *plen = row->len;
+    return row->text;
+}
+#endif
+
+
 static WORD dr_fnode(UWORD last_state, UWORD curr_state, WORD x, WORD y,
             WORD w, WORD h, FNODE *fnode)
 {
     WORD len;
-    char temp[LEN_FNODE];
+#if CONF_WITH_TEXT_ROW_CACHE
+    char *text;
+#else
+    char text[LEN_FNODE];
+#endif
 
     if ((last_state ^ curr_state) & SELECTED)
         bb_fill(MD_XOR, FIS_SOLID, IP_SOLID, x, y, w, h);
     else
     {
-        len = format_fnode(fnode, temp);    /* convert to text */
+#if CONF_WITH_TEXT_ROW_CACHE
+        text = get_text_row(fnode, &len);
+#else
+        len = format_fnode(fnode, text);    /* convert to text */
+#endif
         gsx_attr(TRUE, MD_TRANS, BLACK);
-        expand_string(intin, temp);
+        expand_string(intin, text);
         gsx_tblt(IBM, x, y, len);
         gsx_attr(FALSE, MD_XOR, BLACK);
     }
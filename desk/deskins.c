@@ -579,6 +579,7 @@ static WORD ins_app_dialog(ANODE *pa, char *pathname, char *pfname, BOOL install
             pa->a_dicon = IG_DOCU;
             pa->a_xspot = 0;
             pa->a_yspot = 0;
+            app_changed();          /* the names & flags may have changed */
             change = 1;
             break;
         case APREMOVE:      /* remove an application */
@@ -432,6 +432,19 @@ static void desktop_set_cache(void)
 #endif
 
 
+#if CONF_WITH_BOOT_PROFILE
+/*
+ * Routine to record the end of the boot: must be Supexec'd because
+ * boot_phase() accesses the system timer
+ */
+static void desktop_boot_done(void)
+{
+    boot_phase("desktop");
+    boot_profile_dump(TRUE);
+}
+#endif
+
+
 /*
  *  Routine to update all of the desktop windows
  */
@@ -2078,6 +2091,10 @@ BOOL deskmain(void)
     /* enable graphical critical error handler */
     enable_ceh = TRUE;
 
+#if CONF_WITH_BOOT_PROFILE
+    Supexec((LONG)desktop_boot_done);
+#endif
+
     /* loop handling user input until done */
     while(!done)
     {
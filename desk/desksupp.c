@@ -80,6 +80,16 @@ static const WORD hd_skewtab[] =
 
 #endif
 
+#if CONF_WITH_FLOPTRKS
+/*
+ *      declarations used by disk_copy()
+ */
+#define FT_READ         0           /* Floptrks() modes */
+#define FT_WRITE        1
+#define COPY_MAXSPT     20          /* as checked by Floptrks() */
+#define COPY_MAXTRACK   86
+#endif
+
 #if CONF_WITH_SHOW_FILE || CONF_WITH_PRINTER_ICON
 /*
  *      declarations used by show_file() or print_file()
@@ -94,8 +104,17 @@ static const WORD hd_skewtab[] =
  *      declarations used by show_file() only
  */
 #define IOBUFSIZE   16384L
+#define LINE_INDEX  1024        /* number of line starts remembered, for paging back */
+#define SHOW_BACK   2           /* show_buf() return: redisplay from 'seekoffs' */
 static LONG linecount;
 static WORD pagesize;
+static LONG *lineoffs;          /* file offsets of recent line starts (or NULL) */
+static LONG nlines;             /* number of lines displayed */
+static LONG lowline;            /* earliest line whose start is remembered */
+static LONG fileoffs;           /* file offset of next character to display */
+static LONG seekoffs;           /* file offset to redisplay from */
+static const char *run_ptr;     /* run of characters for bios_conrun() */
+static LONG run_len;
 #endif
 
 
@@ -678,6 +697,70 @@ static void bios_conws(const char *s)
         Bconout(2, *s++);
 }
 
+/*
+ *  send a run of characters via the BIOS: must be Supexec'd, because
+ *  bconouts() may bypass the BIOS trap and write directly to the screen
+ */
+static void bios_conrun(void)
+{
+    LONG n;
+
+    if (!bconouts(2, (const UBYTE *)run_ptr, run_len))
+        for (n = 0; n < run_len; n++)
+            Bconout(2, (UBYTE)run_ptr[n]);
+}
+
+/*
+ *  send the characters from 'start' up to (but not including) 'end'
+ */
+static void show_run(const char *start, const char *end)
+{
+    if (end > start)
+    {
+        run_ptr = start;
+        run_len = end - start;
+        Supexec((LONG)bios_conrun);
+    }
+}
+
+/*
+ *  remember the offset of the start of the next line
+ */
+static void add_line(void)
+{
+    nlines++;
+    if (lineoffs)
+        lineoffs[nlines % LINE_INDEX] = fileoffs;
+    if (nlines - LINE_INDEX + 1 > lowline)
+        lowline = nlines - LINE_INDEX + 1;  /* its slot has been reused */
+}
+
+/*
+ *  go back one page, if the start of the page is still remembered
+ *
+ *  returns TRUE iff 'seekoffs' has been set up for the new page
+ */
+static BOOL page_back(void)
+{
+    LONG curr, top;
+
+    if (!lineoffs)
+        return FALSE;
+
+    curr = (nlines > pagesize) ? nlines - pagesize : 0L;   /* top line now */
+    top = curr - pagesize;
+    if (top < lowline)              /* not remembered */
+        top = lowline;
+    if (top >= curr)                /* already showing the earliest page */
+        return FALSE;
+
+    nlines = top;
+    seekoffs = fileoffs = lineoffs[top % LINE_INDEX];
+    linecount = 0L;
+
+    return TRUE;
+}
+
 /*
  *  blank out line via VT52 escape sequence
  */
@@ -699,60 +782,86 @@ static void clear_screen(void)
 /*
  *  display a fixed-length buffer with screen paging
  *
+ *  runs of characters are output with a single BIOS call, and the start
+ *  of each line is remembered so that the user can page back with B
+ *
  *  returns +1 if user interrupt or quit
+ *          SHOW_BACK if the file must be redisplayed from 'seekoffs'
  *          0 otherwise
  */
 static WORD show_buf(const char *s,LONG len)
 {
+    const char *run;
     LONG n;
     WORD response;
     char c, cprev = 0;
     char *msg;
 
-    n = len;
-    while(n-- > 0)
+    if (bios_conis())
+        if (user_input(-1, TRUE))
+            return 1;
+
+    for (n = len, run = s; n-- > 0; cprev = c)
     {
+        c = *s;
+        /* convert Un*x-style text to TOS-style */
+        if ((c == '\n') && (cprev != '\r'))
+        {
+            show_run(run, s);
+            run = s;
+            bios_conout('\r');
+        }
+        s++;
+        fileoffs++;
+        if (c != '\n')
+            continue;
+
+        show_run(run, s);
+        run = s;
+        add_line();
+
         if (bios_conis())
             if (user_input(-1, TRUE))
                 return 1;
 
-        c = *s++;
-        /* convert Un*x-style text to TOS-style */
-        if ((c == '\n') && (cprev != '\r'))
-            bios_conout('\r');
-        bios_conout(c);
-        if (c == '\n')
+        if (++linecount >= pagesize)
         {
-            if (++linecount >= pagesize)
+            msg = desktop_str_addr(STMORE);
+            bios_conws(msg);            /* "-More-" */
+            while(1)
             {
-                msg = desktop_str_addr(STMORE);
-                bios_conws(msg);            /* "-More-" */
-                while(1)
+                response = get_key();
+                if (response == '\r')   /* CR displays the next line */
+                    break;
+                if (response == ' ')    /* space displays the next page */
                 {
-                    response = get_key();
-                    if (response == '\r')   /* CR displays the next line */
-                        break;
-                    if (response == ' ')    /* space displays the next page */
-                    {
-                        linecount = 0L;
-                        break;
-                    }
-                    if ((response == 'D') || (response == 'd') || (response == CTL_D))
-                    {                       /* D, d, or ^D displays half a page */
-                        linecount = pagesize / 2;
-                        break;
-                    }
-                    if (user_input(response, TRUE))
+                    linecount = 0L;
+                    break;
+                }
+                if ((response == 'D') || (response == 'd') || (response == CTL_D))
+                {                       /* D, d, or ^D displays half a page */
+                    linecount = pagesize / 2;
+                    break;
+                }
+                if ((response == 'B') || (response == 'b'))
+                {                       /* B or b displays the previous page */
+                    if (page_back())
                     {
-                        bios_conout('\r');
-                        return 1;
+                        clear_screen();
+                        return SHOW_BACK;
                     }
+                    continue;
+                }
+                if (user_input(response, TRUE))
+                {
+                    bios_conout('\r');
+                    return 1;
                 }
-                blank_line();               /* overwrite the pause msg */
             }
+            blank_line();               /* overwrite the pause msg */
         }
-        cprev = c;
     }
+    show_run(run, s);
 
     return 0;
 }
@@ -763,7 +872,7 @@ static WORD show_buf(const char *s,LONG len)
 static void show_file(char *name,LONG bufsize,char *iobuf)
 {
     LONG rc, n;
-    WORD handle, scr_width, scr_height;
+    WORD handle, scr_width, scr_height, response;
     char *msg;
 
     rc = dos_open(name,0);
@@ -790,27 +899,46 @@ static void show_file(char *name,LONG bufsize,char *iobuf)
     pagesize = (G.g_desk.g_y+G.g_desk.g_h)/gl_hchar - 1;
     linecount = 0L;
 
+    /* if there's no memory for the line index, we can't page back */
+    lineoffs = dos_alloc_anyram(LINE_INDEX*sizeof(LONG));
+    nlines = lowline = fileoffs = 0L;
+    if (lineoffs)
+        lineoffs[0] = 0L;
+
     while(1)
     {
         n = rc = dos_read(handle,bufsize,iobuf);
-        if (rc <= 0L)
-            break;
-        rc = show_buf(iobuf,n);
         if (rc > 0L)
-            break;
-    }
-
-    dos_close(handle);
+        {
+            rc = show_buf(iobuf,n);
+            if (rc == SHOW_BACK)
+            {
+                dos_lseek(handle, 0, seekoffs);
+                continue;
+            }
+            if (rc > 0L)    /* user quit */
+                break;
+            continue;
+        }
 
-    if (rc <= 0L)   /* not user quit */
-    {
+        /* EOF or read error */
         bios_conout('\n');
         msg = desktop_str_addr((rc==0L)?STEOF:STFRE);
         blank_line();
         bios_conws(msg);    /* "-End of file-" or "-File read error-" */
-        get_key();
+        response = get_key();
+        if ((rc < 0L) || ((response != 'B') && (response != 'b')))
+            break;
+        if (!page_back())   /* B or b at EOF displays the previous page */
+            break;
+        clear_screen();
+        dos_lseek(handle, 0, seekoffs);
     }
 
+    dos_close(handle);
+    if (lineoffs)
+        dos_free(lineoffs);
+
     /*
      * switch back to normal desktop
      */
@@ -1649,6 +1777,100 @@ void do_format(void)
 #endif
 
 
+#if CONF_WITH_FLOPTRKS
+/*
+ *  Get a little-endian word from a boot sector
+ */
+static WORD get_bootword(const UBYTE *p)
+{
+    return (p[1] << 8) | p[0];
+}
+
+/*
+ *  Copy a whole diskette from floppy drive 'src' to floppy drive 'dst'
+ *
+ *  The source is read in one pass into a buffer holding the whole disk
+ *  (in alternate RAM if there is some), then written in one pass.
+ *
+ *  Returns FALSE iff a disk copy is not possible between these drives
+ *  (e.g. drive B: is the same physical drive as A:), so that the caller
+ *  can copy the files instead.
+ */
+BOOL disk_copy(WORD src, WORD dst)
+{
+    UBYTE *boot, *buf;
+    char drivename[3];
+    WORD spt, sides, tracks, rc;
+
+    if ((Floptrks(0L, src, FT_READ, 1, 1, 0, 0) == EUNDEV)
+     || (Floptrks(0L, dst, FT_READ, 1, 1, 0, 0) == EUNDEV))
+        return FALSE;
+
+    if (fun_alert_merge(2, STDELDIS, 'A'+dst) != 1)
+        return TRUE;
+
+    boot = dos_alloc_anyram(SECTOR_SIZE);
+    if (!boot)
+    {
+        malloc_fail_alert();
+        return TRUE;
+    }
+
+    desk_busy_on();
+
+    /* the geometry of the source disk comes from its boot sector */
+    rc = Floprd((LONG)boot, 0L, src, 1, 0, 0, 1);
+    spt = get_bootword(boot+24);
+    sides = get_bootword(boot+26);
+    if (!rc && (spt > 0) && (spt <= COPY_MAXSPT) && (sides > 0) && (sides <= 2))
+        tracks = get_bootword(boot+19) / (spt * sides);
+    else
+        tracks = 0;
+    dos_free(boot);
+
+    buf = NULL;
+    if ((tracks > 0) && (tracks <= COPY_MAXTRACK))
+    {
+        buf = dos_alloc_anyram((LONG)tracks * sides * spt * SECTOR_SIZE);
+        if (!buf)
+        {
+            desk_busy_off();
+            malloc_fail_alert();
+            return TRUE;
+        }
+        rc = Floptrks((LONG)buf, src, FT_READ, spt, sides, 0, tracks);
+    }
+    drivename[0] = 'A' + src;
+    drivename[1] = DRIVESEP;
+    drivename[2] = '\0';
+    if (!buf || rc)
+    {
+        desk_busy_off();
+        fun_alert_merge(1, STRDFILE, drivename);
+        if (buf)
+            dos_free(buf);
+        return TRUE;
+    }
+
+    rc = Floptrks((LONG)buf, dst, FT_WRITE, spt, sides, 0, tracks);
+    dos_free(buf);
+    desk_busy_off();
+
+    /* the directory of the target has changed completely */
+    Rwabs(READSEC, (LONG)NULL, MEDIACHANGE, 0, dst, 0);
+    refresh_drive('A'+dst);
+
+    if (rc)
+    {
+        drivename[0] = 'A' + dst;
+        fun_alert_merge(1, STWRFILE, drivename);
+    }
+
+    return TRUE;
+}
+#endif
+
+
 /*
  *  Routine to re-read and redisplay the directory associated with
  *  the specified window
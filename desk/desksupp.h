@@ -33,6 +33,9 @@ void do_fopen(WNODE *pw, WORD curr, char *pathname, WORD allow_new_win);
 WORD do_open(WNODE *pw, WORD curr);
 WORD do_info(WORD curr);
 void do_format(void);
+#if CONF_WITH_FLOPTRKS
+BOOL disk_copy(WORD src, WORD dst);
+#endif
 void malloc_fail_alert(void);
 BOOL print_file(char *name, LONG bufsize, char *iobuf);
 void refresh_drive(WORD drive);
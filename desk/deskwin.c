@@ -379,8 +379,12 @@ static void win_ocalc(WNODE *pwin, WORD wfit, WORD hfit, FNODE **ppstart)
  */
 static void win_icalc(FNODE *pfnode, WNODE *pwin)
 {
+    if (pfnode->f_pagen == G.g_agen)    /* ANODEs unchanged since last time */
+        return;
+
     pfnode->f_pa = app_afind_by_name((pfnode->f_attr&FA_SUBDIR) ? AT_ISFOLD : AT_ISFILE,
             AF_ISDESK|AF_VIEWER, pwin->w_pnode.p_spec, pfnode->f_name, &pfnode->f_isap);
+    pfnode->f_pagen = G.g_agen;
 }
 
 
@@ -788,6 +792,8 @@ void win_bdall(void)
     GRECT clip;
     WNODE *pw;
 
+    app_changed();          /* make sure f_pa/f_isap are recalculated */
+
     for (pw = G.g_wfirst; pw; pw = pw->w_next)
     {
         if (pw->w_id != 0)
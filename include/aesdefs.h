@@ -242,6 +242,15 @@
 #define AC_OPEN     40
 #define AC_CLOSE    41
 
+/*
+ * EmuTOS-specific: hand over a memory block allocated by Malloc() or
+ * Mxalloc().  msg[3..4] is the block address, msg[5..6] the length of
+ * the data and msg[7] is application-defined.  When the message reaches
+ * the receiver's pipe, the block is owned by the receiver, which must
+ * Mfree() it; the sender must not use it after calling appl_write().
+ */
+#define AP_BUFFER   0x4542
+
 /* WM_ARROWED message: arrow type */
 #define WA_UPPAGE   0
 #define WA_DNPAGE   1
@@ -261,6 +270,7 @@
 #define MU_TIMER    0x0020
 #define MU_TOSVALID 0x003F      /* valid bits for TOS compatibility */
 #define MU_M3       0x0100      /* internal use only */
+#define MU_PERSIST  0x4000      /* EmuTOS extension: keep button/mouse waits armed */
 
 
 /*
@@ -549,6 +559,7 @@ typedef struct mform
 #define WF_SCREEN   17
 #define WF_COLOR    18
 #define WF_DCOLOR   19
+#define WF_RLIST    0x4552      /* EmuTOS-specific */
 
 /* request type: wind_calc() */
 #define WC_BORDER   0
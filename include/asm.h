@@ -272,9 +272,13 @@ static __inline__ void swpcopyw(const UWORD* src, UWORD* dest)
 /*
  * WORD set_sr(WORD new);
  *   sets sr to the new value, and return the old sr value
+ *
+ * with CONF_WITH_IRQ_TRACE, set_sr() times the windows during which the
+ * interrupts are masked (see bios/irqtrace.c); set_sr_untraced() is the
+ * plain instruction sequence
  */
 
-#define set_sr(a)                         \
+#define set_sr_untraced(a)                \
 __extension__                             \
 ({short _r, _a = (a);                     \
   __asm__ volatile                        \
@@ -287,6 +291,13 @@ __extension__                             \
   _r;                                     \
 })
 
+#if CONF_WITH_IRQ_TRACE
+short irq_trace_set_sr(short sr);
+#define set_sr(a) irq_trace_set_sr(a)
+#else
+#define set_sr(a) set_sr_untraced(a)
+#endif
+
 
 /*
  * WORD get_sr(void);
@@ -62,6 +62,8 @@
 #define CINVA_DC            .dc.w 0xf458            /* 68040-68060 */
 #define CINVA_IC            .dc.w 0xf498            /* 68040-68060 */
 #define CINVA_BC            .dc.w 0xf4d8            /* 68040-68060 */
+#define CPUSHA_DC           .dc.w 0xf478            /* 68040-68060 */
+#define CPUSHL_DC_A0        .dc.w 0xf468            /* 68040-68060 */
 #define CINVL_IC_A0         .dc.w 0xf488            /* 68040-68060 */
 
 #define ADDIWL_0_A0         .dc.l 0x06d00000        /* 68080 */
@@ -52,5 +52,14 @@ extern long trap1_pexec(short mode, const char *path, const char *tail, const ch
 #define Fsnext() trap1(0x4f)
 #define Frename(oldname,newname) trap1(0x56, 0, oldname, newname)
 #define Fdatime(timeptr,handle,wflag) trap1(0x57, timeptr, handle, wflag)
+#define Fsnextn(buf,count) trap1(0x58, buf, count)
+#define Fprealloc(handle,size) trap1(0x59, handle, size)
+#define Sosmem(info) trap1(0x5a, info)
+#define Smeminfo(pool,info,pd) trap1(0x5b, pool, info, pd)
+#define Sproctime(type,index,info) trap1(0x5c, type, index, info)
+#define Dfatmode(drive,mode) trap1(0x5d, drive, mode)
+#define Dsync(drive) trap1(0x5e, drive)
+#define Sdosprof(mode,index,info) trap1(0x5f, mode, index, info)
+#define Dreadahead(drive,count) trap1(0x60, drive, count)
 
 #endif /* _BDOSBIND_H */
@@ -21,6 +21,13 @@
 #define MX_PREFTTRAM 3
 #define MX_MODEMASK  0x03   /* mask for supported mode bits */
 
+/* EmuTOS extension: Mxalloc() mode bits requesting an aligned block */
+#define MX_ALIGN16   0x0100 /* 16 bytes (cache line, move16) */
+#define MX_ALIGN32   0x0200 /* 32 bytes */
+#define MX_ALIGN256  0x0300 /* 256 bytes */
+#define MX_ALIGN4K   0x0400 /* 4096 bytes (page) */
+#define MX_ALIGNMASK 0x0700
+
 /* Values of 'mode' for Pexec() */
 #define PE_LOADGO     0
 #define PE_LOAD       3
@@ -54,6 +61,117 @@ typedef struct
     char    d_fname[14];        /* name */
 } DTA;
 
+/*
+ *  FSENTRY - directory entry returned by Fsnextn()
+ *
+ *  e_attrib thru e_fname[] have the same size & sequence as the
+ *  corresponding items in the DTA, and e_attrib is on an odd boundary
+ *  like d_attrib, so an entry may be copied to or from a DTA in one go
+ */
+typedef struct
+{
+    char    e_fill;             /* unused */
+    char    e_attrib;           /* attributes */
+    UWORD   e_time;             /* packed time */
+    UWORD   e_date;             /* packed date */
+    LONG    e_length;           /* size */
+    char    e_fname[14];        /* name */
+} FSENTRY;
+
+/*
+ *  OSMINFO - OS memory pool information returned by Sosmem()
+ *
+ *  each block is 64 bytes; om_used[] is indexed by block type:
+ *  0 = MDBLOCK (holding up to 3 MDs, or 2 with CONF_WITH_MEMTREE),
+ *  1 = DMD, 2 = DND, 3 = OFD
+ */
+typedef struct
+{
+    LONG    om_blocks;          /* blocks in pool, including added slabs */
+    LONG    om_free;            /* blocks available */
+    LONG    om_slabs;           /* number of slabs added to the pool */
+    LONG    om_used[4];         /* blocks in use, by type */
+} OSMINFO;
+
+/*
+ *  MEMINFO - memory pool information returned by Smeminfo()
+ *
+ *  mi_frag is the fragmentation of the free space, in tenths of a
+ *  percent: 0 if all free memory is in one block, tending to 1000 as
+ *  free memory is split into many small blocks
+ */
+typedef struct
+{
+    LONG    mi_free;            /* total free memory */
+    LONG    mi_freeblks;        /* number of free blocks */
+    LONG    mi_largest;         /* size of the largest free block */
+    LONG    mi_used;            /* total allocated memory */
+    LONG    mi_usedblks;        /* number of allocated blocks */
+    LONG    mi_owned;           /* memory allocated to the specified process */
+    WORD    mi_frag;            /* 1000 * (1 - largest / free) */
+    WORD    mi_fill;
+    LONG    mi_ffit;            /* allocation requests, inc. size queries */
+    LONG    mi_failed;          /* allocation requests that failed */
+    LONG    mi_freeit;          /* blocks freed */
+} MEMINFO;
+
+/* Smeminfo() pool values */
+#define MI_STRAM    0
+#define MI_ALTRAM   1
+
+/*
+ *  PROCTIME - process running time returned by Sproctime()
+ *
+ *  the time counted for a GEMDOS process excludes the time during which
+ *  its children were running; the time counted for an AES process is
+ *  the time during which it was the AES process in context.  in both
+ *  cases, interrupts are counted for the process that they interrupted.
+ */
+typedef struct
+{
+    LONG    pt_id;              /* basepage address, or AES process id */
+    ULONG   pt_ticks;           /* running time, in 200 Hz ticks */
+    char    pt_name[10];        /* AES process name, empty for GEMDOS */
+} PROCTIME;
+
+/* Sproctime() process types */
+#define PT_GEMDOS   0
+#define PT_AES      1
+
+/*
+ *  DOSPROF - GEMDOS function profile returned by Sdosprof()
+ *
+ *  the time of a call is measured in osif(), from the dispatch to the
+ *  return of the function; for Pexec(), it includes the time during
+ *  which the child was running.  calls which fail with a disk error are
+ *  not counted.  dp_hist[] is only filled in for Fopen(), Fread(),
+ *  Fwrite(), Pexec() and Fsfirst(): dp_hist[0] to dp_hist[4] count the
+ *  calls which took less than 1, 2, 8, 32 and 128 ticks, and dp_hist[5]
+ *  the longer ones.
+ */
+#define DP_BUCKETS  6
+
+typedef struct
+{
+    ULONG   dp_calls;           /* number of calls */
+    ULONG   dp_ticks;           /* total time, in 200 Hz ticks */
+    ULONG   dp_hist[DP_BUCKETS];/* latency histogram */
+} DOSPROF;
+
+/*
+ *  DOSCACHE - BDOS buffer cache counters returned by Sdosprof()
+ */
+typedef struct
+{
+    ULONG   dc_lookups;         /* records requested */
+    ULONG   dc_misses;          /* records read from disk */
+} DOSCACHE;
+
+/* Sdosprof() modes */
+#define DP_FUNCTION 0
+#define DP_CACHE    1
+#define DP_RESET    2
+
 /*
  *  PD - Process Descriptor (a.k.a. BASEPAGE)
  */
@@ -89,7 +207,8 @@ struct _pd
     UBYTE   p_curdir[NUMCURDIR];    /* index into sys dir table */
     char    p_2fill[32-NUMCURDIR];
 /* 0x60 */
-    LONG    p_3fill[2];
+    ULONG   p_ticks;        /* EmuTOS: running time, see Sproctime() */
+    ULONG   p_tstamp;       /* EmuTOS: hz_200 when the process last resumed */
     LONG    p_dreg[1];      /* dreg[0] */
     LONG    p_areg[5];      /* areg[3..7] */
 /* 0x80 */
@@ -100,6 +219,8 @@ struct _pd
 #define PF_FASTLOAD     0x0001
 #define PF_TTRAMLOAD    0x0002
 #define PF_TTRAMMEM     0x0004
+#define PF_SMALLTPA     0x0008  /* TPA size is limited, see alloc_tpa() */
+#define PF_SHTEXT       0x0800  /* TEXT may be shared, see kpgmld.c */
 #define PF_STANDARD     (PF_FASTLOAD | PF_TTRAMLOAD | PF_TTRAMMEM)
 
 /*
@@ -111,7 +232,10 @@ struct _md
         MD      *m_link;    /* next MD, or NULL */
         UBYTE   *m_start;   /* start address of memory block */
         LONG    m_length;   /* number of bytes in memory block*/
+        union {
         PD      *m_own;     /* owner's process descriptor */
+        LONG    m_max;      /* free MDs: used by the MD index in iumem.c */
+        };
 };
 
 /*
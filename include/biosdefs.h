@@ -83,6 +83,34 @@ typedef struct _bpb BPB;
  */
 #define B_16    1       /* device has 16-bit FATs */
 #define B_1FAT  2       /* device has only a single FAT */
+#define B_32    4       /* device has 32-bit FATs (see BPBEXT below) */
+
+#if CONF_WITH_FAT32
+/*
+ *  BPBEXT - BPB extension for FAT32
+ *
+ *  the fields of a standard BPB are too small for FAT32, so for a FAT32
+ *  device (B_32 set in b_flags), Getbpb() returns a BPB with the FAT
+ *  size, record numbers and cluster count set to zero, immediately
+ *  followed in memory by this structure.  the root directory is a
+ *  cluster chain like any other directory.
+ */
+typedef struct
+{
+    ULONG fsiz;         /* FAT size in records */
+    ULONG fatrec;       /* first FAT record (of last FAT) */
+    ULONG datrec;       /* first data record */
+    ULONG numcl;        /* number of data clusters available */
+    ULONG rootcl;       /* first cluster of root directory */
+    UWORD fsinfo;       /* FSInfo record, 0 if none */
+} BPBEXT;
+
+typedef struct
+{
+    BPB bpb;
+    BPBEXT x;
+} BPB32;
+#endif
 
 /*
  * Flags for Kbshift()
@@ -35,6 +35,17 @@ struct font_head;
 /* Bitmap of removable logical drives */
 extern LONG drvrem;
 
+#if CONF_WITH_MEDIACH_CACHE
+/* incremented on each (possible) media change event */
+extern UWORD blkdev_changes;
+BOOL blkdev_fixed(WORD dev);
+#endif
+
+#if CONF_WITH_RAMDISK
+/* address of a logical sector on the RAM disk, or NULL */
+UBYTE *blkdev_direct(WORD dev, LONG lrecnr);
+#endif
+
 /* Boot flags */
 extern UBYTE bootflags;
 #define BOOTFLAG_EARLY_CLI     0x01
@@ -58,6 +69,9 @@ WORD cache_exists(void);
 void set_cache(WORD enable);
 #endif
 
+/* output a string of characters to a device, for the BDOS */
+BOOL bconouts(WORD handle, const UBYTE *buf, LONG count);
+
 /* bios allocation of ST-RAM */
 UBYTE *balloc_stram(ULONG size, BOOL top);
 
@@ -100,10 +114,32 @@ extern struct font_head fon8x16;
 BOOL is_text_pointer(const void *p);
 #endif
 
+#if CONF_WITH_BOOT_PROFILE
+/* boot time profiling, see bios/bootprof.c (supervisor mode only) */
+void boot_phase(const char *name);
+void boot_profile_dump(BOOL complete);
+#endif
+
+#if CONF_WITH_IRQ_TRACE
+/* interrupt masking latency tracer, see bios/irqtrace.c */
+WORD irq_trace_set_sr_at(WORD sr, const void *pc);
+void irq_trace_dump(void);
+#endif
+
 /* VIDEL routines */
 WORD get_videl_mode(void);
 #ifdef MACHINE_AMIGA
 WORD amiga_vgetmode(void);
 #endif
 
+#if CONF_WITH_AMIGA_PLANAR
+/* mark screen lines y1 to y2 as modified, for the Amiga bitplane conversion */
+void amiga_screen_dirty(WORD y1, WORD y2);
+#endif
+
+#if CONF_WITH_AES_PREEMPTION
+/* exception frame of the Timer C interrupt, valid while etv_timer is called */
+extern UWORD *timerc_frame;
+#endif
+
 #endif /* BIOSEXT_H */
@@ -116,6 +116,9 @@
 # ifndef CONF_WITH_EASTER_EGG
 #  define CONF_WITH_EASTER_EGG 0 /* ARAnyM's YM2149 can't produce sound */
 # endif
+# ifndef CONF_FIXED_HARDWARE
+#  define CONF_FIXED_HARDWARE 1
+# endif
 #endif
 
 /*
@@ -194,6 +197,9 @@
 # ifndef CONF_WITH_FORMAT
 #  define CONF_WITH_FORMAT 0
 # endif
+# ifndef CONF_FIXED_HARDWARE
+#  define CONF_FIXED_HARDWARE 1
+# endif
 #endif
 
 /*
@@ -352,6 +358,9 @@
 # ifndef CONF_WITH_EXTENDED_MOUSE
 #  define CONF_WITH_EXTENDED_MOUSE 0
 # endif
+# ifndef CONF_WITH_MOUSE_COALESCE
+#  define CONF_WITH_MOUSE_COALESCE 0
+# endif
 # ifndef CONF_WITH_VDI_VERTLINE
 #  define CONF_WITH_VDI_VERTLINE 0
 # endif
@@ -364,6 +373,102 @@
 # ifndef CONF_WITH_READ_INF
 #  define CONF_WITH_READ_INF 0
 # endif
+# ifndef CONF_WITH_BDOS_CACHE
+#  define CONF_WITH_BDOS_CACHE 0
+# endif
+# ifndef CONF_WITH_BDOS_FREEMAP
+#  define CONF_WITH_BDOS_FREEMAP 0
+# endif
+# ifndef CONF_WITH_BDOS_EXTENTS
+#  define CONF_WITH_BDOS_EXTENTS 0
+# endif
+# ifndef CONF_WITH_FSNEXTN
+#  define CONF_WITH_FSNEXTN 0
+# endif
+# ifndef CONF_WITH_OSMEM_SLABS
+#  define CONF_WITH_OSMEM_SLABS 0
+# endif
+# ifndef CONF_WITH_MEMTREE
+#  define CONF_WITH_MEMTREE 0
+# endif
+# ifndef CONF_WITH_MEMINFO
+#  define CONF_WITH_MEMINFO 0
+# endif
+# ifndef CONF_WITH_IDE_LBA48
+#  define CONF_WITH_IDE_LBA48 0
+# endif
+# ifndef CONF_WITH_DISK_CACHE
+#  define CONF_WITH_DISK_CACHE 0
+# endif
+# ifndef CONF_WITH_ANODE_INDEX
+#  define CONF_WITH_ANODE_INDEX 0
+# endif
+# ifndef CONF_WITH_TEXT_ROW_CACHE
+#  define CONF_WITH_TEXT_ROW_CACHE 0
+# endif
+# ifndef CONF_WITH_EVNT_PERSIST
+#  define CONF_WITH_EVNT_PERSIST 0
+# endif
+# ifndef CONF_WITH_WINDOW_GADGET_UPDATE
+#  define CONF_WITH_WINDOW_GADGET_UPDATE 0
+# endif
+# ifndef CONF_WITH_MENU_ITEM_LOOKUP
+#  define CONF_WITH_MENU_ITEM_LOOKUP 0
+# endif
+# ifndef CONF_WITH_AES_BUFFER_MSG
+#  define CONF_WITH_AES_BUFFER_MSG 0
+# endif
+# ifndef CONF_WITH_MEDIACH_CACHE
+#  define CONF_WITH_MEDIACH_CACHE 0
+# endif
+# ifndef CONF_WITH_VDI_BATCH
+#  define CONF_WITH_VDI_BATCH 0
+# endif
+# ifndef CONF_WITH_VDI_EDGE_TABLE
+#  define CONF_WITH_VDI_EDGE_TABLE 0
+# endif
+# ifndef CONF_WITH_VDI_GLYPH_CACHE
+#  define CONF_WITH_VDI_GLYPH_CACHE 0
+# endif
+# ifndef CONF_WITH_VDI_SPAN_MERGE
+#  define CONF_WITH_VDI_SPAN_MERGE 0
+# endif
+# ifndef CONF_WITH_VDI_LINE_FILL
+#  define CONF_WITH_VDI_LINE_FILL 0
+# endif
+# ifndef CONF_WITH_VDI_FILL_EXPAND
+#  define CONF_WITH_VDI_FILL_EXPAND 0
+# endif
+# ifndef CONF_WITH_VDI_SCRNINFO
+#  define CONF_WITH_VDI_SCRNINFO 0
+# endif
+# ifndef CONF_WITH_VDI_MARKER_STAMPS
+#  define CONF_WITH_VDI_MARKER_STAMPS 0
+# endif
+# ifndef CONF_WITH_VDI_BITMAP
+#  define CONF_WITH_VDI_BITMAP 0
+# endif
+# ifndef CONF_WITH_MOUSE_EXCLUSION
+#  define CONF_WITH_MOUSE_EXCLUSION 0
+# endif
+# ifndef CONF_WITH_VDI_ELLIPSE_RASTER
+#  define CONF_WITH_VDI_ELLIPSE_RASTER 0
+# endif
+# ifndef CONF_WITH_AES_SUBTREE_CLIP
+#  define CONF_WITH_AES_SUBTREE_CLIP 0
+# endif
+# ifndef CONF_WITH_LINEA_RECTS
+#  define CONF_WITH_LINEA_RECTS 0
+# endif
+# ifndef CONF_WITH_VDI_FONT_INDEX
+#  define CONF_WITH_VDI_FONT_INDEX 0
+# endif
+# ifndef CONF_WITH_AES_FOREGROUND_BOOST
+#  define CONF_WITH_AES_FOREGROUND_BOOST 0
+# endif
+# ifndef CONF_WITH_AES_PARTIAL_MOVE
+#  define CONF_WITH_AES_PARTIAL_MOVE 0
+# endif
 # ifndef CONF_WITH_68030_PMMU
 #  define CONF_WITH_68030_PMMU 0
 # endif
@@ -491,6 +596,9 @@
 # ifndef CONF_WITH_EXTENDED_MOUSE
 #  define CONF_WITH_EXTENDED_MOUSE 0
 # endif
+# ifndef CONF_WITH_MOUSE_COALESCE
+#  define CONF_WITH_MOUSE_COALESCE 0
+# endif
 # ifndef CONF_WITH_VDI_TEXT_SPEEDUP
 #  define CONF_WITH_VDI_TEXT_SPEEDUP 0
 # endif
@@ -530,6 +638,102 @@
 # ifndef CONF_WITH_NOVA
 #  define CONF_WITH_NOVA 0
 # endif
+# ifndef CONF_WITH_BDOS_CACHE
+#  define CONF_WITH_BDOS_CACHE 0
+# endif
+# ifndef CONF_WITH_BDOS_FREEMAP
+#  define CONF_WITH_BDOS_FREEMAP 0
+# endif
+# ifndef CONF_WITH_BDOS_EXTENTS
+#  define CONF_WITH_BDOS_EXTENTS 0
+# endif
+# ifndef CONF_WITH_FSNEXTN
+#  define CONF_WITH_FSNEXTN 0
+# endif
+# ifndef CONF_WITH_OSMEM_SLABS
+#  define CONF_WITH_OSMEM_SLABS 0
+# endif
+# ifndef CONF_WITH_MEMTREE
+#  define CONF_WITH_MEMTREE 0
+# endif
+# ifndef CONF_WITH_MEMINFO
+#  define CONF_WITH_MEMINFO 0
+# endif
+# ifndef CONF_WITH_IDE_LBA48
+#  define CONF_WITH_IDE_LBA48 0
+# endif
+# ifndef CONF_WITH_DISK_CACHE
+#  define CONF_WITH_DISK_CACHE 0
+# endif
+# ifndef CONF_WITH_ANODE_INDEX
+#  define CONF_WITH_ANODE_INDEX 0
+# endif
+# ifndef CONF_WITH_TEXT_ROW_CACHE
+#  define CONF_WITH_TEXT_ROW_CACHE 0
+# endif
+# ifndef CONF_WITH_EVNT_PERSIST
+#  define CONF_WITH_EVNT_PERSIST 0
+# endif
+# ifndef CONF_WITH_WINDOW_GADGET_UPDATE
+#  define CONF_WITH_WINDOW_GADGET_UPDATE 0
+# endif
+# ifndef CONF_WITH_MENU_ITEM_LOOKUP
+#  define CONF_WITH_MENU_ITEM_LOOKUP 0
+# endif
+# ifndef CONF_WITH_AES_BUFFER_MSG
+#  define CONF_WITH_AES_BUFFER_MSG 0
+# endif
+# ifndef CONF_WITH_MEDIACH_CACHE
+#  define CONF_WITH_MEDIACH_CACHE 0
+# endif
+# ifndef CONF_WITH_VDI_BATCH
+#  define CONF_WITH_VDI_BATCH 0
+# endif
+# ifndef CONF_WITH_VDI_EDGE_TABLE
+#  define CONF_WITH_VDI_EDGE_TABLE 0
+# endif
+# ifndef CONF_WITH_VDI_GLYPH_CACHE
+#  define CONF_WITH_VDI_GLYPH_CACHE 0
+# endif
+# ifndef CONF_WITH_VDI_SPAN_MERGE
+#  define CONF_WITH_VDI_SPAN_MERGE 0
+# endif
+# ifndef CONF_WITH_VDI_LINE_FILL
+#  define CONF_WITH_VDI_LINE_FILL 0
+# endif
+# ifndef CONF_WITH_VDI_FILL_EXPAND
+#  define CONF_WITH_VDI_FILL_EXPAND 0
+# endif
+# ifndef CONF_WITH_VDI_SCRNINFO
+#  define CONF_WITH_VDI_SCRNINFO 0
+# endif
+# ifndef CONF_WITH_VDI_MARKER_STAMPS
+#  define CONF_WITH_VDI_MARKER_STAMPS 0
+# endif
+# ifndef CONF_WITH_VDI_BITMAP
+#  define CONF_WITH_VDI_BITMAP 0
+# endif
+# ifndef CONF_WITH_MOUSE_EXCLUSION
+#  define CONF_WITH_MOUSE_EXCLUSION 0
+# endif
+# ifndef CONF_WITH_VDI_ELLIPSE_RASTER
+#  define CONF_WITH_VDI_ELLIPSE_RASTER 0
+# endif
+# ifndef CONF_WITH_AES_SUBTREE_CLIP
+#  define CONF_WITH_AES_SUBTREE_CLIP 0
+# endif
+# ifndef CONF_WITH_LINEA_RECTS
+#  define CONF_WITH_LINEA_RECTS 0
+# endif
+# ifndef CONF_WITH_VDI_FONT_INDEX
+#  define CONF_WITH_VDI_FONT_INDEX 0
+# endif
+# ifndef CONF_WITH_AES_FOREGROUND_BOOST
+#  define CONF_WITH_AES_FOREGROUND_BOOST 0
+# endif
+# ifndef CONF_WITH_AES_PARTIAL_MOVE
+#  define CONF_WITH_AES_PARTIAL_MOVE 0
+# endif
 # ifndef MAX_VERTICES
 #  define MAX_VERTICES 512
 # endif
@@ -977,6 +1181,16 @@
 # define CONF_WITH_MIDI_ACIA 1
 #endif
 
+/*
+ * Set CONF_WITH_MIDI_QUEUES to 1 to queue MIDI output, which is then sent
+ * by the ACIA transmit interrupt, so that Midiws() returns immediately.
+ * This also records the 200 Hz timer value for each received MIDI byte,
+ * in a table pointed to by the longword that follows the MIDI IOREC.
+ */
+#ifndef CONF_WITH_MIDI_QUEUES
+# define CONF_WITH_MIDI_QUEUES 0
+#endif
+
 /*
  * Set CONF_WITH_IKBD_ACIA to 1 to enable IKBD ACIA support
  */
@@ -1011,6 +1225,52 @@
 # define CONF_WITH_FDC 1
 #endif
 
+/*
+ * Set CONF_WITH_FLOPPY_CACHE to 1 to read a whole floppy track/side when
+ * the BIOS reads part of it, and to satisfy later reads from the same
+ * track/side from memory.  This requires CONF_WITH_FDC.  The track buffer
+ * is 9 KB of BSS, which raises membot by that amount and may break
+ * programs that expect the same free memory as with TOS, so this is off
+ * by default.
+ */
+#ifndef CONF_WITH_FLOPPY_CACHE
+# define CONF_WITH_FLOPPY_CACHE 0
+#endif
+
+/*
+ * RWABS_RETRIES_FLOPPY and RWABS_RETRIES_DISK are the number of times
+ * Rwabs() tries a failing transfer on a floppy or another unit before
+ * calling the critical error handler (which shows the AES alert, and may
+ * request more tries).  RWABS_RETRY_DELAY is the wait in milliseconds
+ * before the first automatic retry, doubled before each further one.
+ * Interrupts stay enabled while waiting.
+ */
+#ifndef RWABS_RETRIES_FLOPPY
+# define RWABS_RETRIES_FLOPPY 1
+#endif
+#ifndef RWABS_RETRIES_DISK
+# define RWABS_RETRIES_DISK 1
+#endif
+#ifndef RWABS_RETRY_DELAY
+# define RWABS_RETRY_DELAY 50
+#endif
+
+/*
+ * Set CONF_WITH_MEDIACH_CACHE to 1 to let the BDOS remember that a drive
+ * reported no media change, so that buffer cache hits do not call
+ * Mediach() each time.  Drives on non-removable units are then not
+ * polled at all, and the result for removable ones is kept for
+ * MEDIACH_CACHE_TICKS (in 200 Hz ticks).  Both are invalidated by any
+ * media change event seen by the BIOS, such as a write-protect change
+ * detected by the floppy VBL routine.
+ */
+#ifndef CONF_WITH_MEDIACH_CACHE
+# define CONF_WITH_MEDIACH_CACHE 1
+#endif
+#ifndef MEDIACH_CACHE_TICKS
+# define MEDIACH_CACHE_TICKS 300
+#endif
+
 /*
  * Set this to 1 to activate ACSI support
  */
@@ -1025,6 +1285,15 @@
 # define CONF_WITH_SCSI 1
 #endif
 
+/*
+ * Set CONF_WITH_SCSI_DISCONNECT to 1 to allow SCSI targets to disconnect
+ * from the bus during a command (e.g. while seeking or rewinding), and to
+ * handle their subsequent reselection.  You must also enable CONF_WITH_SCSI.
+ */
+#ifndef CONF_WITH_SCSI_DISCONNECT
+# define CONF_WITH_SCSI_DISCONNECT 0
+#endif
+
 /*
  * Set CONF_WITH_IDE to 1 to activate Falcon IDE support
  */
@@ -1032,6 +1301,15 @@
 # define CONF_WITH_IDE 1
 #endif
 
+/*
+ * Set CONF_WITH_IDE_LBA48 to 1 to use the 48-bit LBA commands with IDE
+ * devices that support them.  This allows transfers of more than 256
+ * sectors per command, and disks larger than 128 GB.
+ */
+#ifndef CONF_WITH_IDE_LBA48
+# define CONF_WITH_IDE_LBA48 CONF_WITH_IDE
+#endif
+
 /*
  * Set CONF_WITH_SDMMC to 1 to activate SD/MMC bus support
  */
@@ -1047,6 +1325,31 @@
 # define CONF_WITH_VAMPIRE_SPI 0
 #endif
 
+/*
+ * Set CONF_WITH_SDMMC_HIGHSPEED to 1 to switch SD cards to High Speed
+ * mode when they support it, and run them at the fastest SPI clock that
+ * passes a read-verify probe.  The data CRC is then checked, and the
+ * clock is lowered when it is bad.
+ */
+#ifndef CONF_WITH_SDMMC_HIGHSPEED
+# define CONF_WITH_SDMMC_HIGHSPEED CONF_WITH_SDMMC
+#endif
+
+/*
+ * Set CONF_WITH_RAMDISK to 1 to provide a RAM disk, located at the top
+ * of TT-RAM.  It is handled as an extra bus (major device 32), so it is
+ * visible through XHDI, and the BDOS accesses its files and directories
+ * in place rather than through the buffer cache.
+ * RAMDISK_SIZE is its size in kilobytes: it is only created if at least
+ * twice that amount of TT-RAM is available.
+ */
+#ifndef CONF_WITH_RAMDISK
+# define CONF_WITH_RAMDISK 0
+#endif
+#ifndef RAMDISK_SIZE
+# define RAMDISK_SIZE 4096
+#endif
+
 /*
  * Set CONF_WITH_ATARI_VIDEO to 1 to enable support for ST Shifter and higher
  */
@@ -1151,6 +1454,16 @@
 # define CONF_WITH_BLITTER 1
 #endif
 
+/*
+ * On a 68020 or better, the VDI draws operations smaller than
+ * BLITTER_MIN_SIZE (width x height x planes) with the CPU even if the
+ * blitter is enabled, because the CPU is faster than the blitter setup.
+ * Set it to 0 to always use the blitter when it is enabled.
+ */
+#ifndef BLITTER_MIN_SIZE
+# define BLITTER_MIN_SIZE 4096UL
+#endif
+
 /*
  * Set CONF_WITH_SFP004 to 1 to enable 68881 FPU support for the Mega ST
  */
@@ -1233,6 +1546,27 @@
 # define AES_STACK_SIZE 590     /* standard value for 68K systems, in LONGs */
 #endif
 
+/*
+ * AES_QUEUE_SIZE is the size in bytes of the message pipe of each AES
+ * process.  Atari TOS uses 128 bytes, i.e. 8 standard messages; a bigger
+ * pipe means that a process sending a burst of messages (e.g. WM_REDRAW)
+ * is less likely to block until the receiver has read some of them.
+ * It must be a multiple of 16.
+ */
+#ifndef AES_QUEUE_SIZE
+# define AES_QUEUE_SIZE 256
+#endif
+
+/*
+ * AES_KBD_QUEUE_SIZE is the number of keystrokes that the AES buffers for
+ * the process that owns the keyboard.  Atari TOS uses 8.  Keys that do
+ * not fit are left in the BIOS keyboard buffer (see IKBD_IOREC_SIZE),
+ * but a bigger queue moves them out of the interrupt path sooner.
+ */
+#ifndef AES_KBD_QUEUE_SIZE
+# define AES_KBD_QUEUE_SIZE 16
+#endif
+
 /*
  * Set CONF_WITH_3D_OBJECTS to 1 to enable support for 3D objects,
  * as in Atari TOS 4
@@ -1287,6 +1621,24 @@
 # define CONF_WITH_MENU_EXTENSION 1
 #endif
 
+/*
+ * Set CONF_WITH_MENU_ITEM_LOOKUP to 1 to record the item rectangles of
+ * a menu when it is pulled down, so that the item under the mouse can
+ * be found from its y position rather than via ob_find()
+ */
+#ifndef CONF_WITH_MENU_ITEM_LOOKUP
+# define CONF_WITH_MENU_ITEM_LOOKUP 1
+#endif
+
+/*
+ * Set CONF_WITH_AES_BUFFER_MSG to 1 to support the EmuTOS-specific
+ * AP_BUFFER message, which hands over a memory block to the receiver
+ * so that data of any size can be passed without copying it
+ */
+#ifndef CONF_WITH_AES_BUFFER_MSG
+# define CONF_WITH_AES_BUFFER_MSG 1
+#endif
+
 /*
  * Set CONF_WITH_NICELINES to use a drawn line instead of dashes for
  * separators in menus
@@ -1311,6 +1663,35 @@
 # define CONF_WITH_WINDOW_COLOURS 1
 #endif
 
+/*
+ * Set CONF_WITH_WF_RLIST to 1 to support the EmuTOS-specific wind_get()
+ * mode WF_RLIST, which copies all the rectangles of a window's rectangle
+ * list to a buffer supplied by the caller, rather than requiring one
+ * call per rectangle via WF_FIRSTXYWH/WF_NEXTXYWH.
+ */
+#ifndef CONF_WITH_WF_RLIST
+# define CONF_WITH_WF_RLIST 1
+#endif
+
+/*
+ * Set CONF_WITH_WINDOW_GADGET_UPDATE to 1 to make wind_set() update just
+ * the slider, name or info line gadget being changed, rather than
+ * rebuilding the whole window object tree, when that is possible
+ */
+#ifndef CONF_WITH_WINDOW_GADGET_UPDATE
+# define CONF_WITH_WINDOW_GADGET_UPDATE 1
+#endif
+
+/*
+ * Set CONF_WITH_EVNT_PERSIST to 1 to support the EmuTOS-specific
+ * evnt_multi() flag MU_PERSIST, which leaves the button and mouse
+ * rectangle waits armed on return, so that a loop calling evnt_multi()
+ * with unchanged parameters does not set them up again on each call.
+ */
+#ifndef CONF_WITH_EVNT_PERSIST
+# define CONF_WITH_EVNT_PERSIST 1
+#endif
+
 /*
  * Define the AES version here. This must be done at the end of the
  * "Software Section - AES", since the value depends on features that
@@ -1436,6 +1817,19 @@
 # define CONF_SERIAL_CONSOLE_POLLING_MODE 0
 #endif
 
+/*
+ * Set CONF_WITH_DEFERRED_CONSOLE to 1 to make the VT52 console update a
+ * shadow copy of the text screen, and only repaint the changed cells from
+ * the VBL interrupt.  Scrolling the whole screen then just rotates the
+ * shadow copy, and many updates are merged into one repaint per frame,
+ * which speeds up heavy console output.  Text may appear up to one frame
+ * late, which may confuse programs mixing console output with direct
+ * screen access, so this is not enabled by default.
+ */
+#ifndef CONF_WITH_DEFERRED_CONSOLE
+# define CONF_WITH_DEFERRED_CONSOLE 0
+#endif
+
 /*
  * Set CONF_SERIAL_IKBD to 1 to allow IKBD keyboard/mouse/joysticks to be
  * plugged on the serial port
@@ -1462,6 +1856,17 @@
 # define CONF_WITH_68040_PMMU 0
 #endif
 
+/*
+ * Set CONF_WITH_ROM_SHADOW to 1 to copy the ROM to the last megabyte of
+ * TT-RAM at boot, and to map the ROM address range onto that copy via
+ * the PMMU tree (write-protected, with caching allowed).  Since TT-RAM is
+ * much faster than ROM, this speeds up the whole OS.  The copy is only
+ * used when a PMMU tree is installed, and _ramtop is lowered by 1 MB.
+ */
+#ifndef CONF_WITH_ROM_SHADOW
+# define CONF_WITH_ROM_SHADOW 0
+#endif
+
 /*
  * Set CONF_WITH_BIOS_EXTENSIONS to 1 to support various BIOS extension
  * functions
@@ -1479,6 +1884,28 @@
 # define CONF_WITH_EXTENDED_MOUSE 1
 #endif
 
+/*
+ * Set CONF_WITH_MOUSE_COALESCE to 1 to accumulate the relative mouse
+ * packets received between two VBLs when the mouse vector is the VDI's
+ * own, and to deliver them as one at the next VBL.  Packets that change
+ * the button state are still delivered at once, and a mouse vector
+ * installed by a program still gets every packet.
+ *
+ * MOUSE_ACCEL_THRESHOLD and MOUSE_ACCEL_FACTOR define a simple
+ * acceleration curve for the accumulated movement: the part of each
+ * packet's movement (per axis) beyond the threshold is multiplied by the
+ * factor.  A threshold of 0 disables acceleration.
+ */
+#ifndef CONF_WITH_MOUSE_COALESCE
+# define CONF_WITH_MOUSE_COALESCE 1
+#endif
+#ifndef MOUSE_ACCEL_THRESHOLD
+# define MOUSE_ACCEL_THRESHOLD 0
+#endif
+#ifndef MOUSE_ACCEL_FACTOR
+# define MOUSE_ACCEL_FACTOR 2
+#endif
+
 /*
  * Set CONF_WITH_FRB to 1 to automatically enable the _FRB cookie when required
  */
@@ -1486,6 +1913,15 @@
 # define CONF_WITH_FRB CONF_WITH_ALT_RAM
 #endif
 
+/*
+ * Set CONF_WITH_ACSI_OVERLAP to 1 to split the intermediate buffer used
+ * for ACSI transfers to/from Alt-RAM in two halves, so that copying to or
+ * from one half overlaps the DMA transfer using the other half.
+ */
+#ifndef CONF_WITH_ACSI_OVERLAP
+# define CONF_WITH_ACSI_OVERLAP (CONF_WITH_ACSI && CONF_WITH_FRB)
+#endif
+
 /*
  * set CONF_WITH_MEMORY_TEST to 1 to do a memory test during a cold boot
  */
@@ -1493,6 +1929,17 @@
 # define CONF_WITH_MEMORY_TEST 0
 #endif
 
+/*
+ * Set CONF_MEMTEST_SAMPLE_SIZE to a non-zero number of bytes to make the
+ * memory test only check that amount at the start of each zone (1/32 of
+ * a RAM type), rather than the whole zone.  This keeps the cold boot
+ * quick on systems with hundreds of megabytes of TT-RAM, at the cost of
+ * a less thorough test.  It must be a multiple of 4.
+ */
+#ifndef CONF_MEMTEST_SAMPLE_SIZE
+# define CONF_MEMTEST_SAMPLE_SIZE 0
+#endif
+
 /*
  * Set CONF_WITH_XBIOS_SOUND to 1 to enable support for the XBIOS sound
  * extension.  This extension provides (some of) the Falcon XBIOS sound
@@ -1510,6 +1957,23 @@
 # define DEFAULT_BAUDRATE B9600
 #endif
 
+/*
+ * Sizes in bytes of the input buffers returned by Iorec().  The defaults
+ * are the same as Atari TOS; larger values let bursts of input (e.g. from
+ * a barcode scanner) be held until a program reads them.  Each keyboard
+ * entry uses 4 bytes, so IKBD_IOREC_SIZE must be a multiple of 4.  All
+ * values must be less than 32768.
+ */
+#ifndef IKBD_IOREC_SIZE
+# define IKBD_IOREC_SIZE 256
+#endif
+#ifndef MIDI_IOREC_SIZE
+# define MIDI_IOREC_SIZE 128
+#endif
+#ifndef RS232_IOREC_SIZE
+# define RS232_IOREC_SIZE 256
+#endif
+
 /*
  * Retry count for the internal_inquire() used to detect the presence of
  * a physical hard disk drive
@@ -1541,6 +2005,17 @@
 # define CONF_WITH_1FAT_SUPPORT 0
 #endif
 
+/*
+ * Set CONF_WITH_FAT32 to 1 to support FAT32 filesystems, so that large
+ * media can be used as a single partition.  Cluster numbers become 32-bit
+ * throughout the BDOS, which makes it slightly larger and slower.  The
+ * free cluster count recorded in the FSInfo sector is used by Dfree(),
+ * so that the FAT does not need to be scanned.
+ */
+#ifndef CONF_WITH_FAT32
+# define CONF_WITH_FAT32 0
+#endif
+
 
 
 /********************************************************
@@ -1581,6 +2056,279 @@
 # define CONF_LOGSEC_SIZE 512
 #endif
 
+/*
+ * Set CONF_WITH_BDOS_CACHE to 1 to enlarge the BDOS sector buffer cache
+ * at boot time, and to look up buffers in it via a hash table.  The
+ * additional buffers are only allocated in Alt-RAM: ST-RAM is kept free
+ * for programs which are booted directly.  The bufl[] chains remain
+ * valid for programs that walk them.
+ *
+ * BDOS_CACHE_PERCENT is the percentage of free Alt-RAM to use for the
+ * additional buffers, and BDOS_CACHE_MAXBUFS is an upper limit on
+ * their number.
+ */
+#ifndef CONF_WITH_BDOS_CACHE
+# define CONF_WITH_BDOS_CACHE 1
+#endif
+#ifndef BDOS_CACHE_PERCENT
+# define BDOS_CACHE_PERCENT 2
+#endif
+#ifndef BDOS_CACHE_MAXBUFS
+# define BDOS_CACHE_MAXBUFS 256
+#endif
+
+/*
+ * Set CONF_WITH_BDOS_WRITEBACK to 1 to write back dirty BDOS buffers in
+ * batches: runs of adjacent dirty records are copied to a staging buffer
+ * of BDOS_WRITEBACK_SIZE bytes and written by a single Rwabs(), and FAT
+ * records are written to both FATs from that buffer.  The staging buffer
+ * is only allocated, in Alt-RAM, along with the additional buffers of
+ * CONF_WITH_BDOS_CACHE; without it, buffers are written one at a time,
+ * and there is no read-ahead or FAT mirror deferral.  Batches are also
+ * written BDOS_WRITEBACK_DELAY milliseconds after a buffer is first
+ * dirtied, at the next GEMDOS call.  This requires CONF_WITH_BDOS_CACHE.
+ */
+#ifndef CONF_WITH_BDOS_WRITEBACK
+# define CONF_WITH_BDOS_WRITEBACK CONF_WITH_BDOS_CACHE
+#endif
+#ifndef BDOS_WRITEBACK_SIZE
+# define BDOS_WRITEBACK_SIZE 8192
+#endif
+#ifndef BDOS_WRITEBACK_DELAY
+# define BDOS_WRITEBACK_DELAY 2000
+#endif
+
+/*
+ * Set CONF_WITH_FATMIRROR_DEFER to 1 to provide the EmuTOS-specific
+ * Dfatmode() GEMDOS call (0x5D), which lets a drive be switched to a mode
+ * where FAT changes are written to one FAT only, and the second FAT is
+ * brought up to date in a single pass when the dirty buffers are
+ * written back (after BDOS_WRITEBACK_DELAY, when a file is closed, and
+ * before a possible media change).  This roughly halves the FAT write
+ * traffic during heavy writes, at the cost of the second FAT being out
+ * of date for a while.  This requires CONF_WITH_BDOS_WRITEBACK.
+ */
+#ifndef CONF_WITH_FATMIRROR_DEFER
+# define CONF_WITH_FATMIRROR_DEFER 0
+#endif
+
+/*
+ * Set CONF_WITH_DSYNC to 1 to provide the EmuTOS-specific Dsync()
+ * GEMDOS call (0x5E), which writes back the dirty buffers of one drive,
+ * or of all drives in drive order.  The AES calls it before a shutdown
+ * or a resolution change, and the BIOS before shutdown().  This requires
+ * CONF_WITH_BDOS_WRITEBACK.
+ */
+#ifndef CONF_WITH_DSYNC
+# define CONF_WITH_DSYNC CONF_WITH_BDOS_WRITEBACK
+#endif
+
+/*
+ * Set CONF_WITH_BDOS_FREEMAP to 1 to keep an in-memory bitmap of the
+ * free clusters on each drive.  It is built the first time that a
+ * cluster is allocated or Dfree() is called, is kept up to date when
+ * the FAT is modified, and is discarded on media change.
+ */
+#ifndef CONF_WITH_BDOS_FREEMAP
+# define CONF_WITH_BDOS_FREEMAP 1
+#endif
+
+/*
+ * Set CONF_WITH_BDOS_EXTENTS to 1 to remember the layout of the cluster
+ * chains of recently-used files as runs of contiguous clusters.  This
+ * speeds up seeks within large files, and lets reads and writes of
+ * whole clusters find contiguous runs without following the FAT.
+ *
+ * BDOS_EXTENT_MAPS is the number of files whose layout is remembered,
+ * and BDOS_EXTENTS_PER_MAP the maximum number of runs for each file.
+ */
+#ifndef CONF_WITH_BDOS_EXTENTS
+# define CONF_WITH_BDOS_EXTENTS 1
+#endif
+#ifndef BDOS_EXTENT_MAPS
+# define BDOS_EXTENT_MAPS 8
+#endif
+#ifndef BDOS_EXTENTS_PER_MAP
+# define BDOS_EXTENTS_PER_MAP 16
+#endif
+
+/*
+ * Set CONF_WITH_BDOS_READAHEAD to 1 to read ahead when a file is read
+ * sequentially.  When a read starts where the previous one ended, and
+ * needs a record that is not in the cache, the records that follow it
+ * are read into the cache by the same Rwabs(), as far as they are
+ * contiguous on disk.  This uses the staging buffer described above, and
+ * requires CONF_WITH_BDOS_CACHE.
+ *
+ * BDOS_READAHEAD_FLOPPY and BDOS_READAHEAD_DISK are the number of records
+ * to read at a time for floppy drives and for other drives respectively
+ * (0 disables read-ahead).  They are copied to each drive's DMD when the
+ * media is logged in.  BDOS_READAHEAD_MAX is the upper limit.
+ */
+#ifndef CONF_WITH_BDOS_READAHEAD
+# define CONF_WITH_BDOS_READAHEAD CONF_WITH_BDOS_CACHE
+#endif
+#ifndef BDOS_READAHEAD_FLOPPY
+# define BDOS_READAHEAD_FLOPPY 8
+#endif
+#ifndef BDOS_READAHEAD_DISK
+# define BDOS_READAHEAD_DISK 16
+#endif
+#ifndef BDOS_READAHEAD_MAX
+# define BDOS_READAHEAD_MAX 32
+#endif
+
+/*
+ * Set CONF_WITH_DREADAHEAD to 1 to provide the EmuTOS-specific
+ * Dreadahead() GEMDOS call (0x60), which gets or sets the read-ahead
+ * limit of a drive at run time, instead of the defaults above.  The
+ * setting is kept across media changes.  This requires
+ * CONF_WITH_BDOS_READAHEAD.
+ */
+#ifndef CONF_WITH_DREADAHEAD
+# define CONF_WITH_DREADAHEAD CONF_WITH_BDOS_READAHEAD
+#endif
+
+/*
+ * Set CONF_WITH_BDOS_NAMECACHE to 1 to remember the position of directory
+ * entries by name, so that opening a file in a large directory does not
+ * require reading the directory from the start.  The entries are allocated
+ * along with the additional buffers of CONF_WITH_BDOS_CACHE, which this
+ * requires; BDOS_NAMECACHE_PER_BUF is the number of entries per buffer.
+ */
+#ifndef CONF_WITH_BDOS_NAMECACHE
+# define CONF_WITH_BDOS_NAMECACHE CONF_WITH_BDOS_CACHE
+#endif
+#ifndef BDOS_NAMECACHE_PER_BUF
+# define BDOS_NAMECACHE_PER_BUF 4
+#endif
+
+/*
+ * Set CONF_WITH_FSNEXTN to 1 to provide the EmuTOS-specific Fsnextn()
+ * GEMDOS call (0x58), which returns many directory entries per call.
+ * The desktop and the file selector use it to read large directories.
+ */
+#ifndef CONF_WITH_FSNEXTN
+# define CONF_WITH_FSNEXTN 1
+#endif
+
+/*
+ * Set CONF_WITH_FPREALLOC to 1 to provide the EmuTOS-specific Fprealloc()
+ * GEMDOS call (0x59), which reserves a contiguous run of clusters for a
+ * file that is about to be written.  This requires CONF_WITH_BDOS_FREEMAP.
+ */
+#ifndef CONF_WITH_FPREALLOC
+# define CONF_WITH_FPREALLOC CONF_WITH_BDOS_FREEMAP
+#endif
+
+/*
+ * Set CONF_WITH_OSMEM_SLABS to 1 to grow the internal OS memory pool
+ * (used for MDs, DNDs, OFDs and DMDs) on demand, by slabs of
+ * OSMEM_SLAB_BLOCKS 64-byte blocks allocated from ST-RAM or Alt-RAM.
+ * The pool is grown at the start of a GEMDOS call when fewer than
+ * OSMEM_RESERVE_BLOCKS blocks remain.  This also provides the
+ * EmuTOS-specific Sosmem() GEMDOS call (0x5A) to report pool usage.
+ */
+#ifndef CONF_WITH_OSMEM_SLABS
+# define CONF_WITH_OSMEM_SLABS 1
+#endif
+#ifndef OSMEM_SLAB_BLOCKS
+# define OSMEM_SLAB_BLOCKS 32
+#endif
+#ifndef OSMEM_RESERVE_BLOCKS
+# define OSMEM_RESERVE_BLOCKS 4
+#endif
+
+/*
+ * Set CONF_WITH_SFT_GROW to 1 to allow more than 75 files to be open at
+ * the same time.  When all the entries of the GEMDOS system file table are
+ * in use, it is extended by 64-byte blocks from the internal OS memory
+ * pool, up to SFT_MAX_FILES entries.  Open files are also hashed by
+ * directory entry, so that opening or closing a file does not need to
+ * search the other open files.  Note that a standard handle cannot be
+ * redirected by Fforce() to a handle above 127.
+ */
+#ifndef CONF_WITH_SFT_GROW
+# define CONF_WITH_SFT_GROW CONF_WITH_OSMEM_SLABS
+#endif
+#ifndef SFT_MAX_FILES
+# define SFT_MAX_FILES 250
+#endif
+
+/*
+ * Set CONF_WITH_DND_LRU to 1 to keep the directory nodes (DNDs) of
+ * recently visited folders cached, instead of recycling a sibling node
+ * whenever a new folder is found.  When more than DND_CACHE_MAX DNDs are
+ * in use, or the OS memory pool is exhausted, the least recently used
+ * half of the unreferenced DNDs is freed.  DNDs for current directories,
+ * for folders containing open files, and their parents, are never freed.
+ * This requires CONF_WITH_OSMEM_SLABS.
+ */
+#ifndef CONF_WITH_DND_LRU
+# define CONF_WITH_DND_LRU CONF_WITH_OSMEM_SLABS
+#endif
+#ifndef DND_CACHE_MAX
+# define DND_CACHE_MAX 64
+#endif
+
+/*
+ * Set CONF_WITH_MEMTREE to 1 to index the free and allocated lists of the
+ * GEMDOS memory pools by address, so that Malloc(), Mfree() and Mshrink()
+ * take logarithmic rather than linear time when there are many blocks.
+ * Allocation remains first-fit.  Each MD then needs 10 more bytes, so
+ * only 2 MDs fit in a 64-byte OS memory block instead of 3.
+ */
+#ifndef CONF_WITH_MEMTREE
+# define CONF_WITH_MEMTREE 1
+#endif
+
+/*
+ * Set CONF_WITH_MEMINFO to 1 to count the allocations and frees in each
+ * GEMDOS memory pool, and to provide the EmuTOS-specific Smeminfo()
+ * GEMDOS call (0x5B), which reports these counts together with the free
+ * space, the largest free block, the fragmentation of the pool, and the
+ * memory allocated to a given process.
+ */
+#ifndef CONF_WITH_MEMINFO
+# define CONF_WITH_MEMINFO 1
+#endif
+
+/*
+ * Set CONF_WITH_SHARED_ENV to 1 to let a program run by Pexec(0) with
+ * the environment of its parent use the parent's environment block,
+ * instead of a copy of it.  Shared blocks are freed when the last process
+ * using them terminates.  This saves time and memory when many programs
+ * are launched, but a program that modifies its environment in place
+ * then modifies the environment of its parent too, so it is not enabled
+ * by default.
+ */
+#ifndef CONF_WITH_SHARED_ENV
+# define CONF_WITH_SHARED_ENV 0
+#endif
+
+/*
+ * Set CONF_WITH_PGM_CACHE to 1 to keep the TEXT, DATA and relocation info
+ * of the last few programs loaded by Pexec() in Alt-RAM, so that running
+ * an unchanged program again does not need to read the file.  Programs
+ * larger than PGM_CACHE_MAXLEN bytes are never cached, and no more than
+ * half of the largest free Alt-RAM block is used for a new entry.
+ */
+#ifndef CONF_WITH_PGM_CACHE
+# define CONF_WITH_PGM_CACHE 0
+#endif
+#ifndef PGM_CACHE_MAXLEN
+# define PGM_CACHE_MAXLEN (256*1024L)
+#endif
+
+/*
+ * Set CONF_WITH_SHARED_TEXT to 1 to let programs with the PF_SHTEXT
+ * program flag run from a single copy of their TEXT segment, kept in the
+ * program cache: only DATA and BSS are allocated for each instance
+ */
+#ifndef CONF_WITH_SHARED_TEXT
+# define CONF_WITH_SHARED_TEXT CONF_WITH_PGM_CACHE
+#endif
+
 
 
 /****************************************************
@@ -1612,6 +2360,391 @@
 # define CONF_WITH_VDI_VERTLINE 1
 #endif
 
+/*
+ * Set CONF_WITH_VDI_BATCH to 1 to support the EmuTOS-specific VDI escape
+ * that executes a list of VDI calls with a single trap
+ */
+#ifndef CONF_WITH_VDI_BATCH
+# define CONF_WITH_VDI_BATCH 1
+#endif
+
+/*
+ * Set CONF_WITH_BOOT_PROFILE to 1 to record the time at the end of each
+ * boot phase (BIOS, BDOS, AES and desktop initialisation).  The results
+ * are output via kprintf(), and are available via the ETBP cookie, which
+ * points to a BOOT_PROFILE structure (see bios/bootprof.h).
+ */
+#ifndef CONF_WITH_BOOT_PROFILE
+# define CONF_WITH_BOOT_PROFILE 0
+#endif
+
+/*
+ * Set CONF_WITH_IRQ_TRACE to 1 to time the windows during which set_sr()
+ * or the AES masks the MFP interrupts, and keep the longest ones with
+ * the addresses of the code which masked and unmasked them.  This is a
+ * debugging aid which slows down the system.  The results are output via
+ * kprintf() at the end of the boot, and are available via the ETIL
+ * cookie, which points to an IRQ_TRACE structure (see bios/irqtrace.h).
+ */
+#ifndef CONF_WITH_IRQ_TRACE
+# define CONF_WITH_IRQ_TRACE 0
+#endif
+
+/*
+ * Set CONF_WITH_WARM_CACHE to 1 to save the results of the slow parts of
+ * the hardware detection (delay loop calibration, IDE interface checks)
+ * in the system variables, and reuse them on a warm reset instead of
+ * detecting again.  This speeds up resets of machines which are reset
+ * often.  Everything is detected again on a cold boot.
+ */
+#ifndef CONF_WITH_WARM_CACHE
+# define CONF_WITH_WARM_CACHE 0
+#endif
+
+/*
+ * Set CONF_WITH_CACHECTL to 1 to support the EmuTOS-specific XBIOS call
+ * Cachectl() (0x8f), which pushes or invalidates the caches for a zone
+ * of memory and, if a 68040 PMMU tree is installed, sets the cache mode
+ * (write-through, copyback or inhibited) of a region of RAM.
+ */
+#ifndef CONF_WITH_CACHECTL
+# define CONF_WITH_CACHECTL 0
+#endif
+
+/*
+ * Set CONF_WITH_PROCTIME to 1 to count the time (in 200 Hz ticks) during
+ * which each GEMDOS process and each AES process runs, and to provide
+ * the EmuTOS-specific GEMDOS call Sproctime() (0x5C) which reports it.
+ * EmuCON then has a PS command to display these times.
+ */
+#ifndef CONF_WITH_PROCTIME
+# define CONF_WITH_PROCTIME 0
+#endif
+
+/*
+ * Set CONF_WITH_BDOS_PROFILE to 1 to count the calls to each GEMDOS
+ * function and the time spent in them, to keep latency histograms for
+ * the file functions, and to count the BDOS buffer cache hits and misses.
+ * The EmuTOS-specific GEMDOS call Sdosprof() (0x5F) reports them, and
+ * EmuCON has a DOSPROF command to display them.
+ */
+#ifndef CONF_WITH_BDOS_PROFILE
+# define CONF_WITH_BDOS_PROFILE 0
+#endif
+
+/*
+ * Set CONF_WITH_AMIGA_PLANAR to 1 to support the ST Low and ST Medium
+ * colour modes on the Amiga.  The VDI keeps drawing into an Atari-style
+ * interleaved screen, and the VBL uses the blitter to convert the lines
+ * which have changed into separate bitplanes in Chip RAM, for display.
+ * This costs 32000 additional bytes of Chip RAM.
+ */
+#ifndef CONF_WITH_AMIGA_PLANAR
+# define CONF_WITH_AMIGA_PLANAR 0
+#endif
+
+/*
+ * Set CONF_WITH_SOUND_STREAM to 1 to support the EmuTOS-specific XBIOS
+ * call Sndstream() (0x8e), which plays a ring of DMA sound buffers and
+ * calls a refill routine from the end-of-frame interrupt (MFP timer A)
+ */
+#ifndef CONF_WITH_SOUND_STREAM
+# define CONF_WITH_SOUND_STREAM 0
+#endif
+
+/*
+ * Set CONF_WITH_SCREEN_FLIP to 1 to support the EmuTOS-specific XBIOS
+ * call Vflip() (0x90), which queues physical screen addresses to be
+ * displayed on the following VBLs, and reports (through a counter or a
+ * callback) when each of them has been displayed.
+ */
+#ifndef CONF_WITH_SCREEN_FLIP
+# define CONF_WITH_SCREEN_FLIP 0
+#endif
+
+/*
+ * Set CONF_WITH_FLOPTRKS to 1 to support the EmuTOS-specific XBIOS call
+ * Floptrks() (0x91), which reads or writes a range of whole floppy tracks
+ * in one operation.  EmuDesk then copies a whole diskette when the icon
+ * of one floppy drive is dropped onto the other with Alternate held down.
+ */
+#ifndef CONF_WITH_FLOPTRKS
+# define CONF_WITH_FLOPTRKS 0
+#endif
+
+/*
+ * Set CONF_WITH_HARDCOPY to 1 to support screen dumps to an Epson-compatible
+ * printer (Alt-Help or Scrdmp()).  The dump is rendered a few columns per
+ * VBL into a queue which is sent by the parallel port BUSY interrupt, so
+ * Alt-Help dumps run in the background.
+ */
+#ifndef CONF_WITH_HARDCOPY
+# define CONF_WITH_HARDCOPY 0
+#endif
+
+/*
+ * Set CONF_WITH_PRINTER_SPOOL to 1 to buffer the output to the parallel
+ * port (Bconout(0,...), and Fwrite() to PRN:) in a queue which is sent
+ * by the BUSY interrupt, so that printing runs alongside normal work.
+ * Bcostat(0) then reports the space left in the queue.
+ */
+#ifndef CONF_WITH_PRINTER_SPOOL
+# define CONF_WITH_PRINTER_SPOOL 0
+#endif
+
+/*
+ * CONF_WITH_PRINTER_QUEUE is set automatically when the interrupt-driven
+ * parallel port output queue is needed by one of the above features.
+ */
+#ifndef CONF_WITH_PRINTER_QUEUE
+# define CONF_WITH_PRINTER_QUEUE (CONF_WITH_HARDCOPY || CONF_WITH_PRINTER_SPOOL)
+#endif
+
+/*
+ * Set CONF_WITH_CLOCK_CACHE to 1 to make Gettime() return the software
+ * clock maintained by GEMDOS, rather than reading the clock hardware on
+ * every call (which may take milliseconds with the IKBD clock).  The
+ * software clock is resynchronised from the hardware every
+ * CLOCK_RESYNC_SECONDS seconds.
+ */
+#ifndef CONF_WITH_CLOCK_CACHE
+# define CONF_WITH_CLOCK_CACHE 0
+#endif
+#ifndef CLOCK_RESYNC_SECONDS
+# define CLOCK_RESYNC_SECONDS 60
+#endif
+
+/*
+ * Set CONF_WITH_HIRES_CLOCK to 1 to support the EmuTOS-specific XBIOS
+ * call Hrclock() (0x2d), which returns a microsecond clock.  This is
+ * derived from the 200 Hz tick count and the current value of the timer
+ * C counter (or of a slice timer on ColdFire), without extra interrupts.
+ */
+#ifndef CONF_WITH_HIRES_CLOCK
+# define CONF_WITH_HIRES_CLOCK 0
+#endif
+
+/*
+ * Set CONF_WITH_PATH_CACHE to 1 to remember the full names found by
+ * recent searches of the AES path (shel_find() & rsrc_load()) and of the
+ * EmuCON PATH, and reuse them if no directory has been changed since.
+ * EmuCON also reuses the names read for tab completion in the same way.
+ * Like the file selector cache below, this is never used for removable
+ * drives.
+ */
+#ifndef CONF_WITH_PATH_CACHE
+# define CONF_WITH_PATH_CACHE 0
+#endif
+
+/*
+ * Set CONF_WITH_AES_FSEL_CACHE to 1 to make the file selector keep the
+ * sorted listing of the last directory displayed, and reuse it if no
+ * directory has been changed since.  This is only reliable when EmuTOS's
+ * own GEMDOS handles the drive, and is never used for removable drives.
+ */
+#ifndef CONF_WITH_AES_FSEL_CACHE
+# define CONF_WITH_AES_FSEL_CACHE 0
+#endif
+
+/*
+ * Set CONF_WITH_AES_MENU_CACHE to 1 to keep an image of the last drop-down
+ * menu drawn, and redisplay it by a single blit if the menu has not changed.
+ * This uses a second buffer the size of the menu/alert buffer.
+ */
+#ifndef CONF_WITH_AES_MENU_CACHE
+# define CONF_WITH_AES_MENU_CACHE 0
+#endif
+
+/*
+ * Set CONF_WITH_AES_PARTIAL_MOVE to 1 to move the top window by BLTing
+ * it even if part of it is off the screen, redrawing only the parts
+ * that become visible
+ */
+#ifndef CONF_WITH_AES_PARTIAL_MOVE
+# define CONF_WITH_AES_PARTIAL_MOVE 1
+#endif
+
+/*
+ * Set CONF_WITH_AES_FOREGROUND_BOOST to 1 to give the AES process that
+ * owns the mouse priority over background processes (e.g. desk
+ * accessories) when it becomes ready to run
+ */
+#ifndef CONF_WITH_AES_FOREGROUND_BOOST
+# define CONF_WITH_AES_FOREGROUND_BOOST 1
+#endif
+
+/*
+ * Set CONF_WITH_AES_PREEMPTION to 1 to switch out an AES process that
+ * computes for too long without calling the AES, on a system timer tick
+ * that interrupts it in user mode.  The process that owns the mouse gets
+ * a longer time slice than the others.  This needs the Timer C handler
+ * to be called directly by the hardware (e.g. via the MFP): elsewhere,
+ * the process is never preempted.
+ * Programs that use line-A directly may misbehave, since another process
+ * may then call the VDI between two of their line-A calls.
+ */
+#ifndef CONF_WITH_AES_PREEMPTION
+# define CONF_WITH_AES_PREEMPTION 0
+#endif
+
+/*
+ * Set CONF_WITH_VDI_FONT_INDEX to 1 to keep an index of the available
+ * font faces, so that vst_font() & friends need not walk the font chains,
+ * and a width table for the current proportional font, used by
+ * vqt_extent() & friends for long strings
+ */
+#ifndef CONF_WITH_VDI_FONT_INDEX
+# define CONF_WITH_VDI_FONT_INDEX 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_PROFILE to 1 to count the calls to each VDI function,
+ * and the time spent in them, both per function and per workstation.
+ * The counters can be read via an EmuTOS-specific VDI escape.
+ */
+#ifndef CONF_WITH_VDI_PROFILE
+# define CONF_WITH_VDI_PROFILE 0
+#endif
+
+/*
+ * Set CONF_WITH_VDI_SETCOLORS to 1 to support the EmuTOS-specific VDI
+ * escape that sets a range of pens with a single call.  On a Falcon, the
+ * hardware palette is then updated all at once by the next VBL.
+ */
+#ifndef CONF_WITH_VDI_SETCOLORS
+# define CONF_WITH_VDI_SETCOLORS 0
+#endif
+
+/*
+ * Set CONF_WITH_LINEA_RECTS to 1 to support the EmuTOS-specific line-A
+ * function $10, which draws a list of filled rectangles (or horizontal
+ * lines) with the same attributes in a single call
+ */
+#ifndef CONF_WITH_LINEA_RECTS
+# define CONF_WITH_LINEA_RECTS 1
+#endif
+
+/*
+ * Set CONF_WITH_LAZY_LINEA_SYNC to 1 to stop the VDI from copying the
+ * current workstation's font, writing mode and clipping to the line-A
+ * variables after every call, until the first line-A opcode is executed.
+ * A program must call line-A $A000 to find these variables, so this is
+ * invisible to programs; from then on, the copy is done as usual.
+ */
+#ifndef CONF_WITH_LAZY_LINEA_SYNC
+# define CONF_WITH_LAZY_LINEA_SYNC 1
+#endif
+
+/*
+ * Set CONF_WITH_AES_SUBTREE_CLIP to 1 to speed up AES object drawing, by
+ * not visiting the children of an object that lies entirely outside the
+ * clipping rectangle.  This relies on children lying within their parent,
+ * as objc_find() already does.
+ */
+#ifndef CONF_WITH_AES_SUBTREE_CLIP
+# define CONF_WITH_AES_SUBTREE_CLIP 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_ELLIPSE_RASTER to 1 to improve the performance of
+ * VDI circles, ellipses, arcs and pie slices, by drawing them directly
+ * as horizontal spans rather than as polygons or polylines
+ */
+#ifndef CONF_WITH_VDI_ELLIPSE_RASTER
+# define CONF_WITH_VDI_ELLIPSE_RASTER 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_16BIT to 1 to support drawing in the Falcon 16-bit
+ * (truecolour) video mode, where each pixel is a word rather than being
+ * spread across bitplanes.  Filled areas, horizontal lines, raster copies
+ * and simple text output are supported.
+ */
+#ifndef CONF_WITH_VDI_16BIT
+# define CONF_WITH_VDI_16BIT CONF_WITH_VIDEL
+#endif
+
+/*
+ * Set CONF_WITH_MOUSE_EXCLUSION to 1 to allow the AES to draw objects
+ * without removing the mouse cursor from the screen, unless the cursor
+ * is (or moves) within the area being drawn
+ */
+#ifndef CONF_WITH_MOUSE_EXCLUSION
+# define CONF_WITH_MOUSE_EXCLUSION 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_BITMAP to 1 to support off-screen bitmap workstations,
+ * opened via v_open_bm() as in NVDI.  All VDI drawing functions can then
+ * be used to draw into memory rather than onto the screen.
+ */
+#ifndef CONF_WITH_VDI_BITMAP
+# define CONF_WITH_VDI_BITMAP 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_SPAN_MERGE to 1 to speed up the drawing of wide
+ * lines, by merging the overlapping horizontal spans of adjacent line
+ * segments and their joins before drawing them
+ */
+#ifndef CONF_WITH_VDI_SPAN_MERGE
+# define CONF_WITH_VDI_SPAN_MERGE 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_LINE_FILL to 1 to speed up replace mode fills that
+ * cover whole scan lines (such as the desktop background), by filling
+ * them as contiguous memory rather than a plane at a time
+ */
+#ifndef CONF_WITH_VDI_LINE_FILL
+# define CONF_WITH_VDI_LINE_FILL 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_FILL_EXPAND to 1 to keep, for each workstation, the
+ * fill pattern expanded in the fill colour for each plane, so that
+ * replace mode fills just store the pattern words
+ */
+#ifndef CONF_WITH_VDI_FILL_EXPAND
+# define CONF_WITH_VDI_FILL_EXPAND 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_SCRNINFO to 1 to support the NVDI vq_scrninfo()
+ * call, which describes the layout of the screen bitmap, and an
+ * EmuTOS-specific escape that makes the screen safe for direct drawing
+ * by applications (and reports the end of it)
+ */
+#ifndef CONF_WITH_VDI_SCRNINFO
+# define CONF_WITH_VDI_SCRNINFO 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_MARKER_STAMPS to 1 to speed up v_pmarker(), by
+ * drawing the markers as pre-rasterised bitmaps rather than polylines
+ * in replace and transparent modes
+ */
+#ifndef CONF_WITH_VDI_MARKER_STAMPS
+# define CONF_WITH_VDI_MARKER_STAMPS 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_GLYPH_CACHE to 1 to improve the performance of
+ * scaled, rotated, outlined and skewed text output, at the cost of
+ * some RAM, by caching the characters after applying the effects
+ */
+#ifndef CONF_WITH_VDI_GLYPH_CACHE
+# define CONF_WITH_VDI_GLYPH_CACHE 1
+#endif
+
+/*
+ * Set CONF_WITH_VDI_EDGE_TABLE to 1 to improve VDI polygon fill
+ * performance, at the cost of some RAM, by using an active edge table
+ */
+#ifndef CONF_WITH_VDI_EDGE_TABLE
+# define CONF_WITH_VDI_EDGE_TABLE 1
+#endif
+
 /*
  * The VDI functions v_fillarea(), v_pline(), v_pmarker() can handle
  * up to MAX_VERTICES coordinates (MAX_VERTICES/2 points).
@@ -1650,6 +2783,18 @@
 # define CONF_WITH_XHDI 1
 #endif
 
+/*
+ * Set CONF_WITH_DISK_CACHE to 1 to keep a few recently read physical
+ * sectors of hard disk units in memory.  This avoids reading the root
+ * sector and partition tables several times while scanning for partitions
+ * and building the BPBs.  The cache is only used during that scan, at
+ * boot time and when a removable unit is rescanned, and is emptied
+ * afterwards.
+ */
+#ifndef CONF_WITH_DISK_CACHE
+# define CONF_WITH_DISK_CACHE 1
+#endif
+
 
 
 /************************************************************
@@ -1741,6 +2886,24 @@
 # define CONF_WITH_DESKTOP_SHORTCUTS 1
 #endif
 
+/*
+ * Set CONF_WITH_ANODE_INDEX to 1 to index the installed applications &
+ * icons by file extension, so that the desktop finds the ANODE for a
+ * file without matching every ANODE against its name
+ */
+#ifndef CONF_WITH_ANODE_INDEX
+# define CONF_WITH_ANODE_INDEX 1
+#endif
+
+/*
+ * Set CONF_WITH_TEXT_ROW_CACHE to 1 to keep the formatted text of the
+ * most recently drawn rows of "show as text" windows, so that redrawing
+ * them (e.g. when scrolling) does not format them again
+ */
+#ifndef CONF_WITH_TEXT_ROW_CACHE
+# define CONF_WITH_TEXT_ROW_CACHE 1
+#endif
+
 /*
  * Set CONF_WITH_EASTER_EGG to 1 to include the EmuDesk Easter Egg
  * (this plays a small tune and therefore requires YM2149 support)
@@ -1882,6 +3045,17 @@
 # endif
 #endif
 
+/*
+ * Set CONF_FIXED_HARDWARE to 1 for ROMs which only run on one kind of
+ * machine: the HAS_* macros for the hardware that this machine always
+ * or never has then become constants (see include/has.h), so the code
+ * for the other cases is removed.  This is the default for the ARAnyM
+ * and FireBee targets, and is set by the Makefile for Vampire ROMs.
+ */
+#ifndef CONF_FIXED_HARDWARE
+# define CONF_FIXED_HARDWARE 0
+#endif
+
 
 
 /********************************
@@ -2022,6 +3196,10 @@
 # endif
 #endif
 
+#if (IKBD_IOREC_SIZE % 4) != 0
+# error IKBD_IOREC_SIZE must be a multiple of 4.
+#endif
+
 #if !CONF_WITH_ADVANCED_CPU
 # if CONF_WITH_68030_PMMU
 #  error CONF_WITH_68030_PMMU requires CONF_WITH_ADVANCED_CPU.
@@ -2040,6 +3218,15 @@
 # endif
 #endif
 
+#if CONF_WITH_ROM_SHADOW
+# if !CONF_WITH_TTRAM
+#  error CONF_WITH_ROM_SHADOW requires CONF_WITH_TTRAM.
+# endif
+# if !(CONF_WITH_68030_PMMU || CONF_WITH_68040_PMMU)
+#  error CONF_WITH_ROM_SHADOW requires CONF_WITH_68030_PMMU or CONF_WITH_68040_PMMU.
+# endif
+#endif
+
 #if !CONF_WITH_ALT_RAM
 # if CONF_WITH_STATIC_ALT_RAM
 #  error CONF_WITH_STATIC_ALT_RAM requires CONF_WITH_ALT_RAM.
@@ -2047,6 +3234,24 @@
 # if CONF_WITH_TTRAM
 #  error CONF_WITH_TTRAM requires CONF_WITH_ALT_RAM.
 # endif
+# if CONF_WITH_PGM_CACHE
+#  error CONF_WITH_PGM_CACHE requires CONF_WITH_ALT_RAM.
+# endif
+# if CONF_WITH_SHARED_TEXT
+#  error CONF_WITH_SHARED_TEXT requires CONF_WITH_ALT_RAM.
+# endif
+#endif
+
+#if !CONF_WITH_TTRAM
+# if CONF_WITH_RAMDISK
+#  error CONF_WITH_RAMDISK requires CONF_WITH_TTRAM.
+# endif
+#endif
+
+#if !CONF_WITH_PGM_CACHE
+# if CONF_WITH_SHARED_TEXT
+#  error CONF_WITH_SHARED_TEXT requires CONF_WITH_PGM_CACHE.
+# endif
 #endif
 
 #ifndef STATIC_ALT_RAM_ADDRESS
@@ -2097,6 +3302,21 @@
 # endif
 #endif
 
+#if !CONF_WITH_VIDEL
+# if CONF_WITH_VDI_16BIT
+#  error CONF_WITH_VDI_16BIT requires CONF_WITH_VIDEL.
+# endif
+#endif
+
+#if !CONF_WITH_PRINTER_PORT
+# if CONF_WITH_HARDCOPY
+#  error CONF_WITH_HARDCOPY requires CONF_WITH_PRINTER_PORT.
+# endif
+# if CONF_WITH_PRINTER_SPOOL
+#  error CONF_WITH_PRINTER_SPOOL requires CONF_WITH_PRINTER_PORT.
+# endif
+#endif
+
 #if !CONF_SERIAL_CONSOLE
 # if CONF_SERIAL_CONSOLE_ANSI
 #  error CONF_SERIAL_CONSOLE_ANSI requires CONF_SERIAL_CONSOLE.
@@ -2109,6 +3329,12 @@
 # endif
 #endif
 
+#if !CONF_WITH_SCSI
+# if CONF_WITH_SCSI_DISCONNECT
+#  error CONF_WITH_SCSI_DISCONNECT requires CONF_WITH_SCSI.
+# endif
+#endif
+
 #if !CONF_WITH_ACSI
 # if CONF_WITH_ICDRTC
 #  error CONF_WITH_ICDRTC requires CONF_WITH_ACSI.
@@ -2116,6 +3342,9 @@
 # if CONF_WITH_ULTRASATAN_CLOCK
 #  error CONF_WITH_ULTRASATAN_CLOCK requires CONF_WITH_ACSI.
 # endif
+# if CONF_WITH_ACSI_OVERLAP
+#  error CONF_WITH_ACSI_OVERLAP requires CONF_WITH_ACSI.
+# endif
 #endif
 
 #if !CONF_WITH_DMASOUND
@@ -2124,7 +3353,55 @@
 # endif
 #endif
 
+#if !CONF_WITH_BDOS_CACHE
+# if CONF_WITH_BDOS_WRITEBACK
+#  error CONF_WITH_BDOS_WRITEBACK requires CONF_WITH_BDOS_CACHE.
+# endif
+# if CONF_WITH_BDOS_READAHEAD
+#  error CONF_WITH_BDOS_READAHEAD requires CONF_WITH_BDOS_CACHE.
+# endif
+# if CONF_WITH_BDOS_NAMECACHE
+#  error CONF_WITH_BDOS_NAMECACHE requires CONF_WITH_BDOS_CACHE.
+# endif
+#endif
+
+#if !CONF_WITH_BDOS_READAHEAD
+# if CONF_WITH_DREADAHEAD
+#  error CONF_WITH_DREADAHEAD requires CONF_WITH_BDOS_READAHEAD.
+# endif
+#endif
+
+#if !CONF_WITH_BDOS_WRITEBACK
+# if CONF_WITH_FATMIRROR_DEFER
+#  error CONF_WITH_FATMIRROR_DEFER requires CONF_WITH_BDOS_WRITEBACK.
+# endif
+# if CONF_WITH_DSYNC
+#  error CONF_WITH_DSYNC requires CONF_WITH_BDOS_WRITEBACK.
+# endif
+#endif
+
+#if !CONF_WITH_BDOS_FREEMAP
+# if CONF_WITH_FPREALLOC
+#  error CONF_WITH_FPREALLOC requires CONF_WITH_BDOS_FREEMAP.
+# endif
+#endif
+
+#if !CONF_WITH_OSMEM_SLABS
+# if CONF_WITH_DND_LRU
+#  error CONF_WITH_DND_LRU requires CONF_WITH_OSMEM_SLABS.
+# endif
+#endif
+
+#if CONF_WITH_SFT_GROW
+# if SFT_MAX_FILES > 32000
+#  error SFT_MAX_FILES must fit in a GEMDOS file handle.
+# endif
+#endif
+
 #if !CONF_WITH_FDC
+# if CONF_WITH_FLOPPY_CACHE
+#  error CONF_WITH_FLOPPY_CACHE requires CONF_WITH_FDC.
+# endif
 # if CONF_WITH_FORMAT
 #  error CONF_WITH_FORMAT requires CONF_WITH_FDC.
 # endif
@@ -2152,6 +3429,21 @@
 # endif
 #endif
 
+#if CONF_WITH_SOUND_STREAM
+# if !CONF_WITH_DMASOUND || !CONF_WITH_MFP
+#  error CONF_WITH_SOUND_STREAM requires CONF_WITH_DMASOUND and CONF_WITH_MFP.
+# endif
+#endif
+
+#if CONF_WITH_MIDI_QUEUES
+# if !CONF_WITH_MIDI_ACIA
+#  error CONF_WITH_MIDI_QUEUES requires CONF_WITH_MIDI_ACIA.
+# endif
+# if MIDI_DEBUG_PRINT
+#  error CONF_WITH_MIDI_QUEUES cannot be used with MIDI_DEBUG_PRINT.
+# endif
+#endif
+
 #if (CONSOLE_DEBUG_PRINT + RS232_DEBUG_PRINT + SCC_DEBUG_PRINT + COLDFIRE_DEBUG_PRINT + MIDI_DEBUG_PRINT) > 1
 # error Only one of CONSOLE_DEBUG_PRINT, RS232_DEBUG_PRINT, SCC_DEBUG_PRINT, COLDFIRE_DEBUG_PRINT or MIDI_DEBUG_PRINT must be set to 1.
 #endif
@@ -2174,6 +3466,9 @@
 # if CONF_WITH_UAE
 #  error CONF_WITH_UAE requires MACHINE_AMIGA.
 # endif
+# if CONF_WITH_AMIGA_PLANAR
+#  error CONF_WITH_AMIGA_PLANAR requires MACHINE_AMIGA.
+# endif
 #endif
 
 #ifndef MACHINE_ARANYM
@@ -42,6 +42,8 @@ struct cookie {
 #define COOKIE__5MS     0x5f354d53L
 #define COOKIE_NVDI     0x4e564449L
 #define COOKIE_SCSIDRIV 0x53435349L
+#define COOKIE_ETBP     0x45544250L
+#define COOKIE_ETIL     0x4554494cL
 
 /*
  * values of _MCH cookie
@@ -12,13 +12,22 @@
 
 #include "bdosbind.h"
 
-WORD pgmld(WORD handle, char *pname, LONG **ldaddr);
+WORD pgmld(char *pname, LONG **ldaddr);
 LONG dos_exec(WORD mode, const char *pcspec, const char *pcmdln, const char *segenv); /* see: gemstart.S */
 WORD dos_setdt(UWORD h, UWORD time, UWORD date);
 WORD dos_label(char drive, char *plabel);
 void dos_space(WORD drv, LONG *ptotal, LONG *pavail);
 LONG dos_load_file(char *filename, LONG count, char *buf);
 
+#if CONF_WITH_AES_FSEL_CACHE || CONF_WITH_PATH_CACHE
+extern ULONG dirchgcnt;     /* BDOS directory change counter */
+#endif
+
+#if CONF_WITH_PROCTIME
+/* BDOS hook for Sproctime(PT_AES) */
+extern LONG (*aes_proctime)(WORD index, PROCTIME *info);
+#endif
+
 void *dos_alloc_stram(LONG nbytes);
 void *dos_alloc_anyram(LONG nbytes);
 LONG dos_avail_stram(void);
@@ -67,6 +76,14 @@ static __inline__ WORD dos_snext(void)
     return Fsnext();
 }
 
+#if CONF_WITH_FSNEXTN
+WORD dos_bsfirst(char *pspec, WORD attr);
+WORD dos_bsnext(void);
+#else
+#define dos_bsfirst(pspec,attr) dos_sfirst(pspec,attr)
+#define dos_bsnext() dos_snext()
+#endif
+
 static __inline__ LONG dos_open(char *pname, WORD access)
 {
     return Fopen(pname,access);
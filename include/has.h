@@ -10,15 +10,45 @@
 #ifndef HAS_H
 #define HAS_H
 
+/*
+ * with CONF_FIXED_HARDWARE, the following macros are constants for the
+ * hardware that the target machine always or never has, so the tests
+ * fold away.  the detection still sets the variables.
+ */
+#if CONF_FIXED_HARDWARE
+# if defined(MACHINE_ARANYM)
+  #define FIXED_IS_ARANYM 1
+  #define FIXED_HAS_NATFEATS 1
+  #define FIXED_HAS_VIDEL 1
+  #define FIXED_HAS_NVRAM 1
+  #define FIXED_HAS_MICROWIRE 0
+# elif defined(MACHINE_FIREBEE)
+  #define FIXED_HAS_VIDEL 1
+  #define FIXED_HAS_VME 0
+  #define FIXED_HAS_NVRAM 1
+  #define FIXED_HAS_MICROWIRE 0
+# elif defined(MACHINE_AMIGA) && CONF_WITH_VAMPIRE_SPI
+  #define FIXED_IS_APOLLO_68080 1   /* all Vampire boards */
+# endif
+#endif
+
 #if CONF_WITH_ARANYM
 extern int is_aranym;
+# ifdef FIXED_IS_ARANYM
+  #define IS_ARANYM FIXED_IS_ARANYM
+# else
   #define IS_ARANYM is_aranym
+# endif
 #else
   #define IS_ARANYM 0
 #endif
 
 #if DETECT_NATIVE_FEATURES
+# ifdef FIXED_HAS_NATFEATS
+  #define HAS_NATFEATS FIXED_HAS_NATFEATS
+# else
   #define HAS_NATFEATS has_natfeats()   /* declared in natfeat.h */
+# endif
 #else
   #define HAS_NATFEATS 0
 #endif
@@ -39,7 +69,11 @@ extern int has_tt_shifter;
 
 #if CONF_WITH_VIDEL
 extern int has_videl;
+# ifdef FIXED_HAS_VIDEL
+  #define HAS_VIDEL FIXED_HAS_VIDEL
+# else
   #define HAS_VIDEL has_videl
+# endif
 #else
   #define HAS_VIDEL 0
 #endif
@@ -64,7 +98,11 @@ extern int has_scc;
 
 #if CONF_WITH_VME
 extern int has_vme;
+# ifdef FIXED_HAS_VME
+  #define HAS_VME FIXED_HAS_VME
+# else
   #define HAS_VME has_vme
+# endif
 #else
   #define HAS_VME 0
 #endif
@@ -105,7 +143,11 @@ extern int ultrasatan_id; /* in disk.c */
 
 #if CONF_WITH_NVRAM
 extern int has_nvram;     /* in nvram.c */
+# ifdef FIXED_HAS_NVRAM
+  #define HAS_NVRAM FIXED_HAS_NVRAM
+# else
   #define HAS_NVRAM has_nvram
+# endif
 #else
   #define HAS_NVRAM 0
 #endif
@@ -126,7 +168,11 @@ extern int has_dmasound;  /* in dmasound.c */
 extern int has_microwire; /* in dmasound.c */
 extern int has_falcon_dmasound; /* in dmasound.c */
   #define HAS_DMASOUND has_dmasound
+# ifdef FIXED_HAS_MICROWIRE
+  #define HAS_MICROWIRE FIXED_HAS_MICROWIRE
+# else
   #define HAS_MICROWIRE has_microwire
+# endif
   #define HAS_FALCON_DMASOUND has_falcon_dmasound
 #else
   #define HAS_DMASOUND 0
@@ -156,6 +202,17 @@ extern int has_alt_ram;
 extern int has_modectl;
 #endif
 
+#if CONF_WITH_APOLLO_68080
+extern BOOL is_apollo_68080;    /* in processor.S */
+# ifdef FIXED_IS_APOLLO_68080
+  #define IS_APOLLO_68080 FIXED_IS_APOLLO_68080
+# else
+  #define IS_APOLLO_68080 is_apollo_68080
+# endif
+#else
+  #define IS_APOLLO_68080 0
+#endif
+
 /* address bus width */
 #if defined(__mcoldfire__)
   #define IS_BUS32 1
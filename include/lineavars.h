@@ -34,7 +34,7 @@ typedef struct _mcs {
         WORD    len;            /* height of saved form */
         UWORD   *addr;          /* screen address of saved form */
         UBYTE    stat;          /* save status */
-        char    reserved;
+        char    width;          /* pixels saved per row (16-bit mode only) */
         ULONG   area[8*16];     /* handle up to 8 video planes */
 } MCS;
 /* defines for 'stat' above */
@@ -10,8 +10,21 @@
 #ifndef MISCUTIL_H
 #define MISCUTIL_H
 
+/*
+ * an item to be sorted by sort_keys(): items are ordered by 'key' (as
+ * an unsigned value) and, for equal keys, by the caller's compare function
+ */
+typedef struct {
+    ULONG key;              /* precomputed primary sort key */
+    LONG item;              /* the item (pointer or index) being sorted */
+} SORTKEY;
+
+typedef WORD (*SORTCMP)(LONG item1, LONG item2);
+
 void build_root_path(char *path, char drive);
 WORD extract_drive_number(const char *path);
 void set_all_files(char *target);
+ULONG sort_strkey(const char *s);
+void sort_keys(SORTKEY *base, LONG count, SORTKEY *work, SORTCMP cmp);
 
 #endif
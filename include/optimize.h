@@ -18,6 +18,7 @@ void inf_sget(OBJECT *tree, WORD obj, char *pstr);
 WORD inf_gindex(OBJECT *tree, WORD baseobj, WORD numobj);
 WORD inf_what(OBJECT *tree, WORD ok);
 char *scan_2(char *pcurr, WORD *pwd);
+char *put_2(char *pcurr, WORD value);
 WORD wildcmp(const char *pwld, const char *ptst);
 
 #endif
@@ -61,6 +61,14 @@ void * memcpy(void * RESTRICT dst, const void * RESTRICT src,
 void * memmove(void * dst, const void * src,
                size_t length);
 
+#if CONF_WITH_ADVANCED_CPU && !defined(__mcoldfire__)
+/* moves length bytes from src to dst using move16 (68040/68060 only).
+ * dst, src and length must be multiples of 16; the regions may only
+ * overlap if dst is below src.
+ */
+void memcpy16(void * dst, const void * src, size_t length);
+#endif
+
 /* fills with byte c, returns the given address. */
 void * memset(void *address, int c, size_t size);
 
@@ -73,4 +73,12 @@
  */
 #define SIZE_SHELBUF    4192L           /* size of shell buffer - same as TOS 1.04-> */
 
+/*
+ * the following defines the number of bytes reserved for control panel
+ * use at the start of the shell buffer.  these bytes are not modified
+ * by EmuDesk, and are (currently) not saved to the EMUDESK.INF file.
+ * EmuDesk saves its EMUDESK.INF data in the shell buffer after them.
+ */
+#define CPDATA_LEN      128
+
 #endif  /* _SYSCONF_H */
@@ -20,6 +20,26 @@ typedef struct {
     WORD xright;                /* x coordinate of segment end */
 } SEGMENT;
 
+#if CONF_WITH_VDI_EDGE_TABLE
+/*
+ * polygon edge used by clc_flit()
+ *
+ * the intersection with the current scan line is maintained incrementally
+ * as floor(k*a/b), where k is the distance in scan lines from the endpoint
+ * at x = xo, and q & r are the quotient & remainder of that division
+ */
+typedef struct {
+    WORD ytop;                  /* first (highest) scan line crossed */
+    WORD ybot;                  /* last (lowest) scan line crossed */
+    WORD x;                     /* intersection with the current scan line */
+    WORD xo;                    /* x coordinate of the reference endpoint */
+    WORD q, r;                  /* current quotient & remainder */
+    WORD qstep, rstep;          /* quotient & remainder of a/b */
+    WORD b;                     /* divisor: height of edge */
+    WORD away;                  /* TRUE if k increases on each scan line */
+} FILLEDGE;
+#endif
+
 /*
  * queue size for contourfill()
  *
@@ -49,6 +69,9 @@ typedef union {
     struct vsmain {
         WORD local_ptsin[2*MAX_VERTICES];   /* used by GSX_ENTRY() - must be at offset 0 */
         WORD fill_buffer[MAX_VERTICES];     /* used by clc_flit() */
+#if CONF_WITH_VDI_EDGE_TABLE
+        FILLEDGE fill_edges[MAX_VERTICES];  /* used by clc_flit() */
+#endif
     } main;
     SEGMENT queue[QSIZE];       /* storage for contourfill() seed points  */
     WORD deftxbuf[SCRATCHBUF_SIZE/sizeof(WORD)];    /* text scratch buffer */
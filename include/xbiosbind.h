@@ -55,6 +55,7 @@
 #define Vsync() xbios_v_v(37)
 #define Supexec(a) xbios_l_l(38,a)
 #define Puntaes() xbios_v_v(39)
+#define Hrclock() xbios_l_v(45)     /* EmuTOS-specific */
 #define Blitmode(a) xbios_w_w(64, a)
 #define EgetShift() xbios_w_v(81)
 #define EsetColor(a,b) xbios_w_ww(83,a,b)
@@ -63,6 +64,7 @@
 #define VgetSize(a) xbios_l_w(91,a)
 #define VsetRGB(a,b,c) xbios_v_wwl(93,a,b,c)
 #define VgetRGB(a,b,c) xbios_v_wwl(94,a,b,c)
+#define Floptrks(a,b,c,d,e,f,g) xbios_w_lwwwwww(145,a,b,c,d,e,f,g)  /* EmuTOS-specific */
 
 #define FLOPFMT_MAGIC   0x87654321UL
 
@@ -320,6 +322,30 @@ static __inline__ short xbios_w_llwwwwwlw(int op,
     return retval;
 }
 
+static __inline__ short xbios_w_lwwwwww(int op,
+    long a, short b, short c, short d, short e, short f, short g)
+{
+    register long retval __asm__("d0");
+
+    __asm__ volatile (
+        "move.w  %8,-(sp)\n\t"
+        "move.w  %7,-(sp)\n\t"
+        "move.w  %6,-(sp)\n\t"
+        "move.w  %5,-(sp)\n\t"
+        "move.w  %4,-(sp)\n\t"
+        "move.w  %3,-(sp)\n\t"
+        "move.l  %2,-(sp)\n\t"
+        "move.w  %1,-(sp)\n\t"
+        "trap    #14\n\t"
+        "lea     18(sp),sp"
+         : "=r"(retval)
+         : "nr"(op), "ir"(a), "nr"(b), "nr"(c), "nr"(d), "nr"(e), "nr"(f),
+           "nr"(g)
+         : "d1", "d2", "a0", "a1", "a2", "memory", "cc"
+        );
+    return retval;
+}
+
 static __inline__ long xbios_l_v(int op)
 {
     register long retval __asm__("d0");
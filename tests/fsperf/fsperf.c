@@ -0,0 +1,237 @@
+/*
+ * fsperf.c - GEMDOS file system workload generator
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * This runs a fixed, pseudo-random sequence of operations in the
+ * current directory: it creates a wide folder of files of varied sizes,
+ * appends to them, seeks and reads at random positions, builds a deep
+ * folder tree, and deletes everything again.
+ *
+ * For each type of operation, a line
+ *
+ *   FSPERF <name> <ops> <bytes> <ms>
+ *
+ * is reported on screen, in FSPERF.TXT and, via NatFeats, on the
+ * emulator's stderr.  The program then shuts the emulator down.
+ *
+ * It must be run on a drive handled by EmuTOS itself (e.g. a disk
+ * image), not on a drive emulated at the GEMDOS level.
+ */
+
+#include <stdio.h>
+#include <osbind.h>
+#include "nat_feat.h"
+
+#define HZ_200      ((volatile unsigned long *)0x4ba)
+#define NFILES      100
+#define DEPTH       8
+#define MAXSIZE     4096
+#define APPENDSIZE  512
+#define READSIZE    512
+#define NREADS      400
+
+static FILE *fh;
+static char buf[MAXSIZE];
+static long filesize[NFILES];
+static long start_ticks;
+
+/* same generator as tools/memstres.c */
+static unsigned long qdrand(void)
+{
+    static unsigned long idum = 0;
+    idum = 1664525L*idum + 1013904223L;
+    return idum;
+}
+
+static long read_hz_200(void)
+{
+    return *HZ_200;
+}
+
+static void start(void)
+{
+    start_ticks = Supexec(read_hz_200);
+}
+
+static void report(const char *name, int ops, long bytes)
+{
+    char line[80];
+
+    sprintf(line, "FSPERF %s %d %ld %ld\n", name, ops, bytes,
+            (Supexec(read_hz_200) - start_ticks) * 5);
+    printf("%s", line);
+    if (fh)
+        fputs(line, fh);
+    nf_stderr(line);
+}
+
+static void filename(char *name, int n)
+{
+    sprintf(name, "WIDE\\F%05d.DAT", n);
+}
+
+static int create_files(void)
+{
+    char name[32];
+    long bytes = 0;
+    int i, fd;
+
+    if (Dcreate("WIDE") < 0)
+        return -1;
+
+    start();
+    for (i = 0; i < NFILES; i++)
+    {
+        filename(name, i);
+        fd = Fcreate(name, 0);
+        if (fd < 0)
+            return -1;
+        filesize[i] = (qdrand() >> 8) % MAXSIZE + 1;
+        if (Fwrite(fd, filesize[i], buf) != filesize[i])
+            return -1;
+        bytes += filesize[i];
+        Fclose(fd);
+    }
+    report("create", NFILES, bytes);
+
+    return 0;
+}
+
+static int append_files(void)
+{
+    char name[32];
+    int i, fd;
+
+    start();
+    for (i = 0; i < NFILES; i++)
+    {
+        filename(name, i);
+        fd = Fopen(name, 1);
+        if (fd < 0)
+            return -1;
+        Fseek(0L, fd, 2);
+        if (Fwrite(fd, APPENDSIZE, buf) != APPENDSIZE)
+            return -1;
+        filesize[i] += APPENDSIZE;
+        Fclose(fd);
+    }
+    report("append", NFILES, (long)NFILES * APPENDSIZE);
+
+    return 0;
+}
+
+static int seek_read(void)
+{
+    char name[32];
+    long bytes = 0, pos, n;
+    int i, f, fd;
+
+    start();
+    for (i = 0; i < NREADS; i++)
+    {
+        f = (qdrand() >> 8) % NFILES;
+        filename(name, f);
+        fd = Fopen(name, 0);
+        if (fd < 0)
+            return -1;
+        pos = (qdrand() >> 8) % filesize[f];
+        Fseek(pos, fd, 0);
+        n = Fread(fd, READSIZE, buf);
+        if (n < 0)
+            return -1;
+        bytes += n;
+        Fclose(fd);
+    }
+    report("seekread", NREADS, bytes);
+
+    return 0;
+}
+
+static int deep_tree(void)
+{
+    char path[DEPTH*4];
+    int i;
+
+    /* level i is "D00\D01\...\Dii", i.e. 3 + 4*i characters long */
+    start();
+    for (i = 0; i < DEPTH; i++)
+    {
+        sprintf(path + (i ? 3 + 4*(i-1) : 0), "%sD%02d", i ? "\\" : "", i);
+        if (Dcreate(path) < 0)
+            return -1;
+    }
+    report("mkdir", DEPTH, 0L);
+
+    Fsetdta((_DTA *)buf);
+    start();
+    for (i = 0; i < NFILES; i++)
+        Fsfirst(path, 0x10);
+    report("lookup", NFILES, 0L);
+
+    start();
+    for (i = DEPTH-1; i >= 0; i--)
+    {
+        path[3 + 4*i] = '\0';
+        if (Ddelete(path) < 0)
+            return -1;
+    }
+    report("rmdir", DEPTH, 0L);
+
+    return 0;
+}
+
+static int delete_files(void)
+{
+    char name[32];
+    int i;
+
+    start();
+    for (i = 0; i < NFILES; i++)
+    {
+        filename(name, i);
+        if (Fdelete(name) < 0)
+            return -1;
+    }
+    Ddelete("WIDE");
+    report("delete", NFILES, 0L);
+
+    return 0;
+}
+
+int main(void)
+{
+    int rc;
+
+    fh = fopen("FSPERF.TXT", "wb");
+
+    rc = create_files();
+    if (rc == 0)
+        rc = append_files();
+    if (rc == 0)
+        rc = seek_read();
+    if (rc == 0)
+        rc = deep_tree();
+    if (rc == 0)
+        rc = delete_files();
+
+    if (rc != 0)
+    {
+        printf("FSPERF failed\n");
+        if (fh)
+            fputs("FSPERF failed\n", fh);
+        nf_stderr("FSPERF failed\n");
+    }
+
+    if (fh)
+        fclose(fh);
+
+    Supexec(nf_shutdown);
+
+    return rc ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+#!/bin/sh
+# Copyright (C) 2026 The EmuTOS development team
+#
+# This file is distributed under the GPL, version 2 or at your
+# option any later version.  See doc/license.txt for details.
+
+echo "File system benchmark (with Hatari):"
+
+if ! command -v hatari >/dev/null 2>&1; then
+    echo "ERROR: You must install hatari to run this test."
+    exit 1
+fi
+
+if ! command -v mcopy >/dev/null 2>&1; then
+    echo "ERROR: You must install mtools to run this test."
+    exit 1
+fi
+
+if [ -z "$EMUTOS" ]; then
+    export EMUTOS=../../etos1024k.img
+fi
+
+export SDL_VIDEODRIVER=dummy
+export SDL_AUDIODRIVER=dummy
+
+disk=fsperf.st
+
+trap "rm -f $disk FSPERF.TXT" INT TERM HUP EXIT
+
+# the benchmark must run on a real FAT file system handled by EmuTOS,
+# so it is run from a floppy image rather than a GEMDOS-emulated drive
+run_hatari() {
+    rm -f FSPERF.TXT
+    dd if=/dev/zero of=$disk bs=1024 count=720 status=none
+    mformat -a -f 720 -i $disk ::
+    mcopy -i $disk fsperf.tos ::/FSPERF.TOS
+    mcopy -i $disk EMUDESK.INF ::/EMUDESK.INF
+    outtxt=$(mktemp)
+    hatari --log-level fatal --sound off --fast-forward on --run-vbls 20000 \
+        --fast-boot on --natfeats on --tos "$EMUTOS" --disk-a $disk "$@" >"$outtxt" 2>&1
+    if [ $? -ne 0 ]; then
+        echo "ERROR: Failed to run hatari:"
+        cat "$outtxt"
+        rm "$outtxt"
+        exit 1
+    fi
+    rm "$outtxt"
+    mcopy -i $disk ::/FSPERF.TXT . 2>/dev/null
+    if [ ! -f FSPERF.TXT ]; then
+        echo "ERROR: FSPERF.TXT has not been created."
+        exit 1
+    fi
+    if grep -q "failed" FSPERF.TXT; then
+        echo "ERROR: the benchmark failed."
+        exit 1
+    fi
+}
+
+echo "- Checking ST ... "
+run_hatari --machine st --cpulevel 0
+cat FSPERF.TXT
+
+echo "- Checking TT ... "
+run_hatari --machine tt --cpulevel 3
+cat FSPERF.TXT
+
+echo "All done."
@@ -26,4 +26,20 @@ static inline void nf_shutdown(void)
                   : "d0", "d1", "d2", "a0", "a1", "a2", "memory", "cc");
 }
 
+static inline void nf_stderr(const char *text)
+{
+    const char *str = "NF_STDERR";
+
+    asm volatile (" move.l  %1,-(sp)\n"
+                  " move.l  %0,-(sp)\n"
+                  " pea     0f(pc)\n"
+                  " .dc.w   0x7300\n"
+                  " move.l  d0,4(sp)\n"
+                  " .dc.w   0x7301\n"
+                  " lea     12(sp),sp\n"
+                  "0:\n"
+                  :: "r"(str), "r"(text)
+                  : "d0", "d1", "d2", "a0", "a1", "a2", "memory", "cc");
+}
+
 #endif
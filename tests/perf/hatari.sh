@@ -0,0 +1,49 @@
+#!/bin/sh
+# Copyright (C) 2026 The EmuTOS development team
+#
+# This file is distributed under the GPL, version 2 or at your
+# option any later version.  See doc/license.txt for details.
+
+echo "Performance benchmarks (with Hatari):"
+
+if ! command -v hatari >/dev/null 2>&1; then
+    echo "ERROR: You must install hatari to run this test."
+    exit 1
+fi
+
+if [ -z "$EMUTOS" ]; then
+    export EMUTOS=../../etos1024k.img
+fi
+
+export SDL_VIDEODRIVER=dummy
+export SDL_AUDIODRIVER=dummy
+
+run_hatari() {
+    rm -f PERF.TXT
+    outtxt=$(mktemp)
+    hatari --log-level fatal --sound off --fast-forward on --run-vbls 20000 \
+        --fast-boot on --natfeats on --tos "$EMUTOS" -d . "$@" >"$outtxt" 2>&1
+    if [ $? -ne 0 ]; then
+        echo "ERROR: Failed to run hatari:"
+        cat "$outtxt"
+        rm "$outtxt"
+        exit 1
+    fi
+    rm "$outtxt"
+    if [ ! -f PERF.TXT ]; then
+        echo "ERROR: PERF.TXT has not been created."
+        exit 1
+    fi
+}
+
+echo "- Checking ST ... "
+run_hatari --machine st --cpulevel 0
+cat PERF.TXT
+
+echo "- Checking TT ... "
+run_hatari --machine tt --cpulevel 3
+cat PERF.TXT
+
+rm -f PERF.TXT PERFTEST.DAT
+
+echo "All done."
@@ -0,0 +1,280 @@
+/*
+ * perfbm.c - time standard VDI, AES and GEMDOS workloads
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * Each workload is run a fixed number of times, and the elapsed time
+ * is reported as one line:
+ *
+ *   PERF <name> <count> <ms>
+ *
+ * on screen, in PERF.TXT and, via NatFeats, on the emulator's stderr.
+ * The program then shuts the emulator down.
+ */
+
+#include <stdio.h>
+#include <gem.h>
+#include <osbind.h>
+#include "nat_feat.h"
+
+#define HZ_200      ((volatile unsigned long *)0x4ba)
+#define FILENAME    "PERFTEST.DAT"
+#define FILESIZE    (256*1024L)
+#define CHUNK       (32*1024L)
+
+static short handle;
+static short scr_w, scr_h;
+static FILE *fh;
+static char iobuf[CHUNK];
+
+static long read_hz_200(void)
+{
+    return *HZ_200;
+}
+
+static long now(void)
+{
+    return Supexec(read_hz_200);
+}
+
+static void report(const char *name, short count, long start)
+{
+    char line[64];
+
+    sprintf(line, "PERF %s %d %ld\n", name, count, (now() - start) * 5);
+    printf("%s", line);
+    if (fh)
+        fputs(line, fh);
+    nf_stderr(line);
+}
+
+static void bench_text(void)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog";
+    static const char *names[] = { "v_gtext_8x8", "v_gtext_8x16", "v_gtext_6x6" };
+    static const short points[] = { 9, 10, 8 };
+    char name[32];
+    short font, effects, i, y, dummy;
+    long start;
+
+    for (font = 0; font < 3; font++) {
+        vst_point(handle, points[font], &dummy, &dummy, &dummy, &dummy);
+        for (effects = 0; effects < 32; effects++) {
+            vst_effects(handle, effects);
+            start = now();
+            for (i = 0, y = 16; i < 100; i++) {
+                v_gtext(handle, 0, y, text);
+                y = (y + 16) % scr_h;
+            }
+            sprintf(name, "%s_fx%02x", names[font], effects);
+            report(name, 100, start);
+        }
+    }
+    vst_effects(handle, 0);
+}
+
+static void bench_fill(void)
+{
+    short pxy[12];
+    short i;
+    long start;
+
+    vsf_interior(handle, FIS_PATTERN);
+    vsf_style(handle, 4);
+    vsf_perimeter(handle, 0);
+
+    start = now();
+    for (i = 0; i < 100; i++) {
+        pxy[0] = i;
+        pxy[1] = i;
+        pxy[2] = scr_w - 1 - i;
+        pxy[3] = scr_h - 1 - i;
+        v_bar(handle, pxy);
+    }
+    report("v_bar", 100, start);
+
+    start = now();
+    for (i = 0; i < 100; i++) {
+        pxy[0] = scr_w / 2;
+        pxy[1] = i;
+        pxy[2] = scr_w - 1 - i;
+        pxy[3] = scr_h / 2;
+        pxy[4] = scr_w / 2;
+        pxy[5] = scr_h - 1 - i;
+        pxy[6] = i;
+        pxy[7] = scr_h / 2;
+        pxy[8] = scr_w / 4;
+        pxy[9] = scr_h / 4;
+        v_fillarea(handle, 5, pxy);
+    }
+    report("v_fillarea", 100, start);
+}
+
+static void bench_scroll(void)
+{
+    MFDB screen;
+    short pxy[8];
+    short i;
+    long start;
+
+    screen.fd_addr = NULL;
+
+    start = now();
+    for (i = 0; i < 100; i++) {
+        pxy[0] = 0;
+        pxy[1] = 16;
+        pxy[2] = scr_w - 1;
+        pxy[3] = scr_h - 1;
+        pxy[4] = 0;
+        pxy[5] = 0;
+        pxy[6] = scr_w - 1;
+        pxy[7] = scr_h - 17;
+        vro_cpyfm(handle, S_ONLY, pxy, &screen, &screen);
+    }
+    report("vro_cpyfm_vscroll", 100, start);
+
+    start = now();
+    for (i = 0; i < 100; i++) {
+        pxy[0] = 8;
+        pxy[1] = 0;
+        pxy[2] = scr_w - 1;
+        pxy[3] = scr_h - 1;
+        pxy[4] = 0;
+        pxy[5] = 0;
+        pxy[6] = scr_w - 9;
+        pxy[7] = scr_h - 1;
+        vro_cpyfm(handle, S_ONLY, pxy, &screen, &screen);
+    }
+    report("vro_cpyfm_hscroll", 100, start);
+}
+
+static void bench_window(void)
+{
+    short wx, wy, ww, wh, x, y, w, h;
+    short win, i;
+    long start;
+
+    wind_get(0, WF_WORKXYWH, &wx, &wy, &ww, &wh);
+
+    start = now();
+    for (i = 0; i < 20; i++) {
+        win = wind_create(NAME|CLOSER|MOVER|SIZER|FULLER|INFO|UPARROW|DNARROW|VSLIDE,
+                          wx, wy, ww, wh);
+        if (win < 0)
+            return;
+        wind_set_str(win, WF_NAME, "perfbm");
+        wind_set_str(win, WF_INFO, "");
+        wind_open(win, wx + 16, wy + 16, ww / 2, wh / 2);
+        wind_close(win);
+        wind_delete(win);
+    }
+    report("wind_open", 20, start);
+
+    win = wind_create(NAME|MOVER|SIZER, wx, wy, ww, wh);
+    if (win < 0)
+        return;
+    wind_set_str(win, WF_NAME, "perfbm");
+    wind_open(win, wx + 16, wy + 16, ww / 2, wh / 2);
+
+    start = now();
+    for (i = 0; i < 50; i++)
+        wind_set(win, WF_CURRXYWH, wx + 16 + (i & 15) * 4, wy + 16 + (i & 7) * 4, ww / 2, wh / 2);
+    report("wind_move", 50, start);
+
+    start = now();
+    for (i = 0; i < 50; i++) {
+        wind_update(BEG_UPDATE);
+        graf_mouse(M_OFF, NULL);
+        wind_get(win, WF_FIRSTXYWH, &x, &y, &w, &h);
+        while (w && h) {
+            short pxy[4];
+
+            pxy[0] = x;
+            pxy[1] = y;
+            pxy[2] = x + w - 1;
+            pxy[3] = y + h - 1;
+            vs_clip(handle, 1, pxy);
+            v_bar(handle, pxy);
+            wind_get(win, WF_NEXTXYWH, &x, &y, &w, &h);
+        }
+        vs_clip(handle, 0, NULL);
+        graf_mouse(M_ON, NULL);
+        wind_update(END_UPDATE);
+    }
+    report("wind_redraw", 50, start);
+
+    wind_close(win);
+    wind_delete(win);
+}
+
+static void bench_file(void)
+{
+    long start, n;
+    short fd;
+
+    start = now();
+    fd = Fcreate(FILENAME, 0);
+    if (fd < 0)
+        return;
+    for (n = 0; n < FILESIZE; n += CHUNK)
+        Fwrite(fd, CHUNK, iobuf);
+    Fclose(fd);
+    report("Fwrite_256k", 1, start);
+
+    start = now();
+    fd = Fopen(FILENAME, 0);
+    if (fd < 0)
+        return;
+    for (n = 0; n < FILESIZE; n += CHUNK)
+        Fread(fd, CHUNK, iobuf);
+    Fclose(fd);
+    report("Fread_256k", 1, start);
+
+    Fdelete(FILENAME);
+}
+
+int main(void)
+{
+    short work_in[11], work_out[57];
+    short dummy, i;
+
+    appl_init();
+    handle = graf_handle(&dummy, &dummy, &dummy, &dummy);
+    for (i = 0; i < 10; i++)
+        work_in[i] = 1;
+    work_in[10] = 2;
+    v_opnvwk(work_in, &handle, work_out);
+    if (!handle) {
+        printf("Can not open a VDI workstation\n");
+        appl_exit();
+        return 1;
+    }
+    scr_w = work_out[0] + 1;
+    scr_h = work_out[1] + 1;
+
+    fh = fopen("PERF.TXT", "wb");
+
+    graf_mouse(M_OFF, NULL);
+    bench_text();
+    bench_fill();
+    bench_scroll();
+    graf_mouse(M_ON, NULL);
+    bench_window();
+    form_dial(FMD_FINISH, 0, 0, 0, 0, 0, 0, scr_w, scr_h);
+    bench_file();
+
+    if (fh)
+        fclose(fh);
+
+    v_clsvwk(handle);
+    appl_exit();
+
+    Supexec(nf_shutdown);
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * bigprg - child program for the Pexec() benchmark
+ *
+ * It does nothing, but its data segment contains a large table of
+ * pointers, each of which needs a fixup when the program is loaded.
+ */
+
+#define R4(x)       x, x, x, x
+#define R16(x)      R4(x), R4(x), R4(x), R4(x)
+#define R8192(x)    R16(R16(R16(x))), R16(R16(R16(x)))
+
+static const void *table[] = { R8192(&table) };
+
+int main(void)
+{
+    return (table[0] == &table) ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * pexecbm - measure program launch latency
+ *
+ * Runs BIGPRG.TOS repeatedly via Pexec() and reports the average time
+ * per launch, both on screen and in PEXEC.TXT.
+ */
+
+#include <stdio.h>
+#include <osbind.h>
+#include "nat_feat.h"
+
+#define LAUNCHES    50
+#define HZ_200      ((volatile unsigned long *)0x4ba)
+
+static long read_hz_200(void)
+{
+    return *HZ_200;
+}
+
+int main(void)
+{
+    FILE *fh;
+    long start, ticks, rc;
+    int i;
+
+    start = Supexec(read_hz_200);
+    for (i = 0; i < LAUNCHES; i++)
+    {
+        rc = Pexec(0, "BIGPRG.TOS", "", NULL);
+        if (rc != 0)
+        {
+            printf("Pexec() failed, rc=%ld\n", rc);
+            return 1;
+        }
+    }
+    ticks = Supexec(read_hz_200) - start;
+
+    fh = fopen("PEXEC.TXT", "wb");
+    if (!fh) {
+        printf("Can not open PEXEC.TXT\n");
+        return 1;
+    }
+    printf("%d launches: %ld ms per launch\n", LAUNCHES, ticks * 5 / LAUNCHES);
+    fprintf(fh, "%d launches: %ld ms per launch\n", LAUNCHES, ticks * 5 / LAUNCHES);
+    fclose(fh);
+
+    Supexec(nf_shutdown);
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * vdiprof.c - dump the EmuTOS VDI profiling counters
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * This requires EmuTOS to be built with CONF_WITH_VDI_PROFILE=1.
+ *
+ * Usage: vdiprof [-r]
+ *
+ * Without arguments, the counters for every VDI function that has been
+ * called are displayed, and written to VDIPROF.TXT.  With -r, the
+ * counters are reset, so that a run of the program to be measured can
+ * be followed by a run of vdiprof to see where the time went.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <gem.h>
+
+#define V_PROFILE_ESC   0x4550
+
+static short contrl[12];
+static short intin[16];
+static short ptsin[16];
+static short intout[64];
+static short ptsout[16];
+
+static void *pblock[5] = { contrl, intin, ptsin, intout, ptsout };
+
+static void vdi_trap(void)
+{
+    __asm__ volatile (
+        "move.l %0,d1\n\t"
+        "moveq  #115,d0\n\t"
+        "trap   #2"
+        :
+        : "g"(pblock)
+        : "d0", "d1", "d2", "a0", "a1", "a2", "memory", "cc");
+}
+
+/*
+ * read the counters for one opcode (0 => this workstation, -1 => reset)
+ *
+ * returns the number of values returned by the VDI: this is 0 if the
+ * escape is not supported
+ */
+static int read_profile(short handle, short opcode, unsigned long *calls,
+                        unsigned long *ticks, short *rate)
+{
+    contrl[0] = 5;
+    contrl[1] = 0;
+    contrl[3] = 1;
+    contrl[5] = V_PROFILE_ESC;
+    contrl[6] = handle;
+    contrl[4] = 0;
+    intin[0] = opcode;
+    vdi_trap();
+
+    if (contrl[4] < 5)
+        return 0;
+
+    *calls = ((unsigned long)(unsigned short)intout[0] << 16) | (unsigned short)intout[1];
+    *ticks = ((unsigned long)(unsigned short)intout[2] << 16) | (unsigned short)intout[3];
+    *rate = intout[4];
+
+    return contrl[4];
+}
+
+static void dump(FILE *fh, short handle, short first, short last)
+{
+    unsigned long calls, ticks;
+    short opcode, rate;
+
+    for (opcode = first; opcode <= last; opcode++) {
+        if (!read_profile(handle, opcode, &calls, &ticks, &rate))
+            continue;
+        if (calls == 0)
+            continue;
+        printf("%5d %10lu %10lu %8lu\n", opcode, calls, ticks, ticks * 1000UL / rate);
+        if (fh)
+            fprintf(fh, "%5d %10lu %10lu %8lu\n", opcode, calls, ticks, ticks * 1000UL / rate);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    short work_in[11], work_out[57];
+    short handle, dummy, i, rate;
+    unsigned long calls, ticks;
+    FILE *fh;
+
+    appl_init();
+    handle = graf_handle(&dummy, &dummy, &dummy, &dummy);
+    for (i = 0; i < 10; i++)
+        work_in[i] = 1;
+    work_in[10] = 2;
+    v_opnvwk(work_in, &handle, work_out);
+    if (!handle) {
+        printf("Can not open a VDI workstation\n");
+        appl_exit();
+        return 1;
+    }
+
+    if (!read_profile(handle, 0, &calls, &ticks, &rate)) {
+        printf("VDI profiling is not available\n");
+        v_clsvwk(handle);
+        appl_exit();
+        return 1;
+    }
+
+    if ((argc > 1) && !strcmp(argv[1], "-r")) {
+        read_profile(handle, -1, &calls, &ticks, &rate);
+        printf("VDI profiling counters reset\n");
+    } else {
+        fh = fopen("VDIPROF.TXT", "wb");
+        printf("   op      calls      ticks       ms\n");
+        if (fh)
+            fprintf(fh, "   op      calls      ticks       ms\n");
+        dump(fh, handle, 1, 39);
+        dump(fh, handle, 100, 139);
+        if (fh)
+            fclose(fh);
+    }
+
+    v_clsvwk(handle);
+    appl_exit();
+
+    return 0;
+}
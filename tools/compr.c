@@ -0,0 +1,265 @@
+/*
+ * compr.c - Compress a binary image for util/uncompr.S
+ *
+ * Copyright (C) 2026 The EmuTOS development team
+ *
+ * This file is distributed under the GPL, version 2 or at your
+ * option any later version.  See doc/license.txt for details.
+ */
+
+/*
+ * This tool compresses a file using a simple LZ77 format, similar to LZ4,
+ * which was chosen because it can be decompressed quickly by a 68000.
+ *
+ * The output file starts with the magic 'ETLZ' and the uncompressed size,
+ * both as big endian longs.  Then follows a list of sequences:
+ *
+ *   token          high nibble: number of literals (15 = more follow)
+ *                  low nibble: match length - 4 (15 = more follow)
+ *   [more]         if the literal count is 15: bytes to add to it,
+ *                  until a byte which is not 255
+ *   literals       bytes to copy as is
+ *   offset         big endian word: distance back to the match (1-65535)
+ *   [more]         if the match length is 15: bytes to add to it, as above
+ *
+ * The last sequence contains only literals: the decompressor stops when,
+ * after copying the literals of a sequence, it has produced the whole
+ * uncompressed size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MIN_MATCH   4
+#define MAX_OFFSET  65535
+#define HASH_BITS   16
+#define HASH_SIZE   (1UL << HASH_BITS)
+#define MAX_CHAIN   256     /* max number of candidates tried per position */
+#define NO_POS      ((uint32_t)-1)
+
+/* Global variables */
+static const char* g_argv0; /* Program name */
+static uint32_t g_head[HASH_SIZE]; /* Most recent position for each hash */
+
+/* Write a big endian long */
+static void put_big_endian_long(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+/* Hash of the MIN_MATCH bytes at p */
+static uint32_t hash(const uint8_t* p)
+{
+    uint32_t v = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+               | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+
+    return (uint32_t)(v * 2654435761UL) >> (32 - HASH_BITS);
+}
+
+/* Write a length extension: 255 bytes, then the remainder */
+static uint8_t* put_length(uint8_t* out, size_t len)
+{
+    while (len >= 255)
+    {
+        *out++ = 255;
+        len -= 255;
+    }
+    *out++ = (uint8_t)len;
+
+    return out;
+}
+
+/* Write one sequence, return the new output pointer */
+static uint8_t* put_sequence(uint8_t* out, const uint8_t* lit, size_t nlit, size_t offset, size_t mlen)
+{
+    uint8_t* token = out++;
+
+    *token = (uint8_t)((nlit < 15 ? nlit : 15) << 4);
+    if (nlit >= 15)
+        out = put_length(out, nlit - 15);
+    memcpy(out, lit, nlit);
+    out += nlit;
+
+    if (mlen == 0)  /* last sequence */
+        return out;
+
+    *out++ = (uint8_t)(offset >> 8);
+    *out++ = (uint8_t)offset;
+    mlen -= MIN_MATCH;
+    *token |= (uint8_t)(mlen < 15 ? mlen : 15);
+    if (mlen >= 15)
+        out = put_length(out, mlen - 15);
+
+    return out;
+}
+
+/* Compress 'size' bytes from 'in' to 'out', return the compressed size */
+static size_t compress(const uint8_t* in, size_t size, uint8_t* out, uint32_t* chain)
+{
+    uint8_t* start = out;
+    size_t pos = 0, anchor = 0;
+    size_t i;
+
+    for (i = 0; i < HASH_SIZE; i++)
+        g_head[i] = NO_POS;
+
+    while (pos + MIN_MATCH <= size)
+    {
+        uint32_t h = hash(in + pos);
+        uint32_t cand = g_head[h];
+        size_t best_len = 0, best_off = 0;
+        int tries = MAX_CHAIN;
+
+        /* find the longest match in the window */
+        while (cand != NO_POS && pos - cand <= MAX_OFFSET && tries-- > 0)
+        {
+            size_t len = 0;
+
+            while (pos + len < size && in[cand + len] == in[pos + len])
+                len++;
+            if (len > best_len)
+            {
+                best_len = len;
+                best_off = pos - cand;
+            }
+            cand = chain[cand];
+        }
+
+        chain[pos] = g_head[h];
+        g_head[h] = (uint32_t)pos;
+
+        if (best_len < MIN_MATCH)
+        {
+            pos++;
+            continue;
+        }
+
+        out = put_sequence(out, in + anchor, pos - anchor, best_off, best_len);
+
+        /* enter the matched positions into the hash chains */
+        for (i = 1; i < best_len && pos + i + MIN_MATCH <= size; i++)
+        {
+            h = hash(in + pos + i);
+            chain[pos + i] = g_head[h];
+            g_head[h] = (uint32_t)(pos + i);
+        }
+
+        pos += best_len;
+        anchor = pos;
+    }
+
+    /* remaining literals */
+    out = put_sequence(out, in + anchor, size - anchor, 0, 0);
+
+    return out - start;
+}
+
+/* Read a whole file into a malloc'd buffer */
+static uint8_t* read_file(const char* filename, size_t* psize)
+{
+    FILE* file;
+    long size;
+    uint8_t* buf;
+
+    file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        perror(filename);
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0
+     || fseek(file, 0, SEEK_SET) != 0)
+    {
+        perror(filename);
+        fclose(file);
+        return NULL;
+    }
+
+    buf = malloc(size ? size : 1);
+    if (buf == NULL)
+    {
+        fprintf(stderr, "%s: not enough memory\n", g_argv0);
+        fclose(file);
+        return NULL;
+    }
+
+    if (fread(buf, 1, size, file) != (size_t)size)
+    {
+        fprintf(stderr, "%s: %s: read error\n", g_argv0, filename);
+        free(buf);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    *psize = size;
+
+    return buf;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* infilename;
+    const char* outfilename;
+    uint8_t* in;
+    uint8_t* out;
+    uint32_t* chain;
+    size_t insize, outsize;
+    FILE* outfile;
+
+    g_argv0 = argv[0];
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s <source> <destination>\n", g_argv0);
+        return EXIT_FAILURE;
+    }
+
+    infilename = argv[1];
+    outfilename = argv[2];
+
+    in = read_file(infilename, &insize);
+    if (in == NULL)
+        return EXIT_FAILURE;
+
+    /* worst case: one extension byte per 255 literals, plus a token */
+    out = malloc(8 + insize + insize / 255 + 16);
+    chain = malloc((insize ? insize : 1) * sizeof(uint32_t));
+    if (out == NULL || chain == NULL)
+    {
+        fprintf(stderr, "%s: not enough memory\n", g_argv0);
+        return EXIT_FAILURE;
+    }
+
+    memcpy(out, "ETLZ", 4);
+    put_big_endian_long(out + 4, (uint32_t)insize);
+    outsize = 8 + compress(in, insize, out + 8, chain);
+
+    outfile = fopen(outfilename, "wb");
+    if (outfile == NULL)
+    {
+        perror(outfilename);
+        return EXIT_FAILURE;
+    }
+
+    if (fwrite(out, 1, outsize, outfile) != outsize || fclose(outfile) != 0)
+    {
+        fprintf(stderr, "%s: %s: write error\n", g_argv0, outfilename);
+        return EXIT_FAILURE;
+    }
+
+    printf("# %s: %lu bytes compressed to %lu bytes\n", outfilename,
+        (unsigned long)insize, (unsigned long)outsize);
+
+    free(chain);
+    free(out);
+    free(in);
+
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,7 @@
 /*
  * boot.c - standalone PRG to load EmuTOS in RAM
  *
- * Copyright (C) 2001-2019 The EmuTOS development team
+ * Copyright (C) 2001-2026 The EmuTOS development team
  *
  * Authors:
  *  LVL     Laurent Vogel
@@ -30,6 +30,11 @@ void bootram(const UBYTE *src, ULONG size, ULONG cpu) NORETURN;
 extern const UBYTE ramtos[];
 extern const UBYTE end_ramtos[];
 
+#ifdef COMPRESS_PRG
+/* emutos.img is compressed by tools/compr.c, see util/uncompr.S */
+ULONG uncompr(const UBYTE *src, UBYTE *dst);
+#endif
+
 /*
  * cookie stuff
  */
@@ -85,23 +90,48 @@ static ULONG get_cookie(ULONG id)
 
 int main(void)
 {
+  const UBYTE *image;
   ULONG count;
   ULONG cpu, mch;
 #if DBG_BOOT
   UBYTE *address;
 #endif
 
+#ifdef COMPRESS_PRG
+  {
+    /* uncompress the image to a buffer, its size follows the magic */
+    UBYTE *buf = (UBYTE *)Malloc(*(const ULONG *)(ramtos + 4));
+
+    if (buf == NULL) {
+      (void)Cconws("Not enough memory to uncompress EmuTOS.\r\n");
+      (void)Cconws("Hit RETURN to exit");
+      (void)Cconin();
+      return 1;
+    }
+
+    count = uncompr(ramtos, buf);
+    if (count == 0) {
+      (void)Cconws("The embedded EmuTOS image is damaged.\r\n");
+      (void)Cconws("Hit RETURN to exit");
+      (void)Cconin();
+      return 1;
+    }
+    image = buf;
+  }
+#else
   /* get the file size */
 
   count = end_ramtos - ramtos;
+  image = ramtos;
+#endif
 
 #if DBG_BOOT
   /* get final address */
 
-  address = *((UBYTE **)(ramtos + 8));
+  address = *((UBYTE **)(image + 8));
 
   (void)Cconws("src = 0x");
-  putl((ULONG)ramtos);
+  putl((ULONG)image);
   (void)Cconws("\012\015");
 
   (void)Cconws("dst = 0x");
@@ -138,7 +168,7 @@ int main(void)
 
   /* do the rest in assembler */
 
-  bootram(ramtos, count, cpu);
+  bootram(image, count, cpu);
 
   return 1;
 }
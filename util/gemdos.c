@@ -21,12 +21,13 @@
 
 #include "emutos.h"
 #include "string.h"
+#include "gemerror.h"
 #include "asm.h"
 #include "gemdos.h"
 #include "bdosbind.h"
 
 
-WORD pgmld(WORD handle, char *pname, LONG **ldaddr)
+WORD pgmld(char *pname, LONG **ldaddr)
 {
     LONG    length, ret;
     LONG    *temp;
@@ -160,3 +161,58 @@ LONG dos_load_file(char *filename, LONG count, char *buf)
 
     return ret;
 }
+
+
+#if CONF_WITH_FSNEXTN
+/*
+ *  Batched directory search
+ *
+ *  dos_bsfirst()/dos_bsnext() behave like dos_sfirst()/dos_snext(), and
+ *  return each entry in the DTA current at the time of dos_bsfirst().
+ *  However the entries after the first are fetched BSEARCH_ENTRIES at a
+ *  time via Fsnextn(), which makes reading a large directory much faster.
+ *  If Fsnextn() is unavailable, we fall back to Fsnext().
+ *
+ *  Only one batched search may be active at a time.
+ */
+#define BSEARCH_ENTRIES 32
+
+static struct
+{
+    DTA *dta;                   /* where entries are returned */
+    WORD next;                  /* index of next entry to return */
+    WORD count;                 /* number of entries in buffer */
+    WORD ret;                   /* result of latest Fsnextn() */
+    FSENTRY entry[BSEARCH_ENTRIES];
+} bsrch;
+
+WORD dos_bsfirst(char *pspec, WORD attr)
+{
+    bsrch.dta = dos_gdta();
+    bsrch.next = bsrch.count = 0;
+    bsrch.ret = E_OK;
+
+    return dos_sfirst(pspec, attr);
+}
+
+WORD dos_bsnext(void)
+{
+    if (bsrch.next >= bsrch.count)
+    {
+        if (bsrch.ret >= 0)
+            bsrch.ret = Fsnextn(bsrch.entry, BSEARCH_ENTRIES);
+        if (bsrch.ret == EINVFN)
+            return dos_snext();
+        if (bsrch.ret < 0)
+            return bsrch.ret;
+        bsrch.next = 0;
+        bsrch.count = bsrch.ret;
+        if (bsrch.count < BSEARCH_ENTRIES)    /* end of directory */
+            bsrch.ret = ENMFIL;
+    }
+
+    memcpy(&bsrch.dta->d_attrib, &bsrch.entry[bsrch.next++].e_attrib, sizeof(FSENTRY)-1);
+
+    return E_OK;
+}
+#endif
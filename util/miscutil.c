@@ -8,6 +8,7 @@
  */
 #include "emutos.h"
 #include "string.h"
+#include "intmath.h"
 #include "miscutil.h"
 
 /*
@@ -53,3 +54,76 @@ void set_all_files(char *target)
 {
     strcpy(target,"*.*");
 }
+
+
+/*
+ *  returns a sort key for a string: up to the first 4 characters,
+ *  packed so that the keys compare in the same order as strcmp()
+ */
+ULONG sort_strkey(const char *s)
+{
+    ULONG key = 0UL;
+    WORD i;
+
+    for (i = 0; i < 4; i++)
+    {
+        key <<= 8;
+        if (*s)
+            key |= (UBYTE)*s++;
+    }
+
+    return key;
+}
+
+
+/*
+ *  returns TRUE iff item 'a' sorts strictly before item 'b'
+ */
+static BOOL sort_before(const SORTKEY *a, const SORTKEY *b, SORTCMP cmp)
+{
+    if (a->key != b->key)
+        return (a->key < b->key);
+
+    return cmp ? (cmp(a->item, b->item) < 0) : FALSE;
+}
+
+
+/*
+ *  sorts an array of SORTKEYs, using a stable bottom-up merge sort
+ *
+ *  'work' must point to an array of at least 'count' SORTKEYs.  'cmp'
+ *  is only called for items with equal keys, and may be NULL.
+ */
+void sort_keys(SORTKEY *base, LONG count, SORTKEY *work, SORTCMP cmp)
+{
+    SORTKEY *src, *dst, *temp;
+    LONG width, lo, mid, hi, i, j, k;
+
+    src = base;
+    dst = work;
+    for (width = 1; width < count; width *= 2)
+    {
+        for (lo = 0; lo < count; lo += 2*width)
+        {
+            mid = min(lo+width, count);
+            hi = min(lo+2*width, count);
+            for (i = lo, j = mid, k = lo; (i < mid) && (j < hi); )
+            {
+                if (sort_before(&src[j], &src[i], cmp))
+                    dst[k++] = src[j++];
+                else
+                    dst[k++] = src[i++];
+            }
+            while (i < mid)
+                dst[k++] = src[i++];
+            while (j < hi)
+                dst[k++] = src[j++];
+        }
+        temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    if (src != base)
+        memcpy(base, src, count*sizeof(SORTKEY));
+}
@@ -219,6 +219,25 @@ char *scan_2(char *pcurr, WORD *pwd)
 }
 
 
+/*
+ *  Convert the low byte of a WORD value to a 2-digit hex character
+ *  string: this is the inverse of scan_2(), and is much cheaper than
+ *  sprintf("%02X") when writing lots of values.
+ *
+ *  The output is not nul-terminated; the returned pointer points after
+ *  the hex digits.
+ */
+char *put_2(char *pcurr, WORD value)
+{
+    static const char hexdigits[] = "0123456789ABCDEF";
+
+    *pcurr++ = hexdigits[(value>>4)&0x0f];
+    *pcurr++ = hexdigits[value&0x0f];
+
+    return pcurr;
+}
+
+
 /*
  * return pointer to start of last segment of path
  * (assumed to be the filename)
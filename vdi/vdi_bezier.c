@@ -13,6 +13,7 @@
  */
 
 #include "emutos.h"
+#include "intmath.h"
 #include "vdi_defs.h"
 #include "biosbind.h"
 #include "asm.h"        /* for malloc */
@@ -49,6 +50,35 @@
 
 
 
+/*
+ * fixed-point scale used while flattening curves: coordinates are held
+ * in 1/BEZ_ONE pixel units
+ */
+#define BEZ_SHIFT       4
+#define BEZ_ONE         (1 << BEZ_SHIFT)
+
+/*
+ * the maximum depth of subdivision of a curve, i.e. a curve is never
+ * split into more than 2^MAX_BEZ_DEPTH segments
+ */
+#define MAX_BEZ_DEPTH   10
+
+/*
+ * a curve (or part of one) during flattening
+ */
+typedef struct {
+    LONG x[4];
+    LONG y[4];
+    WORD depth;
+} BEZSEG;
+
+/*
+ * the vertex buffer shared by v_bez() and v_bez_fill()
+ */
+static Point ptsbuf[MAX_VERTICES];
+
+
+
 /*
  * labs - absolute for LONG
  */
@@ -64,95 +94,166 @@ labs(LONG x)
 
 
 /*
- * gen_segs -  compute bezier function by difference method
+ * bez_tolerance - returns the flatness tolerance for a bezier quality
+ *
+ * the tolerance is in 1/BEZ_ONE pixel units: it is 8 pixels for the
+ * lowest quality, and halves for each step up to 1/16 pixel for the
+ * highest quality
+ */
+static LONG
+bez_tolerance(WORD bez_qual)
+{
+    return (8L * BEZ_ONE) >> bez_qual;
+}
+
+
+
+/*
+ * bez_flat - returns TRUE if a curve is within the tolerance of the
+ *            straight line between its anchor points
+ *
+ * the distance of the curve from its chord is at most 1/4 of
+ * sqrt(max(ux²,vx²) + max(uy²,vy²)), where u = 3c1-2a1-a2 and
+ * v = 3c2-a1-2a2.  we use the sum of the larger absolute values of
+ * the x & y terms instead, which avoids multiplication and overflow
+ * and overestimates the distance by at most a factor of sqrt(2).
+ */
+static BOOL
+bez_flat(const BEZSEG *seg, LONG tolerance)
+{
+    LONG ux, uy, vx, vy;
+
+    ux = labs(3 * seg->x[1] - 2 * seg->x[0] - seg->x[3]);
+    uy = labs(3 * seg->y[1] - 2 * seg->y[0] - seg->y[3]);
+    vx = labs(3 * seg->x[2] - seg->x[0] - 2 * seg->x[3]);
+    vy = labs(3 * seg->y[2] - seg->y[0] - 2 * seg->y[3]);
+
+    return (max(ux, vx) + max(uy, vy)) <= 4 * tolerance;
+}
+
+
+
+/*
+ * bez_split - splits a curve at its midpoint (de Casteljau)
  *
- * last point is included
- * one dimension only, so use alternate elements of array & px
- * array[0] : anchor 1
- * array[2] : control 1
- * array[4] : control 2
- * array[6] : anchor 2
+ * the first half replaces *left, the second half replaces *right;
+ * left and right may be the same
  */
 static void
-gen_segs(WORD *const array, WORD *px, const int bez_qual,
-         WORD * pmin, WORD * pmax, WORD fill)
+bez_split(BEZSEG *left, BEZSEG *right, const BEZSEG *seg)
 {
-    LONG d3x, d2x, d1x;
-    LONG x0;
-    int q = 3 * bez_qual;
-    int qd = 0;
-    int i;
-    WORD x;
-
-    /*** calculate 1st, 2nd & 3rd order differences ***/
-    d1x = (LONG)array[2]-array[0];
-    d2x = (LONG)array[4]-array[2];
-    d3x = -array[0] - 3*d2x + array[6];
-    d2x -= d1x;
-
-    if (!fill && q >= 3) {
-        d1x>>=1;
-        d2x>>=1;
-        d3x>>=1;
-        q--;
+    LONG x01, x12, x23, x012, x123, xmid;
+    LONG y01, y12, y23, y012, y123, ymid;
+    LONG x0 = seg->x[0], x3 = seg->x[3];
+    LONG y0 = seg->y[0], y3 = seg->y[3];
+    WORD depth = seg->depth + 1;
+
+    x01 = (x0 + seg->x[1]) >> 1;
+    x12 = (seg->x[1] + seg->x[2]) >> 1;
+    x23 = (seg->x[2] + x3) >> 1;
+    x012 = (x01 + x12) >> 1;
+    x123 = (x12 + x23) >> 1;
+    xmid = (x012 + x123) >> 1;
+
+    y01 = (y0 + seg->y[1]) >> 1;
+    y12 = (seg->y[1] + seg->y[2]) >> 1;
+    y23 = (seg->y[2] + y3) >> 1;
+    y012 = (y01 + y12) >> 1;
+    y123 = (y12 + y23) >> 1;
+    ymid = (y012 + y123) >> 1;
+
+    right->x[0] = xmid;     right->y[0] = ymid;
+    right->x[1] = x123;     right->y[1] = y123;
+    right->x[2] = x23;      right->y[2] = y23;
+    right->x[3] = x3;       right->y[3] = y3;
+    right->depth = depth;
+
+    left->x[0] = x0;        left->y[0] = y0;
+    left->x[1] = x01;       left->y[1] = y01;
+    left->x[2] = x012;      left->y[2] = y012;
+    left->x[3] = xmid;      left->y[3] = ymid;
+    left->depth = depth;
+}
+
+
+
+/*
+ * bez_minmax - updates the extent of the output with a point
+ */
+static void
+bez_minmax(const Point *point, WORD *xmin, WORD *xmax, WORD *ymin, WORD *ymax)
+{
+    if (point->x < *xmin)
+        *xmin = point->x;
+    if (point->x > *xmax)
+        *xmax = point->x;
+    if (point->y < *ymin)
+        *ymin = point->y;
+    if (point->y > *ymax)
+        *ymax = point->y;
+}
+
+
+
+/*
+ * gen_segs - flatten a bezier curve into line segments
+ *
+ * cp[0] is the first anchor point, cp[1] & cp[2] are the control points,
+ * and cp[3] is the second anchor point.  the curve is split recursively
+ * (using an explicit stack) until each part is flat to within the
+ * tolerance, so that small or nearly straight curves generate few
+ * vertices and large curves generate as many as they need.
+ *
+ * the vertices, including both anchor points, are stored in out[];
+ * at most 'room' vertices are stored (the last one is always the second
+ * anchor point).  returns the number of vertices stored.
+ */
+static WORD
+gen_segs(const Point *cp, Point *out, WORD room, const LONG tolerance,
+         WORD *xmin, WORD *xmax, WORD *ymin, WORD *ymax)
+{
+    BEZSEG stack[MAX_BEZ_DEPTH+1];
+    BEZSEG *seg = stack;
+    Point *pt = out;
+    WORD i;
+
+    if (room < 2)
+        return 0;
+
+    for (i = 0; i < 4; i++) {
+        seg->x[i] = (LONG)cp[i].x << BEZ_SHIFT;
+        seg->y[i] = (LONG)cp[i].y << BEZ_SHIFT;
     }
+    seg->depth = 0;
 
-    d1x = ((3L * d1x) << (2 * bez_qual)) + ((3L * d2x) << bez_qual) + d3x;
-    /* assert( d1x <=  0x5f408000 ); */
-    /* assert( d1x >= -0x5f408000 ); */
-
-    d3x = 6L*d3x;
-    /* assert( d3x <=  0xbffe8 ); */
-    /* assert( d3x >= -0xbffe8 ); */
-
-    d2x = ((6L*d2x)<<bez_qual) + d3x;
-    /* assert( d2x <=  0x2f6fa12 ); */
-    /* assert( d2x >= -0x2f6fa12 ); */
-
-    x0 = labs(array[0]);
-    while( x0 >= (0x7fffffffL>>q) )
-        q--, qd++;
-
-    x0 = (((LONG)array[0]) << q) + (1L << (q - 1));
-
-    for(i = 1 << bez_qual; i > 0; i--) {
-        x = (WORD)(x0 >> q);
-        *px = x;
-        if ( x < *pmin )
-            *pmin = x;
-        if ( x > *pmax )
-            *pmax = x;
-        px+=2;
-
-        if (labs( (x0 >> 1) + (d1x >> (qd + 1)) ) >= 0x3ffffffeL) {
-            /** halve scale to avoid overflow **/
-            x0 >>= 1;
-            q--;
-            qd++;
-            /* assert( labs(x0+(d1x>>qd)) >= 0x40000000L ); */
-        }
+    *pt = cp[0];
+    bez_minmax(pt++, xmin, xmax, ymin, ymax);
 
-        x0 += d1x >> qd;
-        if ( qd > 0 && labs(x0) < 0x40000000L ) {
-            /** double scale to maximise accuracy **/
-            x0 = (x0 << 1)|1;
-            q++, qd--;
+    while (seg >= stack) {
+        if ((seg->depth < MAX_BEZ_DEPTH) && !bez_flat(seg, tolerance)) {
+            /* the second half stays in place, the first half is done next */
+            bez_split(seg+1, seg, seg);
+            seg++;
+            continue;
         }
 
-        /* assert( d2x<0 || d1x <=  0x7fffffff-d2x ); */
-        /* assert( d2x>0 || d1x >= -0x7fffffff-d2x ); */
-        d1x += d2x;
-        d2x += d3x;
-        /* assert( d2x <=  0x30bf9e8 ); */
-        /* assert( d2x >= -0x30bf9e8 ); */
+        /* output the end of this part, ignoring duplicates */
+        if (pt - out == room)
+            pt--;               /* out of room: replace the last vertex */
+        pt->x = (WORD)((seg->x[3] + BEZ_ONE/2) >> BEZ_SHIFT);
+        pt->y = (WORD)((seg->y[3] + BEZ_ONE/2) >> BEZ_SHIFT);
+        if ((pt->x != pt[-1].x) || (pt->y != pt[-1].y)) {
+            bez_minmax(pt, xmin, xmax, ymin, ymax);
+            pt++;
+        }
+        seg--;
     }
 
-    /** add the last point .. */
-    *px = x = array[6];
-    if ( x < *pmin )
-        *pmin = x;
-    if ( x > *pmax )
-        *pmax = x;
+    /* a curve that starts & ends at the same pixel still needs a segment */
+    if (pt - out < 2)
+        *pt++ = cp[3];
+
+    return pt - out;
 }
 
 
@@ -231,17 +332,14 @@ v_bez(Vwk * vwk, Point * ptsget, int nr_ptsin)
     int i;
     /* WORD  const nr_ptsin = CONTRL[1]; */
     UBYTE * bezarr = (UBYTE*)INTIN;
-    WORD bez_qual;
+    LONG tolerance;
     WORD xmin, xmax, ymin, ymax;
     WORD total_vertices = nr_ptsin;
     WORD total_jumps = 0;
-    UWORD vertices_per_bez;
-    Point ptsbuf[MAX_VERTICES];
+    WORD nr_vertices;
     /* Point * ptsget = (Point*)PTSIN; */
-    Point * ptsput = ptsbuf;
 
-    bez_qual = vwk->bez_qual;
-    vertices_per_bez = 1 << bez_qual;
+    tolerance = bez_tolerance(vwk->bez_qual);
     xmin = ymin = 32767;
     xmax = ymax = 0;
 
@@ -258,14 +356,14 @@ v_bez(Vwk * vwk, Point * ptsget, int nr_ptsin)
                 total_jumps++;          /* count jump point */
 
             /* generate line segments from bez points */
-            gen_segs(&ptsget->x, &ptsput->x, bez_qual, &xmin, &xmax, vwk->xfm_mode);    /* x coords */
-            gen_segs(&ptsget->y, &ptsput->y, bez_qual, &ymin, &ymax, vwk->xfm_mode);    /* y coords */
+            nr_vertices = gen_segs(ptsget, ptsbuf, MAX_VERTICES, tolerance,
+                                   &xmin, &xmax, &ymin, &ymax);
 
             /* skip to coord pairs at end of bez curve */
             i += 3;
             ptsget += 3;
-            total_vertices += vertices_per_bez-3;
-            draw_segs(vwk, vertices_per_bez+1, ptsbuf, NO_FILL );
+            total_vertices += nr_vertices-4;
+            draw_segs(vwk, nr_vertices, ptsbuf, NO_FILL );
         }
         else {
             /* polyline */
@@ -333,18 +431,16 @@ v_bez_fill(Vwk * vwk, Point * ptsget, int nr_ptsin)
     int i;
     /* WORD  const nr_ptsin = CONTRL[1]; */
     UBYTE * bezarr = (UBYTE*)INTIN;
-    WORD bez_qual;
+    LONG tolerance;
     WORD xmin, xmax, ymin, ymax;
     WORD total_vertices = nr_ptsin;
     WORD total_jumps = 0;
-    UWORD vertices_per_bez;
+    WORD nr_vertices;
     WORD output_vertices = 0;
-    Point ptsbuf[MAX_VERTICES];
     /* Point * ptsget = (Point*)PTSIN; */
     Point * ptsput = ptsbuf;
 
-    bez_qual = vwk->bez_qual;
-    vertices_per_bez = 1 << bez_qual;
+    tolerance = bez_tolerance(vwk->bez_qual);
     xmin = ymin = 32767;
     xmax = ymax = 0;
 
@@ -361,15 +457,15 @@ v_bez_fill(Vwk * vwk, Point * ptsget, int nr_ptsin)
                 total_jumps++;   /* count jump point */
 
             /* generate line segments from bez points */
-            gen_segs(&ptsget->x, &ptsput->x, bez_qual, &xmin, &xmax, vwk->xfm_mode);
-            gen_segs(&ptsget->y, &ptsput->y, bez_qual, &ymin, &ymax, vwk->xfm_mode);
+            nr_vertices = gen_segs(ptsget, ptsput, MAX_VERTICES-output_vertices, tolerance,
+                                   &xmin, &xmax, &ymin, &ymax);
 
             /* skip to coord pairs at end of bez curve */
             i += 3;
             ptsget += 3;
-            total_vertices += vertices_per_bez-3;
+            total_vertices += nr_vertices-4;
 
-            output_vertices += vertices_per_bez+1;
+            output_vertices += nr_vertices;
             ptsput = ptsbuf + output_vertices;
             /* draw_segs(vwk, vertices_per_bez+1, ptsbuf, FILL ); */
         }
@@ -413,7 +509,6 @@ v_bez_fill(Vwk * vwk, Point * ptsget, int nr_ptsin)
 
         /* draw segments and reset all vertex information */
         draw_segs(vwk, output_vertices, ptsbuf, FILL);
-        bez_qual = vwk->bez_qual;
         /* ptsget0 = ptsget; */
         ptsput = ptsbuf;
         output_vertices = 0;
@@ -438,20 +533,18 @@ v_bez_fill(Vwk * vwk, Point * ptsget, int nr_ptsin)
 {
     /* WORD  const nr_ptsin = CONTRL[1]; */
     const UBYTE *const bezarr = (UBYTE*)INTIN;  /* index with xor 1 to byte swap !! */
-    WORD bez_qual;
+    LONG tolerance;
     WORD xmin, xmax, ymin, ymax;
     WORD total_vertices = nr_ptsin;
     WORD total_jumps = 0;
-    WORD vertices_per_bez;
+    WORD nr_vertices;
     WORD i, i0;
     WORD output_vertices = 0;
-    Point ptsbuf[MAX_VERTICES];
     /* Point * ptsget = (Point*)PTSIN; */
     Point * ptsget0 = ptsget;
     Point * ptsput = ptsbuf;
 
-    bez_qual = vwk->bez_qual;
-    vertices_per_bez = 1 << bez_qual;
+    tolerance = bez_tolerance(vwk->bez_qual);
     xmin = ymin = 32767;
     xmax = ymax = 0;
 
@@ -466,34 +559,18 @@ v_bez_fill(Vwk * vwk, Point * ptsget, int nr_ptsin)
             if (IS_JUMP(flag))
                 total_jumps++;   /* count jump point */
 
-            /* keep this curve within nr vertices for the driver's ptsget[]
-             ** with one spare for the end point */
-            if ( output_vertices+vertices_per_bez+1 > INQ_TAB[14] ) {
-                if ( bez_qual > MIN_QUAL ) {
-                    /* reduce bezier quality & start this polygon again */
-                    bez_qual--;
-                    i = i0;
-                    ptsget = (Point*)PTSIN;
-                    ptsget0 = ptsget;
-                    ptsput = ptsbuf;
-                    output_vertices = 0;
-                    continue;
-                }
-                /* too bad if we get here. refuse to add vertices to output */
+            if ( i != i0 ) {
+                /* the end point will be copied in again */
+                ptsput -= 1;
+                output_vertices--;
             }
-            else {
-                if ( i != i0 ) {
-                    /* the end point will be copied in again */
-                    ptsput -= 1;
-                    output_vertices--;
-                }
 
-                output_vertices += vertices_per_bez+1;
-                total_vertices += vertices_per_bez-3;
-                gen_segs(&ptsget->x, &ptsput->x, bez_qual, &xmin, &xmax, vwk->xfm_mode);        /* x coords */
-                gen_segs(&ptsget->y, &ptsput->y, bez_qual, &ymin, &ymax, vwk->xfm_mode);        /* y coords */
-                ptsput = ptsbuf + output_vertices;
-            }
+            /* keep this curve within nr vertices for the driver's ptsget[] */
+            nr_vertices = gen_segs(ptsget, ptsput, INQ_TAB[14]-output_vertices, tolerance,
+                                   &xmin, &xmax, &ymin, &ymax);
+            output_vertices += nr_vertices;
+            total_vertices += nr_vertices-4;
+            ptsput = ptsbuf + output_vertices;
             /* assert( PTSIN + 2*i == ptsget ); */
             i+=3;
             ptsget += 3;
@@ -549,7 +626,6 @@ v_bez_fill(Vwk * vwk, Point * ptsget, int nr_ptsin)
 
         if ( i >= nr_ptsin || IS_JUMP(flag) ) {
             draw_segs(vwk, output_vertices, ptsbuf, FILL);
-            bez_qual = vwk->bez_qual;
             i0 = i;
             ptsget0 = ptsget;
             ptsput = ptsbuf;
@@ -597,7 +673,7 @@ v_bez_control(Vwk * vwk)
  * lower quality bezier curve has fewer longer straight line segments.
  * Higher quality bezier curves thus appear smoother, but are slower.
  *
- * note: bez_qual > 7 will cause overflow in gen_segs()
+ * note: bez_qual is at most 7, see bez_tolerance()
  */
 #define MIN_QUAL 0
 static const WORD pcarr[] = {0, 10, 23, 39, 55, 71, 86, 100};
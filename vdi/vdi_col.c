@@ -462,6 +462,15 @@ static void query_tt_color(WORD colnum,WORD *retval)
 #endif
 
 
+#if CONF_WITH_VDI_16BIT
+/*
+ * the pixel value for each hardware palette register in 16-bit mode,
+ * where the hardware palette is not used
+ */
+UWORD truecolor_palette[256];
+#endif
+
+
 #if CONF_WITH_VIDEL
 /* Create videl colour value from VDI colour */
 static LONG vdi2videl(WORD col)
@@ -529,6 +538,29 @@ static WORD adjust_mono_values(WORD colnum,WORD *rgb)
 }
 
 
+#if CONF_WITH_VIDEL
+/* Convert a VDI colour to the videl value for hardware register hwreg
+ *
+ * Also updates the 16-bit mode palette
+ */
+static LONG videl_color(WORD hwreg, const WORD *rgb)
+{
+    WORD r = rgb[0], g = rgb[1], b = rgb[2];
+
+#if CONF_WITH_VDI_16BIT
+    /* RRRRRGGGGGGBBBBB */
+    truecolor_palette[hwreg] = (divu((ULONG)r*31+500, 1000) << 11)
+                             | (divu((ULONG)g*63+500, 1000) << 5)
+                             | divu((ULONG)b*31+500, 1000);
+#else
+    UNUSED(hwreg);
+#endif
+
+    return (vdi2videl(r) << 16) | (vdi2videl(g) << 8) | vdi2videl(b);
+}
+#endif
+
+
 /* Set an entry in the hardware color palette
  *
  * Input is VDI-style: colnum is VDI pen#, rgb[] entries are 0-1000
@@ -541,21 +573,20 @@ static void set_color(WORD colnum, WORD *rgb)
     /* get hardware register, clamped according to number of planes */
     hwreg = MAP_COL[colnum] & (numcolors-1);
 
-    r = rgb[0];
-    g = rgb[1];
-    b = rgb[2];
-
 #if CONF_WITH_VIDEL
     if (has_videl)
     {
-        LONG videlrgb;
+        LONG videlrgb = videl_color(hwreg, rgb);
 
-        videlrgb = (vdi2videl(r) << 16) | (vdi2videl(g) << 8) | vdi2videl(b);
         VsetRGB(hwreg,1,(LONG)&videlrgb);
         return;
     }
 #endif
 
+    r = rgb[0];
+    g = rgb[1];
+    b = rgb[2];
+
 #if CONF_WITH_TT_SHIFTER
     if (has_tt_shifter)
     {
@@ -594,21 +625,12 @@ static void set_color(WORD colnum, WORD *rgb)
 
 
 /*
- * vdi_vs_color - set color index table
+ * store the requested RGB values for a (valid) VDI pen, and return them
+ * in rgb[], clamped to 0-1000, ready for set_color()
  */
-void vdi_vs_color(Vwk *vwk)
+static void store_req_color(WORD colnum, const WORD *intin, WORD *rgb)
 {
-    WORD colnum, i;
-    WORD *intin, rgb[3], *rgbptr;
-
-    colnum = INTIN[0];
-
-    /* Check for valid color index */
-    if (colnum < 0 || colnum >= numcolors)
-    {
-        /* It was out of range */
-        return;
-    }
+    WORD i, *rgbptr;
 
 #if CONF_WITH_TT_SHIFTER
     if (has_tt_shifter)
@@ -619,7 +641,7 @@ void vdi_vs_color(Vwk *vwk)
      * Copy raw values to the "requested colour" arrays, then clamp
      * them to 0-1000 before calling set_color()
      */
-    for (i = 0, intin = INTIN+1, rgbptr = rgb; i < 3; i++, intin++, rgbptr++)
+    for (i = 0, rgbptr = rgb; i < 3; i++, intin++, rgbptr++)
     {
         if (colnum < 16)
             REQ_COL[colnum][i] = *intin;
@@ -633,12 +655,101 @@ void vdi_vs_color(Vwk *vwk)
             *rgbptr = 0;
         else *rgbptr = *intin;
     }
+}
+
 
-    colnum = INTIN[0];      /* may have been munged on TT system, see above */
+/*
+ * vdi_vs_color - set color index table
+ */
+void vdi_vs_color(Vwk *vwk)
+{
+    WORD colnum;
+    WORD rgb[3];
+
+    colnum = INTIN[0];
+
+    /* Check for valid color index */
+    if (colnum < 0 || colnum >= numcolors)
+    {
+        /* It was out of range */
+        return;
+    }
+
+    store_req_color(colnum, INTIN+1, rgb);
     set_color(colnum, rgb);
 }
 
 
+#if CONF_WITH_VDI_SETCOLORS
+/*
+ * vdi_vs_colors - set a range of pens (EmuTOS-specific escape)
+ *
+ * input:
+ *     CONTRL[5] = V_SETCOLORS_ESC
+ *     INTIN[0] = first VDI pen
+ *     INTIN[1] = number of pens
+ *     INTIN[2-...] = RGB values (0-1000) for each pen, as for vs_color()
+ * output:
+ *     CONTRL[4] = 1
+ *     INTOUT[0] = number of pens set
+ *
+ * On a Falcon, consecutive hardware registers are passed to a single
+ * VsetRGB() call, which updates the shadow palette; the VBL then loads
+ * the hardware registers all at once.
+ */
+#define SETCOLORS_BATCH 16      /* max hardware registers per VsetRGB() */
+
+void vdi_vs_colors(Vwk *vwk)
+{
+    WORD first, count, i;
+    WORD rgb[3];
+    const WORD *intin = INTIN + 2;
+#if CONF_WITH_VIDEL
+    LONG videlrgb[SETCOLORS_BATCH];
+    WORD hwreg, start = 0, n = 0;
+#endif
+
+    first = INTIN[0];
+    count = INTIN[1];
+    if ((first < 0) || (first >= numcolors) || (count < 0))
+        count = 0;
+    else if (count > numcolors - first)
+        count = numcolors - first;
+
+    for (i = 0; i < count; i++, intin += 3)
+    {
+        store_req_color(first+i, intin, rgb);
+
+#if CONF_WITH_VIDEL
+        if (has_videl)
+        {
+            hwreg = MAP_COL[first+i] & (numcolors-1);
+            if (n && ((hwreg != start+n) || (n == SETCOLORS_BATCH)))
+            {
+                VsetRGB(start, n, (LONG)videlrgb);
+                n = 0;
+            }
+            if (n == 0)
+                start = hwreg;
+            videlrgb[n++] = videl_color(hwreg, rgb);
+            continue;
+        }
+#endif
+
+        set_color(first+i, rgb);
+    }
+
+#if CONF_WITH_VIDEL
+    if (n)
+        VsetRGB(start, n, (LONG)videlrgb);
+#endif
+
+    CONTRL[4] = 1;
+    INTOUT[0] = count;
+}
+#endif
+
+
 /* Set the default palette etc. */
 void init_colors(void)
 {
@@ -20,6 +20,7 @@
 #include "intmath.h"
 #include "bdosbind.h"
 #include "tosvars.h"
+#include "has.h"        /* for blitter-related items */
 
 #define FIRST_VDI_HANDLE    1
 #define LAST_VDI_HANDLE     (FIRST_VDI_HANDLE+NUM_VDI_HANDLES-1)
@@ -32,6 +33,14 @@
  */
 #define MX_SUPER            (3<<4)
 
+#if CONF_WITH_VDI_BITMAP
+/*
+ * Mxalloc() mode used when allocating an off-screen bitmap: the bitmap
+ * must be accessible by the application too
+ */
+#define MX_GLOBAL           (2<<4)
+#endif
+
 
 /*
  * ptr to current mouse cursor save area, based on v_planes
@@ -389,6 +398,169 @@ static void build_vwk_chain(void)
 
 
 
+#if CONF_WITH_VDI_BITMAP
+/*
+ * screen values saved by bitmap_select() and restored by bitmap_deselect()
+ */
+static struct {
+    UBYTE *v_bas_ad;
+    WORD v_lin_wr;
+    UWORD bytes_lin;
+    UWORD rez_hz;
+    UWORD rez_vt;
+    WORD max_x;
+    WORD max_y;
+#if CONF_WITH_BLITTER
+    int blitter;
+#endif
+} screen_save;
+
+/*
+ * bitmap_select - make the VDI draw on the bitmap of an off-screen
+ * bitmap workstation rather than on the screen
+ *
+ * this must always be followed by a call to bitmap_deselect().  in
+ * between, the mouse cursor is not updated by the VBL routine, since
+ * it uses the same variables to locate the screen.
+ */
+void bitmap_select(const Vwk *vwk)
+{
+    mouse_flag += 1;
+
+    screen_save.v_bas_ad = v_bas_ad;
+    screen_save.v_lin_wr = v_lin_wr;
+    screen_save.bytes_lin = BYTES_LIN;
+    screen_save.rez_hz = V_REZ_HZ;
+    screen_save.rez_vt = V_REZ_VT;
+    screen_save.max_x = xres;
+    screen_save.max_y = yres;
+
+    v_bas_ad = vwk->bm_addr;
+    BYTES_LIN = v_lin_wr = vwk->bm_lin_wr;
+    V_REZ_HZ = vwk->bm_width;
+    V_REZ_VT = vwk->bm_height;
+    xres = vwk->bm_width - 1;
+    yres = vwk->bm_height - 1;
+
+#if CONF_WITH_BLITTER
+    /* the blitter can only access ST-RAM */
+    screen_save.blitter = blitter_is_enabled;
+    if (vwk->bm_addr >= phystop)
+        blitter_is_enabled = FALSE;
+#endif
+}
+
+/*
+ * bitmap_deselect - make the VDI draw on the screen again
+ */
+void bitmap_deselect(void)
+{
+    v_bas_ad = screen_save.v_bas_ad;
+    v_lin_wr = screen_save.v_lin_wr;
+    BYTES_LIN = screen_save.bytes_lin;
+    V_REZ_HZ = screen_save.rez_hz;
+    V_REZ_VT = screen_save.rez_vt;
+    xres = screen_save.max_x;
+    yres = screen_save.max_y;
+
+#if CONF_WITH_BLITTER
+    blitter_is_enabled = screen_save.blitter;
+#endif
+
+    mouse_flag -= 1;
+}
+
+/*
+ * open_bitmap - set up the bitmap for v_open_bm()
+ *
+ * input:
+ *     CONTRL[7-8] = address of MFDB; if fd_addr is NULL, the VDI allocates
+ *                   and clears the bitmap, and fills in the MFDB
+ *     INTIN[11] = width of bitmap - 1 (if allocated by the VDI)
+ *     INTIN[12] = height of bitmap - 1 (if allocated by the VDI)
+ *
+ * only bitmaps in the device-specific format of the screen are supported.
+ * returns FALSE if the bitmap is invalid or cannot be allocated.
+ */
+static BOOL open_bitmap(Vwk *vwk)
+{
+    MFDB *mfdb = *(MFDB **)&CONTRL[7];
+    WORD width, height, wdwidth;
+    ULONG size;
+    UBYTE *addr;
+
+    if ((mfdb->fd_nplanes != 0) && (mfdb->fd_nplanes != v_planes))
+        return FALSE;
+
+    if (mfdb->fd_addr)
+    {
+        if (mfdb->fd_stand)
+            return FALSE;
+        width = mfdb->fd_w;
+        height = mfdb->fd_h;
+        wdwidth = mfdb->fd_wdwidth;
+    }
+    else
+    {
+        width = INTIN[11] + 1;
+        height = INTIN[12] + 1;
+        wdwidth = (width + 15) >> 4;
+    }
+
+    if ((width <= 0) || (height <= 0) || (wdwidth < ((width + 15) >> 4)))
+        return FALSE;
+
+    vwk->bm_width = width;
+    vwk->bm_height = height;
+    vwk->bm_lin_wr = wdwidth * v_planes * sizeof(WORD);
+    vwk->bm_allocated = FALSE;
+
+    if (mfdb->fd_addr)
+    {
+        vwk->bm_addr = mfdb->fd_addr;
+        return TRUE;
+    }
+
+    size = (ULONG)vwk->bm_lin_wr * height;
+    addr = (UBYTE *)Mxalloc(size, MX_STRAM | MX_GLOBAL);
+    if (!addr)
+        return FALSE;
+    bzero(addr, size);
+
+    vwk->bm_addr = addr;
+    vwk->bm_allocated = TRUE;
+
+    mfdb->fd_addr = addr;
+    mfdb->fd_w = width;
+    mfdb->fd_h = height;
+    mfdb->fd_wdwidth = wdwidth;
+    mfdb->fd_stand = 0;
+    mfdb->fd_nplanes = v_planes;
+
+    return TRUE;
+}
+
+/*
+ * free_vwk - free a virtual workstation, and any bitmap allocated for it
+ */
+static void free_vwk(Vwk *vwk)
+{
+    if (vwk->bm_allocated)
+        Mfree(vwk->bm_addr);
+    Mfree(vwk);
+}
+#else
+#define free_vwk(vwk)   Mfree(vwk)
+#endif
+
+
+
+/*
+ * vdi_v_opnvwk - open virtual workstation
+ *
+ * if CONTRL[5] is 1, this is v_open_bm(), which opens an off-screen
+ * bitmap workstation (see open_bitmap() above)
+ */
 void vdi_v_opnvwk(Vwk * vwk)
 {
     WORD handle;
@@ -425,9 +597,34 @@ void vdi_v_opnvwk(Vwk * vwk)
         return;
     }
 
-    vwk_ptr[handle] = vwk;
-    vwk->handle = CONTRL[6] = handle;
-    init_wk(vwk);
+#if CONF_WITH_VDI_PROFILE
+    vwk->prof_calls = vwk->prof_ticks = 0UL;
+#endif
+
+#if CONF_WITH_VDI_BITMAP
+    vwk->bm_addr = NULL;
+    vwk->bm_allocated = FALSE;
+    if (CONTRL[5] == 1)
+    {
+        if (!open_bitmap(vwk))
+        {
+            Mfree(vwk);
+            CONTRL[6] = 0;
+            return;
+        }
+        vwk_ptr[handle] = vwk;
+        vwk->handle = CONTRL[6] = handle;
+        bitmap_select(vwk);     /* so that init_wk() returns the bitmap size */
+        init_wk(vwk);
+        bitmap_deselect();
+    }
+    else
+#endif
+    {
+        vwk_ptr[handle] = vwk;
+        vwk->handle = CONTRL[6] = handle;
+        init_wk(vwk);
+    }
     build_vwk_chain();
     CUR_WORK = vwk;
 }
@@ -460,7 +657,7 @@ void vdi_v_clsvwk(Vwk * vwk)
      */
     CUR_WORK = &phys_work;
 
-    Mfree(vwk);
+    free_vwk(vwk);
 }
 
 
@@ -511,8 +708,19 @@ void vdi_v_opnwk(Vwk * vwk)
     /* update resolution-dependent values */
     update_rez_dependent();
 
+#if CONF_WITH_BLITTER
+    hwblit_init();
+#endif
+
     /* initialize the vwk pointer array */
     vwk = &phys_work;
+#if CONF_WITH_VDI_BITMAP
+    vwk->bm_addr = NULL;
+    vwk->bm_allocated = FALSE;
+#endif
+#if CONF_WITH_VDI_PROFILE
+    vwk->prof_calls = vwk->prof_ticks = 0UL;
+#endif
     vwk_ptr[VDI_PHYS_HANDLE] = vwk;
     CONTRL[6] = vwk->handle = VDI_PHYS_HANDLE;
     for (i = VDI_PHYS_HANDLE+1, p = vwk_ptr+i; i <= LAST_VDI_HANDLE; i++)
@@ -545,7 +753,7 @@ void vdi_v_clswk(Vwk * vwk)
     /* close all open virtual workstations */
     for (handle = VDI_PHYS_HANDLE+1, p = vwk_ptr+handle; handle <= LAST_VDI_HANDLE; handle++, p++) {
         if (*p) {
-            Mfree(*p);
+            free_vwk(*p);
             *p = NULL;
         }
     }
@@ -576,6 +784,100 @@ void vdi_v_clrwk(Vwk * vwk)
 
 
 
+#if CONF_WITH_VDI_SCRNINFO
+/*
+ * vq_scrninfo - describe the screen bitmap (NVDI extension of vq_extnd)
+ *
+ * input:
+ *     CONTRL[5] = 1
+ *     INTIN[0] = 2
+ * output:
+ *     CONTRL[2] = 0
+ *     CONTRL[4] = 272
+ *     INTOUT[0] = format: 0 = interleaved planes, 2 = packed pixels
+ *     INTOUT[1] = 1 = hardware CLUT, 2 = software CLUT (truecolour)
+ *     INTOUT[2] = bits per pixel
+ *     INTOUT[3-4] = number of colours
+ *     INTOUT[5] = bytes per line
+ *     INTOUT[6-7] = address of the bitmap
+ *     INTOUT[8-13] = number of bits for red, green, blue, alpha,
+ *                    genlock, and unused bits
+ *     INTOUT[14] = bit order: 1 = usual
+ *     INTOUT[16-271] = with a hardware CLUT, the pixel value of each pen;
+ *                      in truecolour, the numbers of the bits for red
+ *                      [16-31], green [32-47], blue [48-63], alpha,
+ *                      genlock and unused bits, lowest first (-1 = none)
+ *
+ * The bitmap is the one the VDI draws in: on the Amiga, that is the
+ * Atari format screen that the VBL converts for display.
+ */
+static void vq_scrninfo(void)
+{
+    WORD *out = INTOUT;
+    ULONG colours;
+    WORD i;
+
+    CONTRL[2] = 0;
+    CONTRL[4] = 272;
+
+    for (i = 0; i < 272; i++)
+        out[i] = 0;
+
+#if CONF_WITH_VDI_16BIT
+    if (TRUECOLOR_MODE)
+    {
+        colours = 65536UL;
+        out[0] = 2;
+        out[1] = 2;
+        out[8] = 5;         /* RRRRRGGGGGGBBBBB */
+        out[9] = 6;
+        out[10] = 5;
+        for (i = 16; i < 272; i++)
+            out[i] = -1;
+        for (i = 0; i < 5; i++)
+        {
+            out[16+i] = 11 + i;
+            out[48+i] = i;
+        }
+        for (i = 0; i < 6; i++)
+            out[32+i] = 5 + i;
+    }
+    else
+#endif
+    {
+        colours = 1UL << v_planes;
+        out[0] = 0;
+        out[1] = 1;
+        switch(DEV_TAB[39]) {   /* number of colours in the palette */
+        case 0:                 /* more than 32767 */
+            i = 6;
+            break;
+        case 4096:
+            i = 4;
+            break;
+        case 512:
+            i = 3;
+            break;
+        default:
+            i = 0;
+        }
+        out[8] = out[9] = out[10] = i;
+        for (i = 0; i < numcolors; i++)
+            out[16+i] = MAP_COL[i] & (numcolors-1);
+    }
+
+    out[2] = v_planes;
+    out[3] = HIWORD(colours);
+    out[4] = LOWORD(colours);
+    out[5] = v_lin_wr;
+    out[6] = HIWORD((ULONG)v_bas_ad);
+    out[7] = LOWORD((ULONG)v_bas_ad);
+    out[14] = 1;
+}
+#endif
+
+
+
 /*
  * vdi_vq_extnd - Extended workstation inquire
  */
@@ -584,6 +886,13 @@ void vdi_vq_extnd(Vwk * vwk)
     WORD i;
     WORD *dst, *src;
 
+#if CONF_WITH_VDI_SCRNINFO
+    if ((CONTRL[5] == 1) && (INTIN[0] == 2)) {
+        vq_scrninfo();
+        return;
+    }
+#endif
+
     flip_y = 1;
     dst = PTSOUT;
     if (*(INTIN) == 0) {
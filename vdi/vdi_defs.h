@@ -32,8 +32,63 @@
  */
 #define V_OPNWK_OP      1
 #define V_CLSWK_OP      2
+#define V_ESCAPE_OP     5
 #define V_OPNVWK_OP     100
 #define V_CLSVWK_OP     101
+#define VSC_FORM_OP     111
+#define V_SHOW_C_OP     122
+#define V_HIDE_C_OP     123
+#define VQ_MOUSE_OP     124
+
+#if CONF_WITH_VDI_BATCH
+/*
+ * EmuTOS-specific escape to execute a list of VDI calls ("ET", so that
+ * it's well clear of the escapes used by Atari and GDOS drivers)
+ */
+#define V_BATCH_ESC     0x4554
+
+/* one entry in the list passed to the batch escape */
+typedef struct {
+    WORD *contrl;
+    WORD *intin;
+    WORD *ptsin;
+    WORD *intout;
+    WORD *ptsout;
+} VDI_BATCH_PB;
+#endif
+
+#if CONF_WITH_VDI_PROFILE
+/*
+ * EmuTOS-specific escape to read the VDI profiling counters ("EP")
+ */
+#define V_PROFILE_ESC   0x4550
+#endif
+
+#if CONF_WITH_VDI_SETCOLORS
+/*
+ * EmuTOS-specific escape to set a range of pens with one call ("EC")
+ */
+#define V_SETCOLORS_ESC 0x4543
+#endif
+
+#if CONF_WITH_VDI_SCRNINFO
+/*
+ * EmuTOS-specific escape to lock/unlock the screen for direct drawing ("EL")
+ */
+#define V_LOCKSCREEN_ESC 0x454c
+#endif
+
+
+/*
+ * in the Falcon 16-bit video mode, each pixel is a word containing an
+ * RGB565 value rather than a hardware palette register number
+ */
+#if CONF_WITH_VDI_16BIT
+#define TRUECOLOR_MODE  (v_planes > 8)
+extern UWORD truecolor_palette[256];    /* pixel values for each pen */
+#else
+#define TRUECOLOR_MODE  0
+#endif
 
 
 /*
@@ -133,6 +188,9 @@ typedef struct {
     const UWORD *patptr;        /* Current pattern pointer */
     WORD wrt_mode;              /* Current writing mode    */
     UWORD color;                /* fill color */
+#if CONF_WITH_VDI_FILL_EXPAND
+    const UWORD *patexp;        /* expanded pattern (see Vwk), or NULL */
+#endif
 } VwkAttrib;
 
 
@@ -204,6 +262,29 @@ struct Vwk_ {
 #if HAVE_BEZIER
     WORD bez_qual;              /* actual quality for bezier curves */
 #endif
+#if CONF_WITH_VDI_BITMAP
+    UBYTE *bm_addr;             /* off-screen bitmap, or NULL for the screen */
+    WORD bm_width;              /* width of bitmap in pixels */
+    WORD bm_height;             /* height of bitmap in pixels */
+    WORD bm_lin_wr;             /* width of bitmap line in bytes */
+    BOOL bm_allocated;          /* TRUE if the bitmap was allocated by the VDI */
+#endif
+#if CONF_WITH_VDI_PROFILE
+    ULONG prof_calls;           /* number of VDI calls for this workstation */
+    ULONG prof_ticks;           /* 200Hz ticks spent in those calls */
+#endif
+#if CONF_WITH_VDI_FILL_EXPAND
+    /*
+     * the fill pattern in the fill colour, as the word to store in each
+     * plane for each of 16 pattern lines, valid for the values below
+     */
+    const UWORD *exp_patptr;
+    UWORD exp_patmsk;
+    WORD exp_multifill;
+    WORD exp_color;
+    WORD exp_planes;            /* 0 => not valid */
+    UWORD fill_exp[16*8];
+#endif
 };
 
 /*
@@ -225,6 +306,19 @@ typedef struct {
     WORD x2,y2;
 } Line;
 
+/* Raster definitions */
+typedef struct {
+    void *fd_addr;
+    WORD fd_w;
+    WORD fd_h;
+    WORD fd_wdwidth;
+    WORD fd_stand;
+    WORD fd_nplanes;
+    WORD fd_r1;
+    WORD fd_r2;
+    WORD fd_r3;
+} MFDB;
+
 
 /* External definitions for internal use */
 extern WORD flip_y;             /* True if magnitudes being returned */
@@ -270,15 +364,34 @@ extern UBYTE    cur_ms_stat;    /* current mouse status */
 
 
 BOOL clip_line(Vwk *vwk, Line *line);
+BOOL points_clipped(const Vwk *vwk, const Point *point, int count, WORD margin);
+
+/*
+ * rect_clipped - returns TRUE iff clipping is on and the rectangle
+ *                (x1,y1)-(x2,y2) lies entirely outside the clipping
+ *                rectangle.  the rectangle must be ordered (x1<=x2, y1<=y2).
+ */
+static __inline__ BOOL rect_clipped(const Vwk *vwk, WORD x1, WORD y1, WORD x2, WORD y2)
+{
+    return vwk->clip && ((x2 < vwk->xmn_clip) || (x1 > vwk->xmx_clip)
+                         || (y2 < vwk->ymn_clip) || (y1 > vwk->ymx_clip));
+}
 void arb_corner(Rect *rect);
 void arb_line(Line *line);
 
 
 /* C Support routines */
 Vwk *get_vwk_by_handle(WORD);
+#if CONF_WITH_VDI_BITMAP
+void bitmap_select(const Vwk *vwk);
+void bitmap_deselect(void);
+#endif
 UWORD *get_start_addr(const WORD x, const WORD y);
 void set_LN_MASK(Vwk *vwk);
 void st_fl_ptr(Vwk *);
+#if CONF_WITH_VDI_FILL_EXPAND
+void st_fl_exp(Vwk *);
+#endif
 void gdp_justified(Vwk *);
 WORD validate_color_index(WORD colnum);
 
@@ -296,6 +409,21 @@ void draw_rect_common(const VwkAttrib *attr, const Rect *rect);
 void clc_flit(const VwkAttrib *attr, const VwkClip *clipper, const Point *point, WORD vectors, WORD start, WORD end);
 void abline (const Line *line, const WORD wrt_mode, UWORD color);
 void contourfill(const VwkAttrib *attr, const VwkClip *clip);
+#if CONF_WITH_VDI_MARKER_STAMPS
+void draw_stamp(const VwkClip *clipper, UWORD *form, WORD wdwidth,
+                WORD x, WORD y, WORD w, WORD h, UWORD color);
+#endif
+
+#if CONF_WITH_BLITTER
+/* hardware blitter control, in vdi_line.c */
+void hwblit_start(UBYTE status);
+void hwblit_wait(void);
+void hwblit_sync(void);
+void hwblit_end(void *addr, LONG length);
+void hwblit_defer(BOOL defer);
+void hwblit_init(void);
+BOOL hwblit_wanted(UWORD width, UWORD height, UWORD planes);
+#endif
 
 /* initialization of subsystems */
 void init_colors(void);
@@ -316,6 +444,18 @@ void vdi_v_clswk(Vwk *);            /* 2 */
 void vdi_v_clrwk(Vwk *);            /* 3 */
 /* void v_updwk(Vwk *); */          /* 4 - not implemented */
 void vdi_v_escape(Vwk *);           /* 5 */
+#if CONF_WITH_VDI_BATCH
+void vdi_v_batch(Vwk *);            /* 5, subfunction V_BATCH_ESC */
+#endif
+#if CONF_WITH_VDI_PROFILE
+void vdi_v_profile(Vwk *);          /* 5, subfunction V_PROFILE_ESC */
+#endif
+#if CONF_WITH_VDI_SETCOLORS
+void vdi_vs_colors(Vwk *);          /* 5, subfunction V_SETCOLORS_ESC */
+#endif
+#if CONF_WITH_VDI_SCRNINFO
+void vdi_v_lockscreen(Vwk *);       /* 5, subfunction V_LOCKSCREEN_ESC */
+#endif
 
 void vdi_v_pline(Vwk *);            /* 6 */
 void vdi_v_pmarker(Vwk *);          /* 7 */
@@ -405,6 +545,10 @@ void vdi_vex_wheelv(Vwk *);         /* 134 */
 void direct_screen_blit(WORD count, WORD *str);
 #endif
 
+#if CONF_WITH_VDI_GLYPH_CACHE
+void glyph_cache_flush(void);
+#endif
+
 #if HAVE_BEZIER
 /* not in original TOS */
 void v_bez_qual(Vwk *);
@@ -344,6 +344,34 @@ void vdi_v_escape(Vwk * vwk)
     }
 #endif
 
+#if CONF_WITH_VDI_BATCH
+    if (escfun == V_BATCH_ESC) {
+        vdi_v_batch(vwk);       /* execute a list of VDI calls */
+        return;
+    }
+#endif
+
+#if CONF_WITH_VDI_PROFILE
+    if (escfun == V_PROFILE_ESC) {
+        vdi_v_profile(vwk);     /* read the profiling counters */
+        return;
+    }
+#endif
+
+#if CONF_WITH_VDI_SETCOLORS
+    if (escfun == V_SETCOLORS_ESC) {
+        vdi_vs_colors(vwk);     /* set a range of pens */
+        return;
+    }
+#endif
+
+#if CONF_WITH_VDI_SCRNINFO
+    if (escfun == V_LOCKSCREEN_ESC) {
+        vdi_v_lockscreen(vwk);  /* lock/unlock the screen for direct drawing */
+        return;
+    }
+#endif
+
     if (escfun > ldri_escape)
         return;
     (*esctbl[escfun])(vwk);
@@ -19,6 +19,8 @@
 #include "vdistub.h"
 #include "tosvars.h"
 #include "lineavars.h"
+#include "gemdos.h"
+#include "string.h"
 
 
 /* special values used in y member of SEGMENT */
@@ -31,10 +33,16 @@ static UWORD search_color;      /* selected colour for contourfill() */
 static BOOL seed_type;          /* 1 => fill until selected colour is NOT found */
                                 /* 0 => fill until selected colour is found */
 
-/* the following point to segments within vdishare.queue[] (see below) */
+/*
+ * the following point to segments within the queue.  this is initially
+ * vdishare.queue[] (see below), and is moved to a larger Malloc()'d
+ * area if it overflows.
+ */
 static SEGMENT *qbottom;        /* the bottom of the queue      */
 static SEGMENT *qtop;           /* the last segment in use +1   */
 static SEGMENT *qptr;           /* points to the active point   */
+static SEGMENT *qlimit;         /* the end of the queue area    */
+static SEGMENT *qalloc;         /* Malloc()'d queue, or NULL    */
 
 /*
  * a shared area for the VDI
@@ -164,6 +172,10 @@ void vdi_vsf_udpat(Vwk * vwk)
     dp = &vwk->ud_patrn[0];
     for (i = 0; i < count; i++)
         *dp++ = *sp++;
+
+#if CONF_WITH_VDI_FILL_EXPAND
+    st_fl_exp(vwk);
+#endif
 }
 
 
@@ -212,6 +224,9 @@ void vdi_vsf_color(Vwk * vwk)
 
     INTOUT[0] = fc;
     vwk->fill_color = MAP_COL[fc];
+#if CONF_WITH_VDI_FILL_EXPAND
+    st_fl_exp(vwk);
+#endif
 }
 
 
@@ -378,10 +393,267 @@ st_fl_ptr(Vwk * vwk)
     }
     vwk->patptr = (UWORD *)pp;
     vwk->patmsk = pm;
+#if CONF_WITH_VDI_FILL_EXPAND
+    st_fl_exp(vwk);
+#endif
+}
+
+
+#if CONF_WITH_VDI_FILL_EXPAND
+/*
+ * st_fl_exp - expand the fill pattern in the fill colour
+ *
+ * for each of the 16 pattern lines, this sets the word to be stored in
+ * each plane by replace mode fills, so that they do not need to look at
+ * the fill colour & the multi-plane pattern flag for each plane of each
+ * line.  it must be called whenever these change.
+ */
+void st_fl_exp(Vwk * vwk)
+{
+    const int vplanes = v_planes;
+    UWORD *exp = vwk->fill_exp;
+    WORD y, plane, patind;
+    UWORD color;
+
+    vwk->exp_planes = 0;
+    if (vplanes > 8)            /* not interleaved planes */
+        return;
+
+    for (y = 0; y < 16; y++) {
+        patind = vwk->patmsk & y;
+        for (plane = 0, color = vwk->fill_color; plane < vplanes; plane++, color >>= 1) {
+            *exp++ = (color & 0x0001) ? vwk->patptr[patind] : 0x0000;
+            if (vwk->multifill)
+                patind += 16;
+        }
+    }
+
+    vwk->exp_patptr = vwk->patptr;
+    vwk->exp_patmsk = vwk->patmsk;
+    vwk->exp_multifill = vwk->multifill;
+    vwk->exp_color = vwk->fill_color;
+    vwk->exp_planes = vplanes;
 }
+#endif
 
 
 
+/*
+ * fill_span - draw one horizontal span of a filled polygon
+ *
+ * Testing under Atari TOS shows that the fill area always *includes*
+ * the left & right perimeter (for those functions that allow the
+ * perimeter to be drawn separately, it is drawn on top of the edge
+ * pixels).  We now conform to Atari TOS.
+ */
+static void fill_span(const VwkAttrib *attr, const VwkClip *clipper, WORD x1, WORD x2, WORD y)
+{
+    Rect rect;
+
+    /* handle clipping */
+    if (attr->clip) {
+        if (x1 < clipper->xmn_clip) {
+            if (x2 < clipper->xmn_clip)
+                return;             /* entire segment clipped left */
+            x1 = clipper->xmn_clip; /* clip left end of line */
+        }
+
+        if (x2 > clipper->xmx_clip) {
+            if (x1 > clipper->xmx_clip)
+                return;             /* entire segment clipped right */
+            x2 = clipper->xmx_clip; /* clip right end of line */
+        }
+    }
+    rect.x1 = x1;
+    rect.y1 = y;
+    rect.x2 = x2;
+    rect.y2 = y;
+
+    /* rectangle fill routine draws horizontal line */
+    draw_rect_common(attr, &rect);
+}
+
+
+
+#if CONF_WITH_VDI_EDGE_TABLE
+
+/*
+ * sort_edges - sort the edge table into descending order of ytop
+ *
+ * This is a Shell sort: the edges of typical polygons (ellipses, rounded
+ * boxes, etc) are mostly in order already, and we avoid recursion.
+ */
+static void sort_edges(FILLEDGE *edge, WORD count)
+{
+    WORD gap, i, j;
+    FILLEDGE tmp;
+
+    for (gap = count / 2; gap > 0; gap /= 2) {
+        for (i = gap; i < count; i++) {
+            tmp = edge[i];
+            for (j = i; (j >= gap) && (edge[j-gap].ytop < tmp.ytop); j -= gap)
+                edge[j] = edge[j-gap];
+            edge[j] = tmp;
+        }
+    }
+}
+
+
+
+/*
+ * clc_flit - draw a filled polygon
+ *
+ * This is a scan line polygon fill using an active edge table:
+ *  - Build a table of the non-horizontal edges crossing the scan lines
+ *    to be drawn, sorted by their first scan line
+ *  - For each scan line:
+ *     - Move the edges starting on this scan line to the active edge
+ *       table, which is kept sorted left to right
+ *     - Draw pixels between each pair of active edges
+ *     - Remove the edges that end on this scan line, and step the others
+ *       to their intersection with the next scan line
+ *
+ * The intersection points are stepped incrementally but exactly, so the
+ * result is identical to computing them for each scan line.
+ *
+ * The scan lines drawn are from 'start' down to (but not including) 'end'.
+ */
+void clc_flit(const VwkAttrib *attr, const VwkClip *clipper, const Point *point, WORD vectors, WORD start, WORD end)
+{
+    FILLEDGE *edge = vdishare.main.fill_edges;
+    WORD *aet = vdishare.main.fill_buffer;  /* active edges (indexes into edge[]) */
+    WORD nedges, nactive, next;
+    WORD i, j, y;
+
+    if (vectors > MAX_VERTICES)
+        vectors = MAX_VERTICES;
+
+    /* build the edge table */
+    for (i = nedges = 0; i < vectors; i++) {
+        FILLEDGE *e = edge + nedges;
+        WORD x1, y1, x2, y2, yo, dx, k;
+
+        y1 = point[i].y;
+        y2 = point[i+1].y;
+
+        /* if the current vector is horizontal, ignore it. */
+        if (y1 == y2)
+            continue;
+
+        x1 = point[i].x;
+        x2 = point[i+1].x;
+
+        /*
+         * The edge crosses the scan lines from min(y1,y2) to max(y1,y2)-1
+         * inclusive, as in the original DRI sign test (see Newman and
+         * Sproull).  The intersection is measured from one endpoint
+         * exactly as the DRI code did, rounding to the nearest pixel.
+         */
+        dx = (x2 - x1) << 1;    /* so we can round by adding 1 below */
+        if (dx < 0) {
+            e->xo = x2;
+            yo = y2;
+            dx = -dx;
+        } else {
+            e->xo = x1;
+            yo = y1;
+        }
+        if (y1 < y2) {
+            e->ybot = y1;
+            e->ytop = y2 - 1;
+            e->b = y2 - y1;
+        } else {
+            e->ybot = y2;
+            e->ytop = y1 - 1;
+            e->b = y1 - y2;
+        }
+
+        /* restrict to the scan lines that we draw */
+        if (e->ytop > start)
+            e->ytop = start;
+        if (e->ybot <= end)
+            e->ybot = end + 1;
+        if (e->ybot > e->ytop)
+            continue;
+
+        e->away = (yo > e->ytop);
+        k = e->away ? (yo - e->ytop) : (e->ytop - yo);
+        e->q = mul_div(k, dx, e->b);
+        e->r = (LONG)k * dx - (LONG)e->q * e->b;  /* 0 <= r < b */
+        e->qstep = dx / e->b;
+        e->rstep = dx % e->b;
+        e->x = ((e->q + 1) >> 1) + e->xo;
+        nedges++;
+    }
+
+    sort_edges(edge, nedges);
+
+    nactive = next = 0;
+    for (y = start; y > end; y--) {
+        /* add the edges starting on this scan line, keeping them sorted */
+        while ((next < nedges) && (edge[next].ytop >= y)) {
+            WORD x = edge[next].x;
+
+            for (j = nactive++; (j > 0) && (edge[aet[j-1]].x > x); j--)
+                aet[j] = aet[j-1];
+            aet[j] = next++;
+        }
+
+        if ((nactive == 0) && (next >= nedges))
+            break;
+
+        /* draw each pair of intersections */
+        for (i = 1; i < nactive; i += 2)
+            fill_span(attr, clipper, edge[aet[i-1]].x, edge[aet[i]].x, y);
+
+        /*
+         * remove the edges ending on this scan line, and step the others
+         * to the next one
+         */
+        for (i = j = 0; i < nactive; i++) {
+            FILLEDGE *e = edge + aet[i];
+
+            if (e->ybot >= y)
+                continue;
+            if (e->away) {
+                if (e->r >= e->b - e->rstep) {
+                    e->r -= e->b - e->rstep;
+                    e->q += e->qstep + 1;
+                } else {
+                    e->r += e->rstep;
+                    e->q += e->qstep;
+                }
+            } else {
+                if (e->r < e->rstep) {
+                    e->r += e->b - e->rstep;
+                    e->q -= e->qstep + 1;
+                } else {
+                    e->r -= e->rstep;
+                    e->q -= e->qstep;
+                }
+            }
+            e->x = ((e->q + 1) >> 1) + e->xo;
+            aet[j++] = aet[i];
+        }
+        nactive = j;
+
+        /*
+         * edges may have crossed: restore the order (an insertion sort is
+         * cheap, since the table is almost always still in order)
+         */
+        for (i = 1; i < nactive; i++) {
+            WORD n = aet[i];
+            WORD x = edge[n].x;
+
+            for (j = i; (j > 0) && (edge[aet[j-1]].x > x); j--)
+                aet[j] = aet[j-1];
+            aet[j] = n;
+        }
+    }
+}
+
+#else
+
 /*
  * bub_sort - sorts an array of words
  *
@@ -508,50 +780,16 @@ void clc_flit(const VwkAttrib *attr, const VwkClip *clipper, const Point *point,
         bub_sort(vdishare.main.fill_buffer, intersections);
 
         /*
-         * Testing under Atari TOS shows that the fill area always *includes*
-         * the left & right perimeter (for those functions that allow the
-         * perimeter to be drawn separately, it is drawn on top of the edge
-         * pixels).  We now conform to Atari TOS.
-         */
-
-        /*
-         * Loop through points, calling draw_rect_common() for each pair
+         * Loop through points, calling fill_span() for each pair
          */
         bufptr = vdishare.main.fill_buffer;
-        i = intersections / 2;
-        while(i--) {
-            WORD x1, x2;
-            Rect rect;
-
-            /* grab a pair of endpoints */
-            x1 = *bufptr++;
-            x2 = *bufptr++;
-
-            /* handle clipping */
-            if (attr->clip) {
-                if (x1 < clipper->xmn_clip) {
-                    if (x2 < clipper->xmn_clip)
-                        continue;           /* entire segment clipped left */
-                    x1 = clipper->xmn_clip; /* clip left end of line */
-                }
-
-                if (x2 > clipper->xmx_clip) {
-                    if (x1 > clipper->xmx_clip)
-                        continue;           /* entire segment clipped right */
-                    x2 = clipper->xmx_clip; /* clip right end of line */
-                }
-            }
-            rect.x1 = x1;
-            rect.y1 = y;
-            rect.x2 = x2;
-            rect.y2 = y;
-
-            /* rectangle fill routine draws horizontal line */
-            draw_rect_common(attr, &rect);
-        }
+        for (i = intersections / 2; i > 0; i--, bufptr += 2)
+            fill_span(attr, clipper, bufptr[0], bufptr[1], y);
     }
 }
 
+#endif /* CONF_WITH_VDI_EDGE_TABLE */
+
 
 
 /*
@@ -561,16 +799,25 @@ void
 polygon(Vwk * vwk, Point * ptsin, int count)
 {
     WORD i, k;
-    WORD fill_maxy, fill_miny;
+    WORD fill_maxy, fill_miny, fill_maxx, fill_minx;
     Point * point, * ptsget, * ptsput;
     const VwkClip *clipper;
     VwkAttrib attr;
 
-    /* find out the total min and max y values */
+    /* find out the total min and max x & y values */
     point = ptsin;
+    fill_maxx = fill_minx = point->x;
     fill_maxy = fill_miny = point->y;
     for (i = count - 1; i > 0; i--) {
         point++;
+        k = point->x;
+
+        if (k < fill_minx)
+            fill_minx = k;
+        else
+            if (k > fill_maxx)
+                fill_maxx = k;
+
         k = point->y;
 
         if (k < fill_miny)
@@ -583,9 +830,8 @@ polygon(Vwk * vwk, Point * ptsin, int count)
     /* cast structure needed by clc_flit */
     clipper = VDI_CLIP(vwk);
     if (vwk->clip) {
-        if ((fill_maxy < clipper->ymn_clip)     /* polygon entirely before clip */
-         || (fill_miny > clipper->ymx_clip))    /* polygon entirely after clip */
-            return;
+        if (rect_clipped(vwk, fill_minx, fill_miny, fill_maxx, fill_maxy))
+            return;                             /* polygon entirely outside clip */
         if (fill_miny < clipper->ymn_clip)
             fill_miny = clipper->ymn_clip - 1;  /* polygon partial overlap */
         if (fill_maxy > clipper->ymx_clip)
@@ -602,7 +848,13 @@ polygon(Vwk * vwk, Point * ptsin, int count)
     Vwk2Attrib(vwk, &attr, vwk->fill_color);
 
     /* really draw it */
+#if CONF_WITH_BLITTER
+    hwblit_defer(TRUE);
+#endif
     clc_flit(&attr, clipper, ptsin, count, fill_maxy, fill_miny);
+#if CONF_WITH_BLITTER
+    hwblit_defer(FALSE);
+#endif
 
     if (vwk->fill_per == TRUE) {
         LN_MASK = 0xffff;
@@ -681,51 +933,105 @@ pixelread(const WORD x, const WORD y)
 
 
 
-static UWORD
-search_to_right (const VwkClip * clip, WORD x, UWORD mask, const UWORD search_col, UWORD * addr)
+/*
+ * match_mask - find the pixels of a given colour within a word
+ *
+ * input:   addr        ptr to the first plane of a group of interleaved words
+ *          color       colour to search for
+ *
+ * returns a mask with 1 bits for the pixels that are of the given colour
+ */
+static UWORD match_mask(const UWORD *addr, UWORD color)
 {
-    /* is x coord < x resolution ? */
-    while( x++ < clip->xmx_clip ) {
-        UWORD color;
-
-        /* need to jump over interleaved bit_plane? */
-        rorw1(mask);    /* rotate right */
-        if ( mask & 0x8000 )
-            addr += v_planes;
-
-        /* search, while pixel color != search color */
-        color = get_color(mask, addr);
-        if ( search_col != color ) {
-            break;
-        }
+    UWORD mask = 0xffff;
+    WORD plane;
 
+    for (plane = v_planes; plane > 0; plane--, color >>= 1) {
+        if (color & 1)
+            mask &= *addr++;
+        else
+            mask &= ~*addr++;
     }
 
-    return x - 1;       /* output x coord -1 to endxright. */
+    return mask;
 }
 
 
 
-static UWORD
-search_to_left (const VwkClip * clip, WORD x, UWORD mask, const UWORD search_col, UWORD * addr)
+/*
+ * search_to_right - find the right end of a run of pixels of a colour
+ *
+ * input:   clip        ptr to clipping rectangle
+ *          x           x coordinate of a pixel of colour search_col
+ *          search_col  colour of the run
+ *          addr        ptr to the first plane of the word containing x
+ *
+ * returns the rightmost x coordinate of the run, within the clipping
+ * rectangle.  the pixels are examined a whole word at a time.
+ */
+static WORD
+search_to_right (const VwkClip * clip, WORD x, const UWORD search_col, const UWORD * addr)
 {
-    /* Now, search to the left. */
-    while (x-- > clip->xmn_clip) {
-        UWORD color;
-
-        /* need to jump over interleaved bit_plane? */
-        rolw1(mask);    /* rotate left */
-        if ( mask & 0x0001 )
-            addr -= v_planes;
-
-        /* search, while pixel color != search color */
-        color = get_color(mask, addr);
-        if ( search_col != color )
-            break;
+    UWORD diff;
+
+    if (x >= clip->xmx_clip)
+        return x;
+
+    /* look at the pixels to the right of x in its own word first */
+    diff = ~match_mask(addr, search_col) & (0x7fff >> (x & 0x0f));
+    x &= ~0x0f;
+
+    while (!diff) {
+        x += 16;
+        if (x > clip->xmx_clip)
+            return clip->xmx_clip;
+        addr += v_planes;
+        diff = ~match_mask(addr, search_col);
+    }
 
+    /* the leftmost different pixel ends the run */
+    while (!(diff & 0x8000)) {
+        diff <<= 1;
+        x++;
     }
 
-    return x + 1;       /* output x coord + 1 to endxleft. */
+    return min(x - 1, clip->xmx_clip);
+}
+
+
+
+/*
+ * search_to_left - find the left end of a run of pixels of a colour
+ *
+ * as search_to_right(), but returns the leftmost x coordinate of the run
+ */
+static WORD
+search_to_left (const VwkClip * clip, WORD x, const UWORD search_col, const UWORD * addr)
+{
+    UWORD diff;
+
+    if (x <= clip->xmn_clip)
+        return x;
+
+    /* look at the pixels to the left of x in its own word first */
+    diff = ~match_mask(addr, search_col) & ~(0xffff >> (x & 0x0f));
+    x |= 0x0f;
+
+    while (!diff) {
+        x -= 16;
+        if (x < clip->xmn_clip)
+            return clip->xmn_clip;
+        addr -= v_planes;
+        diff = ~match_mask(addr, search_col);
+    }
+
+    /* the rightmost different pixel ends the run */
+    while (!(diff & 0x0001)) {
+        diff >>= 1;
+        x--;
+    }
+
+    return max(x + 1, clip->xmn_clip);
 }
 
 
@@ -757,13 +1063,12 @@ static WORD end_pts(const VwkClip *clip, WORD x, WORD y, WORD *xleftout, WORD *x
 
     /* convert x,y to start address and bit mask */
     addr = get_start_addr(x, y);
-    addr += v_planes;                   /* start at highest-order bit_plane */
     mask = 0x8000 >> (x & 0x000f);   /* fetch the pixel mask. */
 
     /* get search color and the left and right end */
-    color = get_color (mask, addr);
-    *xrightout = search_to_right (clip, x, mask, color, addr);
-    *xleftout = search_to_left (clip, x, mask, color, addr);
+    color = get_color (mask, addr + v_planes);
+    *xrightout = search_to_right (clip, x, color, addr);
+    *xleftout = search_to_left (clip, x, color, addr);
 
     /* see, if the whole found segment is of search color? */
     if ( color != search_color ) {
@@ -787,6 +1092,33 @@ static void crunch_queue(void)
 
 
 
+/*
+ * grow_queue - move the queue to a Malloc()'d area twice the size
+ *
+ * returns FALSE if there is not enough memory
+ */
+static BOOL grow_queue(void)
+{
+    LONG size = (qlimit - qbottom) * sizeof(SEGMENT);
+    SEGMENT *newq;
+
+    newq = dos_alloc_anyram(2 * size);
+    if (!newq)
+        return FALSE;
+
+    memcpy(newq, qbottom, size);
+    qtop = newq + (qtop - qbottom);
+    qptr = newq + (qptr - qbottom);
+    if (qalloc)
+        dos_free(qalloc);
+    qbottom = qalloc = newq;
+    qlimit = (SEGMENT *)((char *)newq + 2 * size);
+
+    return TRUE;
+}
+
+
+
 /*
  * get_seed - put seeds into Q, if (xin,yin) is not of search_color
  */
@@ -831,10 +1163,11 @@ static WORD get_seed(const VwkAttrib *attr, const VwkClip *clip,
          * there were no holes, so raise qtop if we can
          */
         if (qhole == NULL) {
-            if (++qtop > vdishare.queue+QSIZE) { /* can't raise qtop ... */
+            if ((qtop >= qlimit) && !grow_queue()) { /* can't raise qtop ... */
                 KDEBUG(("contourfill(): queue overflow\n"));
                 return -1;      /* error */
             }
+            qtmp = qtop++;
         } else
             qtmp = qhole;
 
@@ -849,14 +1182,15 @@ static WORD get_seed(const VwkAttrib *attr, const VwkClip *clip,
 
 
 
-/* common function for line-A linea_fill() and VDI d_countourfill() */
-void contourfill(const VwkAttrib * attr, const VwkClip *clip)
+/*
+ * fill_loop - fill the segments in the queue, and the segments that they
+ *             lead to, until the queue is empty
+ */
+static void fill_loop(const VwkAttrib * attr, const VwkClip *clip,
+                        WORD oldy, WORD oldxleft, WORD oldxright)
 {
     WORD newxleft;              /* ends of line at oldy +       */
     WORD newxright;             /* the current direction    */
-    WORD oldxleft;              /* left end of line at oldy     */
-    WORD oldxright;             /* right end                    */
-    WORD oldy;                  /* the previous scan line       */
     WORD xleft;                 /* temporary endpoints          */
     WORD xright;                /* */
     WORD direction;             /* is next scan line up or down */
@@ -864,48 +1198,6 @@ void contourfill(const VwkAttrib * attr, const VwkClip *clip)
                                 /* 0 => no seed was put in the Q */
                                 /* -1 => queue overflowed */
 
-    xleft = PTSIN[0];
-    oldy = PTSIN[1];
-
-    if (xleft < clip->xmn_clip || xleft > clip->xmx_clip ||
-        oldy < clip->ymn_clip  || oldy > clip->ymx_clip)
-        return;
-
-    search_color = INTIN[0];
-
-    if ((WORD)search_color < 0) {
-        search_color = pixelread(xleft,oldy);
-        seed_type = 1;
-    } else {
-        /* Range check the color and convert the index to a pixel value */
-        if (search_color >= numcolors)
-            return;
-
-        /*
-         * We mandate that white is all bits on.  Since this yields 15
-         * in rom, we must limit it to how many planes there really are.
-         * Anding with the mask is only necessary when the driver supports
-         * move than one resolution.
-         */
-        search_color =
-            (MAP_COL[search_color] & plane_mask[INQ_TAB[4] - 1]);
-        seed_type = 0;
-    }
-
-    /* check if anything to do */
-    if (!end_pts(clip, xleft, oldy, &oldxleft, &oldxright))
-        return;
-
-    /*
-     * from this point on we must NOT access PTSIN[], since the area
-     * is overwritten by the queue of seeds!
-     */
-    qptr = qbottom = vdishare.queue;
-    qptr->y = (oldy | DOWN_FLAG);   /* stuff a point going down into the Q */
-    qptr->xleft = oldxleft;
-    qptr->xright = oldxright;
-    qtop = qptr + 1;                /* one above highest seed point */
-
     while (1) {
         Rect rect;
 
@@ -966,6 +1258,66 @@ void contourfill(const VwkAttrib * attr, const VwkClip *clip)
         if ((*SEEDABORT)())
             break;
     }
+}
+
+
+
+/* common function for line-A linea_fill() and VDI d_countourfill() */
+void contourfill(const VwkAttrib * attr, const VwkClip *clip)
+{
+    WORD oldxleft;              /* left end of line at oldy     */
+    WORD oldxright;             /* right end                    */
+    WORD oldy;                  /* the previous scan line       */
+    WORD xleft;                 /* temporary endpoints          */
+
+    xleft = PTSIN[0];
+    oldy = PTSIN[1];
+
+    if (xleft < clip->xmn_clip || xleft > clip->xmx_clip ||
+        oldy < clip->ymn_clip  || oldy > clip->ymx_clip)
+        return;
+
+    search_color = INTIN[0];
+
+    if ((WORD)search_color < 0) {
+        search_color = pixelread(xleft,oldy);
+        seed_type = 1;
+    } else {
+        /* Range check the color and convert the index to a pixel value */
+        if (search_color >= numcolors)
+            return;
+
+        /*
+         * We mandate that white is all bits on.  Since this yields 15
+         * in rom, we must limit it to how many planes there really are.
+         * Anding with the mask is only necessary when the driver supports
+         * move than one resolution.
+         */
+        search_color =
+            (MAP_COL[search_color] & plane_mask[INQ_TAB[4] - 1]);
+        seed_type = 0;
+    }
+
+    /* check if anything to do */
+    if (!end_pts(clip, xleft, oldy, &oldxleft, &oldxright))
+        return;
+
+    /*
+     * from this point on we must NOT access PTSIN[], since the area
+     * is overwritten by the queue of seeds!
+     */
+    qptr = qbottom = vdishare.queue;
+    qlimit = vdishare.queue + QSIZE;
+    qalloc = NULL;
+    qptr->y = (oldy | DOWN_FLAG);   /* stuff a point going down into the Q */
+    qptr->xleft = oldxleft;
+    qptr->xright = oldxright;
+    qtop = qptr + 1;                /* one above highest seed point */
+
+    fill_loop(attr, clip, oldy, oldxleft, oldxright);
+
+    if (qalloc)
+        dos_free(qalloc);
 }                               /* end of fill() */
 
 
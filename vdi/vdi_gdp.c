@@ -364,6 +364,365 @@ static int clc_nsteps(void)
 
 
 
+#if CONF_WITH_VDI_ELLIPSE_RASTER
+
+/*
+ * the largest radius handled by the ellipse rasteriser: this keeps the
+ * error terms in raster_curve() within the range of a LONG
+ */
+#define MAX_RASTER_RAD  800
+
+/*
+ * one side of an arc or pie, expressed as the half-plane containing
+ * the points (dx,dy) for which (sinval * dx) <= (cosval * dy).  dx & dy
+ * are offsets from the centre, with dy increasing upwards.
+ */
+typedef struct {
+    WORD cosval;
+    WORD sinval;
+} HALFPLANE;
+
+static HALFPLANE beg_edge, end_edge;
+static BOOL convex_sector;      /* TRUE => sector is the intersection of the half-planes */
+static BOOL full_curve;         /* TRUE => no sector, draw the whole curve */
+
+
+/*
+ * clc_edge - calculates the half-plane to the anticlockwise side of the
+ *            radius at the specified angle (or to the clockwise side,
+ *            if 'clockwise' is TRUE)
+ */
+static void clc_edge(HALFPLANE *edge, WORD angle, BOOL clockwise)
+{
+    WORD cosval, sinval;
+    BOOL xneg = FALSE, yneg = FALSE;
+
+    while (angle >= TWOPI)          /* normalise angle to 0-3599 inclusive */
+        angle -= TWOPI;
+
+    if (angle > 3*HALFPI) {         /* fourth quadrant */
+        angle = TWOPI - angle;
+        yneg = TRUE;
+    } else if (angle > PI) {        /* third quadrant */
+        angle -= PI;
+        xneg = yneg = TRUE;
+    } else if (angle > HALFPI) {    /* second quadrant */
+        angle = PI - angle;
+        xneg = TRUE;
+    }
+
+    /* handle the values not handled by the table, scale the rest to 32767 */
+    cosval = (angle < HALFPI-MAX_TABLE_ANGLE) ? 32767 : Icos(angle) >> 1;
+    sinval = (angle > MAX_TABLE_ANGLE) ? 32767 : Isin(angle) >> 1;
+
+    if (xneg != clockwise)
+        cosval = -cosval;
+    if (yneg != clockwise)
+        sinval = -sinval;
+
+    edge->cosval = cosval;
+    edge->sinval = sinval;
+}
+
+
+/*
+ * floor_div - returns n/d rounded towards minus infinity, clamped to
+ *             the range of a WORD; d must be positive
+ */
+static WORD floor_div(LONG n, WORD d)
+{
+    LONG q = n / d;
+
+    if ((n < 0) && (q * d != n))
+        q--;
+
+    if (q > 32767)
+        return 32767;
+    if (q < -32767)
+        return -32767;
+    return q;
+}
+
+
+/*
+ * edge_span - returns the range of dx within the half-plane for row dy
+ *
+ * the range is returned as [*lo,*hi]; it is empty if *lo > *hi
+ */
+static void edge_span(const HALFPLANE *edge, WORD dy, WORD *lo, WORD *hi)
+{
+    LONG n = muls(edge->cosval, dy);
+
+    *lo = -32767;
+    *hi = 32767;
+
+    if (edge->sinval > 0)
+        *hi = floor_div(n, edge->sinval);
+    else if (edge->sinval < 0)
+        *lo = -floor_div(n, -edge->sinval);
+    else if (n < 0) {
+        *lo = 32767;
+        *hi = -32767;
+    }
+}
+
+
+/*
+ * curve_span - draws the part of a row of the curve between dx offsets
+ *              x1 & x2 inclusive, clipping it to the clipping rectangle
+ */
+static void curve_span(const VwkAttrib *attr, const VwkClip *clipper, WORD x1, WORD x2, WORD y)
+{
+    Rect rect;
+
+    rect.x1 = xc + x1;
+    rect.x2 = xc + x2;
+
+    if (attr->clip) {
+        if ((rect.x2 < clipper->xmn_clip) || (rect.x1 > clipper->xmx_clip))
+            return;
+        if (rect.x1 < clipper->xmn_clip)
+            rect.x1 = clipper->xmn_clip;
+        if (rect.x2 > clipper->xmx_clip)
+            rect.x2 = clipper->xmx_clip;
+    }
+    rect.y1 = rect.y2 = y;
+
+    draw_rect_common(attr, &rect);
+}
+
+
+/*
+ * sector_span - draws the part of the range [lo,hi] of a row of the curve
+ *               that lies within the sector
+ *
+ * alo/ahi and blo/bhi are the ranges within the two half-planes bounding
+ * the sector for this row.  when the sector is wider than a semicircle,
+ * we draw the union of the ranges, taking care not to draw any pixel
+ * twice (for XOR mode).
+ */
+static void sector_span(const VwkAttrib *attr, const VwkClip *clipper, WORD lo, WORD hi,
+                        WORD alo, WORD ahi, WORD blo, WORD bhi, WORD y)
+{
+    WORD l1, h1, l2, h2;
+
+    l1 = max(lo, alo);
+    h1 = min(hi, ahi);
+    l2 = max(lo, blo);
+    h2 = min(hi, bhi);
+
+    if (convex_sector) {
+        l1 = max(l1, l2);
+        h1 = min(h1, h2);
+        if (l1 <= h1)
+            curve_span(attr, clipper, l1, h1, y);
+        return;
+    }
+
+    if (l1 > h1) {
+        if (l2 <= h2)
+            curve_span(attr, clipper, l2, h2, y);
+    } else if (l2 > h2) {
+        curve_span(attr, clipper, l1, h1, y);
+    } else if ((l2 <= h1+1) && (l1 <= h2+1)) {  /* touching or overlapping */
+        curve_span(attr, clipper, min(l1, l2), max(h1, h2), y);
+    } else {
+        curve_span(attr, clipper, l1, h1, y);
+        curve_span(attr, clipper, l2, h2, y);
+    }
+}
+
+
+/*
+ * curve_row - draws one row of the curve, dy rows above the centre
+ *
+ * the row covers offsets -outer to +outer; if 'inner' is non-zero, the
+ * offsets from -inner+1 to +inner-1 (the interior of an outline) are
+ * left undrawn.
+ */
+static void curve_row(const VwkAttrib *attr, const VwkClip *clipper, WORD inner, WORD outer, WORD dy)
+{
+    WORD y = yc - dy;
+    WORD alo, ahi, blo, bhi;
+
+    if (attr->clip)
+        if ((y < clipper->ymn_clip) || (y > clipper->ymx_clip))
+            return;
+
+    if (full_curve) {
+        if (inner == 0) {
+            curve_span(attr, clipper, -outer, outer, y);
+        } else {
+            curve_span(attr, clipper, -outer, -inner, y);
+            curve_span(attr, clipper, inner, outer, y);
+        }
+        return;
+    }
+
+    edge_span(&beg_edge, dy, &alo, &ahi);
+    edge_span(&end_edge, dy, &blo, &bhi);
+
+    if (inner == 0) {
+        sector_span(attr, clipper, -outer, outer, alo, ahi, blo, bhi, y);
+    } else {
+        sector_span(attr, clipper, -outer, -inner, alo, ahi, blo, bhi, y);
+        sector_span(attr, clipper, inner, outer, alo, ahi, blo, bhi, y);
+    }
+}
+
+
+/*
+ * raster_curve - draws a circle/ellipse (or the sector of one defined by
+ *                beg_edge/end_edge) as horizontal spans, either filled
+ *                or as a one-pixel outline
+ *
+ * this is a midpoint algorithm: for each row, starting at the top, we
+ * find the largest x such that the pixel (x,y) is no more than half a
+ * pixel outside the true curve, either horizontally or vertically.  with
+ * F(x,y) = b²x² + a²y² - a²b², that is F(x-½,y) <= 0 or F(x,y-½) <= 0,
+ * i.e. F(x,y) <= max(b²x - b²/4, a²y - a²/4).  F is maintained
+ * incrementally, relative to the vertical threshold ty, and x never
+ * decreases as we move towards the centre row.  the lower half is the
+ * mirror image of the upper half.
+ */
+static void raster_curve(const VwkAttrib *attr, const VwkClip *clipper, BOOL outline)
+{
+    LONG a2, b2, f, ty, lim;
+    WORD x, y, inner, prev_x;
+
+    a2 = muls(xrad, xrad);
+    b2 = muls(yrad, yrad);
+    ty = a2 * yrad - a2 / 4;            /* a²y - a²/4 */
+    f = b2 - ty;                        /* F(1,yrad) - ty */
+
+    for (x = 0, prev_x = -1, y = yrad; y >= 0; y--) {
+        for (;;) {
+            lim = b2 * (x + 1) - b2 / 4 - ty;   /* for pixel x+1 */
+            if (f > max(lim, 0))
+                break;
+            x++;
+            f += b2 * (2 * x + 1);      /* F(x+1,y) - F(x,y) */
+        }
+
+        /* an outline includes the pixels not covered by the previous row */
+        inner = outline ? min(x, prev_x + 1) : 0;
+
+        curve_row(attr, clipper, inner, x, y);
+        if (y)
+            curve_row(attr, clipper, inner, x, -y);
+
+        prev_x = x;
+        f -= 2 * a2 * (y - 1);          /* F(x+1,y) - F(x+1,y-1), less a² */
+        ty -= a2;
+    }
+}
+
+
+/*
+ * can_raster - returns TRUE if the curve described by the GDP variables
+ *              can be drawn by raster_curve()
+ *
+ * we leave to clc_arc() the cases that raster_curve() does not handle:
+ * curves that are too large or degenerate, unusual angles, and arcs
+ * drawn with wide, patterned or arrowed lines.  in XOR mode, we also
+ * leave it filled pie slices with perimeters, since the perimeter would
+ * overlap itself where the arc meets the radii.
+ */
+static BOOL can_raster(Vwk *vwk)
+{
+    if ((xrad == 0) || (xrad > MAX_RASTER_RAD) || (yrad == 0) || (yrad > MAX_RASTER_RAD))
+        return FALSE;
+
+    if ((beg_ang < 0) || (beg_ang > TWOPI) || (end_ang < 0) || (end_ang > TWOPI) || (del_ang == 0))
+        return FALSE;
+
+    switch(CONTRL[5]) {
+    case 2:             /* v_arc() */
+    case 6:             /* v_ellarc() */
+        if (vwk->line_width != 1)
+            return FALSE;
+        if ((vwk->line_beg | vwk->line_end) & ARROWED)
+            return FALSE;
+        set_LN_MASK(vwk);
+        if ((UWORD)LN_MASK != 0xffff)  /* solid lines only */
+            return FALSE;
+        break;
+    case 3:             /* v_pieslice() */
+    case 7:             /* v_ellpie() */
+        if ((vwk->fill_per == TRUE) && (vwk->wrt_mode == WM_XOR))
+            return FALSE;
+        break;
+    }
+
+    return TRUE;
+}
+
+
+/*
+ * gdp_raster - draws the curve described by the GDP variables directly,
+ *              without generating the vertices of a polygon/polyline
+ */
+static void gdp_raster(Vwk *vwk)
+{
+    VwkAttrib attr;
+    const VwkClip *clipper = VDI_CLIP(vwk);
+    Point *point;
+    BOOL pie = (CONTRL[5] == 3) || (CONTRL[5] == 7);
+
+    full_curve = (del_ang >= TWOPI);
+    convex_sector = (del_ang <= PI);
+    clc_edge(&beg_edge, beg_ang, FALSE);
+    clc_edge(&end_edge, end_ang, TRUE);
+
+#if CONF_WITH_BLITTER
+    hwblit_defer(TRUE);
+#endif
+
+    if ((CONTRL[5] == 2) || (CONTRL[5] == 6)) { /* v_arc() or v_ellarc() */
+        Vwk2Attrib(vwk, &attr, vwk->line_color);
+        attr.multifill = 0;
+        attr.patmsk = 0;
+        attr.patptr = &SOLID;
+#if CONF_WITH_VDI_FILL_EXPAND
+        attr.patexp = NULL;
+#endif
+        raster_curve(&attr, clipper, TRUE);
+    } else {
+        Vwk2Attrib(vwk, &attr, vwk->fill_color);
+        raster_curve(&attr, clipper, FALSE);
+
+        if (vwk->fill_per == TRUE) {
+            attr.color = vwk->fill_color;
+            attr.multifill = 0;
+            attr.patmsk = 0;
+            attr.patptr = &SOLID;
+#if CONF_WITH_VDI_FILL_EXPAND
+            attr.patexp = NULL;
+#endif
+            raster_curve(&attr, clipper, TRUE);
+        }
+    }
+
+#if CONF_WITH_BLITTER
+    hwblit_defer(FALSE);
+#endif
+
+    /* the radii of a pie slice form part of its perimeter */
+    if (pie && (vwk->fill_per == TRUE) && !full_curve) {
+        point = (Point *)PTSIN;
+        clc_pts(point, beg_ang);
+        point[1].x = xc;
+        point[1].y = yc;
+        clc_pts(point+2, end_ang);
+        LN_MASK = 0xffff;
+        polyline(vwk, point, 3, vwk->fill_color);
+    }
+}
+
+#endif /* CONF_WITH_VDI_ELLIPSE_RASTER */
+
+
+
 /*
  * gdp_curve: handles all circle/ellipse GDP functions:
  *  v_arc(), v_pieslice(), v_circle(), v_ellipse(), v_ellarc(), v_ellpie()
@@ -395,11 +754,8 @@ static void gdp_curve(Vwk *vwk)
     /*
      * we can quit now if clipping excludes the entire curve
      */
-    if (vwk->clip) {
-        if (((xc + xrad) < vwk->xmn_clip) || ((xc - xrad) > vwk->xmx_clip) ||
-            ((yc + yrad) < vwk->ymn_clip) || ((yc - yrad) > vwk->ymx_clip))
-            return;
-    }
+    if (rect_clipped(vwk, xc - xrad, yc - yrad, xc + xrad, yc + yrad))
+        return;
 
     if ((CONTRL[5] == 4) || (CONTRL[5] == 5)) { /* v_circle(), v_ellipse() */
         beg_ang = 0;
@@ -413,6 +769,13 @@ static void gdp_curve(Vwk *vwk)
     if (del_ang < 0)
         del_ang += TWOPI;
 
+#if CONF_WITH_VDI_ELLIPSE_RASTER
+    if (can_raster(vwk)) {
+        gdp_raster(vwk);
+        return;
+    }
+#endif
+
     steps = clc_nsteps();
 
     clc_arc(vwk, steps);
@@ -11,6 +11,7 @@
 
 #include "emutos.h"
 #include "intmath.h"
+#include "string.h"
 #include "asm.h"
 #include "aesext.h"
 #include "vdi_defs.h"
@@ -18,7 +19,9 @@
 #include "blitter.h"
 #include "biosext.h"    /* for cache control routines */
 #include "lineavars.h"
+#include "tosvars.h"
 #include "has.h"        /* for blitter-related items */
+#include "cookie.h"
 
 
 /*
@@ -43,6 +46,147 @@ typedef struct
  */
 const UBYTE op_draw[] = { 0x03, 0x07, 0x06, 0x0d };
 const UBYTE op_nodraw[] = { 0x00, 0x04, 0x06, 0x01 };
+
+/*
+ * hardware blitter state
+ *
+ * normally, each blitter function waits for the blitter to finish before
+ * returning.  between calls to hwblit_defer(TRUE) and hwblit_defer(FALSE)
+ * (which may be nested), the last blit started by a function is left running in the background,
+ * in no-HOG mode (so it shares the bus with the cpu), while the caller
+ * calculates the next one.  this speeds up drawing that consists of many
+ * small blits, such as filled polygons.  the caller must not access the
+ * screen with the cpu while deferral is active.
+ */
+static BOOL hwblit_running;     /* TRUE if the blitter may still be busy */
+static WORD hwblit_deferred;    /* if non-zero, hwblit_end() must not wait */
+static BOOL hwblit_dirty;       /* TRUE if the data cache must be invalidated */
+static void *hwblit_addr;       /* start & length of memory modified by the */
+static LONG hwblit_length;      /*  blitter functions since the last sync    */
+
+/*
+ * smallest operation (width x height x planes) that is drawn with the
+ * blitter when it is enabled, set by hwblit_init()
+ */
+static ULONG hwblit_min_size;
+
+/*
+ * hwblit_init - choose between the blitter and the cpu
+ *
+ * on a 68000, the blitter is faster for any operation.  a 68020 or better
+ * with its caches beats the blitter for small operations, where the cost
+ * of setting up the blitter dominates.
+ */
+void hwblit_init(void)
+{
+    ULONG cpu;
+
+    hwblit_min_size = 0UL;
+    if (cookie_get(COOKIE_CPU, &cpu) && (cpu >= 20))
+        hwblit_min_size = BLITTER_MIN_SIZE;
+}
+
+/*
+ * hwblit_wanted - return TRUE if an operation of the specified size
+ * should be done with the blitter
+ *
+ * if the cpu is to be used instead, any deferred blit is finished first
+ */
+BOOL hwblit_wanted(UWORD width, UWORD height, UWORD planes)
+{
+    if (!blitter_is_enabled)
+        return FALSE;
+
+    if ((ULONG)width * height * planes >= hwblit_min_size)
+        return TRUE;
+
+    hwblit_sync();
+
+    return FALSE;
+}
+
+/*
+ * hwblit_start - start the blitter, without waiting for it to finish
+ */
+void hwblit_start(UBYTE status)
+{
+    BLITTER->status = status;
+    hwblit_running = TRUE;
+}
+
+/*
+ * hwblit_wait - wait for the blitter to finish
+ *
+ * we do this in the Atari-recommended way, by manually restarting the
+ * blitter until it's done
+ */
+void hwblit_wait(void)
+{
+    if (!hwblit_running)
+        return;
+
+    __asm__ __volatile__(
+    "lea    0xFFFF8A3C,a0\n\t"
+    "0:\n\t"
+    "tas    (a0)\n\t"
+    "nop\n\t"
+    "jbmi   0b\n\t"
+    :
+    :
+    : "a0", "memory", "cc"
+    );
+    hwblit_running = FALSE;
+}
+
+/*
+ * hwblit_sync - wait for the blitter to finish, then invalidate any
+ * cached copies of the memory it has modified
+ *
+ * this must be called before the blitter registers are modified or the
+ * cpu accesses the blitted memory
+ */
+void hwblit_sync(void)
+{
+    hwblit_wait();
+
+    if (hwblit_dirty)
+    {
+        invalidate_data_cache(hwblit_addr, hwblit_length);
+        hwblit_dirty = FALSE;
+    }
+}
+
+/*
+ * hwblit_end - called by a blitter function after it has started its
+ * last blit, to note the memory that it modifies
+ */
+void hwblit_end(void *addr, LONG length)
+{
+    hwblit_addr = addr;
+    hwblit_length = length;
+    hwblit_dirty = TRUE;
+
+    if (!hwblit_deferred)
+        hwblit_sync();
+}
+
+/*
+ * hwblit_defer - enable/disable overlapping of blits with the caller
+ *
+ * calls may be nested: overlapping stops, and the blitter is waited for,
+ * at the hwblit_defer(FALSE) that matches the outermost hwblit_defer(TRUE)
+ */
+void hwblit_defer(BOOL defer)
+{
+    if (defer)
+    {
+        hwblit_deferred++;
+        return;
+    }
+
+    if (--hwblit_deferred == 0)
+        hwblit_sync();
+}
 #endif
 
 
@@ -225,6 +369,7 @@ static void hwblit_vertical_line(const Line *line, WORD wrt_mode, UWORD color)
      * routines ignore the length specification & act on the whole cache
      * anyway.
      */
+    hwblit_sync();
     flush_data_cache(screen_addr, size);
 
     BLITTER->endmask_1 = 0x8000 >> (line->x1&0x000f);
@@ -237,31 +382,18 @@ static void hwblit_vertical_line(const Line *line, WORD wrt_mode, UWORD color)
 
     for (plane = 0; plane < v_planes; plane++, color >>= 1)
     {
+        hwblit_wait();          /* for the previous plane */
         BLITTER->dst_addr = screen_addr++;
         BLITTER->y_count = dy + 1;
         BLITTER->op = (color & 1) ? op_draw[wrt_mode]: op_nodraw[wrt_mode];
 
-        /*
-         * we run the blitter in the Atari-recommended way: use no-HOG mode,
-         * and manually restart the blitter until it's done.
-         */
-        BLITTER->status = BUSY | start_line;    /* no-HOG mode */
-        __asm__ __volatile__(
-        "lea    0xFFFF8A3C,a0\n\t"
-        "0:\n\t"
-        "tas    (a0)\n\t"
-        "nop\n\t"
-        "jbmi   0b\n\t"
-        :
-        :
-        : "a0", "memory", "cc"
-        );
+        hwblit_start(BUSY | start_line);   /* no-HOG mode */
     }
     /*
      * we've modified the screen behind the cpu's back, so we must
-     * invalidate any cached screen data.
+     * invalidate any cached screen data when the blitter has finished
      */
-    invalidate_data_cache(screen_addr, size);
+    hwblit_end(screen_addr, size);
 
     /* update LN_MASK for next time */
     mask = LN_MASK;
@@ -302,21 +434,8 @@ static void hwblit_rect_nonstd(const VwkAttrib *attr, const Rect *rect, UWORD *a
                 patindex = 0;
             BLITTER->y_count = 1;
 
-            /*
-             * we run the blitter in the Atari-recommended way: use no-HOG mode,
-             * and manually restart the blitter until it's done.
-             */
-            BLITTER->status = BUSY;
-            __asm__ __volatile__(
-            "lea    0xFFFF8A3C,a0\n\t"
-            "0:\n\t"
-            "tas    (a0)\n\t"
-            "nop\n\t"
-            "jbmi   0b\n\t"
-            :
-            :
-            : "a0", "memory", "cc"
-            );
+            hwblit_start(BUSY);
+            hwblit_wait();
         }
 
         if (attr->multifill)
@@ -324,9 +443,9 @@ static void hwblit_rect_nonstd(const VwkAttrib *attr, const Rect *rect, UWORD *a
     }
 
     /*
-     * invalidate any cached screen data
+     * invalidate any cached screen data when the blitter has finished
      */
-    invalidate_data_cache(addr, v_lin_wr*ycount);
+    hwblit_end(addr, v_lin_wr*ycount);
 }
 
 
@@ -354,6 +473,7 @@ static void hwblit_rect_common(const VwkAttrib *attr, const Rect *rect)
     /*
      * flush the data cache to ensure that the screen memory is current
      */
+    hwblit_sync();
     flush_data_cache(b.addr, v_lin_wr*ycount);
 
     BLITTER->src_x_incr = 0;
@@ -398,6 +518,7 @@ static void hwblit_rect_common(const VwkAttrib *attr, const Rect *rect)
 
     for (plane = 0; plane < v_planes; plane++, color >>= 1)
     {
+        hwblit_wait();          /* for the previous plane */
         if (attr->multifill)    /* need to init halftone each time */
         {
             UWORD *p = BLITTER->halftone;
@@ -410,27 +531,255 @@ static void hwblit_rect_common(const VwkAttrib *attr, const Rect *rect)
         BLITTER->hop = HOP_HALFTONE_ONLY;
         BLITTER->op = (color & 1) ? op_draw[attr->wrt_mode]: op_nodraw[attr->wrt_mode];
 
-        /*
-         * we run the blitter in the Atari-recommended way: use no-HOG mode,
-         * and manually restart the blitter until it's done.
-         */
-        BLITTER->status = status;
-        __asm__ __volatile__(
-        "lea    0xFFFF8A3C,a0\n\t"
-        "0:\n\t"
-        "tas    (a0)\n\t"
-        "nop\n\t"
-        "jbmi   0b\n\t"
-        :
-        :
-        : "a0", "memory", "cc"
-        );
+        hwblit_start(status);
     }
 
     /*
-     * invalidate any cached screen data
+     * invalidate any cached screen data when the blitter has finished
      */
-    invalidate_data_cache(b.addr, v_lin_wr*ycount);
+    hwblit_end(b.addr, v_lin_wr*ycount);
+}
+#endif
+
+
+#if CONF_WITH_APOLLO_68080
+/*
+ * apollo_rect_replace - replace mode version of swblit_rect_common()
+ *                       for the Apollo 68080
+ *
+ * the 68080 writes longwords to video memory as fast as words, so the
+ * centre section is filled a group of 16 pixels (one word in every
+ * plane) at a time, using longword stores, rather than a plane at a
+ * time.  the left & right sections are handled as usual.
+ *
+ * the caller must ensure that the centre section exists.
+ */
+static void apollo_rect_replace(const VwkAttrib *attr, const Rect *rect, const BLITPARM *b)
+{
+    const int vplanes = v_planes;
+    const int groups = b->width - 2;    /* number of groups in centre section */
+    UWORD *addr = b->addr;
+    UWORD pattern[8];
+    ULONG fill[4];
+    int y;
+
+    for (y = rect->y1; y <= rect->y2; y++, addr += v_lin_wr>>1) {
+        int patind = attr->patmsk & y;  /* starting pattern */
+        int plane, n;
+        UWORD color, data, *work;
+        ULONG *lwork;
+
+        /* left & right sections, and the fill data for every plane */
+        for (plane = 0, color = attr->color; plane < vplanes; plane++, color>>=1) {
+            pattern[plane] = (color & 0x0001) ? attr->patptr[patind] : 0x0000;
+
+            work = addr + plane;
+            data = *work & ~b->leftmask;
+            data |= pattern[plane] & b->leftmask;
+            *work = data;
+
+            if (b->rightmask) {
+                work += (groups + 1) * vplanes;
+                data = *work & ~b->rightmask;
+                data |= pattern[plane] & b->rightmask;
+                *work = data;
+            }
+
+            if (attr->multifill)
+                patind += 16;           /* advance pattern data */
+        }
+
+        /* centre section */
+        lwork = (ULONG *)(addr + vplanes);
+        switch(vplanes) {
+        case 1:
+            fill[0] = ((ULONG)pattern[0] << 16) | pattern[0];
+            for (n = groups; n >= 2; n -= 2)
+                *lwork++ = fill[0];
+            if (n)
+                *(UWORD *)lwork = pattern[0];
+            break;
+        case 2:
+            fill[0] = ((ULONG)pattern[0] << 16) | pattern[1];
+            for (n = groups; n > 0; n--)
+                *lwork++ = fill[0];
+            break;
+        case 4:
+            fill[0] = ((ULONG)pattern[0] << 16) | pattern[1];
+            fill[1] = ((ULONG)pattern[2] << 16) | pattern[3];
+            for (n = groups; n > 0; n--) {
+                *lwork++ = fill[0];
+                *lwork++ = fill[1];
+            }
+            break;
+        default:                        /* 8 planes */
+            for (plane = 0; plane < 4; plane++)
+                fill[plane] = ((ULONG)pattern[2*plane] << 16) | pattern[2*plane+1];
+            for (n = groups; n > 0; n--) {
+                *lwork++ = fill[0];
+                *lwork++ = fill[1];
+                *lwork++ = fill[2];
+                *lwork++ = fill[3];
+            }
+            break;
+        }
+    }
+}
+#endif
+
+
+#if CONF_WITH_VDI_LINE_FILL
+/*
+ * line_fill - replace mode version of swblit_rect_common() for rectangles
+ *             that cover whole scan lines
+ *
+ * the lines are contiguous in memory, so they are filled a longword at a
+ * time with the data for all the planes, rather than a plane at a time.
+ * fill data that is the same in every byte (e.g. when clearing to colour
+ * 0) is written with memset(), which uses movem.  with a solid pattern,
+ * all the lines are filled at once.
+ *
+ * returns FALSE (having done nothing) if the screen layout is unsuitable.
+ */
+static BOOL line_fill(const VwkAttrib *attr, const Rect *rect)
+{
+    const int vplanes = v_planes;
+    const ULONG linelen = v_lin_wr;
+    const int nlong = (vplanes > 1) ? vplanes / 2 : 1;  /* longwords per unit */
+    UWORD pattern[8];
+    ULONG fill[4], size, *lwork;
+    UBYTE *addr;
+    int y, count, plane;
+    LONG n;
+
+    if ((vplanes != 1) && (vplanes != 2) && (vplanes != 4) && (vplanes != 8))
+        return FALSE;
+
+    /* there must be no padding at the end of the lines */
+    if ((ULONG)(xres + 1) * vplanes != linelen * 8)
+        return FALSE;
+    if (linelen & (nlong * sizeof(ULONG) - 1))
+        return FALSE;
+
+    addr = (UBYTE *)get_start_addr(0, rect->y1);
+
+    for (y = rect->y1; y <= rect->y2; y += count, addr += size) {
+        UWORD data = attr->patptr[attr->patmsk & y];
+        UWORD color;
+        BOOL same = TRUE;
+
+        for (plane = 0, color = attr->color; plane < vplanes; plane++, color>>=1) {
+            pattern[plane] = (color & 0x0001) ? data : 0x0000;
+            if (pattern[plane] != pattern[0])
+                same = FALSE;
+        }
+        if (vplanes == 1)
+            pattern[1] = pattern[0];
+
+        count = attr->patmsk ? 1 : rect->y2 - y + 1;
+        size = count * linelen;
+
+        if (same && (HIBYTE(pattern[0]) == LOBYTE(pattern[0]))) {
+            memset(addr, LOBYTE(pattern[0]), size);
+            continue;
+        }
+
+        for (plane = 0; plane < nlong; plane++)
+            fill[plane] = ((ULONG)pattern[2*plane] << 16) | pattern[2*plane+1];
+
+        lwork = (ULONG *)addr;
+        n = size / (nlong * sizeof(ULONG));
+        switch(nlong) {
+        case 1:
+            for ( ; n >= 4; n -= 4) {
+                *lwork++ = fill[0];
+                *lwork++ = fill[0];
+                *lwork++ = fill[0];
+                *lwork++ = fill[0];
+            }
+            for ( ; n > 0; n--)
+                *lwork++ = fill[0];
+            break;
+        case 2:
+            for ( ; n >= 2; n -= 2) {
+                *lwork++ = fill[0];
+                *lwork++ = fill[1];
+                *lwork++ = fill[0];
+                *lwork++ = fill[1];
+            }
+            if (n) {
+                *lwork++ = fill[0];
+                *lwork++ = fill[1];
+            }
+            break;
+        default:                        /* 8 planes */
+            for ( ; n > 0; n--) {
+                *lwork++ = fill[0];
+                *lwork++ = fill[1];
+                *lwork++ = fill[2];
+                *lwork++ = fill[3];
+            }
+            break;
+        }
+    }
+
+    return TRUE;
+}
+#endif
+
+
+#if CONF_WITH_VDI_FILL_EXPAND
+/*
+ * expanded_rect_replace - replace mode version of swblit_rect_common()
+ *                         using the expanded fill pattern
+ *
+ * this is the same as the replace mode case of swblit_rect_common(),
+ * except that the word to store in each plane is taken from the
+ * expanded pattern (see st_fl_exp()), rather than being derived from
+ * the fill colour for each plane of each line.
+ */
+static void expanded_rect_replace(const VwkAttrib *attr, const Rect *rect, const BLITPARM *b, int centre)
+{
+    const int vplanes = v_planes;
+    const int yinc = (v_lin_wr>>1) - vplanes;
+    UWORD *addr = b->addr;
+    int y;
+
+    for (y = rect->y1; y <= rect->y2; y++, addr += yinc) {
+        const UWORD *patexp = attr->patexp + (y & 15) * vplanes;
+        int plane;
+
+        for (plane = 0; plane < vplanes; plane++, addr++) {
+            UWORD data, *work = addr;
+            UWORD pattern = *patexp++;
+            int n;
+
+            data = *work & ~b->leftmask;        /* left section */
+            data |= pattern & b->leftmask;
+            *work = data;
+            work += vplanes;
+#ifdef __mcoldfire__
+            for (n = centre; n >= 0; n--) {     /* centre section */
+                *work = pattern;
+                work += vplanes;
+            }
+#else
+            if (centre >= 0) {                  /* centre section */
+                n = centre;
+                __asm ("1:\n\t"
+                       "move.w %2,(%1)\n\t"
+                       "adda.w %3,%1\n\t"
+                       "dbra %0,1b" : "+d"(n), "+a"(work) : "r"(pattern),
+                                      "r"(2*vplanes) : "memory", "cc");
+            }
+#endif
+            if (b->rightmask) {                 /* right section */
+                data = *work & ~b->rightmask;
+                data |= pattern & b->rightmask;
+                *work = data;
+            }
+        }
+    }
 }
 #endif
 
@@ -463,11 +812,31 @@ static void OPTIMIZE_SMALL swblit_rect_common(const VwkAttrib *attr, const Rect
     int centre, y;
     BLITPARM b;
 
+#if CONF_WITH_VDI_LINE_FILL
+    if ((attr->wrt_mode == WM_REPLACE) && !attr->multifill
+     && (rect->x1 == 0) && (rect->x2 == xres) && line_fill(attr, rect))
+        return;
+#endif
+
     /* set up masks, width, screen address pointer */
     draw_rect_setup(&b, attr, rect);
 
     centre = b.width - 2 - 1;   /* -1 because of the way we construct the innermost loops */
 
+#if CONF_WITH_APOLLO_68080
+    if (IS_APOLLO_68080 && (attr->wrt_mode == WM_REPLACE) && (centre >= 0)) {
+        apollo_rect_replace(attr, rect, &b);
+        return;
+    }
+#endif
+
+#if CONF_WITH_VDI_FILL_EXPAND
+    if ((attr->wrt_mode == WM_REPLACE) && attr->patexp) {
+        expanded_rect_replace(attr, rect, &b, centre);
+        return;
+    }
+#endif
+
     switch(attr->wrt_mode) {
     case WM_ERASE:          /* erase (reverse transparent) mode */
         for (y = rect->y1; y <= rect->y2; y++, b.addr += yinc) {
@@ -667,15 +1036,93 @@ static void OPTIMIZE_SMALL swblit_rect_common(const VwkAttrib *attr, const Rect
 }
 
 
+#if CONF_WITH_VDI_16BIT
 /*
- * draw_rect_common - draw one or more horizontal lines
+ * truecolor_rect_common - draw one or more horizontal lines in 16-bit mode
+ *
+ * as for the bitplane modes, pattern bits that are set are drawn in the
+ * fill colour, and (in replace mode) pattern bits that are clear are
+ * drawn in pen 0.  multi-plane fill patterns are not supported.
+ */
+static void truecolor_rect_common(const VwkAttrib *attr, const Rect *rect)
+{
+    const UWORD fg = truecolor_palette[attr->color & 0xff];
+    const UWORD bg = truecolor_palette[0];
+    const UWORD firstbit = 0x8000 >> (rect->x1 & 0x0f);
+    const WORD width = rect->x2 - rect->x1 + 1;
+    UWORD *line, *work;
+    UWORD pattern, bit;
+    WORD n, y;
+
+    if (width <= 0)
+        return;
+
+    line = (UWORD *)(v_bas_ad + muls(rect->y1, v_lin_wr)) + rect->x1;
+
+    for (y = rect->y1; y <= rect->y2; y++, line += v_lin_wr/sizeof(UWORD)) {
+        pattern = attr->patptr[attr->patmsk & y];
+        bit = firstbit;
+        work = line;
+
+        switch(attr->wrt_mode) {
+        case WM_ERASE:          /* erase (reverse transparent) mode */
+            for (n = width; n > 0; n--, work++) {
+                if (!(pattern & bit))
+                    *work = fg;
+                rorw1(bit);
+            }
+            break;
+        case WM_XOR:            /* xor mode */
+            for (n = width; n > 0; n--, work++) {
+                if (pattern & bit)
+                    *work = ~*work;
+                rorw1(bit);
+            }
+            break;
+        case WM_TRANS:          /* transparent mode */
+            for (n = width; n > 0; n--, work++) {
+                if (pattern & bit)
+                    *work = fg;
+                rorw1(bit);
+            }
+            break;
+        default:                /* replace mode */
+            if (pattern == 0xffff) {
+                for (n = width; n > 0; n--)
+                    *work++ = fg;
+                break;
+            }
+            for (n = width; n > 0; n--, work++) {
+                *work = (pattern & bit) ? fg : bg;
+                rorw1(bit);
+            }
+            break;
+        }
+    }
+}
+#endif
+
+
+/*
+ * draw_rect_now - draw one or more horizontal lines
  *
  * calls the hardware or software blitter code to perform the blit
  */
-void draw_rect_common(const VwkAttrib *attr, const Rect *rect)
+static void draw_rect_now(const VwkAttrib *attr, const Rect *rect)
 {
+#if CONF_WITH_AMIGA_PLANAR
+    amiga_screen_dirty(rect->y1, rect->y2);
+#endif
+
+#if CONF_WITH_VDI_16BIT
+    if (TRUECOLOR_MODE)
+    {
+        truecolor_rect_common(attr, rect);
+    }
+    else
+#endif
 #if CONF_WITH_BLITTER
-    if (blitter_is_enabled)
+    if (hwblit_wanted(rect->x2 - rect->x1 + 1, rect->y2 - rect->y1 + 1, v_planes))
     {
         hwblit_rect_common(attr, rect);
     }
@@ -687,6 +1134,140 @@ void draw_rect_common(const VwkAttrib *attr, const Rect *rect)
 }
 
 
+#if CONF_WITH_VDI_SPAN_MERGE
+/*
+ * span buffer
+ *
+ * while wideline() is drawing, the single scan line rectangles that it
+ * generates (via polygon() and do_circ()) are collected here, and spans
+ * on the same scan line that overlap or touch are merged.  this means
+ * that the pixels where segments and their rounded joins overlap are
+ * normally drawn only once.  we only do this in replace & transparent
+ * modes, where drawing a pixel more than once has no further effect.
+ */
+#define SPANBUF_SIZE    32
+
+typedef struct {
+    WORD x1, x2, y;
+} SPAN;
+
+static SPAN spanbuf[SPANBUF_SIZE];
+static WORD span_count;
+static BOOL span_active;        /* TRUE while spans are being collected */
+static VwkAttrib span_attr;     /* attributes common to the buffered spans */
+
+/*
+ * span_flush - draw all the buffered spans
+ */
+static void span_flush(void)
+{
+    const SPAN *span;
+    Rect rect;
+    WORD n;
+
+    if (span_count == 0)
+        return;
+
+#if CONF_WITH_BLITTER
+    hwblit_defer(TRUE);
+#endif
+    for (n = span_count, span = spanbuf; n > 0; n--, span++)
+    {
+        rect.x1 = span->x1;
+        rect.x2 = span->x2;
+        rect.y1 = rect.y2 = span->y;
+        draw_rect_now(&span_attr, &rect);
+    }
+#if CONF_WITH_BLITTER
+    hwblit_defer(FALSE);
+#endif
+
+    span_count = 0;
+}
+
+/*
+ * span_add - add a single scan line rectangle to the span buffer
+ */
+static void span_add(const VwkAttrib *attr, const Rect *rect)
+{
+    SPAN *span;
+    WORD n;
+
+    /* the buffered spans must all be drawn the same way */
+    if (span_count && ((attr->color != span_attr.color)
+                    || (attr->wrt_mode != span_attr.wrt_mode)
+                    || (attr->patptr != span_attr.patptr)
+                    || (attr->patmsk != span_attr.patmsk)
+                    || (attr->multifill != span_attr.multifill)
+#if CONF_WITH_VDI_FILL_EXPAND
+                    || (attr->patexp != span_attr.patexp)
+#endif
+                    ))
+        span_flush();
+
+    if (span_count == 0)
+        span_attr = *attr;
+
+    /* merge with an existing span if possible */
+    for (n = span_count, span = spanbuf; n > 0; n--, span++)
+    {
+        if ((span->y == rect->y1)
+         && (rect->x1 <= span->x2 + 1) && (rect->x2 >= span->x1 - 1))
+        {
+            if (rect->x1 < span->x1)
+                span->x1 = rect->x1;
+            if (rect->x2 > span->x2)
+                span->x2 = rect->x2;
+            return;
+        }
+    }
+
+    if (span_count >= SPANBUF_SIZE)
+        span_flush();
+
+    span = spanbuf + span_count++;
+    span->x1 = rect->x1;
+    span->x2 = rect->x2;
+    span->y = rect->y1;
+}
+
+/*
+ * span_begin - start collecting spans, if the writing mode allows it
+ */
+static void span_begin(const Vwk *vwk)
+{
+    span_count = 0;
+    span_active = (vwk->wrt_mode == WM_REPLACE) || (vwk->wrt_mode == WM_TRANS);
+}
+
+/*
+ * span_end - stop collecting spans, and draw any that are buffered
+ */
+static void span_end(void)
+{
+    span_flush();
+    span_active = FALSE;
+}
+#endif
+
+
+/*
+ * draw_rect_common - draw one or more horizontal lines
+ */
+void draw_rect_common(const VwkAttrib *attr, const Rect *rect)
+{
+#if CONF_WITH_VDI_SPAN_MERGE
+    if (span_active && (rect->y1 == rect->y2))
+    {
+        span_add(attr, rect);
+        return;
+    }
+#endif
+
+    draw_rect_now(attr, rect);
+}
+
+
 /*
  * helper to copy relevant Vwk members to the VwkAttrib struct, which is
  * used to pass the required Vwk info from VDI/Line-A polygon drawing to
@@ -703,6 +1284,11 @@ void Vwk2Attrib(const Vwk *vwk, VwkAttrib *attr, const UWORD color)
     attr->patptr = vwk->patptr;
     attr->wrt_mode = vwk->wrt_mode;
     attr->color = color;
+#if CONF_WITH_VDI_FILL_EXPAND
+    attr->patexp = ((vwk->exp_planes == v_planes) && (vwk->exp_color == color)
+                    && (vwk->exp_patptr == vwk->patptr) && (vwk->exp_patmsk == vwk->patmsk)
+                    && (vwk->exp_multifill == vwk->multifill)) ? vwk->fill_exp : NULL;
+#endif
 }
 
 
@@ -772,6 +1358,9 @@ static void lineA2Attrib(VwkAttrib *attr)
     }
     attr->wrt_mode = WRT_MODE;
     attr->color = linea_color();
+#if CONF_WITH_VDI_FILL_EXPAND
+    attr->patexp = NULL;
+#endif
 }
 
 
@@ -823,6 +1412,51 @@ void linea_hline(void)
 }
 
 
+#if CONF_WITH_LINEA_RECTS
+/*
+ * Line-A wrapper for drawing a list of rectangles (EmuTOS extension)
+ *
+ * CONTRL[1] is the number of rectangles, and PTSIN contains two points
+ * (the opposite corners, x1<=x2 and y1<=y2) for each rectangle; a
+ * horizontal line is a rectangle with y1==y2.  all the rectangles are
+ * drawn with the same attributes, which are set up as for linea_rect().
+ */
+void linea_rects(void)
+{
+    VwkAttrib attr;
+    Rect line;
+    const Rect *rect = (const Rect *)PTSIN;
+    WORD count;
+
+    lineA2Attrib(&attr);
+    attr.multifill = MFILL;
+
+#if CONF_WITH_BLITTER
+    hwblit_defer(TRUE);
+#endif
+    for (count = CONTRL[1]; count > 0; count--, rect++) {
+        line = *rect;
+        if (CLIP) {
+            if (line.x1 < XMINCL)
+                line.x1 = XMINCL;
+            if (line.x2 > XMAXCL)
+                line.x2 = XMAXCL;
+            if (line.y1 < YMINCL)
+                line.y1 = YMINCL;
+            if (line.y2 > YMAXCL)
+                line.y2 = YMAXCL;
+            if ((line.x1 > line.x2) || (line.y1 > line.y2))
+                continue;       /* entirely clipped */
+        }
+        draw_rect_common(&attr, &line);
+    }
+#if CONF_WITH_BLITTER
+    hwblit_defer(FALSE);
+#endif
+}
+#endif
+
+
 /*
  * Line-A wrapper for clc_flit
  */
@@ -970,6 +1604,39 @@ BOOL clip_line(Vwk * vwk, Line * line)
 }
 
 
+/*
+ * points_clipped - fast rejection test for a primitive
+ *
+ * returns TRUE iff clipping is on, and the bounding box of the points,
+ * enlarged by 'margin' on all sides, lies entirely outside the clipping
+ * rectangle.  this allows a primitive to skip all its per-segment work
+ * when none of it can be visible.
+ */
+BOOL points_clipped(const Vwk *vwk, const Point *point, int count, WORD margin)
+{
+    WORD xmin, xmax, ymin, ymax;
+
+    if (!vwk->clip)
+        return FALSE;
+
+    xmin = xmax = point->x;
+    ymin = ymax = point->y;
+    while(--count > 0) {
+        point++;
+        if (point->x < xmin)
+            xmin = point->x;
+        else if (point->x > xmax)
+            xmax = point->x;
+        if (point->y < ymin)
+            ymin = point->y;
+        else if (point->y > ymax)
+            ymax = point->y;
+    }
+
+    return rect_clipped(vwk, xmin-margin, ymin-margin, xmax+margin, ymax+margin);
+}
+
+
 /*
  * polyline - draw a poly-line
  *
@@ -981,6 +1648,10 @@ void polyline(Vwk * vwk, Point * point, int count, WORD color)
     int i;
     Line line;
 
+    /* for a single line, the clipping below is just as quick */
+    if ((count > 2) && points_clipped(vwk, point, count, 0))
+        return;
+
     for (i = count-1, LSTLIN = FALSE; i > 0; i--) {
         if (i == 1)
             LSTLIN = TRUE;
@@ -1285,7 +1956,14 @@ void wideline(Vwk * vwk, Point * point, int count)
     if ((vwk->line_beg | vwk->line_end) & ARROWED)
         arrow(vwk, point, count);
 
+    /* the line may extend up to its width beyond the points */
+    if (points_clipped(vwk, point, count, vwk->line_width))
+        return;
+
     s_fa_attr(vwk);
+#if CONF_WITH_VDI_SPAN_MERGE
+    span_begin(vwk);
+#endif
 
     /* Initialize the starting point for the loop. */
     wx1 = point->x;
@@ -1368,6 +2046,10 @@ void wideline(Vwk * vwk, Point * point, int count)
         wy1 = wy2;
     }
 
+#if CONF_WITH_VDI_SPAN_MERGE
+    span_end();
+#endif
+
     /* Restore the attribute environment. */
     r_fa_attr(vwk);
 }
@@ -1921,13 +2603,17 @@ void abline(const Line *line, const WORD wrt_mode, UWORD color)
     Line ordered;
     UWORD x1,y1,x2,y2;          /* the coordinates */
 
+#if CONF_WITH_AMIGA_PLANAR
+    amiga_screen_dirty(line->y1, line->y2);
+#endif
+
 #if CONF_WITH_VDI_VERTLINE
     /*
      * optimize drawing of vertical lines
      */
     if (line->x1 == line->x2) {
 #if CONF_WITH_BLITTER
-        if (blitter_is_enabled)
+        if (hwblit_wanted(1, max(line->y1, line->y2) - min(line->y1, line->y2) + 1, v_planes))
         {
             hwblit_vertical_line(line, wrt_mode, color);
             return;
@@ -1983,6 +2669,9 @@ void abline(const Line *line, const WORD wrt_mode, UWORD color)
         attr.patptr = &linemask;
         attr.wrt_mode = wrt_mode;
         attr.color = color;
+#if CONF_WITH_VDI_FILL_EXPAND
+        attr.patexp = NULL;
+#endif
         rect.x1 = x1;
         rect.y1 = y1;
         rect.x2 = x2;
@@ -12,6 +12,10 @@
 #include "vdi_defs.h"
 #include "lineavars.h"
 #include "asm.h"
+#include "string.h"
+#include "tosvars.h"
+#include "biosdefs.h"     /* for CLOCKS_PER_SEC */
+#include "vdistub.h"
 
 /* forward prototypes */
 void screen(void);
@@ -115,6 +119,246 @@ static struct vdi_jmptab const jmptb2[] = {
 #define JMPTB2_ENTRIES  ARRAY_SIZE(jmptb2)
 
 
+/*
+ * find_jmptab - return the jumptable entry for a VDI opcode
+ *
+ * returns NULL if the opcode is not supported
+ */
+static const struct vdi_jmptab *find_jmptab(WORD opcode)
+{
+    if ((opcode >= V_OPNWK_OP) && (opcode < V_OPNWK_OP+JMPTB1_ENTRIES))
+        return &jmptb1[opcode - V_OPNWK_OP];
+
+    if ((opcode >= V_OPNVWK_OP) && (opcode < V_OPNVWK_OP+JMPTB2_ENTRIES))
+        return &jmptb2[opcode - V_OPNVWK_OP];
+
+    return NULL;
+}
+
+
+#if CONF_WITH_VDI_BATCH
+/*
+ * vdi_v_batch - execute a list of VDI calls (EmuTOS-specific escape)
+ *
+ * input:
+ *     CONTRL[5] = V_BATCH_ESC
+ *     INTIN[0-1] = address of an array of VDI_BATCH_PB
+ *     INTIN[2] = number of entries in the array
+ * output:
+ *     CONTRL[4] = 1
+ *     INTOUT[0] = number of calls executed
+ *
+ * Each entry is executed as if it had been passed to the VDI trap, except
+ * that it always uses the workstation of the batch call (the handle in
+ * its CONTRL[6] is ignored).  The workstation lookup and the update of
+ * the line-A variables are therefore only done once for the whole batch,
+ * by screen().  Opening or closing a workstation, and escapes (including
+ * nested batches), are not allowed and terminate the batch.
+ */
+void vdi_v_batch(Vwk *vwk)
+{
+    WORD *save_contrl = CONTRL, *save_intin = INTIN, *save_ptsin = PTSIN;
+    WORD *save_intout = INTOUT, *save_ptsout = PTSOUT;
+    const VDI_BATCH_PB *pb;
+    const struct vdi_jmptab *jmptab;
+    WORD i, count, opcode, nptsin, *contrl;
+
+    pb = (const VDI_BATCH_PB *)MAKE_ULONG(INTIN[0], INTIN[1]);
+    count = INTIN[2];
+
+    for (i = 0; i < count; i++, pb++) {
+        contrl = pb->contrl;
+        opcode = contrl[0];
+
+        if ((opcode == V_OPNWK_OP) || (opcode == V_CLSWK_OP)
+         || (opcode == V_OPNVWK_OP) || (opcode == V_CLSVWK_OP)
+         || (opcode == V_ESCAPE_OP))
+            break;
+
+        contrl[2] = 0;
+        contrl[4] = 0;
+        flip_y = 0;
+
+        jmptab = find_jmptab(opcode);
+        if (!jmptab)
+            continue;
+
+        /* copy PTSIN as GSX_ENTRY() does, preserving the caller's CONTRL[1] */
+        nptsin = contrl[1];
+        if (nptsin > MAX_VERTICES)
+            contrl[1] = MAX_VERTICES;
+        if (contrl[1] > 0)
+            memcpy(vdishare.main.local_ptsin, pb->ptsin, contrl[1] * 2 * sizeof(WORD));
+
+        CONTRL = contrl;
+        INTIN = pb->intin;
+        PTSIN = vdishare.main.local_ptsin;
+        INTOUT = pb->intout;
+        PTSOUT = pb->ptsout;
+
+        if (vwk->fill_style != 4)       /* multifill just for user */
+            vwk->multifill = 0;
+
+        contrl[2] = jmptab->nptsout;
+        contrl[4] = jmptab->nintout;
+        (*jmptab->op) (vwk);
+
+        contrl[1] = nptsin;
+    }
+
+    CONTRL = save_contrl;
+    INTIN = save_intin;
+    PTSIN = save_ptsin;
+    INTOUT = save_intout;
+    PTSOUT = save_ptsout;
+
+    flip_y = 0;
+    CONTRL[4] = 1;
+    INTOUT[0] = i;
+}
+#endif
+
+
+#if CONF_WITH_VDI_PROFILE
+/*
+ * per-opcode profiling counters, indexed in the same way as the
+ * concatenation of jmptb1[] and jmptb2[]
+ */
+typedef struct {
+    ULONG calls;                /* number of calls */
+    ULONG ticks;                /* 200Hz ticks spent in those calls */
+} VDI_PROFILE;
+
+static VDI_PROFILE profile[JMPTB1_ENTRIES+JMPTB2_ENTRIES];
+
+
+/*
+ * find_profile - return the profiling counters for a jumptable entry
+ */
+static VDI_PROFILE *find_profile(const struct vdi_jmptab *jmptab)
+{
+    if (jmptab < jmptb1+JMPTB1_ENTRIES)
+        return &profile[jmptab - jmptb1];
+
+    return &profile[JMPTB1_ENTRIES + (jmptab - jmptb2)];
+}
+
+
+/*
+ * vdi_v_profile - read the profiling counters (EmuTOS-specific escape)
+ *
+ * input:
+ *     CONTRL[5] = V_PROFILE_ESC
+ *     INTIN[0] = VDI opcode: return the counters for that opcode,
+ *                  summed over all workstations
+ *                0: return the counters for this workstation
+ *                -1: reset the counters for all opcodes and for this
+ *                  workstation, and return zeroes
+ * output:
+ *     CONTRL[4] = 5
+ *     INTOUT[0-1] = number of calls
+ *     INTOUT[2-3] = number of ticks spent in those calls
+ *     INTOUT[4] = ticks per second
+ *
+ * The counters for an escape include the times of all its subfunctions.
+ * Opcodes that are not supported return zeroes.
+ */
+void vdi_v_profile(Vwk *vwk)
+{
+    const struct vdi_jmptab *jmptab;
+    ULONG calls = 0UL, ticks = 0UL;
+    WORD opcode = INTIN[0];
+
+    if (opcode == -1) {
+        bzero(profile, sizeof(profile));
+        vwk->prof_calls = vwk->prof_ticks = 0UL;
+    } else if (opcode == 0) {
+        calls = vwk->prof_calls;
+        ticks = vwk->prof_ticks;
+    } else {
+        jmptab = find_jmptab(opcode);
+        if (jmptab) {
+            VDI_PROFILE *prof = find_profile(jmptab);
+            calls = prof->calls;
+            ticks = prof->ticks;
+        }
+    }
+
+    CONTRL[4] = 5;
+    INTOUT[0] = HIWORD(calls);
+    INTOUT[1] = LOWORD(calls);
+    INTOUT[2] = HIWORD(ticks);
+    INTOUT[3] = LOWORD(ticks);
+    INTOUT[4] = CLOCKS_PER_SEC;
+}
+#endif
+
+
+#if CONF_WITH_VDI_BITMAP
+/*
+ * uses_bitmap - return TRUE if a VDI function called for an off-screen
+ * bitmap workstation should act on its bitmap
+ *
+ * functions that handle the mouse cursor, and escapes (the cursor text
+ * functions use the screen via the BIOS), always act on the screen
+ */
+static BOOL uses_bitmap(WORD opcode)
+{
+    switch(opcode) {
+    case V_ESCAPE_OP:
+#if CONF_WITH_VDI_BATCH
+        return CONTRL[5] == V_BATCH_ESC;
+#else
+        return FALSE;
+#endif
+    case V_CLSVWK_OP:
+    case VSC_FORM_OP:
+    case V_SHOW_C_OP:
+    case V_HIDE_C_OP:
+    case VQ_MOUSE_OP:
+        return FALSE;
+    }
+
+    return TRUE;
+}
+#endif
+
+
+/*
+ * linea_sync - set some line-A variables from CUR_WORK
+ *
+ * these assignments are not required by EmuTOS, but ensure that the
+ * values in the line-A variables mirror those in the current virtual
+ * workstation, just like in Atari TOS.
+ */
+static void linea_sync(void)
+{
+    Vwk *vwk = CUR_WORK;
+
+    CUR_FONT = vwk->cur_font;
+    WRT_MODE = vwk->wrt_mode;
+    CLIP = vwk->clip;
+    XMINCL = vwk->xmn_clip;
+    YMINCL = vwk->ymn_clip;
+    XMAXCL = vwk->xmx_clip;
+    YMAXCL = vwk->ymx_clip;
+}
+
+
+#if CONF_WITH_LAZY_LINEA_SYNC
+BOOL linea_in_use;
+
+/*
+ * linea_start - called by the line-A handler until line-A is in use
+ */
+void linea_start(void)
+{
+    linea_in_use = TRUE;
+    linea_sync();
+}
+#endif
+
+
 /*
  * screen - Screen driver entry point
  */
@@ -124,6 +368,12 @@ void screen(void)
     WORD *contrl = CONTRL;
     const struct vdi_jmptab *jmptab;
     Vwk *vwk = NULL;
+#if CONF_WITH_VDI_BITMAP
+    BOOL bitmap = FALSE;
+#endif
+#if CONF_WITH_VDI_PROFILE
+    ULONG start;
+#endif
 
     /* get workstation handle */
     handle = CONTRL[6];
@@ -147,17 +397,40 @@ void screen(void)
             vwk->multifill = 0;
     }
 
-    if ((opcode >= V_OPNWK_OP) && (opcode < V_OPNWK_OP+JMPTB1_ENTRIES)) {
-        jmptab = &jmptb1[opcode - V_OPNWK_OP];
-    }
-    else if ((opcode >= V_OPNVWK_OP) && (opcode < V_OPNVWK_OP+JMPTB2_ENTRIES)) {
-        jmptab = &jmptb2[opcode - V_OPNVWK_OP];
-    } else {
+    jmptab = find_jmptab(opcode);
+    if (!jmptab)
         return;
-    }
     contrl[2] = jmptab->nptsout;
     contrl[4] = jmptab->nintout;
+#if CONF_WITH_VDI_BITMAP
+    if (vwk && vwk->bm_addr && uses_bitmap(opcode))
+    {
+        bitmap_select(vwk);
+        bitmap = TRUE;
+    }
+#endif
+#if CONF_WITH_VDI_PROFILE
+    start = hz_200;
     (*jmptab->op) (vwk);
+    start = hz_200 - start;     /* now the elapsed time */
+    {
+        VDI_PROFILE *prof = find_profile(jmptab);
+        prof->calls++;
+        prof->ticks += start;
+    }
+    /* a workstation that has just been opened or closed is not counted */
+    if (vwk && (opcode != V_CLSWK_OP) && (opcode != V_CLSVWK_OP))
+    {
+        vwk->prof_calls++;
+        vwk->prof_ticks += start;
+    }
+#else
+    (*jmptab->op) (vwk);
+#endif
+#if CONF_WITH_VDI_BITMAP
+    if (bitmap)
+        bitmap_deselect();
+#endif
 
     /*
      * at this point, for v_opnwk() and v_opnvwk(), vwk is NULL.  we
@@ -175,18 +448,11 @@ void screen(void)
      * the workstation is valid)
      */
     if ((opcode != V_CLSWK_OP) && (opcode != V_CLSVWK_OP)) {
-        /*
-         * the following assignments are not required by EmuTOS, but
-         * ensure that the values in the line-A variables mirror those
-         * in the current virtual workstation, just like in Atari TOS.
-         */
-        CUR_FONT = vwk->cur_font;
-        WRT_MODE = vwk->wrt_mode;
-        CLIP = vwk->clip;
-        XMINCL = vwk->xmn_clip;
-        YMINCL = vwk->ymn_clip;
-        XMAXCL = vwk->xmx_clip;
-        YMAXCL = vwk->ymx_clip;
         CUR_WORK = vwk;
+#if CONF_WITH_LAZY_LINEA_SYNC
+        if (linea_in_use)
+#endif
+        linea_sync();
     }
 }
+
@@ -11,6 +11,8 @@
 
 #include "emutos.h"
 #include "vdi_defs.h"
+#include "intmath.h"
+#include "string.h"
 
 
 
@@ -22,6 +24,140 @@ static const WORD m_square[] = { 1, 5, -4, -3, 4, -3, 4, 3, -4, 3, -4, -3 };
 static const WORD m_cross[] = { 2, 2, -4, -3, 4, 3, 2, -4, 3, 4, -3 };
 static const WORD m_dmnd[] = { 1, 5, -4, 0, 0, -3, 4, 0, 0, 3, -4, 0 };
 
+static const WORD * const markhead[] = {
+    m_dot, m_plus, m_star, m_square, m_cross, m_dmnd
+};
+
+#if CONF_WITH_VDI_MARKER_STAMPS
+/*
+ * the marker stamp
+ *
+ * in replace & transparent modes, the current marker is rasterised once
+ * into a monochrome form, which is then drawn for each point via
+ * draw_stamp().  the stamp is kept until the marker style or scale
+ * changes.
+ */
+#define STAMP_MAXSCALE  8       /* maximum mark_scale, i.e. (88+5)/11 */
+#define STAMP_WDWIDTH   ((8 * STAMP_MAXSCALE + 1 + 15) / 16)
+#define STAMP_HEIGHT    (6 * STAMP_MAXSCALE + 1)
+
+static UWORD stamp[STAMP_WDWIDTH * STAMP_HEIGHT];
+static WORD stamp_index = -1;   /* marker style of stamp, -1 => none */
+static WORD stamp_scale;        /* marker scale of stamp */
+static WORD stamp_wdwidth;      /* width of stamp in words */
+static WORD stamp_xoff, stamp_yoff; /* offset of top left from marker centre */
+static WORD stamp_w, stamp_h;   /* size of stamp in pixels */
+
+static void stamp_plot(WORD x, WORD y)
+{
+    stamp[y * stamp_wdwidth + (x >> 4)] |= 0x8000 >> (x & 0x0f);
+}
+
+/*
+ * stamp_line - draw a line into the stamp
+ *
+ * this selects the same pixels as draw_line() in vdi_line.c
+ */
+static void stamp_line(WORD x1, WORD y1, WORD x2, WORD y2)
+{
+    WORD dx, dy, yinc, eps, n;
+
+    /* always draw from left to right */
+    if (x2 < x1) {
+        n = x1; x1 = x2; x2 = n;
+        n = y1; y1 = y2; y2 = n;
+    }
+
+    dx = x2 - x1;
+    dy = y2 - y1;
+    yinc = 1;
+    if (dy < 0) {
+        dy = -dy;
+        yinc = -1;
+    }
+
+    if (dx >= dy) {
+        for (n = dx, eps = -dx; n >= 0; n--) {
+            stamp_plot(x1++, y1);
+            eps += 2*dy;
+            if (eps >= 0) {
+                eps -= 2*dx;
+                y1 += yinc;
+            }
+        }
+    } else {
+        for (n = dy, eps = -dy; n >= 0; n--) {
+            stamp_plot(x1, y1);
+            y1 += yinc;
+            eps += 2*dx;
+            if (eps >= 0) {
+                eps -= 2*dy;
+                x1++;
+            }
+        }
+    }
+}
+
+/*
+ * make_stamp - rasterise the current marker into the stamp
+ */
+static void make_stamp(WORD index, WORD scale)
+{
+    const WORD *m_ptr;
+    WORD i, j, num_lines, num_points;
+    WORD xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+
+    /* find the extent of the marker */
+    m_ptr = markhead[index];
+    for (i = 0, num_lines = *m_ptr++; i < num_lines; i++) {
+        for (j = 0, num_points = *m_ptr++; j < num_points; j++, m_ptr += 2) {
+            xmin = min(xmin, m_ptr[0]);
+            xmax = max(xmax, m_ptr[0]);
+            ymin = min(ymin, m_ptr[1]);
+            ymax = max(ymax, m_ptr[1]);
+        }
+    }
+
+    stamp_xoff = scale * xmin;
+    stamp_yoff = scale * ymin;
+    stamp_w = scale * (xmax - xmin) + 1;
+    stamp_h = scale * (ymax - ymin) + 1;
+    stamp_wdwidth = (stamp_w + 15) / 16;
+    bzero(stamp, stamp_wdwidth * stamp_h * sizeof(UWORD));
+
+    /* draw the polylines which define the marker */
+    m_ptr = markhead[index];
+    for (i = 0, num_lines = *m_ptr++; i < num_lines; i++) {
+        num_points = *m_ptr++;
+        for (j = 1; j < num_points; j++, m_ptr += 2)
+            stamp_line(scale * m_ptr[0] - stamp_xoff, scale * m_ptr[1] - stamp_yoff,
+                       scale * m_ptr[2] - stamp_xoff, scale * m_ptr[3] - stamp_yoff);
+        if (num_points == 1)    /* not used by the current markers */
+            stamp_plot(scale * m_ptr[0] - stamp_xoff, scale * m_ptr[1] - stamp_yoff);
+        m_ptr += 2;
+    }
+
+    stamp_index = index;
+    stamp_scale = scale;
+}
+
+/*
+ * draw_stamps - draw the markers for all the points in PTSIN
+ */
+static void draw_stamps(Vwk * vwk)
+{
+    const VwkClip *clipper = VDI_CLIP(vwk);
+    WORD i, *pts_in;
+
+    if ((vwk->mark_index != stamp_index) || (vwk->mark_scale != stamp_scale))
+        make_stamp(vwk->mark_index, vwk->mark_scale);
+
+    for (i = CONTRL[1], pts_in = PTSIN; i > 0; i--, pts_in += 2)
+        draw_stamp(clipper, stamp, stamp_wdwidth, pts_in[0] + stamp_xoff,
+                   pts_in[1] + stamp_yoff, stamp_w, stamp_h, vwk->mark_color);
+}
+#endif
+
 
 
 /*
@@ -88,16 +224,20 @@ void vdi_v_pmarker(Vwk * vwk)
 /* If this constant goes greater than 5, you must increase size of sav_points */
 #define MARKSEGMAX 5
 
-    static const WORD * const markhead[] = {
-        m_dot, m_plus, m_star, m_square, m_cross, m_dmnd
-    };
-
     WORD i, j, num_lines, num_vert, x_center, y_center, sav_points[10];
     WORD sav_index, sav_color, sav_width, sav_beg, sav_end;
     WORD *old_ptsin, scale, num_points, *src_ptr;
     WORD h, *pts_in;
     const WORD *mrk_ptr, *m_ptr;
 
+#if CONF_WITH_VDI_MARKER_STAMPS
+    if (((vwk->wrt_mode == WM_REPLACE) || (vwk->wrt_mode == WM_TRANS))
+     && (vwk->mark_scale <= STAMP_MAXSCALE)) {
+        draw_stamps(vwk);
+        return;
+    }
+#endif
+
     /* Save the current polyline attributes which will be used. */
     sav_index = vwk->line_index;
     sav_color = vwk->line_color;
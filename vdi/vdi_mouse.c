@@ -11,6 +11,7 @@
 
 #include "emutos.h"
 #include "asm.h"
+#include "intmath.h"
 #include "biosbind.h"
 #include "xbiosbind.h"
 #include "obdefs.h"
@@ -46,6 +47,32 @@ extern Mcdb     mouse_cdb;              /* storage for mouse sprite */
 /* prototypes */
 static void vb_draw(void);             /* user button vector */
 
+#if CONF_WITH_MOUSE_EXCLUSION
+/*
+ * mouse-excluding rectangle
+ *
+ * while drawing is confined to a known area, the cursor need not be
+ * removed from the screen as long as it stays outside that area.  in this
+ * state, HIDE_CNT is 1 and excl_active is TRUE; the VBL routine still
+ * moves the cursor, but removes it instead if it would intersect the
+ * rectangle.  cur_x/cur_y hold the position of the top left corner of the
+ * cursor as last drawn.
+ */
+static BOOL excl_active;
+static Rect excl_rect;
+static WORD cur_x, cur_y;
+
+/*
+ * cursor_in_excl_rect - return TRUE if a cursor with its top left corner
+ * at x,y would intersect the mouse-excluding rectangle
+ */
+static BOOL cursor_in_excl_rect(WORD x, WORD y)
+{
+    return (x <= excl_rect.x2) && (x + 15 >= excl_rect.x1)
+        && (y <= excl_rect.y2) && (y + 15 >= excl_rect.y1);
+}
+#endif
+
 /* prototypes for functions in vdi_asm.S */
 void mouse_int(void);           /* mouse interrupt routine */
 void mov_cur(void);             /* user button vector */
@@ -130,6 +157,13 @@ static void dis_cur(void)
     }
 
     /* HIDE_CNT is precisely 1 at this point */
+#if CONF_WITH_MOUSE_EXCLUSION
+    if (excl_active)
+    {
+        excl_active = FALSE;    /* stop the VBL routine moving the cursor */
+        cur_replace(mcs_ptr);   /* the cursor may still be on the screen */
+    }
+#endif
     cur_display(&mouse_cdb, mcs_ptr, GCURX, GCURY);  /* display the cursor */
     draw_flag = 0;              /* disable VBL drawing routine */
     HIDE_CNT--;
@@ -156,6 +190,15 @@ static void hide_cur(void)
      * If this is the first one then remove the cursor from the screen.
      * If not then do nothing, because the cursor wasn't on the screen.
      */
+#if CONF_WITH_MOUSE_EXCLUSION
+    if (excl_active) {          /* the cursor may still be on the screen */
+        excl_active = FALSE;    /* stop the VBL routine moving the cursor */
+        HIDE_CNT += 1;
+        cur_replace(mcs_ptr);
+        draw_flag = 0;
+        return;
+    }
+#endif
     HIDE_CNT += 1;              /* increment it */
     if (HIDE_CNT == 1) {        /* if cursor was not hidden... */
         cur_replace(mcs_ptr);   /* remove the cursor from screen */
@@ -165,6 +208,39 @@ static void hide_cur(void)
 
 
 
+#if CONF_WITH_MOUSE_EXCLUSION
+/*
+ * hide_cur_rect
+ *
+ * Like hide_cur(), but for drawing that will be confined to the
+ * specified rectangle.  If the cursor is currently displayed outside
+ * the rectangle, it is left on the screen (see excl_active above).
+ * If the cursor is already hidden, this is the same as hide_cur().
+ */
+static void hide_cur_rect(const Rect *rect)
+{
+    WORD old_sr;
+
+    old_sr = set_sr(0x2700);    /* keep the VBL routine out */
+    if ((HIDE_CNT == 0) && !excl_active)
+    {
+        excl_rect = *rect;
+        if (!(mcs_ptr->stat & MCS_VALID) || !cursor_in_excl_rect(cur_x, cur_y))
+        {
+            excl_active = TRUE;
+            HIDE_CNT = 1;
+            set_sr(old_sr);
+            return;
+        }
+    }
+    set_sr(old_sr);
+
+    hide_cur();                 /* including nested calls */
+}
+#endif
+
+
+
 /*
  * gloc_key - get locator key
  *
@@ -325,11 +401,68 @@ void vdi_v_show_c(Vwk * vwk)
  */
 void vdi_v_hide_c(Vwk * vwk)
 {
+#if CONF_WITH_MOUSE_EXCLUSION
+    /*
+     * EmuTOS extension: if PTSIN contains a rectangle, the caller will
+     * only draw within it (see hide_cur_rect())
+     */
+    if (CONTRL[1] >= 2)
+    {
+        Rect rect = *(Rect *)PTSIN;
+
+        arb_corner(&rect);
+        hide_cur_rect(&rect);
+        return;
+    }
+#endif
+
     linea_hide_mouse();
 }
 
 
 
+#if CONF_WITH_VDI_SCRNINFO
+/*
+ * vdi_v_lockscreen - lock/unlock the screen for direct drawing
+ * (EmuTOS-specific escape)
+ *
+ * input:
+ *     CONTRL[1] = 0, or 2 if PTSIN contains a rectangle
+ *     CONTRL[5] = V_LOCKSCREEN_ESC
+ *     INTIN[0] = 1 to lock, 0 to unlock
+ *     PTSIN[0-3] = if present, the rectangle that is drawn in
+ *
+ * Locking hides the mouse cursor (like v_hide_c(), including the
+ * rectangle) and waits until any blit by the VDI has finished, so that
+ * the application can then write to the bitmap described by
+ * vq_scrninfo().  Unlocking shows the cursor again and, on the Amiga,
+ * gets the drawn lines (or the whole screen) converted for display.
+ * Calls may be nested, but locks and unlocks must be balanced.
+ */
+void vdi_v_lockscreen(Vwk * vwk)
+{
+    if (INTIN[0])
+    {
+#if CONF_WITH_BLITTER
+        hwblit_sync();
+#endif
+        vdi_v_hide_c(vwk);
+        return;
+    }
+
+#if CONF_WITH_AMIGA_PLANAR
+    if (CONTRL[1] >= 2)
+        amiga_screen_dirty(PTSIN[1], PTSIN[3]);
+    else
+        amiga_screen_dirty(0, V_REZ_VT - 1);
+#endif
+
+    dis_cur();
+}
+#endif
+
+
+
 /*
  * vdi_vq_mouse - Query mouse position and button status
  */
@@ -665,7 +798,11 @@ static void vb_draw(void)
     WORD old_sr, x, y;
 
     /* if the cursor is being modified, or is hidden, just exit */
+#if CONF_WITH_MOUSE_EXCLUSION
+    if (mouse_flag || (HIDE_CNT && !excl_active))
+#else
     if (mouse_flag || HIDE_CNT)
+#endif
         return;
 
     old_sr = set_sr(0x2700);        /* disable interrupts */
@@ -675,6 +812,12 @@ static void vb_draw(void)
         y = newy;
         set_sr(old_sr);
         cur_replace(mcs_ptr);       /* remove the old cursor from the screen */
+#if CONF_WITH_MOUSE_EXCLUSION
+        /* don't display it within the mouse-excluding rectangle */
+        if (excl_active
+         && cursor_in_excl_rect(x - mouse_cdb.xhot, y - mouse_cdb.yhot))
+            return;
+#endif
         cur_display(&mouse_cdb, mcs_ptr, x, y); /* display the cursor */
     } else
         set_sr(old_sr);
@@ -767,6 +910,95 @@ static void cur_display_clip(WORD op,Mcdb *sprite,MCS *mcs,UWORD *mask_start,UWO
     } /* loop through planes */
 }
 
+#if CONF_WITH_VDI_16BIT
+/*
+ * cur_display_truecolor() - cur_display() for the 16-bit video mode
+ *
+ * the visible part of the cursor is saved a pixel per word, so the
+ * extended save area (128 longs) is just large enough
+ */
+static void cur_display_truecolor(Mcdb *sprite, MCS *mcs, WORD x, WORD y)
+{
+    const UWORD fg = truecolor_palette[sprite->fg_col & 0xff];
+    const UWORD bg = truecolor_palette[sprite->bg_col & 0xff];
+    const WORD dst_inc = v_lin_wr / sizeof(UWORD);
+    const UWORD *src = sprite->maskdata;
+    UWORD *dst, *save = (UWORD *)mcs->area;
+    UWORD bg_bits, fg_bits, bit;
+    WORD row, col, skip, width, height;
+
+    x -= sprite->xhot;          /* x = left side of destination block */
+    y -= sprite->yhot;          /* y = top of destination block */
+
+#if CONF_WITH_MOUSE_EXCLUSION
+    if (mcs == mcs_ptr) {       /* remember where the mouse cursor is */
+        cur_x = x;
+        cur_y = y;
+    }
+#endif
+
+    mcs->stat = 0x00;           /* reset status of save buffer */
+
+    /* clip the 16x16 block to the screen */
+    skip = 0;
+    width = 16;
+    if (x < 0) {
+        skip = -x;
+        width -= skip;
+        x = 0;
+    }
+    if (x + width > xres + 1)
+        width = xres + 1 - x;
+
+    height = 16;
+    if (y < 0) {
+        src -= y << 1;          /* point to first visible row of MASK/FORM */
+        height += y;
+        y = 0;
+    }
+    if (y + height > yres + 1)
+        height = yres + 1 - y;
+
+    if ((width <= 0) || (height <= 0))
+        return;
+
+    dst = (UWORD *)(v_bas_ad + muls(y, v_lin_wr)) + x;
+
+    /* store values required by cur_replace() */
+    mcs->len = height;
+    mcs->width = width;
+    mcs->addr = dst;
+    mcs->stat = MCS_VALID;
+
+    for (row = height; row > 0; row--, dst += dst_inc) {
+        bg_bits = *src++ << skip;
+        fg_bits = *src++ << skip;
+        for (col = 0, bit = 0x8000; col < width; col++, bit >>= 1) {
+            *save++ = dst[col];
+            if (fg_bits & bit)
+                dst[col] = fg;
+            else if (bg_bits & bit)
+                dst[col] = bg;
+        }
+    }
+}
+
+/*
+ * cur_replace_truecolor() - cur_replace() for the 16-bit video mode
+ */
+static void cur_replace_truecolor(MCS *mcs)
+{
+    const WORD dst_inc = v_lin_wr / sizeof(UWORD);
+    const UWORD *src = (const UWORD *)mcs->area;
+    UWORD *dst = mcs->addr;
+    WORD row, col;
+
+    for (row = mcs->len; row > 0; row--, dst += dst_inc)
+        for (col = 0; col < mcs->width; col++)
+            dst[col] = *src++;
+}
+#endif
+
 /*
  * cur_display() - blits a "cursor" to the destination
  *
@@ -791,9 +1023,23 @@ void cur_display (Mcdb *sprite, MCS *mcs, WORD x, WORD y)
     UWORD cdb_mask;             /* for checking cdb_bg/cdb_fg */
     ULONG *save;
 
+#if CONF_WITH_VDI_16BIT
+    if (TRUECOLOR_MODE) {
+        cur_display_truecolor(sprite, mcs, x, y);
+        return;
+    }
+#endif
+
     x -= sprite->xhot;          /* x = left side of destination block */
     y -= sprite->yhot;          /* y = top of destination block */
 
+#if CONF_WITH_MOUSE_EXCLUSION
+    if (mcs == mcs_ptr) {       /* remember where the mouse cursor is */
+        cur_x = x;
+        cur_y = y;
+    }
+#endif
+
     mcs->stat = 0x00;           /* reset status of save buffer */
 
     /*
@@ -841,6 +1087,10 @@ void cur_display (Mcdb *sprite, MCS *mcs, WORD x, WORD y)
     mcs->addr = addr;           /* save area: origin of material */
     mcs->stat |= MCS_VALID;     /* flag the buffer as being loaded */
 
+#if CONF_WITH_AMIGA_PLANAR
+    amiga_screen_dirty(y, y + row_count - 1);
+#endif
+
     /*
      *  To allow performance optimisations in this function, we handle
      *  L/R clipping in a separate function
@@ -943,9 +1193,21 @@ void cur_replace (MCS *mcs)
         return;
     mcs->stat &= ~MCS_VALID;        /* yes but (like TOS) don't allow reuse */
 
+#if CONF_WITH_VDI_16BIT
+    if (TRUECOLOR_MODE) {
+        cur_replace_truecolor(mcs);
+        return;
+    }
+#endif
+
     addr = mcs->addr;
     src = (UWORD *)mcs->area;
 
+#if CONF_WITH_AMIGA_PLANAR
+    row = (WORD)(((UBYTE *)addr - v_bas_ad) / v_lin_wr);
+    amiga_screen_dirty(row, row + mcs->len - 1);
+#endif
+
     /*
      * handle longword data
      */
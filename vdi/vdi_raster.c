@@ -11,13 +11,16 @@
 /* #define ENABLE_KDEBUG */
 
 #include "emutos.h"
+#include "intmath.h"
 #include "vdi_defs.h"
 #include "vdistub.h"
 #include "blitter.h"
 #include "biosext.h"    /* for cache control routines */
 #include "lineavars.h"
 #include "tosvars.h"
+#include "gemdos.h"
 #include "has.h"        /* for blitter-related items */
+#include "string.h"
 
 #ifdef __mcoldfire__
 #define ASM_BLIT_IS_AVAILABLE   0   /* assembler routine does not support ColdFire */
@@ -159,20 +162,6 @@ struct blit_frame {
     WORD src_wr;        /* +74 source form wrap (in bytes) */
 };
 
-/* Raster definitions */
-typedef struct {
-    void *fd_addr;
-    WORD fd_w;
-    WORD fd_h;
-    WORD fd_wdwidth;
-    WORD fd_stand;
-    WORD fd_nplanes;
-    WORD fd_r1;
-    WORD fd_r2;
-    WORD fd_r3;
-} MFDB;
-
-
 #if ASM_BLIT_IS_AVAILABLE
 void fast_bit_blt(struct blit_frame *blit_info);    /* defined in vdi_blit.S */
 #endif
@@ -181,6 +170,106 @@ void fast_bit_blt(struct blit_frame *blit_info);    /* defined in vdi_blit.S */
 static struct blit_frame vdi_info;
 
 
+/*
+ * trnfm_groups - not-in-place vr_trnfm() for 1, 2, 4 or 8 planes
+ *
+ * in device-dependent form, the words for the same 16 pixels in each
+ * plane are adjacent, so rather than scattering one plane at a time,
+ * we transform a group of 16 pixels (one word from every plane) per
+ * step, keeping a pointer into each plane of the standard form data.
+ * on an Apollo 68080, the device-dependent side is moved as longwords.
+ *
+ * returns FALSE if the number of planes is not handled here.
+ */
+static BOOL trnfm_groups(WORD *src, WORD *dst, WORD planes, LONG size, BOOL tostd)
+{
+    UWORD *plane[8], *dev;
+    LONG i;
+    WORD j;
+
+    if (planes == 1) {          /* both forms are the same */
+        memcpy(dst, src, size * sizeof(WORD));
+        return TRUE;
+    }
+
+    if ((planes != 2) && (planes != 4) && (planes != 8))
+        return FALSE;
+
+    /* the standard form data has one plane after another */
+    for (j = 0; j < planes; j++)
+        plane[j] = (UWORD *)(tostd ? dst : src) + j * size;
+    dev = (UWORD *)(tostd ? src : dst);
+
+#if CONF_WITH_APOLLO_68080
+    if (IS_APOLLO_68080) {
+        ULONG *ldev = (ULONG *)dev;
+
+        if (tostd) {
+            for (i = 0; i < size; i++) {
+                for (j = 0; j < planes; j += 2) {
+                    ULONG data = *ldev++;
+                    *plane[j]++ = data >> 16;
+                    *plane[j+1]++ = data;
+                }
+            }
+        } else {
+            for (i = 0; i < size; i++) {
+                for (j = 0; j < planes; j += 2)
+                    *ldev++ = ((ULONG)*plane[j]++ << 16) | *plane[j+1]++;
+            }
+        }
+        return TRUE;
+    }
+#endif
+
+    if (planes == 2) {
+        UWORD *p0 = plane[0], *p1 = plane[1];
+
+        if (tostd) {
+            for (i = size; i > 0; i--) {
+                *p0++ = *dev++;
+                *p1++ = *dev++;
+            }
+        } else {
+            for (i = size; i > 0; i--) {
+                *dev++ = *p0++;
+                *dev++ = *p1++;
+            }
+        }
+    } else if (planes == 4) {
+        UWORD *p0 = plane[0], *p1 = plane[1], *p2 = plane[2], *p3 = plane[3];
+
+        if (tostd) {
+            for (i = size; i > 0; i--) {
+                *p0++ = *dev++;
+                *p1++ = *dev++;
+                *p2++ = *dev++;
+                *p3++ = *dev++;
+            }
+        } else {
+            for (i = size; i > 0; i--) {
+                *dev++ = *p0++;
+                *dev++ = *p1++;
+                *dev++ = *p2++;
+                *dev++ = *p3++;
+            }
+        }
+    } else {                    /* 8 planes */
+        if (tostd) {
+            for (i = size; i > 0; i--)
+                for (j = 0; j < 8; j++)
+                    *plane[j]++ = *dev++;
+        } else {
+            for (i = size; i > 0; i--)
+                for (j = 0; j < 8; j++)
+                    *dev++ = *plane[j]++;
+        }
+    }
+
+    return TRUE;
+}
+
+
 /*
  * vdi_vr_trnfm - transform screen bitmaps
  *
@@ -193,7 +282,7 @@ static struct blit_frame vdi_info;
 void vdi_vr_trnfm(Vwk * vwk)
 {
     MFDB *src_mfdb, *dst_mfdb;
-    WORD *src, *dst, *work;
+    WORD *src, *dst, *work, *copy = NULL;
     WORD planes;
     BOOL inplace;
     LONG size, inner, outer, i, j;
@@ -221,16 +310,37 @@ void vdi_vr_trnfm(Vwk * vwk)
         inner = planes;
     }
 
+    /*
+     * for an in-place transform, we transform from a temporary copy of
+     * the source if we can get one, since that is much faster than
+     * shuffling the data around within the bitmap
+     */
+    if (inplace && (planes > 1))
+    {
+        copy = dos_alloc_anyram(size * planes * sizeof(WORD));
+        if (copy)
+        {
+            memcpy(copy, src, size * planes * sizeof(WORD));
+            src = copy;
+            inplace = FALSE;
+        }
+    }
+
     if (!inplace)               /* the simple option */
     {
-        for (i = 0; i < outer; i++, dst++)
+        if (!trnfm_groups(src, dst, planes, size, dst_mfdb->fd_stand))
         {
-            for (j = 0, work = dst; j < inner; j++)
+            for (i = 0; i < outer; i++, dst++)
             {
-                *work = *src++;
-                work += outer;
+                for (j = 0, work = dst; j < inner; j++)
+                {
+                    *work = *src++;
+                    work += outer;
+                }
             }
         }
+        if (copy)
+            dos_free(copy);
         return;
     }
 
@@ -282,6 +392,7 @@ hwblit_raster(BLITVARS *blt)
      * routines ignore it & act on the whole cache anyway.
      */
     length = (blt->y_cnt * blt->dst_y_inc) + (blt->x_cnt * blt->dst_x_inc);
+    hwblit_sync();
     flush_data_cache((void *)blt->dst_addr,length);
 
     BLITTER->src_x_incr = blt->src_x_inc;
@@ -299,32 +410,70 @@ hwblit_raster(BLITVARS *blt)
     BLITTER->hop = blt->hop;
     BLITTER->skew = blt->skew;
 
-    /*
-     * we run the blitter in the Atari-recommended way: use no-HOG mode,
-     * and manually restart the blitter until it's done.
-     */
-    BLITTER->status = BUSY;     /* no-HOG mode */
-    __asm__ __volatile__(
-    "lea    0xFFFF8A3C,a0\n\t"
-    "0:\n\t"
-    "tas    (a0)\n\t"
-    "nop\n\t"
-    "jbmi   0b\n\t"
-    :
-    :
-    : "a0", "memory", "cc"
-    );
+    hwblit_start(BUSY);     /* no-HOG mode */
 
     /*
      * we've modified data behind the cpu's back, so we must
-     * invalidate any cached data.
+     * invalidate any cached data when the blitter has finished
      */
-    invalidate_data_cache((void *)blt->dst_addr,length);
+    hwblit_end((void *)blt->dst_addr,length);
 }
 #endif
 
 
 #if !ASM_BLIT_IS_AVAILABLE
+/*
+ * template for specialised versions of do_blit() for the most common
+ * logic ops, when source and destination have the same alignment (i.e.
+ * the skew is zero).  in this case, each destination word is combined
+ * with the corresponding source word, whatever the FXSR/NFSR flags are
+ * set to, and the addresses finish in the same place as with do_blit().
+ *
+ * OP(s,d) returns the result for source word s and destination word d;
+ * it need not use both of them.
+ */
+#define ALIGNED_BLIT(name, OP)                                              \
+static void name(BLITVARS *blt)                                             \
+{                                                                           \
+    UWORD *src = (UWORD *)blt->src_addr;                                    \
+    UWORD *dst = (UWORD *)blt->dst_addr;                                    \
+    WORD src_x_inc = blt->src_x_inc, dst_x_inc = blt->dst_x_inc;            \
+    UWORD end_1 = blt->end_1, end_3 = blt->end_3;                           \
+    UWORD dst_in, xc;                                                       \
+                                                                            \
+    do {                                                                    \
+        dst_in = *dst;                                                      \
+        *dst = (OP(*src, dst_in) & end_1) | (dst_in & ~end_1);              \
+        if (blt->x_cnt > 1) {                                               \
+            for (xc = blt->x_cnt - 2; xc > 0; xc--) {                       \
+                src = (UWORD *)((UBYTE *)src + src_x_inc);                  \
+                dst = (UWORD *)((UBYTE *)dst + dst_x_inc);                  \
+                *dst = OP(*src, *dst);                                      \
+            }                                                               \
+            src = (UWORD *)((UBYTE *)src + src_x_inc);                      \
+            dst = (UWORD *)((UBYTE *)dst + dst_x_inc);                      \
+            dst_in = *dst;                                                  \
+            *dst = (OP(*src, dst_in) & end_3) | (dst_in & ~end_3);          \
+        }                                                                   \
+        src = (UWORD *)((UBYTE *)src + blt->src_y_inc);                     \
+        dst = (UWORD *)((UBYTE *)dst + blt->dst_y_inc);                     \
+    } while(--blt->y_cnt != 0);                                             \
+                                                                            \
+    blt->src_addr = (ULONG)src;                                             \
+    blt->dst_addr = (ULONG)dst;                                             \
+}
+
+#define OP_S_ONLY(s,d)  (s)
+#define OP_S_AND_D(s,d) ((s) & (d))
+#define OP_S_XOR_D(s,d) ((s) ^ (d))
+#define OP_NOT_D(s,d)   (~(d))
+
+ALIGNED_BLIT(aligned_blit_s_only, OP_S_ONLY)
+ALIGNED_BLIT(aligned_blit_s_and_d, OP_S_AND_D)
+ALIGNED_BLIT(aligned_blit_s_xor_d, OP_S_XOR_D)
+ALIGNED_BLIT(aligned_blit_not_d, OP_NOT_D)
+
+
 /*
  * the following is a modified version of a blitter emulator, with the HOP
  * processing removed since it is always called with a HOP value of 2 (source)
@@ -338,6 +487,24 @@ do_blit(BLITVARS * blt)
     UWORD   xc;
 
     KDEBUG(("do_blit(): Start\n"));
+
+    /* use a specialised version if possible */
+    if ((blt->skew & SKEW) == 0) {
+        switch (blt->op & 0xf) {
+        case BM_S_ONLY:
+            aligned_blit_s_only(blt);
+            return;
+        case BM_S_AND_D:
+            aligned_blit_s_and_d(blt);
+            return;
+        case BM_S_XOR_D:
+            aligned_blit_s_xor_d(blt);
+            return;
+        case BM_NOT_D:
+            aligned_blit_not_d(blt);
+            return;
+        }
+    }
     /*
      * note: because HOP is always set to source, the halftone RAM
      * and the starting halftone line number (status&0x0f) are not
@@ -662,7 +829,7 @@ static void bit_blt(struct blit_frame *blit_info)
          */
 #if !ASM_BLIT_IS_AVAILABLE
 #if CONF_WITH_BLITTER
-        if (blitter_is_enabled)
+        if (hwblit_wanted(blit_info->b_wd, blit_info->b_ht, 1))
         {
             hwblit_raster(blt);
         }
@@ -864,10 +1031,144 @@ setup_info (struct raster_t *raster, struct blit_frame * info)
     info->s_nxpl = 2;           /* next plane offset (source) */
     info->d_nxpl = 2;           /* next plane offset (destination) */
 
+#if CONF_WITH_VDI_16BIT
+    /* 16-bit (truecolour) forms are valid in 16-bit mode */
+    if (TRUECOLOR_MODE && (info->plane_ct == 16))
+        return FALSE;
+#endif
+
     /* only 8, 4, 2 and 1 planes are valid (destination) */
     return info->plane_ct & ~0x000f;
 }
 
+#if CONF_WITH_VDI_16BIT
+/*
+ * truecolor_logic_op - apply one of the 16 logic operations to a pair
+ * of 16-bit pixels
+ */
+static UWORD truecolor_logic_op(WORD op, UWORD s, UWORD d)
+{
+    switch(op) {
+    case 0:  return 0;
+    case 1:  return s & d;
+    case 2:  return s & ~d;
+    case 3:  return s;
+    case 4:  return ~s & d;
+    case 5:  return d;
+    case 6:  return s ^ d;
+    case 7:  return s | d;
+    case 8:  return ~(s | d);
+    case 9:  return ~(s ^ d);
+    case 10: return ~d;
+    case 11: return s | ~d;
+    case 12: return ~s;
+    case 13: return ~s | d;
+    case 14: return ~(s & d);
+    }
+
+    return 0xffff;
+}
+
+/*
+ * truecolor_opaque_blit - copy a 16-bit form to a 16-bit form
+ *
+ * source and destination may overlap, so when the destination is
+ * above the source we work backwards, from the last pixel
+ */
+static void truecolor_opaque_blit(const struct blit_frame *info, WORD op)
+{
+    UBYTE *src, *dst;
+    UWORD *s, *d;
+    WORD s_nxln = info->s_nxln;
+    WORD d_nxln = info->d_nxln;
+    WORD n, y, step = 1;
+
+    src = (UBYTE *)info->s_form + muls(info->s_ymin, s_nxln) + info->s_xmin * sizeof(UWORD);
+    dst = (UBYTE *)info->d_form + muls(info->d_ymin, d_nxln) + info->d_xmin * sizeof(UWORD);
+
+    if (dst > src)
+    {
+        src += muls(info->b_ht - 1, s_nxln);
+        dst += muls(info->b_ht - 1, d_nxln);
+        s_nxln = -s_nxln;
+        d_nxln = -d_nxln;
+        step = -1;
+    }
+
+    for (y = info->b_ht; y > 0; y--, src += s_nxln, dst += d_nxln)
+    {
+        if (op == 3)    /* plain copy */
+        {
+            memmove(dst, src, info->b_wd * sizeof(UWORD));
+            continue;
+        }
+
+        s = (UWORD *)src;
+        d = (UWORD *)dst;
+        if (step < 0)
+        {
+            s += info->b_wd - 1;
+            d += info->b_wd - 1;
+        }
+        for (n = info->b_wd; n > 0; n--, s += step, d += step)
+            *d = truecolor_logic_op(op, *s, *d);
+    }
+}
+
+/*
+ * truecolor_trans_blit - copy a monochrome form to a 16-bit form
+ *
+ * set source bits are drawn in the foreground colour, and clear bits
+ * in the background colour, according to the writing mode
+ */
+static void truecolor_trans_blit(const struct blit_frame *info, WORD mode, UWORD fg, UWORD bg)
+{
+    const UWORD firstbit = 0x8000 >> (info->s_xmin & 0x0f);
+    const UWORD *src, *s;
+    UWORD *dst, *d;
+    UWORD bit;
+    WORD n, y;
+
+    src = (const UWORD *)((UBYTE *)info->s_form + muls(info->s_ymin, info->s_nxln)) + (info->s_xmin >> 4);
+    dst = (UWORD *)((UBYTE *)info->d_form + muls(info->d_ymin, info->d_nxln)) + info->d_xmin;
+
+    for (y = info->b_ht; y > 0; y--)
+    {
+        s = src;
+        d = dst;
+        bit = firstbit;
+        for (n = info->b_wd; n > 0; n--, d++)
+        {
+            switch(mode) {
+            case MD_TRANS:
+                if (*s & bit)
+                    *d = fg;
+                break;
+            case MD_REPLACE:
+                *d = (*s & bit) ? fg : bg;
+                break;
+            case MD_XOR:
+                if (*s & bit)
+                    *d = ~*d;
+                break;
+            case MD_ERASE:
+                if (!(*s & bit))
+                    *d = bg;
+                break;
+            }
+            bit >>= 1;
+            if (!bit)
+            {
+                bit = 0x8000;
+                s++;
+            }
+        }
+        src = (const UWORD *)((const UBYTE *)src + info->s_nxln);
+        dst = (UWORD *)((UBYTE *)dst + info->d_nxln);
+    }
+}
+#endif
+
 /* common functionality for vdi_vro_cpyfm, vdi_vrt_cpyfm, linea_raster */
 static void
 cpy_raster(struct raster_t *raster, struct blit_frame *info)
@@ -902,6 +1203,14 @@ cpy_raster(struct raster_t *raster, struct blit_frame *info)
         if (info->s_nxwd != info->d_nxwd)
             return;
 
+#if CONF_WITH_VDI_16BIT
+        if (info->plane_ct == 16)
+        {
+            truecolor_opaque_blit(info, mode);
+            return;
+        }
+#endif
+
         info->op_tab[0] = mode; /* fg:0 bg:0 */
         info->bg_col = 0;       /* bg:0 & fg:0 => only first OP_TAB */
         info->fg_col = 0;       /* entry will be referenced */
@@ -962,6 +1271,14 @@ cpy_raster(struct raster_t *raster, struct blit_frame *info)
         default:
             return;                     /* unsupported mode */
         }
+
+#if CONF_WITH_VDI_16BIT
+        if (info->plane_ct == 16)
+        {
+            truecolor_trans_blit(info, mode, truecolor_palette[fg_col], truecolor_palette[bg_col]);
+            return;
+        }
+#endif
     }
 
     /*
@@ -972,7 +1289,7 @@ cpy_raster(struct raster_t *raster, struct blit_frame *info)
      */
 #if ASM_BLIT_IS_AVAILABLE
 #if CONF_WITH_BLITTER
-    if (blitter_is_enabled)
+    if (hwblit_wanted(info->b_wd, info->b_ht, info->plane_ct))
     {
         bit_blt(info);
     }
@@ -984,6 +1301,11 @@ cpy_raster(struct raster_t *raster, struct blit_frame *info)
 #else
     bit_blt(info);
 #endif
+
+#if CONF_WITH_AMIGA_PLANAR
+    if (info->d_form == (UWORD *)v_bas_ad)
+        amiga_screen_dirty(info->d_ymin, info->d_ymax);
+#endif
 }
 
 /*
@@ -1061,7 +1383,7 @@ void linea_blit(struct blit_frame *info)
      */
 #if ASM_BLIT_IS_AVAILABLE
 #if CONF_WITH_BLITTER
-    if (blitter_is_enabled)
+    if (hwblit_wanted(info->b_wd, info->b_ht, info->plane_ct))
     {
         bit_blt(info);
     }
@@ -1073,4 +1395,99 @@ void linea_blit(struct blit_frame *info)
 #else
     bit_blt(info);
 #endif
+
+#if CONF_WITH_AMIGA_PLANAR
+    if (info->d_form == (UWORD *)v_bas_ad)
+        amiga_screen_dirty(info->d_ymin, info->d_ymax);
+#endif
 }
+
+#if CONF_WITH_VDI_MARKER_STAMPS
+/*
+ * draw_stamp - draw a monochrome form on the screen in transparent mode
+ *
+ * this is used by v_pmarker(): the form, which is 'wdwidth' words wide,
+ * is drawn at x,y with size w,h in the specified (already mapped)
+ * colour, clipped to the clipping rectangle.  a form that is clipped
+ * away entirely is rejected before any blit setup is done.
+ */
+void draw_stamp(const VwkClip *clipper, UWORD *form, WORD wdwidth,
+                WORD x, WORD y, WORD w, WORD h, UWORD color)
+{
+    struct blit_frame info;
+    WORD s_xmin = 0, s_ymin = 0;
+    WORD d_xmax = x + w - 1, d_ymax = y + h - 1;
+
+    if ((x > clipper->xmx_clip) || (d_xmax < clipper->xmn_clip)
+     || (y > clipper->ymx_clip) || (d_ymax < clipper->ymn_clip))
+        return;
+
+    if (x < clipper->xmn_clip) {
+        s_xmin = clipper->xmn_clip - x;
+        x = clipper->xmn_clip;
+    }
+    if (d_xmax > clipper->xmx_clip)
+        d_xmax = clipper->xmx_clip;
+    if (y < clipper->ymn_clip) {
+        s_ymin = clipper->ymn_clip - y;
+        y = clipper->ymn_clip;
+    }
+    if (d_ymax > clipper->ymx_clip)
+        d_ymax = clipper->ymx_clip;
+
+    info.b_wd = d_xmax - x + 1;
+    info.b_ht = d_ymax - y + 1;
+    info.plane_ct = v_planes;
+    info.fg_col = color;
+    info.bg_col = 0;
+    info.op_tab[0] = 04;        /* fg:0 bg:0  D' <- [not S] and D */
+    info.op_tab[2] = 07;        /* fg:1 bg:0  D' <- S or D */
+
+    info.s_xmin = s_xmin;
+    info.s_ymin = s_ymin;
+    info.s_xmax = s_xmin + info.b_wd - 1;
+    info.s_ymax = s_ymin + info.b_ht - 1;
+    info.s_form = form;
+    info.s_nxwd = 2;
+    info.s_nxln = wdwidth * 2;
+    info.s_nxpl = 0;            /* use only one plane of source */
+
+    info.d_xmin = x;
+    info.d_ymin = y;
+    info.d_xmax = d_xmax;
+    info.d_ymax = d_ymax;
+    info.d_form = (UWORD *)v_bas_ad;
+    info.d_nxwd = v_planes * 2;
+    info.d_nxln = v_lin_wr;
+    info.d_nxpl = 2;
+
+    info.p_addr = NULL;
+
+#if CONF_WITH_VDI_16BIT
+    if (TRUECOLOR_MODE)
+    {
+        truecolor_trans_blit(&info, MD_TRANS, truecolor_palette[color], truecolor_palette[0]);
+        return;
+    }
+#endif
+
+#if ASM_BLIT_IS_AVAILABLE
+#if CONF_WITH_BLITTER
+    if (hwblit_wanted(info.b_wd, info.b_ht, info.plane_ct))
+    {
+        bit_blt(&info);
+    }
+    else
+#endif
+    {
+        fast_bit_blt(&info);
+    }
+#else
+    bit_blt(&info);
+#endif
+
+#if CONF_WITH_AMIGA_PLANAR
+    amiga_screen_dirty(info.d_ymin, info.d_ymax);
+#endif
+}
+#endif
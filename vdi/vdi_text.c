@@ -154,6 +154,160 @@ static void make_header(Vwk * vwk);
 static UWORD clc_dda(Vwk * vwk, UWORD act, UWORD req);
 static UWORD act_siz(Vwk * vwk, UWORD top);
 
+#if CONF_WITH_VDI_FONT_INDEX
+/*
+ * font face index
+ *
+ * this maps a face id to the first font of that face in font_ring[],
+ * and to the font_ring[] entry following the chain that contains it.
+ * it is sorted by face id so that vst_font(), vst_height() & vst_point()
+ * can find a face by binary search, rather than by walking the chains
+ * (which may be long with GDOS fonts).  it is rebuilt whenever font_ring[]
+ * changes.  if there are more faces than will fit, face_count is set to
+ * -1, and the chains are walked as before.
+ */
+#define MAX_INDEXED_FACES   32
+
+typedef struct {
+    WORD font_id;
+    const Fonthead *font;       /* first font of this face */
+    const Fonthead **chain;     /* font_ring[] entry after its chain */
+} FACEINDEX;
+
+static FACEINDEX face_index[MAX_INDEXED_FACES];
+static WORD face_count;
+
+/*
+ * width table for proportional fonts
+ *
+ * this holds the width of each character of the font whose offset
+ * table is width_src, so that calc_width() need not compute it from
+ * the offset table for every character of a long string.  it is only
+ * built for strings of at least MIN_WIDTH_STRING characters, and not
+ * for fonts with characters wider than 255 pixels.
+ */
+#define MIN_WIDTH_STRING    16
+
+static UBYTE width_table[256];
+static const UWORD *width_src;
+
+/*
+ * return the index of the first face_index[] entry with an id
+ * greater than or equal to font_id
+ */
+static WORD face_slot(WORD font_id)
+{
+    WORD lo = 0, hi = face_count, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) >> 1;
+        if (face_index[mid].font_id < font_id)
+            lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+/*
+ * (re)build the face index from font_ring[], and discard the width table
+ */
+static void build_font_index(void)
+{
+    const Fonthead *fnt_ptr, **chain_ptr;
+    FACEINDEX *p;
+    WORD i;
+
+    width_src = NULL;
+    face_count = 0;
+
+    chain_ptr = font_ring;
+    while ((fnt_ptr = *chain_ptr++)) {
+        do {
+            i = face_slot(fnt_ptr->font_id);
+            p = &face_index[i];
+            if ((i < face_count) && (p->font_id == fnt_ptr->font_id))
+                continue;       /* already have this face */
+            if (face_count >= MAX_INDEXED_FACES) {
+                face_count = -1;    /* too many faces, don't use index */
+                return;
+            }
+            memmove(p+1, p, (face_count-i)*sizeof(FACEINDEX));
+            p->font_id = fnt_ptr->font_id;
+            p->font = fnt_ptr;
+            p->chain = chain_ptr;
+            face_count++;
+        } while ((fnt_ptr = fnt_ptr->next_font));
+    }
+}
+
+/*
+ * build the width table for the specified font
+ *
+ * returns FALSE if the font cannot use a width table
+ */
+static BOOL build_width_table(const Fonthead *fnt_ptr)
+{
+    const UWORD *off = fnt_ptr->off_table;
+    WORD i, n, w;
+
+    width_src = NULL;
+
+    n = fnt_ptr->last_ade - fnt_ptr->first_ade + 1;
+    if ((n <= 0) || (n > 256))
+        return FALSE;
+
+    for (i = 0; i < n; i++, off++) {
+        w = off[1] - off[0];
+        if ((w < 0) || (w > 255))
+            return FALSE;
+        width_table[i] = w;
+    }
+    for ( ; i < 256; i++)
+        width_table[i] = 0;
+
+    width_src = fnt_ptr->off_table;
+
+    return TRUE;
+}
+#endif
+
+/*
+ * find the first font in font_ring[] with the specified face id
+ *
+ * returns a pointer to the font (or NULL if there is none), and sets
+ * *chain to point to the font_ring[] entry following its chain
+ */
+static const Fonthead *find_face(WORD font_id, const Fonthead ***chain)
+{
+    const Fonthead *test_font, **chain_ptr;
+
+#if CONF_WITH_VDI_FONT_INDEX
+    if (face_count >= 0) {
+        WORD i = face_slot(font_id);
+        FACEINDEX *p = &face_index[i];
+
+        if ((i < face_count) && (p->font_id == font_id)) {
+            *chain = p->chain;
+            return p->font;
+        }
+        return NULL;
+    }
+#endif
+
+    chain_ptr = font_ring;
+    while ((test_font = *chain_ptr++)) {
+        do {
+            if (test_font->font_id == font_id) {
+                *chain = chain_ptr;
+                return test_font;
+            }
+        } while ((test_font = test_font->next_font));
+    }
+
+    return NULL;
+}
+
 /*
  * calculates height of text string
  */
@@ -183,6 +337,16 @@ static WORD calc_width(Vwk *vwk, WORD cnt, WORD *str)
     {
         width = cnt * (fnt_ptr->off_table[1]-fnt_ptr->off_table[0]);
     }
+#if CONF_WITH_VDI_FONT_INDEX
+    else if ((fnt_ptr->off_table == width_src)
+          || ((cnt >= MIN_WIDTH_STRING) && build_width_table(fnt_ptr)))
+    {
+        for (i = 0, width = 0; i < cnt; i++) {
+            chr = *str++ - table_start;
+            width += width_table[chr & 0xff];
+        }
+    }
+#endif
     else
     {
         for (i = 0, width = 0; i < cnt; i++) {
@@ -217,7 +381,6 @@ static WORD calc_width(Vwk *vwk, WORD cnt, WORD *str)
  * the following must all be true:
  *  there are no effects
  *  there is no rotation
- *  the output is left-aligned
  *  the output is not justified
  *  the characters are byte-aligned
  *  the font is monospace with a cell width of 8
@@ -229,7 +392,7 @@ static BOOL ok_for_direct_blit(Vwk *vwk, WORD width, JUSTINFO *justified)
     const Fonthead *fnt_ptr;
     WORD xmin, xmax, ymin, ymax;
 
-    if (vwk->style | vwk->chup | vwk->h_align)
+    if (vwk->style | vwk->chup)
         return FALSE;
 
     if (justified)
@@ -579,6 +742,9 @@ void text_init2(Vwk * vwk)
 
     font_ring[2] = vwk->loaded_fonts;
     DEV_TAB[10] = vwk->num_fonts;
+#if CONF_WITH_VDI_FONT_INDEX
+    build_font_index();
+#endif
 }
 
 void text_init(void)
@@ -652,6 +818,9 @@ void text_init(void)
     }
     DEV_TAB[5] = i;                     /* number of sizes */
     font_count = DEV_TAB[10] = ++j;     /* number of faces */
+#if CONF_WITH_VDI_FONT_INDEX
+    build_font_index();
+#endif
 }
 
 /*
@@ -676,21 +845,12 @@ void vdi_vst_height(Vwk * vwk)
     const Fonthead *test_font, *single_font;
     WORD font_id;
     UWORD test_height;
-    BOOL found;
 
     font_id = vwk->cur_font->font_id;
     vwk->pts_mode = FALSE;
 
     /* Find the smallest font in the requested face */
-    chain_ptr = font_ring;
-
-    found = FALSE;
-    while (!found && (test_font = *chain_ptr++)) {
-        do {
-            if (test_font->font_id == font_id)
-                found = TRUE;
-        } while (!found && (test_font = test_font->next_font));
-    }
+    test_font = find_face(font_id, &chain_ptr);
 
     single_font = test_font;
     test_height = PTSIN[1];
@@ -734,22 +894,19 @@ void vdi_vst_height(Vwk * vwk)
  */
 static UWORD act_siz(Vwk * vwk, UWORD top)
 {
-    UWORD accu;
     UWORD retval;
-    UWORD i;
 
     if (vwk->dda_inc == 0xffff) {
         /* double size */
         return (top<<1);
     }
-    accu = 0x7fff;
-    retval = vwk->t_sclsts ? top : 0;
 
-    for (i = 0; i < top; i++) {
-        accu += vwk->dda_inc;
-        if (accu < vwk->dda_inc)
-            retval++;
-    }
+    /*
+     * this is the number of carries out of a 16-bit accumulator that
+     * starts at 0x7fff and has dda_inc added to it 'top' times
+     */
+    retval = vwk->t_sclsts ? top : 0;
+    retval += ((ULONG)top * vwk->dda_inc + 0x7fff) >> 16;
 
     /* if input is non-zero, make return value at least 1 */
     if (top && !retval)
@@ -815,20 +972,12 @@ void vdi_vst_point(Vwk * vwk)
     const Fonthead **chain_ptr, *double_font;
     const Fonthead *test_font, *single_font;
     WORD test_height, h;
-    BOOL found;
 
     font_id = vwk->cur_font->font_id;
     vwk->pts_mode = TRUE;
 
     /* Find the smallest font in the requested face */
-    chain_ptr = font_ring;
-    found = FALSE;
-    while (!found && (test_font = *chain_ptr++)) {
-        do {
-            if (test_font->font_id == font_id)
-                found = TRUE;
-        } while (!found && (test_font = test_font->next_font));
-    }
+    test_font = find_face(font_id, &chain_ptr);
 
     double_font = single_font = test_font;
     test_height = INTIN[0];
@@ -933,26 +1082,16 @@ void vdi_vst_font(Vwk * vwk)
     WORD *old_intin, point, *old_ptsout, dummy[4], *old_ptsin;
     WORD face;
     const Fonthead *test_font, **chain_ptr;
-    BOOL found;
 
     test_font = vwk->cur_font;
     point = test_font->point;
     dummy[1] = test_font->top;
     face = INTIN[0];
 
-    chain_ptr = font_ring;
+    test_font = find_face(face, &chain_ptr);
 
-    found = FALSE;
-    while (!found && (test_font = *chain_ptr++)) {
-        do {
-            if (test_font->font_id == face)
-                found = TRUE;
-        } while (!found && (test_font = test_font->next_font));
-    }
-
-    /* If we fell through the loop, we could not find the face. */
-    /* Default to the system font.                  */
-    if (!found)
+    /* If we could not find the face, default to the system font. */
+    if (!test_font)
         test_font = &fon6x6;
 
     /* Call down to the set text height routine to get the proper size */
@@ -974,6 +1113,10 @@ void vdi_vst_font(Vwk * vwk)
     PTSOUT = old_ptsout;
 
     INTOUT[0] = vwk->cur_font->font_id;
+
+#if CONF_WITH_VDI_GLYPH_CACHE
+    glyph_cache_flush();
+#endif
 }
 
 
@@ -1332,6 +1475,12 @@ void vdi_vst_load_fonts(Vwk * vwk)
     } while (first_font);
 
     font_ring[2] = vwk->loaded_fonts;
+#if CONF_WITH_VDI_FONT_INDEX
+    build_font_index();
+#endif
+#if CONF_WITH_VDI_GLYPH_CACHE
+    glyph_cache_flush();
+#endif
 
     /* Update the device table count of faces. */
     vwk->num_fonts += count;
@@ -1351,6 +1500,12 @@ void vdi_vst_unload_fonts(Vwk * vwk)
     vwk->scrpt2 = SCRATCHBUF_OFFSET;    /* Reset pointers to default buffers */
     vwk->scrtchp = vdishare.deftxbuf;
     vwk->num_fonts = font_count;        /* Reset font count to default */
+#if CONF_WITH_VDI_FONT_INDEX
+    build_font_index();
+#endif
+#if CONF_WITH_VDI_GLYPH_CACHE
+    glyph_cache_flush();
+#endif
 #endif
 }
 
@@ -21,6 +21,7 @@
 #include "vdistub.h"
 #include "lineavars.h"
 #include "biosext.h"
+#include "string.h"
 
 
 /*
@@ -741,6 +742,153 @@ void scale(LOCALVARS *vars)
 
 
 #if CONF_WITH_VDI_TEXT_SPEEDUP
+/*
+ * operations performed on one plane by direct_screen_blit(), depending
+ * on the writing mode and the corresponding bit of the foreground colour
+ */
+#define DB_COPY     0           /* replace, colour bit set */
+#define DB_CLEAR    1           /* replace, colour bit clear */
+#define DB_OR       2           /* transparent, colour bit set */
+#define DB_ANDNOT   3           /* transparent, colour bit clear */
+#define DB_XOR      4           /* xor, either colour bit */
+#define DB_ORNOT    5           /* reverse transparent, colour bit set */
+#define DB_AND      6           /* reverse transparent, colour bit clear */
+
+/*
+ * copy one character to one plane of the screen
+ */
+static void direct_blit_byte(WORD op, const UBYTE *p, UBYTE *q,
+                                WORD height, WORD src_width, WORD dst_width)
+{
+    WORD n;
+
+    switch(op) {
+    case DB_COPY:
+        for (n = height; n > 0; n--, p += src_width, q += dst_width)
+            *q = *p;
+        break;
+    case DB_CLEAR:
+        for (n = height; n > 0; n--, q += dst_width)
+            *q = 0;
+        break;
+    case DB_OR:
+        for (n = height; n > 0; n--, p += src_width, q += dst_width)
+            *q |= *p;
+        break;
+    case DB_ANDNOT:
+        for (n = height; n > 0; n--, p += src_width, q += dst_width)
+            *q &= ~*p;
+        break;
+    case DB_XOR:
+        for (n = height; n > 0; n--, p += src_width, q += dst_width)
+            *q ^= *p;
+        break;
+    case DB_ORNOT:
+        for (n = height; n > 0; n--, p += src_width, q += dst_width)
+            *q |= ~*p;
+        break;
+    case DB_AND:
+        for (n = height; n > 0; n--, p += src_width, q += dst_width)
+            *q &= *p;
+        break;
+    }
+}
+
+/*
+ * copy two characters that share a screen word to one plane of the
+ * screen, accessing the screen (which is much slower than the font data
+ * on some machines) a word at a time
+ */
+static void direct_blit_word(WORD op, const UBYTE *p1, const UBYTE *p2, UBYTE *q,
+                                WORD height, WORD src_width, WORD dst_width)
+{
+    WORD n, d;
+
+    d = p2 - p1;
+
+#define GLYPHS  (((UWORD)*p1 << 8) | p1[d])
+    switch(op) {
+    case DB_COPY:
+        for (n = height; n > 0; n--, p1 += src_width, q += dst_width)
+            *(UWORD *)q = GLYPHS;
+        break;
+    case DB_CLEAR:
+        for (n = height; n > 0; n--, q += dst_width)
+            *(UWORD *)q = 0;
+        break;
+    case DB_OR:
+        for (n = height; n > 0; n--, p1 += src_width, q += dst_width)
+            *(UWORD *)q |= GLYPHS;
+        break;
+    case DB_ANDNOT:
+        for (n = height; n > 0; n--, p1 += src_width, q += dst_width)
+            *(UWORD *)q &= ~GLYPHS;
+        break;
+    case DB_XOR:
+        for (n = height; n > 0; n--, p1 += src_width, q += dst_width)
+            *(UWORD *)q ^= GLYPHS;
+        break;
+    case DB_ORNOT:
+        for (n = height; n > 0; n--, p1 += src_width, q += dst_width)
+            *(UWORD *)q |= ~GLYPHS;
+        break;
+    case DB_AND:
+        for (n = height; n > 0; n--, p1 += src_width, q += dst_width)
+            *(UWORD *)q &= GLYPHS;
+        break;
+    }
+#undef GLYPHS
+}
+
+#if CONF_WITH_VDI_16BIT
+/*
+ * output the font directly to the screen in 16-bit mode
+ */
+static void truecolor_screen_blit(WORD count, WORD *str)
+{
+    const UWORD fg = truecolor_palette[TEXTFG & 0xff];
+    const UWORD bg = truecolor_palette[0];
+    const WORD mode = WRT_MODE;
+    const WORD dst_width = v_lin_wr / sizeof(UWORD);
+    UWORD *dst, *q;
+    const UBYTE *p;
+    WORD n, pixel;
+    UBYTE glyph;
+
+    dst = (UWORD *)(v_bas_ad + muls(DESTY, v_lin_wr)) + DESTX;
+
+    for ( ; count > 0; count--, dst += 8)
+    {
+        p = (const UBYTE *)FBASE + *str++;
+        for (n = DELY, q = dst; n > 0; n--, p += FWIDTH, q += dst_width)
+        {
+            glyph = *p;
+            for (pixel = 0; pixel < 8; pixel++, glyph <<= 1)
+            {
+                switch(mode) {
+                default:    /* WM_REPLACE */
+                    q[pixel] = (glyph & 0x80) ? fg : bg;
+                    break;
+                case WM_TRANS:
+                    if (glyph & 0x80)
+                        q[pixel] = fg;
+                    break;
+                case WM_XOR:
+                    if (glyph & 0x80)
+                        q[pixel] = ~q[pixel];
+                    break;
+                case WM_ERASE:
+                    if (!(glyph & 0x80))
+                        q[pixel] = fg;
+                    break;
+                }
+            }
+        }
+    }
+}
+#endif
+
+
 /*
  * output the font directly to the screen
  *
@@ -749,105 +897,89 @@ void scale(LOCALVARS *vars)
  */
 void direct_screen_blit(WORD count, WORD *str)
 {
-    WORD forecol, height, mode, n, planes;
+    WORD forecol, height, mode, plane;
     WORD src_width, dst_width;
-    UBYTE *src, *dst, *save_dst;
+    UBYTE *dst;
+    const UBYTE *src, *src2;
+    UBYTE op[8];                /* per-plane operation (max 8 planes) */
+
+#if CONF_WITH_VDI_16BIT
+    if (TRUECOLOR_MODE)
+    {
+        truecolor_screen_blit(count, str);
+        return;
+    }
+#endif
 
     height = DELY;
     mode = WRT_MODE;
     src_width = FWIDTH;
     dst_width = v_lin_wr;
 
+#if CONF_WITH_AMIGA_PLANAR
+    amiga_screen_dirty(DESTY, DESTY+height-1);
+#endif
+
+    /*
+     * work out what to do to each plane, once for the whole string
+     */
+    forecol = TEXTFG;
+    for (plane = 0; plane < v_planes; plane++, forecol >>= 1)
+    {
+        switch(mode) {
+        default:    /* WM_REPLACE */
+            op[plane] = (forecol & 1) ? DB_COPY : DB_CLEAR;
+            break;
+        case WM_TRANS:
+            op[plane] = (forecol & 1) ? DB_OR : DB_ANDNOT;
+            break;
+        case WM_XOR:
+            op[plane] = DB_XOR;
+            break;
+        case WM_ERASE:
+            op[plane] = (forecol & 1) ? DB_ORNOT : DB_AND;
+            break;
+        }
+    }
+
     dst = (UBYTE *)get_start_addr(DESTX, DESTY);
-    if (DESTX & 0x0008)
-        dst++;
 
-    for ( ; count > 0; count--)
+    /*
+     * if we start in the second half of a screen word, output that
+     * character on its own
+     */
+    if ((DESTX & 0x0008) && (count > 0))
     {
-        src = (UBYTE *)FBASE + *str++;
-        save_dst = dst;
-        forecol = TEXTFG;
-        for (planes = v_planes; planes > 0; planes--)
-        {
-            UBYTE *p, *q;
+        src = (const UBYTE *)FBASE + *str++;
+        for (plane = 0; plane < v_planes; plane++)
+            direct_blit_byte(op[plane], src, dst + plane*sizeof(WORD) + 1,
+                                height, src_width, dst_width);
+        dst += v_planes * sizeof(WORD);
+        count--;
+    }
 
-            switch(mode) {
-            default:    /* WM_REPLACE */
-                if (forecol & 1)
-                {
-                    for (n = height, p = src, q = dst; n > 0; n--)
-                    {
-                        *q = *p;
-                        p += src_width;
-                        q += dst_width;
-                    }
-                }
-                else
-                {
-                    for (n = height, q = dst; n > 0; n--)
-                    {
-                        *q = 0;
-                        q += dst_width;
-                    }
-                }
-                break;
-            case WM_TRANS:
-                if (forecol & 1)
-                {
-                    for (n = height, p = src, q = dst; n > 0; n--)
-                    {
-                        *q |= *p;
-                        p += src_width;
-                        q += dst_width;
-                    }
-                }
-                else
-                {
-                    for (n = height, p = src, q = dst; n > 0; n--)
-                    {
-                        *q &= ~*p;
-                        p += src_width;
-                        q += dst_width;
-                    }
-                }
-                break;
-            case WM_XOR:
-                for (n = height, p = src, q = dst; n > 0; n--)
-                {
-                    *q ^= *p;
-                    p += src_width;
-                    q += dst_width;
-                }
-                break;
-            case WM_ERASE:
-                if (forecol & 1)
-                {
-                    for (n = height, p = src, q = dst; n > 0; n--)
-                    {
-                        *q |= ~*p;
-                        p += src_width;
-                        q += dst_width;
-                    }
-                }
-                else
-                {
-                    for (n = height, p = src, q = dst; n > 0; n--)
-                    {
-                        *q &= *p;
-                        p += src_width;
-                        q += dst_width;
-                    }
-                }
-                break;
-            }
-            dst += sizeof(WORD);    /* next plane */
-            forecol >>= 1;
-        }
-        dst = save_dst + 1;
-        if (!IS_ODD_POINTER(dst))   /* must go to next screen word */
-        {
-            dst += (v_planes-1)*sizeof(WORD);
-        }
+    /*
+     * then output pairs of characters a screen word at a time
+     */
+    for ( ; count > 1; count -= 2)
+    {
+        src = (const UBYTE *)FBASE + *str++;
+        src2 = (const UBYTE *)FBASE + *str++;
+        for (plane = 0; plane < v_planes; plane++)
+            direct_blit_word(op[plane], src, src2, dst + plane*sizeof(WORD),
+                                height, src_width, dst_width);
+        dst += v_planes * sizeof(WORD);
+    }
+
+    /*
+     * and finally any character left over
+     */
+    if (count > 0)
+    {
+        src = (const UBYTE *)FBASE + *str;
+        for (plane = 0; plane < v_planes; plane++)
+            direct_blit_byte(op[plane], src, dst + plane*sizeof(WORD),
+                                height, src_width, dst_width);
     }
 }
 #endif
@@ -889,9 +1021,183 @@ static void screen_blit(LOCALVARS *vars)
     vars->d_next = -v_lin_wr;
 
     normal_blit(vars+1, vars->sform, vars->dform);  /* call assembler helper function */
+
+#if CONF_WITH_AMIGA_PLANAR
+    amiga_screen_dirty(vars->DESTY, vars->DESTY+vars->DELY-1);
+#endif
+}
+
+
+/*
+ * do the scaling, skewing/thickening/outlining and rotation that must
+ * be done before the character is blitted to the screen
+ */
+static void apply_effects(LOCALVARS *vars, BOOL prerender)
+{
+    if (SCALE)
+    {
+        scale(vars);
+    }
+
+    if (prerender)
+    {
+        pre_blit(vars);
+    }
+
+    if (CHUP)
+    {
+        rotate(vars);
+    }
+}
+
+
+#if CONF_WITH_VDI_GLYPH_CACHE
+/*
+ * glyph cache
+ *
+ * this holds the results of apply_effects() for recently-output
+ * characters, so that drawing the same text again with the same scaling,
+ * effects & rotation only requires the final blit.  an entry is keyed by
+ * all the inputs to apply_effects(), including the horizontal DDA, so
+ * that the result is exactly the same as recalculating it.
+ */
+#define GLYPH_CACHE_ENTRIES 16
+#define GLYPH_DATA_SIZE     (SCRATCHBUF_SIZE/2)
+
+typedef struct {
+    const UWORD *fbase;         /* NULL => entry unused */
+    WORD fwidth;
+    WORD sourcex, sourcey;
+    WORD delx, dely;
+    WORD style;                 /* effects that are pre-rendered */
+    WORD prerender;
+    WORD chup;
+    WORD scale;
+    UWORD ddainc;
+    WORD scaldir;
+    WORD xdda;
+    WORD weight;
+    WORD loff, roff;
+    WORD skewmask;
+} GLYPHKEY;
+
+typedef struct {
+    GLYPHKEY key;
+    ULONG used;                 /* for LRU replacement */
+                        /* results of apply_effects() */
+    WORD delx, dely;
+    WORD s_next;
+    WORD style;
+    WORD smear;
+    WORD tmp_delx, tmp_dely;
+    WORD swap_tmps;
+    WORD sourcex;
+    WORD xdda;
+    UBYTE data[GLYPH_DATA_SIZE];
+} GLYPH;
+
+static GLYPH glyph_cache[GLYPH_CACHE_ENTRIES];
+static ULONG glyph_clock;
+
+
+/*
+ * empty the glyph cache
+ *
+ * this must be called whenever font data may have changed
+ */
+void glyph_cache_flush(void)
+{
+    WORD i;
+
+    for (i = 0; i < GLYPH_CACHE_ENTRIES; i++)
+        glyph_cache[i].key.fbase = NULL;
 }
 
 
+/*
+ * apply_effects() via the glyph cache
+ */
+static void cached_effects(LOCALVARS *vars, BOOL prerender)
+{
+    GLYPHKEY key;
+    GLYPH *g, *lru;
+    WORD i, size;
+
+    bzero(&key, sizeof(key));
+    key.fbase = FBASE;
+    key.fwidth = FWIDTH;
+    key.sourcex = SOURCEX;
+    key.sourcey = SOURCEY;
+    key.delx = vars->DELX;
+    key.dely = vars->DELY;
+    key.style = vars->STYLE & (F_SKEW|F_THICKEN|F_OUTLINE);
+    key.prerender = prerender;
+    key.chup = CHUP;
+    key.scale = SCALE;
+    if (SCALE)
+    {
+        key.ddainc = DDAINC;
+        key.scaldir = SCALDIR;
+        key.xdda = XDDA;
+    }
+    if (prerender)
+    {
+        key.weight = WEIGHT;
+        key.loff = LOFF;
+        key.roff = ROFF;
+        key.skewmask = SKEWMASK;
+    }
+
+    for (i = 0, g = glyph_cache, lru = g; i < GLYPH_CACHE_ENTRIES; i++, g++)
+    {
+        if (g->key.fbase && (memcmp(&g->key, &key, sizeof(key)) == 0))
+        {
+            g->used = ++glyph_clock;
+            vars->DELX = g->delx;
+            vars->DELY = g->dely;
+            vars->s_next = g->s_next;
+            vars->STYLE = g->style;
+            vars->smear = g->smear;
+            vars->tmp_delx = g->tmp_delx;
+            vars->tmp_dely = g->tmp_dely;
+            vars->swap_tmps = g->swap_tmps;
+            vars->sform = g->data;
+            SOURCEX = g->sourcex;
+            SOURCEY = 0;
+            XDDA = g->xdda;
+            return;
+        }
+        if (g->used < lru->used)
+            lru = g;
+    }
+
+    apply_effects(vars, prerender);
+
+    /*
+     * all the effects leave the character at the top of the form, so we
+     * can save it if it fits
+     */
+    size = vars->s_next * vars->DELY;
+    if ((SOURCEY != 0) || (vars->s_next <= 0) || (size > GLYPH_DATA_SIZE))
+        return;
+
+    lru->key = key;
+    lru->used = ++glyph_clock;
+    lru->delx = vars->DELX;
+    lru->dely = vars->DELY;
+    lru->s_next = vars->s_next;
+    lru->style = vars->STYLE;
+    lru->smear = vars->smear;
+    lru->tmp_delx = vars->tmp_delx;
+    lru->tmp_dely = vars->tmp_dely;
+    lru->swap_tmps = vars->swap_tmps;
+    lru->sourcex = SOURCEX;
+    lru->xdda = XDDA;
+    memcpy(lru->data, vars->sform, size);
+}
+#endif
+
+
 /*
  * resize characters for line-A
  *
@@ -943,6 +1249,7 @@ void text_blt(void)
     LOCALVARS vars;
     WORD clipped, delx, dely, weight;
     WORD temp;
+    BOOL prerender;
 
     vars.swap_tmps = 0;
 
@@ -1008,11 +1315,6 @@ void text_blt(void)
     vars.s_next = FWIDTH;
     vars.sform = (UBYTE *)FBASE;
 
-    if (SCALE)
-    {
-        scale(&vars);
-    }
-
     /*
      * the following is equivalent to:
      *  if outlining, OR
@@ -1020,20 +1322,23 @@ void text_blt(void)
      *     skewing AND clipping-is-required,
      *      call pre_blit()
      */
+    prerender = FALSE;
     if (vars.STYLE & (F_SKEW|F_THICKEN|F_OUTLINE))
     {
         if (CHUP
          || ((vars.STYLE & F_SKEW) && clipped)
          || (vars.STYLE & F_OUTLINE))
         {
-            pre_blit(&vars);
+            prerender = TRUE;
         }
     }
 
-    if (CHUP)
-    {
-        rotate(&vars);
-    }
+#if CONF_WITH_VDI_GLYPH_CACHE
+    if (SCALE || prerender || CHUP)
+        cached_effects(&vars, prerender);
+#else
+    apply_effects(&vars, prerender);
+#endif
 
     if (vars.STYLE & F_THICKEN)
     {
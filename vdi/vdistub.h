@@ -20,6 +20,9 @@ struct blit_frame;
  * below as trap #2 handler. */
 void vditrap(void);
 
+/* the jsr-able VDI dispatcher, called with the VDI parameter block in d1 */
+void GSX_ENTRY(void);
+
 /* shared VDI functions & VDI line-A wrapper functions */
 void cur_display (struct Mcdb_ *sprite, struct _mcs *mcs, WORD x, WORD y);
 void cur_replace (struct _mcs *mcs);
@@ -32,10 +35,17 @@ void linea_transform_mouse(void);
 void linea_rect(void);
 void linea_hline(void);
 void linea_polygon(void);
+#if CONF_WITH_LINEA_RECTS
+void linea_rects(void);
+#endif
 void linea_line(void);
 void linea_fill(void);
 void linea_blit(struct blit_frame *info);
 void linea_raster(void);
+#if CONF_WITH_LAZY_LINEA_SYNC
+extern BOOL linea_in_use;   /* TRUE once a line-A opcode has been executed */
+void linea_start(void);
+#endif
 
 /* End of the VDI BSS section.
  * This is referenced by the OSHEADER */